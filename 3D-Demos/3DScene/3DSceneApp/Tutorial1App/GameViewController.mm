@@ -18,6 +18,7 @@
 #import "GaProject.h"
 #import "ApConfig.h"
 #import "RsImpl.h"
+#import "RsGL.h"
 #import "ShTouch.h"
 #import "BtTime.h"
 #import "SdSoundImpl.h"
@@ -653,20 +654,20 @@ CVOpenGLESTextureRef createTexture( CVOpenGLESTextureCacheRef textureCache,
     CbCrTexture = createTexture(_videoTextureCache, pixelBuffer, 1, GL_LUMINANCE_ALPHA );
     
     // Bind the Y texture and set up its texture stage states
-    glBindTexture(CVOpenGLESTextureGetTarget(yTexture), CVOpenGLESTextureGetName(yTexture));
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(CVOpenGLESTextureGetTarget(yTexture), 0);
+    RsGL::BindTexture(CVOpenGLESTextureGetTarget(yTexture), CVOpenGLESTextureGetName(yTexture));
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    RsGL::BindTexture(CVOpenGLESTextureGetTarget(yTexture), 0);
     
     // Bind the cbcr texture and set up its texture stage states
-    glBindTexture(CVOpenGLESTextureGetTarget(CbCrTexture), CVOpenGLESTextureGetName(CbCrTexture));
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(CVOpenGLESTextureGetTarget(CbCrTexture), 0);
+    RsGL::BindTexture(CVOpenGLESTextureGetTarget(CbCrTexture), CVOpenGLESTextureGetName(CbCrTexture));
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    RsGL::BindTexture(CVOpenGLESTextureGetTarget(CbCrTexture), 0);
     
     int yTextureGL = CVOpenGLESTextureGetName(yTexture);
     int CbCrTextureGL = CVOpenGLESTextureGetName(CbCrTexture);
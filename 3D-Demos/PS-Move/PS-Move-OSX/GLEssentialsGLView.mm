@@ -3,6 +3,7 @@
 #import "ScMain.h"
 #import "BtTime.h"
 #import "RsImpl.h"
+#import "RsGL.h"
 #import "ApConfig.h"
 #import "SdSoundImpl.h"
 #import "SdSound.h"
@@ -157,8 +158,8 @@ static CVReturn MyDisplayLinkCallback(CVDisplayLinkRef displayLink,
     
     // Create a vertex array object (VAO) to cache model parameters
     GLuint vaoName;
-    glGenVertexArrays(1, &vaoName);
-    glBindVertexArray(vaoName);
+    RsGL::GenVertexArrays(1, &vaoName);
+    RsGL::BindVertexArray(vaoName);
     
     BtTime::SetTick( 1.0f / 60.0f );
     
@@ -339,7 +340,7 @@ static CVReturn MyDisplayLinkCallback(CVDisplayLinkRef displayLink,
     // Render the project
     myProject.Render();
     
-    glBindFramebuffer(GL_FRAMEBUFFER, 0 );
+    RsGL::BindFramebuffer(GL_FRAMEBUFFER, 0 );
 
     // Render
     RsImpl::pInstance()->Render();
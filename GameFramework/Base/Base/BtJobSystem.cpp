@@ -0,0 +1,469 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtJobSystem.cpp
+
+#include "BtJobSystem.h"
+#include "BtThread.h"
+#include "BtMutex.h"
+#include "BtAtomic.h"
+#include "BtProfiler.h"
+#include "BtBase.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Queues. One per worker plus a shared one for threads that aren't workers
+
+struct LBtJobQueue
+{
+	BtJob							m_jobs[MaxJobsPerQueue];
+	BtU32							m_top;				// Thieves take from here
+	BtU32							m_bottom;			// The owner pushes and pops here
+	volatile BtS32					m_lock;
+};
+
+const BtU32 LBtJobQueueMask = MaxJobsPerQueue - 1;
+const BtU32 LBtSharedQueue = MaxJobWorkers;
+
+static LBtJobQueue g_queues[MaxJobWorkers + 1];
+
+////////////////////////////////////////////////////////////////////////////////
+// Workers
+
+class BtJobWorker : public BtThread
+{
+public:
+
+	BtJobWorker( BtU32 iWorker ) : m_iWorker( iWorker ) {}
+
+	void							Create();
+	void							Destroy() {}
+	void							Update();
+
+private:
+
+	BtU32							m_iWorker;
+};
+
+static BtJobWorker* g_pWorkers[MaxJobWorkers];
+static BtU32 g_numWorkers = 0;
+static BtBool g_isCreated = BtFalse;
+
+// Queue index + 1 of the worker running on this thread. Zero for any other thread
+static BtThreadLocal BtU32 g_workerSlot = 0;
+
+// Idle workers sleep on this until there is something to steal
+static BtMutex* g_pWakeMutex = BtNull;
+static BtConditionVariable* g_pWakeCondition = BtNull;
+static volatile BtS32 g_pendingJobs = 0;
+static volatile BtS32 g_sleepingWorkers = 0;
+static volatile BtS32 g_quit = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtGetQueue
+
+static BtU32 LBtGetQueue()
+{
+	if( g_workerSlot == 0 )
+	{
+		return LBtSharedQueue;
+	}
+	return g_workerSlot - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtPushJob
+
+static BtBool LBtPushJob( BtU32 iQueue, const BtJob& job )
+{
+	LBtJobQueue& queue = g_queues[iQueue];
+
+	BtSpinLock( &queue.m_lock );
+
+	if( queue.m_bottom - queue.m_top >= MaxJobsPerQueue )
+	{
+		BtSpinUnlock( &queue.m_lock );
+		return BtFalse;
+	}
+
+	queue.m_jobs[queue.m_bottom & LBtJobQueueMask] = job;
+	queue.m_bottom++;
+
+	BtSpinUnlock( &queue.m_lock );
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtWakeWorkers
+
+static void LBtWakeWorkers( BtS32 numJobs )
+{
+	BtAtomicAdd( &g_pendingJobs, numJobs );
+
+	// Both counters are full barriers so either we see the sleeper or it sees the job
+	if( BtAtomicLoad( &g_sleepingWorkers ) > 0 )
+	{
+		g_pWakeMutex->Lock();
+
+		if( numJobs == 1 )
+		{
+			g_pWakeCondition->NotifyOne();
+		}
+		else
+		{
+			g_pWakeCondition->NotifyAll();
+		}
+		g_pWakeMutex->Unlock();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Create
+
+void BtJobWorker::Create()
+{
+	BtProfiler::SetThreadName( "BtJobWorker" );
+
+	g_workerSlot = m_iWorker + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+
+void BtJobWorker::Update()
+{
+	if( BtJobSystem::RunNextJob( m_iWorker ) == BtFalse )
+	{
+		BtJobSystem::Sleep();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateManager
+
+//static
+void BtJobSystem::CreateManager( BtU32 numWorkers )
+{
+	BtAssert( g_isCreated == BtFalse );
+
+	if( numWorkers == 0 )
+	{
+		numWorkers = BtThread::GetNumProcessors();
+	}
+	if( numWorkers > MaxJobWorkers )
+	{
+		numWorkers = MaxJobWorkers;
+	}
+	if( numWorkers < 1 )
+	{
+		numWorkers = 1;
+	}
+
+	for( BtU32 i=0; i<MaxJobWorkers + 1; i++ )
+	{
+		g_queues[i].m_top = 0;
+		g_queues[i].m_bottom = 0;
+		g_queues[i].m_lock = 0;
+	}
+
+	g_pWakeMutex = new BtMutex;
+	g_pWakeCondition = new BtConditionVariable;
+	g_pendingJobs = 0;
+	g_sleepingWorkers = 0;
+	g_quit = 0;
+	g_numWorkers = numWorkers;
+	g_isCreated = BtTrue;
+
+	// The calling thread is worker zero
+	g_workerSlot = 1;
+
+	for( BtU32 i=1; i<numWorkers; i++ )
+	{
+		g_pWorkers[i] = new BtJobWorker( i );
+		g_pWorkers[i]->Start();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DestroyManager
+
+//static
+void BtJobSystem::DestroyManager()
+{
+	if( g_isCreated == BtFalse )
+	{
+		return;
+	}
+
+	BtAtomicStore( &g_quit, 1 );
+
+	g_pWakeMutex->Lock();
+	g_pWakeCondition->NotifyAll();
+	g_pWakeMutex->Unlock();
+
+	for( BtU32 i=1; i<g_numWorkers; i++ )
+	{
+		g_pWorkers[i]->End();
+		delete g_pWorkers[i];
+		g_pWorkers[i] = BtNull;
+	}
+
+	delete g_pWakeCondition;
+	delete g_pWakeMutex;
+	g_pWakeCondition = BtNull;
+	g_pWakeMutex = BtNull;
+
+	g_workerSlot = 0;
+	g_numWorkers = 0;
+	g_isCreated = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run
+
+//static
+void BtJobSystem::Run( BtJobFunction function, void* pContext, BtU32 iStart, BtU32 iEnd, BtJobCounter* pCounter )
+{
+	BtJob job;
+	job.m_function = function;
+	job.m_pContext = pContext;
+	job.m_iStart = iStart;
+	job.m_iEnd = iEnd;
+	job.m_pCounter = pCounter;
+
+	if( pCounter != BtNull )
+	{
+		BtAtomicAdd( &pCounter->m_count, 1 );
+	}
+
+	// Without workers, or with a full queue, the job runs straight away
+	if( ( g_isCreated == BtFalse ) || ( LBtPushJob( LBtGetQueue(), job ) == BtFalse ) )
+	{
+		Execute( job );
+		return;
+	}
+
+	LBtWakeWorkers( 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wait
+
+//static
+void BtJobSystem::Wait( BtJobCounter* pCounter )
+{
+	BtU32 iQueue = LBtGetQueue();
+
+	while( BtAtomicLoad( &pCounter->m_count ) > 0 )
+	{
+		// Help out rather than block. The jobs we are waiting for may be in our own queue
+		if( ( g_isCreated == BtFalse ) || ( RunNextJob( iQueue ) == BtFalse ) )
+		{
+			BtAtomicPause();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ParallelFor
+
+//static
+void BtJobSystem::ParallelFor( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext )
+{
+	if( count == 0 )
+	{
+		return;
+	}
+
+	// Default to a few ranges per worker so stealing can even out the load
+	if( grainSize == 0 )
+	{
+		BtU32 numRanges = ( g_numWorkers > 0 ? g_numWorkers : 1 ) * 4;
+		grainSize = ( count + numRanges - 1 ) / numRanges;
+	}
+
+	if( ( g_isCreated == BtFalse ) || ( g_numWorkers == 1 ) || ( count <= grainSize ) )
+	{
+		function( pContext, 0, count );
+		return;
+	}
+
+	BtJobCounter counter;
+	BtU32 iQueue = LBtGetQueue();
+	BtS32 numPushed = 0;
+
+	// Queue all but the first range and run that one ourselves
+	for( BtU32 iStart = grainSize; iStart < count; iStart += grainSize )
+	{
+		BtJob job;
+		job.m_function = function;
+		job.m_pContext = pContext;
+		job.m_iStart = iStart;
+		job.m_iEnd = ( count - iStart > grainSize ) ? iStart + grainSize : count;
+		job.m_pCounter = &counter;
+
+		BtAtomicAdd( &counter.m_count, 1 );
+
+		if( LBtPushJob( iQueue, job ) == BtTrue )
+		{
+			numPushed++;
+		}
+		else
+		{
+			Execute( job );
+		}
+	}
+
+	if( numPushed > 0 )
+	{
+		LBtWakeWorkers( numPushed );
+	}
+
+	function( pContext, 0, grainSize );
+
+	Wait( &counter );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RunNextJob
+
+//static
+BtBool BtJobSystem::RunNextJob( BtU32 iQueue )
+{
+	BtJob job;
+
+	BtBool found = PopJob( iQueue, job );
+
+	// Try everyone else, starting with our neighbour so thieves spread out
+	for( BtU32 i=0; ( found == BtFalse ) && ( i<g_numWorkers ); i++ )
+	{
+		BtU32 iVictim = ( iQueue + 1 + i ) % g_numWorkers;
+
+		if( iVictim != iQueue )
+		{
+			found = StealJob( iVictim, job );
+		}
+	}
+
+	if( ( found == BtFalse ) && ( iQueue != LBtSharedQueue ) )
+	{
+		found = StealJob( LBtSharedQueue, job );
+	}
+
+	if( found == BtFalse )
+	{
+		return BtFalse;
+	}
+
+	BtAtomicAdd( &g_pendingJobs, -1 );
+
+	Execute( job );
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PopJob
+
+//static
+BtBool BtJobSystem::PopJob( BtU32 iQueue, BtJob& job )
+{
+	LBtJobQueue& queue = g_queues[iQueue];
+
+	BtSpinLock( &queue.m_lock );
+
+	if( queue.m_bottom == queue.m_top )
+	{
+		BtSpinUnlock( &queue.m_lock );
+		return BtFalse;
+	}
+
+	// Newest first while the data it touches is still in cache
+	queue.m_bottom--;
+	job = queue.m_jobs[queue.m_bottom & LBtJobQueueMask];
+
+	BtSpinUnlock( &queue.m_lock );
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// StealJob
+
+//static
+BtBool BtJobSystem::StealJob( BtU32 iQueue, BtJob& job )
+{
+	LBtJobQueue& queue = g_queues[iQueue];
+
+	// Don't queue up behind the owner. There will be other victims
+	if( BtSpinTryLock( &queue.m_lock ) == BtFalse )
+	{
+		return BtFalse;
+	}
+
+	if( queue.m_bottom == queue.m_top )
+	{
+		BtSpinUnlock( &queue.m_lock );
+		return BtFalse;
+	}
+
+	// Oldest first. These tend to be the biggest pieces of work
+	job = queue.m_jobs[queue.m_top & LBtJobQueueMask];
+	queue.m_top++;
+
+	BtSpinUnlock( &queue.m_lock );
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Execute
+
+//static
+void BtJobSystem::Execute( BtJob& job )
+{
+	BtProfiler::Begin( "BtJob" );
+	job.m_function( job.m_pContext, job.m_iStart, job.m_iEnd );
+	BtProfiler::End();
+
+	if( job.m_pCounter != BtNull )
+	{
+		BtAtomicAdd( &job.m_pCounter->m_count, -1 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sleep
+
+//static
+void BtJobSystem::Sleep()
+{
+	g_pWakeMutex->Lock();
+
+	BtAtomicAdd( &g_sleepingWorkers, 1 );
+
+	while( ( BtAtomicLoad( &g_pendingJobs ) <= 0 ) && ( BtAtomicLoad( &g_quit ) == 0 ) )
+	{
+		g_pWakeCondition->Wait( *g_pWakeMutex );
+	}
+
+	BtAtomicAdd( &g_sleepingWorkers, -1 );
+
+	g_pWakeMutex->Unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumWorkers
+
+//static
+BtU32 BtJobSystem::GetNumWorkers()
+{
+	return g_numWorkers;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsCreated
+
+//static
+BtBool BtJobSystem::IsCreated()
+{
+	return g_isCreated;
+}
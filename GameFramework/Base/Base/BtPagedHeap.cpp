@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtPagedHeap.cpp
+
+#include "BtPagedHeap.h"
+#include "ErrorLog.h"
+#include "MtMath.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtPagedHeap::BtPagedHeap()
+{
+	m_name = "BtPagedHeap";
+	m_tag = BtMT_General;
+	m_firstPageSize = 0;
+	m_alignment = 1;
+	m_maxPages = MaxPagedHeapPages;
+	m_numPages = 0;
+	m_currentPage = 0;
+	m_offset = 0;
+	m_bytesUsed = 0;
+	m_numAllocations = 0;
+	m_capacity = 0;
+	m_numGrowths = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Create
+
+void BtPagedHeap::Create( const BtChar* name, BtMemoryTag tag, BtU32 firstPageSize, BtU32 alignment, BtU32 maxPages )
+{
+	BtAssert( m_numPages == 0 );
+	BtAssert( ( alignment & ( alignment - 1 ) ) == 0 );
+	BtAssert( alignment <= BtMemoryDefaultAlignment );
+	BtAssert( ( maxPages > 0 ) && ( maxPages <= MaxPagedHeapPages ) );
+
+	m_name = name;
+	m_tag = tag;
+	m_firstPageSize = firstPageSize;
+	m_alignment = alignment;
+	m_maxPages = maxPages;
+	m_capacity = 0;
+	m_numGrowths = 0;
+
+	Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy
+
+void BtPagedHeap::Destroy()
+{
+	for( BtU32 i=0; i<m_numPages; i++ )
+	{
+		BtMemory::Free( m_pPages[i] );
+	}
+	m_numPages = 0;
+	m_capacity = 0;
+
+	Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AllocatePage
+
+BtU8* BtPagedHeap::AllocatePage( BtU32 size )
+{
+	BtU32 iPage = ( m_numPages == 0 ) ? 0 : m_currentPage + 1;
+
+	if( iPage == m_maxPages )
+	{
+		ErrorLog::Fatal_Printf( "%s is out of pages. %d bytes used\n", m_name, m_bytesUsed );
+		return BtNull;
+	}
+
+	// Pages are reused in order. Replace one that is too small for this allocation
+	if( ( iPage < m_numPages ) && ( m_pageSize[iPage] < size ) )
+	{
+		m_capacity -= m_pageSize[iPage];
+		BtMemory::Free( m_pPages[iPage] );
+		m_pPages[iPage] = BtMemory::Allocate( m_tag, size );
+		m_pageSize[iPage] = size;
+		m_capacity += size;
+	}
+	else if( iPage == m_numPages )
+	{
+		if( iPage > 0 )
+		{
+			++m_numGrowths;
+		}
+
+		// Double the capacity each time so a busy frame only needs a few pages
+		BtU32 pageSize = MtMax( MtMax( m_firstPageSize, m_capacity ), size );
+
+		m_pPages[iPage] = BtMemory::Allocate( m_tag, pageSize );
+		m_pageSize[iPage] = pageSize;
+		++m_numPages;
+
+		m_capacity += pageSize;
+	}
+
+	m_currentPage = iPage;
+	m_offset = size;
+	m_bytesUsed += size;
+	++m_numAllocations;
+
+	return m_pPages[iPage];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reset
+
+void BtPagedHeap::Reset()
+{
+#if defined( _DEBUG )
+	// Scribble over what was allocated so anything still holding it shows up
+	for( BtU32 i=0; ( i<=m_currentPage ) && ( i<m_numPages ); i++ )
+	{
+		BtU32 used = ( i == m_currentPage ) ? m_offset : m_pageSize[i];
+		BtMemory::Set( m_pPages[i], 0xDD, used );
+	}
+#endif
+
+	m_currentPage = 0;
+	m_offset = 0;
+	m_bytesUsed = 0;
+	m_numAllocations = 0;
+}
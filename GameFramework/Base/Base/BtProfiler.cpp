@@ -0,0 +1,481 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtProfiler.cpp
+
+#include <stdio.h>
+#include "BtProfiler.h"
+#include "BtThread.h"
+#include "BtAtomic.h"
+#include "BtMemory.h"
+#include "BtTime.h"
+#include "BtBase.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Capture state
+
+enum LBtCaptureState
+{
+	LBtCapture_Idle,
+	LBtCapture_Armed,						// Starts at the next BeginFrame
+	LBtCapture_Capturing,
+	LBtCapture_Ready,
+};
+
+const BtU32 LBtNoEvent = 0xFFFFFFFF;
+
+// Open markers remember which capture they belong to so a marker left open
+// across captures can't close an event in the next one
+struct LBtProfileMarker
+{
+	BtU32							m_index;
+	BtS32							m_capture;
+};
+
+// Only the owning thread writes its events, and it empties them itself when it first
+// records in a new capture. The slot goes back to the pool when the thread exits
+struct LBtProfileThread
+{
+	BtProfileEvent*					m_pEvents;
+	volatile BtS32					m_numEvents;
+	volatile BtS32					m_capture;			// The capture the events belong to
+	volatile BtS32					m_isUsed;
+	LBtProfileMarker				m_stack[MaxProfileDepth];
+	BtU32							m_depth;
+	const BtChar*					m_name;
+};
+
+static LBtProfileThread g_threads[MaxProfileThreads];
+static volatile BtS32 g_numThreads = 0;					// Slots ever used
+
+// Threads beyond MaxProfileThreads share this and record nothing
+static LBtProfileThread g_overflowThread;
+
+static BtThreadLocal LBtProfileThread* g_pThread = BtNull;
+
+static volatile BtS32 g_state = LBtCapture_Idle;
+static volatile BtS32 g_numDropped = 0;
+static volatile BtS32 g_capture = 0;
+static BtU32 g_frame = 0;
+static BtU32 g_numCaptureFrames = 0;
+static BtU64 g_captureStart = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtGetThread
+
+static LBtProfileThread* LBtGetThread()
+{
+	if( g_pThread == BtNull )
+	{
+		g_pThread = &g_overflowThread;
+
+		// Take the first free slot. Released slots keep their buffers for the next thread
+		for( BtU32 iThread=0; iThread<MaxProfileThreads; iThread++ )
+		{
+			LBtProfileThread* pThread = &g_threads[iThread];
+
+			if( BtAtomicCompareSwap( &pThread->m_isUsed, 0, 1 ) == BtTrue )
+			{
+				pThread->m_depth = 0;
+				pThread->m_name = BtNull;
+				g_pThread = pThread;
+
+				// Let WriteTrace see the slot
+				BtS32 numThreads = BtAtomicLoad( &g_numThreads );
+
+				while( ( numThreads <= (BtS32)iThread ) &&
+					   ( BtAtomicCompareSwap( &g_numThreads, numThreads, iThread + 1 ) == BtFalse ) )
+				{
+					numThreads = BtAtomicLoad( &g_numThreads );
+				}
+				break;
+			}
+		}
+	}
+	return g_pThread;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtIsCapturing
+
+// Peek first so markers cost next to nothing when idle. Once capturing load the state
+// properly so the capture number stored ahead of it is seen too
+static BtBool LBtIsCapturing()
+{
+	return ( BtAtomicPeek( &g_state ) == LBtCapture_Capturing ) &&
+		   ( BtAtomicLoad( &g_state ) == LBtCapture_Capturing );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtPrepareEvents
+
+// Returns the number of events the thread has recorded in this capture, emptying the
+// buffer the first time the thread records in a new one
+static BtS32 LBtPrepareEvents( LBtProfileThread* pThread )
+{
+	if( pThread->m_pEvents == BtNull )
+	{
+		pThread->m_pEvents = (BtProfileEvent*)BtMemory::Allocate( BtMT_General, sizeof( BtProfileEvent ) * MaxProfileEvents );
+	}
+
+	BtS32 capture = BtAtomicPeek( &g_capture );
+
+	if( pThread->m_capture != capture )
+	{
+		BtAtomicStore( &pThread->m_numEvents, 0 );
+		BtAtomicStore( &pThread->m_capture, capture );
+	}
+	return pThread->m_numEvents;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Begin
+
+//static
+void BtProfiler::Begin( const BtChar* name )
+{
+	LBtProfileThread* pThread = LBtGetThread();
+
+	LBtProfileMarker marker;
+	marker.m_index = LBtNoEvent;
+	marker.m_capture = BtAtomicPeek( &g_capture );
+
+	if( ( LBtIsCapturing() == BtTrue ) && ( pThread != &g_overflowThread ) )
+	{
+		// Buffers are only made for threads that are recorded
+		BtS32 numEvents = LBtPrepareEvents( pThread );
+		marker.m_capture = pThread->m_capture;
+
+		if( ( pThread->m_pEvents != BtNull ) && ( numEvents < (BtS32)MaxProfileEvents ) )
+		{
+			BtProfileEvent& event = pThread->m_pEvents[numEvents];
+			event.m_name = name;
+			event.m_start = BtTime::GetElapsedTimeInNanoseconds();
+			event.m_end = 0;
+			event.m_depth = pThread->m_depth;
+			event.m_frame = g_frame;
+			event.m_value = 0;
+			event.m_isCounter = BtFalse;
+
+			marker.m_index = numEvents;
+
+			// Publish the event to WriteTrace
+			BtAtomicStore( &pThread->m_numEvents, numEvents + 1 );
+		}
+		else
+		{
+			BtAtomicAdd( &g_numDropped, 1 );
+		}
+	}
+
+	// Keep counting depth past the end of the stack so Begin and End stay paired
+	if( pThread->m_depth < MaxProfileDepth )
+	{
+		pThread->m_stack[pThread->m_depth] = marker;
+	}
+	pThread->m_depth++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// End
+
+//static
+void BtProfiler::End()
+{
+	LBtProfileThread* pThread = g_pThread;
+
+	if( ( pThread == BtNull ) || ( pThread->m_depth == 0 ) )
+	{
+		return;
+	}
+
+	pThread->m_depth--;
+
+	if( pThread->m_depth >= MaxProfileDepth )
+	{
+		return;
+	}
+
+	const LBtProfileMarker& marker = pThread->m_stack[pThread->m_depth];
+
+	if( ( marker.m_index != LBtNoEvent ) &&
+		( marker.m_capture == BtAtomicPeek( &g_capture ) ) &&
+		( BtAtomicPeek( &g_state ) == LBtCapture_Capturing ) )
+	{
+		pThread->m_pEvents[marker.m_index].m_end = BtTime::GetElapsedTimeInNanoseconds();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Counter
+
+//static
+void BtProfiler::Counter( const BtChar* name, BtS64 value )
+{
+	if( LBtIsCapturing() == BtFalse )
+	{
+		return;
+	}
+
+	LBtProfileThread* pThread = LBtGetThread();
+
+	if( pThread == &g_overflowThread )
+	{
+		return;
+	}
+
+	BtS32 numEvents = LBtPrepareEvents( pThread );
+
+	if( ( pThread->m_pEvents == BtNull ) || ( numEvents >= (BtS32)MaxProfileEvents ) )
+	{
+		BtAtomicAdd( &g_numDropped, 1 );
+		return;
+	}
+
+	BtProfileEvent& event = pThread->m_pEvents[numEvents];
+	event.m_name = name;
+	event.m_start = BtTime::GetElapsedTimeInNanoseconds();
+	event.m_end = event.m_start;
+	event.m_depth = pThread->m_depth;
+	event.m_frame = g_frame;
+	event.m_value = value;
+	event.m_isCounter = BtTrue;
+
+	BtAtomicStore( &pThread->m_numEvents, numEvents + 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BeginFrame
+
+//static
+void BtProfiler::BeginFrame()
+{
+	if( BtAtomicPeek( &g_state ) == LBtCapture_Armed )
+	{
+		// Threads empty their own buffers when they see the new capture
+		BtAtomicStore( &g_capture, g_capture + 1 );
+		g_frame = 0;
+		g_captureStart = BtTime::GetElapsedTimeInNanoseconds();
+
+		BtAtomicStore( &g_state, LBtCapture_Capturing );
+	}
+
+	Begin( "Frame" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndFrame
+
+//static
+void BtProfiler::EndFrame()
+{
+	End();
+
+	if( BtAtomicPeek( &g_state ) == LBtCapture_Capturing )
+	{
+		g_frame++;
+
+		if( g_frame >= g_numCaptureFrames )
+		{
+			BtAtomicStore( &g_state, LBtCapture_Ready );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetThreadName
+
+//static
+void BtProfiler::SetThreadName( const BtChar* name )
+{
+	LBtGetThread()->m_name = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndThread
+
+//static
+void BtProfiler::EndThread()
+{
+	LBtProfileThread* pThread = g_pThread;
+
+	if( ( pThread == BtNull ) || ( pThread == &g_overflowThread ) )
+	{
+		g_pThread = BtNull;
+		return;
+	}
+
+	// The events stay in the capture. The next thread to take the slot adds to them
+	pThread->m_name = BtNull;
+	pThread->m_depth = 0;
+	g_pThread = BtNull;
+
+	BtAtomicStore( &pThread->m_isUsed, 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Capture
+
+//static
+void BtProfiler::Capture( BtU32 numFrames )
+{
+	if( ( BtAtomicPeek( &g_state ) == LBtCapture_Capturing ) || ( numFrames == 0 ) )
+	{
+		return;
+	}
+
+	g_numCaptureFrames = numFrames;
+	BtAtomicStore( &g_numDropped, 0 );
+	BtAtomicStore( &g_state, LBtCapture_Armed );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsCapturing
+
+//static
+BtBool BtProfiler::IsCapturing()
+{
+	BtS32 state = BtAtomicPeek( &g_state );
+
+	return ( state == LBtCapture_Armed ) || ( state == LBtCapture_Capturing );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsCaptureReady
+
+//static
+BtBool BtProfiler::IsCaptureReady()
+{
+	return BtAtomicPeek( &g_state ) == LBtCapture_Ready;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumDroppedEvents
+
+//static
+BtU32 BtProfiler::GetNumDroppedEvents()
+{
+	return (BtU32)BtAtomicLoad( &g_numDropped );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtWriteString
+
+static void LBtWriteString( FILE* f, const BtChar* text )
+{
+	fputc( '"', f );
+
+	for( const BtChar* pChar = text; *pChar != 0; pChar++ )
+	{
+		BtUChar c = (BtUChar)*pChar;
+
+		if( ( c == '"' ) || ( c == '\\' ) )
+		{
+			fputc( '\\', f );
+			fputc( c, f );
+		}
+		else if( c < 0x20 )
+		{
+			fprintf( f, "\\u%04x", c );
+		}
+		else
+		{
+			fputc( c, f );
+		}
+	}
+
+	fputc( '"', f );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WriteTrace
+
+//static
+BtBool BtProfiler::WriteTrace( const BtChar* filename )
+{
+	if( IsCaptureReady() == BtFalse )
+	{
+		return BtFalse;
+	}
+
+	FILE* f = fopen( filename, "w" );
+
+	if( f == BtNull )
+	{
+		return BtFalse;
+	}
+
+	fprintf( f, "{\"traceEvents\":[\n" );
+
+	BtBool isFirst = BtTrue;
+	BtS32 numThreads = BtAtomicLoad( &g_numThreads );
+
+	for( BtS32 iThread=0; ( iThread<numThreads ) && ( iThread<(BtS32)MaxProfileThreads ); iThread++ )
+	{
+		const LBtProfileThread& thread = g_threads[iThread];
+
+		// Skip slots with nothing from this capture
+		if( BtAtomicLoad( (volatile BtS32*)&thread.m_capture ) != g_capture )
+		{
+			continue;
+		}
+
+		// Name the thread
+		if( isFirst == BtFalse )
+		{
+			fprintf( f, ",\n" );
+		}
+		isFirst = BtFalse;
+
+		fprintf( f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", iThread );
+
+		if( thread.m_name != BtNull )
+		{
+			LBtWriteString( f, thread.m_name );
+		}
+		else
+		{
+			fprintf( f, "\"Thread %d\"", iThread );
+		}
+		fprintf( f, "}}" );
+
+		// Complete events. Times are in microseconds from the start of the capture
+		BtS32 numEvents = BtAtomicLoad( (volatile BtS32*)&thread.m_numEvents );
+
+		for( BtS32 iEvent=0; iEvent<numEvents; iEvent++ )
+		{
+			const BtProfileEvent& event = thread.m_pEvents[iEvent];
+
+			// Skip markers that were still open when the capture finished
+			if( event.m_end == 0 )
+			{
+				continue;
+			}
+
+			if( event.m_isCounter == BtTrue )
+			{
+				fprintf( f, ",\n{\"name\":" );
+				LBtWriteString( f, event.m_name );
+				fprintf( f, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}",
+						 ( event.m_start - g_captureStart ) / 1000.0,
+						 iThread,
+						 (long long)event.m_value );
+				continue;
+			}
+
+			fprintf( f, ",\n{\"name\":" );
+			LBtWriteString( f, event.m_name );
+			fprintf( f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%d}}",
+					 ( event.m_start - g_captureStart ) / 1000.0,
+					 ( event.m_end - event.m_start ) / 1000.0,
+					 iThread,
+					 event.m_frame );
+		}
+	}
+
+	fprintf( f, "\n]}\n" );
+	fclose( f );
+
+	// The capture has been used up
+	BtAtomicStore( &g_state, LBtCapture_Idle );
+
+	return BtTrue;
+}
@@ -6,6 +6,27 @@
 #include "BtBase.h"
 #include "BtPrint.h"
 #include "ErrorLog.h"
+#include "BtMemory.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtCompressedFile::BtCompressedFile()
+{
+	m_file = BtNull;
+	m_pChunks = BtNull;
+	m_pCompressed = BtNull;
+	BtMemory::Set( &m_chunkHeader, 0, sizeof(BaArchiveChunkHeader) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+BtCompressedFile::~BtCompressedFile()
+{
+	BtMemory::Free( m_pChunks );
+	BtMemory::Free( m_pCompressed );
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Read
@@ -72,6 +93,219 @@ void BtCompressedFile::Read( FILE *f, BtU8* pMemory, BtU32 targetSize )
 
 	/* clean up and return */
 	(void)inflateEnd(&m_strm);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WriteChunks
 
-	fclose( m_file );
+//static
+BtU32 BtCompressedFile::WriteChunks( FILE *f, const BtU8* pSource, BtU32 dataSize )
+{
+	// Split the archive into fixed size chunks that each deflate to their own zlib stream
+	BaArchiveChunkHeader chunkHeader;
+	chunkHeader.m_magic = BaArchiveChunkMagic;
+	chunkHeader.m_nChunks = ( dataSize + BaArchiveChunkSize - 1 ) / BaArchiveChunkSize;
+	chunkHeader.m_nChunkSize = BaArchiveChunkSize;
+	chunkHeader.m_nCompressedSize = 0;
+
+	uLong maxChunkSize = compressBound( BaArchiveChunkSize );
+
+	BaArchiveChunk* pChunks = (BaArchiveChunk*)BtMemory::Allocate( BtMT_Archive, chunkHeader.m_nChunks * sizeof(BaArchiveChunk) );
+	BtU8* pCompressed = BtMemory::Allocate( BtMT_Archive, chunkHeader.m_nChunks * (BtU32)maxChunkSize );
+
+	for( BtU32 iChunk=0; iChunk<chunkHeader.m_nChunks; iChunk++ )
+	{
+		BaArchiveChunk& chunk = pChunks[iChunk];
+		chunk.m_nUncompressedOffset = iChunk * BaArchiveChunkSize;
+		chunk.m_nUncompressedSize = dataSize - chunk.m_nUncompressedOffset;
+
+		if( chunk.m_nUncompressedSize > BaArchiveChunkSize )
+		{
+			chunk.m_nUncompressedSize = BaArchiveChunkSize;
+		}
+
+		uLongf chunkSize = maxChunkSize;
+		BtS32 ret = compress2( pCompressed + chunkHeader.m_nCompressedSize, &chunkSize,
+							   pSource + chunk.m_nUncompressedOffset, chunk.m_nUncompressedSize, 1 );
+
+		if( ret != Z_OK )
+		{
+			ErrorLog::Fatal_Printf( "compress2 %d\n", ret );
+		}
+
+		chunk.m_nCompressedOffset = chunkHeader.m_nCompressedSize;
+		chunk.m_nCompressedSize = (BtU32)chunkSize;
+		chunkHeader.m_nCompressedSize += (BtU32)chunkSize;
+	}
+
+	// Write the chunk table followed by the chunks
+	fwrite( (void*)&chunkHeader, 1, sizeof(BaArchiveChunkHeader), f );
+	fwrite( (void*)pChunks, sizeof(BaArchiveChunk), chunkHeader.m_nChunks, f );
+
+	if( fwrite( pCompressed, 1, chunkHeader.m_nCompressedSize, f ) != chunkHeader.m_nCompressedSize )
+	{
+		ErrorLog::Fatal_Printf( "ferror\n" );
+	}
+
+	BtMemory::Free( pChunks );
+	BtMemory::Free( pCompressed );
+
+	return chunkHeader.m_nCompressedSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReadChunkTable
+
+BtBool BtCompressedFile::ReadChunkTable( FILE *f, BtU32 dataSize )
+{
+	m_file = f;
+
+	long position = ftell( f );
+
+	// Older archives are a single zlib stream straight after the archive header
+	if( ( fread( &m_chunkHeader, 1, sizeof(BaArchiveChunkHeader), f ) != sizeof(BaArchiveChunkHeader) ) ||
+		( m_chunkHeader.m_magic != BaArchiveChunkMagic ) )
+	{
+		BtMemory::Set( &m_chunkHeader, 0, sizeof(BaArchiveChunkHeader) );
+		fseek( f, position, SEEK_SET );
+		return BtFalse;
+	}
+
+	// The packer cuts the archive into as many chunks of the chunk size as it takes
+	if( ( m_chunkHeader.m_nChunkSize == 0 ) ||
+		( m_chunkHeader.m_nChunks != (BtU32)( ( (BtU64)dataSize + m_chunkHeader.m_nChunkSize - 1 ) / m_chunkHeader.m_nChunkSize ) ) )
+	{
+		ErrorLog::Fatal_Printf( "Corrupt archive chunk header.\n" );
+		return BtFalse;
+	}
+
+	// Read the chunk table
+	BtU32 tableSize = m_chunkHeader.m_nChunks * sizeof(BaArchiveChunk);
+	m_pChunks = (BaArchiveChunk*)BtMemory::Allocate( BtMT_Archive, tableSize );
+
+	if( fread( m_pChunks, 1, tableSize, f ) != tableSize )
+	{
+		ErrorLog::Fatal_Printf( "Truncated archive chunk table.\n" );
+	}
+
+	// Chunks are inflated in parallel straight into the archive memory so they must lie
+	// end to end within it and within the compressed data. All but the last are the chunk
+	// size, so the chunks covering any range can be found without searching the table
+	BtU32 uncompressedOffset = 0;
+
+	for( BtU32 iChunk=0; iChunk<m_chunkHeader.m_nChunks; iChunk++ )
+	{
+		const BaArchiveChunk& chunk = m_pChunks[iChunk];
+		BtBool isLast = ( iChunk == m_chunkHeader.m_nChunks - 1 ) ? BtTrue : BtFalse;
+
+		if( ( chunk.m_nUncompressedOffset != uncompressedOffset ) ||
+			( chunk.m_nUncompressedSize == 0 ) ||
+			( chunk.m_nUncompressedSize > m_chunkHeader.m_nChunkSize ) ||
+			( ( isLast == BtFalse ) && ( chunk.m_nUncompressedSize != m_chunkHeader.m_nChunkSize ) ) ||
+			( (BtU64)chunk.m_nUncompressedOffset + chunk.m_nUncompressedSize > dataSize ) ||
+			( (BtU64)chunk.m_nCompressedOffset + chunk.m_nCompressedSize > m_chunkHeader.m_nCompressedSize ) )
+		{
+			ErrorLog::Fatal_Printf( "Corrupt archive chunk %d.\n", iChunk );
+			return BtFalse;
+		}
+		uncompressedOffset += chunk.m_nUncompressedSize;
+	}
+
+	if( uncompressedOffset != dataSize )
+	{
+		ErrorLog::Fatal_Printf( "Archive chunks inflate to %d bytes not %d.\n", uncompressedOffset, dataSize );
+		return BtFalse;
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReadChunks
+
+void BtCompressedFile::ReadChunks( FILE *f )
+{
+	// Read all the compressed chunks in one go. They are inflated separately
+	m_pCompressed = BtMemory::Allocate( BtMT_Archive, m_chunkHeader.m_nCompressedSize );
+
+	if( m_pCompressed == BtNull )
+	{
+		ErrorLog::Fatal_Printf( "Can't allocate memory for compressed archive." );
+	}
+
+	if( fread( m_pCompressed, 1, m_chunkHeader.m_nCompressedSize, f ) != m_chunkHeader.m_nCompressedSize )
+	{
+		ErrorLog::Fatal_Printf( "Truncated archive chunks.\n" );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InflateChunk
+
+BtBool BtCompressedFile::InflateChunk( BtU32 iChunk, BtU8* pMemory ) const
+{
+	BtAssert( iChunk < m_chunkHeader.m_nChunks );
+
+	// The chunk table was checked against the archive size when it was read
+	const BaArchiveChunk& chunk = m_pChunks[iChunk];
+
+	// Each chunk is a complete zlib stream so this is safe to call from any thread
+	uLongf destSize = chunk.m_nUncompressedSize;
+
+	BtS32 ret = uncompress( pMemory + chunk.m_nUncompressedOffset,
+							&destSize,
+							m_pCompressed + chunk.m_nCompressedOffset,
+							chunk.m_nCompressedSize );
+
+	if( ( ret != Z_OK ) || ( destSize != chunk.m_nUncompressedSize ) )
+	{
+		ErrorLog::Printf( "inflate chunk %d %d.\n", iChunk, ret );
+		return BtFalse;
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InflateChunks
+
+void BtCompressedFile::InflateChunks( BtU8* pMemory, BtU32 iFirstChunk, BtU32 iEndChunk ) const
+{
+	for( BtU32 iChunk=iFirstChunk; iChunk<iEndChunk; iChunk++ )
+	{
+		if( InflateChunk( iChunk, pMemory ) == BtFalse )
+		{
+			ErrorLog::Fatal_Printf( "Corrupt archive chunk %d.\n", iChunk );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InflateRange
+
+void BtCompressedFile::InflateRange( BtU8* pMemory, BtU32 offset, BtU32 size ) const
+{
+	BtAssert( m_pChunks != BtNull );
+
+	if( size == 0 )
+	{
+		return;
+	}
+
+	// Every chunk but the last is the chunk size so the covering chunks follow from the offsets
+	BtU32 iFirstChunk = offset / m_chunkHeader.m_nChunkSize;
+	BtU32 iEndChunk = (BtU32)( ( (BtU64)offset + size - 1 ) / m_chunkHeader.m_nChunkSize ) + 1;
+
+	if( iEndChunk > m_chunkHeader.m_nChunks )
+	{
+		iEndChunk = m_chunkHeader.m_nChunks;
+	}
+
+	InflateChunks( pMemory, iFirstChunk, iEndChunk );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InflateResource
+
+void BtCompressedFile::InflateResource( BtU8* pMemory, const BaResourceHeader& resourceHeader ) const
+{
+	InflateRange( pMemory, resourceHeader.m_nResourceOffset, resourceHeader.m_nResourceSize );
 }
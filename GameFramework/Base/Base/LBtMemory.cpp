@@ -4,25 +4,511 @@
 #include <memory.h>
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "BtBase.h"
 #include "BtTypes.h"
 #include "BtMemory.h"
+#include "BtAtomic.h"
+#include "BtThread.h"
+#include "BtPrint.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocation header. Sits immediately before every pointer we hand out
+
+struct LBtMemoryHeader
+{
+	BtU32							m_size;
+	BtU32							m_offset;			// From the start of the block to the pointer we returned
+	BtU8							m_tag;
+	BtU8							m_pool;
+	BtU16							m_pad;
+	BtU32							m_guard;
+};
+
+const BtU32 LBtMemoryGuard = 0xB7A110C8;
+const BtU8 LBtNoPool = 0xFF;
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed size pools for small allocations. Blocks include the header. Each tag has its own
+// pools, which are its arena
+
+struct LBtPoolBlock
+{
+	LBtPoolBlock*					m_pNext;
+};
+
+struct LBtPool
+{
+	LBtPoolBlock*					m_pFree;
+	volatile BtS32					m_lock;
+};
+
+const BtU32 LBtNumPools = 4;
+const BtU32 LBtPoolBlockSize[LBtNumPools] = { 32, 64, 128, 256 };
+const BtU32 LBtPoolPageSize = 64 * 1024;
+
+// Every thread keeps its own list of each pool's blocks and only locks the pool to take
+// this many when its list runs out, or to give this many back when it holds twice as many
+const BtU32 LBtCacheBatch = 32;
+
+struct LBtThreadCache
+{
+	LBtPoolBlock*					m_pFree[BtMT_Max][LBtNumPools];
+	BtU32							m_numFree[BtMT_Max][LBtNumPools];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Every thread counts into its own slot and moves its counts to the shared totals once they
+// come to a batch, raising the peak as it does. Threads beyond the slots add to the totals.
+// Only the owner writes a slot, with relaxed atomic writes so GetStats can read it from
+// any thread without tearing
+
+struct LBtThreadStats
+{
+	volatile BtS64					m_bytes[BtMT_Max];
+	volatile BtS64					m_allocations[BtMT_Max];
+	volatile BtS64					m_totalAllocations[BtMT_Max];
+	volatile BtS32					m_isUsed;
+	BtU8							m_pad[64];				// Keep each thread's counts to its own cache lines
+};
+
+const BtU32 LBtMaxThreads = 64;
+const BtS64 LBtStatsBatchBytes = 16 * 1024;
+const BtS64 LBtStatsBatchCount = 64;
+
+static LBtPool g_pools[BtMT_Max][LBtNumPools];
+static BtMemoryStats g_stats[BtMT_Max];
+
+static LBtThreadStats g_threadStats[LBtMaxThreads];
+static volatile BtS32 g_numThreadStats = 0;				// Slots ever used
+
+static BtThreadLocal LBtThreadCache g_cache;
+static BtThreadLocal LBtThreadStats* g_pThreadStats = BtNull;
+static BtThreadLocal BtBool g_hasNoSlot = BtFalse;
+static BtThreadLocal BtBool g_isHooked = BtFalse;
+
+static const BtChar* g_tagNames[BtMT_Max] =
+{
+	"General",
+	"Archive",
+	"Render",
+	"SceneGraph",
+	"Audio",
+	"Network",
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtRaisePeak
+
+static void LBtRaisePeak( BtU32 tag, BtS64 liveBytes )
+{
+	BtMemoryStats& stats = g_stats[tag];
+
+	// Unless another thread beat us to a higher one
+	BtS64 peak = BtAtomicPeek( &stats.m_peakBytes );
+
+	while( ( liveBytes > peak ) && ( BtAtomicCompareSwap( &stats.m_peakBytes, peak, liveBytes ) == BtFalse ) )
+	{
+		peak = BtAtomicPeek( &stats.m_peakBytes );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtAddTotals
+
+static void LBtAddTotals( BtU32 tag, BtS64 bytes, BtS64 allocations, BtS64 totalAllocations )
+{
+	BtMemoryStats& stats = g_stats[tag];
+
+	BtS64 liveBytes = BtAtomicAdd( &stats.m_bytes, bytes );
+	BtAtomicAdd( &stats.m_allocations, allocations );
+	BtAtomicAdd( &stats.m_totalAllocations, totalAllocations );
+
+	LBtRaisePeak( tag, liveBytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtFlushStats
+
+static void LBtFlushStats( LBtThreadStats* pStats, BtU32 tag )
+{
+	LBtAddTotals( tag, pStats->m_bytes[tag], pStats->m_allocations[tag], pStats->m_totalAllocations[tag] );
+
+	BtAtomicPoke( &pStats->m_bytes[tag], 0 );
+	BtAtomicPoke( &pStats->m_allocations[tag], 0 );
+	BtAtomicPoke( &pStats->m_totalAllocations[tag], 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Thread exit hook. Any thread that takes blocks or a slot gives them back as it exits,
+// whether or not it is a BtThread. The main thread keeps its own until the program ends
+
+#ifdef WIN32
+
+static DWORD g_exitKey = FLS_OUT_OF_INDEXES;
+static volatile BtS32 g_exitKeyLock = 0;
+
+static void WINAPI LBtOnThreadExit( void* pValue )
+{
+	if( pValue != BtNull )
+	{
+		BtMemory::EndThread();
+	}
+}
+
+static void LBtHookThreadExit()
+{
+	if( g_isHooked == BtTrue )
+	{
+		return;
+	}
+	g_isHooked = BtTrue;
+
+	BtSpinLock( &g_exitKeyLock );
+
+	if( g_exitKey == FLS_OUT_OF_INDEXES )
+	{
+		g_exitKey = FlsAlloc( LBtOnThreadExit );
+	}
+	BtSpinUnlock( &g_exitKeyLock );
+
+	if( g_exitKey != FLS_OUT_OF_INDEXES )
+	{
+		FlsSetValue( g_exitKey, (void*)1 );
+	}
+}
+
+#else
+
+static pthread_key_t g_exitKey;
+static pthread_once_t g_exitKeyOnce = PTHREAD_ONCE_INIT;
+
+static void LBtOnThreadExit( void* )
+{
+	BtMemory::EndThread();
+}
+
+static void LBtMakeExitKey()
+{
+	pthread_key_create( &g_exitKey, LBtOnThreadExit );
+}
+
+static void LBtHookThreadExit()
+{
+	if( g_isHooked == BtTrue )
+	{
+		return;
+	}
+	g_isHooked = BtTrue;
+
+	// The destructor only runs for threads whose value isn't null
+	pthread_once( &g_exitKeyOnce, LBtMakeExitKey );
+	pthread_setspecific( g_exitKey, (void*)1 );
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtGetThreadStats
+
+static LBtThreadStats* LBtGetThreadStats()
+{
+	if( ( g_pThreadStats == BtNull ) && ( g_hasNoSlot == BtFalse ) )
+	{
+		g_hasNoSlot = BtTrue;
+
+		LBtHookThreadExit();
+
+		// Take the first free slot. Released slots have given their counts back
+		for( BtU32 iThread=0; iThread<LBtMaxThreads; iThread++ )
+		{
+			LBtThreadStats* pStats = &g_threadStats[iThread];
+
+			if( BtAtomicCompareSwap( &pStats->m_isUsed, 0, 1 ) == BtTrue )
+			{
+				g_pThreadStats = pStats;
+				g_hasNoSlot = BtFalse;
+
+				// Let readers know to sum this slot
+				BtS32 numThreads = BtAtomicLoad( &g_numThreadStats );
+
+				while( ( numThreads <= (BtS32)iThread ) &&
+					   ( BtAtomicCompareSwap( &g_numThreadStats, numThreads, iThread + 1 ) == BtFalse ) )
+				{
+					numThreads = BtAtomicLoad( &g_numThreadStats );
+				}
+				break;
+			}
+		}
+	}
+	return g_pThreadStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtAddStats
+
+static void LBtAddStats( BtU32 tag, BtS64 bytes, BtS64 allocations )
+{
+	BtS64 totalAllocations = ( allocations > 0 ) ? allocations : 0;
+
+	LBtThreadStats* pStats = LBtGetThreadStats();
+
+	if( pStats == BtNull )
+	{
+		LBtAddTotals( tag, bytes, allocations, totalAllocations );
+		return;
+	}
+
+	// Plain reads are safe as no other thread writes the slot
+	BtS64 slotBytes = pStats->m_bytes[tag] + bytes;
+	BtS64 slotTotalAllocations = pStats->m_totalAllocations[tag] + totalAllocations;
+
+	BtAtomicPoke( &pStats->m_bytes[tag], slotBytes );
+	BtAtomicPoke( &pStats->m_allocations[tag], pStats->m_allocations[tag] + allocations );
+	BtAtomicPoke( &pStats->m_totalAllocations[tag], slotTotalAllocations );
+
+	if( ( slotTotalAllocations >= LBtStatsBatchCount ) ||
+		( slotBytes >= LBtStatsBatchBytes ) ||
+		( slotBytes <= -LBtStatsBatchBytes ) )
+	{
+		LBtFlushStats( pStats, tag );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtTakeBlocks
+
+// Moves up to a batch of blocks from the pool to the thread's list
+static BtBool LBtTakeBlocks( BtU32 tag, BtU32 iPool )
+{
+	LBtPool& pool = g_pools[tag][iPool];
+
+	BtSpinLock( &pool.m_lock );
+
+	if( pool.m_pFree == BtNull )
+	{
+		// Carve a new page into blocks. Pages are kept for the life of the program
+		BtU8* pRaw = (BtU8*)malloc( LBtPoolPageSize + BtMemoryDefaultAlignment );
+
+		if( pRaw == BtNull )
+		{
+			BtSpinUnlock( &pool.m_lock );
+			return BtFalse;
+		}
+
+		BtAtomicAdd( &g_stats[tag].m_poolBytes, (BtS64)LBtPoolPageSize );
+
+		BtU8* pPage = (BtU8*)( ( (size_t)pRaw + BtMemoryDefaultAlignment - 1 ) & ~(size_t)( BtMemoryDefaultAlignment - 1 ) );
+		BtU32 blockSize = LBtPoolBlockSize[iPool];
+
+		// Lowest address first
+		for( BtU32 offset = LBtPoolPageSize - ( LBtPoolPageSize % blockSize ); offset >= blockSize; offset -= blockSize )
+		{
+			LBtPoolBlock* pBlock = (LBtPoolBlock*)( pPage + offset - blockSize );
+			pBlock->m_pNext = pool.m_pFree;
+			pool.m_pFree = pBlock;
+		}
+	}
+
+	LBtPoolBlock* pFirst = pool.m_pFree;
+	LBtPoolBlock* pLast = pFirst;
+	BtU32 numBlocks = 1;
+
+	while( ( numBlocks < LBtCacheBatch ) && ( pLast->m_pNext != BtNull ) )
+	{
+		pLast = pLast->m_pNext;
+		++numBlocks;
+	}
+
+	pool.m_pFree = pLast->m_pNext;
+
+	BtSpinUnlock( &pool.m_lock );
+
+	LBtHookThreadExit();
+
+	pLast->m_pNext = g_cache.m_pFree[tag][iPool];
+	g_cache.m_pFree[tag][iPool] = pFirst;
+	g_cache.m_numFree[tag][iPool] += numBlocks;
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtGiveBlocks
+
+// Moves up to numBlocks blocks from the thread's list back to the pool
+static void LBtGiveBlocks( BtU32 tag, BtU32 iPool, BtU32 numBlocks )
+{
+	LBtPoolBlock* pFirst = g_cache.m_pFree[tag][iPool];
+
+	if( ( pFirst == BtNull ) || ( numBlocks == 0 ) )
+	{
+		return;
+	}
+
+	LBtPoolBlock* pLast = pFirst;
+	BtU32 numGiven = 1;
+
+	while( ( numGiven < numBlocks ) && ( pLast->m_pNext != BtNull ) )
+	{
+		pLast = pLast->m_pNext;
+		++numGiven;
+	}
+
+	g_cache.m_pFree[tag][iPool] = pLast->m_pNext;
+	g_cache.m_numFree[tag][iPool] -= numGiven;
+
+	LBtPool& pool = g_pools[tag][iPool];
+
+	BtSpinLock( &pool.m_lock );
+
+	pLast->m_pNext = pool.m_pFree;
+	pool.m_pFree = pFirst;
+
+	BtSpinUnlock( &pool.m_lock );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtAllocateBlock
+
+static BtU8* LBtAllocateBlock( BtU32 tag, BtU32 iPool )
+{
+	if( ( g_cache.m_pFree[tag][iPool] == BtNull ) && ( LBtTakeBlocks( tag, iPool ) == BtFalse ) )
+	{
+		return BtNull;
+	}
+
+	LBtPoolBlock* pBlock = g_cache.m_pFree[tag][iPool];
+	g_cache.m_pFree[tag][iPool] = pBlock->m_pNext;
+	--g_cache.m_numFree[tag][iPool];
+
+	return (BtU8*)pBlock;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtFreeBlock
+
+// The block joins the freeing thread's list, whichever thread allocated it
+static void LBtFreeBlock( BtU32 tag, BtU32 iPool, BtU8* pMemory )
+{
+	LBtPoolBlock* pBlock = (LBtPoolBlock*)pMemory;
+	pBlock->m_pNext = g_cache.m_pFree[tag][iPool];
+	g_cache.m_pFree[tag][iPool] = pBlock;
+
+	if( ++g_cache.m_numFree[tag][iPool] >= LBtCacheBatch * 2 )
+	{
+		LBtGiveBlocks( tag, iPool, LBtCacheBatch );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate
 
 BtU8* BtMemory::Allocate( BtU32 nSizeInBytes )
 {
-	//printf( "Memory %d\n", nSizeInBytes );
-	
-	return (BtU8*) malloc( nSizeInBytes );
+	return Allocate( BtMT_General, nSizeInBytes, BtMemoryDefaultAlignment );
 }
 
 BtU8* BtMemory::Allocate( BtU32 nSizeInBytes, BtU32 nAlignment )
 {
-	(void)nAlignment;
-	return (BtU8*) Allocate( nSizeInBytes );
+	return Allocate( BtMT_General, nSizeInBytes, nAlignment );
+}
+
+BtU8* BtMemory::Allocate( BtMemoryTag tag, BtU32 nSizeInBytes, BtU32 nAlignment )
+{
+	BtAssert( tag < BtMT_Max );
+
+	if( nAlignment < BtMemoryDefaultAlignment )
+	{
+		nAlignment = BtMemoryDefaultAlignment;
+	}
+
+	// Alignments must be a power of two
+	BtAssert( ( nAlignment & ( nAlignment - 1 ) ) == 0 );
+
+	BtU8* pMemory;
+	BtU32 offset;
+	BtU8 iPool = LBtNoPool;
+	BtU32 headerSize = sizeof(LBtMemoryHeader);
+
+	if( ( nSizeInBytes <= BtMemoryMaxPooledSize ) && ( nAlignment == BtMemoryDefaultAlignment ) )
+	{
+		// Find the smallest pool that fits
+		iPool = 0;
+
+		while( nSizeInBytes + headerSize > LBtPoolBlockSize[iPool] )
+		{
+			iPool++;
+		}
+
+		BtU8* pBlock = LBtAllocateBlock( tag, iPool );
+
+		if( pBlock == BtNull )
+		{
+			return BtNull;
+		}
+		pMemory = pBlock + headerSize;
+		offset = headerSize;
+	}
+	else
+	{
+		BtU8* pRaw = (BtU8*)malloc( nSizeInBytes + nAlignment + headerSize );
+
+		if( pRaw == BtNull )
+		{
+			return BtNull;
+		}
+		pMemory = (BtU8*)( ( (size_t)pRaw + headerSize + nAlignment - 1 ) & ~(size_t)( nAlignment - 1 ) );
+		offset = (BtU32)( pMemory - pRaw );
+	}
+
+	LBtMemoryHeader* pHeader = (LBtMemoryHeader*)( pMemory - headerSize );
+	pHeader->m_size = nSizeInBytes;
+	pHeader->m_offset = offset;
+	pHeader->m_tag = (BtU8)tag;
+	pHeader->m_pool = iPool;
+	pHeader->m_guard = LBtMemoryGuard;
+	pHeader->m_pad = 0;
+
+	LBtAddStats( tag, nSizeInBytes, 1 );
+
+	return pMemory;
 }
 
 void BtMemory::Free( void *pMemory )
 {
-	free( pMemory );
+	if( pMemory == BtNull )
+	{
+		return;
+	}
+
+	LBtMemoryHeader* pHeader = (LBtMemoryHeader*)( (BtU8*)pMemory - sizeof(LBtMemoryHeader) );
+
+	// Catch frees of memory we didn't allocate and double frees
+	BtAssert( pHeader->m_guard == LBtMemoryGuard );
+	pHeader->m_guard = 0;
+
+	LBtAddStats( pHeader->m_tag, -(BtS64)pHeader->m_size, -1 );
+
+	BtU8* pBlock = (BtU8*)pMemory - pHeader->m_offset;
+
+	if( pHeader->m_pool == LBtNoPool )
+	{
+		free( pBlock );
+	}
+	else
+	{
+		LBtFreeBlock( pHeader->m_tag, pHeader->m_pool, pBlock );
+	}
+}
+
+void BtMemory::FreeAligned( void *pMemory )
+{
+	Free( pMemory );
 }
 
 void BtMemory::Copy( void* pDest, const void *pSource, BtU32 nSize )
@@ -55,3 +541,96 @@ BtBool BtMemory::Compare( const void* pDest, const void *pSource, BtU32 nSize )
 		return BtFalse;
 	}
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// GetStats
+
+BtMemoryStats BtMemory::GetStats( BtMemoryTag tag )
+{
+	BtMemoryStats& totals = g_stats[tag];
+
+	BtMemoryStats stats;
+	stats.m_bytes = BtAtomicPeek( &totals.m_bytes );
+	stats.m_allocations = BtAtomicPeek( &totals.m_allocations );
+	stats.m_totalAllocations = BtAtomicPeek( &totals.m_totalAllocations );
+	stats.m_poolBytes = BtAtomicPeek( &totals.m_poolBytes );
+
+	// With what each thread hasn't moved to the totals yet
+	BtS32 numThreads = BtAtomicLoad( &g_numThreadStats );
+
+	for( BtS32 iThread=0; iThread<numThreads; iThread++ )
+	{
+		LBtThreadStats& threadStats = g_threadStats[iThread];
+
+		stats.m_bytes += BtAtomicPeek( &threadStats.m_bytes[tag] );
+		stats.m_allocations += BtAtomicPeek( &threadStats.m_allocations[tag] );
+		stats.m_totalAllocations += BtAtomicPeek( &threadStats.m_totalAllocations[tag] );
+	}
+
+	LBtRaisePeak( tag, stats.m_bytes );
+	stats.m_peakBytes = BtAtomicPeek( &totals.m_peakBytes );
+
+	return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetTagName
+
+const BtChar* BtMemory::GetTagName( BtMemoryTag tag )
+{
+	return g_tagNames[tag];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReportLeaks
+
+BtU32 BtMemory::ReportLeaks()
+{
+	BtU32 numLeaks = 0;
+
+	for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+	{
+		BtMemoryStats stats = GetStats( (BtMemoryTag)tag );
+
+		if( stats.m_allocations )
+		{
+			BtPrint( "Memory %s: %lld allocations of %lld bytes still live. Peak %lld bytes.\n",
+					 g_tagNames[tag],
+					 (long long)stats.m_allocations,
+					 (long long)stats.m_bytes,
+					 (long long)stats.m_peakBytes );
+
+			numLeaks += (BtU32)stats.m_allocations;
+		}
+	}
+	return numLeaks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndThread
+
+void BtMemory::EndThread()
+{
+	for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+	{
+		for( BtU32 iPool=0; iPool<LBtNumPools; iPool++ )
+		{
+			LBtGiveBlocks( tag, iPool, g_cache.m_numFree[tag][iPool] );
+		}
+	}
+
+	if( g_pThreadStats != BtNull )
+	{
+		for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+		{
+			LBtFlushStats( g_pThreadStats, tag );
+		}
+
+		BtAtomicStore( &g_pThreadStats->m_isUsed, 0 );
+		g_pThreadStats = BtNull;
+	}
+	g_hasNoSlot = BtFalse;
+
+	// A thread that allocates again after this, e.g. in a later destructor, hooks again
+	g_isHooked = BtFalse;
+}
@@ -77,20 +77,17 @@ BtBool BtStrCompare( const BtChar* pString1, const BtChar* pString2, BtU32 lengt
 ////////////////////////////////////////////////////////////////////////////////
 // LBtStrCompareNoCase
 
+// Titles of any length match when they are the same apart from case
 BtBool BtStrCompareNoCase( const BtChar* pString1, const BtChar* pString2 )
 {
-	BtChar string1[256];
-	BtChar string2[256];
-	
-	BtStrCopy( string1, 256, pString1 );
-	BtStrCopy( string2, 256, pString2 );
-
-	BtStrLower( string1, 256 );
-	BtStrLower( string2, 256 );
-
-	if( BtStrCompare( string1, string2 ) == BtTrue )
+	while( tolower( (BtUChar)*pString1 ) == tolower( (BtUChar)*pString2 ) )
 	{
-		return BtTrue;
+		if( *pString1 == 0 )
+		{
+			return BtTrue;
+		}
+		++pString1;
+		++pString2;
 	}
 	return BtFalse;
 }
@@ -13,6 +13,8 @@
 #include "BaResource.h"
 #include "BtMemory.h"
 #include "BtCompressedFile.h"
+#include "BtJobSystem.h"
+#include "BtProfiler.h"
 #include "ApConfig.h"
 #include "DyCollisionMesh.h"
 #include "DyCollisionAnalytical.h"
@@ -20,18 +22,35 @@
 #include "BtCRC.h"
 #include "BtString.h"
 #include <stdio.h>
+#include <ctype.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 // Statics
 
 BtLinkedList<BaArchiveNode> BaArchive::m_archives;
 
+const BtU32 BaEmptyIndexEntry = 0xFFFFFFFF;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
 BaArchive::BaArchive()
 {
 	m_isLoaded = BtFalse;
+	m_pArchiveMemory = BtNull;
+	m_pInstanceMemory = BtNull;
+	m_pMappedMemory = BtNull;
+	m_mappedSize = 0;
+	m_pTitleIndex = BtNull;
+	m_pIDIndex = BtNull;
+	m_indexMask = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -40,7 +59,7 @@ BaArchive::BaArchive()
 void BaArchive::AddDuplicate( BaResource* pResource )
 {
 	// Create the duplicate
-	BaDuplicate* pDuplicate = new BaDuplicate( pResource );
+	BaDuplicate* pDuplicate = new( BtMemory::Allocate( BtMT_Archive, sizeof(BaDuplicate) ) ) BaDuplicate( pResource );
 
 	// Set the archive
 	pResource->m_pArchive = this;
@@ -49,11 +68,60 @@ void BaArchive::AddDuplicate( BaResource* pResource )
 	m_duplicates.AddHead( pDuplicate );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// FreeDuplicates
+
+void BaArchive::FreeDuplicates()
+{
+	// Destroy them all before freeing any, as a node's hierarchy still refers to the nodes below it
+	for( BaDuplicate* pDuplicate = m_duplicates.pHead(); pDuplicate != BtNull; pDuplicate = pDuplicate->pNext() )
+	{
+		BaResource* pResource = pDuplicate->m_pResource;
+
+		pResource->Remove();
+		pResource->RemoveFromDevice();
+		pResource->Destroy();
+	}
+
+	BaDuplicate* pDuplicate = m_duplicates.pHead();
+
+	while( pDuplicate != BtNull )
+	{
+		BaDuplicate* pNext = pDuplicate->pNext();
+
+		// Each duplicate's instance starts the block it was allocated in
+		BtMemory::Free( pDuplicate->m_pResource );
+
+		m_duplicates.Remove( pDuplicate );
+		BtMemory::Free( pDuplicate );
+
+		pDuplicate = pNext;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBaInflateChunks
+
+struct LBaInflateContext
+{
+	const BtCompressedFile*		m_pCompressedFile;
+	BtU8*						m_pMemory;
+};
+
+static void LBaInflateChunks( void* pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LBaInflateContext* pInflate = (LBaInflateContext*)pContext;
+
+	pInflate->m_pCompressedFile->InflateChunks( pInflate->m_pMemory, iStart, iEnd );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // LoadFile
 
 void BaArchive::LoadFile( const BtChar* archiveName )
 {
+	BtProfile( "BaArchive::LoadFile" );
+
 	BtBool isInitialised = ApConfig::IsInitialised();
 	if (isInitialised == BtFalse)
 	{
@@ -62,6 +130,12 @@ void BaArchive::LoadFile( const BtChar* archiveName )
 
 	BtStrCopy(m_filename, archiveName);
 
+	// Prefer the uncompressed variant which we can fix up in place
+	if( LoadMappedFile( archiveName ) == BtTrue )
+	{
+		return;
+	}
+
 	// Load the file
 	BtChar filename[256];
 	BtStrCopy(filename, 256, ApConfig::GetResourcePath());
@@ -86,7 +160,7 @@ void BaArchive::LoadFile( const BtChar* archiveName )
 		BtAssert(checksum == m_header.m_nHeaderCheckSum);
 
 		// Make the memory
-		m_pArchiveMemory = (BtU8*)BtMemory::Allocate(m_header.m_nDataSize);
+		m_pArchiveMemory = (BtU8*)BtMemory::Allocate(BtMT_Archive, m_header.m_nDataSize);
 
 		BtU32 kBytes = m_header.m_nDataSize / 1024;
 		BtU32 mBytes = kBytes / 1024;
@@ -101,7 +175,21 @@ void BaArchive::LoadFile( const BtChar* archiveName )
 
 		// Load the compressed file
 		BtCompressedFile compressedFile;
-		compressedFile.Read(f, m_pArchiveMemory, m_header.m_nDataSize );
+
+		if( compressedFile.ReadChunkTable( f, m_header.m_nDataSize ) == BtTrue )
+		{
+			compressedFile.ReadChunks( f );
+
+			// Chunks are independent zlib streams so inflate them across the job workers
+			LBaInflateContext context;
+			context.m_pCompressedFile = &compressedFile;
+			context.m_pMemory = m_pArchiveMemory;
+			BtJobSystem::ParallelFor( compressedFile.GetNumChunks(), 1, LBaInflateChunks, &context );
+		}
+		else
+		{
+			compressedFile.Read(f, m_pArchiveMemory, m_header.m_nDataSize );
+		}
 
 		fclose(f);
 		m_isLoaded = BtTrue;
@@ -118,6 +206,249 @@ void BaArchive::LoadFile( const BtChar* archiveName )
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// LoadMappedFile
+
+BtBool BaArchive::LoadMappedFile( const BtChar* archiveName )
+{
+#ifdef WIN32
+	(void)archiveName;
+	return BtFalse;
+#else
+	BtChar filename[256];
+	BtStrCopy(filename, 256, ApConfig::GetResourcePath());
+	BtStrCat(filename, 256, archiveName);
+	BtStrCat(filename, 256, ApConfig::GetExtension());
+
+	// The mapped variant swaps the trailing z of the compressed extension for an m
+	BtU32 length = BtStrLength( filename );
+
+	if( ( length == 0 ) || ( tolower( filename[length - 1] ) != 'z' ) )
+	{
+		return BtFalse;
+	}
+
+	BtChar sourceFilename[256];
+	BtStrCopy( sourceFilename, 256, filename );
+	filename[length - 1] = 'm';
+
+	int fd = open( filename, O_RDONLY );
+
+	if( fd < 0 )
+	{
+		return BtFalse;
+	}
+
+	struct stat fileStat;
+
+	if( ( fstat( fd, &fileStat ) != 0 ) || ( fileStat.st_size < (off_t)BaMappedArchiveAlignment ) )
+	{
+		close( fd );
+		return BtFalse;
+	}
+
+	// Map privately so fixing up pointers only copies the pages we write to
+	void* pMapping = mmap( BtNull, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if( pMapping == MAP_FAILED )
+	{
+		return BtFalse;
+	}
+
+	// Check the archive header
+	BaArchiveHeader* pHeader = (BaArchiveHeader*)pMapping;
+
+	BtU32 checksum = BtCRC::GenerateHashCode((BtU8*)pHeader, sizeof(BaArchiveHeader) - sizeof(BtU32));
+
+	if( ( checksum != pHeader->m_nHeaderCheckSum ) ||
+		( (BtU64)BaMappedArchiveAlignment + pHeader->m_nDataSize > (BtU64)fileStat.st_size ) )
+	{
+		ErrorLog::Printf( "Ignoring invalid mapped archive %s\n", filename );
+		munmap( pMapping, (size_t)fileStat.st_size );
+		return BtFalse;
+	}
+
+	// Check the mapping has this layout and was written alongside the compressed archive.
+	// Only the mapping might ship, but when the compressed archive is there it must match
+	BaMappedArchiveHeader* pMappedHeader = (BaMappedArchiveHeader*)( pHeader + 1 );
+
+	BtBool isCurrent = ( pMappedHeader->m_magic == BaMappedArchiveMagic ) &&
+					   ( pMappedHeader->m_nVersion == BaMappedArchiveVersion );
+
+	FILE* f = fopen( sourceFilename, "rb" );
+
+	if( ( isCurrent == BtTrue ) && ( f != BtNull ) )
+	{
+		BaArchiveHeader sourceHeader;
+		BtBool isRead = fread( (void*)&sourceHeader, 1, sizeof(BaArchiveHeader), f ) == sizeof(BaArchiveHeader);
+
+		fseek( f, 0, SEEK_END );
+		long sourceSize = ftell( f );
+
+		if( ( isRead == BtFalse ) ||
+			( sourceSize != (long)pMappedHeader->m_nSourceSize ) ||
+			( BtMemory::Compare( &sourceHeader, pHeader, sizeof(BaArchiveHeader) ) == BtFalse ) )
+		{
+			isCurrent = BtFalse;
+		}
+	}
+
+	if( f != BtNull )
+	{
+		fclose( f );
+	}
+
+	if( isCurrent == BtFalse )
+	{
+		ErrorLog::Printf( "Ignoring stale mapped archive %s\n", filename );
+		munmap( pMapping, (size_t)fileStat.st_size );
+		return BtFalse;
+	}
+
+	m_header = *pHeader;
+	m_pMappedMemory = pMapping;
+	m_mappedSize = (BtU64)fileStat.st_size;
+	m_pArchiveMemory = (BtU8*)pMapping + BaMappedArchiveAlignment;
+	m_isLoaded = BtTrue;
+
+	return BtTrue;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeArchiveMemory
+
+void BaArchive::FreeArchiveMemory()
+{
+#ifndef WIN32
+	if( m_pMappedMemory != BtNull )
+	{
+		munmap( m_pMappedMemory, (size_t)m_mappedSize );
+
+		m_pMappedMemory = BtNull;
+		m_mappedSize = 0;
+		m_pArchiveMemory = BtNull;
+		return;
+	}
+#endif
+	BtMemory::Free( m_pArchiveMemory );
+	m_pArchiveMemory = BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetTitleHash
+
+BtU32 BaArchive::GetTitleHash( BaResourceType eType, const BtChar* szTitle )
+{
+	// FNV-1a over the whole lower case title. BtStrCompareNoCase reads it all too, so only
+	// titles that are the same apart from case match, however long they are
+	BtU32 hash = 2166136261u ^ (BtU32)eType;
+
+	while( *szTitle )
+	{
+		hash ^= (BtU32)tolower( (BtUChar)*szTitle );
+		hash *= 16777619u;
+		szTitle++;
+	}
+	return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BuildResourceIndex
+
+void BaArchive::BuildResourceIndex()
+{
+	// Keep the tables at most half full so a probe always reaches an empty slot
+	BtU32 indexSize = BtNearestPowerOf2( m_header.m_nNumResources * 2 );
+	m_indexMask = indexSize - 1;
+
+	m_pTitleIndex = (BaResourceIndexEntry*)BtMemory::Allocate( BtMT_Archive, indexSize * sizeof(BaResourceIndexEntry) );
+	m_pIDIndex = (BaResourceIndexEntry*)BtMemory::Allocate( BtMT_Archive, indexSize * sizeof(BaResourceIndexEntry) );
+
+	if( ( m_pTitleIndex == BtNull ) || ( m_pIDIndex == BtNull ) )
+	{
+		ErrorLog::Fatal_Printf( "Can't allocate memory for archive index." );
+	}
+
+	// Mark every slot as empty
+	BtMemory::Set( m_pTitleIndex, 0xFF, indexSize * sizeof(BaResourceIndexEntry) );
+	BtMemory::Set( m_pIDIndex, 0xFF, indexSize * sizeof(BaResourceIndexEntry) );
+
+	// Cache the resource headers
+	BaResourceHeader* pResourceHeaders = (BaResourceHeader*)( m_pArchiveMemory );
+
+	for( BtU32 nResourceIndex=0; nResourceIndex<m_header.m_nNumResources; nResourceIndex++ )
+	{
+		BaResourceHeader* pResourceHeader = pResourceHeaders + nResourceIndex;
+
+		// Index by type and title. The first of any duplicate titles wins as it did with the linear search
+		BtU32 hash = GetTitleHash( pResourceHeader->m_type, pResourceHeader->m_szTitle );
+		BtU32 slot = hash & m_indexMask;
+		BtBool isDuplicate = BtFalse;
+
+		while( m_pTitleIndex[slot].m_nResourceIndex != BaEmptyIndexEntry )
+		{
+			BaResourceIndexEntry& entry = m_pTitleIndex[slot];
+			BaResourceHeader* pExisting = pResourceHeaders + entry.m_nResourceIndex;
+
+			if( ( entry.m_hash == hash ) &&
+				( pExisting->m_type == pResourceHeader->m_type ) &&
+				( BtStrCompareNoCase( pExisting->m_szTitle, pResourceHeader->m_szTitle ) == BtTrue ) )
+			{
+				isDuplicate = BtTrue;
+				break;
+			}
+			slot = ( slot + 1 ) & m_indexMask;
+		}
+
+		if( isDuplicate == BtFalse )
+		{
+			m_pTitleIndex[slot].m_hash = hash;
+			m_pTitleIndex[slot].m_nResourceIndex = nResourceIndex;
+		}
+
+		// Index by resource ID. Zero is never looked up
+		BtU32 nResourceID = pResourceHeader->m_nResourceID;
+
+		if( nResourceID != 0 )
+		{
+			hash = nResourceID * 2654435761u;
+			slot = hash & m_indexMask;
+			isDuplicate = BtFalse;
+
+			while( m_pIDIndex[slot].m_nResourceIndex != BaEmptyIndexEntry )
+			{
+				if( m_pIDIndex[slot].m_hash == nResourceID )
+				{
+					isDuplicate = BtTrue;
+					break;
+				}
+				slot = ( slot + 1 ) & m_indexMask;
+			}
+
+			if( isDuplicate == BtFalse )
+			{
+				m_pIDIndex[slot].m_hash = nResourceID;
+				m_pIDIndex[slot].m_nResourceIndex = nResourceIndex;
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeResourceIndex
+
+void BaArchive::FreeResourceIndex()
+{
+	BtMemory::Free( m_pTitleIndex );
+	BtMemory::Free( m_pIDIndex );
+
+	m_pTitleIndex = BtNull;
+	m_pIDIndex = BtNull;
+	m_indexMask = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // IsLoaded
 
@@ -151,7 +482,7 @@ void BaArchive::GetInstanceSizes()
 		pResourceHeader++;
 	}
 
-	m_pInstanceMemory = (BtU8*)BtMemory::Allocate(totalInstanceSize);
+	m_pInstanceMemory = (BtU8*)BtMemory::Allocate(BtMT_Archive, totalInstanceSize);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -190,15 +521,35 @@ void BaArchive::CreateResources()
 
 void BaArchive::Load( const BtChar* archiveName )
 {
+	BtProfile( "BaArchive::Load" );
+
 	if( m_isLoaded )
 	{
 		Unload();
 	}
 
+	ReadArchive( archiveName );
+	FixPointers( 0, m_header.m_nNumResources );
+	FinishLoad();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReadArchive
+
+void BaArchive::ReadArchive( const BtChar* archiveName )
+{
+	// These steps don't touch the device so they are safe on a loading thread
     LoadFile( archiveName );
+	BuildResourceIndex();
 	GetInstanceSizes();
 	CreateResources();
-	FixPointers();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FinishLoad
+
+void BaArchive::FinishLoad()
+{
 	ValidateResources();
 
 	// Add this to our list of archives
@@ -209,13 +560,13 @@ void BaArchive::Load( const BtChar* archiveName )
 ////////////////////////////////////////////////////////////////////////////////
 // FixPointers
 
-void BaArchive::FixPointers()
+void BaArchive::FixPointers( BtU32 iStartResource, BtU32 iEndResource )
 {
 	// Cache each resource header
-	BaResourceHeader* pResourceHeader = (BaResourceHeader*)( m_pArchiveMemory );
+	BaResourceHeader* pResourceHeader = (BaResourceHeader*)( m_pArchiveMemory ) + iStartResource;
 
 	// Loop through the resources
-	for( BtU32 nResourceIndex=0; nResourceIndex<m_header.m_nNumResources; nResourceIndex++ )
+	for( BtU32 nResourceIndex=iStartResource; nResourceIndex<iEndResource; nResourceIndex++ )
 	{		
 		// Cache each resource
 		BaResource* pResource = pResourceHeader->m_pResource;
@@ -334,6 +685,9 @@ void BaArchive::Unload()
 {
 	if( m_isLoaded )
 	{
+		// Duplicates may point into our resources so go first
+		FreeDuplicates();
+
 		// Cache each resource header
 		BaResourceHeader* pResourceHeader = (BaResourceHeader*)( m_pArchiveMemory );
 
@@ -359,12 +713,15 @@ void BaArchive::Unload()
 			pResourceHeader++;		
 		}
 
-		// Free the memory
-		BtMemory::Free( m_pArchiveMemory );
+		// Free or unmap the archive memory
+		FreeArchiveMemory();
 
 		// Free the instance memory
 		BtMemory::Free( m_pInstanceMemory );
 
+		// Free the lookup tables
+		FreeResourceIndex();
+
 		// Remove this from the list
 		m_archives.Remove( &m_archiveNode );
 
@@ -383,26 +740,38 @@ BaResource* BaArchive::GetResource( BaResourceType eType, const BtChar* szTitle
         ErrorLog::Fatal_Printf( "Archive not loaded." );
     }
 
+	// Nothing to find without an index
+	if( m_pTitleIndex == BtNull )
+	{
+		return BtNull;
+	}
+
 	// Get the first resource header
-	BaResourceHeader* pResourceHeader = (BaResourceHeader*)m_pArchiveMemory;
+	BaResourceHeader* pResourceHeaders = (BaResourceHeader*)m_pArchiveMemory;
 
-	// Loop through the resources
-	for( BtU32 nResourceIndex=0; nResourceIndex<m_header.m_nNumResources; nResourceIndex++ )
+	BtU32 hash = GetTitleHash( eType, szTitle );
+
+	// Probe until we find the title or an empty slot
+	for( BtU32 slot = hash & m_indexMask;
+		 m_pTitleIndex[slot].m_nResourceIndex != BaEmptyIndexEntry;
+		 slot = ( slot + 1 ) & m_indexMask )
 	{
-		// Is this the string resource?
-		if( pResourceHeader->m_type == eType )
+		const BaResourceIndexEntry& entry = m_pTitleIndex[slot];
+
+		if( entry.m_hash == hash )
 		{
-			if( BtStrCompareNoCase( pResourceHeader->m_szTitle, szTitle ) == BtTrue )
+			BaResourceHeader* pResourceHeader = pResourceHeaders + entry.m_nResourceIndex;
+
+			// Check the title in case of a hash collision
+			if( ( pResourceHeader->m_type == eType ) &&
+				( BtStrCompareNoCase( pResourceHeader->m_szTitle, szTitle ) == BtTrue ) )
 			{
 				return pResourceHeader->m_pResource;
 			}
 		}
-
-		// Get the next resource header
-		pResourceHeader++;
 	}
 
-	// Return BtNull though we will never reach here
+	// Return BtNull if the resource is not in this archive
 	return BtNull;
 }
 
@@ -412,28 +781,26 @@ BaResource* BaArchive::GetResource( BaResourceType eType, const BtChar* szTitle
 BaResource* BaArchive::GetResource( BtU32 nResourceID ) const
 {
 	// Don't search for a null resource
-	if( nResourceID == 0  )
+	if( ( nResourceID == 0 ) || ( m_pIDIndex == BtNull ) )
 	{
 		return BtNull;
 	}
 
 	// Get the first resource header
-	BaResourceHeader* pResourceHeader = (BaResourceHeader*)m_pArchiveMemory;
+	BaResourceHeader* pResourceHeaders = (BaResourceHeader*)m_pArchiveMemory;
 
-	// Loop through the resources
-	for( BtU32 nResourceIndex=0; nResourceIndex<m_header.m_nNumResources; nResourceIndex++ )
+	// Probe until we find the ID or an empty slot
+	for( BtU32 slot = ( nResourceID * 2654435761u ) & m_indexMask;
+		 m_pIDIndex[slot].m_nResourceIndex != BaEmptyIndexEntry;
+		 slot = ( slot + 1 ) & m_indexMask )
 	{
-		// Is this the string resource?
-		if( pResourceHeader->m_nResourceID == nResourceID )
+		if( m_pIDIndex[slot].m_hash == nResourceID )
 		{
-			return pResourceHeader->m_pResource;
+			return pResourceHeaders[ m_pIDIndex[slot].m_nResourceIndex ].m_pResource;
 		}
-
-		// Get the next resource header
-		pResourceHeader++;
 	}
 
-	// Return BtNull though we will never reach here
+	// Return BtNull if the resource is not in this archive
 	return BtNull;
 }
 
@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveLoader.cpp
+
+// Includes
+#include "BaArchiveLoader.h"
+#include "BaArchive.h"
+#include "BtBase.h"
+#include "BtString.h"
+#include "BtThread.h"
+#include "BtProfiler.h"
+#include "ErrorLog.h"
+#include "MtMath.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveLoaderThread
+
+class BaArchiveLoaderThread : public BtThread
+{
+public:
+
+	void							Create() { BtProfiler::SetThreadName( "BaArchiveLoader" ); }
+	void							Destroy() {}
+	void							Update();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Statics
+
+static BaArchiveLoaderThread g_loaderThread;
+
+BaLoadRequest BaArchiveLoader::m_requests[MaxArchiveLoads];
+BaLoadHandle BaArchiveLoader::m_nextHandle = 1;
+BtU32 BaArchiveLoader::m_resourcesPerUpdate = 32;
+BtBool BaArchiveLoader::m_isCreated = BtFalse;
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+
+void BaArchiveLoaderThread::Update()
+{
+	BaLoadRequest* pRequest = BaArchiveLoader::GetNextRequest();
+
+	if( pRequest == BtNull )
+	{
+		SleepThread( 1 );
+		return;
+	}
+
+	BaArchiveLoader::ReadRequest( pRequest );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReadRequest
+
+//static
+void BaArchiveLoader::ReadRequest( BaLoadRequest* pRequest )
+{
+	// Read, inflate and construct the resources off the game thread
+	pRequest->SetState( BaLS_Reading );
+	pRequest->m_pArchive->ReadArchive( pRequest->m_archiveName );
+	pRequest->m_nextResource = 0;
+	pRequest->SetState( BaLS_Read );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNextRequest
+
+//static
+BaLoadRequest* BaArchiveLoader::GetNextRequest()
+{
+	BaLoadRequest* pBest = BtNull;
+
+	// Take the highest priority. Ties go to the oldest request
+	for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+	{
+		BaLoadRequest* pRequest = &m_requests[i];
+
+		if( pRequest->GetState() != BaLS_Queued )
+		{
+			continue;
+		}
+
+		if( ( pBest == BtNull ) ||
+			( pRequest->m_priority > pBest->m_priority ) ||
+			( ( pRequest->m_priority == pBest->m_priority ) && ( pRequest->m_handle < pBest->m_handle ) ) )
+		{
+			pBest = pRequest;
+		}
+	}
+	return pBest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateManager
+
+//static
+void BaArchiveLoader::CreateManager()
+{
+	if( m_isCreated == BtFalse )
+	{
+		for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+		{
+			m_requests[i].SetState( BaLS_Free );
+		}
+
+		g_loaderThread.Start();
+		g_loaderThread.Priority( TP_Low );
+		m_isCreated = BtTrue;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DestroyManager
+
+//static
+void BaArchiveLoader::DestroyManager()
+{
+	if( m_isCreated == BtTrue )
+	{
+		// Wait for the thread to finish any archive it is part way through
+		g_loaderThread.End();
+		m_isCreated = BtFalse;
+
+		// Drop anything it hadn't started
+		for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+		{
+			if( m_requests[i].GetState() == BaLS_Queued )
+			{
+				m_requests[i].SetState( BaLS_Free );
+			}
+		}
+
+		// Finish anything it has read so no archive is left half created
+		while( GetNumPending() )
+		{
+			Update();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load
+
+//static
+BaLoadHandle BaArchiveLoader::Load( BaArchive* pArchive,
+									const BtChar* archiveName,
+									BaLoadPriority priority,
+									BaLoadCallback callback,
+									void* pContext )
+{
+	// Without a loading thread fall back to loading straight away
+	if( m_isCreated == BtFalse )
+	{
+		pArchive->Load( archiveName );
+
+		if( callback )
+		{
+			callback( pArchive, pContext );
+		}
+		return 0;
+	}
+
+	// Unloading removes resources from the device so it has to happen on this thread
+	if( pArchive->IsLoaded() )
+	{
+		pArchive->Unload();
+	}
+
+	for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+	{
+		BaLoadRequest& request = m_requests[i];
+
+		if( request.GetState() == BaLS_Free )
+		{
+			request.m_pArchive = pArchive;
+			BtStrCopy( request.m_archiveName, 256, archiveName );
+			request.m_priority = priority;
+			request.m_callback = callback;
+			request.m_pContext = pContext;
+			request.m_handle = m_nextHandle++;
+			request.m_nextResource = 0;
+
+			// Hand it to the loading thread last
+			request.SetState( BaLS_Queued );
+
+			return request.m_handle;
+		}
+	}
+
+	ErrorLog::Fatal_Printf( "Too many archives loading. Increase MaxArchiveLoads.\n" );
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+
+//static
+void BaArchiveLoader::Update()
+{
+	BtProfile( "BaArchiveLoader::Update" );
+
+	// Pick the highest priority archive that has been read
+	BaLoadRequest* pRequest = BtNull;
+
+	for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+	{
+		BaLoadRequest* pCurrent = &m_requests[i];
+		BaLoadState state = pCurrent->GetState();
+
+		if( ( state != BaLS_Read ) && ( state != BaLS_Creating ) )
+		{
+			continue;
+		}
+
+		if( ( pRequest == BtNull ) ||
+			( state == BaLS_Creating ) ||
+			( ( pRequest->GetState() != BaLS_Creating ) && ( pCurrent->m_priority > pRequest->m_priority ) ) )
+		{
+			pRequest = pCurrent;
+		}
+	}
+
+	if( pRequest == BtNull )
+	{
+		return;
+	}
+
+	pRequest->SetState( BaLS_Creating );
+
+	BaArchive* pArchive = pRequest->m_pArchive;
+
+	// Spread the fix ups and device creation over several updates
+	BtU32 numResources = pArchive->GetNumResources();
+	BtU32 endResource = MtMin( pRequest->m_nextResource + m_resourcesPerUpdate, numResources );
+
+	pArchive->FixPointers( pRequest->m_nextResource, endResource );
+	pRequest->m_nextResource = endResource;
+
+	if( endResource == numResources )
+	{
+		pArchive->FinishLoad();
+
+		BaLoadCallback callback = pRequest->m_callback;
+		void* pContext = pRequest->m_pContext;
+
+		pRequest->SetState( BaLS_Free );
+
+		if( callback )
+		{
+			callback( pArchive, pContext );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsComplete
+
+//static
+BtBool BaArchiveLoader::IsComplete( BaLoadHandle handle )
+{
+	for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+	{
+		if( ( m_requests[i].GetState() != BaLS_Free ) && ( m_requests[i].m_handle == handle ) )
+		{
+			return BtFalse;
+		}
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumPending
+
+//static
+BtU32 BaArchiveLoader::GetNumPending()
+{
+	BtU32 numPending = 0;
+
+	for( BtU32 i=0; i<MaxArchiveLoads; i++ )
+	{
+		if( m_requests[i].GetState() != BaLS_Free )
+		{
+			numPending++;
+		}
+	}
+	return numPending;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetResourcesPerUpdate
+
+//static
+void BaArchiveLoader::SetResourcesPerUpdate( BtU32 resourcesPerUpdate )
+{
+	m_resourcesPerUpdate = MtMax( resourcesPerUpdate, (BtU32)1 );
+}
@@ -143,10 +143,15 @@ struct BaShader
 	BtU32							m_size;
 };
 
+// Archives packed from this version on have a hash of the shader source. It keys
+// the program binary cache so loading doesn't have to hash the source itself
+const BtU32 BaShaderHashVersion = 101;
+
 struct BaShaderFileData
 {
 	BtU32							m_count;
 	BaShader						m_shaders[MaxShaders];
+	BtU32							m_sourceHash;		// CRC of the source from the first shader to the end of the last
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -352,6 +357,33 @@ struct BaMaterialBlockFileData
 	BtU32							m_nEndRenderBlock;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// BaMeshLodFileData
+
+// Most levels of detail a mesh is packed with, counting the full mesh
+const BtU32 MaxMeshLods = 4;
+
+// Archives packed from this version on follow a mesh's material blocks with its levels
+// of detail. The material blocks themselves still cover only the full mesh
+const BtU32 BaMeshLodVersion = 102;
+
+struct BaMeshLodFileData
+{
+	BtU32							m_numLods;
+	BtFloat							m_screenSize[MaxMeshLods];	// Smallest projected radius each level is drawn at
+	BtU32							m_pad;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// BaMaterialLodFileData
+
+// The render blocks of each level of detail of one material block
+struct BaMaterialLodFileData
+{
+	BtU32							m_nStartRenderBlock[MaxMeshLods];
+	BtU32							m_nEndRenderBlock[MaxMeshLods];
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // BaSceneFileData
 
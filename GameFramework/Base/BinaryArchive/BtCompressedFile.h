@@ -7,6 +7,7 @@
 // Includes
 #include "BtTypes.h"
 #include "BaFileData.h"
+#include "BaArchive.h"
 #include "zlib.h"
 #include <stdio.h>
 
@@ -17,9 +18,28 @@ class BtCompressedFile
 {
 public:
 
+	// Constructor
+	BtCompressedFile();
+	~BtCompressedFile();
+
 	// Public functions
 	void					Read( FILE *f, BtU8* pMemory, BtU32 targetSize );
 
+	// Chunked archives. The packer writes the chunk table and chunks after the archive header
+	static BtU32			WriteChunks( FILE *f, const BtU8* pSource, BtU32 dataSize );
+	BtBool					ReadChunkTable( FILE *f, BtU32 dataSize );
+	void					ReadChunks( FILE *f );
+	BtBool					InflateChunk( BtU32 iChunk, BtU8* pMemory ) const;
+	void					InflateChunks( BtU8* pMemory, BtU32 iFirstChunk, BtU32 iEndChunk ) const;
+
+	// Inflates only the chunks covering part of the archive memory, such as one resource's data
+	void					InflateRange( BtU8* pMemory, BtU32 offset, BtU32 size ) const;
+	void					InflateResource( BtU8* pMemory, const BaResourceHeader& resourceHeader ) const;
+
+	// Accessors
+	BtU32					GetNumChunks() const;
+	const BaArchiveChunk&	GetChunk( BtU32 iChunk ) const;
+
 private:
 
 	// Private functions
@@ -29,4 +49,24 @@ private:
 	FILE*					m_file;
 	z_stream				m_strm;
 	BtU8					m_buffer[StreamingSize];
+
+	BaArchiveChunkHeader	m_chunkHeader;
+	BaArchiveChunk*			m_pChunks;
+	BtU8*					m_pCompressed;
 };
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumChunks
+
+inline BtU32 BtCompressedFile::GetNumChunks() const
+{
+	return m_chunkHeader.m_nChunks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetChunk
+
+inline const BaArchiveChunk& BtCompressedFile::GetChunk( BtU32 iChunk ) const
+{
+	return m_pChunks[iChunk];
+}
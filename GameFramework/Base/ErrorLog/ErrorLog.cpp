@@ -3,6 +3,7 @@
 
 // Includes
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <cctype>
 #include <stdarg.h>
@@ -4,6 +4,17 @@
 #include "RsFrustum.h"
 #include "MtMath.h"
 
+// Batches are tested four at a time where the platform has the instructions. x64 always has SSE
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 1 ) )
+#include <xmmintrin.h>
+#define RS_FRUSTUM_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define RS_FRUSTUM_NEON
+#endif
+
+static BtBool g_isSimd = BtTrue;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
@@ -94,6 +105,222 @@ BtBool RsFrustum::IsInside( const MtVector3& v3Point, BtFloat radius ) const
 	return BtTrue;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// IsInside
+
+BtBool RsFrustum::IsInside( const MtAABB& AABB ) const
+{
+	MtVector3 v3Center = ( AABB.Min() + AABB.Max() ) * 0.5f;
+	MtVector3 v3Extent = ( AABB.Max() - AABB.Min() ) * 0.5f;
+
+	return IsBoxInside( v3Center, v3Extent );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsBoxInside
+
+// Outside when even the corner furthest into the frustum is outside a plane
+BtBool RsFrustum::IsBoxInside( const MtVector3& v3Center, const MtVector3& v3Extent ) const
+{
+	for( BtU32 iPlane = 0; iPlane < 6; ++iPlane )
+	{
+		const MtPlane& plane = m_frustumPlanes[iPlane];
+
+		BtFloat fDistanceToPlane = plane.DistanceTo( v3Center );
+		BtFloat fReach = ( MtAbs( plane.m_v3Normal.x ) * v3Extent.x ) +
+						 ( MtAbs( plane.m_v3Normal.y ) * v3Extent.y ) +
+						 ( MtAbs( plane.m_v3Normal.z ) * v3Extent.z );
+
+		if( fDistanceToPlane > fReach )
+		{
+			return BtFalse;
+		}
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetSimd
+
+//static
+void RsFrustum::SetSimd( BtBool isEnabled )
+{
+	g_isSimd = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsInside
+
+// Each result is worked out the same way as the single sphere test so the two always agree
+void RsFrustum::IsInside( const BtFloat* pX, const BtFloat* pY, const BtFloat* pZ, const BtFloat* pRadius,
+						  BtU32 count, BtBool* pIsInside ) const
+{
+	BtU32 i = 0;
+
+#if defined( RS_FRUSTUM_SSE )
+	if( g_isSimd == BtTrue )
+	{
+		for( ; i + 4 <= count; i += 4 )
+		{
+			__m128 x = _mm_loadu_ps( pX + i );
+			__m128 y = _mm_loadu_ps( pY + i );
+			__m128 z = _mm_loadu_ps( pZ + i );
+			__m128 radius = _mm_loadu_ps( pRadius + i );
+			__m128 isOutside = _mm_setzero_ps();
+
+			for( BtU32 iPlane = 0; iPlane < 6; ++iPlane )
+			{
+				const MtPlane& plane = m_frustumPlanes[iPlane];
+
+				__m128 distance = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.x ), x ),
+																	  _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.y ), y ) ),
+														  _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.z ), z ) ),
+											  _mm_set1_ps( plane.m_fDistance ) );
+
+				isOutside = _mm_or_ps( isOutside, _mm_cmpgt_ps( distance, radius ) );
+			}
+
+			BtU32 mask = _mm_movemask_ps( isOutside );
+
+			pIsInside[i + 0] = ( mask & 1 ) == 0;
+			pIsInside[i + 1] = ( mask & 2 ) == 0;
+			pIsInside[i + 2] = ( mask & 4 ) == 0;
+			pIsInside[i + 3] = ( mask & 8 ) == 0;
+		}
+	}
+#elif defined( RS_FRUSTUM_NEON )
+	if( g_isSimd == BtTrue )
+	{
+		for( ; i + 4 <= count; i += 4 )
+		{
+			float32x4_t x = vld1q_f32( pX + i );
+			float32x4_t y = vld1q_f32( pY + i );
+			float32x4_t z = vld1q_f32( pZ + i );
+			float32x4_t radius = vld1q_f32( pRadius + i );
+			uint32x4_t isOutside = vdupq_n_u32( 0 );
+
+			for( BtU32 iPlane = 0; iPlane < 6; ++iPlane )
+			{
+				const MtPlane& plane = m_frustumPlanes[iPlane];
+
+				// Separate multiplies and adds rather than fused ones to round like the single test
+				float32x4_t distance = vaddq_f32( vaddq_f32( vaddq_f32( vmulq_n_f32( x, plane.m_v3Normal.x ),
+																	   vmulq_n_f32( y, plane.m_v3Normal.y ) ),
+															 vmulq_n_f32( z, plane.m_v3Normal.z ) ),
+												  vdupq_n_f32( plane.m_fDistance ) );
+
+				isOutside = vorrq_u32( isOutside, vcgtq_f32( distance, radius ) );
+			}
+
+			pIsInside[i + 0] = vgetq_lane_u32( isOutside, 0 ) == 0;
+			pIsInside[i + 1] = vgetq_lane_u32( isOutside, 1 ) == 0;
+			pIsInside[i + 2] = vgetq_lane_u32( isOutside, 2 ) == 0;
+			pIsInside[i + 3] = vgetq_lane_u32( isOutside, 3 ) == 0;
+		}
+	}
+#endif
+
+	// What's left over, or everything without SIMD
+	for( ; i < count; i++ )
+	{
+		pIsInside[i] = IsInside( MtVector3( pX[i], pY[i], pZ[i] ), pRadius[i] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsInside
+
+// Each result is worked out the same way as IsBoxInside so the two always agree. The
+// absolute values of the normals are taken once per plane, so only SSE1 is needed
+void RsFrustum::IsInside( const BtFloat* pCenterX, const BtFloat* pCenterY, const BtFloat* pCenterZ,
+						  const BtFloat* pExtentX, const BtFloat* pExtentY, const BtFloat* pExtentZ,
+						  BtU32 count, BtBool* pIsInside ) const
+{
+	BtU32 i = 0;
+
+#if defined( RS_FRUSTUM_SSE )
+	if( g_isSimd == BtTrue )
+	{
+		for( ; i + 4 <= count; i += 4 )
+		{
+			__m128 x = _mm_loadu_ps( pCenterX + i );
+			__m128 y = _mm_loadu_ps( pCenterY + i );
+			__m128 z = _mm_loadu_ps( pCenterZ + i );
+			__m128 extentX = _mm_loadu_ps( pExtentX + i );
+			__m128 extentY = _mm_loadu_ps( pExtentY + i );
+			__m128 extentZ = _mm_loadu_ps( pExtentZ + i );
+			__m128 isOutside = _mm_setzero_ps();
+
+			for( BtU32 iPlane = 0; iPlane < 6; ++iPlane )
+			{
+				const MtPlane& plane = m_frustumPlanes[iPlane];
+
+				__m128 distance = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.x ), x ),
+																	  _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.y ), y ) ),
+														  _mm_mul_ps( _mm_set1_ps( plane.m_v3Normal.z ), z ) ),
+											  _mm_set1_ps( plane.m_fDistance ) );
+
+				__m128 reach = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( MtAbs( plane.m_v3Normal.x ) ), extentX ),
+													   _mm_mul_ps( _mm_set1_ps( MtAbs( plane.m_v3Normal.y ) ), extentY ) ),
+										   _mm_mul_ps( _mm_set1_ps( MtAbs( plane.m_v3Normal.z ) ), extentZ ) );
+
+				isOutside = _mm_or_ps( isOutside, _mm_cmpgt_ps( distance, reach ) );
+			}
+
+			BtU32 mask = _mm_movemask_ps( isOutside );
+
+			pIsInside[i + 0] = ( mask & 1 ) == 0;
+			pIsInside[i + 1] = ( mask & 2 ) == 0;
+			pIsInside[i + 2] = ( mask & 4 ) == 0;
+			pIsInside[i + 3] = ( mask & 8 ) == 0;
+		}
+	}
+#elif defined( RS_FRUSTUM_NEON )
+	if( g_isSimd == BtTrue )
+	{
+		for( ; i + 4 <= count; i += 4 )
+		{
+			float32x4_t x = vld1q_f32( pCenterX + i );
+			float32x4_t y = vld1q_f32( pCenterY + i );
+			float32x4_t z = vld1q_f32( pCenterZ + i );
+			float32x4_t extentX = vld1q_f32( pExtentX + i );
+			float32x4_t extentY = vld1q_f32( pExtentY + i );
+			float32x4_t extentZ = vld1q_f32( pExtentZ + i );
+			uint32x4_t isOutside = vdupq_n_u32( 0 );
+
+			for( BtU32 iPlane = 0; iPlane < 6; ++iPlane )
+			{
+				const MtPlane& plane = m_frustumPlanes[iPlane];
+
+				// Separate multiplies and adds rather than fused ones to round like the single test
+				float32x4_t distance = vaddq_f32( vaddq_f32( vaddq_f32( vmulq_n_f32( x, plane.m_v3Normal.x ),
+																	   vmulq_n_f32( y, plane.m_v3Normal.y ) ),
+															 vmulq_n_f32( z, plane.m_v3Normal.z ) ),
+												  vdupq_n_f32( plane.m_fDistance ) );
+
+				float32x4_t reach = vaddq_f32( vaddq_f32( vmulq_n_f32( extentX, MtAbs( plane.m_v3Normal.x ) ),
+														  vmulq_n_f32( extentY, MtAbs( plane.m_v3Normal.y ) ) ),
+											   vmulq_n_f32( extentZ, MtAbs( plane.m_v3Normal.z ) ) );
+
+				isOutside = vorrq_u32( isOutside, vcgtq_f32( distance, reach ) );
+			}
+
+			pIsInside[i + 0] = vgetq_lane_u32( isOutside, 0 ) == 0;
+			pIsInside[i + 1] = vgetq_lane_u32( isOutside, 1 ) == 0;
+			pIsInside[i + 2] = vgetq_lane_u32( isOutside, 2 ) == 0;
+			pIsInside[i + 3] = vgetq_lane_u32( isOutside, 3 ) == 0;
+		}
+	}
+#endif
+
+	// What's left over, or everything without SIMD
+	for( ; i < count; i++ )
+	{
+		pIsInside[i] = IsBoxInside( MtVector3( pCenterX[i], pCenterY[i], pCenterZ[i] ),
+									MtVector3( pExtentX[i], pExtentY[i], pExtentZ[i] ) );
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetNearestPointOnFrustum
 
@@ -6,13 +6,20 @@
 #include "BtMemory.h"
 #include "BtTime.h"
 #include "BtPrint.h"
+#include "BtProfiler.h"
+#include "ErrorLog.h"
+#include "MtMath.h"
 #include "ApConfig.h"
 
 //static
 RsImpl *RsImpl::m_pInstance = BtNull;
 
+// Size of the first page of the graphics heap
 const BtU32 RenderHeapSize = 1024 * 100;
 
+// Renderables hold matrices so keep every allocation aligned for them
+const BtU32 RenderHeapAlignment = 16;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
@@ -25,6 +32,7 @@ RsImpl::RsImpl()
 	m_isFullScreen = BtFalse;
 	m_pInstance = this;
 	m_orientation = RsOrientation_Landscape;
+	BtMemory::Set( &m_heapStats, 0, sizeof( RsGraphicsHeapStats ) );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,8 +40,10 @@ RsImpl::RsImpl()
 
 void RsImpl::Create()
 {
-	// Allocate from the heap
-	m_pHeap = BtMemory::Allocate( RenderHeapSize );
+	// The first page is taken by the first renderable. More are chained on when a frame needs them
+	m_heap.Create( "RsImpl graphics heap", BtMT_Render, RenderHeapSize, RenderHeapAlignment, MaxGraphicsHeapPages );
+
+	BtMemory::Set( &m_heapStats, 0, sizeof( RsGraphicsHeapStats ) );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -41,8 +51,7 @@ void RsImpl::Create()
 
 void RsImpl::Destroy()
 {
-	// Free the heap memory
-	BtMemory::Free( m_pHeap );
+	m_heap.Destroy();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -50,16 +59,44 @@ void RsImpl::Destroy()
 
 BtU8 *RsImpl::AllocateGraphicsMemory( BtU32 size )
 {
-	// Calculate the current heap position
-	BtU8 *pMemory = m_pHeap + m_runTimeHeap;
-
-	// Advance the heap
-	m_runTimeHeap += size;
+	BtU8 *pMemory = m_heap.Allocate( size );
 
-	// Return the current pointer
+	// Keep the stats in step when the heap took more memory
+	if( m_heap.GetCapacity() != m_heapStats.m_capacity )
+	{
+		if( m_heap.GetNumGrowths() != m_heapStats.m_numGrowths )
+		{
+#if defined( _DEBUG )
+			ErrorLog::Printf( "RsImpl graphics heap grew to %d pages. %d bytes used this frame\n", m_heap.GetNumPages(), m_heap.GetBytesUsed() );
+#else
+			if( m_heapStats.m_numGrowths == 0 )
+			{
+				ErrorLog::Printf( "RsImpl graphics heap overflowed %d bytes. Growing it\n", m_heapStats.m_capacity );
+			}
+#endif
+		}
+		m_heapStats.m_capacity = m_heap.GetCapacity();
+		m_heapStats.m_numPages = m_heap.GetNumPages();
+		m_heapStats.m_numGrowths = m_heap.GetNumGrowths();
+	}
 	return pMemory;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// ResetGraphicsMemory
+
+void RsImpl::ResetGraphicsMemory()
+{
+	// Record the frame that just finished
+	m_heapStats.m_bytesUsed = m_heap.GetBytesUsed();
+	m_heapStats.m_numAllocations = m_heap.GetNumAllocations();
+	m_heapStats.m_highWater = MtMax( m_heapStats.m_highWater, m_heapStats.m_bytesUsed );
+
+	BtProfiler::Counter( "Graphics heap bytes", m_heapStats.m_bytesUsed );
+
+	m_heap.Reset();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // pInstance
 
@@ -74,7 +111,16 @@ RsImpl *RsImpl::pInstance()
 
 void RsImpl::BeginScene()
 {
-	m_runTimeHeap = 0;
+	ResetGraphicsMemory();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderParallel
+
+//virtual
+void RsImpl::RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext )
+{
+	function( pContext, 0, count );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
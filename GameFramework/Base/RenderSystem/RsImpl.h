@@ -10,6 +10,8 @@
 #include "RsUtil.h"
 #include "RsVertex.h"
 #include "RsShader.h"
+#include "BtJobSystem.h"
+#include "BtPagedHeap.h"
 
 #ifndef GL_BUFFER_OFFSET
 #define GL_BUFFER_OFFSET(i)((char *)NULL + (i))
@@ -18,6 +20,19 @@
 const BtU32 MaxVertex = 65535;
 const BtU32 MaxIndex = 65535;
 
+// Pages the graphics heap can chain. Running out of these is fatal
+const BtU32 MaxGraphicsHeapPages = 32;
+
+struct RsGraphicsHeapStats
+{
+	BtU32								m_bytesUsed;			// Last frame
+	BtU32								m_numAllocations;		// Last frame
+	BtU32								m_highWater;			// Most used by any one frame
+	BtU32								m_capacity;
+	BtU32								m_numPages;
+	BtU32								m_numGrowths;			// Frames that needed another page
+};
+
 // Class declaration
 class RsImpl
 {
@@ -31,7 +46,10 @@ public:
 	virtual void							Create();
 	virtual void							Destroy();
 
+	// Per frame memory for renderables. Everything is released by ResetGraphicsMemory
 	BtU8								   *AllocateGraphicsMemory( BtU32 size );
+	void									ResetGraphicsMemory();
+	const RsGraphicsHeapStats&				GetGraphicsHeapStats() const;
 
 	virtual RsRenderTarget				   *GetNewRenderTarget() = 0;
 
@@ -39,6 +57,10 @@ public:
 
 	virtual void							BeginScene();
 	virtual void							Render() = 0;
+
+	// Runs function over [0, count) and adds the renderables it makes. Platforms that can
+	// spread this over the job system do so
+	virtual void							RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext );
 	virtual void							EndScene();
 
 	// Accessors
@@ -89,8 +111,8 @@ protected:
 	BtU32									m_currentIndex;
 
 	// Graphics heap memory
-	BtU8								   *m_pHeap;
-	BtU32									m_runTimeHeap;
+	BtPagedHeap								m_heap;
+	RsGraphicsHeapStats						m_heapStats;
 
 	BtBool									m_isFullScreen;
 };
@@ -159,6 +181,14 @@ inline MtVector2 RsImpl::GetScreenCenter()
 	return GetDimension() * 0.5f;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// GetGraphicsHeapStats
+
+inline const RsGraphicsHeapStats& RsImpl::GetGraphicsHeapStats() const
+{
+	return m_heapStats;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetCurrentVertex
 
@@ -32,6 +32,14 @@ void RsUtil::EmptyRenderTargets()
 	return RsImpl::pInstance()->EmptyRenderTargets();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RenderParallel
+
+void RsUtil::RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext )
+{
+	RsImpl::pInstance()->RenderParallel( count, grainSize, function, pContext );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetNewRenderTarget
 
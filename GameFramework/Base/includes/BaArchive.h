@@ -10,6 +10,14 @@
 const BtU32 MaxArchiveName   = 32;
 const BtU32 LMaxResourceName = 68;
 
+// Mapped archives store the raw archive after the header at this offset
+const BtU32 BaMappedArchiveAlignment = 4096;
+
+// Mapped archives record the version of their layout and the size of the compressed archive
+// they were written alongside, so a stale mapping falls back to the compressed archive
+const BtU32 BaMappedArchiveMagic   = 0x4D414142;	// "BAAM"
+const BtU32 BaMappedArchiveVersion = 1;
+
 //////////////////////////////////////////////////////////////////////////
 // BaResourceType
 
@@ -51,6 +59,36 @@ struct BaArchiveHeader
 	BtU32						m_nHeaderCheckSum;
 };
 
+// Follows the archive header at the start of a mapped archive
+struct BaMappedArchiveHeader
+{
+	BtU32						m_magic;
+	BtU32						m_nVersion;
+	BtU32						m_nSourceSize;
+	BtU32						m_pad0;
+};
+
+// Chunked archives follow the archive header with a chunk table. Each chunk
+// is an independent zlib stream so chunks can be inflated in any order
+const BtU32 BaArchiveChunkMagic = 0x4B434142;	// "BACK"
+const BtU32 BaArchiveChunkSize  = 256 * 1024;
+
+struct BaArchiveChunkHeader
+{
+	BtU32						m_magic;
+	BtU32						m_nChunks;
+	BtU32						m_nChunkSize;
+	BtU32						m_nCompressedSize;
+};
+
+struct BaArchiveChunk
+{
+	BtU32						m_nCompressedOffset;		// Relative to the end of the chunk table
+	BtU32						m_nCompressedSize;
+	BtU32						m_nUncompressedOffset;
+	BtU32						m_nUncompressedSize;
+};
+
 struct BaResourceHeader
 {
 	BtChar						m_szTitle[LMaxResourceName];
@@ -96,6 +134,12 @@ class SgRigidBody;
 class SgAnimator;
 class BaArchive;
 
+struct BaResourceIndexEntry
+{
+	BtU32						m_hash;
+	BtU32						m_nResourceIndex;
+};
+
 struct BaArchiveNode : public BtLinkedListItem<BaArchiveNode>
 {
 	BaArchiveNode()
@@ -128,6 +172,7 @@ public:
 	BaResource				   *GetResource( BaResourceType eType, const BtChar* szTitle ) const;
 	BaResource			       *GetResource( BtU32 nResourceID ) const;
 	BtChar					   *GetFilename() { return m_filename; }
+	BtU32						GetPackerVersion() const { return m_header.m_nPackerVersion; }
 
 
 	RsFont					   *GetFont( const BtChar* name );
@@ -150,6 +195,13 @@ public:
 private:
 
 	void						LoadFile( const BtChar* archiveName );
+	BtBool						LoadMappedFile( const BtChar* archiveName );
+	void						FreeArchiveMemory();
+
+	void						BuildResourceIndex();
+	void						FreeResourceIndex();
+	void						FreeDuplicates();
+	static BtU32				GetTitleHash( BaResourceType eType, const BtChar* szTitle );
 	
 	void						GetInstanceSizes();
 
@@ -158,9 +210,16 @@ private:
 	void						CreateResources();
 	void						CreateResourceInstance(BaResourceType resourceType, BtU8 *pMemory);
 	
-	void						FixPointers();
+	void						FixPointers( BtU32 iStartResource, BtU32 iEndResource );
 	void						ValidateResources();
 
+	// Split load used by BaArchiveLoader. ReadArchive doesn't touch the device
+	void						ReadArchive( const BtChar* archiveName );
+	void						FinishLoad();
+	BtU32						GetNumResources() const { return m_header.m_nNumResources; }
+
+	friend class BaArchiveLoader;
+
 	BaArchiveHeader				m_header;
 	BaArchiveNode				m_archiveNode;
 	static BtLinkedList<BaArchiveNode>	m_archives;
@@ -168,6 +227,15 @@ private:
 	BtU8*						m_pArchiveMemory;
 	BtU8*						m_pInstanceMemory;
 
+	// Set when the archive memory is a private file mapping rather than an allocation
+	void*						m_pMappedMemory;
+	BtU64						m_mappedSize;
+
+	// Open addressed lookups into the resource headers built at load time
+	BaResourceIndexEntry*		m_pTitleIndex;
+	BaResourceIndexEntry*		m_pIDIndex;
+	BtU32						m_indexMask;
+
 	BtLinkedList<BaDuplicate>	m_duplicates;
 	BtChar						m_filename[256];
 	BtBool						m_isLoaded;
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveLoader.h
+
+// Include guard
+#pragma once
+#include "BtTypes.h"
+#include "BaArchive.h"
+#include "BtAtomic.h"
+
+const BtU32 MaxArchiveLoads = 16;
+
+enum BaLoadPriority
+{
+	BaLP_Low = 0,
+	BaLP_Normal,
+	BaLP_High,
+};
+
+enum BaLoadState
+{
+	BaLS_Free = 0,
+	BaLS_Queued,				// Waiting for the loading thread
+	BaLS_Reading,				// Reading and inflating on the loading thread
+	BaLS_Read,					// Waiting for the game thread to create on the device
+	BaLS_Creating,				// Fixing up and creating on the device a few resources per update
+};
+
+typedef BtU32 BaLoadHandle;
+typedef void (*BaLoadCallback)( BaArchive* pArchive, void* pContext );
+
+struct BaLoadRequest
+{
+	BaArchive*						m_pArchive;
+	BtChar							m_archiveName[256];
+	BaLoadPriority					m_priority;
+	BaLoadCallback					m_callback;
+	void*							m_pContext;
+	BaLoadHandle					m_handle;
+	BtU32							m_nextResource;
+
+	// Each state is owned by exactly one thread which hands the request on by writing the next state.
+	// The state is stored and loaded atomically so the next owner sees everything written before it
+	BaLoadState						GetState() { return (BaLoadState)BtAtomicLoad( &m_state ); }
+	void							SetState( BaLoadState state ) { BtAtomicStore( &m_state, (BtS32)state ); }
+
+	volatile BtS32					m_state;
+};
+
+// Class definition
+class BaArchiveLoader
+{
+public:
+
+	// Public functions
+	static void						CreateManager();
+	static void						DestroyManager();
+	static void						Update();
+
+	static BaLoadHandle				Load( BaArchive* pArchive,
+										  const BtChar* archiveName,
+										  BaLoadPriority priority = BaLP_Normal,
+										  BaLoadCallback callback = BtNull,
+										  void* pContext = BtNull );
+
+	// Accessors
+	static BtBool					IsComplete( BaLoadHandle handle );
+	static BtU32					GetNumPending();
+	static void						SetResourcesPerUpdate( BtU32 resourcesPerUpdate );
+
+private:
+
+	friend class BaArchiveLoaderThread;
+
+	static BaLoadRequest*			GetNextRequest();
+	static void						ReadRequest( BaLoadRequest* pRequest );
+
+	static BaLoadRequest			m_requests[MaxArchiveLoads];
+	static BaLoadHandle				m_nextHandle;
+	static BtU32					m_resourcesPerUpdate;
+	static BtBool					m_isCreated;
+};
@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomic.h
+
+#pragma once
+#include "BtTypes.h"
+
+#ifdef WIN32
+#include <intrin.h>
+#pragma intrinsic( _InterlockedExchangeAdd, _InterlockedExchange, _InterlockedCompareExchange )
+#pragma intrinsic( _InterlockedCompareExchange64 )
+#endif
+
+// Unless noted these are full barriers. Add returns the new value, Exchange the old one
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicAdd
+
+inline BtS32 BtAtomicAdd( volatile BtS32* pValue, BtS32 value )
+{
+#ifdef WIN32
+	return _InterlockedExchangeAdd( (volatile long*)pValue, value ) + value;
+#else
+	return __sync_add_and_fetch( pValue, value );
+#endif
+}
+
+inline BtS64 BtAtomicAdd( volatile BtS64* pValue, BtS64 value )
+{
+#ifdef WIN32
+	BtS64 old = *pValue;
+
+	// 32 bit targets have no 64 bit add intrinsic so build one from a compare and swap
+	while( _InterlockedCompareExchange64( (volatile __int64*)pValue, old + value, old ) != old )
+	{
+		old = *pValue;
+	}
+	return old + value;
+#else
+	return __sync_add_and_fetch( pValue, value );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicExchange
+
+inline BtS32 BtAtomicExchange( volatile BtS32* pValue, BtS32 value )
+{
+#ifdef WIN32
+	return _InterlockedExchange( (volatile long*)pValue, value );
+#else
+	return __atomic_exchange_n( pValue, value, __ATOMIC_SEQ_CST );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicCompareSwap
+
+inline BtBool BtAtomicCompareSwap( volatile BtS32* pValue, BtS32 expected, BtS32 value )
+{
+#ifdef WIN32
+	return _InterlockedCompareExchange( (volatile long*)pValue, value, expected ) == expected;
+#else
+	return __sync_bool_compare_and_swap( pValue, expected, value );
+#endif
+}
+
+inline BtBool BtAtomicCompareSwap( volatile BtS64* pValue, BtS64 expected, BtS64 value )
+{
+#ifdef WIN32
+	return _InterlockedCompareExchange64( (volatile __int64*)pValue, value, expected ) == expected;
+#else
+	return __sync_bool_compare_and_swap( pValue, expected, value );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicLoad
+
+inline BtS32 BtAtomicLoad( volatile BtS32* pValue )
+{
+#ifdef WIN32
+	return _InterlockedCompareExchange( (volatile long*)pValue, 0, 0 );
+#else
+	return __atomic_load_n( pValue, __ATOMIC_SEQ_CST );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicPeek. A relaxed read with no ordering. Fine for polling, not for publishing
+
+inline BtS32 BtAtomicPeek( volatile BtS32* pValue )
+{
+#ifdef WIN32
+	return *pValue;
+#else
+	return __atomic_load_n( pValue, __ATOMIC_RELAXED );
+#endif
+}
+
+inline BtS64 BtAtomicPeek( volatile BtS64* pValue )
+{
+#if defined( WIN32 ) && defined( _WIN64 )
+	return *pValue;
+#elif defined( WIN32 )
+	// 32 bit targets would read the halves separately
+	return _InterlockedCompareExchange64( (volatile __int64*)pValue, 0, 0 );
+#else
+	return __atomic_load_n( pValue, __ATOMIC_RELAXED );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicPoke. A relaxed write with no ordering, for values one thread writes and others
+// only Peek
+
+inline void BtAtomicPoke( volatile BtS64* pValue, BtS64 value )
+{
+#if defined( WIN32 ) && defined( _WIN64 )
+	*pValue = value;
+#elif defined( WIN32 )
+	BtS64 old = *pValue;
+
+	while( _InterlockedCompareExchange64( (volatile __int64*)pValue, value, old ) != old )
+	{
+		old = *pValue;
+	}
+#else
+	__atomic_store_n( pValue, value, __ATOMIC_RELAXED );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicStore
+
+inline void BtAtomicStore( volatile BtS32* pValue, BtS32 value )
+{
+#ifdef WIN32
+	_InterlockedExchange( (volatile long*)pValue, value );
+#else
+	__atomic_store_n( pValue, value, __ATOMIC_SEQ_CST );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtAtomicPause
+
+inline void BtAtomicPause()
+{
+#ifdef WIN32
+	_mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BtSpinLock. For very short critical sections. Use BtMutex for anything that might block
+
+inline void BtSpinLock( volatile BtS32* pLock )
+{
+	while( BtAtomicCompareSwap( pLock, 0, 1 ) == BtFalse )
+	{
+		// Spin on a plain read so waiting doesn't keep stealing the cache line
+		while( BtAtomicPeek( pLock ) != 0 )
+		{
+			BtAtomicPause();
+		}
+	}
+}
+
+inline BtBool BtSpinTryLock( volatile BtS32* pLock )
+{
+	return BtAtomicCompareSwap( pLock, 0, 1 );
+}
+
+inline void BtSpinUnlock( volatile BtS32* pLock )
+{
+#ifdef WIN32
+	_InterlockedExchange( (volatile long*)pLock, 0 );
+#else
+	__atomic_store_n( pLock, 0, __ATOMIC_RELEASE );
+#endif
+}
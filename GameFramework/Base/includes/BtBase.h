@@ -15,7 +15,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 // BtFloatToBtU32
 
-inline BtU32 BtFloatToBtU32( BtFloat f ) { return *((BtU32*)&f); }
+// Read the bits through a union rather than a cast pointer, which breaks strict aliasing
+inline BtU32 BtFloatToBtU32( BtFloat value ) { union { BtFloat f; BtU32 u; } bits; bits.f = value; return bits.u; }
 
 ////////////////////////////////////////////////////////////////////////////////
 // BtNearestPowerOf2
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtJobSystem.h
+
+#pragma once
+#include "BtTypes.h"
+
+const BtU32 MaxJobWorkers = 16;
+const BtU32 MaxJobsPerQueue = 1024;
+
+// A job runs over the index range [iStart, iEnd)
+typedef void (*BtJobFunction)( void* pContext, BtU32 iStart, BtU32 iEnd );
+
+// Counts the outstanding jobs of a batch. Wait on it to know they have all run
+struct BtJobCounter
+{
+	BtJobCounter() : m_count( 0 ) {}
+
+	volatile BtS32				m_count;
+};
+
+struct BtJob
+{
+	BtJobFunction				m_function;
+	void*						m_pContext;
+	BtU32						m_iStart;
+	BtU32						m_iEnd;
+	BtJobCounter*				m_pCounter;
+};
+
+// Every worker owns a deque. It pushes and pops its own work at the bottom and idle
+// workers steal from the top of everyone else's
+class BtJobSystem
+{
+public:
+
+	// Pass zero workers to use one per processor. The calling thread counts as one of them
+	static void					CreateManager( BtU32 numWorkers = 0 );
+	static void					DestroyManager();
+
+	// Queue a job. Jobs must not depend on the order they run in
+	static void					Run( BtJobFunction function, void* pContext, BtU32 iStart, BtU32 iEnd, BtJobCounter* pCounter );
+
+	// Run jobs until the counter reaches zero
+	static void					Wait( BtJobCounter* pCounter );
+
+	// Split [0, count) into ranges of at most grainSize and run them across the workers.
+	// Returns when every range has run
+	static void					ParallelFor( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext );
+
+	// Accessors
+	static BtU32				GetNumWorkers();
+	static BtBool				IsCreated();
+
+private:
+
+	friend class BtJobWorker;
+
+	static BtBool				RunNextJob( BtU32 iWorker );
+	static BtBool				PopJob( BtU32 iQueue, BtJob& job );
+	static BtBool				StealJob( BtU32 iQueue, BtJob& job );
+	static void					Execute( BtJob& job );
+	static void					Sleep();
+};
@@ -4,6 +4,35 @@
 #pragma once
 #include "BtTypes.h"
 
+// Allocations are tagged with the subsystem that owns them so we can see who is using memory.
+// Each tag is an arena with its own pools, so a subsystem's small allocations only share
+// pages with each other. Larger ones come from the heap
+enum BtMemoryTag
+{
+	BtMT_General = 0,
+	BtMT_Archive,
+	BtMT_Render,
+	BtMT_SceneGraph,
+	BtMT_Audio,
+	BtMT_Network,
+	BtMT_Max,
+};
+
+struct BtMemoryStats
+{
+	BtS64						m_bytes;				// Live bytes requested
+	BtS64						m_peakBytes;			// Raised every few kilobytes and when read
+	BtS64						m_allocations;			// Live allocations
+	BtS64						m_totalAllocations;
+	BtS64						m_poolBytes;			// Pages the arena's pools hold
+};
+
+// Everything is at least this aligned so SIMD types are safe by default
+const BtU32 BtMemoryDefaultAlignment = 16;
+
+// Allocations this size or smaller come from fixed size pools rather than malloc
+const BtU32 BtMemoryMaxPooledSize = 256 - BtMemoryDefaultAlignment;
+
 // Class Declaration
 class BtMemory
 {
@@ -11,10 +40,20 @@ public:
 
 	static BtU8*  Allocate( BtU32 nSizeInByes );
 	static BtU8*  Allocate( BtU32 nSizeInByes, BtU32 nAlignment );
+	static BtU8*  Allocate( BtMemoryTag tag, BtU32 nSizeInByes, BtU32 nAlignment = BtMemoryDefaultAlignment );
 	static void   Free( void* pMemory );
 	static void   FreeAligned( void* pMemory );
 	static void   Copy( void* pDest, const void *pSource, BtU32 nSize );
 	static void   SetWords( BtU32* pDest, BtU32 nValue, BtU32 numWords);
 	static void   Set(void* pDest, BtU8 nValue, BtU32 nSize);
 	static BtBool Compare( const void* pDest, const void *pSource, BtU32 nSize );
+
+	// Accounting
+	static BtMemoryStats		GetStats( BtMemoryTag tag );
+	static const BtChar*		GetTagName( BtMemoryTag tag );
+	static BtU32				ReportLeaks();
+
+	// Give the calling thread's cached blocks and counts back. Every thread that allocates
+	// calls this as it exits, through a thread exit hook, and BtThread calls it sooner
+	static void					EndThread();
 };
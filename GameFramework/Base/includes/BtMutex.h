@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtMutex.h
+
+#pragma once
+#include "BtTypes.h"
+
+class BtConditionVariable;
+
+class BtMutex
+{
+public:
+
+	// Constructor
+	BtMutex();
+	~BtMutex();
+
+	// Public functions
+	void						Lock();
+	BtBool						TryLock();
+	void						Unlock();
+
+ private:
+
+	friend class BtConditionVariable;
+
+	// Not copyable
+	BtMutex( const BtMutex& );
+	BtMutex& operator=( const BtMutex& );
+
+	void*						m_pHandle;
+};
+
+// Locks a mutex for the lifetime of a scope
+class BtScopedLock
+{
+public:
+
+	BtScopedLock( BtMutex& mutex ) : m_mutex( mutex )
+	{
+		m_mutex.Lock();
+	}
+
+	~BtScopedLock()
+	{
+		m_mutex.Unlock();
+	}
+
+ private:
+
+	BtScopedLock( const BtScopedLock& );
+	BtScopedLock& operator=( const BtScopedLock& );
+
+	BtMutex&					m_mutex;
+};
+
+class BtConditionVariable
+{
+public:
+
+	// Constructor
+	BtConditionVariable();
+	~BtConditionVariable();
+
+	// Public functions. Wait must be called with the mutex locked and can wake spuriously
+	void						Wait( BtMutex& mutex );
+	void						NotifyOne();
+	void						NotifyAll();
+
+ private:
+
+	// Not copyable
+	BtConditionVariable( const BtConditionVariable& );
+	BtConditionVariable& operator=( const BtConditionVariable& );
+
+	void*						m_pHandle;
+};
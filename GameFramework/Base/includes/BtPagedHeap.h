@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtPagedHeap.h
+
+#pragma once
+#include "BtTypes.h"
+#include "BtBase.h"
+#include "BtMemory.h"
+
+// A heap grows by chaining pages. Running out of these is fatal
+const BtU32 MaxPagedHeapPages = 32;
+
+// Linear memory that is all released at once by Reset. When a page fills, the next one is
+// taken. Pages are kept and reused in order, so once the heap has grown to fit its busiest
+// frame it stops allocating. Earlier allocations never move
+class BtPagedHeap
+{
+public:
+
+	BtPagedHeap();
+
+	// The name is used if the heap runs out of pages. The first page is taken by the first
+	// allocation and each new page is as big as all those before it
+	void							Create( const BtChar* name, BtMemoryTag tag, BtU32 firstPageSize, BtU32 alignment, BtU32 maxPages );
+	void							Destroy();
+
+	// Memory aligned to the heap's alignment. It lasts until Reset
+	BtU8*							Allocate( BtU32 size );
+
+	// Release everything. In debug the memory that was used is scribbled over
+	void							Reset();
+
+	// Accessors
+	BtU32							GetBytesUsed() const;			// Since the last Reset, across all its pages
+	BtU32							GetNumAllocations() const;		// Since the last Reset
+	BtU32							GetCapacity() const;
+	BtU32							GetNumPages() const;
+	BtU32							GetNumGrowths() const;			// Pages added after the first
+
+private:
+
+	BtU8*							AllocatePage( BtU32 size );
+
+	const BtChar*					m_name;
+	BtMemoryTag						m_tag;
+	BtU32							m_firstPageSize;
+	BtU32							m_alignment;
+	BtU32							m_maxPages;
+
+	BtU8*							m_pPages[MaxPagedHeapPages];
+	BtU32							m_pageSize[MaxPagedHeapPages];
+	BtU32							m_numPages;
+	BtU32							m_currentPage;
+	BtU32							m_offset;						// Into the current page
+	BtU32							m_bytesUsed;
+	BtU32							m_numAllocations;
+	BtU32							m_capacity;
+	BtU32							m_numGrowths;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate
+
+inline BtU8* BtPagedHeap::Allocate( BtU32 size )
+{
+	size = ( size + m_alignment - 1 ) & ~( m_alignment - 1 );
+
+	// Only moving on to another page leaves the inline path
+	if( ( m_numPages == 0 ) || ( m_offset + size > m_pageSize[m_currentPage] ) )
+	{
+		return AllocatePage( size );
+	}
+
+	BtU8 *pMemory = m_pPages[m_currentPage] + m_offset;
+
+	m_offset += size;
+	m_bytesUsed += size;
+	++m_numAllocations;
+
+	return pMemory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetBytesUsed
+
+inline BtU32 BtPagedHeap::GetBytesUsed() const
+{
+	return m_bytesUsed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumAllocations
+
+inline BtU32 BtPagedHeap::GetNumAllocations() const
+{
+	return m_numAllocations;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetCapacity
+
+inline BtU32 BtPagedHeap::GetCapacity() const
+{
+	return m_capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumPages
+
+inline BtU32 BtPagedHeap::GetNumPages() const
+{
+	return m_numPages;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumGrowths
+
+inline BtU32 BtPagedHeap::GetNumGrowths() const
+{
+	return m_numGrowths;
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtProfiler.h
+
+#pragma once
+#include "BtTypes.h"
+
+const BtU32 MaxProfileThreads = 16;
+const BtU32 MaxProfileEvents = 16384;				// Per thread, per capture
+const BtU32 MaxProfileDepth = 32;
+
+struct BtProfileEvent
+{
+	const BtChar*				m_name;				// Must outlive the capture. Use string literals
+	BtU64						m_start;
+	BtU64						m_end;
+	BtU32						m_depth;
+	BtU32						m_frame;
+	BtS64						m_value;			// Counters only
+	BtBool						m_isCounter;
+};
+
+// Markers cost a thread local read and a branch until a capture is running.
+// A capture records every thread for a number of frames and can then be
+// written out as Chrome trace event JSON (load it in chrome://tracing)
+class BtProfiler
+{
+public:
+
+	// Call once per frame from the main thread
+	static void					BeginFrame();
+	static void					EndFrame();
+
+	// Markers. Prefer the BtProfile macro so Begin and End always pair up
+	static void					Begin( const BtChar* name );
+	static void					End();
+
+	// Record a value, e.g. memory in use, as a counter track in the trace
+	static void					Counter( const BtChar* name, BtS64 value );
+
+	// Name the calling thread in the trace
+	static void					SetThreadName( const BtChar* name );
+
+	// Give the calling thread's slot back for another thread. BtThread calls this as its
+	// thread exits. Other threads that record markers should call it before they exit
+	static void					EndThread();
+
+	// Record the next numFrames frames
+	static void					Capture( BtU32 numFrames );
+	static BtBool				IsCapturing();
+	static BtBool				IsCaptureReady();
+
+	// Write the finished capture as trace event JSON. This ends the capture
+	static BtBool				WriteTrace( const BtChar* filename );
+
+	// Accessors
+	static BtU32				GetNumDroppedEvents();
+};
+
+class BtProfileScope
+{
+public:
+
+	BtProfileScope( const BtChar* name )
+	{
+		BtProfiler::Begin( name );
+	}
+
+	~BtProfileScope()
+	{
+		BtProfiler::End();
+	}
+};
+
+#define BtProfileJoin2( a, b ) a##b
+#define BtProfileJoin( a, b ) BtProfileJoin2( a, b )
+#define BtProfile( name ) BtProfileScope BtProfileJoin( profileScope, __LINE__ )( name )
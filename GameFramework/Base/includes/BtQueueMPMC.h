@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtQueueMPMC.h
+
+#pragma once
+#include "BtBase.h"
+#include "BtTypes.h"
+#include "BtAtomic.h"
+
+// Lock free ring buffer for any number of producer and consumer threads.
+// Every slot carries a sequence number that says whose turn it is, so a push
+// or pop is a single compare and swap on the shared position.
+// MaxQueueSize must be a power of two. Nothing is allocated after construction
+template< class T, int MaxQueueSize> class BtQueueMPMC
+{
+public:
+
+	BtQueueMPMC();
+
+	BtBool							Push( const T& Data );
+	BtBool							Pop( T& Data );
+
+	// The count may be stale by the time it is used. It only includes items a Pop can
+	// return, so with one consumer that many Pops will succeed
+	BtBool							IsRoom() const;
+	BtU32							GetItemCount() const;
+	BtU32							GetMaxItems() const;
+
+private:
+
+	typedef char					SizeIsPowerOfTwo[ ( ( MaxQueueSize & ( MaxQueueSize - 1 ) ) == 0 ) ? 1 : -1 ];
+
+	struct BtQueueCell
+	{
+		volatile BtS32				m_sequence;
+		T							m_item;
+	};
+
+	// Producers and consumers each get their own cache line
+	volatile BtS32					m_enqueue;
+	BtU8							m_pad0[60];
+	volatile BtS32					m_dequeue;
+	BtU8							m_pad1[60];
+
+	BtQueueCell						m_queue[MaxQueueSize];
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Constructor
+
+template< class T, int MaxQueueSize > BtQueueMPMC< T, MaxQueueSize >::BtQueueMPMC()
+{
+	for( BtU32 i=0; i<(BtU32)MaxQueueSize; i++ )
+	{
+		m_queue[i].m_sequence = (BtS32)i;
+	}
+	m_enqueue = 0;
+	m_dequeue = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Push
+
+template< class T, int MaxQueueSize > BtBool BtQueueMPMC< T, MaxQueueSize >::Push( const T& Data )
+{
+	BtQueueCell* pCell;
+	BtU32 position = (BtU32)BtAtomicPeek( &m_enqueue );
+
+	while( 1 )
+	{
+		pCell = &m_queue[position & ( MaxQueueSize - 1 )];
+
+		BtU32 sequence = (BtU32)BtAtomicLoad( &pCell->m_sequence );
+		BtS32 difference = (BtS32)( sequence - position );
+
+		if( difference == 0 )
+		{
+			// The slot is free for this position. Claim it unless another producer got there first
+			if( BtAtomicCompareSwap( &m_enqueue, (BtS32)position, (BtS32)( position + 1 ) ) == BtTrue )
+			{
+				break;
+			}
+			position = (BtU32)BtAtomicPeek( &m_enqueue );
+		}
+		else if( difference < 0 )
+		{
+			// The consumer a lap behind hasn't emptied the slot. We're full
+			return BtFalse;
+		}
+		else
+		{
+			position = (BtU32)BtAtomicPeek( &m_enqueue );
+		}
+	}
+
+	pCell->m_item = Data;
+
+	// Tell consumers the slot holds the item for this position
+	BtAtomicStore( &pCell->m_sequence, (BtS32)( position + 1 ) );
+
+	return BtTrue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Pop
+
+template< class T, int MaxQueueSize > BtBool BtQueueMPMC< T, MaxQueueSize >::Pop( T& Data )
+{
+	BtQueueCell* pCell;
+	BtU32 position = (BtU32)BtAtomicPeek( &m_dequeue );
+
+	while( 1 )
+	{
+		pCell = &m_queue[position & ( MaxQueueSize - 1 )];
+
+		BtU32 sequence = (BtU32)BtAtomicLoad( &pCell->m_sequence );
+		BtS32 difference = (BtS32)( sequence - ( position + 1 ) );
+
+		if( difference == 0 )
+		{
+			if( BtAtomicCompareSwap( &m_dequeue, (BtS32)position, (BtS32)( position + 1 ) ) == BtTrue )
+			{
+				break;
+			}
+			position = (BtU32)BtAtomicPeek( &m_dequeue );
+		}
+		else if( difference < 0 )
+		{
+			// Nothing has been pushed for this position yet. We're empty
+			return BtFalse;
+		}
+		else
+		{
+			position = (BtU32)BtAtomicPeek( &m_dequeue );
+		}
+	}
+
+	Data = pCell->m_item;
+
+	// Free the slot for the producer one lap ahead
+	BtAtomicStore( &pCell->m_sequence, (BtS32)( position + MaxQueueSize ) );
+
+	return BtTrue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// IsRoom
+
+template< class T, int MaxQueueSize > BtBool BtQueueMPMC< T, MaxQueueSize >::IsRoom() const
+{
+	BtS32 dequeue = BtAtomicLoad( (volatile BtS32*)&m_dequeue );
+	BtS32 enqueue = BtAtomicLoad( (volatile BtS32*)&m_enqueue );
+
+	// Claimed slots count as taken whether or not their items have been written
+	return (BtS32)( (BtU32)enqueue - (BtU32)dequeue ) < MaxQueueSize;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GetItemCount
+
+template< class T, int MaxQueueSize > BtU32 BtQueueMPMC< T, MaxQueueSize >::GetItemCount() const
+{
+	BtU32 position = (BtU32)BtAtomicLoad( (volatile BtS32*)&m_dequeue );
+	BtU32 count = 0;
+
+	// Only count items that have been written, up to the first slot a producer has claimed
+	// but not filled. A single consumer can then pop as many items as this returns
+	while( count < (BtU32)MaxQueueSize )
+	{
+		const BtQueueCell& cell = m_queue[( position + count ) & ( MaxQueueSize - 1 )];
+
+		if( (BtU32)BtAtomicLoad( (volatile BtS32*)&cell.m_sequence ) != position + count + 1 )
+		{
+			break;
+		}
+		++count;
+	}
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GetMaxItems
+
+template< class T, int MaxQueueSize > BtU32 BtQueueMPMC< T, MaxQueueSize >::GetMaxItems() const
+{
+	return MaxQueueSize;
+}
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtQueueSPSC.h
+
+#pragma once
+#include "BtBase.h"
+#include "BtTypes.h"
+#include "BtAtomic.h"
+
+// Lock free ring buffer for one producer thread and one consumer thread.
+// MaxQueueSize must be a power of two. Nothing is allocated after construction
+template< class T, int MaxQueueSize> class BtQueueSPSC
+{
+public:
+
+	BtQueueSPSC();
+
+	// Producer
+	BtBool							Push( const T& Data );
+	BtBool							IsRoom() const;
+
+	// Consumer
+	BtBool							Pop( T& Data );
+	BtBool							Peek( T& Data ) const;
+
+	// Either thread. The count may be stale by the time it is used
+	BtU32							GetItemCount() const;
+	BtU32							GetMaxItems() const;
+
+private:
+
+	typedef char					SizeIsPowerOfTwo[ ( ( MaxQueueSize & ( MaxQueueSize - 1 ) ) == 0 ) ? 1 : -1 ];
+
+	// Each end sits on its own cache line so the two threads don't fight over it
+	volatile BtS32					m_head;				// Next item to pop
+	BtU8							m_pad0[60];
+	volatile BtS32					m_tail;				// Next free slot
+	BtU8							m_pad1[60];
+
+	T								m_queue[MaxQueueSize];
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Constructor
+
+template< class T, int MaxQueueSize > BtQueueSPSC< T, MaxQueueSize >::BtQueueSPSC()
+{
+	m_head = 0;
+	m_tail = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Push
+
+template< class T, int MaxQueueSize > BtBool BtQueueSPSC< T, MaxQueueSize >::Push( const T& Data )
+{
+	BtU32 tail = (BtU32)BtAtomicPeek( &m_tail );
+	BtU32 head = (BtU32)BtAtomicLoad( &m_head );
+
+	if( tail - head >= (BtU32)MaxQueueSize )
+	{
+		return BtFalse;
+	}
+
+	m_queue[tail & ( MaxQueueSize - 1 )] = Data;
+
+	// Publish the item only once it has been written
+	BtAtomicStore( &m_tail, (BtS32)( tail + 1 ) );
+
+	return BtTrue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Pop
+
+template< class T, int MaxQueueSize > BtBool BtQueueSPSC< T, MaxQueueSize >::Pop( T& Data )
+{
+	BtU32 head = (BtU32)BtAtomicPeek( &m_head );
+	BtU32 tail = (BtU32)BtAtomicLoad( &m_tail );
+
+	if( head == tail )
+	{
+		return BtFalse;
+	}
+
+	Data = m_queue[head & ( MaxQueueSize - 1 )];
+
+	// Hand the slot back to the producer once we have copied out of it
+	BtAtomicStore( &m_head, (BtS32)( head + 1 ) );
+
+	return BtTrue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Peek
+
+template< class T, int MaxQueueSize > BtBool BtQueueSPSC< T, MaxQueueSize >::Peek( T& Data ) const
+{
+	BtU32 head = (BtU32)BtAtomicPeek( (volatile BtS32*)&m_head );
+	BtU32 tail = (BtU32)BtAtomicLoad( (volatile BtS32*)&m_tail );
+
+	if( head == tail )
+	{
+		return BtFalse;
+	}
+
+	Data = m_queue[head & ( MaxQueueSize - 1 )];
+
+	return BtTrue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// IsRoom
+
+template< class T, int MaxQueueSize > BtBool BtQueueSPSC< T, MaxQueueSize >::IsRoom() const
+{
+	return GetItemCount() < (BtU32)MaxQueueSize;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GetItemCount
+
+template< class T, int MaxQueueSize > BtU32 BtQueueSPSC< T, MaxQueueSize >::GetItemCount() const
+{
+	BtU32 head = (BtU32)BtAtomicLoad( (volatile BtS32*)&m_head );
+	BtU32 tail = (BtU32)BtAtomicLoad( (volatile BtS32*)&m_tail );
+
+	return tail - head;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// GetMaxItems
+
+template< class T, int MaxQueueSize > BtU32 BtQueueSPSC< T, MaxQueueSize >::GetMaxItems() const
+{
+	return MaxQueueSize;
+}
@@ -3,6 +3,14 @@
 
 #pragma once
 #include "BtTypes.h"
+#include "BtAtomic.h"
+
+// Declares a variable with one copy per thread
+#ifdef WIN32
+#define BtThreadLocal __declspec( thread )
+#else
+#define BtThreadLocal __thread
+#endif
 
 enum eThreadPriority
 {
@@ -17,7 +25,8 @@ public:
 
 	// Constructor
 	BtThread();
-	
+	virtual ~BtThread();
+
 	virtual void				Create() = 0;
 	virtual void				Destroy() = 0;
 	virtual void				Update() = 0;
@@ -39,16 +48,29 @@ public:
 	BtU32						ThreadHandle();
 	BtU32						ThreadID();
 	BtU32						Priority();
+	BtBool						IsSuspended();
+
+	static BtU32				GetNumProcessors();
 
  private:
 	
 	BtU32						m_nThreadID;
 	BtU32						m_nThreadHandle;
+	void*						m_pHandle;				// pthread_t on POSIX platforms
 	eThreadPriority				m_ePriority;
 
-	volatile BtBool				m_bThreadEnded;
+	// Set by one thread and polled by another
+	volatile BtS32				m_bThreadEnded;
+	volatile BtS32				m_bSuspended;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+inline BtThread::~BtThread()
+{
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // ThreadID
 
@@ -78,7 +100,7 @@ inline BtU32 BtThread::Priority()
 
 inline void BtThread::IsEnded( BtBool isEnded )
 {
-	m_bThreadEnded = isEnded;
+	BtAtomicStore( &m_bThreadEnded, isEnded );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -86,7 +108,15 @@ inline void BtThread::IsEnded( BtBool isEnded )
 
 inline BtBool BtThread::IsEnded()
 {
-	return m_bThreadEnded;
+	return BtAtomicLoad( &m_bThreadEnded ) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsSuspended
+
+inline BtBool BtThread::IsSuspended()
+{
+	return BtAtomicLoad( &m_bSuspended ) != 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
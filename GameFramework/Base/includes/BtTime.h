@@ -15,6 +15,7 @@ class BtTime
 		static void					SetTick( BtFloat tick );
 		static BtFloat				GetElapsedTimeInMilliseconds();
 		static BtFloat				GetElapsedTimeInSeconds();
+		static BtU64				GetElapsedTimeInNanoseconds();
 		static BtU32				GetDay();
 		static BtU32				GetMonth();
 		static BtU32				GetYear();
@@ -5,6 +5,7 @@
 #include "MtPlane.h"
 #include "MtMatrix4.h"
 #include "MtVector3.h"
+#include "MtAABB.h"
 
 class RsFrustum
 {
@@ -15,9 +16,25 @@ public:
 	void			Set( const MtMatrix4& m4Transform );
 	BtBool			IsInside( const MtVector3& v3Position ) const;
 	BtBool			IsInside( const MtVector3& v3Position, BtFloat radius ) const;
+	BtBool			IsInside( const MtAABB& AABB ) const;
+
+	// Test many spheres at once, four at a time with SSE or NEON where we have them. The
+	// bounds are passed as an array per component. Each result matches the single test
+	void			IsInside( const BtFloat* pX, const BtFloat* pY, const BtFloat* pZ, const BtFloat* pRadius,
+							  BtU32 count, BtBool* pIsInside ) const;
+
+	// The same for boxes given by their centres and half extents. Each result matches the
+	// single test of the box the centre and half extent were taken from
+	void			IsInside( const BtFloat* pCenterX, const BtFloat* pCenterY, const BtFloat* pCenterZ,
+							  const BtFloat* pExtentX, const BtFloat* pExtentY, const BtFloat* pExtentZ,
+							  BtU32 count, BtBool* pIsInside ) const;
+
+	// Turn off to test batches one at a time, e.g. to compare the two
+	static void		SetSimd( BtBool isEnabled );
 
 private:
 
+	BtBool			IsBoxInside( const MtVector3& v3Center, const MtVector3& v3Extent ) const;
 	MtVector3		GetNearestPointOnFrustum( const MtVector3& v3Position ) const;
 	
 	MtPlane			m_frustumPlanes[6];
@@ -77,6 +77,8 @@ struct SgMeshRenderable : BtLinkedListItem<SgMeshRenderable>
 	RsRenderTarget						   *m_pRenderTarget;
 	SgMesh                                 *m_pMesh;
 	BaMaterialBlockFileData*				m_pMaterialBlock;
+	BtU32									m_nStartRenderBlock;		// The level of detail being drawn
+	BtU32									m_nEndRenderBlock;
 
 	RsColour								m_ambient;
 	MtVector3								m_v3DirectionalLight;
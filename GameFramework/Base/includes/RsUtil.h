@@ -8,6 +8,7 @@
 #include "RsColour.h"
 #include "RsCaps.h"
 #include "RsRenderTarget.h"
+#include "BtJobSystem.h"
 
 #ifndef GL_BUFFER_OFFSET
 #define GL_BUFFER_OFFSET(i)((char *)NULL + (i))
@@ -32,6 +33,12 @@ public:
 	static void*							GetHandle();
 	static void								EmptyRenderTargets();
 
+	// Calls function over [0, count) in ranges of at most grainSize, spread across the
+	// job system. Use it to render large numbers of nodes. Renderables are added in the
+	// same order as calling the function over the whole range would add them. The
+	// function must not change the current render target or shader
+	static void								RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext );
+
 	// Accessors
 	static RsRenderTarget				   *GetNewRenderTarget();
 
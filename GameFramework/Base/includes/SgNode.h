@@ -49,6 +49,11 @@ public:
 	virtual const BtChar*		pName() const = 0;
 	virtual BtBool				HasChildren() const = 0;
 	virtual SgNode*				pFind( const BtChar* pName ) = 0;
+
+	// Find meshes below this node by their world bounds. The mesh the line enters first,
+	// and the meshes that overlap a sphere up to maxNodes of them
+	virtual SgNode*				pPick( const MtVector3& v3From, const MtVector3& v3To ) = 0;
+	virtual BtU32				FindNear( const MtVector3& v3Position, BtFloat radius, SgNode** ppNodes, BtU32 maxNodes ) = 0;
 	virtual SgNode*				pParent() const = 0;
 	virtual SgNode*				pFirstChild() const = 0;
 	virtual SgNode*				pNextSibling() const = 0;
@@ -70,6 +75,10 @@ public:
 	virtual void				SetForceRendered( BtBool enabled ) = 0;
 	virtual BtBool				IsRendered() const = 0;
 
+	// Occluders are meshes drawn into the occlusion buffer. Meshes hidden behind them aren't rendered
+	virtual void				SetOccluder( BtBool isOccluder ) = 0;
+	virtual BtBool				IsOccluder() const = 0;
+
 	//
 
 	// Node functionality				 
@@ -8,6 +8,7 @@
 #include "DyImpl.h"
 #include "DyWorld.h"
 #include "BtTime.h"
+#include "BtProfiler.h"
 #include "ApConfig.h"
 #include "DyBody.h"
 
@@ -69,6 +70,8 @@ void DyWorld::Create()
 //static
 void DyWorld::Update()
 {
+	BtProfile( "DyWorld::Update" );
+
  	BtBool m_paused = ApConfig::IsPaused();// && DyImpl::IsPaused();
 
 	BtAssert( m_pDynamicsWorld != NULL );
@@ -23,6 +23,18 @@
 #include "ShKeyboard.h"
 #include "FsFile.h"
 #include "UiKeyboardImpl.h"
+#include "BaArchiveLoader.h"
+#include "BtJobSystem.h"
+#include "BtProfiler.h"
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsVertexBufferImpl.h"
+#include "RsShaderImpl.h"
+#include "RsFrustum.h"
+#include "SgNodeImpl.h"
+#include "SgMeshImpl.h"
+#include "SgOcclusionImpl.h"
 
 //#pragma comment(lib, "XInput.lib") // Library containing necessary 360
 
@@ -34,6 +46,12 @@ BtFloat	m_frameRemainder;
 BtFloat	m_lastGameLogic;
 BtS32 m_width, m_height;
 HANDLE g_mutex;
+BtBool m_isHeadless = BtFalse;
+BtU32 m_maxFrames = 0;
+BtU32 m_numWorkers = 0;
+
+// Frames recorded when F12 is pressed
+const BtU32 ProfileCaptureFrames = 60;
 
 void GameUpdate();
 
@@ -253,6 +271,102 @@ void Game::Create(GaProject *pProject)
 	ApConfig::SetPlatform( ApPlatform_WinGL );
 	ApConfig::SetDevice( ApDevice_WIN );
 
+	// -nullrender runs the renderer without a window or GPU. -frames N quits after N frames.
+	// -nostream reallocates the vertex buffer for every draw, -nobatch draws every
+	// renderable on its own, -nostatecache sends every state change to the device,
+	// -nosort draws meshes in the order they were added, -novao sets up mesh attributes
+	// for every draw, -noinstancing draws every mesh on its own, -noshadercache compiles
+	// every shader program as it loads, -nosimd culls meshes one at a time, -notree
+	// culls and queries scenes by walking every node, -nolod draws every mesh at full
+	// detail, -noocclusion renders meshes hidden behind occluders, -noflatten updates
+	// every transform by walking the nodes and -nonametable finds nodes by comparing
+	// every name, as we used to, for comparison.
+	// -workers N sets the number of job system workers
+	const BtChar* commandLine = GetCommandLineA();
+	m_isHeadless = strstr( commandLine, "-nullrender" ) != BtNull;
+
+	const BtChar* frames = strstr( commandLine, "-frames" );
+	if( frames != BtNull )
+	{
+		m_maxFrames = atoi( frames + strlen( "-frames" ) );
+	}
+
+	const BtChar* workers = strstr( commandLine, "-workers" );
+	if( workers != BtNull )
+	{
+		m_numWorkers = atoi( workers + strlen( "-workers" ) );
+	}
+
+	if( m_isHeadless == BtTrue )
+	{
+		RsGL::SetBackend( RsBackend_Null );
+	}
+
+	if( strstr( commandLine, "-nostream" ) != BtNull )
+	{
+		RsImplWinGL::SetStreamRing( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nobatch" ) != BtNull )
+	{
+		RsRenderTargetWinGL::SetBatching( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nostatecache" ) != BtNull )
+	{
+		RsGL::SetStateCache( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nosort" ) != BtNull )
+	{
+		RsRenderTargetWinGL::SetSorting( BtFalse );
+	}
+
+	if( strstr( commandLine, "-novao" ) != BtNull )
+	{
+		RsVertexBufferImpl::SetVertexArrays( BtFalse );
+	}
+
+	if( strstr( commandLine, "-noinstancing" ) != BtNull )
+	{
+		RsRenderTargetWinGL::SetInstancing( BtFalse );
+	}
+
+	if( strstr( commandLine, "-noshadercache" ) != BtNull )
+	{
+		RsShaderImpl::SetProgramCache( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nosimd" ) != BtNull )
+	{
+		RsFrustum::SetSimd( BtFalse );
+	}
+
+	if( strstr( commandLine, "-notree" ) != BtNull )
+	{
+		SgNodeImpl::SetBoundsTree( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nolod" ) != BtNull )
+	{
+		SgMeshWinGL::SetLod( BtFalse );
+	}
+
+	if( strstr( commandLine, "-noocclusion" ) != BtNull )
+	{
+		SgOcclusionImpl::SetOcclusion( BtFalse );
+	}
+
+	if( strstr( commandLine, "-noflatten" ) != BtNull )
+	{
+		SgNodeImpl::SetFlatTransforms( BtFalse );
+	}
+
+	if( strstr( commandLine, "-nonametable" ) != BtNull )
+	{
+		SgNodeImpl::SetNameTable( BtFalse );
+	}
+
 	GLFWvidmode dvm;
 
 	// Count the number of instances of this program
@@ -298,33 +412,38 @@ void Game::Create(GaProject *pProject)
 	m_width = RsUtil::GetWidth();
 	m_height = RsUtil::GetHeight();
 
-	glfwOpenWindowHint(GLFW_WINDOW_NO_RESIZE, GL_TRUE);
+	int handle = 0;
 
-	// Create a window
-	if(!glfwOpenWindow(m_width, m_height, redBits, greenBits, blueBits, alphaBits, depthBits, stencilBits, GLFW_WINDOW))
+	if( m_isHeadless == BtFalse )
 	{
-		fprintf(stderr, "Failed to open GLFW window\n");
+		glfwOpenWindowHint(GLFW_WINDOW_NO_RESIZE, GL_TRUE);
 
-		glfwTerminate();
-		exit(EXIT_FAILURE);
-	}
+		// Create a window
+		if(!glfwOpenWindow(m_width, m_height, redBits, greenBits, blueBits, alphaBits, depthBits, stencilBits, GLFW_WINDOW))
+		{
+			fprintf(stderr, "Failed to open GLFW window\n");
 
-	// Set listeners
-	glfwSetWindowCloseCallback(windowCloseListener);
+			glfwTerminate();
+			exit(EXIT_FAILURE);
+		}
 
-	int width, height;
-	GetDesktopResolution(width, height);
-	glfwSetWindowPos((width / 2) - (RsUtil::GetWidth() / 2), (height / 2) - (RsUtil::GetHeight() / 2));
+		// Set listeners
+		glfwSetWindowCloseCallback(windowCloseListener);
 
-	GLenum nGlewError = glewInit();
-	if (nGlewError != GLEW_OK)
-	{
-		printf("%s - Error initializing GLEW! %s\n", __FUNCTION__, glewGetErrorString(nGlewError));
-		exit(EXIT_FAILURE);
-	}
+		int width, height;
+		GetDesktopResolution(width, height);
+		glfwSetWindowPos((width / 2) - (RsUtil::GetWidth() / 2), (height / 2) - (RsUtil::GetHeight() / 2));
 
-	// Cache the window handle
-	int handle = glfwGetWindowParam( -1 );
+		GLenum nGlewError = glewInit();
+		if (nGlewError != GLEW_OK)
+		{
+			printf("%s - Error initializing GLEW! %s\n", __FUNCTION__, glewGetErrorString(nGlewError));
+			exit(EXIT_FAILURE);
+		}
+
+		// Cache the window handle
+		handle = glfwGetWindowParam( -1 );
+	}
 
 	// Create the game mouse
 	m_gameMouse.Setup( (HWND)handle );
@@ -335,8 +454,16 @@ void Game::Create(GaProject *pProject)
 
 	SdSoundImpl::CreateManager();
 
+	// Create the job system. This thread is one of its workers
+	BtJobSystem::CreateManager( m_numWorkers );
+
+	// Create the background archive loader
+	BaArchiveLoader::CreateManager();
+
 	BtTime::Init();
 
+	BtProfiler::SetThreadName( "Main" );
+
 	//glfwOpenWindowHint( GLFW_REFRESH_RATE, 1.0f / 30.0f );
 	// Set the game window title
 	BtChar title[32];
@@ -348,8 +475,12 @@ void Game::Create(GaProject *pProject)
 		sprintf(instanceNum, "_%d", instances);
 		strcat(title, instanceNum);
 	}
-	glfwSetWindowTitle(title);
+	if( m_isHeadless == BtFalse )
+	{
+		glfwSetWindowTitle(title);
+	}
 
+	if( m_isHeadless == BtFalse )
 	{ // Read in the window position
 		int l, t;
 		FsFile windowPosIn;
@@ -365,29 +496,41 @@ void Game::Create(GaProject *pProject)
 		DeleteFile(title);
 	}
 
-	// Ensure we can capture the escape key being pressed below
-	glfwEnable(GLFW_STICKY_KEYS);
+	if( m_isHeadless == BtFalse )
+	{
+		// Ensure we can capture the escape key being pressed below
+		glfwEnable(GLFW_STICKY_KEYS);
+
+		// Enable vertical sync (on cards that support it)
+		//glfwSwapInterval(1);
 
-	// Enable vertical sync (on cards that support it)
-	//glfwSwapInterval(1);
+		// Hide the cursor
+		glfwDisable(GLFW_MOUSE_CURSOR);
 
-	// Hide the cursor
-	glfwDisable(GLFW_MOUSE_CURSOR);
+		glfwSetKeyCallback( key_callback );
+	}
 
-	glfwSetKeyCallback( key_callback );
+	BtU32 frameCount = 0;
+	BtU64 submitTime = 0;
+	BtU64 prepareTime = 0;
 
 	project->Create();
 	project->Reset();
 	do
 	{
 		// Get window size (may be different than the requested size)
-		glfwGetWindowSize(&m_width, &m_height);
+		if( m_isHeadless == BtFalse )
+		{
+			glfwGetWindowSize(&m_width, &m_height);
+		}
 
 		// Set the window size
-		glViewport(0, 0, m_width, m_height);
+		RsGL::Viewport(0, 0, m_width, m_height);
 
 		// Set the frame buffer to 0
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		RsGL::BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		BtProfiler::BeginFrame();
 
 		BtFloat dt = BtTime::GetTick();
 		BtFloat elapsedTime = BtTime::GetElapsedTimeInSeconds();
@@ -412,7 +555,10 @@ void Game::Create(GaProject *pProject)
 			input.Update();
 
 			// Update the game logic
-			GameUpdate();
+			{
+				BtProfile( "GameUpdate" );
+				GameUpdate();
+			}
 
 			// Remove the dt from the frame remainder
 			m_frameRemainder -= dt;
@@ -421,17 +567,78 @@ void Game::Create(GaProject *pProject)
 		if((isClosing == BtFalse) && (project->IsClosing() == BtFalse))
 		{
 			// Render
-			project->Render();
+			{
+				BtProfile( "GaProject::Render" );
+				BtU64 prepareStart = BtTime::GetElapsedTimeInNanoseconds();
+				project->Render();
+				prepareTime += BtTime::GetElapsedTimeInNanoseconds() - prepareStart;
+			}
 
 			// Render
+			BtU64 submitStart = BtTime::GetElapsedTimeInNanoseconds();
 			RsImpl::pInstance()->Render();
+			submitTime += BtTime::GetElapsedTimeInNanoseconds() - submitStart;
 		}
 
 		// Swap buffers
-		glfwSwapBuffers();
+		if( m_isHeadless == BtFalse )
+		{
+			BtProfile( "SwapBuffers" );
+			glfwSwapBuffers();
+		}
+
+		// Stop after a fixed number of frames when asked to, e.g. for benchmarks
+		++frameCount;
+		if( ( m_maxFrames > 0 ) && ( frameCount == m_maxFrames ) )
+		{
+			windowCloseListener();
+		}
+
+		BtProfiler::EndFrame();
+
+		// Write out a finished profile capture
+		if( BtProfiler::IsCaptureReady() == BtTrue )
+		{
+			BtProfiler::WriteTrace( "profile.json" );
+			ErrorLog::Printf( "Wrote profile.json. %d events dropped\n", BtProfiler::GetNumDroppedEvents() );
+		}
 	} // Check if the ESC key was pressed or the window was closed
 	while(project->IsClosed() == BtFalse);
 
+	if( m_isHeadless == BtTrue )
+	{
+		const RsGLStats& stats = RsGL::GetFrameStats();
+		ErrorLog::Printf( "Last frame: %d draw calls %d vertices %d state changes (%d redundant skipped) %d uploads %d bytes\n",
+						  stats.m_numDrawCalls,
+						  stats.m_numVertices,
+						  stats.m_numStateChanges,
+						  stats.m_numRedundantStateChanges,
+						  stats.m_numUploads,
+						  (BtU32)stats.m_bytesUploaded );
+		ErrorLog::Printf( "Render preparation: %.1f us per frame with %d job workers\n",
+						  ( prepareTime / 1000.0 ) / MtMax( frameCount, (BtU32)1 ),
+						  BtJobSystem::GetNumWorkers() );
+		ErrorLog::Printf( "Render submission: %.1f us per frame over %d frames\n",
+						  ( submitTime / 1000.0 ) / MtMax( frameCount, (BtU32)1 ),
+						  frameCount );
+
+		const SgOcclusionStats& occlusionStats = SgOcclusionImpl::pInstance()->GetFrameStats();
+		ErrorLog::Printf( "Occlusion: %d of %d meshes culled last frame, %d occluders with %d triangles drawn in %.1f us\n",
+						  occlusionStats.m_numCulled,
+						  occlusionStats.m_numTested,
+						  occlusionStats.m_numOccluders,
+						  occlusionStats.m_numTriangles,
+						  occlusionStats.m_rasteriseTime / 1000.0 );
+
+		const RsGraphicsHeapStats& heapStats = RsImpl::pInstance()->GetGraphicsHeapStats();
+		ErrorLog::Printf( "Graphics heap: %d bytes in %d allocations last frame, %d bytes high water, %d bytes in %d pages\n",
+						  heapStats.m_bytesUsed,
+						  heapStats.m_numAllocations,
+						  heapStats.m_highWater,
+						  heapStats.m_capacity,
+						  heapStats.m_numPages );
+	}
+	else
 	{
 		RECT r;
 		GetWindowRect((HWND)handle, &r);
@@ -447,6 +654,12 @@ void Game::Create(GaProject *pProject)
 		}
 	}
 
+	// Finish or cancel any background archive loads
+	BaArchiveLoader::DestroyManager();
+
+	// Stop the job workers
+	BtJobSystem::DestroyManager();
+
 	// Destroy the renderer
 	RsImpl::pInstance()->Destroy();
 
@@ -459,6 +672,9 @@ void Game::Create(GaProject *pProject)
 	// Destroy the project
 	project->Destroy();
 
+	// Report anything the project didn't free
+	BtMemory::ReportLeaks();
+
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
 
@@ -519,6 +735,12 @@ void GameUpdate()
 		}		
 	}
 
+	// Capture a profile of the next few frames
+	if( UiKeyboard::pInstance()->IsPressed( UiKeyCode_F12 ) )
+	{
+		BtProfiler::Capture( ProfileCaptureFrames );
+	}
+
 	ShTouch::Update();
 	ShJoystick::Update();
 	ShKeyboard::Update();
@@ -529,6 +751,9 @@ void GameUpdate()
 	//	project->SetClosing();
 	//}
 
+	// Create on the device any archives read in the background and call their callbacks
+	BaArchiveLoader::Update();
+
 	// Update
 	if( project->IsClosed() == BtFalse )
 	{
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+/// RsCommandBufferImpl.cpp
+
+#include "BtBase.h"
+#include "BtThread.h"
+#include "RsCommandBufferImpl.h"
+#include "RsRenderTargetImpl.h"
+
+// Size of the first page of each buffer
+const BtU32 CommandBufferPageSize = 1024 * 16;
+
+// Renderables hold matrices so keep every allocation aligned for them
+const BtU32 CommandBufferAlignment = 16;
+
+static BtThreadLocal RsCommandBufferImpl* g_pCurrent = BtNull;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+RsCommandBufferImpl::RsCommandBufferImpl()
+{
+	m_heap.Create( "RsCommandBufferImpl", BtMT_Render, CommandBufferPageSize, CommandBufferAlignment, MaxCommandBufferPages );
+	m_pFirstCommand = BtNull;
+	m_pLastCommand = BtNull;
+	m_numCommands = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy
+
+void RsCommandBufferImpl::Destroy()
+{
+	m_heap.Destroy();
+
+	Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reset
+
+void RsCommandBufferImpl::Reset()
+{
+	m_heap.Reset();
+	m_pFirstCommand = BtNull;
+	m_pLastCommand = BtNull;
+	m_numCommands = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add
+
+void RsCommandBufferImpl::Add( RsRenderTargetWinGL *pRenderTarget, BtU32 sortOrder, RsRenderCommandType type, void *pRenderable )
+{
+	RsRenderCommand *pCommand = (RsRenderCommand*)Allocate( sizeof( RsRenderCommand ) );
+	pCommand->m_pNext = BtNull;
+	pCommand->m_pRenderTarget = pRenderTarget;
+	pCommand->m_pRenderable = pRenderable;
+	pCommand->m_sortOrder = sortOrder;
+	pCommand->m_type = type;
+
+	if( m_pLastCommand == BtNull )
+	{
+		m_pFirstCommand = pCommand;
+	}
+	else
+	{
+		m_pLastCommand->m_pNext = pCommand;
+	}
+	m_pLastCommand = pCommand;
+
+	++m_numCommands;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Merge
+
+void RsCommandBufferImpl::Merge()
+{
+	// The render targets would record these again if we were still recording
+	BtAssert( g_pCurrent == BtNull );
+
+	for( RsRenderCommand *pCommand = m_pFirstCommand; pCommand != BtNull; pCommand = pCommand->m_pNext )
+	{
+		RsRenderTargetWinGL *pRenderTarget = pCommand->m_pRenderTarget;
+		BtU32 sortOrder = pCommand->m_sortOrder;
+
+		switch( pCommand->m_type )
+		{
+			case RsRenderCommand_Font:
+				pRenderTarget->Add( sortOrder, (RsFontRenderable*)pCommand->m_pRenderable );
+				break;
+
+			case RsRenderCommand_Texture:
+				pRenderTarget->Add( sortOrder, (RsTextureRenderable*)pCommand->m_pRenderable );
+				break;
+
+			case RsRenderCommand_Material:
+				pRenderTarget->Add( sortOrder, (RsMaterialRenderable*)pCommand->m_pRenderable );
+				break;
+
+			case RsRenderCommand_Sprite:
+				pRenderTarget->Add( sortOrder, (RsSpriteRenderable*)pCommand->m_pRenderable );
+				break;
+
+			case RsRenderCommand_Mesh:
+				pRenderTarget->Add( sortOrder, (SgMeshRenderable*)pCommand->m_pRenderable );
+				break;
+
+			case RsRenderCommand_Skin:
+				pRenderTarget->Add( sortOrder, (SgSkinRenderable*)pCommand->m_pRenderable );
+				break;
+
+			default:
+				BtAssert( 0 );
+				break;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetCurrent
+
+//static
+RsCommandBufferImpl* RsCommandBufferImpl::GetCurrent()
+{
+	return g_pCurrent;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetCurrent
+
+//static
+void RsCommandBufferImpl::SetCurrent( RsCommandBufferImpl *pCommandBuffer )
+{
+	g_pCurrent = pCommandBuffer;
+}
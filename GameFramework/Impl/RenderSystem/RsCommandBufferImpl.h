@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+/// RsCommandBufferImpl.h
+
+#pragma once
+#include "BtTypes.h"
+#include "BtPagedHeap.h"
+
+class RsRenderTargetWinGL;
+
+// Command buffers available to the jobs of one frame
+const BtU32 MaxCommandBuffers = 64;
+
+// Pages each buffer's memory can chain. Running out of these is fatal
+const BtU32 MaxCommandBufferPages = 16;
+
+enum RsRenderCommandType
+{
+	RsRenderCommand_Font,
+	RsRenderCommand_Texture,
+	RsRenderCommand_Material,
+	RsRenderCommand_Sprite,
+	RsRenderCommand_Mesh,
+	RsRenderCommand_Skin,
+};
+
+struct RsRenderCommand
+{
+	RsRenderCommand*					m_pNext;
+	RsRenderTargetWinGL*				m_pRenderTarget;
+	void*								m_pRenderable;
+	BtU32								m_sortOrder;
+	BtU32								m_type;
+};
+
+// Renderables made on a job go into the job's own command buffer rather than straight
+// into the render targets. The buffer also owns the memory for them so jobs never share
+// the graphics heap. Buffers are merged on the main thread in the order the work was
+// split up, so the render targets end up the same whichever thread ran each job
+class RsCommandBufferImpl
+{
+public:
+
+	RsCommandBufferImpl();
+
+	void								Destroy();
+
+	// Call once the frame's renderables have been drawn
+	void								Reset();
+
+	// Memory for a renderable. It lasts until Reset
+	BtU8*								Allocate( BtU32 size );
+
+	// Record adding a renderable to a render target
+	void								Add( RsRenderTargetWinGL *pRenderTarget, BtU32 sortOrder, RsRenderCommandType type, void *pRenderable );
+
+	// Add everything recorded to its render target in the order it was recorded
+	void								Merge();
+
+	// The buffer the calling thread is recording into, or null when it adds renderables directly
+	static RsCommandBufferImpl*			GetCurrent();
+	static void							SetCurrent( RsCommandBufferImpl *pCommandBuffer );
+
+	// Accessors
+	BtU32								GetNumCommands() const;
+	BtU32								GetBytesUsed() const;
+
+private:
+
+	BtPagedHeap							m_heap;
+
+	RsRenderCommand*					m_pFirstCommand;
+	RsRenderCommand*					m_pLastCommand;
+	BtU32								m_numCommands;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocate
+
+inline BtU8* RsCommandBufferImpl::Allocate( BtU32 size )
+{
+	return m_heap.Allocate( size );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumCommands
+
+inline BtU32 RsCommandBufferImpl::GetNumCommands() const
+{
+	return m_numCommands;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetBytesUsed
+
+inline BtU32 RsCommandBufferImpl::GetBytesUsed() const
+{
+	return m_heap.GetBytesUsed();
+}
@@ -0,0 +1,2091 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsGL.cpp
+
+// Includes
+#include <stdint.h>
+#include <string.h>
+#include "RsGL.h"
+#include "BtBase.h"
+#include "ErrorLog.h"
+#include "BtMemory.h"
+
+// ES2 has neither fences nor ranged mapping
+#if defined( GL_SYNC_GPU_COMMANDS_COMPLETE ) && defined( GL_MAP_WRITE_BIT )
+#define RS_GL_HAS_SYNC
+#endif
+
+// Vertex array objects are core from GL3 and an extension before that. OSX's legacy
+// context only has the Apple flavour so it goes without
+#if defined( GLEW_ARB_vertex_array_object ) || ( defined( GL_VERSION_3_0 ) && !defined( __APPLE__ ) )
+#define RS_GL_HAS_VERTEX_ARRAY
+#endif
+
+// Instanced draws are core from GL3.1 but per instance attributes need GL3.3
+#if defined( GL_VERSION_3_3 ) && !defined( __APPLE__ )
+#define RS_GL_HAS_INSTANCING
+#endif
+
+// Program binaries are core from GL4.1 and ES3
+#if ( defined( GL_VERSION_4_1 ) || defined( GL_ES_VERSION_3_0 ) ) && !defined( __APPLE__ )
+#define RS_GL_HAS_PROGRAM_BINARY
+#endif
+
+// Uniform buffers are core from GL3.1 and ES3
+#if ( defined( GL_VERSION_3_1 ) || defined( GL_ES_VERSION_3_0 ) ) && !defined( __APPLE__ )
+#define RS_GL_HAS_UNIFORM_BUFFER
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Statics
+
+RsBackend RsGL::m_backend = RsBackend_OpenGL;
+RsGLNullReflection* RsGL::m_pNullReflection = BtNull;
+BtBool RsGL::m_isCapturing = BtFalse;
+BtU32 RsGL::m_numCommands = 0;
+RsGLCommand RsGL::m_commands[MaxRsGLCommands];
+RsGLStats RsGL::m_stats;
+RsGLStats RsGL::m_frameStats;
+BtBool RsGL::m_isStateCache = BtTrue;
+
+static const BtChar* g_commandNames[RsGLCommand_Max] =
+{
+	"ActiveTexture",
+	"AttachShader",
+	"BindAttribLocation",
+	"BindBuffer",
+	"BindBufferRange",
+	"BindFramebuffer",
+	"BindRenderbuffer",
+	"BindTexture",
+	"BindVertexArray",
+	"BlendFunc",
+	"BufferData",
+	"BufferSubData",
+	"CheckFramebufferStatus",
+	"Clear",
+	"ClearColor",
+	"ClientWaitSync",
+	"CompileShader",
+	"CreateProgram",
+	"CreateShader",
+	"DeleteBuffers",
+	"DeleteSync",
+	"DeleteTextures",
+	"DeleteVertexArrays",
+	"DepthFunc",
+	"Disable",
+	"DisableVertexAttribArray",
+	"DrawArrays",
+	"DrawElements",
+	"DrawElementsInstanced",
+	"Enable",
+	"EnableVertexAttribArray",
+	"FenceSync",
+	"FramebufferRenderbuffer",
+	"FramebufferTexture2D",
+	"FrontFace",
+	"GenBuffers",
+	"GenFramebuffers",
+	"GenRenderbuffers",
+	"GenTextures",
+	"GenVertexArrays",
+	"GetActiveUniform",
+	"GetActiveUniformBlockiv",
+	"GetActiveUniformsiv",
+	"GetError",
+	"GetIntegerv",
+	"GetProgramBinary",
+	"GetProgramiv",
+	"GetShaderInfoLog",
+	"GetShaderiv",
+	"GetString",
+	"GetUniformBlockIndex",
+	"GetUniformLocation",
+	"LinkProgram",
+	"MapBufferRange",
+	"PixelStorei",
+	"ProgramBinary",
+	"ProgramParameteri",
+	"RenderbufferStorage",
+	"ShaderSource",
+	"TexImage2D",
+	"TexParameteri",
+	"Uniform1fv",
+	"Uniform1i",
+	"Uniform2fv",
+	"Uniform3fv",
+	"Uniform4fv",
+	"UniformBlockBinding",
+	"UniformMatrix4fv",
+	"UnmapBuffer",
+	"UseProgram",
+	"VertexAttribDivisor",
+	"VertexAttribPointer",
+	"Viewport",
+};
+
+// Names handed out by the null backend
+static GLuint g_nextName = 1;
+
+// Memory the null backend maps buffers to when the range isn't in the buffer's storage
+static BtU8* g_pNullMapping = BtNull;
+static BtU32 g_nullMappingSize = 0;
+
+// The null backend keeps what is written to each buffer so tests can read it back.
+// Buffers are indexed by name and bound per target
+struct LRsGLNullBuffer
+{
+	BtU8*							m_pData;
+	BtU32							m_size;
+};
+
+static LRsGLNullBuffer* g_pNullBuffers = BtNull;
+static BtU32 g_numNullBuffers = 0;
+static GLuint g_nullArrayBuffer = 0;
+static GLuint g_nullElementArrayBuffer = 0;
+static GLuint g_nullUniformBuffer = 0;
+
+// Nanoseconds to wait on a fence before flushing and trying again
+const BtU64 RsGLWaitTimeout = 1000000000;
+
+// A shadowed value that doesn't match anything GL could hold, so the next set goes through
+const BtU32 RsGLUnknown = 0xFFFFFFFF;
+
+// What we last sent the device
+struct LRsGLState
+{
+	BtU32							m_program;
+	BtU32							m_activeTexture;
+	BtU32							m_texture[MaxRsGLTextureUnits];
+	BtU32							m_arrayBuffer;
+	BtU32							m_elementArrayBuffer;
+	BtU32							m_isBlend;
+	BtU32							m_isDepthTest;
+	BtU32							m_isCullFace;
+	BtU32							m_blendFunc;
+	BtU32							m_depthFunc;
+	BtU32							m_frontFace;
+	BtU32							m_isVertexAttribArray[MaxRsGLVertexAttribs];
+	BtU32							m_vertexArray;
+};
+
+// Enabled attributes and the element buffer belong to the bound vertex array. We only
+// track them for the default one and keep them here while another is bound
+struct LRsGLVertexArrayState
+{
+	BtU32							m_elementArrayBuffer;
+	BtU32							m_isVertexAttribArray[MaxRsGLVertexAttribs];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLUnknownState
+
+static LRsGLState LRsGLUnknownState()
+{
+	LRsGLState state;
+	memset( &state, 0xFF, sizeof( LRsGLState ) );
+	return state;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLUnknownVertexArrayState
+
+static LRsGLVertexArrayState LRsGLUnknownVertexArrayState()
+{
+	LRsGLVertexArrayState state;
+	memset( &state, 0xFF, sizeof( LRsGLVertexArrayState ) );
+	return state;
+}
+
+static LRsGLState g_state = LRsGLUnknownState();
+static LRsGLVertexArrayState g_defaultVertexArray = LRsGLUnknownVertexArrayState();
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLGetCapState
+
+static BtU32* LRsGLGetCapState( GLenum cap )
+{
+	switch( cap )
+	{
+	case GL_BLEND:
+		return &g_state.m_isBlend;
+	case GL_DEPTH_TEST:
+		return &g_state.m_isDepthTest;
+	case GL_CULL_FACE:
+		return &g_state.m_isCullFace;
+	}
+	return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLGetBufferState
+
+static BtU32* LRsGLGetBufferState( GLenum target )
+{
+	switch( target )
+	{
+	case GL_ARRAY_BUFFER:
+		return &g_state.m_arrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER:
+		return &g_state.m_elementArrayBuffer;
+	}
+	return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLNewName
+
+static GLuint LRsGLNewName()
+{
+	return g_nextName++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLNewNames
+
+static void LRsGLNewNames( GLsizei n, GLuint* pNames )
+{
+	for( GLsizei i=0; i<n; i++ )
+	{
+		pNames[i] = LRsGLNewName();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLGetNullBound
+
+static GLuint* LRsGLGetNullBound( GLenum target )
+{
+	switch( target )
+	{
+	case GL_ARRAY_BUFFER:
+		return &g_nullArrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER:
+		return &g_nullElementArrayBuffer;
+#if defined( GL_UNIFORM_BUFFER )
+	case GL_UNIFORM_BUFFER:
+		return &g_nullUniformBuffer;
+#endif
+	}
+	return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLGetNullBuffer
+
+// The storage of the buffer bound to the target, or null if nothing is bound
+static LRsGLNullBuffer* LRsGLGetNullBuffer( GLenum target )
+{
+	GLuint* pBound = LRsGLGetNullBound( target );
+
+	if( ( pBound == BtNull ) || ( *pBound == 0 ) )
+	{
+		return BtNull;
+	}
+
+	GLuint buffer = *pBound;
+
+	if( buffer >= g_numNullBuffers )
+	{
+		BtU32 numBuffers = ( g_numNullBuffers * 2 > buffer ) ? g_numNullBuffers * 2 : buffer + 1;
+		LRsGLNullBuffer* pBuffers = (LRsGLNullBuffer*)BtMemory::Allocate( BtMT_Render, numBuffers * sizeof( LRsGLNullBuffer ) );
+
+		BtMemory::Set( pBuffers, 0, numBuffers * sizeof( LRsGLNullBuffer ) );
+
+		if( g_pNullBuffers != BtNull )
+		{
+			BtMemory::Copy( pBuffers, g_pNullBuffers, g_numNullBuffers * sizeof( LRsGLNullBuffer ) );
+			BtMemory::Free( g_pNullBuffers );
+		}
+		g_pNullBuffers = pBuffers;
+		g_numNullBuffers = numBuffers;
+	}
+	return &g_pNullBuffers[buffer];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLEmptyLog
+
+static void LRsGLEmptyLog( GLsizei bufSize, GLsizei* pLength, GLchar* pInfoLog )
+{
+	if( pLength != BtNull )
+	{
+		*pLength = 0;
+	}
+	if( ( pInfoLog != BtNull ) && ( bufSize > 0 ) )
+	{
+		pInfoLog[0] = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGLTextureSize
+
+static BtU32 LRsGLTextureSize( GLsizei width, GLsizei height, GLenum format, GLenum type )
+{
+	BtU32 numComponents = 4;
+
+	switch( format )
+	{
+	case GL_ALPHA:
+	case GL_LUMINANCE:
+	case GL_DEPTH_COMPONENT:
+		numComponents = 1;
+		break;
+	case GL_LUMINANCE_ALPHA:
+		numComponents = 2;
+		break;
+	case GL_RGB:
+		numComponents = 3;
+		break;
+	}
+
+	BtU32 componentSize = 1;
+
+	switch( type )
+	{
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+		componentSize = 2;
+		break;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:
+		componentSize = 4;
+		break;
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+		// Packed formats are one value per pixel
+		numComponents = 1;
+		componentSize = 2;
+		break;
+	}
+
+	return width * height * numComponents * componentSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetBackend
+
+//static
+void RsGL::SetBackend( RsBackend backend )
+{
+	m_backend = backend;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetBackend
+
+//static
+RsBackend RsGL::GetBackend()
+{
+	return m_backend;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetNullReflection
+
+//static
+void RsGL::SetNullReflection( RsGLNullReflection* pReflection )
+{
+	m_pNullReflection = pReflection;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsSyncSupported
+
+//static
+BtBool RsGL::IsSyncSupported()
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return BtTrue;
+	}
+#if defined( RS_GL_HAS_SYNC ) && defined( GLEW_ARB_sync )
+	// GLEW builds have the entry points but the driver may not
+	return ( GLEW_ARB_sync && GLEW_ARB_map_buffer_range ) ? BtTrue : BtFalse;
+#elif defined( RS_GL_HAS_SYNC )
+	return BtTrue;
+#else
+	return BtFalse;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetStateCache
+
+//static
+void RsGL::SetStateCache( BtBool isEnabled )
+{
+	m_isStateCache = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InvalidateState
+
+//static
+void RsGL::InvalidateState()
+{
+	g_state = LRsGLUnknownState();
+	g_defaultVertexArray = LRsGLUnknownVertexArrayState();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsRedundant
+
+// Returns true if the shadowed value already matches. Otherwise it records the value
+// and the caller goes on to set it
+//static
+BtBool RsGL::IsRedundant( BtU32 &shadow, BtU32 value )
+{
+	if( ( shadow == value ) && ( m_isStateCache == BtTrue ) )
+	{
+		m_stats.m_numRedundantStateChanges++;
+		return BtTrue;
+	}
+	shadow = value;
+	return BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindTextureUnit
+
+//static
+void RsGL::BindTextureUnit( BtU32 unit, GLuint texture )
+{
+	BtAssert( unit < MaxRsGLTextureUnits );
+
+	if( ( g_state.m_texture[unit] == texture ) && ( m_isStateCache == BtTrue ) )
+	{
+		m_stats.m_numRedundantStateChanges++;
+		return;
+	}
+	ActiveTexture( GL_TEXTURE0 + unit );
+	BindTexture( GL_TEXTURE_2D, texture );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetVertexAttribArrays
+
+//static
+void RsGL::SetVertexAttribArrays( BtU32 mask )
+{
+	if( IsVertexArraySupported() == BtTrue )
+	{
+		BindVertexArray( 0 );
+	}
+
+	for( BtU32 i=0; i<MaxRsGLVertexAttribs; i++ )
+	{
+		if( mask & ( 1 << i ) )
+		{
+			EnableVertexAttribArray( i );
+		}
+		else
+		{
+			DisableVertexAttribArray( i );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsVertexArraySupported
+
+//static
+BtBool RsGL::IsVertexArraySupported()
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return BtTrue;
+	}
+#if defined( RS_GL_HAS_VERTEX_ARRAY ) && defined( GLEW_ARB_vertex_array_object )
+	return ( GLEW_ARB_vertex_array_object || GLEW_VERSION_3_0 ) ? BtTrue : BtFalse;
+#elif defined( RS_GL_HAS_VERTEX_ARRAY )
+	return BtTrue;
+#else
+	return BtFalse;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsInstancingSupported
+
+//static
+BtBool RsGL::IsInstancingSupported()
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return BtTrue;
+	}
+#if defined( RS_GL_HAS_INSTANCING ) && defined( GLEW_VERSION_3_3 )
+	return GLEW_VERSION_3_3 ? BtTrue : BtFalse;
+#elif defined( RS_GL_HAS_INSTANCING )
+	return BtTrue;
+#else
+	return BtFalse;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsProgramBinarySupported
+
+//static
+BtBool RsGL::IsProgramBinarySupported()
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return BtTrue;
+	}
+#if defined( RS_GL_HAS_PROGRAM_BINARY ) && defined( GLEW_ARB_get_program_binary )
+	if( !GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1 )
+	{
+		return BtFalse;
+	}
+#endif
+#if defined( RS_GL_HAS_PROGRAM_BINARY )
+	// Drivers may support the entry points without offering any formats
+	GLint numFormats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+
+	return ( numFormats > 0 ) ? BtTrue : BtFalse;
+#else
+	return BtFalse;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsUniformBufferSupported
+
+//static
+BtBool RsGL::IsUniformBufferSupported()
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return BtTrue;
+	}
+#if defined( RS_GL_HAS_UNIFORM_BUFFER ) && defined( GLEW_ARB_uniform_buffer_object )
+	return ( GLEW_ARB_uniform_buffer_object || GLEW_VERSION_3_1 ) ? BtTrue : BtFalse;
+#elif defined( RS_GL_HAS_UNIFORM_BUFFER )
+	return BtTrue;
+#else
+	return BtFalse;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BeginCapture
+
+//static
+void RsGL::BeginCapture()
+{
+	m_numCommands = 0;
+	m_isCapturing = BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndCapture
+
+//static
+void RsGL::EndCapture()
+{
+	m_isCapturing = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsCapturing
+
+//static
+BtBool RsGL::IsCapturing()
+{
+	return m_isCapturing;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumCommands
+
+//static
+BtU32 RsGL::GetNumCommands()
+{
+	return m_numCommands;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetCommand
+
+//static
+const RsGLCommand& RsGL::GetCommand( BtU32 iCommand )
+{
+	BtAssert( iCommand < m_numCommands );
+	return m_commands[iCommand];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetCommandName
+
+//static
+const BtChar* RsGL::GetCommandName( BtU32 type )
+{
+	if( type < RsGLCommand_Max )
+	{
+		return g_commandNames[type];
+	}
+	return "Unknown";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PrintCapture
+
+//static
+void RsGL::PrintCapture()
+{
+	for( BtU32 iCommand=0; iCommand<m_numCommands; iCommand++ )
+	{
+		const RsGLCommand& command = m_commands[iCommand];
+
+		ErrorLog::Printf( "%5d %-24s %8x %8x %8x %8x %d\n",
+						  iCommand,
+						  GetCommandName( command.m_type ),
+						  command.m_args[0],
+						  command.m_args[1],
+						  command.m_args[2],
+						  command.m_args[3],
+						  command.m_bytes );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetBufferData
+
+//static
+const BtU8* RsGL::GetBufferData( GLuint buffer, BtU32 &size )
+{
+	size = 0;
+
+	if( ( m_backend != RsBackend_Null ) || ( buffer >= g_numNullBuffers ) )
+	{
+		return BtNull;
+	}
+	size = g_pNullBuffers[buffer].m_size;
+
+	return g_pNullBuffers[buffer].m_pData;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndFrame
+
+//static
+void RsGL::EndFrame()
+{
+	m_frameStats = m_stats;
+	memset( &m_stats, 0, sizeof( RsGLStats ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetFrameStats
+
+//static
+const RsGLStats& RsGL::GetFrameStats()
+{
+	return m_frameStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Record
+
+//static
+void RsGL::Record( RsGLCommandType type, RsGLCategory category, BtU32 arg0, BtU32 arg1, BtU32 arg2, BtU32 bytes, BtU32 arg3 )
+{
+	switch( category )
+	{
+	case RsGLCategory_State:
+		m_stats.m_numStateChanges++;
+		break;
+	case RsGLCategory_Draw:
+		m_stats.m_numDrawCalls++;
+		m_stats.m_numVertices += arg1;
+		break;
+	case RsGLCategory_Upload:
+		m_stats.m_numUploads++;
+		break;
+	case RsGLCategory_Resource:
+		m_stats.m_numResourceCalls++;
+		break;
+	case RsGLCategory_Query:
+		break;
+	}
+	m_stats.m_bytesUploaded += bytes;
+
+	if( ( m_isCapturing == BtTrue ) && ( m_numCommands < MaxRsGLCommands ) )
+	{
+		RsGLCommand& command = m_commands[m_numCommands++];
+		command.m_type = type;
+		command.m_args[0] = arg0;
+		command.m_args[1] = arg1;
+		command.m_args[2] = arg2;
+		command.m_args[3] = arg3;
+		command.m_bytes = bytes;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ActiveTexture
+
+//static
+void RsGL::ActiveTexture( GLenum texture )
+{
+	if( IsRedundant( g_state.m_activeTexture, (BtU32)texture ) == BtTrue )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_ActiveTexture, RsGLCategory_State, (BtU32)texture, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glActiveTexture( texture );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AttachShader
+
+//static
+void RsGL::AttachShader( GLuint program, GLuint shader )
+{
+	Record( RsGLCommand_AttachShader, RsGLCategory_Resource, (BtU32)program, (BtU32)shader, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		if( m_pNullReflection != BtNull )
+		{
+			m_pNullReflection->AttachShader( program, shader );
+		}
+		return;
+	}
+	glAttachShader( program, shader );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindAttribLocation
+
+//static
+void RsGL::BindAttribLocation( GLuint program, GLuint index, const GLchar* name )
+{
+	Record( RsGLCommand_BindAttribLocation, RsGLCategory_Resource, (BtU32)program, (BtU32)index, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindAttribLocation( program, index, name );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindBuffer
+
+//static
+void RsGL::BindBuffer( GLenum target, GLuint buffer )
+{
+	GLuint* pNullBound = LRsGLGetNullBound( target );
+
+	if( pNullBound != BtNull )
+	{
+		*pNullBound = buffer;
+	}
+
+	BtU32* pShadow = LRsGLGetBufferState( target );
+
+	if( ( pShadow != BtNull ) && ( IsRedundant( *pShadow, (BtU32)buffer ) == BtTrue ) )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_BindBuffer, RsGLCategory_State, (BtU32)target, (BtU32)buffer, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindBuffer( target, buffer );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindBufferRange
+
+//static
+void RsGL::BindBufferRange( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size )
+{
+	Record( RsGLCommand_BindBufferRange, RsGLCategory_State, (BtU32)index, (BtU32)buffer, (BtU32)offset, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_UNIFORM_BUFFER )
+		glBindBufferRange( target, index, buffer, offset, size );
+#else
+		BtUnusedVariable( target );
+		BtUnusedVariable( size );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindFramebuffer
+
+//static
+void RsGL::BindFramebuffer( GLenum target, GLuint framebuffer )
+{
+	Record( RsGLCommand_BindFramebuffer, RsGLCategory_State, (BtU32)target, (BtU32)framebuffer, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindFramebuffer( target, framebuffer );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindRenderbuffer
+
+//static
+void RsGL::BindRenderbuffer( GLenum target, GLuint renderbuffer )
+{
+	Record( RsGLCommand_BindRenderbuffer, RsGLCategory_State, (BtU32)target, (BtU32)renderbuffer, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindRenderbuffer( target, renderbuffer );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindTexture
+
+//static
+void RsGL::BindTexture( GLenum target, GLuint texture )
+{
+	BtU32 unit = g_state.m_activeTexture - GL_TEXTURE0;
+
+	if( ( target == GL_TEXTURE_2D ) && ( unit < MaxRsGLTextureUnits ) )
+	{
+		if( IsRedundant( g_state.m_texture[unit], (BtU32)texture ) == BtTrue )
+		{
+			return;
+		}
+	}
+
+	Record( RsGLCommand_BindTexture, RsGLCategory_State, (BtU32)target, (BtU32)texture, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindTexture( target, texture );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BindVertexArray
+
+//static
+void RsGL::BindVertexArray( GLuint array )
+{
+	BtU32 previous = g_state.m_vertexArray;
+
+	if( IsRedundant( g_state.m_vertexArray, (BtU32)array ) == BtTrue )
+	{
+		return;
+	}
+
+	// Swap the shadowed per vertex array state
+	if( previous == 0 )
+	{
+		g_defaultVertexArray.m_elementArrayBuffer = g_state.m_elementArrayBuffer;
+		memcpy( g_defaultVertexArray.m_isVertexAttribArray, g_state.m_isVertexAttribArray, sizeof( g_state.m_isVertexAttribArray ) );
+	}
+
+	if( array == 0 )
+	{
+		g_state.m_elementArrayBuffer = g_defaultVertexArray.m_elementArrayBuffer;
+		memcpy( g_state.m_isVertexAttribArray, g_defaultVertexArray.m_isVertexAttribArray, sizeof( g_state.m_isVertexAttribArray ) );
+	}
+	else
+	{
+		g_state.m_elementArrayBuffer = RsGLUnknown;
+		memset( g_state.m_isVertexAttribArray, 0xFF, sizeof( g_state.m_isVertexAttribArray ) );
+	}
+
+	Record( RsGLCommand_BindVertexArray, RsGLCategory_State, (BtU32)array, 0, 0, 0 );
+
+#if defined( RS_GL_HAS_VERTEX_ARRAY )
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBindVertexArray( array );
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlendFunc
+
+//static
+void RsGL::BlendFunc( GLenum sfactor, GLenum dfactor )
+{
+	if( IsRedundant( g_state.m_blendFunc, ( (BtU32)sfactor << 16 ) | (BtU32)dfactor ) == BtTrue )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_BlendFunc, RsGLCategory_State, (BtU32)sfactor, (BtU32)dfactor, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glBlendFunc( sfactor, dfactor );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BufferData
+
+//static
+void RsGL::BufferData( GLenum target, GLsizeiptr size, const void* data, GLenum usage )
+{
+	Record( RsGLCommand_BufferData, RsGLCategory_Upload, (BtU32)target, (BtU32)size, (BtU32)usage, data ? (BtU32)size : 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNullBuffer* pBuffer = LRsGLGetNullBuffer( target );
+
+		if( pBuffer != BtNull )
+		{
+			// Fresh storage, as GL gives
+			if( pBuffer->m_size != (BtU32)size )
+			{
+				BtMemory::Free( pBuffer->m_pData );
+				pBuffer->m_pData = ( size > 0 ) ? BtMemory::Allocate( BtMT_Render, (BtU32)size ) : BtNull;
+				pBuffer->m_size = (BtU32)size;
+			}
+
+			if( data != BtNull )
+			{
+				BtMemory::Copy( pBuffer->m_pData, data, (BtU32)size );
+			}
+		}
+		return;
+	}
+	glBufferData( target, size, data, usage );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BufferSubData
+
+//static
+void RsGL::BufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void* data )
+{
+	Record( RsGLCommand_BufferSubData, RsGLCategory_Upload, (BtU32)target, (BtU32)offset, (BtU32)size, (BtU32)size );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNullBuffer* pBuffer = LRsGLGetNullBuffer( target );
+
+		if( ( pBuffer != BtNull ) && ( (BtU32)( offset + size ) <= pBuffer->m_size ) )
+		{
+			BtMemory::Copy( pBuffer->m_pData + offset, data, (BtU32)size );
+		}
+		return;
+	}
+	glBufferSubData( target, offset, size, data );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CheckFramebufferStatus
+
+//static
+GLenum RsGL::CheckFramebufferStatus( GLenum target )
+{
+	Record( RsGLCommand_CheckFramebufferStatus, RsGLCategory_Query, (BtU32)target, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+	return glCheckFramebufferStatus( target );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Clear
+
+//static
+void RsGL::Clear( GLbitfield mask )
+{
+	Record( RsGLCommand_Clear, RsGLCategory_State, (BtU32)mask, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glClear( mask );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ClearColor
+
+//static
+void RsGL::ClearColor( GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha )
+{
+	Record( RsGLCommand_ClearColor, RsGLCategory_State, 0, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glClearColor( red, green, blue, alpha );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ClientWaitSync
+
+//static
+void RsGL::ClientWaitSync( void* sync )
+{
+	Record( RsGLCommand_ClientWaitSync, RsGLCategory_Query, 0, 0, 0, 0 );
+
+#if defined( RS_GL_HAS_SYNC )
+	if( ( m_backend == RsBackend_OpenGL ) && ( sync != BtNull ) )
+	{
+		// Flush on the first wait so the fence can't sit in an unsubmitted command buffer forever
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+		while( glClientWaitSync( (GLsync)sync, flags, RsGLWaitTimeout ) == GL_TIMEOUT_EXPIRED )
+		{
+			flags = 0;
+		}
+	}
+#else
+	BtUnusedVariable( sync );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CompileShader
+
+//static
+void RsGL::CompileShader( GLuint shader )
+{
+	Record( RsGLCommand_CompileShader, RsGLCategory_Resource, (BtU32)shader, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glCompileShader( shader );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateProgram
+
+//static
+GLuint RsGL::CreateProgram()
+{
+	Record( RsGLCommand_CreateProgram, RsGLCategory_Resource, 0, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		return LRsGLNewName();
+	}
+	return glCreateProgram();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateShader
+
+//static
+GLuint RsGL::CreateShader( GLenum type )
+{
+	Record( RsGLCommand_CreateShader, RsGLCategory_Resource, (BtU32)type, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		return LRsGLNewName();
+	}
+	return glCreateShader( type );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DeleteBuffers
+
+//static
+void RsGL::DeleteBuffers( GLsizei n, const GLuint* buffers )
+{
+	// GL unbinds deleted buffers and the names can be handed out again
+	for( GLsizei i=0; i<n; i++ )
+	{
+		if( g_state.m_arrayBuffer == buffers[i] )
+		{
+			g_state.m_arrayBuffer = 0;
+		}
+		if( g_state.m_elementArrayBuffer == buffers[i] )
+		{
+			g_state.m_elementArrayBuffer = 0;
+		}
+		if( g_defaultVertexArray.m_elementArrayBuffer == buffers[i] )
+		{
+			g_defaultVertexArray.m_elementArrayBuffer = 0;
+		}
+
+		if( buffers[i] < g_numNullBuffers )
+		{
+			BtMemory::Free( g_pNullBuffers[buffers[i]].m_pData );
+			g_pNullBuffers[buffers[i]].m_pData = BtNull;
+			g_pNullBuffers[buffers[i]].m_size = 0;
+		}
+
+		if( g_nullArrayBuffer == buffers[i] )
+		{
+			g_nullArrayBuffer = 0;
+		}
+		if( g_nullElementArrayBuffer == buffers[i] )
+		{
+			g_nullElementArrayBuffer = 0;
+		}
+		if( g_nullUniformBuffer == buffers[i] )
+		{
+			g_nullUniformBuffer = 0;
+		}
+	}
+
+	Record( RsGLCommand_DeleteBuffers, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDeleteBuffers( n, buffers );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DeleteSync
+
+//static
+void RsGL::DeleteSync( void* sync )
+{
+	Record( RsGLCommand_DeleteSync, RsGLCategory_Resource, 0, 0, 0, 0 );
+
+#if defined( RS_GL_HAS_SYNC )
+	if( ( m_backend == RsBackend_OpenGL ) && ( sync != BtNull ) )
+	{
+		glDeleteSync( (GLsync)sync );
+	}
+#else
+	BtUnusedVariable( sync );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DeleteTextures
+
+//static
+void RsGL::DeleteTextures( GLsizei n, const GLuint* textures )
+{
+	for( GLsizei i=0; i<n; i++ )
+	{
+		for( BtU32 unit=0; unit<MaxRsGLTextureUnits; unit++ )
+		{
+			if( g_state.m_texture[unit] == textures[i] )
+			{
+				g_state.m_texture[unit] = 0;
+			}
+		}
+	}
+
+	Record( RsGLCommand_DeleteTextures, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDeleteTextures( n, textures );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DeleteVertexArrays
+
+//static
+void RsGL::DeleteVertexArrays( GLsizei n, const GLuint* arrays )
+{
+	// Deleting the bound array puts back the default one
+	for( GLsizei i=0; i<n; i++ )
+	{
+		if( ( arrays[i] != 0 ) && ( g_state.m_vertexArray == arrays[i] ) )
+		{
+			BindVertexArray( 0 );
+		}
+	}
+
+	Record( RsGLCommand_DeleteVertexArrays, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+#if defined( RS_GL_HAS_VERTEX_ARRAY )
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDeleteVertexArrays( n, arrays );
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DepthFunc
+
+//static
+void RsGL::DepthFunc( GLenum func )
+{
+	if( IsRedundant( g_state.m_depthFunc, (BtU32)func ) == BtTrue )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_DepthFunc, RsGLCategory_State, (BtU32)func, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDepthFunc( func );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Disable
+
+//static
+void RsGL::Disable( GLenum cap )
+{
+	BtU32* pShadow = LRsGLGetCapState( cap );
+
+	if( ( pShadow != BtNull ) && ( IsRedundant( *pShadow, 0 ) == BtTrue ) )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_Disable, RsGLCategory_State, (BtU32)cap, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDisable( cap );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DisableVertexAttribArray
+
+//static
+void RsGL::DisableVertexAttribArray( GLuint index )
+{
+	if( ( index < MaxRsGLVertexAttribs ) && ( IsRedundant( g_state.m_isVertexAttribArray[index], 0 ) == BtTrue ) )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_DisableVertexAttribArray, RsGLCategory_State, (BtU32)index, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDisableVertexAttribArray( index );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DrawArrays
+
+//static
+void RsGL::DrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+	Record( RsGLCommand_DrawArrays, RsGLCategory_Draw, (BtU32)mode, (BtU32)count, (BtU32)first, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDrawArrays( mode, first, count );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DrawElements
+
+//static
+void RsGL::DrawElements( GLenum mode, GLsizei count, GLenum type, const void* indices )
+{
+	Record( RsGLCommand_DrawElements, RsGLCategory_Draw, (BtU32)mode, (BtU32)count, (BtU32)type, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glDrawElements( mode, count, type, indices );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DrawElementsInstanced
+
+//static
+void RsGL::DrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount )
+{
+	Record( RsGLCommand_DrawElementsInstanced, RsGLCategory_Draw, (BtU32)mode, (BtU32)count, (BtU32)instancecount, 0 );
+
+	// Record counted one instance's worth
+	m_stats.m_numVertices += count * ( instancecount - 1 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_INSTANCING )
+		glDrawElementsInstanced( mode, count, type, indices, instancecount );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Enable
+
+//static
+void RsGL::Enable( GLenum cap )
+{
+	BtU32* pShadow = LRsGLGetCapState( cap );
+
+	if( ( pShadow != BtNull ) && ( IsRedundant( *pShadow, 1 ) == BtTrue ) )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_Enable, RsGLCategory_State, (BtU32)cap, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glEnable( cap );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EnableVertexAttribArray
+
+//static
+void RsGL::EnableVertexAttribArray( GLuint index )
+{
+	if( ( index < MaxRsGLVertexAttribs ) && ( IsRedundant( g_state.m_isVertexAttribArray[index], 1 ) == BtTrue ) )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_EnableVertexAttribArray, RsGLCategory_State, (BtU32)index, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glEnableVertexAttribArray( index );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FenceSync
+
+//static
+void* RsGL::FenceSync()
+{
+	Record( RsGLCommand_FenceSync, RsGLCategory_Resource, 0, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		// Any non null handle will do. Waits and deletes ignore it
+		return &g_nextName;
+	}
+#if defined( RS_GL_HAS_SYNC )
+	return (void*)glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+#else
+	return BtNull;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FramebufferRenderbuffer
+
+//static
+void RsGL::FramebufferRenderbuffer( GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer )
+{
+	Record( RsGLCommand_FramebufferRenderbuffer, RsGLCategory_Resource, (BtU32)target, (BtU32)attachment, (BtU32)renderbuffer, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glFramebufferRenderbuffer( target, attachment, renderbuffertarget, renderbuffer );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FramebufferTexture2D
+
+//static
+void RsGL::FramebufferTexture2D( GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level )
+{
+	Record( RsGLCommand_FramebufferTexture2D, RsGLCategory_Resource, (BtU32)target, (BtU32)attachment, (BtU32)texture, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glFramebufferTexture2D( target, attachment, textarget, texture, level );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FrontFace
+
+//static
+void RsGL::FrontFace( GLenum mode )
+{
+	if( IsRedundant( g_state.m_frontFace, (BtU32)mode ) == BtTrue )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_FrontFace, RsGLCategory_State, (BtU32)mode, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glFrontFace( mode );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GenBuffers
+
+//static
+void RsGL::GenBuffers( GLsizei n, GLuint* buffers )
+{
+	Record( RsGLCommand_GenBuffers, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNewNames( n, buffers );
+		return;
+	}
+	glGenBuffers( n, buffers );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GenFramebuffers
+
+//static
+void RsGL::GenFramebuffers( GLsizei n, GLuint* framebuffers )
+{
+	Record( RsGLCommand_GenFramebuffers, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNewNames( n, framebuffers );
+		return;
+	}
+	glGenFramebuffers( n, framebuffers );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GenRenderbuffers
+
+//static
+void RsGL::GenRenderbuffers( GLsizei n, GLuint* renderbuffers )
+{
+	Record( RsGLCommand_GenRenderbuffers, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNewNames( n, renderbuffers );
+		return;
+	}
+	glGenRenderbuffers( n, renderbuffers );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GenTextures
+
+//static
+void RsGL::GenTextures( GLsizei n, GLuint* textures )
+{
+	Record( RsGLCommand_GenTextures, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNewNames( n, textures );
+		return;
+	}
+	glGenTextures( n, textures );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GenVertexArrays
+
+//static
+void RsGL::GenVertexArrays( GLsizei n, GLuint* arrays )
+{
+	Record( RsGLCommand_GenVertexArrays, RsGLCategory_Resource, (BtU32)n, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNewNames( n, arrays );
+		return;
+	}
+#if defined( RS_GL_HAS_VERTEX_ARRAY )
+	glGenVertexArrays( n, arrays );
+#else
+	for( GLsizei i=0; i<n; i++ )
+	{
+		arrays[i] = 0;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetActiveUniform
+
+//static
+void RsGL::GetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		if( m_pNullReflection != BtNull )
+		{
+			m_pNullReflection->GetActiveUniform( program, index, bufSize, length, size, type, name );
+			return;
+		}
+		LRsGLEmptyLog( bufSize, length, name );
+		*size = 0;
+		*type = 0;
+		return;
+	}
+	glGetActiveUniform( program, index, bufSize, length, size, type, name );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetActiveUniformBlockiv
+
+//static
+void RsGL::GetActiveUniformBlockiv( GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		*params = 0;
+		return;
+	}
+#if defined( RS_GL_HAS_UNIFORM_BUFFER )
+	glGetActiveUniformBlockiv( program, uniformBlockIndex, pname, params );
+#else
+	*params = 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetActiveUniformsiv
+
+//static
+void RsGL::GetActiveUniformsiv( GLuint program, GLsizei uniformCount, const GLuint* uniformIndices, GLenum pname, GLint* params )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		BtMemory::Set( params, 0, sizeof( GLint ) * uniformCount );
+#if defined( GL_UNIFORM_BLOCK_INDEX )
+		// The uniforms null reports are never in a block
+		if( pname == GL_UNIFORM_BLOCK_INDEX )
+		{
+			for( GLsizei i=0; i<uniformCount; i++ )
+			{
+				params[i] = -1;
+			}
+		}
+#endif
+		return;
+	}
+#if defined( RS_GL_HAS_UNIFORM_BUFFER )
+	glGetActiveUniformsiv( program, uniformCount, uniformIndices, pname, params );
+#else
+	BtUnusedVariable( uniformIndices );
+	BtMemory::Set( params, 0, sizeof( GLint ) * uniformCount );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetError
+
+//static
+GLenum RsGL::GetError()
+{
+	Record( RsGLCommand_GetError, RsGLCategory_Query, 0, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		return GL_NO_ERROR;
+	}
+	return glGetError();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetIntegerv
+
+//static
+void RsGL::GetIntegerv( GLenum pname, GLint* params )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		*params = 0;
+		return;
+	}
+	glGetIntegerv( pname, params );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramBinary
+
+//static
+void RsGL::GetProgramBinary( GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary )
+{
+	Record( RsGLCommand_GetProgramBinary, RsGLCategory_Resource, (BtU32)program, (BtU32)bufSize, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		// What the reflection needs, so a program loaded from the cache reports its uniforms too
+		*length = ( m_pNullReflection != BtNull ) ? m_pNullReflection->GetProgramBinary( program, bufSize, binary ) : 0;
+		*binaryFormat = 0;
+		return;
+	}
+#if defined( RS_GL_HAS_PROGRAM_BINARY )
+	glGetProgramBinary( program, bufSize, length, binaryFormat, binary );
+#else
+	BtUnusedVariable( binary );
+	*length = 0;
+	*binaryFormat = 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramiv
+
+//static
+void RsGL::GetProgramiv( GLuint program, GLenum pname, GLint* params )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		*params = ( pname == GL_LINK_STATUS ) ? GL_TRUE : 0;
+
+		if( ( pname == GL_ACTIVE_UNIFORMS ) && ( m_pNullReflection != BtNull ) )
+		{
+			*params = m_pNullReflection->GetNumUniforms( program );
+		}
+#if defined( RS_GL_HAS_PROGRAM_BINARY )
+		if( ( pname == GL_PROGRAM_BINARY_LENGTH ) && ( m_pNullReflection != BtNull ) )
+		{
+			*params = m_pNullReflection->GetProgramBinaryLength( program );
+		}
+#endif
+		return;
+	}
+	glGetProgramiv( program, pname, params );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetShaderInfoLog
+
+//static
+void RsGL::GetShaderInfoLog( GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLEmptyLog( bufSize, length, infoLog );
+		return;
+	}
+	glGetShaderInfoLog( shader, bufSize, length, infoLog );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetShaderiv
+
+//static
+void RsGL::GetShaderiv( GLuint shader, GLenum pname, GLint* params )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		*params = ( pname == GL_COMPILE_STATUS ) ? GL_TRUE : 0;
+		return;
+	}
+	glGetShaderiv( shader, pname, params );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetString
+
+//static
+const GLubyte* RsGL::GetString( GLenum name )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return (const GLubyte*)"Null";
+	}
+	return glGetString( name );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetUniformBlockIndex
+
+// Programs without the block, and every program on the null backend, return RsGLNoBlock
+//static
+GLuint RsGL::GetUniformBlockIndex( GLuint program, const GLchar* uniformBlockName )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		return RsGLNoBlock;
+	}
+#if defined( RS_GL_HAS_UNIFORM_BUFFER )
+	return glGetUniformBlockIndex( program, uniformBlockName );
+#else
+	return RsGLNoBlock;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetUniformLocation
+
+//static
+GLint RsGL::GetUniformLocation( GLuint program, const GLchar* name )
+{
+	if( m_backend == RsBackend_Null )
+	{
+		// Without reflection no name has a location
+		return ( m_pNullReflection != BtNull ) ? m_pNullReflection->GetUniformLocation( program, name ) : -1;
+	}
+	return glGetUniformLocation( program, name );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LinkProgram
+
+//static
+void RsGL::LinkProgram( GLuint program )
+{
+	Record( RsGLCommand_LinkProgram, RsGLCategory_Resource, (BtU32)program, 0, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		if( m_pNullReflection != BtNull )
+		{
+			m_pNullReflection->LinkProgram( program );
+		}
+		return;
+	}
+	glLinkProgram( program );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MapBufferRange
+
+//static
+void* RsGL::MapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+	Record( RsGLCommand_MapBufferRange, RsGLCategory_Upload, (BtU32)target, (BtU32)offset, (BtU32)length, (BtU32)length );
+
+	if( m_backend == RsBackend_Null )
+	{
+		LRsGLNullBuffer* pBuffer = LRsGLGetNullBuffer( target );
+
+		if( ( pBuffer != BtNull ) && ( (BtU32)( offset + length ) <= pBuffer->m_size ) )
+		{
+			return pBuffer->m_pData + offset;
+		}
+
+		// Hand back scratch memory so callers still do the work of filling it
+		if( (BtU32)length > g_nullMappingSize )
+		{
+			BtMemory::Free( g_pNullMapping );
+			g_pNullMapping = BtMemory::Allocate( BtMT_Render, (BtU32)length );
+			g_nullMappingSize = (BtU32)length;
+		}
+		return g_pNullMapping;
+	}
+#if defined( RS_GL_HAS_SYNC )
+	return glMapBufferRange( target, offset, length, access );
+#else
+	BtUnusedVariable( access );
+	return BtNull;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PixelStorei
+
+//static
+void RsGL::PixelStorei( GLenum pname, GLint param )
+{
+	Record( RsGLCommand_PixelStorei, RsGLCategory_State, (BtU32)pname, (BtU32)param, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glPixelStorei( pname, param );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ProgramBinary
+
+//static
+void RsGL::ProgramBinary( GLuint program, GLenum binaryFormat, const void* binary, GLsizei length )
+{
+	Record( RsGLCommand_ProgramBinary, RsGLCategory_Resource, (BtU32)program, (BtU32)binaryFormat, 0, (BtU32)length );
+
+	if( m_backend == RsBackend_Null )
+	{
+		if( m_pNullReflection != BtNull )
+		{
+			m_pNullReflection->ProgramBinary( program, binary, length );
+		}
+		return;
+	}
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_PROGRAM_BINARY )
+		glProgramBinary( program, binaryFormat, binary, length );
+#else
+		BtUnusedVariable( binary );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ProgramParameteri
+
+//static
+void RsGL::ProgramParameteri( GLuint program, GLenum pname, GLint value )
+{
+	Record( RsGLCommand_ProgramParameteri, RsGLCategory_State, (BtU32)program, (BtU32)pname, (BtU32)value, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_PROGRAM_BINARY )
+		glProgramParameteri( program, pname, value );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderbufferStorage
+
+//static
+void RsGL::RenderbufferStorage( GLenum target, GLenum internalformat, GLsizei width, GLsizei height )
+{
+	Record( RsGLCommand_RenderbufferStorage, RsGLCategory_Resource, (BtU32)internalformat, (BtU32)width, (BtU32)height, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glRenderbufferStorage( target, internalformat, width, height );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ShaderSource
+
+//static
+void RsGL::ShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length )
+{
+	Record( RsGLCommand_ShaderSource, RsGLCategory_Resource, (BtU32)shader, (BtU32)count, 0, 0 );
+
+	if( m_backend == RsBackend_Null )
+	{
+		if( m_pNullReflection != BtNull )
+		{
+			m_pNullReflection->ShaderSource( shader, count, string, length );
+		}
+		return;
+	}
+	glShaderSource( shader, count, string, length );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TexImage2D
+
+//static
+void RsGL::TexImage2D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels )
+{
+	Record( RsGLCommand_TexImage2D, RsGLCategory_Upload, (BtU32)level, (BtU32)width, (BtU32)height, (BtU32)( LRsGLTextureSize( width, height, format, type ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glTexImage2D( target, level, internalformat, width, height, border, format, type, pixels );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TexParameteri
+
+//static
+void RsGL::TexParameteri( GLenum target, GLenum pname, GLint param )
+{
+	Record( RsGLCommand_TexParameteri, RsGLCategory_State, (BtU32)target, (BtU32)pname, (BtU32)param, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glTexParameteri( target, pname, param );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniform1fv
+
+//static
+void RsGL::Uniform1fv( GLint location, GLsizei count, const GLfloat* value )
+{
+	Record( RsGLCommand_Uniform1fv, RsGLCategory_State, (BtU32)location, (BtU32)count, 0, (BtU32)( count * sizeof( GLfloat ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniform1fv( location, count, value );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniform1i
+
+//static
+void RsGL::Uniform1i( GLint location, GLint v0 )
+{
+	Record( RsGLCommand_Uniform1i, RsGLCategory_State, (BtU32)location, (BtU32)v0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniform1i( location, v0 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniform2fv
+
+//static
+void RsGL::Uniform2fv( GLint location, GLsizei count, const GLfloat* value )
+{
+	Record( RsGLCommand_Uniform2fv, RsGLCategory_State, (BtU32)location, (BtU32)count, 0, (BtU32)( count * 2 * sizeof( GLfloat ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniform2fv( location, count, value );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniform3fv
+
+//static
+void RsGL::Uniform3fv( GLint location, GLsizei count, const GLfloat* value )
+{
+	Record( RsGLCommand_Uniform3fv, RsGLCategory_State, (BtU32)location, (BtU32)count, 0, (BtU32)( count * 3 * sizeof( GLfloat ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniform3fv( location, count, value );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniform4fv
+
+//static
+void RsGL::Uniform4fv( GLint location, GLsizei count, const GLfloat* value )
+{
+	Record( RsGLCommand_Uniform4fv, RsGLCategory_State, (BtU32)location, (BtU32)count, 0, (BtU32)( count * 4 * sizeof( GLfloat ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniform4fv( location, count, value );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UniformBlockBinding
+
+//static
+void RsGL::UniformBlockBinding( GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding )
+{
+	Record( RsGLCommand_UniformBlockBinding, RsGLCategory_Resource, (BtU32)program, (BtU32)uniformBlockIndex, (BtU32)uniformBlockBinding, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_UNIFORM_BUFFER )
+		glUniformBlockBinding( program, uniformBlockIndex, uniformBlockBinding );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UniformMatrix4fv
+
+//static
+void RsGL::UniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat* value )
+{
+	Record( RsGLCommand_UniformMatrix4fv, RsGLCategory_State, (BtU32)location, (BtU32)count, 0, (BtU32)( count * 16 * sizeof( GLfloat ) ) );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUniformMatrix4fv( location, count, transpose, value );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UnmapBuffer
+
+//static
+void RsGL::UnmapBuffer( GLenum target )
+{
+	Record( RsGLCommand_UnmapBuffer, RsGLCategory_Resource, (BtU32)target, 0, 0, 0 );
+
+#if defined( RS_GL_HAS_SYNC )
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUnmapBuffer( target );
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UseProgram
+
+//static
+void RsGL::UseProgram( GLuint program )
+{
+	if( IsRedundant( g_state.m_program, (BtU32)program ) == BtTrue )
+	{
+		return;
+	}
+
+	Record( RsGLCommand_UseProgram, RsGLCategory_State, (BtU32)program, 0, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glUseProgram( program );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// VertexAttribDivisor
+
+//static
+void RsGL::VertexAttribDivisor( GLuint index, GLuint divisor )
+{
+	Record( RsGLCommand_VertexAttribDivisor, RsGLCategory_State, (BtU32)index, (BtU32)divisor, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+#if defined( RS_GL_HAS_INSTANCING )
+		glVertexAttribDivisor( index, divisor );
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// VertexAttribPointer
+
+//static
+void RsGL::VertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer )
+{
+	Record( RsGLCommand_VertexAttribPointer, RsGLCategory_State, (BtU32)index, (BtU32)size, (BtU32)stride, 0, (BtU32)(uintptr_t)pointer );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glVertexAttribPointer( index, size, type, normalized, stride, pointer );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Viewport
+
+//static
+void RsGL::Viewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+	Record( RsGLCommand_Viewport, RsGLCategory_State, (BtU32)width, (BtU32)height, 0, 0 );
+
+	if( m_backend == RsBackend_OpenGL )
+	{
+		glViewport( x, y, width, height );
+	}
+}
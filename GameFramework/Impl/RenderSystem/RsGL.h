@@ -0,0 +1,297 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsGL.h
+
+#pragma once
+#include "BtTypes.h"
+#include "RsPlatform.h"
+
+// Which device the render system talks to. The null backend touches no GPU at all so
+// the renderer can run headless, e.g. for benchmarks on machines without a GPU
+enum RsBackend
+{
+	RsBackend_OpenGL,
+	RsBackend_Null,
+};
+
+// One entry per wrapped GL entry point
+enum RsGLCommandType
+{
+	RsGLCommand_ActiveTexture,
+	RsGLCommand_AttachShader,
+	RsGLCommand_BindAttribLocation,
+	RsGLCommand_BindBuffer,
+	RsGLCommand_BindBufferRange,
+	RsGLCommand_BindFramebuffer,
+	RsGLCommand_BindRenderbuffer,
+	RsGLCommand_BindTexture,
+	RsGLCommand_BindVertexArray,
+	RsGLCommand_BlendFunc,
+	RsGLCommand_BufferData,
+	RsGLCommand_BufferSubData,
+	RsGLCommand_CheckFramebufferStatus,
+	RsGLCommand_Clear,
+	RsGLCommand_ClearColor,
+	RsGLCommand_ClientWaitSync,
+	RsGLCommand_CompileShader,
+	RsGLCommand_CreateProgram,
+	RsGLCommand_CreateShader,
+	RsGLCommand_DeleteBuffers,
+	RsGLCommand_DeleteSync,
+	RsGLCommand_DeleteTextures,
+	RsGLCommand_DeleteVertexArrays,
+	RsGLCommand_DepthFunc,
+	RsGLCommand_Disable,
+	RsGLCommand_DisableVertexAttribArray,
+	RsGLCommand_DrawArrays,
+	RsGLCommand_DrawElements,
+	RsGLCommand_DrawElementsInstanced,
+	RsGLCommand_Enable,
+	RsGLCommand_EnableVertexAttribArray,
+	RsGLCommand_FenceSync,
+	RsGLCommand_FramebufferRenderbuffer,
+	RsGLCommand_FramebufferTexture2D,
+	RsGLCommand_FrontFace,
+	RsGLCommand_GenBuffers,
+	RsGLCommand_GenFramebuffers,
+	RsGLCommand_GenRenderbuffers,
+	RsGLCommand_GenTextures,
+	RsGLCommand_GenVertexArrays,
+	RsGLCommand_GetActiveUniform,
+	RsGLCommand_GetActiveUniformBlockiv,
+	RsGLCommand_GetActiveUniformsiv,
+	RsGLCommand_GetError,
+	RsGLCommand_GetIntegerv,
+	RsGLCommand_GetProgramBinary,
+	RsGLCommand_GetProgramiv,
+	RsGLCommand_GetShaderInfoLog,
+	RsGLCommand_GetShaderiv,
+	RsGLCommand_GetString,
+	RsGLCommand_GetUniformBlockIndex,
+	RsGLCommand_GetUniformLocation,
+	RsGLCommand_LinkProgram,
+	RsGLCommand_MapBufferRange,
+	RsGLCommand_PixelStorei,
+	RsGLCommand_ProgramBinary,
+	RsGLCommand_ProgramParameteri,
+	RsGLCommand_RenderbufferStorage,
+	RsGLCommand_ShaderSource,
+	RsGLCommand_TexImage2D,
+	RsGLCommand_TexParameteri,
+	RsGLCommand_Uniform1fv,
+	RsGLCommand_Uniform1i,
+	RsGLCommand_Uniform2fv,
+	RsGLCommand_Uniform3fv,
+	RsGLCommand_Uniform4fv,
+	RsGLCommand_UniformBlockBinding,
+	RsGLCommand_UniformMatrix4fv,
+	RsGLCommand_UnmapBuffer,
+	RsGLCommand_UseProgram,
+	RsGLCommand_VertexAttribDivisor,
+	RsGLCommand_VertexAttribPointer,
+	RsGLCommand_Viewport,
+	RsGLCommand_Max,
+};
+
+enum RsGLCategory
+{
+	RsGLCategory_State,
+	RsGLCategory_Draw,
+	RsGLCategory_Upload,
+	RsGLCategory_Resource,
+	RsGLCategory_Query,
+};
+
+struct RsGLCommand
+{
+	BtU32								m_type;				// RsGLCommandType
+	BtU32								m_args[4];			// The interesting arguments. See RsGL.cpp for which
+	BtU32								m_bytes;			// Bytes sent to the device
+};
+
+struct RsGLStats
+{
+	BtU32								m_numDrawCalls;
+	BtU32								m_numVertices;		// Vertices or indices drawn
+	BtU32								m_numStateChanges;
+	BtU32								m_numUploads;
+	BtU32								m_numResourceCalls;
+	BtU64								m_bytesUploaded;
+	BtU32								m_numRedundantStateChanges;	// Calls the state cache kept from the device
+};
+
+const BtU32 MaxRsGLCommands = 65536;
+
+// State the cache shadows. Texture units and attributes beyond these always go through
+const BtU32 MaxRsGLTextureUnits = 8;
+const BtU32 MaxRsGLVertexAttribs = 8;
+
+// What GetUniformBlockIndex returns for a block the program doesn't have. This is
+// GL_INVALID_INDEX, which ES2 doesn't define
+const GLuint RsGLNoBlock = 0xFFFFFFFF;
+
+// The null backend has no shader compiler, so on its own its programs have no uniforms.
+// Tests that need them install reflection, which is given the shaders and answers for the
+// programs. A program binary is whatever the reflection needs to restore the program
+class RsGLNullReflection
+{
+public:
+
+	virtual								~RsGLNullReflection() {}
+
+	virtual void						ShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length ) = 0;
+	virtual void						AttachShader( GLuint program, GLuint shader ) = 0;
+	virtual void						LinkProgram( GLuint program ) = 0;
+	virtual GLint						GetNumUniforms( GLuint program ) = 0;
+	virtual void						GetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name ) = 0;
+	virtual GLint						GetUniformLocation( GLuint program, const GLchar* name ) = 0;
+	virtual GLsizei						GetProgramBinaryLength( GLuint program ) = 0;
+	virtual GLsizei						GetProgramBinary( GLuint program, GLsizei bufSize, void* binary ) = 0;
+	virtual void						ProgramBinary( GLuint program, const void* binary, GLsizei length ) = 0;
+};
+
+// Every GL call the render system makes goes through here. That gives us one place
+// to swap the device for the null backend and to count or record what we send it
+class RsGL
+{
+public:
+
+	// Call before the render system is created
+	static void							SetBackend( RsBackend backend );
+	static RsBackend					GetBackend();
+
+	// Null backend only. Null, the default, leaves programs without uniforms
+	static void							SetNullReflection( RsGLNullReflection* pReflection );
+
+	// Command capture
+	static void							BeginCapture();
+	static void							EndCapture();
+	static BtBool						IsCapturing();
+	static BtU32						GetNumCommands();
+	static const RsGLCommand&			GetCommand( BtU32 iCommand );
+	static const BtChar*				GetCommandName( BtU32 type );
+	static void							PrintCapture();
+
+	// Null backend only. What has been written to a buffer, so tests can read back what
+	// was drawn. Null for buffers with no storage
+	static const BtU8*					GetBufferData( GLuint buffer, BtU32 &size );
+
+	// Fences and ranged buffer mapping. ES2 has neither
+	static BtBool						IsSyncSupported();
+
+	// Vertex array objects. Without them attributes are set up for every draw
+	static BtBool						IsVertexArraySupported();
+
+	// Instanced draws and per instance attributes. GL3.3, or ES3 and up
+	static BtBool						IsInstancingSupported();
+
+	// Saving and loading linked programs. GL4.1, or ES3 and up, with at least one binary format
+	static BtBool						IsProgramBinarySupported();
+
+	// Uniform blocks and buffers to back them. GL3.1, or ES3 and up
+	static BtBool						IsUniformBufferSupported();
+
+	// The state cache drops binds and enables that would not change anything. Invalidate
+	// it if anything other than RsGL may have touched GL state, e.g. a new context
+	static void							SetStateCache( BtBool isEnabled );
+	static void							InvalidateState();
+
+	// Binds a texture to a unit, selecting the unit only when the bind is needed
+	static void							BindTextureUnit( BtU32 unit, GLuint texture );
+
+	// Enables the vertex attributes in the mask and disables the rest. This is for
+	// attributes set up by hand so it puts back the default vertex array first
+	static void							SetVertexAttribArrays( BtU32 mask );
+
+	// Stats are counted whether or not we are capturing
+	static void							EndFrame();
+	static const RsGLStats&				GetFrameStats();
+
+	// GL. Fences are passed as void* since ES2 has no GLsync
+	static void						ActiveTexture( GLenum texture );
+	static void						AttachShader( GLuint program, GLuint shader );
+	static void						BindAttribLocation( GLuint program, GLuint index, const GLchar* name );
+	static void						BindBuffer( GLenum target, GLuint buffer );
+	static void						BindBufferRange( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size );
+	static void						BindFramebuffer( GLenum target, GLuint framebuffer );
+	static void						BindRenderbuffer( GLenum target, GLuint renderbuffer );
+	static void						BindTexture( GLenum target, GLuint texture );
+	static void						BindVertexArray( GLuint array );
+	static void						BlendFunc( GLenum sfactor, GLenum dfactor );
+	static void						BufferData( GLenum target, GLsizeiptr size, const void* data, GLenum usage );
+	static void						BufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void* data );
+	static GLenum					CheckFramebufferStatus( GLenum target );
+	static void						Clear( GLbitfield mask );
+	static void						ClearColor( GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha );
+	static void						ClientWaitSync( void* sync );
+	static void						CompileShader( GLuint shader );
+	static GLuint					CreateProgram();
+	static GLuint					CreateShader( GLenum type );
+	static void						DeleteBuffers( GLsizei n, const GLuint* buffers );
+	static void						DeleteSync( void* sync );
+	static void						DeleteTextures( GLsizei n, const GLuint* textures );
+	static void						DeleteVertexArrays( GLsizei n, const GLuint* arrays );
+	static void						DepthFunc( GLenum func );
+	static void						Disable( GLenum cap );
+	static void						DisableVertexAttribArray( GLuint index );
+	static void						DrawArrays( GLenum mode, GLint first, GLsizei count );
+	static void						DrawElements( GLenum mode, GLsizei count, GLenum type, const void* indices );
+	static void						DrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount );
+	static void						Enable( GLenum cap );
+	static void						EnableVertexAttribArray( GLuint index );
+	static void*					FenceSync();
+	static void						FramebufferRenderbuffer( GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer );
+	static void						FramebufferTexture2D( GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level );
+	static void						FrontFace( GLenum mode );
+	static void						GenBuffers( GLsizei n, GLuint* buffers );
+	static void						GenFramebuffers( GLsizei n, GLuint* framebuffers );
+	static void						GenRenderbuffers( GLsizei n, GLuint* renderbuffers );
+	static void						GenTextures( GLsizei n, GLuint* textures );
+	static void						GenVertexArrays( GLsizei n, GLuint* arrays );
+	static void						GetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name );
+	static void						GetActiveUniformBlockiv( GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params );
+	static void						GetActiveUniformsiv( GLuint program, GLsizei uniformCount, const GLuint* uniformIndices, GLenum pname, GLint* params );
+	static GLenum					GetError();
+	static void						GetIntegerv( GLenum pname, GLint* params );
+	static void						GetProgramBinary( GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary );
+	static void						GetProgramiv( GLuint program, GLenum pname, GLint* params );
+	static void						GetShaderInfoLog( GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog );
+	static void						GetShaderiv( GLuint shader, GLenum pname, GLint* params );
+	static const GLubyte*			GetString( GLenum name );
+	static GLuint					GetUniformBlockIndex( GLuint program, const GLchar* uniformBlockName );
+	static GLint					GetUniformLocation( GLuint program, const GLchar* name );
+	static void						LinkProgram( GLuint program );
+	static void*					MapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+	static void						PixelStorei( GLenum pname, GLint param );
+	static void						ProgramBinary( GLuint program, GLenum binaryFormat, const void* binary, GLsizei length );
+	static void						ProgramParameteri( GLuint program, GLenum pname, GLint value );
+	static void						RenderbufferStorage( GLenum target, GLenum internalformat, GLsizei width, GLsizei height );
+	static void						ShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length );
+	static void						TexImage2D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels );
+	static void						TexParameteri( GLenum target, GLenum pname, GLint param );
+	static void						Uniform1fv( GLint location, GLsizei count, const GLfloat* value );
+	static void						Uniform1i( GLint location, GLint v0 );
+	static void						Uniform2fv( GLint location, GLsizei count, const GLfloat* value );
+	static void						Uniform3fv( GLint location, GLsizei count, const GLfloat* value );
+	static void						Uniform4fv( GLint location, GLsizei count, const GLfloat* value );
+	static void						UniformBlockBinding( GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding );
+	static void						UniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat* value );
+	static void						UnmapBuffer( GLenum target );
+	static void						UseProgram( GLuint program );
+	static void						VertexAttribDivisor( GLuint index, GLuint divisor );
+	static void						VertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer );
+	static void						Viewport( GLint x, GLint y, GLsizei width, GLsizei height );
+
+private:
+
+	static void							Record( RsGLCommandType type, RsGLCategory category, BtU32 arg0, BtU32 arg1, BtU32 arg2, BtU32 bytes, BtU32 arg3 = 0 );
+	static BtBool						IsRedundant( BtU32 &shadow, BtU32 value );
+
+	static RsBackend					m_backend;
+	static RsGLNullReflection*			m_pNullReflection;
+	static BtBool						m_isCapturing;
+	static BtU32						m_numCommands;
+	static RsGLCommand					m_commands[MaxRsGLCommands];
+	static RsGLStats					m_stats;
+	static RsGLStats					m_frameStats;
+	static BtBool						m_isStateCache;
+};
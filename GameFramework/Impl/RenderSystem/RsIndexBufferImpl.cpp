@@ -7,6 +7,7 @@
 #include "BtMemory.h"
 #include "BtBase.h"
 #include "RsIndexBufferImpl.h"
+#include "RsGL.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // RsIndexBufferWinGL
@@ -39,19 +40,25 @@ void RsIndexBufferImpl::CreateOnDevice()
 		m_indexSize = sizeof(BtU32);
 	}
 
+	// The element buffer binding belongs to the bound vertex array so don't touch a mesh's
+	if( RsGL::IsVertexArraySupported() == BtTrue )
+	{
+		RsGL::BindVertexArray( 0 );
+	}
+
 	// generate a new buffer and get the associated ID
-	glGenBuffers(1, &m_indexBuffer);
+	RsGL::GenBuffers(1, &m_indexBuffer);
 
 	// bind VBO in order to use
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	RsGL::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 
 	BtU32 dataSize = m_pFileData->m_nIndices * m_indexSize;
 
 	// upload data to VBO
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, dataSize, m_pData, GL_STATIC_DRAW);
+	RsGL::BufferData(GL_ELEMENT_ARRAY_BUFFER, dataSize, m_pData, GL_STATIC_DRAW);
 
 	// Unbind vertex buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	RsGL::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,7 +74,7 @@ void RsIndexBufferImpl::Copy( BtU8* pData, BtU32 nIndices )
 void RsIndexBufferImpl::SetIndices()
 {
 	// Bind the index buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	RsGL::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,5 +82,5 @@ void RsIndexBufferImpl::SetIndices()
 
 void RsIndexBufferImpl::RemoveFromDevice()
 {
-	glDeleteBuffers(1, &m_indexBuffer);
+	RsGL::DeleteBuffers(1, &m_indexBuffer);
 }
@@ -31,6 +31,9 @@ public:
 	void							RemoveFromDevice();
 	void							SetIndices();
 
+	// The indices as they were loaded, for reading on the CPU
+	const BtU8*						GetData() const;
+
 private:
 
 	friend class RsImplWinDX;
@@ -41,3 +44,11 @@ private:
 	BtU32							m_indexSize;
 	BtU32							m_lockType;
 };
+
+////////////////////////////////////////////////////////////////////////////////
+// GetData
+
+inline const BtU8* RsIndexBufferImpl::GetData() const
+{
+	return m_pData;
+}
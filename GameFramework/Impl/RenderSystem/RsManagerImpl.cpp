@@ -7,12 +7,33 @@
 #include "RsManagerImpl.h"
 #include "RsRenderTargetImpl.h"
 #include "SgNode.h"
+#include "SgOcclusionImpl.h"
 #include "RsCapsImpl.h"
 #include "RsShaderImpl.h"
+#include "BtProfiler.h"
+#include "RsGL.h"
+#include "BtJobSystem.h"
 
 RsImplWinGL implWin32GL;
 RsCapsWinGL capsWinGL;
-BtU32 RsImplWinGL::m_vertexBuffer = 0;
+RsStreamBufferImpl RsImplWinGL::m_streamBuffer;
+
+// Room for every vertex StartVertex can hand out plus vertex drawn in place
+const BtU32 StreamBufferFrameSize = ( MaxVertex * sizeof( RsVertex3 ) ) + ( 1024 * 256 );
+static BtBool g_isStreamRing = BtTrue;
+
+// Uniform blocks are a few hundred bytes once aligned so this takes a thousand or so
+const BtU32 UniformBufferFrameSize = 1024 * 256;
+
+// What each job of a RenderParallel records with
+struct LRsRecordJob
+{
+	BtJobFunction										m_function;
+	void*												m_pContext;
+	RsCommandBufferImpl*								m_pCommandBuffer;
+};
+
+static LRsRecordJob g_recordJobs[MaxCommandBuffers];
 
 ////////////////////////////////////////////////////////////////////////////////
 // GetCaps
@@ -29,6 +50,8 @@ void RsImplWinGL::Create()
 {
 	RsImpl::Create();
 
+	m_numCommandBuffers = 0;
+
 	// Create the vertex and index buffers
 	CreateOnDevice();
 
@@ -42,15 +65,180 @@ void RsImplWinGL::Create()
 
 void RsImplWinGL::CreateOnDevice()
 {
-	glGenBuffers(1, &m_vertexBuffer);
+	// We know nothing about the new context's state yet
+	RsGL::InvalidateState();
+
+	// Keep every write aligned for the vertex attribute offsets
+	m_streamBuffer.CreateOnDevice( GL_ARRAY_BUFFER, StreamBufferFrameSize, 16 );
+	m_streamBuffer.SetRing( g_isStreamRing );
+	m_numStreamedVertex = 0;
+
+	m_isUniformBuffer = BtFalse;
+
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		m_uniformSpillBuffer[block] = 0;
+	}
+
+#if defined( GL_UNIFORM_BUFFER )
+	if( RsGL::IsUniformBufferSupported() == BtTrue )
+	{
+		// Blocks have to be bound at offsets the device can take
+		GLint alignment = 0;
+		RsGL::GetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+
+		if( alignment <= 0 )
+		{
+			alignment = 256;
+		}
+
+		m_uniformBuffer.CreateOnDevice( GL_UNIFORM_BUFFER, UniformBufferFrameSize, alignment );
+		m_isUniformBuffer = BtTrue;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetStreamRing
+
+//static
+void RsImplWinGL::SetStreamRing( BtBool isRing )
+{
+	g_isStreamRing = isRing;
+	m_streamBuffer.SetRing( isRing );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// StreamVertex
+
+BtU32 RsImplWinGL::StreamVertex( const RsVertex3 *pVertex, BtU32 numVertex )
+{
+	const RsVertex3 *pStreamed = &m_vertex[0];
+
+	// Vertex from StartVertex went up with the rest of the frame's in Render
+	if( ( pVertex >= pStreamed ) && ( pVertex + numVertex <= pStreamed + m_numStreamedVertex ) )
+	{
+		RsGL::BindBuffer( GL_ARRAY_BUFFER, m_streamBuffer.GetHandle() );
+
+		return m_streamedVertexOffset + (BtU32)( ( pVertex - pStreamed ) * sizeof( RsVertex3 ) );
+	}
+
+	// Anything else is drawn straight from the caller's memory so copy it now
+	return m_streamBuffer.Write( pVertex, numVertex * sizeof( RsVertex3 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// StreamInstances
+
+BtU32 RsImplWinGL::StreamInstances( const MtMatrix4 *pWorld, BtU32 numInstances )
+{
+	return m_streamBuffer.Write( pWorld, numInstances * sizeof( MtMatrix4 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// StreamUniforms
+
+void RsImplWinGL::StreamUniforms( BtU32 block, const void *pData, BtU32 size )
+{
+#if defined( GL_UNIFORM_BUFFER )
+	BtAssert( m_isUniformBuffer == BtTrue );
+
+	if( m_uniformBuffer.HasRoom( size ) == BtTrue )
+	{
+		BtU32 offset = m_uniformBuffer.Write( pData, size );
+
+		RsGL::BindBufferRange( GL_UNIFORM_BUFFER, block, m_uniformBuffer.GetHandle(), offset, size );
+		return;
+	}
+
+	// The ring grows next frame. Until then each binding point has a buffer of its own,
+	// as one shared spill buffer would change blocks that are still bound
+	if( m_uniformSpillBuffer[block] == 0 )
+	{
+		RsGL::GenBuffers( 1, &m_uniformSpillBuffer[block] );
+	}
+
+	RsGL::BindBuffer( GL_UNIFORM_BUFFER, m_uniformSpillBuffer[block] );
+	RsGL::BufferData( GL_UNIFORM_BUFFER, size, pData, GL_DYNAMIC_DRAW );
+	RsGL::BindBufferRange( GL_UNIFORM_BUFFER, block, m_uniformSpillBuffer[block], 0, size );
+#else
+	BtUnusedVariable( block );
+	BtUnusedVariable( pData );
+	BtUnusedVariable( size );
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// GetVertexBuffer
+// LRsRecord
 
-BtU32 RsImplWinGL::GetVertexBuffer()
+static void LRsRecord( void* pContext, BtU32 iStart, BtU32 iEnd )
 {
-	return m_vertexBuffer;
+	LRsRecordJob *pJob = (LRsRecordJob*)pContext;
+
+	// A thread waiting on other jobs can run this in the middle of its own
+	RsCommandBufferImpl *pPrevious = RsCommandBufferImpl::GetCurrent();
+
+	RsCommandBufferImpl::SetCurrent( pJob->m_pCommandBuffer );
+	pJob->m_function( pJob->m_pContext, iStart, iEnd );
+	RsCommandBufferImpl::SetCurrent( pPrevious );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RenderParallel
+
+void RsImplWinGL::RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext )
+{
+	BtProfile( "RsImpl::RenderParallel" );
+
+	BtU32 numFree = MaxCommandBuffers - m_numCommandBuffers;
+
+	// Run it here when there is nothing to gain or we're already inside a job
+	if( ( count <= grainSize ) ||
+		( numFree < 2 ) ||
+		( BtJobSystem::IsCreated() == BtFalse ) ||
+		( BtJobSystem::GetNumWorkers() < 2 ) ||
+		( RsCommandBufferImpl::GetCurrent() != BtNull ) )
+	{
+		function( pContext, 0, count );
+		return;
+	}
+
+	grainSize = MtMax( grainSize, (BtU32)1 );
+
+	// Make the ranges bigger when there aren't enough command buffers for them
+	BtU32 numJobs = ( count + grainSize - 1 ) / grainSize;
+
+	if( numJobs > numFree )
+	{
+		grainSize = ( count + numFree - 1 ) / numFree;
+		numJobs = ( count + grainSize - 1 ) / grainSize;
+	}
+
+	BtU32 iFirst = m_numCommandBuffers;
+	m_numCommandBuffers += numJobs;
+
+	BtJobCounter counter;
+
+	for( BtU32 iJob=0; iJob<numJobs; iJob++ )
+	{
+		LRsRecordJob &job = g_recordJobs[iFirst + iJob];
+		job.m_function = function;
+		job.m_pContext = pContext;
+		job.m_pCommandBuffer = &m_commandBuffers[iFirst + iJob];
+
+		BtU32 iStart = iJob * grainSize;
+		BtU32 iEnd = MtMin( iStart + grainSize, count );
+
+		BtJobSystem::Run( LRsRecord, &job, iStart, iEnd, &counter );
+	}
+
+	BtJobSystem::Wait( &counter );
+
+	// Merge in range order rather than the order the jobs finished
+	for( BtU32 iJob=0; iJob<numJobs; iJob++ )
+	{
+		m_commandBuffers[iFirst + iJob].Merge();
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -58,7 +246,22 @@ BtU32 RsImplWinGL::GetVertexBuffer()
 
 void RsImplWinGL::RemoveFromDevice()
 {
-	glDeleteBuffers(1, &m_vertexBuffer);
+	m_streamBuffer.RemoveFromDevice();
+
+	if( m_isUniformBuffer == BtTrue )
+	{
+		m_uniformBuffer.RemoveFromDevice();
+		m_isUniformBuffer = BtFalse;
+	}
+
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		if( m_uniformSpillBuffer[block] != 0 )
+		{
+			RsGL::DeleteBuffers( 1, &m_uniformSpillBuffer[block] );
+			m_uniformSpillBuffer[block] = 0;
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,6 +270,15 @@ void RsImplWinGL::RemoveFromDevice()
 void RsImplWinGL::Destroy()
 {
 	RemoveFromDevice();
+
+	for( BtU32 i=0; i<MaxCommandBuffers; i++ )
+	{
+		m_commandBuffers[i].Destroy();
+	}
+
+	RsRenderTargetWinGL::FreeSortItems();
+
+	RsImpl::Destroy();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -74,14 +286,18 @@ void RsImplWinGL::Destroy()
 
 void RsImplWinGL::ResetRenderables()
 {
-	m_runTimeHeap = 0;
+	ResetGraphicsMemory();
 
 	for( BtU32 i=0; i<m_renderTargets.GetNumItems(); i++ )
 	{
 		m_renderTargets[i].Reset();
 	}
 
-	m_primitives.Empty();
+	for( BtU32 i=0; i<m_numCommandBuffers; i++ )
+	{
+		m_commandBuffers[i].Reset();
+	}
+	m_numCommandBuffers = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -113,12 +329,27 @@ RsRenderTarget *RsImplWinGL::GetNewRenderTarget()
 	return pRenderTarget;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// AllocateRenderable
+
+BtU8 *RsImplWinGL::AllocateRenderable( BtU32 size )
+{
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	// Jobs recording renderables keep them in their own command buffer
+	if( pCommandBuffer != BtNull )
+	{
+		return pCommandBuffer->Allocate( size );
+	}
+	return AllocateGraphicsMemory( size );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // AddFont
 
 RsFontRenderable *RsImplWinGL::AddFont()
 {
-	RsFontRenderable *pFontRenderable = (RsFontRenderable*)AllocateGraphicsMemory( sizeof( RsFontRenderable ) );
+	RsFontRenderable *pFontRenderable = (RsFontRenderable*)AllocateRenderable( sizeof( RsFontRenderable ) );
 	pFontRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pFontRenderable->m_pShader = RsShader::GetCurrent();
 	return pFontRenderable;
@@ -129,7 +360,7 @@ RsFontRenderable *RsImplWinGL::AddFont()
 
 RsSpriteRenderable *RsImplWinGL::AddSprite()
 {
-	RsSpriteRenderable *pSpriteRenderable = (RsSpriteRenderable*)AllocateGraphicsMemory( sizeof( RsSpriteRenderable ) );
+	RsSpriteRenderable *pSpriteRenderable = (RsSpriteRenderable*)AllocateRenderable( sizeof( RsSpriteRenderable ) );
 	pSpriteRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pSpriteRenderable->m_pShader = RsShader::GetCurrent();
 	return pSpriteRenderable;
@@ -140,7 +371,7 @@ RsSpriteRenderable *RsImplWinGL::AddSprite()
 
 RsTextureRenderable *RsImplWinGL::AddTexture()
 {
-	RsTextureRenderable *pTextureRenderable = (RsTextureRenderable*)AllocateGraphicsMemory( sizeof( RsTextureRenderable ) );
+	RsTextureRenderable *pTextureRenderable = (RsTextureRenderable*)AllocateRenderable( sizeof( RsTextureRenderable ) );
 	pTextureRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pTextureRenderable->m_pShader = RsShader::GetCurrent();
 	return pTextureRenderable;
@@ -151,7 +382,7 @@ RsTextureRenderable *RsImplWinGL::AddTexture()
 
 RsMaterialRenderable *RsImplWinGL::AddMaterial()
 {
-	RsMaterialRenderable *pMaterialRenderable = (RsMaterialRenderable*)AllocateGraphicsMemory( sizeof( RsMaterialRenderable ) );
+	RsMaterialRenderable *pMaterialRenderable = (RsMaterialRenderable*)AllocateRenderable( sizeof( RsMaterialRenderable ) );
 	pMaterialRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pMaterialRenderable->m_pShader = RsShader::GetCurrent();
 
@@ -165,7 +396,7 @@ RsMaterialRenderable *RsImplWinGL::AddMaterial()
 
 SgMeshRenderable *RsImplWinGL::AddMesh()
 {
-	SgMeshRenderable *pNodeRenderable = (SgMeshRenderable*)AllocateGraphicsMemory( sizeof( SgMeshRenderable ) );
+	SgMeshRenderable *pNodeRenderable = (SgMeshRenderable*)AllocateRenderable( sizeof( SgMeshRenderable ) );
 	pNodeRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pNodeRenderable->m_pShader = RsShader::GetCurrent();
 	return pNodeRenderable;
@@ -176,7 +407,7 @@ SgMeshRenderable *RsImplWinGL::AddMesh()
 
 SgSkinRenderable *RsImplWinGL::AddSkin()
 {
-	SgSkinRenderable *pNodeRenderable = (SgSkinRenderable*)AllocateGraphicsMemory( sizeof( SgSkinRenderable ) );
+	SgSkinRenderable *pNodeRenderable = (SgSkinRenderable*)AllocateRenderable( sizeof( SgSkinRenderable ) );
 	pNodeRenderable->m_pRenderTarget = RsRenderTarget::GetCurrent();
 	pNodeRenderable->m_pShader = RsShader::GetCurrent();
 	return pNodeRenderable;
@@ -187,7 +418,7 @@ SgSkinRenderable *RsImplWinGL::AddSkin()
 
 RsPrimitive *RsImplWinGL::AddPrimitive()
 {
-	return m_primitives.Add();
+	return (RsPrimitive*)AllocateRenderable( sizeof( RsPrimitive ) );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -195,6 +426,9 @@ RsPrimitive *RsImplWinGL::AddPrimitive()
 
 RsVertex3 *RsImplWinGL::StartVertex()
 {
+	// Everyone shares the vertex array so this can't be used from a RenderParallel job
+	BtAssert( RsCommandBufferImpl::GetCurrent() == BtNull );
+
 	return &m_vertex[m_currentVertex];
 }
 
@@ -211,12 +445,32 @@ void RsImplWinGL::EndVertex( BtU32 vertexCount )
 
 void RsImplWinGL::Render()
 {
+	BtProfile( "RsImpl::Render" );
+
 	BeginScene();
 
 	//glDisable(GL_ALPHA_TEST);
 
     GLint defaultFBO;
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFBO);
+    RsGL::GetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFBO);
+
+	// Upload all of this frame's immediate mode vertex in one write. Renderables then
+	// draw from offsets into it rather than uploading their own
+	m_streamBuffer.BeginFrame();
+	m_numStreamedVertex = 0;
+
+	// Last frame's blocks are in a region we may soon write over so write them again
+	if( m_isUniformBuffer == BtTrue )
+	{
+		m_uniformBuffer.BeginFrame();
+	}
+	RsShaderImpl::InvalidateBlocks();
+
+	if( ( g_isStreamRing == BtTrue ) && ( m_currentVertex > 0 ) )
+	{
+		m_streamedVertexOffset = m_streamBuffer.Write( &m_vertex[0], m_currentVertex * sizeof( RsVertex3 ) );
+		m_numStreamedVertex = m_currentVertex;
+	}
 
 	// Clear the render target so we don't use it in the deferred rendering pass
 	m_pCurrentRenderTarget = BtNull;
@@ -230,13 +484,25 @@ void RsImplWinGL::Render()
 		RsRenderTargetWinGL &renderTarget = m_renderTargets[i];
 
         // Always restore the default frame buffer at the start before changing it
-        glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO );
+        RsGL::BindFramebuffer(GL_FRAMEBUFFER, defaultFBO );
         
 		// render each render target
 		renderTarget.Render();
 	}
 
+	// Fence this frame's part of the stream buffers
+	m_streamBuffer.EndFrame();
+
+	if( m_isUniformBuffer == BtTrue )
+	{
+		m_uniformBuffer.EndFrame();
+	}
+
 	EndScene();
 
+	// Close off this frame's device and occlusion stats
+	RsGL::EndFrame();
+	SgOcclusionImpl::pInstance()->EndFrame();
+
 	ResetRenderables();
 }
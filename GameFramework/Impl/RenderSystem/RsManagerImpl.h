@@ -7,8 +7,14 @@
 #include "BtLinkedList.h"
 #include "RsImpl.h"
 #include "RsRenderTargetImpl.h"
+#include "RsStreamBufferImpl.h"
+#include "RsCommandBufferImpl.h"
+#include "RsShaderImpl.h"
 #include "RsImpl.h"
 
+// The vertex attributes an RsVertex3 fills: position, normal, colour and UV
+const BtU32 RsVertex3Attribs = ( 1 << 0 ) | ( 1 << 1 ) | ( 1 << 4 ) | ( 1 << 5 );
+
 // Class declaration
 class RsImplWinGL : public RsImpl
 {
@@ -26,6 +32,7 @@ public:
 	RsRenderTarget									   *GetNewRenderTarget();
 
 	void 												Render();
+	void												RenderParallel( BtU32 count, BtU32 grainSize, BtJobFunction function, void* pContext );
 	void												SetDimension( const MtVector2 &v2Dimension );
 
 	// Renderables
@@ -41,9 +48,20 @@ public:
 	RsVertex3										   *StartVertex();
 	void											    EndVertex( BtU32 vertexCount );
 
+	// Dynamic vertex. SetStreamRing( BtFalse ) goes back to reallocating the buffer for every draw
+	static void											SetStreamRing( BtBool isRing );
+
+	// Returns the byte offset of the vertex in the stream buffer and leaves it bound
+	BtU32												StreamVertex( const RsVertex3 *pVertex, BtU32 numVertex );
+
+	// Returns the byte offset of the world matrices in the stream buffer and leaves it bound
+	BtU32												StreamInstances( const MtMatrix4 *pWorld, BtU32 numInstances );
+
+	// Writes a uniform block into the uniform ring and binds it to its binding point
+	void												StreamUniforms( BtU32 block, const void *pData, BtU32 size );
+
 	// Accessors
 	RsCaps											   *GetCaps();
-    static BtU32                                        GetVertexBuffer();
 //	RsVertexBufferWin32								   *GetVertexBuffer();
 //	RsIndexBufferWin32								   *GetIndexBuffer();
 
@@ -52,9 +70,16 @@ private:
 	// Private functions
 	void												CreateOnDevice();
 	void												RemoveFromDevice();
+	BtU8											   *AllocateRenderable( BtU32 size );
 
 	// Private members
 	BtArray<RsRenderTargetWinGL, MaxRenderTargets>		m_renderTargets;
-	BtArray< RsPrimitive, 4096>                         m_primitives;
-    static BtU32                                        m_vertexBuffer;
+	static RsStreamBufferImpl							m_streamBuffer;
+	RsStreamBufferImpl									m_uniformBuffer;
+	GLuint												m_uniformSpillBuffer[RsUniformBlock_Max];	// One each as spilled blocks stay bound
+	BtBool												m_isUniformBuffer;
+	BtU32												m_streamedVertexOffset;
+	BtU32												m_numStreamedVertex;
+	RsCommandBufferImpl									m_commandBuffers[MaxCommandBuffers];
+	BtU32												m_numCommandBuffers;
 };
@@ -13,6 +13,7 @@
 #include "RsTextureImpl.h"
 #include "RsManagerImpl.h"
 #include "RsShaderImpl.h"
+#include "RsGL.h"
 #include <new>
 #include <stdio.h>
 
@@ -21,6 +22,7 @@
 
 RsMaterialImpl::RsMaterialImpl()
 {
+	m_technique = RsTechniqueNone;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,7 +32,7 @@ RsMaterialImpl::RsMaterialImpl()
 RsMaterial* RsMaterialImpl::GetDuplicate() const
 {
     // Allocate the memory
-    BtU8* pMemory = BtMemory::Allocate( sizeof(RsMaterialImpl) + m_pFileData->m_nFileDataSize );
+    BtU8* pMemory = BtMemory::Allocate( BtMT_Render, sizeof(RsMaterialImpl) + m_pFileData->m_nFileDataSize );
     
     // Create the class
     RsMaterialImpl* pMaterial = new( pMemory ) RsMaterialImpl;
@@ -67,6 +69,9 @@ void RsMaterialImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 	// Fix the pointers to the textures
 	m_pFileData = (BaMaterialFileData*) pFileData;
 
+	// Look the technique up on first use
+	m_technique = RsTechniqueNone;
+
 	for( BtU32 iTexture=0; iTexture<MaxTextures; ++iTexture )
 	{
         // Fix up the texture
@@ -75,7 +80,7 @@ void RsMaterialImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// GetTechnique
+// GetTechniqueName
 
 BtChar* RsMaterialImpl::GetTechniqueName() const
 {
@@ -88,6 +93,20 @@ BtChar* RsMaterialImpl::GetTechniqueName() const
 void RsMaterialImpl::SetTechniqueName( const BtChar* name )
 {
 	BtStrCopy( m_pFileData->m_techniqueName, 64, name );
+	m_technique = RsTechniqueNone;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetTechnique
+
+BtU32 RsMaterialImpl::GetTechnique()
+{
+	// Names that aren't registered yet are looked up again next time
+	if( m_technique == RsTechniqueNone )
+	{
+		m_technique = RsShaderImpl::GetTechnique( m_pFileData->m_techniqueName );
+	}
+	return m_technique;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -457,60 +476,41 @@ void RsMaterialImpl::Render( RsMaterialRenderable *pRenderable )
 	MtMatrix4 m4WorldViewScreen   = m4World * m4Projection;
     
 	pShader->SetCamera( camera );
-	pShader->SetTechnique( m_pFileData->m_techniqueName );
+	pShader->SetTechnique( GetTechnique() );
 	pShader->SetMatrix( RsHandles_WorldViewScreen, m4WorldViewScreen );
     
-	for( BtU32 i=0; i<7; i++ )
-	{
-		glDisableVertexAttribArray( i );
-	}
-    
 	// Set the texture
     for( BtU32 i=0; i<MaxTextures; i++ )
     {
-        // Set the texture
-        glActiveTexture(GL_TEXTURE0 + i );
-        
         RsTextureImpl* pTexture = (RsTextureImpl*)m_pFileData->m_pTexture[i];
         if( pTexture )
         {
-            GLenum error = glGetError();
+            GLenum error = RsGL::GetError();
             (void)error;
             
             // Cache the texture handle
             BtU32 textureHandle = pTexture->GetTextureHandle();
             
-            // Bind the texture to the handle
-            glBindTexture(GL_TEXTURE_2D, textureHandle );
+            // Bind the texture to the unit
+            RsGL::BindTextureUnit( i, textureHandle );
             
             // Set the shader sampler
             pShader->SetSampler(i);
         }
         else
         {
-            glBindTexture(GL_TEXTURE_2D, 0 );
+            RsGL::BindTextureUnit( i, 0 );
         }
     }
 
 	// Set vertex arrays
 	BtU32 stride = sizeof(RsVertex3);
     
-	// Cache the vertex buffer
-	BtU32 vertexBuffer = RsImplWinGL::GetVertexBuffer();
-    
-	// Get the size
-	BtU32 dataSize = pPrimitives->m_numVertex * stride;
-    
-	// bind VBO in order to use
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer );
-	
-	GLenum error;
-	error = glGetError();
-	(void)error;
-    
-	// upload data to VBO
-	glBufferData(GL_ARRAY_BUFFER, dataSize, pRenderable->m_pVertex, GL_DYNAMIC_DRAW);
-	error = glGetError();
+	// Find the vertex in this frame's stream buffer. This leaves the buffer bound
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+	BtU32 offset = pImpl->StreamVertex( pRenderable->m_pVertex, pPrimitives->m_numVertex );
+
+	GLenum error = RsGL::GetError();
 	(void)error;
     
 	/*
@@ -524,22 +524,18 @@ void RsMaterialImpl::Render( RsMaterialRenderable *pRenderable )
      };
      */
     
-	BtU32 offset = 0;
-	
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::SetVertexAttribArrays( RsVertex3Attribs );
+
+	RsGL::VertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
     
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
     
-	glEnableVertexAttribArray( 4 );
-	glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( BtU32 );
     
-	glEnableVertexAttribArray( 5);
-	glVertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector2 );
     
 	// Draw the primitives
@@ -35,6 +35,7 @@ public:
 	// Accessors
 	BtChar*					GetTechniqueName() const;
 	void					SetTechniqueName( const BtChar* pName );
+	BtU32					GetTechnique();
     
     void                    SetZTest( BtBool isEnabled );
     BtBool                  GetZTest();
@@ -63,6 +64,7 @@ private:
 	friend class SgMaterialsWinGL;
 
 	BaMaterialFileData*		m_pFileData;
+	BtU32					m_technique;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
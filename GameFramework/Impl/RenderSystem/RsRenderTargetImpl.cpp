@@ -10,8 +10,659 @@
 #include "SgMeshImpl.h"
 #include "SgSkinImpl.h"
 #include "SgNode.h"
+#include "RsGL.h"
+#include "RsVertex.h"
+#include "RsShaderImpl.h"
+#include "RsMaterialImpl.h"
+#include "RsCommandBufferImpl.h"
+#include "BtMemory.h"
+#include "ErrorLog.h"
 #include <new>
 
+// Longest vertex run a batch can build
+const BtU32 MaxBatchVertex = 8192;
+
+static RsVertex3 g_batchVertex[MaxBatchVertex];
+static BtBool g_isBatching = BtTrue;
+
+// Meshes and skins the sort has room for to start with. A frame with more doubles it
+const BtU32 StartSortedRenderables = 8192;
+
+// Sort keys, most significant first.
+// Opaque:		layer 4 | 0 | type 1 | program 8 | technique 7 | material 19 | depth 24
+// Transparent:	layer 4 | 1 | inverse depth 24 | type 1 | program 8 | technique 7 | material 19
+// So each layer draws opaque geometry grouped by state and front to back, then
+// transparent geometry back to front
+const BtU32 RsSortKey_LayerShift = 60;
+const BtU32 RsSortKey_TransparentShift = 59;
+
+enum LRsSortType
+{
+	LRsSort_Mesh,
+	LRsSort_Skin,
+};
+
+struct LRsSortItem
+{
+	BtU64						m_key;
+	void*						m_pRenderable;
+	BtU32						m_type;
+};
+
+static LRsSortItem *g_pSortItems = BtNull;
+static LRsSortItem *g_pSortScratch = BtNull;
+static BtU32 g_maxSorted = 0;
+static BtU32 g_numSortGrowths = 0;
+static BtBool g_isSorting = BtTrue;
+
+// Neighbouring opaque meshes that share a material are drawn instanced, one draw per mesh
+static SgMeshRenderable **g_pInstanceRun = BtNull;
+static SgMeshRenderable *g_instances[MaxMeshInstances];
+static BtBool g_isInstancing = BtTrue;
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGetListType
+
+// Batches are drawn as lists so strips and fans can be joined. Returns 0 for
+// primitives we leave alone
+static BtU32 LRsGetListType( BtU32 primitiveType )
+{
+	switch( primitiveType )
+	{
+	case GL_TRIANGLES:
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return GL_TRIANGLES;
+	case GL_LINES:
+	case GL_LINE_STRIP:
+		return GL_LINES;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGetListSize
+
+static BtU32 LRsGetListSize( const RsPrimitive *pPrimitive )
+{
+	BtU32 numVertex = pPrimitive->m_numVertex;
+
+	switch( pPrimitive->m_primitiveType )
+	{
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return ( numVertex > 2 ) ? ( numVertex - 2 ) * 3 : 0;
+	case GL_LINE_STRIP:
+		return ( numVertex > 1 ) ? ( numVertex - 1 ) * 2 : 0;
+	}
+	return numVertex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsAppendAsList
+
+static void LRsAppendAsList( RsVertex3 *pDest, const RsVertex3 *pVertex, const RsPrimitive *pPrimitive )
+{
+	BtU32 numVertex = pPrimitive->m_numVertex;
+
+	switch( pPrimitive->m_primitiveType )
+	{
+	case GL_TRIANGLE_STRIP:
+		for( BtU32 i=0; i+2<numVertex; i++ )
+		{
+			// Every other triangle in a strip is wound the other way
+			if( i & 1 )
+			{
+				*pDest++ = pVertex[i + 1];
+				*pDest++ = pVertex[i];
+			}
+			else
+			{
+				*pDest++ = pVertex[i];
+				*pDest++ = pVertex[i + 1];
+			}
+			*pDest++ = pVertex[i + 2];
+		}
+		break;
+
+	case GL_TRIANGLE_FAN:
+		for( BtU32 i=1; i+1<numVertex; i++ )
+		{
+			*pDest++ = pVertex[0];
+			*pDest++ = pVertex[i];
+			*pDest++ = pVertex[i + 1];
+		}
+		break;
+
+	case GL_LINE_STRIP:
+		for( BtU32 i=0; i+1<numVertex; i++ )
+		{
+			*pDest++ = pVertex[i];
+			*pDest++ = pVertex[i + 1];
+		}
+		break;
+
+	default:
+		BtMemory::Copy( pDest, pVertex, numVertex * sizeof( RsVertex3 ) );
+		break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsCanBatch
+
+template< class T > static BtBool LRsCanBatch( const T *pFirst, const T *pRenderable, const void* (*getKey)( const T* ) )
+{
+	return ( pRenderable != BtNull ) &&
+		   ( getKey( pRenderable ) == getKey( pFirst ) ) &&
+		   ( pRenderable->m_pShader == pFirst->m_pShader ) &&
+		   ( pRenderable->m_pRenderTarget == pFirst->m_pRenderTarget ) &&
+		   ( LRsGetListType( pRenderable->m_primitive->m_primitiveType ) == LRsGetListType( pFirst->m_primitive->m_primitiveType ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsRenderBatched
+
+// Draws a list of renderables, joining neighbours that share a key, shader and kind of
+// primitive into one vertex run and one draw. A null key means draw on its own
+template< class T > static void LRsRenderBatched( T *pRenderable, const void* (*getKey)( const T* ), void (*render)( T* ) )
+{
+	while( pRenderable )
+	{
+		T *pNext = pRenderable->pNext();
+
+		if( ( g_isBatching == BtFalse ) ||
+			( getKey( pRenderable ) == BtNull ) ||
+			( LRsGetListType( pRenderable->m_primitive->m_primitiveType ) == 0 ) ||
+			( LRsCanBatch( pRenderable, pNext, getKey ) == BtFalse ) )
+		{
+			render( pRenderable );
+			pRenderable = pNext;
+			continue;
+		}
+
+		// Start the batch from a copy of the first so it keeps the first's state
+		T batch = *pRenderable;
+		RsPrimitive primitive = *pRenderable->m_primitive;
+		primitive.m_primitiveType = LRsGetListType( primitive.m_primitiveType );
+		primitive.m_numVertex = 0;
+		batch.m_pVertex = g_batchVertex;
+		batch.m_primitive = &primitive;
+
+		const T *pFirst = pRenderable;
+
+		while( LRsCanBatch( pFirst, pRenderable, getKey ) == BtTrue )
+		{
+			BtU32 listSize = LRsGetListSize( pRenderable->m_primitive );
+
+			if( primitive.m_numVertex + listSize > MaxBatchVertex )
+			{
+				break;
+			}
+
+			LRsAppendAsList( g_batchVertex + primitive.m_numVertex, pRenderable->m_pVertex, pRenderable->m_primitive );
+			primitive.m_numVertex += listSize;
+
+			pRenderable = pRenderable->pNext();
+		}
+
+		if( primitive.m_numVertex == 0 )
+		{
+			// Too big to batch at all
+			render( pRenderable );
+			pRenderable = pRenderable->pNext();
+		}
+		else
+		{
+			render( &batch );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch keys and renderers
+
+static const void *LRsGetMaterialKey( const RsMaterialRenderable *pRenderable )
+{
+	return pRenderable->m_pMaterial;
+}
+
+static void LRsRenderMaterial( RsMaterialRenderable *pRenderable )
+{
+	RsMaterialImpl *pMaterial = (RsMaterialImpl*)pRenderable->m_pMaterial;
+
+	if( pMaterial )
+	{
+		pMaterial->Render( pRenderable );
+	}
+}
+
+static const void *LRsGetTextureKey( const RsTextureRenderable *pRenderable )
+{
+	return pRenderable->m_pTexture;
+}
+
+static void LRsRenderTexture( RsTextureRenderable *pRenderable )
+{
+	RsTextureImpl *pTexture = (RsTextureImpl*)pRenderable->m_pTexture;
+
+	pTexture->Render( pRenderable );
+
+	GLenum err = RsGL::GetError();
+	if (err != GL_NO_ERROR)
+		printf( "RsTextureRenderable. glError: 0x%04X", err);
+}
+
+static const void *LRsGetSpriteKey( const RsSpriteRenderable *pRenderable )
+{
+	return pRenderable->m_pSprite;
+}
+
+static void LRsRenderSprite( RsSpriteRenderable *pRenderable )
+{
+	RsSpriteImpl *pSprite = (RsSpriteImpl*)pRenderable->m_pSprite;
+
+	pSprite->Render( pRenderable );
+}
+
+static const void *LRsGetFontKey( const RsFontRenderable *pRenderable )
+{
+	// True type text is rendered to its own texture so it can't share a draw
+	if( pRenderable->m_pTrueTypeFont != BtNull )
+	{
+		return BtNull;
+	}
+	return pRenderable->m_pFont;
+}
+
+static void LRsRenderFont( RsFontRenderable *pRenderable )
+{
+	RsFontImpl *pFont = (RsFontImpl*)pRenderable->m_pFont;
+
+	pFont->Render( pRenderable );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGetDepthBits
+
+// Positive floats order the same as their bit patterns so keep the top 24 bits
+static BtU64 LRsGetDepthBits( BtFloat depth )
+{
+	if( depth <= 0 )
+	{
+		return 0;
+	}
+
+	union
+	{
+		BtFloat					m_float;
+		BtU32					m_bits;
+	} depthBits;
+
+	depthBits.m_float = depth;
+	return depthBits.m_bits >> 7;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsMakeSortKey
+
+static BtU64 LRsMakeSortKey( BtU32 layer, BtU32 type, RsMaterialImpl *pMaterial, BtU32 technique, const MtMatrix4 &m4World, const MtMatrix4 &m4View )
+{
+	// State bits: type, program, technique and material
+	BtU64 program = 0xFF;
+
+	if( technique != RsTechniqueNone )
+	{
+		program = RsShaderImpl::GetTechniqueState( technique ).m_program & 0xFF;
+	}
+	else
+	{
+		technique = 0x7F;
+	}
+
+	BtU64 material = ( (BtU64)(uintptr_t)pMaterial >> 4 ) & 0x7FFFF;
+
+	BtU64 state = ( (BtU64)type << 34 ) | ( program << 26 ) | ( (BtU64)( technique & 0x7F ) << 19 ) | material;
+
+	// View space depth of the object's origin
+	MtVector3 v3Position = m4World.GetTranslation() * m4View;
+	BtU64 depth = LRsGetDepthBits( v3Position.z );
+
+	BtU64 key = (BtU64)layer << RsSortKey_LayerShift;
+
+	if( pMaterial->GetFlags() & RsMaterial_Transparent )
+	{
+		key |= (BtU64)1 << RsSortKey_TransparentShift;
+		key |= ( 0xFFFFFF - depth ) << 35;
+		key |= state;
+	}
+	else
+	{
+		key |= state << 24;
+		key |= depth;
+	}
+	return key;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsRadixSort
+
+// Least significant byte first. Passes where every key shares the byte are skipped,
+// which is most of them as the layer and state bits rarely differ much
+static LRsSortItem *LRsRadixSort( LRsSortItem *pItems, LRsSortItem *pScratch, BtU32 numItems )
+{
+	for( BtU32 shift=0; shift<64; shift+=8 )
+	{
+		BtU32 counts[256];
+		BtMemory::Set( counts, 0, sizeof( counts ) );
+
+		for( BtU32 i=0; i<numItems; i++ )
+		{
+			counts[( pItems[i].m_key >> shift ) & 0xFF]++;
+		}
+
+		if( counts[( pItems[0].m_key >> shift ) & 0xFF] == numItems )
+		{
+			continue;
+		}
+
+		BtU32 offset = 0;
+
+		for( BtU32 i=0; i<256; i++ )
+		{
+			BtU32 count = counts[i];
+			counts[i] = offset;
+			offset += count;
+		}
+
+		for( BtU32 i=0; i<numItems; i++ )
+		{
+			pScratch[counts[( pItems[i].m_key >> shift ) & 0xFF]++] = pItems[i];
+		}
+
+		LRsSortItem *pSwap = pItems;
+		pItems = pScratch;
+		pScratch = pSwap;
+	}
+	return pItems;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsRenderSortItem
+
+static void LRsRenderSortItem( const LRsSortItem &item )
+{
+	if( item.m_type == LRsSort_Mesh )
+	{
+		SgMeshRenderable *pRenderable = (SgMeshRenderable*)item.m_pRenderable;
+		SgMeshWinGL *pMesh = (SgMeshWinGL*)pRenderable->m_pMesh;
+		pMesh->Render( pRenderable );
+	}
+	else
+	{
+		SgSkinRenderable *pRenderable = (SgSkinRenderable*)item.m_pRenderable;
+		SgSkinImpl *pSkin = (SgSkinImpl*)pRenderable->m_pSkin;
+		pSkin->Render( pRenderable );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsIsInstanceable
+
+// Opaque meshes whose world transform is a rotation, a translation and the same scale
+// on every axis. The instanced shader relies on the last to transform normals
+static BtBool LRsIsInstanceable( const LRsSortItem &item )
+{
+	if( ( item.m_type != LRsSort_Mesh ) || ( ( item.m_key >> RsSortKey_TransparentShift ) & 1 ) )
+	{
+		return BtFalse;
+	}
+
+	SgMeshRenderable *pRenderable = (SgMeshRenderable*)item.m_pRenderable;
+	const MtMatrix4 &m4World = ( (SgMeshWinGL*)pRenderable->m_pMesh )->GetWorldTransform();
+
+	MtVector3 v3X = m4World.XAxis();
+	MtVector3 v3Y = m4World.YAxis();
+	MtVector3 v3Z = m4World.ZAxis();
+
+	BtFloat scale = v3X.DotProduct( v3X );
+	BtFloat tolerance = scale * 0.001f;
+
+	return ( MtAbs( v3Y.DotProduct( v3Y ) - scale ) <= tolerance ) &&
+		   ( MtAbs( v3Z.DotProduct( v3Z ) - scale ) <= tolerance ) &&
+		   ( MtAbs( v3X.DotProduct( v3Y ) ) <= tolerance ) &&
+		   ( MtAbs( v3X.DotProduct( v3Z ) ) <= tolerance ) &&
+		   ( MtAbs( v3Y.DotProduct( v3Z ) ) <= tolerance );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsIsSameInstance
+
+static BtBool LRsIsSameInstance( const SgMeshRenderable *pFirst, const SgMeshRenderable *pRenderable )
+{
+	const BaMaterialBlockFileData *pFirstBlock = pFirst->m_pMaterialBlock;
+	const BaMaterialBlockFileData *pBlock = pRenderable->m_pMaterialBlock;
+
+	return ( pRenderable->m_pShader == pFirst->m_pShader ) &&
+		   ( pRenderable->m_pRenderTarget == pFirst->m_pRenderTarget ) &&
+		   ( pBlock->m_pMaterial == pFirstBlock->m_pMaterial ) &&
+		   ( pRenderable->m_nStartRenderBlock == pFirst->m_nStartRenderBlock ) &&
+		   ( pRenderable->m_nEndRenderBlock == pFirst->m_nEndRenderBlock ) &&
+		   ( ( (SgMeshWinGL*)pRenderable->m_pMesh )->GetScene() == ( (SgMeshWinGL*)pFirst->m_pMesh )->GetScene() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsRenderInstanced
+
+// Draws the run of instanceable meshes sharing the first item's material and returns
+// how many items it used. Each mesh in the run becomes one instanced draw so the
+// front to back order only holds between different meshes
+static BtU32 LRsRenderInstanced( const LRsSortItem *pItems, BtU32 numItems )
+{
+	SgMeshRenderable *pFirst = (SgMeshRenderable*)pItems[0].m_pRenderable;
+	BtU32 numRun = 0;
+
+	while( ( numRun < numItems ) && ( LRsIsInstanceable( pItems[numRun] ) == BtTrue ) )
+	{
+		SgMeshRenderable *pRenderable = (SgMeshRenderable*)pItems[numRun].m_pRenderable;
+
+		if( ( pRenderable->m_pMaterialBlock->m_pMaterial != pFirst->m_pMaterialBlock->m_pMaterial ) ||
+			( pRenderable->m_pShader != pFirst->m_pShader ) )
+		{
+			break;
+		}
+		g_pInstanceRun[numRun++] = pRenderable;
+	}
+
+	if( numRun == 0 )
+	{
+		LRsRenderSortItem( pItems[0] );
+		return 1;
+	}
+
+	// Pull out each mesh's instances in turn, keeping the rest of the run in order
+	BtU32 numLeft = numRun;
+
+	while( numLeft > 0 )
+	{
+		SgMeshRenderable *pMeshFirst = g_pInstanceRun[0];
+		BtU32 numInstances = 0;
+		BtU32 numKept = 0;
+
+		for( BtU32 i=0; i<numLeft; i++ )
+		{
+			SgMeshRenderable *pRenderable = g_pInstanceRun[i];
+
+			if( ( numInstances < MaxMeshInstances ) && ( LRsIsSameInstance( pMeshFirst, pRenderable ) == BtTrue ) )
+			{
+				g_instances[numInstances++] = pRenderable;
+			}
+			else
+			{
+				g_pInstanceRun[numKept++] = pRenderable;
+			}
+		}
+		numLeft = numKept;
+
+		SgMeshWinGL *pMesh = (SgMeshWinGL*)pMeshFirst->m_pMesh;
+
+		if( numInstances == 1 )
+		{
+			pMesh->Render( pMeshFirst );
+		}
+		else
+		{
+			pMesh->Render( g_instances, numInstances );
+		}
+	}
+	return numRun;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetInstancing
+
+//static
+void RsRenderTargetWinGL::SetInstancing( BtBool isInstancing )
+{
+	g_isInstancing = isInstancing;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeSortItems
+
+//static
+void RsRenderTargetWinGL::FreeSortItems()
+{
+	if( g_pSortItems != BtNull )
+	{
+		BtMemory::Free( g_pSortItems );
+		BtMemory::Free( g_pSortScratch );
+		BtMemory::Free( g_pInstanceRun );
+	}
+	g_pSortItems = BtNull;
+	g_pSortScratch = BtNull;
+	g_pInstanceRun = BtNull;
+	g_maxSorted = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumSortGrowths
+
+//static
+BtU32 RsRenderTargetWinGL::GetNumSortGrowths()
+{
+	return g_numSortGrowths;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsGrowSortItems
+
+// Makes room for one more item, keeping the numItems already added. The scratch and
+// instance runs are only used once the items are all in so they start again empty
+static void LRsGrowSortItems( BtU32 numItems )
+{
+	BtU32 maxSorted = StartSortedRenderables;
+
+	if( g_maxSorted != 0 )
+	{
+		if( g_numSortGrowths == 0 )
+		{
+			ErrorLog::Printf( "RsRenderTargetWinGL sort overflowed %d meshes and skins. Growing it\n", g_maxSorted );
+		}
+		++g_numSortGrowths;
+
+		maxSorted = g_maxSorted * 2;
+	}
+
+	LRsSortItem *pSortItems = (LRsSortItem*)BtMemory::Allocate( BtMT_Render, maxSorted * sizeof( LRsSortItem ) );
+
+	if( g_pSortItems != BtNull )
+	{
+		BtMemory::Copy( pSortItems, g_pSortItems, numItems * sizeof( LRsSortItem ) );
+	}
+	RsRenderTargetWinGL::FreeSortItems();
+
+	g_pSortItems = pSortItems;
+	g_pSortScratch = (LRsSortItem*)BtMemory::Allocate( BtMT_Render, maxSorted * sizeof( LRsSortItem ) );
+	g_pInstanceRun = (SgMeshRenderable**)BtMemory::Allocate( BtMT_Render, maxSorted * sizeof( SgMeshRenderable* ) );
+	g_maxSorted = maxSorted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetSorting
+
+//static
+void RsRenderTargetWinGL::SetSorting( BtBool isSorting )
+{
+	g_isSorting = isSorting;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsSortMeshes
+
+// Returns the sorted meshes and skins of every layer or null if sorting is off and they
+// should be drawn in the order they were added
+static const LRsSortItem *LRsSortMeshes( BtLinkedList<SgMeshRenderable> *pNodes, BtLinkedList<SgSkinRenderable> *pSkinNodes, const MtMatrix4 &m4View, BtU32 &numItems )
+{
+	numItems = 0;
+
+	if( g_isSorting == BtFalse )
+	{
+		return BtNull;
+	}
+
+	for( BtU32 sortOrder=0; sortOrder<MaxSortOrders; sortOrder++ )
+	{
+		for( SgMeshRenderable *pRenderable = pNodes[sortOrder].pHead(); pRenderable; pRenderable = pRenderable->pNext() )
+		{
+			if( numItems == g_maxSorted )
+			{
+				LRsGrowSortItems( numItems );
+			}
+
+			SgMeshWinGL *pMesh = (SgMeshWinGL*)pRenderable->m_pMesh;
+			RsMaterialImpl *pMaterial = (RsMaterialImpl*)pRenderable->m_pMaterialBlock->m_pMaterial;
+
+			LRsSortItem &item = g_pSortItems[numItems++];
+			item.m_key = LRsMakeSortKey( sortOrder, LRsSort_Mesh, pMaterial, pMaterial->GetTechnique(), pMesh->GetWorldTransform(), m4View );
+			item.m_pRenderable = pRenderable;
+			item.m_type = LRsSort_Mesh;
+		}
+
+		for( SgSkinRenderable *pRenderable = pSkinNodes[sortOrder].pHead(); pRenderable; pRenderable = pRenderable->pNext() )
+		{
+			if( numItems == g_maxSorted )
+			{
+				LRsGrowSortItems( numItems );
+			}
+
+			SgSkinImpl *pSkin = (SgSkinImpl*)pRenderable->m_pSkin;
+			RsMaterialImpl *pMaterial = (RsMaterialImpl*)pRenderable->m_pMaterialBlock->m_pMaterial;
+
+			// Skins always draw with the skinning technique
+			LRsSortItem &item = g_pSortItems[numItems++];
+			item.m_key = LRsMakeSortKey( sortOrder, LRsSort_Skin, pMaterial, RsTechnique_ShaderZLTS, pSkin->GetWorldTransform(), m4View );
+			item.m_pRenderable = pRenderable;
+			item.m_type = LRsSort_Skin;
+		}
+	}
+
+	if( numItems == 0 )
+	{
+		return g_pSortItems;
+	}
+	return LRsRadixSort( g_pSortItems, g_pSortScratch, numItems );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetBatching
+
+//static
+void RsRenderTargetWinGL::SetBatching( BtBool isBatching )
+{
+	g_isBatching = isBatching;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Reset
 
@@ -34,6 +685,14 @@ void RsRenderTargetWinGL::Reset()
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsFontRenderable *pFontRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Font, pFontRenderable );
+		return;
+	}
+
 	m_fonts[sortOrder].AddTail( pFontRenderable );
 }
 
@@ -42,6 +701,14 @@ void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsFontRenderable *pFontRenderabl
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsTextureRenderable *pTextureRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Texture, pTextureRenderable );
+		return;
+	}
+
 	m_textures[sortOrder].AddTail( pTextureRenderable );
 }
 
@@ -50,6 +717,14 @@ void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsTextureRenderable *pTextureRen
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsSpriteRenderable *pSpriteRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Sprite, pSpriteRenderable );
+		return;
+	}
+
 	m_sprites[sortOrder].AddTail( pSpriteRenderable );
 }
 
@@ -58,6 +733,14 @@ void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsSpriteRenderable *pSpriteRende
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsMaterialRenderable *pMaterialRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Material, pMaterialRenderable );
+		return;
+	}
+
 	m_materials[sortOrder].AddTail( pMaterialRenderable );
 }
 
@@ -66,6 +749,14 @@ void RsRenderTargetWinGL::Add( BtU32 sortOrder, RsMaterialRenderable *pMaterialR
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, SgSkinRenderable *pSkinRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Skin, pSkinRenderable );
+		return;
+	}
+
 	m_skinNodes[sortOrder].AddTail( pSkinRenderable );
 }
 
@@ -74,6 +765,14 @@ void RsRenderTargetWinGL::Add( BtU32 sortOrder, SgSkinRenderable *pSkinRenderabl
 
 void RsRenderTargetWinGL::Add( BtU32 sortOrder, SgMeshRenderable *pNodeRenderable )
 {
+	RsCommandBufferImpl *pCommandBuffer = RsCommandBufferImpl::GetCurrent();
+
+	if( pCommandBuffer != BtNull )
+	{
+		pCommandBuffer->Add( this, sortOrder, RsRenderCommand_Mesh, pNodeRenderable );
+		return;
+	}
+
 	m_nodes[sortOrder].AddTail( pNodeRenderable );
 }
 
@@ -97,142 +796,120 @@ void RsRenderTargetWinGL::Render()
 
         if( pTexture->m_pFileData->m_flags & RsTF_RenderTarget )
 		{
-            glBindFramebuffer(GL_FRAMEBUFFER, pTexture->m_frameBufferObject );
+            RsGL::BindFramebuffer(GL_FRAMEBUFFER, pTexture->m_frameBufferObject );
 
 			currentViewport = RsViewport( 0, 0, m_pTexture->GetWidth(), pTexture->GetHeight() );
             
-            err = glGetError();
+            err = RsGL::GetError();
             if (err != GL_NO_ERROR)
                 printf( "RsRenderTargetWinGL::Render to texture. glError: 0x%04X", err);
 		}
 
 		// Set the viewport
-		glViewport(currentViewport.m_x, currentViewport.m_y, currentViewport.m_width, currentViewport.m_height);
+		RsGL::Viewport(currentViewport.m_x, currentViewport.m_y, currentViewport.m_width, currentViewport.m_height);
 	}
 	else
 	{
         const RsViewport &currentViewport = m_camera.GetViewport();
         
         // Set the viewport
-        glViewport( currentViewport.m_x, currentViewport.m_y, currentViewport.m_width, currentViewport.m_height );
+        RsGL::Viewport( currentViewport.m_x, currentViewport.m_y, currentViewport.m_width, currentViewport.m_height );
 	}
     
 	// Clear the viewport
 	if( IsCleared() && IsZCleared() )
 	{
 		// Set the clear colour
-		glClearColor( m_clearColour.Red(), m_clearColour.Green(), m_clearColour.Blue(), m_clearColour.Alpha() );
+		RsGL::ClearColor( m_clearColour.Red(), m_clearColour.Green(), m_clearColour.Blue(), m_clearColour.Alpha() );
 
 		// Clear the color buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        RsGL::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         
-        err = glGetError();
+        err = RsGL::GetError();
         if (err != GL_NO_ERROR)
             printf( "RsRenderTargetWinGL::Render. glError: 0x%04X", err);
 	}
     else if( IsZCleared() )
     {
-        glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        RsGL::Clear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         
-        err = glGetError();
+        err = RsGL::GetError();
         if (err != GL_NO_ERROR)
             printf( "RsRenderTargetWinGL::Render. glError: 0x%04X", err);
     }
     
+	// Sort the meshes and skins of every layer up front
+	BtU32 numSorted = 0;
+	BtU32 iSorted = 0;
+	const LRsSortItem *pSorted = LRsSortMeshes( m_nodes, m_skinNodes, m_camera.GetView(), numSorted );
+
 	for( BtU32 sortOrder=0; sortOrder<MaxSortOrders; sortOrder++ )
 	{
 		// Render the materials
-		RsMaterialRenderable *pMaterialRenderable = m_materials[sortOrder].pHead();
+		LRsRenderBatched( m_materials[sortOrder].pHead(), LRsGetMaterialKey, LRsRenderMaterial );
 
-		while( pMaterialRenderable )
+		if( pSorted != BtNull )
 		{
-			// Render the material
-			RsMaterialImpl *pMaterial = (RsMaterialImpl*)pMaterialRenderable->m_pMaterial;
-
-            if( pMaterial )
-            {
-			// Render the material
-			pMaterial->Render( pMaterialRenderable );
-            }
-            
-			// Go to the next renderable
-			pMaterialRenderable = pMaterialRenderable->pNext();
+			// Render this layer's meshes and skins in key order
+			BtU32 iEnd = iSorted;
+
+			while( ( iEnd < numSorted ) && ( ( pSorted[iEnd].m_key >> RsSortKey_LayerShift ) == sortOrder ) )
+			{
+				++iEnd;
+			}
+
+			while( iSorted < iEnd )
+			{
+				if( g_isInstancing == BtTrue )
+				{
+					iSorted += LRsRenderInstanced( pSorted + iSorted, iEnd - iSorted );
+				}
+				else
+				{
+					LRsRenderSortItem( pSorted[iSorted] );
+					++iSorted;
+				}
+			}
 		}
-
-		// Render the nodes
-		SgMeshRenderable *pNodeRenderable = m_nodes[sortOrder].pHead();
-
-		while( pNodeRenderable )
+		else
 		{
-			// Render the texture
-			SgMeshWinGL *pMesh = (SgMeshWinGL*)pNodeRenderable->m_pMesh;
+			// Render the nodes
+			SgMeshRenderable *pNodeRenderable = m_nodes[sortOrder].pHead();
 
-			// Render the node
-			pMesh->Render( pNodeRenderable );
-            
-			// Go to the next renderable
-			pNodeRenderable = pNodeRenderable->pNext();
-		}
-        
-		// Render the skin
-		SgSkinRenderable *pSkinRenderable = m_skinNodes[sortOrder].pHead();
-    
-		while( pSkinRenderable )
-		{
-			SgSkinImpl *pSkin = (SgSkinImpl*)pSkinRenderable->m_pSkin;
-            
-			// Render the skin
-			pSkin->Render( pSkinRenderable );
-            
-			// Go to the next renderable
-			pSkinRenderable = (SgSkinRenderable*)pSkinRenderable->pNext();
-		}
-        
-        // Render the textures
-		RsTextureRenderable *pTextureRenderable = m_textures[sortOrder].pHead();
+			while( pNodeRenderable )
+			{
+				// Render the texture
+				SgMeshWinGL *pMesh = (SgMeshWinGL*)pNodeRenderable->m_pMesh;
 
-		while( pTextureRenderable )
-		{
-			// Render the texture
-			RsTextureImpl *pTexture = (RsTextureImpl*)pTextureRenderable->m_pTexture;
+				// Render the node
+				pMesh->Render( pNodeRenderable );
 
-			pTexture->Render( pTextureRenderable );
-            
-            err = glGetError();
-            if (err != GL_NO_ERROR)
-                printf( "RsTextureRenderable. glError: 0x%04X", err);
-            
-			// Go to the next renderable
-			pTextureRenderable = pTextureRenderable->pNext();
-		}
+				// Go to the next renderable
+				pNodeRenderable = pNodeRenderable->pNext();
+			}
 
-		// Render the sprites
-		RsSpriteRenderable *pSpriteRenderable = m_sprites[sortOrder].pHead();
+			// Render the skin
+			SgSkinRenderable *pSkinRenderable = m_skinNodes[sortOrder].pHead();
 
-		while( pSpriteRenderable )
-		{
-			RsSpriteImpl *pSprite = (RsSpriteImpl*) pSpriteRenderable->m_pSprite;
+			while( pSkinRenderable )
+			{
+				SgSkinImpl *pSkin = (SgSkinImpl*)pSkinRenderable->m_pSkin;
 
-			// Render the texture
-			pSprite->Render( pSpriteRenderable );
+				// Render the skin
+				pSkin->Render( pSkinRenderable );
 
-			// Go to the next renderable
-			pSpriteRenderable = pSpriteRenderable->pNext();
+				// Go to the next renderable
+				pSkinRenderable = (SgSkinRenderable*)pSkinRenderable->pNext();
+			}
 		}
 
-		// Render the fonts
-		RsFontRenderable *pFontRenderable = m_fonts[sortOrder].pHead();
-
-		while( pFontRenderable )
-		{
-			// Cache the font
-			RsFontImpl *pFont = (RsFontImpl*)pFontRenderable->m_pFont;
+        // Render the textures
+		LRsRenderBatched( m_textures[sortOrder].pHead(), LRsGetTextureKey, LRsRenderTexture );
 
-			// Render the font
-			pFont->Render( pFontRenderable );
+		// Render the sprites
+		LRsRenderBatched( m_sprites[sortOrder].pHead(), LRsGetSpriteKey, LRsRenderSprite );
 
-			// Go to the next renderable
-			pFontRenderable = pFontRenderable->pNext();
-		}
+		// Render the fonts
+		LRsRenderBatched( m_fonts[sortOrder].pHead(), LRsGetFontKey, LRsRenderFont );
   	}
 }
@@ -38,6 +38,23 @@ public:
     void                                    Add( BtU32 sortOrder, SgSkinRenderable *pSkinRenderable );
 	void									Render();
 
+	// Neighbouring materials, textures, sprites and fonts with the same state are
+	// drawn together. Turn this off to compare
+	static void								SetBatching( BtBool isBatching );
+
+	// Meshes and skins are drawn in sort key order rather than the order they were
+	// added. Turn this off to compare
+	static void								SetSorting( BtBool isSorting );
+
+	// The sort starts with room for 8192 meshes and skins and doubles whenever a render
+	// target has more. The render system frees it when it is destroyed
+	static BtU32							GetNumSortGrowths();
+	static void								FreeSortItems();
+
+	// Sorted opaque meshes that share geometry and material are drawn with one instanced
+	// draw. Turn this off to compare
+	static void								SetInstancing( BtBool isInstancing );
+
 protected:
 
 	BtLinkedList<RsFontRenderable>			m_fonts[MaxSortOrders];
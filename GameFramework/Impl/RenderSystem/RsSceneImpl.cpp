@@ -4,6 +4,8 @@
 #include "BtMemory.h"
 #include "BaArchive.h"
 #include "RsSceneImpl.h"
+#include "RsVertexBufferImpl.h"
+#include "RsIndexBufferImpl.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // FixPointers
@@ -40,4 +42,19 @@ void RsSceneImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 
 void RsSceneImpl::CreateOnDevice()
 {
+	// Our buffers are already on the device. Pair each vertex format with the index buffer
+	RsIndexBufferImpl *pIndices = pIndexBuffer();
+
+	if( pIndices == BtNull )
+	{
+		return;
+	}
+
+	for( BtU32 i=0; i<1024; i++ )
+	{
+		if( m_pFileData->m_nVertexBuffer[i] != BtNull )
+		{
+			pVertexBuffer( i )->CreateVertexArray( pIndices );
+		}
+	}
 }
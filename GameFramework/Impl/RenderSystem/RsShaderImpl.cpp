@@ -11,10 +11,130 @@
 #include "RsIndexBufferImpl.h"
 #include "RsImpl.h"
 #include "ErrorLog.h"
+#include "RsGL.h"
+#include "BtCRC.h"
+#include "BtTime.h"
+#include "ApConfig.h"
+#include "FsFile.h"
+#include "MtMath.h"
+#include "RsManagerImpl.h"
+#include "RsCamera.h"
 #include <new>
+#include <string.h>
 
 static BtU32 m_currentProgram = 0;
 
+// The built in techniques in RsTechniques order. Hashes are filled in when they're first looked up
+static RsTechnique g_techniques[MaxTechniques] =
+{
+	// Name					Program					Depth	Depth func	Cull	Front face	Blend	Source blend	Destination blend			Hash
+	{ "RsShaderAdditive",	RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "lensflare",			RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_ONE,			GL_ONE,					0 },
+	{ "RsShadow",			RsShadow,				BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsProjectedShadow",	RsProjectedTexture,		BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderT2",			RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderTG",			RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderTG2",		RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderT",			RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZL",			RsShaderLit,			BtTrue,		GL_LEQUAL,	BtTrue,		GL_CW,	BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZLTGD",		RsShaderLitTextured,	BtTrue,		0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZLT",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZLTG",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZTG",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsShaderZLTS",		RsShaderSkin,			BtTrue,		GL_LEQUAL,	BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+	{ "RsYUVToRGB",			RsYUVToRGB,				BtFalse,	0,			BtFalse,	0,		BtTrue,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA,	0 },
+};
+
+static BtBool g_isProgramCache = BtTrue;
+
+static BtU32 g_numTechniques = RsTechnique_BuiltIn;
+static BtBool g_isTechniquesHashed = BtFalse;
+
+// The uniform each RsHandles value is sent to
+struct LRsHandleUniform
+{
+	const BtChar*						m_name;
+	GLenum								m_type;
+	BtU32								m_count;
+};
+
+static const LRsHandleUniform g_handleUniforms[RsHandles_MAX] =
+{
+	{ "s_m4World",						GL_FLOAT_MAT4,	1 },
+	{ "s_m4View",						GL_FLOAT_MAT4,	1 },
+	{ "s_m4ViewInverse",				GL_FLOAT_MAT4,	1 },
+	{ "s_m4WorldView",					GL_FLOAT_MAT4,	1 },
+	{ "s_m4ViewScreen",					GL_FLOAT_MAT4,	1 },
+	{ "s_m4WorldViewScreen",			GL_FLOAT_MAT4,	1 },
+	{ "s_cameraPosition",				GL_FLOAT_VEC4,	1 },
+	{ "s_blendWeights",					GL_FLOAT_VEC4,	1 },
+	{ "s_m4WorldViewInverseTranspose",	GL_FLOAT_MAT4,	1 },
+	{ "s_m4ViewInverseTranspose",		GL_FLOAT_MAT4,	1 },
+	{ "s_lightDirection",				GL_FLOAT_VEC4,	1 },
+	{ "s_lightAmbient",					GL_FLOAT_VEC4,	1 },
+	{ "s_m4ProjectionTexture",			GL_FLOAT_MAT4,	1 },
+	{ "s_m4BoneMatrices",				GL_FLOAT_MAT4,	MaxBoneMatrices },
+	{ "s_materialColour",				GL_FLOAT_VEC4,	1 },
+};
+
+// Blocks are found by these names in RsUniformBlock order
+static const BtChar* g_blockNames[RsUniformBlock_Max] =
+{
+	"RsFrame",
+	"RsView",
+	"RsObject",
+};
+
+// Which shader and program each binding point holds a block for
+static const RsShaderImpl* g_pBlockShader[RsUniformBlock_Max];
+static BtU32 g_blockProgram[RsUniformBlock_Max];
+
+static BtU8 g_blockData[MaxUniformBlockSize];
+
+// The last shader to send its values. Duplicates share their programs
+static const RsShaderImpl* g_pCommitShader = BtNull;
+
+static BtU32 g_valueVersion = 0;
+
+// The lit vertex shaders with the world matrix taken per instance. Instanced nodes have
+// no non-uniform scale so the world view matrix can stand in for its inverse transpose.
+// The alpha is defined in front of this as the lit and lit textured shaders differ
+static const GLchar* g_instancedVertexShader =
+	"attribute vec4 position;\n"
+	"attribute vec4 normal;\n"
+	"attribute vec4 colour;\n"
+	"attribute vec4 tex0;\n"
+	"attribute mat4 instanceWorld;\n"
+	"\n"
+	"uniform vec4 s_lightAmbient;\n"
+	"uniform vec4 s_lightDirection;\n"
+	"uniform mat4 s_m4ViewScreen;\n"
+	"uniform mat4 s_m4View;\n"
+	"uniform mat4 s_m4ViewInverseTranspose;\n"
+	"\n"
+	"varying vec2 myTex;\n"
+	"varying vec4 myColour;\n"
+	"\n"
+	"void main(void)\n"
+	"{\n"
+	"	vec4 worldPosition = instanceWorld * position;\n"
+	"	gl_Position = s_m4ViewScreen * worldPosition;\n"
+	"\n"
+	"	myTex = tex0.xy;\n"
+	"\n"
+	"	vec4 normal4  = s_m4View * ( instanceWorld * vec4( normal.xyz, 0.0 ) );\n"
+	"	vec3 myNormal = normalize( normal4.xyz );\n"
+	"\n"
+	"	vec4 lightDir4  = s_m4ViewInverseTranspose * s_lightDirection;\n"
+	"	vec3 lightDir   = normalize( lightDir4.xyz );\n"
+	"\n"
+	"	float NdotL = max(dot(myNormal, lightDir), 0.0);\n"
+	"\n"
+	"	myColour = NdotL * colour;\n"
+	"	myColour += s_lightAmbient;\n"
+	"	myColour.a = RS_ALPHA;\n"
+	"}\n";
+
 ////////////////////////////////////////////////////////////////////////////////
 // Statics
 
@@ -23,24 +143,309 @@ void getError( int objectHandle )
 	GLint blen = 0;
 	GLsizei slen = 0;
     
-	glGetShaderiv( objectHandle, GL_INFO_LOG_LENGTH , &blen);
+	RsGL::GetShaderiv( objectHandle, GL_INFO_LOG_LENGTH , &blen);
 	if (blen > 1)
 	{
 		GLchar* compiler_log = (GLchar*)malloc(blen);
-		glGetShaderInfoLog(objectHandle, blen, &slen, compiler_log);
+		RsGL::GetShaderInfoLog(objectHandle, blen, &slen, compiler_log);
 		ErrorLog::Fatal_Printf( "%s\n", compiler_log );
 		free (compiler_log);
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SetProgramCache
+
+//static
+void RsShaderImpl::SetProgramCache( BtBool isEnabled )
+{
+	g_isProgramCache = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetSourceHash
+
+BtU32 RsShaderImpl::GetSourceHash()
+{
+	if( m_pArchive->GetPackerVersion() >= BaShaderHashVersion )
+	{
+		return m_pFileData->m_sourceHash;
+	}
+
+	// Older archives don't have the hash so make it the way the packer does
+	BtU32 start = 0xFFFFFFFF;
+	BtU32 end = 0;
+
+	for( BtU32 i=0; i<m_pFileData->m_count; i++ )
+	{
+		const BaShader &shaderData = m_pFileData->m_shaders[i];
+
+		start = MtMin( start, shaderData.m_offset );
+		end = MtMax( end, shaderData.m_offset + shaderData.m_size );
+	}
+
+	if( end > start )
+	{
+		return BtCRC::GenerateHashCode( (BtU8*)m_pFileData + start, end - start );
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramCacheHeader
+
+void RsShaderImpl::GetProgramCacheHeader( RsProgramCacheHeader &header )
+{
+	// Binaries only load on the driver that made them
+	const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+	BtChar driver[512];
+	driver[0] = 0;
+
+	for( BtU32 i=0; i<3; i++ )
+	{
+		const BtChar *pName = (const BtChar*)RsGL::GetString( names[i] );
+
+		if( pName != BtNull )
+		{
+			BtStrCat( driver, 512, pName );
+		}
+	}
+
+	header.m_magic = RsProgramCacheMagic;
+	header.m_version = RsProgramCacheVersion;
+	header.m_sourceHash = GetSourceHash();
+	header.m_builtInHash = BtCRC::GenerateHashCode( (const BtU8*)g_instancedVertexShader, BtStrLength( g_instancedVertexShader ) );
+	header.m_driverHash = BtCRC::GenerateHashCode( (const BtU8*)driver, BtStrLength( driver ) );
+	header.m_numPrograms = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramCacheFilename
+
+void RsShaderImpl::GetProgramCacheFilename( BtChar *filename, BtU32 size )
+{
+	// The resource path may be read only so keep the cache with the documents
+	BtStrCopy( filename, size, ApConfig::GetDocuments() );
+	BtStrCat( filename, size, m_pArchive->GetFilename() );
+	BtStrCat( filename, size, ".glcache" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LoadProgramCache
+
+// Reads the cache file and points m_pCacheBinary at each program's binary. Nothing is
+// used from a cache made from other source or on another driver
+void RsShaderImpl::LoadProgramCache()
+{
+	BtChar filename[256];
+	GetProgramCacheFilename( filename, 256 );
+
+	FsFile file;
+	file.Open( filename, FsMode_Read );
+
+	if( file.IsOpen() == BtFalse )
+	{
+		return;
+	}
+
+	BtU32 size = file.GetSize();
+
+	if( size < sizeof( RsProgramCacheHeader ) )
+	{
+		file.Close();
+		return;
+	}
+
+	m_pCacheMemory = BtMemory::Allocate( BtMT_Render, size );
+	BtU32 bytesRead = file.Read( m_pCacheMemory, size );
+	file.Close();
+
+	RsProgramCacheHeader header;
+	GetProgramCacheHeader( header );
+
+	const RsProgramCacheHeader *pHeader = (const RsProgramCacheHeader*)m_pCacheMemory;
+
+	if( ( bytesRead != size ) ||
+		( pHeader->m_magic != header.m_magic ) ||
+		( pHeader->m_version != header.m_version ) ||
+		( pHeader->m_sourceHash != header.m_sourceHash ) ||
+		( pHeader->m_builtInHash != header.m_builtInHash ) ||
+		( pHeader->m_driverHash != header.m_driverHash ) )
+	{
+		ErrorLog::Printf( "Ignoring out of date program cache %s\n", filename );
+		return;
+	}
+
+	BtU32 offset = sizeof( RsProgramCacheHeader );
+
+	for( BtU32 iEntry=0; iEntry<pHeader->m_numPrograms; iEntry++ )
+	{
+		if( offset + sizeof( RsProgramCacheEntry ) > size )
+		{
+			break;
+		}
+
+		const RsProgramCacheEntry *pEntry = (const RsProgramCacheEntry*)( m_pCacheMemory + offset );
+		offset += sizeof( RsProgramCacheEntry );
+
+		if( ( pEntry->m_length > size - offset ) || ( pEntry->m_program >= MaxPrograms ) )
+		{
+			break;
+		}
+
+		m_pCacheBinary[pEntry->m_program] = m_pCacheMemory + offset;
+		m_cacheFormat[pEntry->m_program] = pEntry->m_format;
+		m_cacheLength[pEntry->m_program] = pEntry->m_length;
+
+		offset += pEntry->m_length;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveProgramCache
+
+void RsShaderImpl::SaveProgramCache()
+{
+#if defined( GL_PROGRAM_BINARY_LENGTH )
+	BtChar filename[256];
+	GetProgramCacheFilename( filename, 256 );
+
+	FsFile file;
+	file.Open( filename, FsMode_Write );
+
+	if( file.IsOpen() == BtFalse )
+	{
+		ErrorLog::Printf( "Can't write program cache %s\n", filename );
+		return;
+	}
+
+	RsProgramCacheHeader header;
+	GetProgramCacheHeader( header );
+
+	for( BtU32 i=0; i<MaxPrograms; i++ )
+	{
+		if( m_program[i] != 0 )
+		{
+			++header.m_numPrograms;
+		}
+	}
+	file.Write( header );
+
+	for( BtU32 i=0; i<MaxPrograms; i++ )
+	{
+		if( m_program[i] == 0 )
+		{
+			continue;
+		}
+
+		GLint length = 0;
+		RsGL::GetProgramiv( m_program[i], GL_PROGRAM_BINARY_LENGTH, &length );
+
+		BtU8 *pBinary = BtMemory::Allocate( BtMT_Render, MtMax( length, 1 ) );
+
+		GLsizei binaryLength = 0;
+		GLenum format = 0;
+		RsGL::GetProgramBinary( m_program[i], length, &binaryLength, &format, pBinary );
+
+		// An empty entry just fails to load next time
+		RsProgramCacheEntry entry;
+		entry.m_program = i;
+		entry.m_format = format;
+		entry.m_length = binaryLength;
+
+		file.Write( entry );
+		file.Write( pBinary, binaryLength );
+
+		BtMemory::Free( pBinary );
+	}
+	file.Close();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LoadProgramBinary
+
+BtBool RsShaderImpl::LoadProgramBinary( BtU32 program )
+{
+	if( m_pCacheBinary[program] == BtNull )
+	{
+		return BtFalse;
+	}
+
+	RsGL::ProgramBinary( m_program[program], m_cacheFormat[program], m_pCacheBinary[program], m_cacheLength[program] );
+
+	// Drivers reject binaries they no longer understand, e.g. after an update
+	GLint status = 0;
+	RsGL::GetProgramiv( m_program[program], GL_LINK_STATUS, &status );
+
+	return ( status != 0 ) ? BtTrue : BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CompileShader
+
+GLuint RsShaderImpl::CompileShader( GLenum type, GLsizei count, const GLchar* const* pText, const GLint *pLength )
+{
+	GLint status;
+
+	GLuint shader = RsGL::CreateShader( type );
+
+	RsGL::ShaderSource( shader, count, pText, pLength );
+	RsGL::CompileShader( shader );
+	RsGL::GetShaderiv( shader, GL_COMPILE_STATUS, &status );
+	if( status == 0 )
+	{
+		if( type == GL_FRAGMENT_SHADER )
+		{
+			ErrorLog::Printf( "Error compiling pixel shader = %s\n", pText[count - 1] );
+		}
+		getError( shader );
+	}
+	return shader;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LinkProgram
+
+// Attribute locations are bound before the one link. A cached binary has them already
+void RsShaderImpl::LinkProgram( BtU32 program, GLuint vertexShader, GLuint fragmentShader )
+{
+	RsGL::AttachShader( m_program[program], vertexShader );
+	RsGL::AttachShader( m_program[program], fragmentShader );
+
+	RsGL::BindAttribLocation( m_program[program], 0, "position" );
+	RsGL::BindAttribLocation( m_program[program], 1, "normal" );
+	RsGL::BindAttribLocation( m_program[program], 4, "colour" );
+	RsGL::BindAttribLocation( m_program[program], 5, "tex0" );
+
+	if( program == RsShaderSkin )
+	{
+		RsGL::BindAttribLocation( m_program[program], 6, "weights" );
+		RsGL::BindAttribLocation( m_program[program], 7, "boneIndex" );
+	}
+	else if( ( program == RsShaderLitInstanced ) || ( program == RsShaderLitTexturedInstanced ) )
+	{
+		RsGL::BindAttribLocation( m_program[program], RsInstanceWorldAttrib, "instanceWorld" );
+	}
+
+#if defined( GL_PROGRAM_BINARY_RETRIEVABLE_HINT )
+	if( m_isProgramCache == BtTrue )
+	{
+		RsGL::ProgramParameteri( m_program[program], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+	}
+#endif
+
+	RsGL::LinkProgram( m_program[program] );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // FixPointers
 
 void RsShaderImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 {
-    GLenum error = 0;
-    GLint status;
-    
+    BtU64 startTime = BtTime::GetElapsedTimeInNanoseconds();
+
     // Set the file data
     m_pFileData = (BaShaderFileData*) pFileData;
     m_pArchive = pArchive;
@@ -48,162 +453,166 @@ void RsShaderImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
     BtChar *pData = (BtChar*) m_pFileData;
     BtU32 i = 0;
     
+    for( BtU32 program=0; program<MaxPrograms; program++ )
+    {
+        m_program[program] = 0;
+        m_pCacheBinary[program] = BtNull;
+        m_numParameters[program] = 0;
+
+        for( BtU32 handle=0; handle<RsHandles_MAX; handle++ )
+        {
+            m_handles[program][handle] = -1;
+        }
+    }
+    m_pCacheMemory = BtNull;
+
+    ResetValues();
+
+    // Linking from the cache skips compiling altogether
+    m_isProgramCache = ( g_isProgramCache == BtTrue ) && ( RsGL::IsProgramBinarySupported() == BtTrue );
+
+    if( m_isProgramCache == BtTrue )
+    {
+        LoadProgramCache();
+    }
+
+    BtU32 numCached = 0;
+    
     for( BtU32 shaderIndex=0; shaderIndex<m_pFileData->m_count; shaderIndex = shaderIndex + 2 )
     {
-        m_program[i] = glCreateProgram();
-        
-        BaShader &vertexShaderData = m_pFileData->m_shaders[shaderIndex + 0];
-        BaShader &pixelShaderData  = m_pFileData->m_shaders[shaderIndex + 1];
-        
-        BtU32 vertexShader   = glCreateShader(GL_VERTEX_SHADER);
-        BtU32 fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        m_program[i] = RsGL::CreateProgram();
         
-        const GLchar *vertexText   = (const GLchar *)(pData + vertexShaderData.m_offset );
-        const GLchar *fragmentText = (const GLchar *)(pData + pixelShaderData.m_offset);
-        
-        glShaderSource( vertexShader, 1, &vertexText, (const GLint*)&vertexShaderData.m_size );
-        glShaderSource( fragmentShader, 1, &fragmentText, (const GLint*)&pixelShaderData.m_size);
-        
-        //ErrorLog::Printf( "Compiling vertex shader %d\n", shaderIndex );
-      
-        glCompileShader(vertexShader);
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status );
-        if( status == 0 )
+        if( LoadProgramBinary( i ) == BtTrue )
         {
-            getError( vertexShader );
+            ++numCached;
         }
-        
-        glCompileShader(fragmentShader);
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status );
-        if( status == 0 )
+        else
         {
-            ErrorLog::Printf( "Error compiling pixel shader %d = %s\n", shaderIndex, fragmentText );
-            getError( fragmentShader );
+            BaShader &vertexShaderData = m_pFileData->m_shaders[shaderIndex + 0];
+            BaShader &pixelShaderData  = m_pFileData->m_shaders[shaderIndex + 1];
+            
+            const GLchar *vertexText   = (const GLchar *)(pData + vertexShaderData.m_offset );
+            const GLchar *fragmentText = (const GLchar *)(pData + pixelShaderData.m_offset);
+            
+            GLuint vertexShader   = CompileShader( GL_VERTEX_SHADER, 1, &vertexText, (const GLint*)&vertexShaderData.m_size );
+            GLuint fragmentShader = CompileShader( GL_FRAGMENT_SHADER, 1, &fragmentText, (const GLint*)&pixelShaderData.m_size );
+            
+            LinkProgram( i, vertexShader, fragmentShader );
         }
-        //else
-        //{
-        //    ErrorLog::Printf( "Compiled pixel shader %d\n", i );
-        //}
-        
-        glAttachShader( m_program[i], vertexShader );
-        glAttachShader( m_program[i], fragmentShader );
-        glLinkProgram( m_program[i] );
+        RsGL::UseProgram( m_program[i] );
      
         // We don't need to use the program because its referenced explictly
         if( ( i != RsShaderPassThrough ) && ( i != RsYUVToRGB ) )
         {
-            m_handles[i][RsHandles_Light0Direction] = glGetUniformLocation(m_program[i], "s_lightDirection");
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_Light0Direction] = RsGL::GetUniformLocation(m_program[i], "s_lightDirection");
             
-            m_handles[i][RsHandles_LightAmbient] = glGetUniformLocation(m_program[i], "s_lightAmbient");
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_LightAmbient] = RsGL::GetUniformLocation(m_program[i], "s_lightAmbient");
             
-            m_handles[i][RsHandles_Colour] = glGetUniformLocation(m_program[i], "s_materialColour");
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_Colour] = RsGL::GetUniformLocation(m_program[i], "s_materialColour");
             
-            m_handles[i][RsHandles_World] = glGetUniformLocation(m_program[i], "s_m4World");
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_World] = RsGL::GetUniformLocation(m_program[i], "s_m4World");
             
-            m_handles[i][RsHandles_WorldViewScreen] = glGetUniformLocation( m_program[i], "s_m4WorldViewScreen" );
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_WorldViewScreen] = RsGL::GetUniformLocation( m_program[i], "s_m4WorldViewScreen" );
             
-            m_handles[i][RsHandles_WorldViewInverseTranspose] = glGetUniformLocation( m_program[i], "s_m4WorldViewInverseTranspose" );
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_WorldViewInverseTranspose] = RsGL::GetUniformLocation( m_program[i], "s_m4WorldViewInverseTranspose" );
             
-            m_handles[i][RsHandles_ViewInverseTranspose] = glGetUniformLocation( m_program[i], "s_m4ViewInverseTranspose" );
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_ViewInverseTranspose] = RsGL::GetUniformLocation( m_program[i], "s_m4ViewInverseTranspose" );
         }
         if (i == RsProjectedTexture )
         {
-            m_handles[i][RsHandles_World] = glGetUniformLocation(m_program[i], "s_m4World");
-            error = glGetError();
-            (void)error;
-            
-            m_handles[i][RsHandles_TextureMatrix0] = glGetUniformLocation(m_program[i], "s_m4ProjectionTexture");
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_World] = RsGL::GetUniformLocation(m_program[i], "s_m4World");
             
-            MtMatrix4 m4Matrix;
-            m4Matrix.SetIdentity();
-            glUniformMatrix4fv( m_handles[i][RsHandles_TextureMatrix0], 1, GL_FALSE, (const GLfloat*)&m4Matrix );
-            
-            error = glGetError();
-            (void)error;
-            int a = 0;
-            a++;
+            m_handles[i][RsHandles_TextureMatrix0] = RsGL::GetUniformLocation(m_program[i], "s_m4ProjectionTexture");
         }
-        
-        glBindAttribLocation( m_program[i], 0, "position" );
-        error = glGetError();
-        (void)error;
-        
-        glBindAttribLocation( m_program[i], 1, "normal" );
-        error = glGetError();
-        (void)error;
-        
-        glBindAttribLocation( m_program[i], 4, "colour" );
-        error = glGetError();
-        (void)error;
-        
-        glBindAttribLocation( m_program[i], 5, "tex0" );
-        error = glGetError();
-        (void)error;
-        
         if( i == RsShaderSkin )
         {
-            m_handles[i][RsHandles_BoneMatrix] = glGetUniformLocation( m_program[i], "s_m4BoneMatrices" );
-            
-            error = glGetError();
-            (void)error;
-            
-            glBindAttribLocation( m_program[i], 6, "weights" );
-            
-            error = glGetError();
-            (void)error;
-            
-            glBindAttribLocation( m_program[i], 7, "boneIndex" );
-            
-            error = glGetError();
-            (void)error;
+            m_handles[i][RsHandles_BoneMatrix] = RsGL::GetUniformLocation( m_program[i], "s_m4BoneMatrices" );
         }
         
-        glLinkProgram( m_program[i] );
-        glUseProgram( m_program[i] );
-        
         // Sets sampler location against current program
-        m_sampler[i][0] = glGetUniformLocation( m_program[i], "myTexture" );
-        m_sampler[i][1] = glGetUniformLocation( m_program[i], "myTexture2" );
+        m_sampler[i][0] = RsGL::GetUniformLocation( m_program[i], "myTexture" );
+        m_sampler[i][1] = RsGL::GetUniformLocation( m_program[i], "myTexture2" );
+        
+        ReflectProgram( i );
         
-        if( i == RsShaderPassThrough )
+        ++i;
+    }
+    BtU32 numPrograms = i;
+
+    // Build the instanced lit programs against the archive's lit fragment shaders
+    if( ( RsGL::IsInstancingSupported() == BtTrue ) && ( i > RsShaderLitTextured ) )
+    {
+        BtAssert( i <= RsShaderLitInstanced );
+
+        if( CreateInstancedProgram( RsShaderLitInstanced, RsShaderLit, "#define RS_ALPHA 1.0\n" ) == BtTrue )
         {
-            //printf( "%s", fragmentText );
-            int a=0;
-            a++;
+            ++numCached;
         }
-        else if( i == RsYUVToRGB )
+        if( CreateInstancedProgram( RsShaderLitTexturedInstanced, RsShaderLitTextured, "#define RS_ALPHA colour.a\n" ) == BtTrue )
         {
-            printf( "%d\n", m_sampler[i][0] );
-            printf( "%d\n", m_sampler[i][1] );
-            int a=0;
-            a++;
+            ++numCached;
         }
-        
-        error = glGetError();
-        (void)error;
-        
-        ++i;
+        numPrograms += 2;
     }
-    glUseProgram( BtNull );
-    
-    int a=0;
-    a++;
+    RsGL::UseProgram( BtNull );
+
+    // Save the binaries for next time if any had to be compiled
+    if( ( m_isProgramCache == BtTrue ) && ( numCached < numPrograms ) )
+    {
+        SaveProgramCache();
+    }
+
+    BtMemory::Free( m_pCacheMemory );
+    m_pCacheMemory = BtNull;
+
+    for( BtU32 program=0; program<MaxPrograms; program++ )
+    {
+        m_pCacheBinary[program] = BtNull;
+    }
+
+    ErrorLog::Printf( "Loaded %d shader programs in %.2fms. %d from the program cache\n",
+                      numPrograms,
+                      ( BtTime::GetElapsedTimeInNanoseconds() - startTime ) / 1000000.0,
+                      numCached );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateInstancedProgram
+
+// Returns true if the program came from the program cache
+BtBool RsShaderImpl::CreateInstancedProgram( BtU32 program, BtU32 sourceProgram, const GLchar *pAlpha )
+{
+    m_program[program] = RsGL::CreateProgram();
+
+    BtBool isCached = LoadProgramBinary( program );
+
+    if( isCached == BtFalse )
+    {
+        BtChar *pData = (BtChar*) m_pFileData;
+        BaShader &pixelShaderData = m_pFileData->m_shaders[( sourceProgram * 2 ) + 1];
+
+        const GLchar *vertexText[2] = { pAlpha, g_instancedVertexShader };
+        const GLchar *fragmentText  = (const GLchar *)(pData + pixelShaderData.m_offset);
+
+        GLuint vertexShader   = CompileShader( GL_VERTEX_SHADER, 2, vertexText, BtNull );
+        GLuint fragmentShader = CompileShader( GL_FRAGMENT_SHADER, 1, &fragmentText, (const GLint*)&pixelShaderData.m_size );
+
+        LinkProgram( program, vertexShader, fragmentShader );
+    }
+    RsGL::UseProgram( m_program[program] );
+
+    m_handles[program][RsHandles_Light0Direction] = RsGL::GetUniformLocation( m_program[program], "s_lightDirection" );
+    m_handles[program][RsHandles_LightAmbient] = RsGL::GetUniformLocation( m_program[program], "s_lightAmbient" );
+    m_handles[program][RsHandles_ViewScreen] = RsGL::GetUniformLocation( m_program[program], "s_m4ViewScreen" );
+    m_handles[program][RsHandles_View] = RsGL::GetUniformLocation( m_program[program], "s_m4View" );
+    m_handles[program][RsHandles_ViewInverseTranspose] = RsGL::GetUniformLocation( m_program[program], "s_m4ViewInverseTranspose" );
+
+    m_sampler[program][0] = RsGL::GetUniformLocation( m_program[program], "myTexture" );
+    m_sampler[program][1] = RsGL::GetUniformLocation( m_program[program], "myTexture2" );
+
+    ReflectProgram( program );
+
+    return isCached;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -219,7 +628,7 @@ void RsShaderImpl::CreateOnDevice()
 RsShader* RsShaderImpl::pDuplicate()
 {
 	// Allocate the memory
-	BtU8* pMemory = BtMemory::Allocate( sizeof(RsShaderImpl) );
+	BtU8* pMemory = BtMemory::Allocate( BtMT_Render, sizeof(RsShaderImpl) );
     
 	// Create the class
 	RsShaderImpl* pShader = new( pMemory ) RsShaderImpl;
@@ -252,10 +661,11 @@ void RsShaderImpl::SetParams(BtU8 *paramData, BtU32 length)
 
 void RsShaderImpl::SetAmbient( const RsColour &colour )
 {
-    MtVector4 v4Ambient( colour.Red(), colour.Green(), colour.Blue(), 1.0f );
+    // The shaders add this to the lit colour so leave the alpha alone
+    MtVector4 v4Ambient( colour.Red(), colour.Green(), colour.Blue(), 0 );
     
     // Set the ambient lights
-    m_floats[RsHandles_LightAmbient]= v4Ambient;
+    SetValue( RsHandles_LightAmbient, (const BtFloat*)&v4Ambient, 4 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -265,7 +675,7 @@ void RsShaderImpl::SetDirectionalLight( const MtVector3 &v3Direction )
 {
     // Set the light direction
     MtVector4 v4Direction( v3Direction.x, v3Direction.y, v3Direction.z, 1.0f );
-    m_floats[RsHandles_Light0Direction] = v4Direction;
+    SetValue( RsHandles_Light0Direction, (const BtFloat*)&v4Direction, 4 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,169 +693,188 @@ void RsShaderImpl::RemoveFromDevice()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SetTechnique
+// LRsHashTechniqueName
 
-void RsShaderImpl::SetTechnique( const BtChar* pTechniqueName )
+static BtU32 LRsHashTechniqueName( const BtChar* pTechniqueName )
 {
-	GLenum error;
-	error = glGetError();
-	(void)error;
-    
-	// http://en.wikibooks.org/wiki/OpenGL_Programming/Stencil_buffer
-	if (BtStrCompare(pTechniqueName, "RsShaderAdditive") == BtTrue)
-	{
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		m_currentProgram = RsShaderTextured;
-	}
-	else if (BtStrCompare(pTechniqueName, "lensflare") == BtTrue)
-	{
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc( GL_ONE, GL_ONE );
-		m_currentProgram = RsShaderPassThrough;
-	}
-	else if (BtStrCompare(pTechniqueName, "RsShadow") == BtTrue)
-	{
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		m_currentProgram = RsShadow;
-	}
-	else if (BtStrCompare(pTechniqueName, "RsProjectedShadow") == BtTrue)
-	{
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		m_currentProgram = RsProjectedTexture;
-	}
-	else if( BtStrCompare( pTechniqueName, "RsShaderT2" ) == BtTrue )
-	{
-		glDisable( GL_CULL_FACE );
-		glDisable( GL_DEPTH_TEST );
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) ;
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderPassThrough;
-	}
-    else if( BtStrCompare( pTechniqueName, "RsShaderTG" ) == BtTrue )
-    {
-        glDisable( GL_CULL_FACE );
-        glDisable( GL_DEPTH_TEST );
-        glEnable( GL_BLEND );
-        glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) ;
-        
-        // Use The Program Object Instead Of Fixed Function OpenGL
-        m_currentProgram = RsShaderTextured;
-    }
-	else if( BtStrCompare( pTechniqueName, "RsShaderTG2" ) == BtTrue )
-	{
-		glDisable( GL_CULL_FACE );
-		glDisable( GL_DEPTH_TEST );
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) ;
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderPassThrough;
-	}
-	else if( BtStrCompare( pTechniqueName, "RsShaderT" ) == BtTrue )
+	return BtCRC::GenerateHashCode( (const BtU8*)pTechniqueName, BtStrLength( pTechniqueName ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsHashTechniques
+
+static void LRsHashTechniques()
+{
+	if( g_isTechniquesHashed == BtFalse )
 	{
-		glDisable( GL_DEPTH_TEST );
-		glDisable( GL_CULL_FACE );
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderTextured;
+		for( BtU32 i=0; i<g_numTechniques; i++ )
+		{
+			g_techniques[i].m_hash = LRsHashTechniqueName( g_techniques[i].m_name );
+		}
+		g_isTechniquesHashed = BtTrue;
 	}
-	else if( BtStrCompare( pTechniqueName, "RsShaderT" ) == BtTrue )
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetTechnique
+
+//static
+BtU32 RsShaderImpl::GetTechnique( const BtChar* pTechniqueName )
+{
+	LRsHashTechniques();
+
+	BtU32 hash = LRsHashTechniqueName( pTechniqueName );
+
+	for( BtU32 i=0; i<g_numTechniques; i++ )
 	{
-		glDisable( GL_DEPTH_TEST );
-		glDisable( GL_CULL_FACE );
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderTextured;
+		if( ( g_techniques[i].m_hash == hash ) && ( BtStrCompare( g_techniques[i].m_name, pTechniqueName ) == BtTrue ) )
+		{
+			return i;
+		}
 	}
-	else if( BtStrCompare( pTechniqueName, "RsShaderZL" ) == BtTrue )
+	return RsTechniqueNone;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RegisterTechnique
+
+//static
+BtU32 RsShaderImpl::RegisterTechnique( const RsTechnique &technique )
+{
+	BtU32 handle = GetTechnique( technique.m_name );
+
+	if( handle == RsTechniqueNone )
 	{
-		glEnable( GL_DEPTH_TEST );
-		glDepthFunc( GL_LEQUAL );
-		glEnable( GL_CULL_FACE );
-		glFrontFace(GL_CW);
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderLit;
+		if( g_numTechniques == MaxTechniques )
+		{
+			ErrorLog::Fatal_Printf( "Too many techniques registering %s\n", technique.m_name );
+			return RsTechniqueNone;
+		}
+		handle = g_numTechniques++;
 	}
-	else if (BtStrCompare(pTechniqueName, "RsShaderZLTGD"))
+
+	g_techniques[handle] = technique;
+	g_techniques[handle].m_hash = LRsHashTechniqueName( technique.m_name );
+
+	return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetTechniqueState
+
+//static
+const RsTechnique& RsShaderImpl::GetTechniqueState( BtU32 technique )
+{
+	BtAssert( technique < g_numTechniques );
+	return g_techniques[technique];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetTechnique
+
+void RsShaderImpl::SetTechnique( const BtChar* pTechniqueName )
+{
+	SetTechnique( GetTechnique( pTechniqueName ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetTechnique
+
+void RsShaderImpl::SetTechnique( BtU32 technique )
+{
+	SetTechniqueState( technique );
+
+	RsGL::UseProgram( m_program[m_currentProgram] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetInstancedTechnique
+
+BtBool RsShaderImpl::SetInstancedTechnique( BtU32 technique )
+{
+	if( technique >= g_numTechniques )
 	{
-		glEnable(GL_DEPTH_TEST);
-		glDisable(GL_CULL_FACE);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderLitTextured;
-	}
-	else if ( BtStrCompare(pTechniqueName, "RsShaderZLT") ||
-              BtStrCompare(pTechniqueName, "RsShaderZLTG") ||
-              BtStrCompare(pTechniqueName, "RsShaderZTG"))
-	{
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
-		glFrontFace(GL_CW);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderLitTextured;
+		return BtFalse;
 	}
-	else if( BtStrCompare( pTechniqueName, "RsShaderZLTS" ) )
+
+	BtU32 program = 0;
+
+	switch( g_techniques[technique].m_program )
 	{
-		glEnable( GL_DEPTH_TEST );
-		glDepthFunc( GL_LEQUAL );
-		glDisable( GL_CULL_FACE );
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-		// Use The Program Object Instead Of Fixed Function OpenGL
-		m_currentProgram = RsShaderSkin;
+		case RsShaderLit:
+			program = RsShaderLitInstanced;
+			break;
+		case RsShaderLitTextured:
+			program = RsShaderLitTexturedInstanced;
+			break;
+		default:
+			return BtFalse;
 	}
-    else if( BtStrCompare( pTechniqueName, "RsYUVToRGB" ) )
-    {
-        glDisable( GL_CULL_FACE );
-        glDisable( GL_DEPTH_TEST );
-        glEnable( GL_BLEND );
-        glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) ;
-        
-        // Use The Program Object Instead Of Fixed Function OpenGL
-        m_currentProgram = RsYUVToRGB;
-    }
-	else
+
+	if( m_program[program] == 0 )
 	{
-		//ErrorLog::Fatal_Printf( "Shader %s not implemented", pTechniqueName );
-        int a=0;
-        a++;
+		return BtFalse;
 	}
-    
-	glUseProgram( m_program[m_currentProgram] );
-    
-	switch( m_currentProgram )
+
+	SetTechniqueState( technique );
+
+	m_currentProgram = program;
+
+	RsGL::UseProgram( m_program[m_currentProgram] );
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetTechniqueState
+
+// Sets the fixed function state and picks the program but doesn't use it
+void RsShaderImpl::SetTechniqueState( BtU32 technique )
+{
+	// An unknown technique keeps the current state and program
+	if( technique < g_numTechniques )
 	{
-        case RsShaderLit:
-        case RsShaderLitTextured:
-        case RsShaderSkin:
-            SetLights( m_currentProgram );
-            break;
+		const RsTechnique &state = g_techniques[technique];
+
+		if( state.m_isDepthTest == BtTrue )
+		{
+			RsGL::Enable( GL_DEPTH_TEST );
+		}
+		else
+		{
+			RsGL::Disable( GL_DEPTH_TEST );
+		}
+
+		if( state.m_depthFunc != 0 )
+		{
+			RsGL::DepthFunc( state.m_depthFunc );
+		}
+
+		if( state.m_isCullFace == BtTrue )
+		{
+			RsGL::Enable( GL_CULL_FACE );
+		}
+		else
+		{
+			RsGL::Disable( GL_CULL_FACE );
+		}
+
+		if( state.m_frontFace != 0 )
+		{
+			RsGL::FrontFace( state.m_frontFace );
+		}
+
+		if( state.m_isBlend == BtTrue )
+		{
+			RsGL::Enable( GL_BLEND );
+			RsGL::BlendFunc( state.m_sourceBlend, state.m_destBlend );
+		}
+		else
+		{
+			RsGL::Disable( GL_BLEND );
+		}
+
+		m_currentProgram = state.m_program;
 	}
 }
 
@@ -454,6 +883,7 @@ void RsShaderImpl::SetTechnique( const BtChar* pTechniqueName )
 
 void RsShaderImpl::SetMatrix( const BtChar* pMatrix, const MtMatrix4& m4Matrix )
 {
+	SetValue( GetValue( pMatrix, 16 ), (const BtFloat*)&m4Matrix, 16 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -475,6 +905,11 @@ void SetPerspectiveProjection(float fovy, float aspect, float zNear, float zFar)
 
 void RsShaderImpl::SetCamera( const RsCamera &camera )
 {
+	MtVector4 v4Position( camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z, 1.0f );
+
+	SetMatrix( RsHandles_View, camera.GetView() );
+	SetMatrix( RsHandles_ViewScreen, camera.GetViewProjection() );
+	SetValue( RsHandles_CameraPosition, (const BtFloat*)&v4Position, 4 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -483,7 +918,7 @@ void RsShaderImpl::SetCamera( const RsCamera &camera )
 void RsShaderImpl::SetSampler( BtU32 iTexture )
 {
     // Set the sampler stage to the address from the shader
-    glUniform1i( m_sampler[m_currentProgram][iTexture], iTexture );
+    RsGL::Uniform1i( m_sampler[m_currentProgram][iTexture], iTexture );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -491,25 +926,9 @@ void RsShaderImpl::SetSampler( BtU32 iTexture )
 
 void RsShaderImpl::SetMatrix( RsHandles handle, const MtMatrix4& m4Matrix )
 {
-	if( handle == RsHandles_TextureMatrix0 )
-	{
-		GLenum error;
-        
-		glUseProgram( m_program[RsProjectedTexture] );
-        
-		error = glGetError();
-        
-		glUniformMatrix4fv( m_handles[RsProjectedTexture][handle], 1, GL_FALSE, (const GLfloat*)&m4Matrix);
-        
-		error = glGetError();
-        
-		int a = 0;
-		a++;
-	}
-	else
-	{
-		glUniformMatrix4fv( m_handles[m_currentProgram][handle], 1, GL_FALSE, (const GLfloat*)&m4Matrix );
-	}
+	// Programs pick this up the next time they draw. The texture matrix no longer
+	// needs the projected texture program in use to set it
+	SetValue( handle, (const BtFloat*)&m4Matrix, 16 );
 }
 
 // http://www.sjbaker.org/steve/omniv/opengl_lighting.html
@@ -520,7 +939,8 @@ void RsShaderImpl::SetMatrix( RsHandles handle, const MtMatrix4& m4Matrix )
 
 void RsShaderImpl::SetFloats( RsHandles handle, const BtFloat* pArray, BtU32 nCount )
 {
-	m_floats[handle] = MtVector4( pArray[0], pArray[1], pArray[2], 1.0f );
+	MtVector4 v4Value( pArray[0], pArray[1], pArray[2], 1.0f );
+	SetValue( handle, (const BtFloat*)&v4Value, 4 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -528,13 +948,7 @@ void RsShaderImpl::SetFloats( RsHandles handle, const BtFloat* pArray, BtU32 nCo
 
 void RsShaderImpl::SetMatrix( const BtChar* pMatrixName, const MtMatrix4* pMatrix, BtU32 nCount )
 {
-	glUniformMatrix4fv( m_handles[RsShaderSkin][RsHandles_BoneMatrix], nCount, GL_FALSE, (const GLfloat*)pMatrix );
-    
-	GLenum error = glGetError();
-	(void)error;
-    
-	int a=0;
-	a++;
+	SetValue( GetValue( pMatrixName, nCount * 16 ), (const BtFloat*)pMatrix, nCount * 16 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -542,6 +956,9 @@ void RsShaderImpl::SetMatrix( const BtChar* pMatrixName, const MtMatrix4* pMatri
 
 void RsShaderImpl::SetColour( const BtChar* pColourName, const RsColour& colour )
 {
+	BtFloat v4Colour[4] = { colour.Red(), colour.Green(), colour.Blue(), colour.Alpha() };
+
+	SetValue( GetValue( pColourName, 4 ), v4Colour, 4 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -549,6 +966,7 @@ void RsShaderImpl::SetColour( const BtChar* pColourName, const RsColour& colour
 
 void RsShaderImpl::SetFloats( const BtChar* pArrayName, const BtFloat* pArray, BtU32 nCount )
 {
+	SetValue( GetValue( pArrayName, nCount ), pArray, nCount );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -556,13 +974,409 @@ void RsShaderImpl::SetFloats( const BtChar* pArrayName, const BtFloat* pArray, B
 
 void RsShaderImpl::SetFloat( const BtChar* pName, BtFloat value )
 {
+	SetValue( GetValue( pName, 1 ), &value, 1 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // SetInteger
 
+// Integers are kept with the rest of the values and converted as they are sent
 void RsShaderImpl::SetInteger( const BtChar* pName, BtU32 value )
 {
+	BtFloat floatValue = (BtFloat)value;
+
+	SetValue( GetValue( pName, 1 ), &floatValue, 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsFloatsPerElement
+
+// Zero for the types we don't set, e.g. samplers which are set with SetSampler
+static BtU32 LRsFloatsPerElement( GLenum type )
+{
+	switch( type )
+	{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_BOOL:
+			return 1;
+		case GL_FLOAT_VEC2:
+			return 2;
+		case GL_FLOAT_VEC3:
+			return 3;
+		case GL_FLOAT_VEC4:
+			return 4;
+		case GL_FLOAT_MAT4:
+			return 16;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRsHashValueName
+
+static BtU32 LRsHashValueName( const BtChar* pName )
+{
+	return BtCRC::GenerateHashCode( (const BtU8*)pName, BtStrLength( pName ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// InvalidateBlocks
+
+//static
+void RsShaderImpl::InvalidateBlocks()
+{
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		g_pBlockShader[block] = BtNull;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ResetValues
+
+void RsShaderImpl::ResetValues()
+{
+	m_numValues = 0;
+	m_numValueFloats = 0;
+
+	// The handles come first so they index their own values
+	for( BtU32 handle=0; handle<RsHandles_MAX; handle++ )
+	{
+		const LRsHandleUniform &uniform = g_handleUniforms[handle];
+
+		GetValue( uniform.m_name, LRsFloatsPerElement( uniform.m_type ) * uniform.m_count );
+	}
+
+	// Projected textures draw unprojected until they are given a matrix
+	MtMatrix4 m4Identity;
+	m4Identity.SetIdentity();
+	SetValue( RsHandles_TextureMatrix0, (const BtFloat*)&m4Identity, 16 );
+
+	// Nothing sent before now matches the new programs
+	InvalidateBlocks();
+	g_pCommitShader = BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetValue
+
+// Finds or adds the named value with room for at least numFloats. Returns
+// MaxShaderValues if there is no room left
+BtU32 RsShaderImpl::GetValue( const BtChar *pName, BtU32 numFloats )
+{
+	BtU32 hash = LRsHashValueName( pName );
+	BtU32 iValue = 0;
+
+	while( iValue < m_numValues )
+	{
+		if( ( m_values[iValue].m_hash == hash ) && ( BtStrCompare( m_values[iValue].m_name, pName ) == BtTrue ) )
+		{
+			break;
+		}
+		++iValue;
+	}
+
+	if( iValue == m_numValues )
+	{
+		if( ( m_numValues == MaxShaderValues ) || ( BtStrLength( pName ) >= MaxShaderValueName ) )
+		{
+			ErrorLog::Fatal_Printf( "RsShaderImpl can't add the value %s\n", pName );
+			return MaxShaderValues;
+		}
+
+		RsShaderValue &value = m_values[m_numValues++];
+		BtStrCopy( value.m_name, MaxShaderValueName, pName );
+		value.m_hash = hash;
+		value.m_offset = m_numValueFloats;
+		value.m_numFloats = 0;
+		value.m_capacity = 0;
+		value.m_version = 0;
+	}
+
+	RsShaderValue &value = m_values[iValue];
+
+	if( value.m_capacity < numFloats )
+	{
+		if( m_numValueFloats + numFloats > MaxShaderValueFloats )
+		{
+			ErrorLog::Fatal_Printf( "RsShaderImpl is out of room for the value %s\n", pName );
+			return MaxShaderValues;
+		}
+
+		// Move to the end of the pool unless it's already there
+		if( value.m_offset + value.m_capacity != m_numValueFloats )
+		{
+			BtMemory::Copy( &m_valueData[m_numValueFloats], &m_valueData[value.m_offset], value.m_numFloats * sizeof( BtFloat ) );
+			value.m_offset = m_numValueFloats;
+			m_numValueFloats += numFloats;
+		}
+		else
+		{
+			m_numValueFloats += numFloats - value.m_capacity;
+		}
+		value.m_capacity = numFloats;
+	}
+
+	return iValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetValue
+
+// Values only change version when they change so unchanged ones are never sent again
+void RsShaderImpl::SetValue( BtU32 iValue, const BtFloat *pData, BtU32 numFloats )
+{
+	if( iValue >= m_numValues )
+	{
+		return;
+	}
+
+	RsShaderValue &value = m_values[iValue];
+	BtFloat *pValueData = &m_valueData[value.m_offset];
+
+	BtAssert( numFloats <= value.m_capacity );
+	numFloats = MtMin( numFloats, value.m_capacity );
+
+	if( ( value.m_version != 0 ) &&
+		( value.m_numFloats == numFloats ) &&
+		( memcmp( pValueData, pData, numFloats * sizeof( BtFloat ) ) == 0 ) )
+	{
+		return;
+	}
+
+	BtMemory::Copy( pValueData, pData, numFloats * sizeof( BtFloat ) );
+	value.m_numFloats = numFloats;
+
+	// Skip zero, which means never set
+	if( ++g_valueVersion == 0 )
+	{
+		++g_valueVersion;
+	}
+	value.m_version = g_valueVersion;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AddParameter
+
+void RsShaderImpl::AddParameter( BtU32 program, const BtChar *pName, const RsShaderParameter &parameter )
+{
+	if( m_numParameters[program] == MaxProgramParameters )
+	{
+		ErrorLog::Fatal_Printf( "Program %d has more than %d uniforms. %s won't be set\n", program, MaxProgramParameters, pName );
+		return;
+	}
+
+	BtU32 iValue = GetValue( pName, LRsFloatsPerElement( parameter.m_type ) * parameter.m_count );
+
+	if( iValue == MaxShaderValues )
+	{
+		return;
+	}
+
+	RsShaderParameter &added = m_parameters[program][m_numParameters[program]++];
+	added = parameter;
+	added.m_value = iValue;
+	added.m_version = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ReflectProgram
+
+// Finds every uniform the program reads and which value it takes, and binds its blocks
+void RsShaderImpl::ReflectProgram( BtU32 program )
+{
+	GLuint glProgram = m_program[program];
+	GLuint blockIndex[RsUniformBlock_Max];
+	BtBool isUniformBuffer = RsGL::IsUniformBufferSupported();
+
+	m_numParameters[program] = 0;
+
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		blockIndex[block] = RsGLNoBlock;
+		m_blockSize[program][block] = 0;
+	}
+
+#if defined( GL_UNIFORM_BUFFER )
+	if( isUniformBuffer == BtTrue )
+	{
+		for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+		{
+			GLuint index = RsGL::GetUniformBlockIndex( glProgram, g_blockNames[block] );
+
+			if( index == RsGLNoBlock )
+			{
+				continue;
+			}
+
+			GLint size = 0;
+			RsGL::GetActiveUniformBlockiv( glProgram, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size );
+
+			if( size > (GLint)MaxUniformBlockSize )
+			{
+				ErrorLog::Fatal_Printf( "Uniform block %s is %d bytes. The most we send is %d\n", g_blockNames[block], size, MaxUniformBlockSize );
+				continue;
+			}
+
+			// Each block has its own binding point in every program
+			RsGL::UniformBlockBinding( glProgram, index, block );
+
+			blockIndex[block] = index;
+			m_blockSize[program][block] = size;
+		}
+	}
+#endif
+
+	GLint numUniforms = 0;
+	RsGL::GetProgramiv( glProgram, GL_ACTIVE_UNIFORMS, &numUniforms );
+
+	for( GLuint uniform=0; uniform<(GLuint)numUniforms; uniform++ )
+	{
+		GLchar name[MaxShaderValueName];
+		GLsizei length = 0;
+		GLint count = 0;
+		GLenum type = 0;
+
+		RsGL::GetActiveUniform( glProgram, uniform, MaxShaderValueName, &length, &count, &type, name );
+
+		if( LRsFloatsPerElement( type ) == 0 )
+		{
+			continue;
+		}
+
+		// Arrays are named by their first element
+		if( ( length > 3 ) && ( BtStrCompare( name + length - 3, "[0]" ) == BtTrue ) )
+		{
+			name[length - 3] = 0;
+		}
+
+		RsShaderParameter parameter;
+		parameter.m_type = type;
+		parameter.m_count = count;
+		parameter.m_location = -1;
+		parameter.m_block = RsUniformNoBlock;
+		parameter.m_blockOffset = 0;
+		parameter.m_arrayStride = 0;
+		parameter.m_matrixStride = 0;
+
+#if defined( GL_UNIFORM_BUFFER )
+		GLint uniformBlock = -1;
+
+		if( isUniformBuffer == BtTrue )
+		{
+			RsGL::GetActiveUniformsiv( glProgram, 1, &uniform, GL_UNIFORM_BLOCK_INDEX, &uniformBlock );
+		}
+
+		if( uniformBlock != -1 )
+		{
+			for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+			{
+				if( blockIndex[block] == (GLuint)uniformBlock )
+				{
+					parameter.m_block = block;
+				}
+			}
+
+			if( parameter.m_block == RsUniformNoBlock )
+			{
+				ErrorLog::Printf( "%s is in a uniform block we don't send. Use RsFrame, RsView or RsObject\n", name );
+				continue;
+			}
+
+			GLint offset = 0;
+			GLint arrayStride = 0;
+			GLint matrixStride = 0;
+			RsGL::GetActiveUniformsiv( glProgram, 1, &uniform, GL_UNIFORM_OFFSET, &offset );
+			RsGL::GetActiveUniformsiv( glProgram, 1, &uniform, GL_UNIFORM_ARRAY_STRIDE, &arrayStride );
+			RsGL::GetActiveUniformsiv( glProgram, 1, &uniform, GL_UNIFORM_MATRIX_STRIDE, &matrixStride );
+
+			parameter.m_blockOffset = offset;
+			parameter.m_arrayStride = arrayStride;
+			parameter.m_matrixStride = matrixStride;
+		}
+#endif
+
+		if( parameter.m_block == RsUniformNoBlock )
+		{
+			parameter.m_location = RsGL::GetUniformLocation( glProgram, name );
+		}
+
+		AddParameter( program, name, parameter );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UploadParameter
+
+void RsShaderImpl::UploadParameter( const RsShaderParameter &parameter, const RsShaderValue &value )
+{
+	GLsizei count = MtMin( parameter.m_count, value.m_numFloats / LRsFloatsPerElement( parameter.m_type ) );
+
+	if( count == 0 )
+	{
+		return;
+	}
+
+	const BtFloat *pData = &m_valueData[value.m_offset];
+
+	switch( parameter.m_type )
+	{
+		case GL_FLOAT:
+			RsGL::Uniform1fv( parameter.m_location, count, pData );
+			break;
+		case GL_FLOAT_VEC2:
+			RsGL::Uniform2fv( parameter.m_location, count, pData );
+			break;
+		case GL_FLOAT_VEC3:
+			RsGL::Uniform3fv( parameter.m_location, count, pData );
+			break;
+		case GL_FLOAT_VEC4:
+			RsGL::Uniform4fv( parameter.m_location, count, pData );
+			break;
+		case GL_FLOAT_MAT4:
+			RsGL::UniformMatrix4fv( parameter.m_location, count, GL_FALSE, pData );
+			break;
+		case GL_INT:
+		case GL_BOOL:
+			RsGL::Uniform1i( parameter.m_location, (GLint)pData[0] );
+			break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CopyParameter
+
+// Lays the value out in the block the way the program reported. Matrices are column major
+void RsShaderImpl::CopyParameter( BtU8 *pBlock, const RsShaderParameter &parameter, const RsShaderValue &value )
+{
+	BtU32 floatsPerElement = LRsFloatsPerElement( parameter.m_type );
+	BtU32 numColumns = ( parameter.m_type == GL_FLOAT_MAT4 ) ? 4 : 1;
+	BtU32 numRows = floatsPerElement / numColumns;
+	BtU32 count = MtMin( parameter.m_count, value.m_numFloats / floatsPerElement );
+
+	const BtFloat *pData = &m_valueData[value.m_offset];
+
+	for( BtU32 element=0; element<count; element++ )
+	{
+		BtU8 *pElement = pBlock + parameter.m_blockOffset + ( element * parameter.m_arrayStride );
+
+		for( BtU32 column=0; column<numColumns; column++ )
+		{
+			BtU8 *pColumn = pElement + ( column * parameter.m_matrixStride );
+
+			if( ( parameter.m_type == GL_INT ) || ( parameter.m_type == GL_BOOL ) )
+			{
+				GLint intValue = (GLint)pData[0];
+				BtMemory::Copy( pColumn, &intValue, sizeof( GLint ) );
+			}
+			else
+			{
+				BtMemory::Copy( pColumn, pData, numRows * sizeof( BtFloat ) );
+			}
+			pData += numRows;
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -570,6 +1384,84 @@ void RsShaderImpl::SetInteger( const BtChar* pName, BtU32 value )
 
 void RsShaderImpl::Commit()
 {
+	BtU32 program = m_currentProgram;
+
+	// Duplicates share our programs so send everything again if one has drawn since
+	if( g_pCommitShader != this )
+	{
+		for( BtU32 i=0; i<MaxPrograms; i++ )
+		{
+			for( BtU32 j=0; j<m_numParameters[i]; j++ )
+			{
+				m_parameters[i][j].m_version = 0;
+			}
+		}
+		g_pCommitShader = this;
+	}
+
+	// A block is written again when a value in it changes or its binding point holds
+	// someone else's
+	BtBool isBlockDirty[RsUniformBlock_Max];
+
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		isBlockDirty[block] = ( m_blockSize[program][block] > 0 ) &&
+							  ( ( g_pBlockShader[block] != this ) || ( g_blockProgram[block] != program ) );
+	}
+
+	for( BtU32 i=0; i<m_numParameters[program]; i++ )
+	{
+		RsShaderParameter &parameter = m_parameters[program][i];
+		const RsShaderValue &value = m_values[parameter.m_value];
+
+		if( parameter.m_version == value.m_version )
+		{
+			continue;
+		}
+
+		if( parameter.m_block == RsUniformNoBlock )
+		{
+			UploadParameter( parameter, value );
+			parameter.m_version = value.m_version;
+		}
+		else
+		{
+			isBlockDirty[parameter.m_block] = BtTrue;
+		}
+	}
+
+#if defined( GL_UNIFORM_BUFFER )
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	for( BtU32 block=0; block<RsUniformBlock_Max; block++ )
+	{
+		if( isBlockDirty[block] == BtFalse )
+		{
+			continue;
+		}
+
+		BtU32 size = m_blockSize[program][block];
+		BtMemory::Set( g_blockData, 0, size );
+
+		for( BtU32 i=0; i<m_numParameters[program]; i++ )
+		{
+			RsShaderParameter &parameter = m_parameters[program][i];
+
+			if( parameter.m_block == block )
+			{
+				const RsShaderValue &value = m_values[parameter.m_value];
+
+				CopyParameter( g_blockData, parameter, value );
+				parameter.m_version = value.m_version;
+			}
+		}
+
+		pImpl->StreamUniforms( block, g_blockData, size );
+
+		g_pBlockShader[block] = this;
+		g_blockProgram[block] = program;
+	}
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -582,7 +1474,7 @@ void RsShaderImpl::Draw( const RsPrimitive *pPrimitive )
 	RsPrimitive* pPrimitives = (RsPrimitive*) pPrimitive;
     
 	// Draw vertex
-	glDrawArrays( pPrimitives->m_primitiveType, 0, pPrimitives->m_numVertex );
+	RsGL::DrawArrays( pPrimitives->m_primitiveType, 0, pPrimitives->m_numVertex );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -606,12 +1498,35 @@ void RsShaderImpl::Draw( const RsIndexedPrimitive *pPrimitive )
     }
     
     // Draw vertex
-	glDrawElements( primType,
+	RsGL::DrawElements( primType,
                    pPrimitives->m_numIndices,
 				   indexType,
                    GL_BUFFER_OFFSET( pPrimitives->m_startIndex * indexSize) );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Draw
+
+void RsShaderImpl::Draw( const RsIndexedPrimitive *pPrimitive, BtU32 numInstances )
+{
+	Commit();
+
+	BtU32 indexType = GL_UNSIGNED_SHORT;
+	BtU32 indexSize = 2;
+
+	if( pPrimitive->m_indexType == RsIndexBufferImpl::IndType_Long )
+	{
+		indexType = GL_UNSIGNED_INT;
+		indexSize = 4;
+	}
+
+	RsGL::DrawElementsInstanced( pPrimitive->m_primitiveType,
+								 pPrimitive->m_numIndices,
+								 indexType,
+								 GL_BUFFER_OFFSET( pPrimitive->m_startIndex * indexSize ),
+								 numInstances );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // SetTexture
 
@@ -636,50 +1551,26 @@ void RsShaderImpl::SetMaterial( RsMaterial* pMaterial )
 	BtU32 flag = pMaterialWinGL->GetFlags() & RsMaterial_Lit;
     
 	SetFloat( "s_materialFlags", (BtFloat) flag );
-	SetColour( "s_v4MaterialColour", pMaterialWinGL->GetDiffuseColour() );
+	SetColour( "s_materialColour", pMaterialWinGL->GetDiffuseColour() );
     
     // Set the texture
     for( BtU32 i=0; i<MaxTextures; i++ )
     {
-        // Set the texture
-        glActiveTexture(GL_TEXTURE0 + i );
-        
         RsTextureImpl *pTexture = (RsTextureImpl*)pMaterialWinGL->GetTexture(i);
         if( pTexture )
         {
-            GLenum error = glGetError();
-            (void)error;
-            
             // Cache the texture handle
             BtU32 textureHandle = pTexture->GetTextureHandle();
             
-            // Bind the texture to the handle
-            glBindTexture(GL_TEXTURE_2D, textureHandle );
+            // Bind the texture to the unit
+            RsGL::BindTextureUnit( i, textureHandle );
             
             // Set the shader sampler
             SetSampler(i);
         }
         else
         {
-            glBindTexture(GL_TEXTURE_2D, 0 );
+            RsGL::BindTextureUnit( i, 0 );
         }
     }
 }
-
-////////////////////////////////////////////////////////////////////////////////
-// SetLights
-
-void RsShaderImpl::SetLights(BtU32 index)
-{
-	// Set the light direction
-	MtVector4 v4Direction = m_floats[RsHandles_Light0Direction];
-	glUniform4fv( m_handles[index][RsHandles_Light0Direction], 1, v4Direction );
-    
-	// Set the ambient lights
-	MtVector4 v4Ambient = m_floats[RsHandles_LightAmbient];
-	v4Ambient.w = 0;
-	glUniform4fv( m_handles[index][RsHandles_LightAmbient], 1, v4Ambient );
-    
-	int a=0;
-	a++;
-}
@@ -10,6 +10,7 @@
 #include "RsShader.h"
 #include "RsColour.h"
 #include "RsPrimitive.h"
+#include "RsPlatform.h"
 
 const BtU32 RsShaderPassThrough = 0;
 const BtU32 RsShaderLit = 1;
@@ -20,6 +21,126 @@ const BtU32 RsProjectedTexture = 5;
 const BtU32 RsShadow = 6;
 const BtU32 RsYUVToRGB = 7;
 
+// Instanced versions of the lit programs. These are built in rather than loaded
+const BtU32 RsShaderLitInstanced = 8;
+const BtU32 RsShaderLitTexturedInstanced = 9;
+
+// Instanced programs read each instance's world matrix from four attributes, one per column
+const BtU32 RsInstanceWorldAttrib = 8;
+
+const BtU32 MaxPrograms = 16;
+
+// Linked programs are saved to a cache file the first time they are built and loaded from
+// it after that. Bump the version when anything baked into the binaries changes, e.g. the
+// attribute locations
+const BtU32 RsProgramCacheMagic = 0x43505352;		// RSPC
+const BtU32 RsProgramCacheVersion = 1;
+
+// The cache is only used when all of these match. Entries follow it, each an
+// RsProgramCacheEntry followed by its binary
+struct RsProgramCacheHeader
+{
+	BtU32								m_magic;
+	BtU32								m_version;
+	BtU32								m_sourceHash;		// The archive's shader source
+	BtU32								m_builtInHash;		// Source built into the renderer
+	BtU32								m_driverHash;		// GL vendor, renderer and version
+	BtU32								m_numPrograms;
+};
+
+struct RsProgramCacheEntry
+{
+	BtU32								m_program;			// RsShaderPassThrough etc.
+	BtU32								m_format;
+	BtU32								m_length;
+};
+
+// Built in techniques. Handles for techniques registered at run time follow these
+enum RsTechniques
+{
+	RsTechnique_ShaderAdditive,
+	RsTechnique_LensFlare,
+	RsTechnique_Shadow,
+	RsTechnique_ProjectedShadow,
+	RsTechnique_ShaderT2,
+	RsTechnique_ShaderTG,
+	RsTechnique_ShaderTG2,
+	RsTechnique_ShaderT,
+	RsTechnique_ShaderZL,
+	RsTechnique_ShaderZLTGD,
+	RsTechnique_ShaderZLT,
+	RsTechnique_ShaderZLTG,
+	RsTechnique_ShaderZTG,
+	RsTechnique_ShaderZLTS,
+	RsTechnique_YUVToRGB,
+	RsTechnique_BuiltIn,
+};
+
+const BtU32 RsTechniqueNone = 0xFFFFFFFF;
+const BtU32 MaxTechniques = 64;
+
+// A technique is a program and the fixed function state it draws with.
+// A zero depth function or front face leaves that state as it was
+struct RsTechnique
+{
+	BtChar								m_name[64];
+	BtU32								m_program;			// RsShaderPassThrough etc.
+	BtBool								m_isDepthTest;
+	GLenum								m_depthFunc;
+	BtBool								m_isCullFace;
+	GLenum								m_frontFace;
+	BtBool								m_isBlend;
+	GLenum								m_sourceBlend;
+	GLenum								m_destBlend;
+	BtU32								m_hash;				// Filled in by the registry
+};
+
+// Uniform blocks a program may declare, by name, in binding point order. A block is
+// written to the uniform ring and bound with one call whenever a value in it changes
+enum RsUniformBlock
+{
+	RsUniformBlock_Frame,				// RsFrame
+	RsUniformBlock_View,				// RsView
+	RsUniformBlock_Object,				// RsObject
+	RsUniformBlock_Max,
+};
+
+const BtU32 RsUniformNoBlock = 0xFFFFFFFF;
+
+// Every block must fit in the smallest GL_MAX_UNIFORM_BLOCK_SIZE GL allows
+const BtU32 MaxUniformBlockSize = 16384;
+
+// Named values set on the shader. Every program reads the same values
+const BtU32 MaxShaderValues = 64;
+const BtU32 MaxShaderValueFloats = 4096;
+const BtU32 MaxShaderValueName = 48;
+
+// Uniforms found in each program by reflection
+const BtU32 MaxProgramParameters = 32;
+
+struct RsShaderValue
+{
+	BtChar								m_name[MaxShaderValueName];
+	BtU32								m_hash;
+	BtU32								m_offset;			// Into m_valueData
+	BtU32								m_numFloats;		// Last set
+	BtU32								m_capacity;
+	BtU32								m_version;			// Changes when the value does. Zero until set
+};
+
+struct RsShaderParameter
+{
+	BtU32								m_value;			// Index of its RsShaderValue
+	GLenum								m_type;
+	BtU32								m_count;			// Array elements
+	GLint								m_location;			// Uniforms outside a block
+	BtU32								m_block;			// RsUniformBlock or RsUniformNoBlock
+	BtU32								m_blockOffset;		// Bytes into the block
+	BtU32								m_arrayStride;
+	BtU32								m_matrixStride;
+	BtU32								m_version;			// Of the value this program was last sent
+};
+
 struct BaResourceHeader;
 
 class RsCamera;
@@ -48,6 +169,24 @@ public:
 	// Setting values on shader
     
 	void								SetTechnique( const BtChar* pTechniqueName );
+	void								SetTechnique( BtU32 technique );
+
+	// Technique registry. Look a technique up once and set it by handle per draw.
+	// Registering an existing name replaces its state and keeps its handle
+	static BtU32						RegisterTechnique( const RsTechnique &technique );
+	static BtU32						GetTechnique( const BtChar* pTechniqueName );
+	static const RsTechnique&			GetTechniqueState( BtU32 technique );
+
+	// Turn off to compile every program as the shader loads, e.g. to time a cold load
+	static void							SetProgramCache( BtBool isEnabled );
+
+	// Call at the start of each frame. Blocks written into the uniform ring last frame
+	// are bound again before they are next drawn with
+	static void							InvalidateBlocks();
+
+	// Sets the technique's state with the instanced version of its program. Returns
+	// false if there isn't one, in which case draw the instances one at a time
+	BtBool								SetInstancedTechnique( BtU32 technique );
 	void								SetMaterial( RsMaterial* pMaterial );
 	void								SetTexture( const BtChar* pTextureName, const RsTexture* pTexture );
 	void								SetTexture( const BtChar* pTextureName );
@@ -68,17 +207,57 @@ public:
     
 	void								Draw( const RsPrimitive* pPrimitive );
 	void								Draw( const RsIndexedPrimitive* pPrimitive );
+	void								Draw( const RsIndexedPrimitive* pPrimitive, BtU32 numInstances );
     
 private:
     
-    void                                SetLights( BtU32 index );
+	BtBool								CreateInstancedProgram( BtU32 program, BtU32 sourceProgram, const GLchar *pAlpha );
+	GLuint								CompileShader( GLenum type, GLsizei count, const GLchar* const* pText, const GLint *pLength );
+	void								LinkProgram( BtU32 program, GLuint vertexShader, GLuint fragmentShader );
+
+	// Program binary cache
+	BtU32								GetSourceHash();
+	void								GetProgramCacheHeader( RsProgramCacheHeader &header );
+	void								GetProgramCacheFilename( BtChar *filename, BtU32 size );
+	void								LoadProgramCache();
+	void								SaveProgramCache();
+	BtBool								LoadProgramBinary( BtU32 program );
+
+	void								SetTechniqueState( BtU32 technique );
+
+	// Named values and reflection
+	void								ResetValues();
+	BtU32								GetValue( const BtChar *pName, BtU32 numFloats );
+	void								SetValue( BtU32 iValue, const BtFloat *pData, BtU32 numFloats );
+	void								ReflectProgram( BtU32 program );
+	void								AddParameter( BtU32 program, const BtChar *pName, const RsShaderParameter &parameter );
+	void								UploadParameter( const RsShaderParameter &parameter, const RsShaderValue &value );
+	void								CopyParameter( BtU8 *pBlock, const RsShaderParameter &parameter, const RsShaderValue &value );
+
+	// Sends the values that changed since the current program last drew
 	void								Commit();
     
 	BaShaderFileData*					m_pFileData;
     
-	BtS32								m_program[16];
-	BtS32								m_sampler[16][8];
+	BtS32								m_program[MaxPrograms];
+	BtS32								m_sampler[MaxPrograms][8];
     
-	BtS32								m_handles[16][RsHandles_MAX];
-	MtVector4							m_floats[RsHandles_MAX];
+	BtS32								m_handles[MaxPrograms][RsHandles_MAX];
+
+	// Values are indexed by RsHandles first, then by the order they were named in
+	RsShaderValue						m_values[MaxShaderValues];
+	BtU32								m_numValues;
+	BtFloat								m_valueData[MaxShaderValueFloats];
+	BtU32								m_numValueFloats;
+
+	RsShaderParameter					m_parameters[MaxPrograms][MaxProgramParameters];
+	BtU32								m_numParameters[MaxPrograms];
+	BtU32								m_blockSize[MaxPrograms][RsUniformBlock_Max];		// Zero where the program doesn't have the block
+
+	// Only while the shader loads
+	BtBool								m_isProgramCache;
+	BtU8*								m_pCacheMemory;
+	const BtU8*							m_pCacheBinary[MaxPrograms];
+	GLenum								m_cacheFormat[MaxPrograms];
+	BtU32								m_cacheLength[MaxPrograms];
 };
@@ -11,6 +11,7 @@
 #include "BtPrint.h"
 #include "RsImpl.h"
 #include "RsShaderImpl.h"
+#include "RsGL.h"
 #include <stdio.h>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -243,29 +244,26 @@ void RsSpriteImpl::Render( RsSpriteRenderable *pRenderable )
 	BtAssert( pShader );
     
 	// Apply the shader
-	pShader->SetTechnique( "RsShaderTG2" );
+	pShader->SetTechnique( RsTechnique_ShaderTG2 );
 
-    // Set the texture
-    glActiveTexture(GL_TEXTURE0 );
-    
     RsTextureImpl* pTexture = (RsTextureImpl*)m_pFileData->m_pTexture;
     if( pTexture )
     {
-        GLenum error = glGetError();
+        GLenum error = RsGL::GetError();
         (void)error;
         
         // Cache the texture handle
         BtU32 textureHandle = pTexture->GetTextureHandle();
         
-        // Bind the texture to the handle
-        glBindTexture(GL_TEXTURE_2D, textureHandle );
+        // Bind the texture to the first unit
+        RsGL::BindTextureUnit( 0, textureHandle );
         
         // Set the shader sampler
         pShader->SetSampler(0);
     }
     else
     {
-        glBindTexture(GL_TEXTURE_2D, 0 );
+        RsGL::BindTextureUnit( 0, 0 );
     }
     
 	RsPrimitive* pPrimitives = (RsPrimitive*) pRenderable->m_primitive;
@@ -273,22 +271,11 @@ void RsSpriteImpl::Render( RsSpriteRenderable *pRenderable )
 	// Set vertex arrays
 	BtU32 stride = sizeof(RsVertex3);
     
-	// Cache the vertex buffer
-	BtU32 vertexBuffer = RsImplWinGL::GetVertexBuffer();
-    
-	// Get the size
-	BtU32 dataSize = pPrimitives->m_numVertex * stride;
-    
-	// bind VBO in order to use
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer );
-	
-	GLenum error;
-	error = glGetError();
-	(void)error;
-    
-	// upload data to VBO
-	glBufferData(GL_ARRAY_BUFFER, dataSize, pRenderable->m_pVertex, GL_DYNAMIC_DRAW);
-	error = glGetError();
+	// Find the vertex in this frame's stream buffer. This leaves the buffer bound
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+	BtU32 offset = pImpl->StreamVertex( pRenderable->m_pVertex, pPrimitives->m_numVertex );
+
+	GLenum error = RsGL::GetError();
 	(void)error;
     
 	/*
@@ -302,22 +289,18 @@ void RsSpriteImpl::Render( RsSpriteRenderable *pRenderable )
      };
      */
     
-	BtU32 offset = 0;
-	
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::SetVertexAttribArrays( RsVertex3Attribs );
+
+	RsGL::VertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
     
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
     
-	glEnableVertexAttribArray( 4 );
-	glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( BtU32 );
     
-	glEnableVertexAttribArray( 5 );
-	glVertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector2 );
     
 	// Draw the primitives
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+/// RsStreamBufferImpl.cpp
+
+#include "RsPlatform.h"
+#include "BtBase.h"
+#include "BtMemory.h"
+#include "ErrorLog.h"
+#include "RsStreamBufferImpl.h"
+#include "RsGL.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+RsStreamBufferImpl::RsStreamBufferImpl()
+{
+	m_buffer = 0;
+	m_spillBuffer = 0;
+	m_target = GL_ARRAY_BUFFER;
+	m_alignment = 16;
+	m_frameSize = 0;
+	m_frame = 0;
+	m_offset = 0;
+	m_numOverflows = 0;
+	m_isRing = BtTrue;
+	m_isSyncSupported = BtFalse;
+	m_isGrowing = BtFalse;
+
+	for( BtU32 i=0; i<RsStreamBufferFrames; i++ )
+	{
+		m_fence[i] = BtNull;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateOnDevice
+
+void RsStreamBufferImpl::CreateOnDevice( GLenum target, BtU32 frameSize, BtU32 alignment )
+{
+	BtAssert( ( alignment & ( alignment - 1 ) ) == 0 );
+
+	m_target = target;
+	m_alignment = alignment;
+
+	// Each frame's region has to start aligned too
+	m_frameSize = ( frameSize + alignment - 1 ) & ~( alignment - 1 );
+	m_frame = 0;
+	m_offset = 0;
+	m_isSyncSupported = RsGL::IsSyncSupported();
+
+	RsGL::GenBuffers( 1, &m_buffer );
+	RsGL::BindBuffer( m_target, m_buffer );
+	RsGL::BufferData( m_target, m_frameSize * RsStreamBufferFrames, BtNull, GL_DYNAMIC_DRAW );
+	RsGL::BindBuffer( m_target, 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RemoveFromDevice
+
+void RsStreamBufferImpl::RemoveFromDevice()
+{
+	for( BtU32 i=0; i<RsStreamBufferFrames; i++ )
+	{
+		RsGL::DeleteSync( m_fence[i] );
+		m_fence[i] = BtNull;
+	}
+
+	RsGL::DeleteBuffers( 1, &m_buffer );
+	m_buffer = 0;
+
+	if( m_spillBuffer != 0 )
+	{
+		RsGL::DeleteBuffers( 1, &m_spillBuffer );
+		m_spillBuffer = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetRing
+
+void RsStreamBufferImpl::SetRing( BtBool isRing )
+{
+	m_isRing = isRing;
+
+	// The old path resizes the buffer on every write so put the full size back
+	if( ( m_buffer != 0 ) && ( m_isRing == BtTrue ) )
+	{
+		RsGL::BindBuffer( m_target, m_buffer );
+		RsGL::BufferData( m_target, m_frameSize * RsStreamBufferFrames, BtNull, GL_DYNAMIC_DRAW );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BeginFrame
+
+void RsStreamBufferImpl::BeginFrame()
+{
+	if( m_isRing == BtFalse )
+	{
+		return;
+	}
+
+	if( m_isGrowing == BtTrue )
+	{
+		// Fresh storage at the new size. Nothing is waiting on the old storage's fences
+		for( BtU32 i=0; i<RsStreamBufferFrames; i++ )
+		{
+			RsGL::DeleteSync( m_fence[i] );
+			m_fence[i] = BtNull;
+		}
+
+		RsGL::BindBuffer( m_target, m_buffer );
+		RsGL::BufferData( m_target, m_frameSize * RsStreamBufferFrames, BtNull, GL_DYNAMIC_DRAW );
+		m_isGrowing = BtFalse;
+	}
+
+	// Move on to the oldest region
+	m_frame = ( m_frame + 1 ) % RsStreamBufferFrames;
+	m_offset = 0;
+
+	// Wait until the GPU has finished the frame that last used it. This only blocks
+	// when the CPU gets more than RsStreamBufferFrames frames ahead
+	if( m_fence[m_frame] != BtNull )
+	{
+		RsGL::ClientWaitSync( m_fence[m_frame] );
+		RsGL::DeleteSync( m_fence[m_frame] );
+		m_fence[m_frame] = BtNull;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndFrame
+
+void RsStreamBufferImpl::EndFrame()
+{
+	if( ( m_isRing == BtTrue ) && ( m_isSyncSupported == BtTrue ) )
+	{
+		m_fence[m_frame] = RsGL::FenceSync();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HasRoom
+
+BtBool RsStreamBufferImpl::HasRoom( BtU32 size )
+{
+	if( m_isGrowing == BtTrue )
+	{
+		return BtFalse;
+	}
+
+	if( m_offset + size <= m_frameSize )
+	{
+		return BtTrue;
+	}
+
+	// Grow the ring at the next BeginFrame
+	if( m_numOverflows == 0 )
+	{
+		ErrorLog::Printf( "RsStreamBufferImpl overflowed its %d bytes per frame. Growing it\n", m_frameSize );
+	}
+	++m_numOverflows;
+
+	do
+	{
+		m_frameSize *= 2;
+	}
+	while( m_frameSize < size );
+
+	m_isGrowing = BtTrue;
+
+	return BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write
+
+BtU32 RsStreamBufferImpl::Write( const void* pData, BtU32 size )
+{
+	// Leave whichever buffer we wrote to bound for the caller's attribute pointers
+	RsGL::BindBuffer( m_target, m_buffer );
+
+	if( m_isRing == BtFalse )
+	{
+		// Orphan and reallocate the storage for every write
+		RsGL::BufferData( m_target, size, pData, GL_DYNAMIC_DRAW );
+		return 0;
+	}
+
+	if( HasRoom( size ) == BtFalse )
+	{
+		// Draws already queued this frame use the ring so leave it alone. Spill the rest
+		// of the frame into a buffer of its own
+		if( m_spillBuffer == 0 )
+		{
+			RsGL::GenBuffers( 1, &m_spillBuffer );
+		}
+		RsGL::BindBuffer( m_target, m_spillBuffer );
+		RsGL::BufferData( m_target, size, pData, GL_DYNAMIC_DRAW );
+		return 0;
+	}
+
+	BtU32 offset = ( m_frame * m_frameSize ) + m_offset;
+
+	m_offset += ( size + m_alignment - 1 ) & ~( m_alignment - 1 );
+
+#if defined( GL_MAP_UNSYNCHRONIZED_BIT )
+	if( m_isSyncSupported == BtTrue )
+	{
+		// Our fence already guarantees the GPU is done with this range
+		void* pMapped = RsGL::MapBufferRange( m_target, offset, size,
+											  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+
+		if( pMapped != BtNull )
+		{
+			BtMemory::Copy( pMapped, pData, size );
+			RsGL::UnmapBuffer( m_target );
+			return offset;
+		}
+	}
+#endif
+
+	RsGL::BufferSubData( m_target, offset, size, pData );
+
+	return offset;
+}
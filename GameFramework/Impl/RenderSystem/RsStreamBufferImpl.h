@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+/// RsStreamBufferImpl.h
+
+#pragma once
+#include "BtTypes.h"
+#include "RsPlatform.h"
+
+// Frames the GPU may still be reading while we write the next one
+const BtU32 RsStreamBufferFrames = 3;
+
+// One buffer for all the data that is rebuilt every frame. It is split
+// into a region per frame in flight. Each frame writes into its own region and draws
+// from offsets in it, so nothing is reallocated and we never write to memory the GPU
+// is still reading. Where fences are supported the region is mapped unsynchronised
+// once the fence from its last use has passed, otherwise it is filled with
+// glBufferSubData. Vertices and instances stream through one on GL_ARRAY_BUFFER and
+// uniform blocks through another on GL_UNIFORM_BUFFER
+class RsStreamBufferImpl
+{
+public:
+
+	RsStreamBufferImpl();
+
+	// Every write starts on a multiple of alignment, which must be a power of two
+	void							CreateOnDevice( GLenum target, BtU32 frameSize, BtU32 alignment );
+	void							RemoveFromDevice();
+
+	// Call around each frame's rendering
+	void							BeginFrame();
+	void							EndFrame();
+
+	// Copies the data into this frame's region and returns its offset. The buffer
+	// holding it is left bound to the target
+	BtU32							Write( const void* pData, BtU32 size );
+
+	// False if a write of this size won't fit in what is left of this frame's region.
+	// The ring then grows to take it from the next BeginFrame. Write checks this itself
+	// and spills into a buffer of its own, so only callers that spill differently need it
+	BtBool							HasRoom( BtU32 size );
+
+	// Switch back to orphaning the buffer for every write. Used to compare the two
+	void							SetRing( BtBool isRing );
+
+	// Accessors
+	GLuint							GetHandle() const;
+	BtU32							GetNumOverflows() const;
+
+private:
+
+	GLuint							m_buffer;
+	GLuint							m_spillBuffer;		// Takes writes that don't fit until we grow
+	GLenum							m_target;
+	BtU32							m_alignment;
+	BtU32							m_frameSize;
+	BtU32							m_frame;
+	BtU32							m_offset;
+	void*							m_fence[RsStreamBufferFrames];
+	BtU32							m_numOverflows;
+	BtBool							m_isRing;
+	BtBool							m_isSyncSupported;
+	BtBool							m_isGrowing;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// GetHandle
+
+inline GLuint RsStreamBufferImpl::GetHandle() const
+{
+	return m_buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumOverflows
+
+inline BtU32 RsStreamBufferImpl::GetNumOverflows() const
+{
+	return m_numOverflows;
+}
@@ -11,6 +11,7 @@
 #include "RsShaderImpl.h"
 #include "RsImpl.h"
 #include "BaFileData.h"
+#include "RsGL.h"
 #include <stdio.h>
 
 #define GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG                      0x8C00
@@ -73,7 +74,7 @@ RsTexture* RsTextureImpl::GetDuplicate() const
 
 void checkFrameBuffer()
 {
-    GLuint returned = (glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GLuint returned = (RsGL::CheckFramebufferStatus(GL_FRAMEBUFFER));
     
     if( returned != GL_FRAMEBUFFER_COMPLETE )
     {
@@ -149,7 +150,7 @@ void RsTextureImpl::CreateOnDevice()
 		// Cache the mipmap
 		mipMap = m_pMipmaps[0];
 
-		glEnable( GL_TEXTURE_2D );
+		RsGL::Enable( GL_TEXTURE_2D );
     
         BtChar *title = GetTitle();
         
@@ -161,11 +162,11 @@ void RsTextureImpl::CreateOnDevice()
             a++;
         }
         
-        err = glGetError();
+        err = RsGL::GetError();
         
         // glgConvertTo_32
-        glGenTextures( 1, &m_texture );
-        err = glGetError();
+        RsGL::GenTextures( 1, &m_texture );
+        err = RsGL::GetError();
         
         if( m_texture == 11 )
         {
@@ -173,30 +174,30 @@ void RsTextureImpl::CreateOnDevice()
             a++;
         }
         
-        glBindTexture( GL_TEXTURE_2D, m_texture );
-        err = glGetError();
+        RsGL::BindTexture( GL_TEXTURE_2D, m_texture );
+        err = RsGL::GetError();
         
-        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-        err = glGetError();
+        RsGL::PixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+        err = RsGL::GetError();
         
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        err = glGetError();
+        RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        err = RsGL::GetError();
         
         if( m_pFileData->m_flags & RsTF_NearestNeighbour )
         {
-            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         }
         else
         {
-            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            RsGL::TexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         }
      
         // Clamp all textures to edge
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        RsGL::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         
 		if( m_pFileData->m_flags & RsTF_RenderTarget )
 		{
@@ -204,7 +205,7 @@ void RsTextureImpl::CreateOnDevice()
             // http://www.opengl.org/wiki/Framebuffer_Object_Examples
             
             //NULL means reserve texture memory, but texels are undefined
- 			glTexImage2D( GL_TEXTURE_2D,		    //target : usually GL_TEXTURE_2D
+ 			RsGL::TexImage2D( GL_TEXTURE_2D,		    //target : usually GL_TEXTURE_2D
                          0,									//level : usually left to zero
                          GL_RGBA,							//internal format
                          mipMap.m_nWidth,                    //image size
@@ -214,33 +215,33 @@ void RsTextureImpl::CreateOnDevice()
                          GL_UNSIGNED_BYTE,					//data type : pixels are made of byte
                          (GLvoid*)pTextureMemory );          //picture datas
             
-            err = glGetError();
+            err = RsGL::GetError();
             if (err != GL_NO_ERROR)
                 printf( "Error creating texture. glError: 0x%04X\n", err);
             
             checkFrameBuffer();
             
             //-------------------------
-            glGenFramebuffers(1, &m_frameBufferObject);
-            glBindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObject);
+            RsGL::GenFramebuffers(1, &m_frameBufferObject);
+            RsGL::BindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObject);
             //Attach 2D texture to this FBO
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+            RsGL::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
             
             checkFrameBuffer();
             
             //-------------------------
-            glGenRenderbuffers( 1, &m_renderBufferObject);
-            glBindRenderbuffer(GL_RENDERBUFFER, m_renderBufferObject);
-            glRenderbufferStorage(GL_RENDERBUFFER, RS_GL_DEPTH_COMPONENT, mipMap.m_nWidth, mipMap.m_nHeight );
+            RsGL::GenRenderbuffers( 1, &m_renderBufferObject);
+            RsGL::BindRenderbuffer(GL_RENDERBUFFER, m_renderBufferObject);
+            RsGL::RenderbufferStorage(GL_RENDERBUFFER, RS_GL_DEPTH_COMPONENT, mipMap.m_nWidth, mipMap.m_nHeight );
             
             checkFrameBuffer();
             //-------------------------
             //Attach depth buffer to FBO
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderBufferObject);
+            RsGL::FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderBufferObject);
         
             checkFrameBuffer();
             
-            err = glGetError();
+            err = RsGL::GetError();
             if (err != GL_NO_ERROR)
                 printf( "Error creating texture. glError: 0x%04X\n", err);
 		}
@@ -258,7 +259,7 @@ void RsTextureImpl::CreateOnDevice()
                 format = GL_RGB;
             }
             
-			glTexImage2D( GL_TEXTURE_2D,		    //target : usually GL_TEXTURE_2D
+			RsGL::TexImage2D( GL_TEXTURE_2D,		    //target : usually GL_TEXTURE_2D
 				0,									//level : usually left to zero
 				format,                             //internal format
 				mipMap.m_nWidth,                    //image size
@@ -268,7 +269,7 @@ void RsTextureImpl::CreateOnDevice()
 				GL_UNSIGNED_BYTE,					//data type : pixels are made of byte
 				(GLvoid*)pTextureMemory );          //picture datas
 
-            err = glGetError();
+            err = RsGL::GetError();
             if (err != GL_NO_ERROR)
             {
                printf( "Error uploading texture %d %d. glError: 0x%04X\n",
@@ -277,9 +278,9 @@ void RsTextureImpl::CreateOnDevice()
 		}
         
         // Unbind this texture
-        glBindTexture( GL_TEXTURE_2D, 0 );
+        RsGL::BindTexture( GL_TEXTURE_2D, 0 );
         
-        err = glGetError();
+        err = RsGL::GetError();
         
         int a=0;
         a++;
@@ -319,10 +320,10 @@ void RsTextureImpl::WriteMemory( BtU8* pMemory, BtU32 size )
         size = mipMap.m_nWidth * mipMap.m_nHeight * 4;
     }
     
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    RsGL::BindTexture(GL_TEXTURE_2D, m_texture);
+    RsGL::PixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 
-    GLenum err = glGetError();
+    GLenum err = RsGL::GetError();
     if (err != GL_NO_ERROR)
         printf( "Error creating texture. glError: 0x%04X\n", err);
     
@@ -332,7 +333,7 @@ void RsTextureImpl::WriteMemory( BtU8* pMemory, BtU32 size )
     {
         BtAssert( size == mipMap.m_nWidth * mipMap.m_nHeight );
  
-        glTexImage2D(GL_TEXTURE_2D,                     //target : usually GL_TEXTURE_2D
+        RsGL::TexImage2D(GL_TEXTURE_2D,                     //target : usually GL_TEXTURE_2D
                      0,									//level : usually left to zero
                      GL_ALPHA,							//internal format
                      mipMap.m_nWidth,                   //image size
@@ -346,7 +347,7 @@ void RsTextureImpl::WriteMemory( BtU8* pMemory, BtU32 size )
     {
         BtAssert( size == mipMap.m_nWidth * mipMap.m_nHeight * 4 );
         
-        glTexImage2D( GL_TEXTURE_2D,                    //target : usually GL_TEXTURE_2D
+        RsGL::TexImage2D( GL_TEXTURE_2D,                    //target : usually GL_TEXTURE_2D
                      0,									//level : usually left to zero
                      GL_RGBA,							//internal format
                      mipMap.m_nWidth,                   //image size
@@ -357,7 +358,7 @@ void RsTextureImpl::WriteMemory( BtU8* pMemory, BtU32 size )
                      (GLvoid*)pMemory );                //picture datas
     }
     
-    err = glGetError();
+    err = RsGL::GetError();
     if (err != GL_NO_ERROR)
         printf( "Can't update texture. glError: 0x%04X\n", err);
 }
@@ -367,7 +368,7 @@ void RsTextureImpl::WriteMemory( BtU8* pMemory, BtU32 size )
 
 void RsTextureImpl::RemoveFromDevice()
 {
-	glDeleteTextures( 1, &m_texture );
+	RsGL::DeleteTextures( 1, &m_texture );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -565,22 +566,14 @@ void RsTextureImpl::Render( RsTextureRenderable *pRenderable )
 	MtMatrix4 m4WorldViewScreen   = m4World * m4Projection;
 
 	pShader->SetCamera( camera );
-	pShader->SetTechnique( "RsShaderT2" );
+	pShader->SetTechnique( RsTechnique_ShaderT2 );
 	pShader->SetMatrix( RsHandles_WorldViewScreen, m4WorldViewScreen );
 
-	for( BtU32 i=0; i<7; i++ )
-	{
-		glDisableVertexAttribArray( i );
-	}
-
 	// Cache the texture
 	RsTextureImpl* pTexture = (RsTextureImpl*)pRenderable->m_pTexture;
 
-    // Set the texture
-    glActiveTexture(GL_TEXTURE0 );
- 
-    // Bind the texture to the handle
-    glBindTexture(GL_TEXTURE_2D, pTexture->GetTextureHandle() );
+    // Bind the texture to the first unit
+    RsGL::BindTextureUnit( 0, pTexture->GetTextureHandle() );
             
     // Set the shader sampler
     pShader->SetSampler(0);
@@ -588,22 +581,11 @@ void RsTextureImpl::Render( RsTextureRenderable *pRenderable )
 	// Set vertex arrays
 	BtU32 stride = sizeof(RsVertex3);
 
-	// Cache the vertex buffer
-	BtU32 vertexBuffer = RsImplWinGL::GetVertexBuffer();
-
-	// Get the size
-	BtU32 dataSize = pPrimitives->m_numVertex * stride;
-
-	// bind VBO in order to use
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer );
-	
-	GLenum error;
-	error = glGetError();
-	(void)error;
+	// Find the vertex in this frame's stream buffer. This leaves the buffer bound
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+	BtU32 offset = pImpl->StreamVertex( pRenderable->m_pVertex, pPrimitives->m_numVertex );
 
-	// upload data to VBO
-	glBufferData(GL_ARRAY_BUFFER, dataSize, pRenderable->m_pVertex, GL_DYNAMIC_DRAW);
-	error = glGetError();
+	GLenum error = RsGL::GetError();
 	(void)error;
 
 	/*
@@ -617,22 +599,18 @@ void RsTextureImpl::Render( RsTextureRenderable *pRenderable )
 	};
 	*/
 
-	BtU32 offset = 0;
-	
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::SetVertexAttribArrays( RsVertex3Attribs );
+
+	RsGL::VertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
 
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector3 );
 
-	glEnableVertexAttribArray( 4 );
-	glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( BtU32 );
 
-	glEnableVertexAttribArray( 5);
-	glVertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
+	RsGL::VertexAttribPointer( 5, 2, GL_FLOAT, GL_FALSE, stride,  GL_BUFFER_OFFSET( offset ) );
 	offset += sizeof( MtVector2 );
 
 	// Draw the primitives
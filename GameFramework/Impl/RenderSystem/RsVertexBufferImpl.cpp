@@ -6,17 +6,32 @@
 #include "BaArchive.h"
 #include "BtMemory.h"
 #include "RsVertexBufferImpl.h"
+#include "RsIndexBufferImpl.h"
 #include "RsVertex.h"
 #include "RsManagerImpl.h"
+#include "RsGL.h"
 
 RsVertexBufferImpl VertexBuffer;
 
+static BtBool g_isVertexArrays = BtTrue;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
 RsVertexBufferImpl::RsVertexBufferImpl()
 {
 	m_pData = BtNull;
+	m_vertexArray = 0;
+	m_pVertexArrayIndices = BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetVertexArrays
+
+//static
+void RsVertexBufferImpl::SetVertexArrays( BtBool isEnabled )
+{
+	g_isVertexArrays = isEnabled;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +41,8 @@ void RsVertexBufferImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 {
 	m_pFileData = (BaVertexBufferFileData*) pFileData;
 	m_pData = ( (BtU8*) m_pFileData ) + sizeof( BaVertexBufferFileData );
+	m_vertexArray = 0;
+	m_pVertexArrayIndices = BtNull;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -34,24 +51,75 @@ void RsVertexBufferImpl::FixPointers( BtU8 *pFileData, BaArchive *pArchive )
 void RsVertexBufferImpl::CreateOnDevice()
 {
 	// generate a new VBO and get the associated ID
-	glGenBuffers(1, &m_vertexBuffer);
+	RsGL::GenBuffers(1, &m_vertexBuffer);
 
 	// bind VBO in order to use
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	RsGL::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
 	BtU32 dataSize = m_pFileData->m_nVertices * m_pFileData->m_nStride;
 
 	// upload data to VBO
 	if (m_pFileData->m_flags & RsVB_Dynamic)
 	{
-		glBufferData(GL_ARRAY_BUFFER, dataSize, m_pData, GL_DYNAMIC_DRAW);
+		RsGL::BufferData(GL_ARRAY_BUFFER, dataSize, m_pData, GL_DYNAMIC_DRAW);
 	}
 	else {
-		glBufferData(GL_ARRAY_BUFFER, dataSize, m_pData, GL_STATIC_DRAW);
+		RsGL::BufferData(GL_ARRAY_BUFFER, dataSize, m_pData, GL_STATIC_DRAW);
 	}
 
 	// Unbind vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RsGL::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateVertexArray
+
+void RsVertexBufferImpl::CreateVertexArray( RsIndexBufferImpl *pIndexBuffer )
+{
+	if( ( g_isVertexArrays == BtFalse ) || ( RsGL::IsVertexArraySupported() == BtFalse ) )
+	{
+		return;
+	}
+
+	if( m_vertexArray == 0 )
+	{
+		RsGL::GenVertexArrays( 1, &m_vertexArray );
+	}
+	m_pVertexArrayIndices = pIndexBuffer;
+
+	// A new vertex array starts with every attribute off
+	RsGL::BindVertexArray( m_vertexArray );
+
+	BtU32 attribs = GetAttribs();
+
+	for( BtU32 i=0; i<MaxRsGLVertexAttribs; i++ )
+	{
+		if( attribs & ( 1 << i ) )
+		{
+			RsGL::EnableVertexAttribArray( i );
+		}
+	}
+
+	SetPointers();
+	pIndexBuffer->SetIndices();
+
+	// Don't let anything else change it
+	RsGL::BindVertexArray( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetStream
+
+void RsVertexBufferImpl::SetStream( RsIndexBufferImpl *pIndexBuffer )
+{
+	if( ( m_vertexArray != 0 ) && ( m_pVertexArrayIndices == pIndexBuffer ) )
+	{
+		RsGL::BindVertexArray( m_vertexArray );
+		return;
+	}
+
+	SetStream();
+	pIndexBuffer->SetIndices();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,14 +128,52 @@ void RsVertexBufferImpl::CreateOnDevice()
 void RsVertexBufferImpl::SetStream()
 {
 	// http://www.opengl.org/wiki/Vertex_Buffer_Object
-	for( BtU32 i=0; i<8; i++ )
+	// Turn on just the attributes this format has. The state cache leaves alone any that
+	// are already right
+	RsGL::SetVertexAttribArrays( GetAttribs() );
+//	error = RsImplWinGL::CheckError();
+
+	SetPointers();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetAttribs
+
+BtU32 RsVertexBufferImpl::GetAttribs() const
+{
+	BtU32 vertexType = m_pFileData->m_type;
+	BtU32 attribs = 0;
+
+	if( vertexType & VT_Position )
 	{
-		glDisableVertexAttribArray( i );
+		attribs |= 1 << 0;
 	}
-//	error = RsImplWinGL::CheckError();
+	if( vertexType & VT_Normal )
+	{
+		attribs |= 1 << 1;
+	}
+	if( vertexType & VT_Colour )
+	{
+		attribs |= 1 << 4;
+	}
+	if( vertexType & VT_UV0 )
+	{
+		attribs |= 1 << 5;
+	}
+	if( vertexType & VT_Skin )
+	{
+		attribs |= ( 1 << 6 ) | ( 1 << 7 );
+	}
+	return attribs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetPointers
 
+void RsVertexBufferImpl::SetPointers()
+{
 	// Bind the vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);         // for vertex coordinates
+	RsGL::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);         // for vertex coordinates
 //	error = RsImplWinGL::CheckError();
 
 	BtU32 offset = 0;
@@ -78,8 +184,7 @@ void RsVertexBufferImpl::SetStream()
 
 	if ( vertexType & VT_Position )
 	{
-		glEnableVertexAttribArray( 0 );
-		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+		RsGL::VertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 
 		offset += sizeof( MtVector3 );
 		++index;
@@ -89,16 +194,14 @@ void RsVertexBufferImpl::SetStream()
 
 	if ( vertexType & VT_Normal )
 	{
-		glEnableVertexAttribArray( 1 );
-		glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+		RsGL::VertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 
 		offset += sizeof( MtVector3 );
 		++index;
 	}
 	if (vertexType & VT_Colour)
 	{
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET(offset));
+		RsGL::VertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, GL_BUFFER_OFFSET(offset));
 
 		offset += sizeof(BtU32);
 		++index;
@@ -106,8 +209,7 @@ void RsVertexBufferImpl::SetStream()
 
 	if (vertexType & VT_UV0)
 	{
-		glEnableVertexAttribArray(5);
-		glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET(offset));
+		RsGL::VertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET(offset));
 
 		offset += sizeof(MtVector2);
 		++index;
@@ -133,19 +235,17 @@ void RsVertexBufferImpl::SetStream()
 
 	if ( vertexType & VT_Skin )
 	{
-		glEnableVertexAttribArray( 6 );
-		glVertexAttribPointer( 6, 4, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+		RsGL::VertexAttribPointer( 6, 4, GL_FLOAT, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 	
-		GLenum error = glGetError();
+		GLenum error = RsGL::GetError();
 		(void)error;
 
 		offset += sizeof( BtFloat ) * 4;
 		++index;
 
-		glEnableVertexAttribArray( 7 );
-		glVertexAttribPointer( 7, 4, GL_UNSIGNED_BYTE, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
+		RsGL::VertexAttribPointer( 7, 4, GL_UNSIGNED_BYTE, GL_FALSE, stride, GL_BUFFER_OFFSET( offset ) );
 
-		error = glGetError();
+		error = RsGL::GetError();
 		(void)error;
 
 		offset += sizeof( BtU8 ) * 4;
@@ -174,5 +274,12 @@ void RsVertexBufferImpl::Copy(BtU8* pData, BtU32 numVertices )
 
 void RsVertexBufferImpl::RemoveFromDevice()
 {
-	glDeleteBuffers(1, &m_vertexBuffer);
+	if( m_vertexArray != 0 )
+	{
+		RsGL::DeleteVertexArrays( 1, &m_vertexArray );
+		m_vertexArray = 0;
+		m_pVertexArrayIndices = BtNull;
+	}
+
+	RsGL::DeleteBuffers(1, &m_vertexBuffer);
 }
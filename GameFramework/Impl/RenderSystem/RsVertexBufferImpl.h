@@ -8,6 +8,8 @@
 #include "BtTypes.h"
 #include "RsPlatform.h"
 
+class RsIndexBufferImpl;
+
 // Class Declaration
 class RsVertexBufferImpl : public BaResource
 {
@@ -20,15 +22,61 @@ public:
 	void							FixPointers( BtU8 *pFileData, BaArchive *pArchive );
 	void							CreateOnDevice();
 	void							Copy( BtU8* pData, BtU32 nVertices );
-	void							SetStream();
 	void							RemoveFromDevice();
 
+	// Records this buffer's attribute layout and the index buffer in a vertex array
+	// object so drawing with the pair is a single bind
+	void							CreateVertexArray( RsIndexBufferImpl *pIndexBuffer );
+
+	// Binds the vertex array made for this index buffer, or sets the attributes and
+	// indices up by hand where there isn't one
+	void							SetStream( RsIndexBufferImpl *pIndexBuffer );
+
+	// Sets the attributes up by hand
+	void							SetStream();
+
+	// Turn vertex array objects off to compare. Call before loading anything
+	static void						SetVertexArrays( BtBool isEnabled );
+
+	// The vertex as they were loaded, for reading on the CPU
+	const BtU8*						GetData() const;
+	BtU32							GetStride() const;
+	BtU32							GetVertexType() const;
+
 private:
 
 	friend class RsImplWinDX;
 
+	BtU32							GetAttribs() const;
+	void							SetPointers();
+
 	GLuint							m_vertexBuffer;
 	BaVertexBufferFileData*			m_pFileData;
 	BtU8*							m_pData;
 	GLuint							m_vertexArray;
+	RsIndexBufferImpl*				m_pVertexArrayIndices;
 };
+
+////////////////////////////////////////////////////////////////////////////////
+// GetData
+
+inline const BtU8* RsVertexBufferImpl::GetData() const
+{
+	return m_pData;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetStride
+
+inline BtU32 RsVertexBufferImpl::GetStride() const
+{
+	return m_pFileData->m_nStride;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetVertexType
+
+inline BtU32 RsVertexBufferImpl::GetVertexType() const
+{
+	return m_pFileData->m_type;
+}
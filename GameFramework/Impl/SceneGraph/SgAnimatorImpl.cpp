@@ -10,6 +10,7 @@
 #include "SgBoneImpl.h"
 #include "SgSkinImpl.h"
 #include "BtMemory.h"
+#include "BtProfiler.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -25,7 +26,7 @@ SgAnimatorImpl::SgAnimatorImpl()
 SgAnimator *SgAnimatorImpl::GetDuplicate()
 {
 	// Allocate the memory
-	BtU8* pMemory = BtMemory::Allocate(sizeof(SgAnimatorImpl));
+	BtU8* pMemory = BtMemory::Allocate(BtMT_SceneGraph, sizeof(SgAnimatorImpl));
 
 	// Create the class
 	SgAnimatorImpl* pAnimator = new(pMemory) SgAnimatorImpl;
@@ -182,6 +183,8 @@ void SgAnimatorImpl::SetFrame( BtU32 frame )
 
 void SgAnimatorImpl::Update( SgSkin* pSkin )
 {
+	BtProfile( "SgAnimator::Update" );
+
 	if( m_bPaused == BtTrue )
 	{
 		return;
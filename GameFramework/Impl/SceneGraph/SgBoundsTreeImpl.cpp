@@ -0,0 +1,687 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgBoundsTreeImpl.cpp
+
+#include "BtBase.h"
+#include "BtMemory.h"
+#include "MtMath.h"
+#include "MtSphere.h"
+#include "RsFrustum.h"
+#include "SgBoundsTreeImpl.h"
+#include "SgNodeImpl.h"
+#include "SgMeshImpl.h"
+
+const BtU32 SgBoundsTreeNoNode = 0xFFFFFFFF;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+SgBoundsTreeImpl::SgBoundsTreeImpl()
+{
+	m_pX = BtNull;
+	m_pY = BtNull;
+	m_pZ = BtNull;
+	m_pRadius = BtNull;
+	m_pNodes = BtNull;
+	m_pLeaf = BtNull;
+	m_numEntries = 0;
+	m_maxEntries = 0;
+	m_pTreeNodes = BtNull;
+	m_numNodes = 0;
+	m_pSkins = BtNull;
+	m_numSkins = 0;
+	m_maxSkins = 0;
+	m_isBuilt = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy
+
+void SgBoundsTreeImpl::Destroy()
+{
+	FreeEntries();
+
+	if( m_maxSkins > 0 )
+	{
+		BtMemory::Free( m_pSkins );
+		m_maxSkins = 0;
+	}
+
+	m_numEntries = 0;
+	m_numNodes = 0;
+	m_numSkins = 0;
+	m_isBuilt = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeEntries
+
+void SgBoundsTreeImpl::FreeEntries()
+{
+	if( m_maxEntries > 0 )
+	{
+		BtMemory::Free( m_pX );
+		BtMemory::Free( m_pY );
+		BtMemory::Free( m_pZ );
+		BtMemory::Free( m_pRadius );
+		BtMemory::Free( m_pNodes );
+		BtMemory::Free( m_pLeaf );
+		BtMemory::Free( m_pTreeNodes );
+		m_maxEntries = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Invalidate
+
+void SgBoundsTreeImpl::Invalidate()
+{
+	m_isBuilt = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Count
+
+void SgBoundsTreeImpl::Count( SgNodeImpl *pNode, BtU32 &numMeshes, BtU32 &numSkins )
+{
+	if( pNode->NodeType() & SgType_Mesh )
+	{
+		++numMeshes;
+	}
+
+	if( pNode->NodeType() & SgType_Skin )
+	{
+		++numSkins;
+	}
+
+	for( SgNodeImpl *pChild = (SgNodeImpl*)pNode->m_pFileData->m_pFirstChild; pChild != BtNull; pChild = (SgNodeImpl*)pChild->m_pFileData->m_pNextSibling )
+	{
+		Count( pChild, numMeshes, numSkins );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Gather
+
+void SgBoundsTreeImpl::Gather( SgNodeImpl *pNode )
+{
+	// Nodes that are both go in both, so picking and queries find their meshes and Cull
+	// draws their skins whatever the frustum, as SgNodeImpl::RenderBatch does
+	if( pNode->NodeType() & SgType_Mesh )
+	{
+		MtVector3 v3Center;
+		BtFloat radius;
+		pNode->m_pMesh->GetWorldSphere( v3Center, radius );
+
+		BtU32 entry = m_numEntries++;
+		m_pX[entry] = v3Center.x;
+		m_pY[entry] = v3Center.y;
+		m_pZ[entry] = v3Center.z;
+		m_pRadius[entry] = radius;
+		m_pNodes[entry] = pNode;
+	}
+
+	if( pNode->NodeType() & SgType_Skin )
+	{
+		m_pSkins[m_numSkins++] = pNode;
+	}
+
+	for( SgNodeImpl *pChild = (SgNodeImpl*)pNode->m_pFileData->m_pFirstChild; pChild != BtNull; pChild = (SgNodeImpl*)pChild->m_pFileData->m_pNextSibling )
+	{
+		Gather( pChild );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Build
+
+void SgBoundsTreeImpl::Build( SgNodeImpl *pRoot )
+{
+	BtU32 numMeshes = 0;
+	BtU32 numSkins = 0;
+	Count( pRoot, numMeshes, numSkins );
+
+	// Keep the memory from the last build when it's big enough
+	if( numMeshes > m_maxEntries )
+	{
+		FreeEntries();
+
+		m_maxEntries = numMeshes;
+		m_pX = (BtFloat*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtFloat ) * numMeshes );
+		m_pY = (BtFloat*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtFloat ) * numMeshes );
+		m_pZ = (BtFloat*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtFloat ) * numMeshes );
+		m_pRadius = (BtFloat*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtFloat ) * numMeshes );
+		m_pNodes = (SgNodeImpl**)BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgNodeImpl* ) * numMeshes );
+		m_pLeaf = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numMeshes );
+
+		// A tree with n leaves has 2n - 1 nodes, and there are never more leaves than entries
+		m_pTreeNodes = (SgBoundsTreeNode*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgBoundsTreeNode ) * numMeshes * 2 );
+	}
+
+	if( numSkins > m_maxSkins )
+	{
+		if( m_maxSkins > 0 )
+		{
+			BtMemory::Free( m_pSkins );
+		}
+		m_maxSkins = numSkins;
+		m_pSkins = (SgNodeImpl**)BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgNodeImpl* ) * numSkins );
+	}
+
+	m_numEntries = 0;
+	m_numSkins = 0;
+	m_numNodes = 0;
+
+	Gather( pRoot );
+
+	if( m_numEntries > 0 )
+	{
+		BuildNode( 0, m_numEntries, SgBoundsTreeNoNode );
+	}
+
+	// The entries have been reordered so tell each node where it ended up
+	for( BtU32 i=0; i<m_numEntries; i++ )
+	{
+		m_pNodes[i]->m_boundsEntry = i;
+	}
+
+	Refit();
+
+	m_isBuilt = BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BuildNode
+
+// Split the entries in half along the axis their centres are most spread out on. Halving
+// keeps the tree balanced however the meshes are laid out
+BtU32 SgBoundsTreeImpl::BuildNode( BtU32 first, BtU32 count, BtU32 parent )
+{
+	BtU32 index = m_numNodes++;
+
+	SgBoundsTreeNode &node = m_pTreeNodes[index];
+	node.m_parent = parent;
+	node.m_right = SgBoundsTreeNoNode;
+	node.m_first = first;
+	node.m_count = count;
+	node.m_isDirty = BtTrue;
+
+	if( count <= SgBoundsTreeLeafSize )
+	{
+		for( BtU32 i=first; i<first + count; i++ )
+		{
+			m_pLeaf[i] = index;
+		}
+		return index;
+	}
+
+	MtAABB centers( MtVector3( m_pX[first], m_pY[first], m_pZ[first] ) );
+
+	for( BtU32 i=first + 1; i<first + count; i++ )
+	{
+		centers.ExpandBy( MtVector3( m_pX[i], m_pY[i], m_pZ[i] ) );
+	}
+
+	MtVector3 v3Spread = centers.Max() - centers.Min();
+
+	const BtFloat *pKey = m_pX;
+
+	if( ( v3Spread.y > v3Spread.x ) && ( v3Spread.y >= v3Spread.z ) )
+	{
+		pKey = m_pY;
+	}
+	else if( v3Spread.z > v3Spread.x )
+	{
+		pKey = m_pZ;
+	}
+
+	BtU32 numLeft = count / 2;
+	Select( first, count, first + numLeft, pKey );
+
+	node.m_count = 0;
+
+	BuildNode( first, numLeft, index );
+
+	// BuildNode may have moved on so don't hold on to the reference
+	BtU32 right = BuildNode( first + numLeft, count - numLeft, index );
+	m_pTreeNodes[index].m_right = right;
+
+	return index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Select
+
+// Reorder the entries so that the nth is in its sorted place, with none greater before it
+// and none less after it
+void SgBoundsTreeImpl::Select( BtU32 first, BtU32 count, BtU32 nth, const BtFloat *pKey )
+{
+	BtS32 lo = first;
+	BtS32 hi = first + count - 1;
+	BtS32 n = nth;
+
+	while( lo < hi )
+	{
+		BtFloat pivot = pKey[( lo + hi ) / 2];
+
+		BtS32 i = lo;
+		BtS32 j = hi;
+
+		while( i <= j )
+		{
+			while( pKey[i] < pivot )
+			{
+				++i;
+			}
+			while( pKey[j] > pivot )
+			{
+				--j;
+			}
+
+			if( i <= j )
+			{
+				Swap( i, j );
+				++i;
+				--j;
+			}
+		}
+
+		if( n <= j )
+		{
+			hi = j;
+		}
+		else if( n >= i )
+		{
+			lo = i;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Swap
+
+void SgBoundsTreeImpl::Swap( BtU32 a, BtU32 b )
+{
+	BtFloat x = m_pX[a]; m_pX[a] = m_pX[b]; m_pX[b] = x;
+	BtFloat y = m_pY[a]; m_pY[a] = m_pY[b]; m_pY[b] = y;
+	BtFloat z = m_pZ[a]; m_pZ[a] = m_pZ[b]; m_pZ[b] = z;
+	BtFloat radius = m_pRadius[a]; m_pRadius[a] = m_pRadius[b]; m_pRadius[b] = radius;
+	SgNodeImpl *pNode = m_pNodes[a]; m_pNodes[a] = m_pNodes[b]; m_pNodes[b] = pNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetBounds
+
+void SgBoundsTreeImpl::SetBounds( SgNodeImpl *pNode, const MtVector3 &v3Center, BtFloat radius )
+{
+	BtU32 entry = pNode->m_boundsEntry;
+
+	// Duplicates of nodes below the root still point at its parent but aren't in its tree
+	if( ( entry >= m_numEntries ) || ( m_pNodes[entry] != pNode ) )
+	{
+		return;
+	}
+
+	// Most of a level doesn't move
+	if( ( m_pX[entry] == v3Center.x ) &&
+		( m_pY[entry] == v3Center.y ) &&
+		( m_pZ[entry] == v3Center.z ) &&
+		( m_pRadius[entry] == radius ) )
+	{
+		return;
+	}
+
+	m_pX[entry] = v3Center.x;
+	m_pY[entry] = v3Center.y;
+	m_pZ[entry] = v3Center.z;
+	m_pRadius[entry] = radius;
+
+	// Flag the branches above it, stopping where another entry already has
+	for( BtU32 index = m_pLeaf[entry]; index != SgBoundsTreeNoNode; index = m_pTreeNodes[index].m_parent )
+	{
+		if( m_pTreeNodes[index].m_isDirty == BtTrue )
+		{
+			break;
+		}
+		m_pTreeNodes[index].m_isDirty = BtTrue;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Refit
+
+void SgBoundsTreeImpl::Refit()
+{
+	if( m_numNodes > 0 )
+	{
+		RefitNode( 0 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RefitNode
+
+void SgBoundsTreeImpl::RefitNode( BtU32 index )
+{
+	SgBoundsTreeNode &node = m_pTreeNodes[index];
+
+	if( node.m_isDirty == BtFalse )
+	{
+		return;
+	}
+
+	if( node.m_count > 0 )
+	{
+		BtU32 first = node.m_first;
+		MtVector3 v3Extent( m_pRadius[first], m_pRadius[first], m_pRadius[first] );
+		MtVector3 v3Center( m_pX[first], m_pY[first], m_pZ[first] );
+
+		node.m_AABB = MtAABB( v3Center - v3Extent, v3Center + v3Extent );
+
+		for( BtU32 i=first + 1; i<first + node.m_count; i++ )
+		{
+			v3Extent = MtVector3( m_pRadius[i], m_pRadius[i], m_pRadius[i] );
+			v3Center = MtVector3( m_pX[i], m_pY[i], m_pZ[i] );
+
+			node.m_AABB.ExpandBy( MtAABB( v3Center - v3Extent, v3Center + v3Extent ) );
+		}
+	}
+	else
+	{
+		RefitNode( index + 1 );
+		RefitNode( node.m_right );
+
+		node.m_AABB = m_pTreeNodes[index + 1].m_AABB;
+		node.m_AABB.ExpandBy( m_pTreeNodes[node.m_right].m_AABB );
+	}
+
+	node.m_isDirty = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Cull
+
+void SgBoundsTreeImpl::Cull( const RsFrustum &frustum, SgRenderBatch &batch, void (*pFlush)( SgRenderBatch& ) ) const
+{
+	BtU32 stack[MaxBoundsTreeDepth];
+	BtU32 depth = 0;
+
+	if( m_numNodes > 0 )
+	{
+		stack[depth++] = 0;
+	}
+
+	while( depth > 0 )
+	{
+		const SgBoundsTreeNode &node = m_pTreeNodes[stack[--depth]];
+
+		if( frustum.IsInside( node.m_AABB ) == BtFalse )
+		{
+			continue;
+		}
+
+		if( node.m_count == 0 )
+		{
+			BtAssert( depth + 2 <= MaxBoundsTreeDepth );
+
+			// Left first to keep the entries in order
+			stack[depth++] = node.m_right;
+			stack[depth++] = (BtU32)( &node - m_pTreeNodes ) + 1;
+			continue;
+		}
+
+		// The batch tests each mesh's own sphere
+		for( BtU32 i=node.m_first; i<node.m_first + node.m_count; i++ )
+		{
+			SgNodeImpl *pNode = m_pNodes[i];
+
+			// Skinned meshes come with the skins
+			if( ( pNode->m_pFileData->m_renderFlags == RsRF_Hidden ) || ( pNode->NodeType() & SgType_Skin ) )
+			{
+				continue;
+			}
+
+			if( batch.m_numNodes == MaxRenderBatch )
+			{
+				pFlush( batch );
+			}
+
+			BtU32 index = batch.m_numNodes++;
+			batch.m_pNodes[index] = pNode;
+			batch.m_x[index] = m_pX[i];
+			batch.m_y[index] = m_pY[i];
+			batch.m_z[index] = m_pZ[i];
+			batch.m_radius[index] = m_pRadius[i];
+		}
+	}
+
+	for( BtU32 i=0; i<m_numSkins; i++ )
+	{
+		SgNodeImpl *pNode = m_pSkins[i];
+
+		if( pNode->m_pFileData->m_renderFlags == RsRF_Hidden )
+		{
+			continue;
+		}
+
+		if( batch.m_numNodes == MaxRenderBatch )
+		{
+			pFlush( batch );
+		}
+
+		BtU32 index = batch.m_numNodes++;
+		batch.m_pNodes[index] = pNode;
+
+		// The batch still culls a skinned mesh by its own sphere
+		if( pNode->NodeType() & SgType_Mesh )
+		{
+			MtVector3 v3Center;
+			BtFloat radius;
+			pNode->m_pMesh->GetWorldSphere( v3Center, radius );
+
+			batch.m_x[index] = v3Center.x;
+			batch.m_y[index] = v3Center.y;
+			batch.m_z[index] = v3Center.z;
+			batch.m_radius[index] = radius;
+		}
+		else
+		{
+			batch.m_x[index] = 0;
+			batch.m_y[index] = 0;
+			batch.m_z[index] = 0;
+			batch.m_radius[index] = 0;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Intersect
+
+//static
+BtBool SgBoundsTreeImpl::Intersect( const MtVector3 &v3From, const MtVector3 &v3Direction,
+									const MtVector3 &v3Center, BtFloat radius, BtFloat &t )
+{
+	MtVector3 v3Offset = v3From - v3Center;
+
+	BtFloat c = v3Offset.DotProduct( v3Offset ) - ( radius * radius );
+
+	// Starting inside
+	if( c <= 0 )
+	{
+		t = 0;
+		return BtTrue;
+	}
+
+	BtFloat b = v3Offset.DotProduct( v3Direction );
+
+	// Starting outside and heading away
+	if( b > 0 )
+	{
+		return BtFalse;
+	}
+
+	BtFloat a = v3Direction.DotProduct( v3Direction );
+	BtFloat discriminant = ( b * b ) - ( a * c );
+
+	if( ( a == 0 ) || ( discriminant < 0 ) )
+	{
+		return BtFalse;
+	}
+
+	t = ( -b - MtSqrt( discriminant ) ) / a;
+
+	return t <= 1.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pick
+
+SgNodeImpl* SgBoundsTreeImpl::Pick( const MtVector3 &v3From, const MtVector3 &v3To ) const
+{
+	MtVector3 v3Direction = v3To - v3From;
+
+	SgNodeImpl *pNearest = BtNull;
+	BtFloat nearest = 1.0f;
+
+	BtU32 stack[MaxBoundsTreeDepth];
+	BtU32 depth = 0;
+
+	if( m_numNodes > 0 )
+	{
+		stack[depth++] = 0;
+	}
+
+	while( depth > 0 )
+	{
+		BtU32 index = stack[--depth];
+		const SgBoundsTreeNode &node = m_pTreeNodes[index];
+
+		// Clip the line to the box one axis at a time, giving up once it misses or only
+		// reaches the box beyond the nearest hit so far
+		BtFloat enter = 0;
+		BtFloat leave = nearest;
+		BtBool isHit = BtTrue;
+
+		for( BtU32 axis=0; ( axis<3 ) && ( isHit == BtTrue ); axis++ )
+		{
+			BtFloat from = v3From[axis];
+			BtFloat direction = v3Direction[axis];
+			BtFloat min = node.m_AABB.Min()[axis];
+			BtFloat max = node.m_AABB.Max()[axis];
+
+			if( direction == 0 )
+			{
+				isHit = ( from >= min ) && ( from <= max );
+				continue;
+			}
+
+			BtFloat t0 = ( min - from ) / direction;
+			BtFloat t1 = ( max - from ) / direction;
+
+			if( t0 > t1 )
+			{
+				BtFloat swap = t0; t0 = t1; t1 = swap;
+			}
+
+			enter = MtMax( enter, t0 );
+			leave = MtMin( leave, t1 );
+			isHit = enter <= leave;
+		}
+
+		if( isHit == BtFalse )
+		{
+			continue;
+		}
+
+		if( node.m_count == 0 )
+		{
+			BtAssert( depth + 2 <= MaxBoundsTreeDepth );
+			stack[depth++] = node.m_right;
+			stack[depth++] = index + 1;
+			continue;
+		}
+
+		for( BtU32 i=node.m_first; i<node.m_first + node.m_count; i++ )
+		{
+			BtFloat t;
+
+			if( ( Intersect( v3From, v3Direction, MtVector3( m_pX[i], m_pY[i], m_pZ[i] ), m_pRadius[i], t ) == BtTrue ) &&
+				( ( pNearest == BtNull ) || ( t < nearest ) ) )
+			{
+				pNearest = m_pNodes[i];
+				nearest = t;
+			}
+		}
+	}
+
+	return pNearest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FindNear
+
+BtU32 SgBoundsTreeImpl::FindNear( const MtVector3 &v3Position, BtFloat radius, SgNode **ppNodes, BtU32 maxNodes ) const
+{
+	MtSphere sphere( v3Position, radius );
+
+	BtU32 numFound = 0;
+
+	BtU32 stack[MaxBoundsTreeDepth];
+	BtU32 depth = 0;
+
+	if( m_numNodes > 0 )
+	{
+		stack[depth++] = 0;
+	}
+
+	while( ( depth > 0 ) && ( numFound < maxNodes ) )
+	{
+		BtU32 index = stack[--depth];
+		const SgBoundsTreeNode &node = m_pTreeNodes[index];
+
+		// How far the sphere's centre is from the box
+		BtFloat distanceSquared = 0;
+
+		for( BtU32 axis=0; axis<3; axis++ )
+		{
+			BtFloat position = v3Position[axis];
+			BtFloat outside = 0;
+
+			if( position < node.m_AABB.Min()[axis] )
+			{
+				outside = node.m_AABB.Min()[axis] - position;
+			}
+			else if( position > node.m_AABB.Max()[axis] )
+			{
+				outside = position - node.m_AABB.Max()[axis];
+			}
+			distanceSquared += outside * outside;
+		}
+
+		if( distanceSquared > radius * radius )
+		{
+			continue;
+		}
+
+		if( node.m_count == 0 )
+		{
+			BtAssert( depth + 2 <= MaxBoundsTreeDepth );
+			stack[depth++] = node.m_right;
+			stack[depth++] = index + 1;
+			continue;
+		}
+
+		for( BtU32 i=node.m_first; ( i<node.m_first + node.m_count ) && ( numFound < maxNodes ); i++ )
+		{
+			if( sphere.SphericalTest( MtSphere( MtVector3( m_pX[i], m_pY[i], m_pZ[i] ), m_pRadius[i] ) ) == BtTrue )
+			{
+				ppNodes[numFound++] = m_pNodes[i];
+			}
+		}
+	}
+
+	return numFound;
+}
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgBoundsTreeImpl.h
+
+#pragma once
+#include "BtTypes.h"
+#include "MtAABB.h"
+#include "MtVector3.h"
+
+class SgNode;
+class SgNodeImpl;
+class RsFrustum;
+struct SgRenderBatch;
+
+// Most meshes in a leaf of the tree
+const BtU32 SgBoundsTreeLeafSize = 8;
+
+// Deep enough for any tree we build, which splits each branch in half
+const BtU32 MaxBoundsTreeDepth = 64;
+
+struct SgBoundsTreeNode
+{
+	MtAABB								m_AABB;
+	BtU32								m_parent;
+	BtU32								m_right;				// The left child follows its parent
+	BtU32								m_first;				// First entry of a leaf
+	BtU32								m_count;				// Entries in a leaf. Zero for branches
+	BtBool								m_isDirty;
+};
+
+// A bounding volume tree over the world spheres of the meshes below a root node, so
+// culling and queries only visit the parts of the scene near what they are looking for.
+// It is built by the root's Update. Each Update then moves the bounds of the meshes whose
+// transforms changed and refits only the branches above them. Adding or removing nodes
+// invalidates it until the next Update rebuilds it
+class SgBoundsTreeImpl
+{
+public:
+
+	SgBoundsTreeImpl();
+
+	void								Destroy();
+
+	// Gather the meshes and skins below the root and split them into a tree
+	void								Build( SgNodeImpl *pRoot );
+	void								Invalidate();
+
+	// Move a mesh's bounds. Call Refit once all of them have moved
+	void								SetBounds( SgNodeImpl *pNode, const MtVector3 &v3Center, BtFloat radius );
+	void								Refit();
+
+	// Add the meshes in branches that touch the frustum, then every skin, to the batch.
+	// Hidden nodes are left out. The batch is passed to pFlush whenever it fills up
+	void								Cull( const RsFrustum &frustum, SgRenderBatch &batch, void (*pFlush)( SgRenderBatch& ) ) const;
+
+	// The mesh whose bounds the line from v3From to v3To enters first
+	SgNodeImpl*							Pick( const MtVector3 &v3From, const MtVector3 &v3To ) const;
+
+	// Meshes whose bounds overlap the sphere. Returns how many were written
+	BtU32								FindNear( const MtVector3 &v3Position, BtFloat radius, SgNode **ppNodes, BtU32 maxNodes ) const;
+
+	// Where along the line the sphere is entered, from 0 to 1. Picking without a tree uses this too
+	static BtBool						Intersect( const MtVector3 &v3From, const MtVector3 &v3Direction,
+												   const MtVector3 &v3Center, BtFloat radius, BtFloat &t );
+
+	// Accessors
+	BtBool								IsBuilt() const;
+	BtU32								GetNumEntries() const;
+	BtU32								GetNumNodes() const;
+
+private:
+
+	void								FreeEntries();
+	void								Count( SgNodeImpl *pNode, BtU32 &numMeshes, BtU32 &numSkins );
+	void								Gather( SgNodeImpl *pNode );
+	BtU32								BuildNode( BtU32 first, BtU32 count, BtU32 parent );
+	void								Select( BtU32 first, BtU32 count, BtU32 nth, const BtFloat *pKey );
+	void								Swap( BtU32 a, BtU32 b );
+	void								RefitNode( BtU32 index );
+
+	// Entries in leaf order, an array per component
+	BtFloat*							m_pX;
+	BtFloat*							m_pY;
+	BtFloat*							m_pZ;
+	BtFloat*							m_pRadius;
+	SgNodeImpl**						m_pNodes;
+	BtU32*								m_pLeaf;				// Each entry's leaf
+	BtU32								m_numEntries;
+	BtU32								m_maxEntries;
+
+	SgBoundsTreeNode*					m_pTreeNodes;
+	BtU32								m_numNodes;
+
+	// Skins aren't culled so they are kept apart
+	SgNodeImpl**						m_pSkins;
+	BtU32								m_numSkins;
+	BtU32								m_maxSkins;
+
+	BtBool								m_isBuilt;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// IsBuilt
+
+inline BtBool SgBoundsTreeImpl::IsBuilt() const
+{
+	return m_isBuilt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumEntries
+
+inline BtU32 SgBoundsTreeImpl::GetNumEntries() const
+{
+	return m_numEntries;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumNodes
+
+inline BtU32 SgBoundsTreeImpl::GetNumNodes() const
+{
+	return m_numNodes;
+}
@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgHierarchyImpl.cpp
+
+#include "BtBase.h"
+#include "BtMemory.h"
+#include "BtCRC.h"
+#include "BtString.h"
+#include "SgHierarchyImpl.h"
+#include "SgBoundsTreeImpl.h"
+#include "SgNodeImpl.h"
+#include "SgMeshImpl.h"
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 1 ) )
+#include <xmmintrin.h>
+#define SG_HIERARCHY_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define SG_HIERARCHY_NEON
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// LMultiply
+
+// The same as m4Local * m4Parent a row at a time. Each row adds its four products in the
+// order MtMatrix4 does, so the results match it to the bit
+static inline void LMultiply( const MtMatrix4 &m4Local, const MtMatrix4 &m4Parent, MtMatrix4 &m4World )
+{
+#if defined( SG_HIERARCHY_SSE )
+	__m128 vRow0 = _mm_loadu_ps( m4Parent.m[0] );
+	__m128 vRow1 = _mm_loadu_ps( m4Parent.m[1] );
+	__m128 vRow2 = _mm_loadu_ps( m4Parent.m[2] );
+	__m128 vRow3 = _mm_loadu_ps( m4Parent.m[3] );
+
+	for( BtU32 i=0; i<4; i++ )
+	{
+		const BtFloat *pRow = m4Local.m[i];
+
+		__m128 vSum = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( pRow[0] ), vRow0 ), _mm_mul_ps( _mm_set1_ps( pRow[1] ), vRow1 ) );
+		vSum = _mm_add_ps( vSum, _mm_mul_ps( _mm_set1_ps( pRow[2] ), vRow2 ) );
+		vSum = _mm_add_ps( vSum, _mm_mul_ps( _mm_set1_ps( pRow[3] ), vRow3 ) );
+
+		_mm_storeu_ps( m4World.m[i], vSum );
+	}
+#elif defined( SG_HIERARCHY_NEON )
+	float32x4_t vRow0 = vld1q_f32( m4Parent.m[0] );
+	float32x4_t vRow1 = vld1q_f32( m4Parent.m[1] );
+	float32x4_t vRow2 = vld1q_f32( m4Parent.m[2] );
+	float32x4_t vRow3 = vld1q_f32( m4Parent.m[3] );
+
+	// Separate multiplies and adds. A fused multiply add would round differently
+	for( BtU32 i=0; i<4; i++ )
+	{
+		const BtFloat *pRow = m4Local.m[i];
+
+		float32x4_t vSum = vaddq_f32( vmulq_n_f32( vRow0, pRow[0] ), vmulq_n_f32( vRow1, pRow[1] ) );
+		vSum = vaddq_f32( vSum, vmulq_n_f32( vRow2, pRow[2] ) );
+		vSum = vaddq_f32( vSum, vmulq_n_f32( vRow3, pRow[3] ) );
+
+		vst1q_f32( m4World.m[i], vSum );
+	}
+#else
+	m4World = m4Local * m4Parent;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LHashName
+
+static BtU32 LHashName( const BtChar *pName )
+{
+	return BtCRC::GenerateHashCode( (const BtU8*)pName, BtStrLength( pName ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+SgHierarchyImpl::SgHierarchyImpl()
+{
+	m_pNodes = BtNull;
+	m_pParent = BtNull;
+	m_pEnd = BtNull;
+	m_pLocal = BtNull;
+	m_pWorld = BtNull;
+	m_pIsDirty = BtNull;
+	m_numEntries = 0;
+	m_maxEntries = 0;
+	m_firstDirty = 0;
+	m_pSkins = BtNull;
+	m_numSkins = 0;
+	m_pNameHash = BtNull;
+	m_pNextName = BtNull;
+	m_pNameTable = BtNull;
+	m_nameTableSize = 0;
+	m_isBuilt = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy
+
+void SgHierarchyImpl::Destroy()
+{
+	Invalidate();
+	FreeEntries();
+
+	m_numEntries = 0;
+	m_numSkins = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeEntries
+
+void SgHierarchyImpl::FreeEntries()
+{
+	if( m_maxEntries > 0 )
+	{
+		BtMemory::Free( m_pNodes );
+		BtMemory::Free( m_pParent );
+		BtMemory::Free( m_pEnd );
+		BtMemory::Free( m_pLocal );
+		BtMemory::Free( m_pWorld );
+		BtMemory::Free( m_pIsDirty );
+		BtMemory::Free( m_pSkins );
+		BtMemory::Free( m_pNameHash );
+		BtMemory::Free( m_pNextName );
+		BtMemory::Free( m_pNameTable );
+		m_maxEntries = 0;
+		m_nameTableSize = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Invalidate
+
+void SgHierarchyImpl::Invalidate()
+{
+	if( m_isBuilt == BtTrue )
+	{
+		// Until it is built again nodes work out their own transforms
+		for( BtU32 i=0; i<m_numEntries; i++ )
+		{
+			m_pNodes[i]->m_pHierarchy = BtNull;
+		}
+	}
+	m_isBuilt = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Count
+
+BtU32 SgHierarchyImpl::Count( SgNodeImpl *pNode )
+{
+	BtU32 numNodes = 1;
+
+	for( SgNodeImpl *pChild = (SgNodeImpl*)pNode->m_pFileData->m_pFirstChild; pChild != BtNull; pChild = (SgNodeImpl*)pChild->m_pFileData->m_pNextSibling )
+	{
+		numNodes += Count( pChild );
+	}
+	return numNodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Gather
+
+void SgHierarchyImpl::Gather( SgNodeImpl *pNode, BtU32 parent )
+{
+	BtU32 entry = m_numEntries++;
+
+	m_pNodes[entry] = pNode;
+	m_pParent[entry] = parent;
+	m_pLocal[entry] = pNode->m_pFileData->m_m4Local;
+	m_pWorld[entry] = pNode->m_pFileData->m_m4World;
+	m_pIsDirty[entry] = BtTrue;
+	m_pNameHash[entry] = LHashName( pNode->pName() );
+
+	pNode->m_pHierarchy = this;
+	pNode->m_hierarchyEntry = entry;
+
+	if( pNode->NodeType() & SgType_Skin )
+	{
+		m_pSkins[m_numSkins++] = entry;
+	}
+
+	for( SgNodeImpl *pChild = (SgNodeImpl*)pNode->m_pFileData->m_pFirstChild; pChild != BtNull; pChild = (SgNodeImpl*)pChild->m_pFileData->m_pNextSibling )
+	{
+		Gather( pChild, entry );
+	}
+
+	m_pEnd[entry] = m_numEntries;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Build
+
+void SgHierarchyImpl::Build( SgNodeImpl *pRoot )
+{
+	Invalidate();
+
+	BtU32 numNodes = Count( pRoot );
+
+	// Keep the memory from the last build when it's big enough
+	if( numNodes > m_maxEntries )
+	{
+		FreeEntries();
+
+		m_pNodes = (SgNodeImpl**)BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgNodeImpl* ) * numNodes );
+		m_pParent = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numNodes );
+		m_pEnd = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numNodes );
+		m_pLocal = (MtMatrix4*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( MtMatrix4 ) * numNodes, 16 );
+		m_pWorld = (MtMatrix4*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( MtMatrix4 ) * numNodes, 16 );
+		m_pIsDirty = (BtBool*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtBool ) * numNodes );
+		m_pSkins = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numNodes );
+		m_pNameHash = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numNodes );
+		m_pNextName = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * numNodes );
+
+		// At most half full so probes stay short
+		m_nameTableSize = 1;
+		while( m_nameTableSize < numNodes * 2 )
+		{
+			m_nameTableSize *= 2;
+		}
+		m_pNameTable = (BtU32*)BtMemory::Allocate( BtMT_SceneGraph, sizeof( BtU32 ) * m_nameTableSize );
+		m_maxEntries = numNodes;
+	}
+
+	m_numEntries = 0;
+	m_numSkins = 0;
+
+	Gather( pRoot, SgHierarchyNoParent );
+
+	for( BtU32 i=0; i<m_nameTableSize; i++ )
+	{
+		m_pNameTable[i] = SgHierarchyNoName;
+	}
+
+	// Entries go in last walked first, so each name's slot ends up with the first walked
+	// and the chain from it runs in the order they were walked. Many nodes of one name
+	// share a slot rather than filling a run of them
+	for( BtU32 i=m_numEntries; i>0; i-- )
+	{
+		BtU32 entry = i - 1;
+		BtU32 slot = m_pNameHash[entry] & ( m_nameTableSize - 1 );
+
+		while( m_pNameTable[slot] != SgHierarchyNoName )
+		{
+			BtU32 first = m_pNameTable[slot];
+
+			if( ( m_pNameHash[first] == m_pNameHash[entry] ) &&
+				( BtStrCompare( m_pNodes[first]->pName(), m_pNodes[entry]->pName() ) == BtTrue ) )
+			{
+				break;
+			}
+			slot = ( slot + 1 ) & ( m_nameTableSize - 1 );
+		}
+		m_pNextName[entry] = m_pNameTable[slot];
+		m_pNameTable[slot] = entry;
+	}
+
+	// Everything is dirty so the next Update works them all out
+	m_firstDirty = 0;
+	m_isBuilt = BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetLocal
+
+void SgHierarchyImpl::SetLocal( BtU32 entry, const MtMatrix4 &m4Local )
+{
+	m_pLocal[entry] = m4Local;
+
+	// The node's own world transform is kept up to date straight away, as it always was
+	BtU32 parent = m_pParent[entry];
+
+	if( parent == SgHierarchyNoParent )
+	{
+		m_pWorld[entry] = m4Local;
+	}
+	else
+	{
+		LMultiply( m4Local, m_pWorld[parent], m_pWorld[entry] );
+	}
+	m_pNodes[entry]->m_pFileData->m_m4World = m_pWorld[entry];
+
+	m_pIsDirty[entry] = BtTrue;
+	m_firstDirty = MtMin( m_firstDirty, entry );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+
+void SgHierarchyImpl::Update( BtU32 entry, SgBoundsTreeImpl *pTree )
+{
+	BtU32 end = m_pEnd[entry];
+
+	// Everything ahead of the first dirty entry is up to date
+	BtU32 start = MtMax( entry, m_firstDirty );
+
+	for( BtU32 i=start; i<end; i++ )
+	{
+		BtU32 parent = m_pParent[i];
+
+		// Parents come first, so their dirty flags already say whether they moved
+		if( ( m_pIsDirty[i] == BtFalse ) &&
+			( ( parent == SgHierarchyNoParent ) || ( m_pIsDirty[parent] == BtFalse ) ) )
+		{
+			continue;
+		}
+
+		if( parent == SgHierarchyNoParent )
+		{
+			m_pWorld[i] = m_pLocal[i];
+		}
+		else
+		{
+			LMultiply( m_pLocal[i], m_pWorld[parent], m_pWorld[i] );
+		}
+		m_pIsDirty[i] = BtTrue;
+
+		SgNodeImpl *pNode = m_pNodes[i];
+		pNode->m_pFileData->m_m4World = m_pWorld[i];
+
+		if( ( pTree != BtNull ) && ( pNode->NodeType() & SgType_Mesh ) )
+		{
+			MtVector3 v3Center;
+			BtFloat radius;
+			pNode->m_pMesh->GetWorldSphere( v3Center, radius );
+
+			pTree->SetBounds( pNode, v3Center, radius );
+		}
+	}
+
+	for( BtU32 i=start; i<end; i++ )
+	{
+		m_pIsDirty[i] = BtFalse;
+	}
+
+	// Anything still dirty is past the range
+	if( m_firstDirty >= entry )
+	{
+		m_firstDirty = ( entry == 0 ) ? m_numEntries : MtMax( m_firstDirty, end );
+	}
+
+	// Bones follow their joints wherever those are
+	for( BtU32 i=0; i<m_numSkins; i++ )
+	{
+		BtU32 skin = m_pSkins[i];
+
+		if( ( skin >= entry ) && ( skin < end ) )
+		{
+			m_pNodes[skin]->UpdateBones();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find
+
+SgNodeImpl* SgHierarchyImpl::Find( BtU32 entry, const BtChar *pName ) const
+{
+	BtU32 hash = LHashName( pName );
+	BtU32 end = m_pEnd[entry];
+
+	for( BtU32 slot = hash & ( m_nameTableSize - 1 ); m_pNameTable[slot] != SgHierarchyNoName; slot = ( slot + 1 ) & ( m_nameTableSize - 1 ) )
+	{
+		BtU32 found = m_pNameTable[slot];
+
+		// Different names can share a hash so check the name itself
+		if( ( m_pNameHash[found] == hash ) &&
+			( BtStrCompare( m_pNodes[found]->pName(), pName ) == BtTrue ) )
+		{
+			// The first of the name at or below the entry. None are past the end
+			while( ( found != SgHierarchyNoName ) && ( found < end ) )
+			{
+				if( found >= entry )
+				{
+					return m_pNodes[found];
+				}
+				found = m_pNextName[found];
+			}
+			return BtNull;
+		}
+	}
+	return BtNull;
+}
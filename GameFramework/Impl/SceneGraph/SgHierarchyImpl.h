@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgHierarchyImpl.h
+
+#pragma once
+#include "BtTypes.h"
+#include "MtMatrix4.h"
+
+class SgNodeImpl;
+class SgBoundsTreeImpl;
+
+// The parent of a root's entry
+const BtU32 SgHierarchyNoParent = 0xFFFFFFFF;
+
+// An unused slot in the name table
+const BtU32 SgHierarchyNoName = 0xFFFFFFFF;
+
+// The transforms of the nodes below a root, each in an array of its own with parents
+// ahead of their children. SetLocalTransform marks a node dirty and Update walks the
+// arrays once from the first dirty entry, working out the world transforms of the dirty
+// nodes and everything below them. Others are left alone. The names of the nodes are
+// hashed into a table so they can be found without walking them, with nodes of the same
+// name chained from the first walked. It is built by the root's first Update or pFind.
+// Adding or removing nodes invalidates it until it's next needed
+class SgHierarchyImpl
+{
+public:
+
+	SgHierarchyImpl();
+
+	void								Destroy();
+
+	// Flatten the nodes below the root. All of them are dirty until the next Update
+	void								Build( SgNodeImpl *pRoot );
+	void								Invalidate();
+
+	// Set a node's local transform. Those below it move at the next Update
+	void								SetLocal( BtU32 entry, const MtMatrix4 &m4Local );
+
+	// Update the entry and everything below it. Meshes that moved have their bounds
+	// moved in the tree when there is one
+	void								Update( BtU32 entry, SgBoundsTreeImpl *pTree );
+
+	// The first node named pName at or below the entry, in the order they are walked
+	SgNodeImpl*							Find( BtU32 entry, const BtChar *pName ) const;
+
+	// Accessors
+	BtBool								IsBuilt() const;
+	BtU32								GetNumEntries() const;
+
+private:
+
+	void								FreeEntries();
+	BtU32								Count( SgNodeImpl *pNode );
+	void								Gather( SgNodeImpl *pNode, BtU32 parent );
+
+	// Entries with parents ahead of their children, an array per component
+	SgNodeImpl**						m_pNodes;
+	BtU32*								m_pParent;
+	BtU32*								m_pEnd;					// One past the last entry below each
+	MtMatrix4*							m_pLocal;
+	MtMatrix4*							m_pWorld;
+	BtBool*								m_pIsDirty;
+	BtU32								m_numEntries;
+	BtU32								m_maxEntries;
+	BtU32								m_firstDirty;
+
+	// Entries of the skins, whose bones follow their joints every Update
+	BtU32*								m_pSkins;
+	BtU32								m_numSkins;
+
+	// Entries by the hash of their name, probed a slot at a time. A slot holds the first
+	// entry of each name and the others follow on from it in the order they were walked
+	BtU32*								m_pNameHash;
+	BtU32*								m_pNextName;
+	BtU32*								m_pNameTable;
+	BtU32								m_nameTableSize;		// A power of two
+
+	BtBool								m_isBuilt;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// IsBuilt
+
+inline BtBool SgHierarchyImpl::IsBuilt() const
+{
+	return m_isBuilt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumEntries
+
+inline BtU32 SgHierarchyImpl::GetNumEntries() const
+{
+	return m_numEntries;
+}
@@ -46,12 +46,26 @@ void SgMaterialsWinGL::FixPointers( BaArchive *pArchive, BtU8* pMemory )
 			//materialBlock.m_pMaterial = (RsMaterialWin32*)materialBlock.m_pMaterial->pDuplicate();
 		}
 	}
+
+	m_pLodFileData = BtNull;
+	m_pMaterialLods = BtNull;
+
+	// Newer archives follow a mesh's material blocks with its levels of detail
+	if( ( m_pNode->NodeType() & SgType_Mesh ) && ( pArchive->GetPackerVersion() >= BaMeshLodVersion ) )
+	{
+		pMemory += nMaterials * sizeof( BaMaterialBlockFileData );
+
+		m_pLodFileData = (BaMeshLodFileData*) pMemory;
+		pMemory += sizeof( BaMeshLodFileData );
+
+		m_pMaterialLods = (BaMaterialLodFileData*) pMemory;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Render
 
-void SgMaterialsWinGL::Render()
+void SgMaterialsWinGL::Render( BtU32 lod )
 {
 	// Cache the renderer
 	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
@@ -78,6 +92,17 @@ void SgMaterialsWinGL::Render()
 			pRenderable->m_pMesh = m_pNode->GetMesh();
 			pRenderable->m_pMaterialBlock = &materialBlock;
 
+			if( m_pMaterialLods != BtNull )
+			{
+				pRenderable->m_nStartRenderBlock = m_pMaterialLods[iMaterialBlock].m_nStartRenderBlock[lod];
+				pRenderable->m_nEndRenderBlock = m_pMaterialLods[iMaterialBlock].m_nEndRenderBlock[lod];
+			}
+			else
+			{
+				pRenderable->m_nStartRenderBlock = materialBlock.m_nStartRenderBlock;
+				pRenderable->m_nEndRenderBlock = materialBlock.m_nEndRenderBlock;
+			}
+
 			// Add the node to the renderable list
 			pCurrentRenderTarget->Add( sortOrder, pRenderable );
 		}
@@ -20,10 +20,16 @@ public:
 	void						SetMaterial( BtU32 iMaterial, RsMaterial* pMaterial );
 	BtU32						NumMaterials() const;
 	void						FixPointers( BaArchive *pArchive, BtU8* pMemory );
-	void						Render();
+
+	// Meshes draw the render blocks of the level of detail given. Skins draw them all
+	void						Render( BtU32 lod );
+
+	// Null when the mesh was packed without levels of detail
+	const BaMeshLodFileData*	GetLodFileData() const;
 
 private:					
 	friend class SgMeshWin32;
+	friend class SgMeshWinGL;
 	friend class SgSkinWin32;
 	friend class SgNodeWinDX;
 	friend class SgNodeImpl;
@@ -31,8 +37,18 @@ private:
 	SgNode					   *m_pNode;
 	BaMaterialsFileData*		m_pMaterialsFileData;
 	BaMaterialBlockFileData*	m_pMaterialBlocks;
+	BaMeshLodFileData*			m_pLodFileData;
+	BaMaterialLodFileData*		m_pMaterialLods;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// GetLodFileData
+
+inline const BaMeshLodFileData* SgMaterialsWinGL::GetLodFileData() const
+{
+	return m_pLodFileData;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetMaterial
 
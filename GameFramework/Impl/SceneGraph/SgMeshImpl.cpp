@@ -17,6 +17,11 @@
 #include "SgMaterialsImpl.h"
 #include "SgBlendShapeImpl.h"
 #include "RsShaderImpl.h"
+#include "RsGL.h"
+#include "SgOcclusionImpl.h"
+
+static MtMatrix4 g_instanceWorld[MaxMeshInstances];
+static BtBool g_isLod = BtTrue;
 
 ////////////////////////////////////////////////////////////////////////////////
 // FixPointers
@@ -25,6 +30,23 @@ void SgMeshWinGL::FixPointers( BaArchive *pArchive, BtU8* pMemory )
 {
 	// Set the file data
 	m_pFileData = (BaSgMeshFileData*) pMemory;
+
+	// No view has drawn the mesh yet
+	for( BtU32 i=0; i<MaxMeshLodViews; i++ )
+	{
+		m_lodViews[i].m_pView = BtNull;
+		m_lodViews[i].m_lod = 0;
+	}
+	m_nextLodView = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetLod
+
+//static
+void SgMeshWinGL::SetLod( BtBool isLod )
+{
+	g_isLod = isLod;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -36,35 +58,217 @@ void SgMeshWinGL::Render()
 	if( 1 )
 	{
 		// Cache the camera frustum
-		const RsFrustum& frustum = RsRenderTargetWinGL::GetCurrent()->GetCamera().GetFrustum();
+		const RsCamera& camera = RsRenderTargetWinGL::GetCurrent()->GetCamera();
+		const RsFrustum& frustum = camera.GetFrustum();
+
+		MtVector3 v3Center;
+		BtFloat radius;
+		GetWorldSphere( v3Center, radius );
+
+		// Are we inside or outside the frustum, and is anything in front of us
+		if( ( frustum.IsInside( v3Center, radius ) == BtTrue ) &&
+			( SgOcclusionImpl::pInstance()->IsVisible( v3Center, radius, camera.GetViewProjection() ) == BtTrue ) )
+		{
+			m_pNode->m_pMaterials->Render( SelectLod( v3Center, radius ) );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RasteriseOccluder
+
+void SgMeshWinGL::RasteriseOccluder( SgOcclusionImpl &occlusion, const MtMatrix4 &m4ViewProjection )
+{
+	RsSceneImpl* pScene = (RsSceneImpl*)m_pNode->m_pFileData->m_pScene;
+	SgMaterialsWinGL* pMaterials = m_pNode->m_pMaterials;
+
+	MtMatrix4 m4WorldViewScreen = m_pNode->m_pFileData->m_m4World * m4ViewProjection;
+
+	const BtU8* pIndexData = pScene->pIndexBuffer()->GetData();
+
+	BtU32 numMaterials = pMaterials->NumMaterials();
+
+	for( BtU32 iMaterialBlock=0; iMaterialBlock<numMaterials; iMaterialBlock++ )
+	{
+		BaMaterialBlockFileData* pMaterialBlock = &pMaterials->m_pMaterialBlocks[iMaterialBlock];
+		RsMaterialImpl* pMaterial = (RsMaterialImpl*) pMaterialBlock->m_pMaterial;
+
+		RsVertexBufferImpl* pVertexBuffer = pScene->pVertexBuffer( pMaterial->GetVertexType() );
+
+		// Positions come first in every vertex that has them
+		if( ( pVertexBuffer->GetVertexType() & VT_Position ) == 0 )
+		{
+			continue;
+		}
+
+		const BtU8* pVertexData = pVertexBuffer->GetData();
+		BtU32 stride = pVertexBuffer->GetStride();
+
+		// The material block covers the full detail render blocks
+		for( BtU32 nRenderBlock=pMaterialBlock->m_nStartRenderBlock; nRenderBlock<pMaterialBlock->m_nEndRenderBlock; nRenderBlock++ )
+		{
+			BaRenderBlockFileData* pRenderBlock = pScene->pRenderBlock( nRenderBlock );
 
-        // Get the AABB
-		const MtAABB& AABB = m_pFileData->m_AABB;
+			for( BtU32 nPrimitiveBlock=pRenderBlock->m_nStartPrimitiveBlock; nPrimitiveBlock<pRenderBlock->m_nEndPrimitiveBlock; nPrimitiveBlock++ )
+			{
+				RsIndexedPrimitive* pPrimitiveBlock = pScene->pPrimitiveBlock( nPrimitiveBlock );
 
-		// Get the center
-		MtVector3 v3Center = AABB.Center();
+				BtBool isStrip = pPrimitiveBlock->m_primitiveType == GL_TRIANGLE_STRIP;
 
-		// Get the edge
-		MtVector3 v3Edge = v3Center + MtVector3( 0, 0, AABB.Radius() );
+				if( ( isStrip == BtFalse ) && ( pPrimitiveBlock->m_primitiveType != GL_TRIANGLES ) )
+				{
+					continue;
+				}
 
-		// Transform the center
-		v3Center *= m_pNode->GetWorldTransform();
+				MtVector4 v4Clip[3];
 
-		// Transform the edge
-		v3Edge *= m_pNode->GetWorldTransform();
+				for( BtU32 i=0; i<pPrimitiveBlock->m_numIndices; i++ )
+				{
+					// Read the index the same way the draw does
+					BtU32 index;
 
-		// Get the distance in case the world transform scaled
-		MtVector3 v3Diff = v3Edge - v3Center;
+					if( pPrimitiveBlock->m_indexType == RsIndexBufferImpl::IndType_Long )
+					{
+						index = ( (const BtU32*)pIndexData )[pPrimitiveBlock->m_startIndex + i];
+					}
+					else
+					{
+						index = ( (const BtU16*)pIndexData )[pPrimitiveBlock->m_startIndex + i];
+					}
 
-		// Get the radius
-		BtFloat radius = v3Diff.GetLength();
+					const MtVector3& v3Position = *(const MtVector3*)( pVertexData + ( index * stride ) );
 
-		// Are we inside or outside the frustum
-		if( frustum.IsInside( v3Center, radius ) == BtTrue )
+					MtVector4 v4Position = MtVector4( v3Position, 1.0f ) * m4WorldViewScreen;
+
+					if( isStrip == BtTrue )
+					{
+						// Each index after the first two makes a triangle with the two before it
+						v4Clip[0] = v4Clip[1];
+						v4Clip[1] = v4Clip[2];
+						v4Clip[2] = v4Position;
+
+						if( i >= 2 )
+						{
+							occlusion.Rasterise( v4Clip[0], v4Clip[1], v4Clip[2] );
+						}
+					}
+					else
+					{
+						v4Clip[i % 3] = v4Position;
+
+						if( ( i % 3 ) == 2 )
+						{
+							occlusion.Rasterise( v4Clip[0], v4Clip[1], v4Clip[2] );
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetLodView
+
+// Each view keeps its own level, so a mesh seen by two cameras doesn't carry the
+// hysteresis of one over to the other. Views are only drawn one at a time
+SgMeshLodView &SgMeshWinGL::GetLodView( const RsRenderTarget *pView )
+{
+	for( BtU32 i=0; i<MaxMeshLodViews; i++ )
+	{
+		if( m_lodViews[i].m_pView == pView )
 		{
-			m_pNode->m_pMaterials->Render();
+			return m_lodViews[i];
 		}
 	}
+
+	// Start a new view at full detail
+	SgMeshLodView &lodView = m_lodViews[m_nextLodView];
+	m_nextLodView = ( m_nextLodView + 1 ) % MaxMeshLodViews;
+
+	lodView.m_pView = pView;
+	lodView.m_lod = 0;
+	return lodView;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SelectLod
+
+BtU32 SgMeshWinGL::SelectLod( const MtVector3 &v3Center, BtFloat radius )
+{
+	const BaMeshLodFileData *pLodFileData = m_pNode->m_pMaterials->GetLodFileData();
+
+	if( ( g_isLod == BtFalse ) || ( pLodFileData == BtNull ) || ( pLodFileData->m_numLods < 2 ) )
+	{
+		return 0;
+	}
+
+	RsRenderTarget *pView = RsRenderTargetWinGL::GetCurrent();
+	const RsCamera &camera = pView->GetCamera();
+	SgMeshLodView &lodView = GetLodView( pView );
+
+	// The projected radius as a fraction of half the screen height. The matrix is indexed
+	// from zero, so _11 is the height scale in row one and column one, not the width
+	BtFloat size = radius * camera.GetProjection()._11;
+
+	if( camera.GetPerspective() == BtTrue )
+	{
+		BtFloat distance = ( v3Center - camera.GetPosition() ).GetLength();
+
+		if( distance <= radius )
+		{
+			lodView.m_lod = 0;
+			return lodView.m_lod;
+		}
+		size /= distance;
+	}
+
+	const BtFloat *pScreenSize = pLodFileData->m_screenSize;
+	BtU32 numLods = MtMin( pLodFileData->m_numLods, MaxMeshLods );
+
+	BtU32 lod = MtMin( lodView.m_lod, numLods - 1 );
+
+	// Move a level at a time only once the size is clearly past the boundary
+	while( ( lod + 1 < numLods ) && ( size < pScreenSize[lod] * ( 1.0f - MeshLodHysteresis ) ) )
+	{
+		++lod;
+	}
+
+	while( ( lod > 0 ) && ( size > pScreenSize[lod - 1] * ( 1.0f + MeshLodHysteresis ) ) )
+	{
+		--lod;
+	}
+
+	lodView.m_lod = lod;
+
+	return lodView.m_lod;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetWorldSphere
+
+void SgMeshWinGL::GetWorldSphere( MtVector3 &v3Center, BtFloat &radius ) const
+{
+	// Get the AABB
+	const MtAABB& AABB = m_pFileData->m_AABB;
+
+	// Get the center
+	v3Center = AABB.Center();
+
+	// Get the edge
+	MtVector3 v3Edge = v3Center + MtVector3( 0, 0, AABB.Radius() );
+
+	// Transform the center
+	v3Center *= m_pNode->GetWorldTransform();
+
+	// Transform the edge
+	v3Edge *= m_pNode->GetWorldTransform();
+
+	// Get the distance in case the world transform scaled
+	MtVector3 v3Diff = v3Edge - v3Center;
+
+	// Get the radius
+	radius = v3Diff.GetLength();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -80,11 +284,8 @@ void SgMeshWinGL::Render( SgMeshRenderable *pRenderable )
 	// Cache the material
 	RsMaterialImpl* pMaterial = (RsMaterialImpl*) pMaterialBlock->m_pMaterial;
 
-	// Set the vertex buffer
-	pScene->pVertexBuffer( pMaterial->GetVertexType() )->SetStream();
-
-	// Set the index stream
-	pScene->pIndexBuffer()->SetIndices();
+	// Set the vertex and index buffers
+	pScene->pVertexBuffer( pMaterial->GetVertexType() )->SetStream( pScene->pIndexBuffer() );
 
 	// Cache the effect
 	RsShaderImpl* pShader = (RsShaderImpl*)pRenderable->m_pShader;
@@ -108,17 +309,8 @@ void SgMeshWinGL::Render( SgMeshRenderable *pRenderable )
 	MtMatrix4 m4WorldViewScreen   = m4World * m4ViewScreen;
 	MtMatrix4 m4WorldView		  = m4World * m4View;
 
-	// Cache the technique
-	const BtChar* pTechnique = pMaterial->GetTechniqueName();
-
-	if( strstr( pTechnique, "RsShaderZLT" ) )
-	{
-		int a=0;
-		a++;
-	}
-
 	// Set the technique
-	pShader->SetTechnique( pTechnique );
+	pShader->SetTechnique( pMaterial->GetTechnique() );
 	pShader->SetMatrix( RsHandles_WorldViewScreen, m4WorldViewScreen );
 	pShader->SetMatrix( RsHandles_WorldViewInverseTranspose, m4WorldView.GetInverse().GetTranspose() );
 	pShader->SetMatrix( RsHandles_ViewInverseTranspose, m4View.GetInverse().GetTranspose() );
@@ -128,8 +320,8 @@ void SgMeshWinGL::Render( SgMeshRenderable *pRenderable )
 	// Ensure we have a material
 	BtAssert( pMaterial != BtNull );
 
-	// Loop through the materials
-	for( BtU32 nRenderBlock=pMaterialBlock->m_nStartRenderBlock; nRenderBlock<pMaterialBlock->m_nEndRenderBlock; nRenderBlock++ )
+	// Loop through the render blocks of the level of detail
+	for( BtU32 nRenderBlock=pRenderable->m_nStartRenderBlock; nRenderBlock<pRenderable->m_nEndRenderBlock; nRenderBlock++ )
 	{
 		// Cache each render block
 		BaRenderBlockFileData* pRenderBlock = pScene->pRenderBlock( nRenderBlock );
@@ -145,3 +337,77 @@ void SgMeshWinGL::Render( SgMeshRenderable *pRenderable )
 		}
 	}
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Render
+
+void SgMeshWinGL::Render( SgMeshRenderable **ppRenderables, BtU32 numInstances )
+{
+	BtAssert( numInstances <= MaxMeshInstances );
+
+	RsSceneImpl* pScene = (RsSceneImpl*)m_pNode->m_pFileData->m_pScene;
+
+	// The instances share everything but their world transforms so use the first's
+	SgMeshRenderable *pRenderable = ppRenderables[0];
+	BaMaterialBlockFileData* pMaterialBlock = pRenderable->m_pMaterialBlock;
+	RsMaterialImpl* pMaterial = (RsMaterialImpl*) pMaterialBlock->m_pMaterial;
+	RsShaderImpl* pShader = (RsShaderImpl*)pRenderable->m_pShader;
+
+	if( pShader->SetInstancedTechnique( pMaterial->GetTechnique() ) == BtFalse )
+	{
+		for( BtU32 i=0; i<numInstances; i++ )
+		{
+			SgMeshWinGL *pMesh = (SgMeshWinGL*)ppRenderables[i]->m_pMesh;
+			pMesh->Render( ppRenderables[i] );
+		}
+		return;
+	}
+
+	// Set the vertex and index buffers
+	pScene->pVertexBuffer( pMaterial->GetVertexType() )->SetStream( pScene->pIndexBuffer() );
+
+	// Stream the world transforms. This leaves the stream buffer bound for the pointers below
+	for( BtU32 i=0; i<numInstances; i++ )
+	{
+		SgMeshWinGL *pMesh = (SgMeshWinGL*)ppRenderables[i]->m_pMesh;
+		g_instanceWorld[i] = pMesh->GetWorldTransform();
+	}
+
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+	BtU32 offset = pImpl->StreamInstances( g_instanceWorld, numInstances );
+
+	// One attribute per column, moving on once per instance
+	for( BtU32 column=0; column<4; column++ )
+	{
+		BtU32 attrib = RsInstanceWorldAttrib + column;
+
+		RsGL::EnableVertexAttribArray( attrib );
+		RsGL::VertexAttribPointer( attrib, 4, GL_FLOAT, GL_FALSE, sizeof( MtMatrix4 ), GL_BUFFER_OFFSET( offset + ( column * sizeof( MtVector4 ) ) ) );
+		RsGL::VertexAttribDivisor( attrib, 1 );
+	}
+
+	// The shader works out the rest from the world transform
+	const RsCamera &camera = pRenderable->m_pRenderTarget->GetCamera();
+	const MtMatrix4 &m4View = camera.GetView();
+
+	pShader->SetMatrix( RsHandles_ViewScreen, camera.GetViewProjection() );
+	pShader->SetMatrix( RsHandles_View, m4View );
+	pShader->SetMatrix( RsHandles_ViewInverseTranspose, m4View.GetInverse().GetTranspose() );
+	pShader->SetMaterial( pMaterial );
+
+	for( BtU32 nRenderBlock=pRenderable->m_nStartRenderBlock; nRenderBlock<pRenderable->m_nEndRenderBlock; nRenderBlock++ )
+	{
+		BaRenderBlockFileData* pRenderBlock = pScene->pRenderBlock( nRenderBlock );
+
+		for( BtU32 nPrimitiveBlock=pRenderBlock->m_nStartPrimitiveBlock; nPrimitiveBlock<pRenderBlock->m_nEndPrimitiveBlock; nPrimitiveBlock++ )
+		{
+			pShader->Draw( pScene->pPrimitiveBlock( nPrimitiveBlock ), numInstances );
+		}
+	}
+
+	// Leave the vertex array as the single draws expect it
+	for( BtU32 column=0; column<4; column++ )
+	{
+		RsGL::DisableVertexAttribArray( RsInstanceWorldAttrib + column );
+	}
+}
@@ -10,7 +10,27 @@
 
 struct SgMeshRenderable;
 class RsShaderD3DEffectWin32;
+class SgOcclusionImpl;
+
+// Most meshes one instanced draw takes
+const BtU32 MaxMeshInstances = 1024;
+
+// How far past a level's screen size a mesh has to move before it changes level, so
+// meshes sitting on the boundary don't switch back and forth every frame
+const BtFloat MeshLodHysteresis = 0.1f;
+
+// Views that keep their own level of detail for each mesh. Any more and the least
+// recently added one is forgotten and starts again from full detail
+const BtU32 MaxMeshLodViews = 4;
+
 class ExTexture;
+class RsRenderTarget;
+
+struct SgMeshLodView
+{
+	const RsRenderTarget*				m_pView;
+	BtU32								m_lod;
+};
 
 // Class Declaration
 class SgMeshWinGL : public SgMesh
@@ -20,20 +40,41 @@ public:
 	void								Render();
 	void								Render( SgMeshRenderable *pNodeRenderable );
 
+	// Draws renderables that share this mesh's geometry, material and shader with one
+	// instanced draw per primitive block. Falls back to drawing them one at a time
+	void								Render( SgMeshRenderable **ppNodeRenderables, BtU32 numInstances );
+
+	// The bounding sphere in world space, used to cull the mesh
+	void								GetWorldSphere( MtVector3 &v3Center, BtFloat &radius ) const;
+
+	// Picks the level of detail to draw from how big the world sphere is on screen
+	BtU32								SelectLod( const MtVector3 &v3Center, BtFloat radius );
+
+	// Draw every mesh at full detail. Used to compare the two
+	static void							SetLod( BtBool isLod );
+
+	// Draws the full detail triangles into the occlusion buffer
+	void								RasteriseOccluder( SgOcclusionImpl &occlusion, const MtMatrix4 &m4ViewProjection );
+
 	// Accessors
 	const MtAABB&						GetAABB() const;
 	const MtSphere&						GetSphere() const;
 	const BtU32							GetNumMaterials() const;
+	const MtMatrix4&					GetWorldTransform() const;
+	BaResource*							GetScene() const;
 
 private:
 
 	friend class SgNodeImpl;
 
 	void								FixPointers( BaArchive *pArchive, BtU8* pMemory );
+	SgMeshLodView&						GetLodView( const RsRenderTarget *pView );
 
 	SgNodeImpl*						m_pNode;
 	BaSgMeshFileData*					m_pFileData;
 	ExTexture*							m_pLightmap;
+	SgMeshLodView						m_lodViews[MaxMeshLodViews];
+	BtU32								m_nextLodView;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,3 +97,19 @@ inline const BtU32 SgMeshWinGL::GetNumMaterials() const
 {
 	return m_pFileData->m_nMaterials;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// GetWorldTransform
+
+inline const MtMatrix4& SgMeshWinGL::GetWorldTransform() const
+{
+	return m_pNode->GetWorldTransform();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetScene
+
+inline BaResource* SgMeshWinGL::GetScene() const
+{
+	return m_pNode->m_pFileData->m_pScene;
+}
@@ -8,6 +8,7 @@
 #include "RsCamera.h"
 #include "RsTextureImpl.h"
 #include "MtMath.h"
+#include "MtSphere.h"
 
 #include "SgBoneImpl.h"
 #include "SgMaterialsImpl.h"
@@ -19,8 +20,16 @@
 #include "SgRigidBodyImpl.h"
 #include "RsImpl.h"
 #include "RsSceneImpl.h"
+#include "RsRenderTargetImpl.h"
 #include "SgMeshImpl.h"
 #include "SgSkinImpl.h"
+#include "SgBoundsTreeImpl.h"
+#include "SgHierarchyImpl.h"
+#include "SgOcclusionImpl.h"
+
+static BtBool g_isBoundsTree = BtTrue;
+static BtBool g_isFlatTransforms = BtTrue;
+static BtBool g_isNameTable = BtTrue;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -33,6 +42,12 @@ SgNodeImpl::SgNodeImpl()
     m_pMesh = BtNull;
     m_pSkin = BtNull;
     m_pBlendShape = BtNull;
+    m_pBoundsTree = BtNull;
+    m_boundsEntry = 0;
+    m_pOwnHierarchy = BtNull;
+    m_pHierarchy = BtNull;
+    m_hierarchyEntry = 0;
+    m_isOccluder = BtFalse;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,12 +75,126 @@ BtU32 SgNodeImpl::GetInstanceSize(BaResourceHeader *pResourceHeader)
 
 void SgNodeImpl::Destroy()
 {
+    DestroyBoundsTree();
+    DestroyHierarchy();
+    SetOccluder( BtFalse );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetBoundsTree
+
+//static
+void SgNodeImpl::SetBoundsTree( BtBool isEnabled )
+{
+    g_isBoundsTree = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetFlatTransforms
+
+//static
+void SgNodeImpl::SetFlatTransforms( BtBool isEnabled )
+{
+    g_isFlatTransforms = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetNameTable
+
+//static
+void SgNodeImpl::SetNameTable( BtBool isEnabled )
+{
+    g_isNameTable = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetRoot
+
+SgNodeImpl* SgNodeImpl::GetRoot()
+{
+    SgNodeImpl* pRoot = this;
+    
+    while( pRoot->m_pFileData->m_pParent != BtNull )
+    {
+        pRoot = (SgNodeImpl*) pRoot->m_pFileData->m_pParent;
+    }
+    return pRoot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetBoundsTree
+
+// This node's tree if it is up to date, otherwise we walk the nodes instead
+SgBoundsTreeImpl* SgNodeImpl::GetBoundsTree()
+{
+    if( ( g_isBoundsTree == BtTrue ) && ( m_pBoundsTree != BtNull ) && ( m_pBoundsTree->IsBuilt() == BtTrue ) )
+    {
+        return m_pBoundsTree;
+    }
+    return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DestroyBoundsTree
+
+void SgNodeImpl::DestroyBoundsTree()
+{
+    if( m_pBoundsTree != BtNull )
+    {
+        m_pBoundsTree->Destroy();
+        BtMemory::Free( m_pBoundsTree );
+        m_pBoundsTree = BtNull;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DestroyHierarchy
+
+void SgNodeImpl::DestroyHierarchy()
+{
+    if( m_pOwnHierarchy != BtNull )
+    {
+        m_pOwnHierarchy->Destroy();
+        BtMemory::Free( m_pOwnHierarchy );
+        m_pOwnHierarchy = BtNull;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BuildHierarchy
+
+// Flatten the nodes below this root the first time and again after nodes are added or removed
+void SgNodeImpl::BuildHierarchy()
+{
+    if( m_pOwnHierarchy == BtNull )
+    {
+        m_pOwnHierarchy = new( BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgHierarchyImpl ) ) ) SgHierarchyImpl;
+    }
+    m_pOwnHierarchy->Build( this );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // pFind
 
 SgNode* SgNodeImpl::pFind( const BtChar* pName )
+{
+    // The hierarchy shares the arrays of the flattened transforms
+    if( ( g_isNameTable == BtTrue ) && ( g_isFlatTransforms == BtTrue ) )
+    {
+        if( m_pHierarchy == BtNull )
+        {
+            GetRoot()->BuildHierarchy();
+        }
+        return m_pHierarchy->Find( m_hierarchyEntry, pName );
+    }
+    
+    return pFindNodes( pName );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pFindNodes
+
+SgNode* SgNodeImpl::pFindNodes( const BtChar* pName )
 {
     if( BtStrCompare( m_pFileData->m_name, pName ) == BtTrue )
     {
@@ -78,7 +207,7 @@ SgNode* SgNodeImpl::pFind( const BtChar* pName )
     // Loop through the children
     while( pChild != BtNull )
     {
-        SgNodeImpl* pNode = (SgNodeImpl*)pChild->pFind( pName );
+        SgNodeImpl* pNode = (SgNodeImpl*)pChild->pFindNodes( pName );
         
         // Update the child
         if( pNode != BtNull )
@@ -92,6 +221,116 @@ SgNode* SgNodeImpl::pFind( const BtChar* pName )
     return BtNull;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// pPick
+
+SgNode* SgNodeImpl::pPick( const MtVector3& v3From, const MtVector3& v3To )
+{
+    SgBoundsTreeImpl* pTree = GetBoundsTree();
+    
+    if( pTree != BtNull )
+    {
+        return pTree->Pick( v3From, v3To );
+    }
+    
+    SgNodeImpl* pNearest = BtNull;
+    BtFloat nearest = 1.0f;
+    
+    PickNodes( v3From, v3To - v3From, pNearest, nearest );
+    
+    return pNearest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PickNodes
+
+void SgNodeImpl::PickNodes( const MtVector3& v3From, const MtVector3& v3Direction, SgNodeImpl *&pNearest, BtFloat &nearest )
+{
+    if( NodeType() & SgType_Mesh )
+    {
+        MtVector3 v3Center;
+        BtFloat radius;
+        m_pMesh->GetWorldSphere( v3Center, radius );
+        
+        BtFloat t;
+        
+        if( ( SgBoundsTreeImpl::Intersect( v3From, v3Direction, v3Center, radius, t ) == BtTrue ) &&
+            ( ( pNearest == BtNull ) || ( t < nearest ) ) )
+        {
+            pNearest = this;
+            nearest = t;
+        }
+    }
+    
+    // Cache the first child
+    SgNodeImpl* pChild = (SgNodeImpl*) m_pFileData->m_pFirstChild;
+    
+    // Loop through the children
+    while( pChild != BtNull )
+    {
+        pChild->PickNodes( v3From, v3Direction, pNearest, nearest );
+        
+        // Move to the next child
+        pChild = (SgNodeImpl*) pChild->m_pFileData->m_pNextSibling;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FindNear
+
+BtU32 SgNodeImpl::FindNear( const MtVector3& v3Position, BtFloat radius, SgNode** ppNodes, BtU32 maxNodes )
+{
+    SgBoundsTreeImpl* pTree = GetBoundsTree();
+    
+    if( pTree != BtNull )
+    {
+        return pTree->FindNear( v3Position, radius, ppNodes, maxNodes );
+    }
+    
+    BtU32 numFound = 0;
+    
+    FindNearNodes( v3Position, radius, ppNodes, maxNodes, numFound );
+    
+    return numFound;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FindNearNodes
+
+void SgNodeImpl::FindNearNodes( const MtVector3& v3Position, BtFloat radius, SgNode** ppNodes, BtU32 maxNodes, BtU32 &numFound )
+{
+    if( numFound == maxNodes )
+    {
+        return;
+    }
+    
+    if( NodeType() & SgType_Mesh )
+    {
+        MtVector3 v3Center;
+        BtFloat meshRadius;
+        m_pMesh->GetWorldSphere( v3Center, meshRadius );
+        
+        MtSphere sphere( v3Position, radius );
+        
+        if( sphere.SphericalTest( MtSphere( v3Center, meshRadius ) ) == BtTrue )
+        {
+            ppNodes[numFound++] = this;
+        }
+    }
+    
+    // Cache the first child
+    SgNodeImpl* pChild = (SgNodeImpl*) m_pFileData->m_pFirstChild;
+    
+    // Loop through the children
+    while( pChild != BtNull )
+    {
+        pChild->FindNearNodes( v3Position, radius, ppNodes, maxNodes, numFound );
+        
+        // Move to the next child
+        pChild = (SgNodeImpl*) pChild->m_pFileData->m_pNextSibling;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetDuplicate
 
@@ -101,7 +340,7 @@ SgNode* SgNodeImpl::GetDuplicate()
     BtU32 instanceSize = GetInstanceSize(BtNull);
     
     // Allocate the memory
-    BtU8* pMemory = BtMemory::Allocate( instanceSize + m_pFileData->m_nFileDataSize );
+    BtU8* pMemory = BtMemory::Allocate( BtMT_SceneGraph, instanceSize + m_pFileData->m_nFileDataSize );
     
     // Create an instance of the new node
     SgNodeImpl* pSgNode = new (pMemory) SgNodeImpl;
@@ -322,6 +561,27 @@ BtBool SgNodeImpl::IsRendered() const
     return ( m_pFileData->m_renderFlags == RsRF_Visible ) || ( m_pFileData->m_renderFlags == RsRF_ForceVisible );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SetOccluder
+
+void SgNodeImpl::SetOccluder( BtBool isOccluder )
+{
+    if( isOccluder == m_isOccluder )
+    {
+        return;
+    }
+    
+    if( isOccluder == BtTrue )
+    {
+        SgOcclusionImpl::pInstance()->AddOccluder( this );
+    }
+    else
+    {
+        SgOcclusionImpl::pInstance()->RemoveOccluder( this );
+    }
+    m_isOccluder = isOccluder;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // pRigidBody
 
@@ -375,6 +635,52 @@ SgNode* SgNodeImpl::GetJoint(BtU32 jointIndex) const
 // Update
 
 void SgNodeImpl::Update()
+{
+    SgNodeImpl* pRoot = GetRoot();
+    SgBoundsTreeImpl* pTree = pRoot->GetBoundsTree();
+    
+    if( g_isFlatTransforms == BtFalse )
+    {
+        // Its arrays would miss the local transforms set while it's off
+        pRoot->DestroyHierarchy();
+        
+        UpdateTransforms( pTree );
+    }
+    else if( m_pHierarchy != BtNull )
+    {
+        // Only the nodes that moved and those below them
+        m_pHierarchy->Update( m_hierarchyEntry, pTree );
+    }
+    else if( pRoot == this )
+    {
+        BuildHierarchy();
+        m_pOwnHierarchy->Update( 0, pTree );
+    }
+    else
+    {
+        UpdateTransforms( pTree );
+    }
+    
+    if( pTree != BtNull )
+    {
+        // Only the branches above meshes that moved
+        pTree->Refit();
+    }
+    else if( ( pRoot == this ) && ( g_isBoundsTree == BtTrue ) )
+    {
+        // Build it the first time and again after nodes are added or removed
+        if( m_pBoundsTree == BtNull )
+        {
+            m_pBoundsTree = new( BtMemory::Allocate( BtMT_SceneGraph, sizeof( SgBoundsTreeImpl ) ) ) SgBoundsTreeImpl;
+        }
+        m_pBoundsTree->Build( this );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UpdateTransforms
+
+void SgNodeImpl::UpdateTransforms( SgBoundsTreeImpl *pTree )
 {
     if( m_pFileData->m_pParent == BtNull )
     {
@@ -394,22 +700,39 @@ void SgNodeImpl::Update()
     while( pChild != BtNull )
     {
         // Update the child
-        pChild->Update();
+        pChild->UpdateTransforms( pTree );
         
         // Move to the next child
         pChild = (SgNodeImpl*) pChild->m_pFileData->m_pNextSibling;
     }
     
+    if( ( pTree != BtNull ) && ( NodeType() & SgType_Mesh ) )
+    {
+        MtVector3 v3Center;
+        BtFloat radius;
+        m_pMesh->GetWorldSphere( v3Center, radius );
+        
+        pTree->SetBounds( this, v3Center, radius );
+    }
+    
     if( m_pFileData->m_nodeType & SgType_Skin )
     {
-        for (BtU32 i = 0; i < m_pSkin->m_pFileData->m_numJoints; i++)
-        {
-            SgNode *pNode = m_pSkin->m_pFileData->m_skeleton[i].m_pJoint;
-            
-            SgBoneImpl *pBone = (SgBoneImpl*)pNode->pBone();
-            
-            pBone->m_boneTransform = pBone->GetInverseBindPose() * pNode->GetWorldTransform();
-        }
+        UpdateBones();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UpdateBones
+
+void SgNodeImpl::UpdateBones()
+{
+    for (BtU32 i = 0; i < m_pSkin->m_pFileData->m_numJoints; i++)
+    {
+        SgNode *pNode = m_pSkin->m_pFileData->m_skeleton[i].m_pJoint;
+        
+        SgBoneImpl *pBone = (SgBoneImpl*)pNode->pBone();
+        
+        pBone->m_boneTransform = pBone->GetInverseBindPose() * pNode->GetWorldTransform();
     }
 }
 
@@ -423,7 +746,12 @@ void SgNodeImpl::SetLocalTransform( const MtMatrix4& m4Transform )
     // Cache the parent
     SgNodeImpl* pParent = (SgNodeImpl*) m_pFileData->m_pParent;
     
-    if( pParent == BtNull )
+    if( m_pHierarchy != BtNull )
+    {
+        // Marks it dirty so the nodes below follow at the next Update
+        m_pHierarchy->SetLocal( m_hierarchyEntry, m4Transform );
+    }
+    else if( pParent == BtNull )
     {
         m_pFileData->m_m4World = m4Transform;
     }
@@ -431,23 +759,84 @@ void SgNodeImpl::SetLocalTransform( const MtMatrix4& m4Transform )
     {
         m_pFileData->m_m4World = m4Transform * pParent->m_pFileData->m_m4World;
     }
+    
+    if( NodeType() & SgType_Mesh )
+    {
+        SgBoundsTreeImpl* pTree = GetRoot()->GetBoundsTree();
+        
+        if( pTree != BtNull )
+        {
+            MtVector3 v3Center;
+            BtFloat radius;
+            m_pMesh->GetWorldSphere( v3Center, radius );
+            
+            pTree->SetBounds( this, v3Center, radius );
+            pTree->Refit();
+        }
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Render
 
+// Rather than culling each mesh as we walk the tree, gather their bounds and cull them
+// a batch at a time. Roots with a bounds tree only gather the branches in view. Otherwise
+// everything is gathered in tree order. Meshes in view are then tested against the occluders
 void SgNodeImpl::Render()
 {
-    if( m_pFileData->m_renderFlags != RsRF_Hidden )
+    SgRenderBatch batch;
+    batch.m_numNodes = 0;
+    
+    const RsCamera& camera = RsRenderTargetWinGL::GetCurrent()->GetCamera();
+    
+    SgOcclusionImpl::pInstance()->Prepare( camera );
+    
+    SgBoundsTreeImpl* pTree = GetBoundsTree();
+    
+    if( pTree != BtNull )
     {
-        if( NodeType() & SgType_Mesh )
+        pTree->Cull( camera.GetFrustum(), batch, RenderBatch );
+    }
+    else
+    {
+        Gather( batch );
+    }
+    RenderBatch( batch );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Gather
+
+void SgNodeImpl::Gather( SgRenderBatch &batch )
+{
+    if( ( m_pFileData->m_renderFlags != RsRF_Hidden ) && ( NodeType() & ( SgType_Mesh | SgType_Skin ) ) )
+    {
+        if( batch.m_numNodes == MaxRenderBatch )
         {
-            m_pMesh->Render();
+            RenderBatch( batch );
         }
         
-        if( NodeType() & SgType_Skin )
+        BtU32 index = batch.m_numNodes++;
+        batch.m_pNodes[index] = this;
+        
+        if( NodeType() & SgType_Mesh )
+        {
+            MtVector3 v3Center;
+            BtFloat radius;
+            m_pMesh->GetWorldSphere( v3Center, radius );
+            
+            batch.m_x[index] = v3Center.x;
+            batch.m_y[index] = v3Center.y;
+            batch.m_z[index] = v3Center.z;
+            batch.m_radius[index] = radius;
+        }
+        else
         {
-            m_pSkin->Render();
+            // Skins aren't culled
+            batch.m_x[index] = 0;
+            batch.m_y[index] = 0;
+            batch.m_z[index] = 0;
+            batch.m_radius[index] = 0;
         }
     }
     
@@ -457,14 +846,56 @@ void SgNodeImpl::Render()
     // Loop through the children
     while( pChild != BtNull )
     {
-        // Render the child
-        pChild->Render();
+        // Gather the child
+        pChild->Gather( batch );
         
         // Move to the next child
         pChild = (SgNodeImpl*) pChild->m_pFileData->m_pNextSibling;
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RenderBatch
+
+//static
+void SgNodeImpl::RenderBatch( SgRenderBatch &batch )
+{
+    if( batch.m_numNodes == 0 )
+    {
+        return;
+    }
+    
+    // Cache the camera frustum
+    const RsCamera& camera = RsRenderTargetWinGL::GetCurrent()->GetCamera();
+    const RsFrustum& frustum = camera.GetFrustum();
+    
+    frustum.IsInside( batch.m_x, batch.m_y, batch.m_z, batch.m_radius, batch.m_numNodes, batch.m_isInside );
+    
+    SgOcclusionImpl* pOcclusion = SgOcclusionImpl::pInstance();
+    
+    for( BtU32 i=0; i<batch.m_numNodes; i++ )
+    {
+        SgNodeImpl* pNode = batch.m_pNodes[i];
+        
+        if( ( pNode->NodeType() & SgType_Mesh ) && ( batch.m_isInside[i] == BtTrue ) )
+        {
+            MtVector3 v3Center( batch.m_x[i], batch.m_y[i], batch.m_z[i] );
+            
+            if( pOcclusion->IsVisible( v3Center, batch.m_radius[i], camera.GetViewProjection() ) == BtTrue )
+            {
+                pNode->m_pMaterials->Render( pNode->m_pMesh->SelectLod( v3Center, batch.m_radius[i] ) );
+            }
+        }
+        
+        if( pNode->NodeType() & SgType_Skin )
+        {
+            pNode->m_pSkin->Render();
+        }
+    }
+    
+    batch.m_numNodes = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // AddChild
 
@@ -472,6 +903,22 @@ void SgNodeImpl::AddChild( SgNode* pChild )
 {
     SgNodeImpl* pChildInst = (SgNodeImpl*) pChild;
     
+    // Its meshes join our root's tree when that is next built, and its nodes our root's hierarchy
+    pChildInst->DestroyBoundsTree();
+    pChildInst->DestroyHierarchy();
+    
+    SgNodeImpl* pRoot = GetRoot();
+    
+    if( pRoot->m_pBoundsTree != BtNull )
+    {
+        pRoot->m_pBoundsTree->Invalidate();
+    }
+    
+    if( pRoot->m_pOwnHierarchy != BtNull )
+    {
+        pRoot->m_pOwnHierarchy->Invalidate();
+    }
+    
     // Add the new child as the first
     SgNodeImpl* pNextChild = (SgNodeImpl*) m_pFileData->m_pFirstChild;
     m_pFileData->m_pFirstChild = pChildInst;
@@ -486,6 +933,18 @@ void SgNodeImpl::RemoveChild( SgNode* pChildNode )
 {
     SgNodeImpl* pChildToRemove = (SgNodeImpl*) pChildNode;
     
+    SgNodeImpl* pRoot = GetRoot();
+    
+    if( pRoot->m_pBoundsTree != BtNull )
+    {
+        pRoot->m_pBoundsTree->Invalidate();
+    }
+    
+    if( pRoot->m_pOwnHierarchy != BtNull )
+    {
+        pRoot->m_pOwnHierarchy->Invalidate();
+    }
+    
     if( m_pFileData->m_pFirstChild == pChildToRemove )
     {
         m_pFileData->m_pFirstChild = pChildToRemove->m_pFileData->m_pNextSibling;
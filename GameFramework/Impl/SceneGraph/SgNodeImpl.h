@@ -21,6 +21,25 @@ class SgCameraWin32;
 class SgBlendShapeImpl;
 class SgLightWin32;
 struct SgMeshRenderable;
+class SgNodeImpl;
+class SgBoundsTreeImpl;
+class SgHierarchyImpl;
+
+// Nodes culled together by SgNodeImpl::Render
+const BtU32 MaxRenderBatch = 256;
+
+// The bounds of the nodes to render, an array per component so the frustum can test
+// several at once. It lives on the stack of whoever is rendering
+struct SgRenderBatch
+{
+	BtFloat						m_x[MaxRenderBatch];
+	BtFloat						m_y[MaxRenderBatch];
+	BtFloat						m_z[MaxRenderBatch];
+	BtFloat						m_radius[MaxRenderBatch];
+	BtBool						m_isInside[MaxRenderBatch];
+	SgNodeImpl*					m_pNodes[MaxRenderBatch];
+	BtU32						m_numNodes;
+};
 
 // Class Declaration
 class SgNodeImpl : public SgNode
@@ -39,8 +58,19 @@ public:
 	MtMatrix3 					WorldRotation() const;
 
 	SgNode*						pFind( const BtChar* pName );
+	SgNode*						pPick( const MtVector3& v3From, const MtVector3& v3To );
+	BtU32						FindNear( const MtVector3& v3Position, BtFloat radius, SgNode** ppNodes, BtU32 maxNodes );
 	SgNode*						GetDuplicate();
 
+	// Turn off to cull and query by walking every node, e.g. to compare the two
+	static void					SetBoundsTree( BtBool isEnabled );
+
+	// Turn off to update transforms by walking every node, e.g. to compare the two
+	static void					SetFlatTransforms( BtBool isEnabled );
+
+	// Turn off to find nodes by comparing the name of each in turn
+	static void					SetNameTable( BtBool isEnabled );
+
 	void						FixPointers( BtU8 *pFileData, BaArchive *pArchive );
 	void						Update();
 	void						Render();
@@ -63,6 +93,8 @@ public:
 	void						SetForceRendered( BtBool enabled );
 	BtBool						IsForceRendered() const;
 	BtBool						IsRendered() const;
+	void						SetOccluder( BtBool isOccluder );
+	BtBool						IsOccluder() const;
 
 	BtBool						IsEnvMapped() const;
 	BtBool						HasMaterials() const;
@@ -85,6 +117,25 @@ private:
 	friend class SgMeshWinGL;
 	friend class SgSkinImpl;
 	friend class SgCollisionWinGL;
+	friend class SgBoundsTreeImpl;
+	friend class SgHierarchyImpl;
+
+	SgNodeImpl*					GetRoot();
+	SgBoundsTreeImpl*			GetBoundsTree();
+	void						DestroyBoundsTree();
+	void						BuildHierarchy();
+	void						DestroyHierarchy();
+	void						UpdateTransforms( SgBoundsTreeImpl *pTree );
+	void						UpdateBones();
+
+	// Walk every node below this one for queries without a tree or hierarchy
+	SgNode*						pFindNodes( const BtChar* pName );
+	void						PickNodes( const MtVector3& v3From, const MtVector3& v3Direction, SgNodeImpl *&pNearest, BtFloat &nearest );
+	void						FindNearNodes( const MtVector3& v3Position, BtFloat radius, SgNode** ppNodes, BtU32 maxNodes, BtU32 &numFound );
+
+	// Collect the visible meshes and skins below this node in the order they are rendered
+	void						Gather( SgRenderBatch &batch );
+	static void					RenderBatch( SgRenderBatch &batch );
 
 	// Instances in order
 	SgMeshWinGL*				m_pMesh;
@@ -99,8 +150,27 @@ private:
 
 	// File data
 	BaSgNodeFileData*			m_pFileData;
+
+	// Only root nodes own a tree. Meshes remember where they are in their root's
+	SgBoundsTreeImpl*			m_pBoundsTree;
+	BtU32						m_boundsEntry;
+
+	// Likewise only roots own their flattened hierarchy. Nodes remember where they are in it
+	SgHierarchyImpl*			m_pOwnHierarchy;
+	SgHierarchyImpl*			m_pHierarchy;
+	BtU32						m_hierarchyEntry;
+
+	BtBool						m_isOccluder;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// IsOccluder
+
+inline BtBool SgNodeImpl::IsOccluder() const
+{
+	return m_isOccluder;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // localTransform
 
@@ -0,0 +1,542 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgOcclusionImpl.cpp
+
+#include "BtBase.h"
+#include "BtAtomic.h"
+#include "BtMemory.h"
+#include "BtTime.h"
+#include "MtMath.h"
+#include "RsCamera.h"
+#include "RsCommandBufferImpl.h"
+#include "SgNodeImpl.h"
+#include "SgMeshImpl.h"
+#include "SgOcclusionImpl.h"
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 1 ) )
+#include <xmmintrin.h>
+#define SG_OCCLUSION_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define SG_OCCLUSION_NEON
+#endif
+
+// Triangles smaller than this in pixels cover no pixel centres worth drawing
+const BtFloat OcclusionMinArea = 1.0e-4f;
+
+static SgOcclusionImpl g_occlusion;
+static BtBool g_isOcclusion = BtTrue;
+
+////////////////////////////////////////////////////////////////////////////////
+// LCopy
+
+// The vectors only declare a copy constructor, so copy into existing ones a component at a time
+static void LCopy( MtVector4 &v4Dest, const MtVector4 &v4Source )
+{
+	v4Dest.x = v4Source.x;
+	v4Dest.y = v4Source.y;
+	v4Dest.z = v4Source.z;
+	v4Dest.w = v4Source.w;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+SgOcclusionImpl::SgOcclusionImpl()
+{
+	m_numOccluders = 0;
+	m_isCurrent = BtFalse;
+	m_isEmpty = BtTrue;
+	BtMemory::Set( &m_stats, 0, sizeof( SgOcclusionStats ) );
+	BtMemory::Set( &m_frameStats, 0, sizeof( SgOcclusionStats ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pInstance
+
+//static
+SgOcclusionImpl* SgOcclusionImpl::pInstance()
+{
+	return &g_occlusion;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetOcclusion
+
+//static
+void SgOcclusionImpl::SetOcclusion( BtBool isEnabled )
+{
+	g_isOcclusion = isEnabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AddOccluder
+
+void SgOcclusionImpl::AddOccluder( SgNodeImpl *pNode )
+{
+	if( ( pNode->NodeType() & SgType_Mesh ) == 0 )
+	{
+		ErrorLog::Printf( "SgOcclusionImpl: %s is not a mesh so it can't be an occluder\n", pNode->pName() );
+		return;
+	}
+
+	for( BtU32 i=0; i<m_numOccluders; i++ )
+	{
+		if( m_pOccluders[i] == pNode )
+		{
+			return;
+		}
+	}
+
+	if( m_numOccluders == MaxOccluders )
+	{
+		ErrorLog::Printf( "SgOcclusionImpl: More than %d occluders. %s is ignored\n", MaxOccluders, pNode->pName() );
+		return;
+	}
+
+	m_pOccluders[m_numOccluders++] = pNode;
+	m_isCurrent = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RemoveOccluder
+
+void SgOcclusionImpl::RemoveOccluder( SgNodeImpl *pNode )
+{
+	for( BtU32 i=0; i<m_numOccluders; i++ )
+	{
+		if( m_pOccluders[i] == pNode )
+		{
+			m_pOccluders[i] = m_pOccluders[--m_numOccluders];
+			m_isCurrent = BtFalse;
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsCurrent
+
+// The buffer can be used again while the camera and every occluder are where they were
+BtBool SgOcclusionImpl::IsCurrent( const MtMatrix4 &m4ViewProjection ) const
+{
+	if( m_isCurrent == BtFalse )
+	{
+		return BtFalse;
+	}
+
+	if( BtMemory::Compare( &m4ViewProjection, &m_m4ViewProjection, sizeof( MtMatrix4 ) ) == BtFalse )
+	{
+		return BtFalse;
+	}
+
+	for( BtU32 i=0; i<m_numOccluders; i++ )
+	{
+		SgNodeImpl *pNode = m_pOccluders[i];
+
+		if( ( pNode->IsRendered() != m_isOccluderRendered[i] ) ||
+			( BtMemory::Compare( &pNode->GetWorldTransform(), &m_m4OccluderWorld[i], sizeof( MtMatrix4 ) ) == BtFalse ) )
+		{
+			return BtFalse;
+		}
+	}
+
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Clear
+
+void SgOcclusionImpl::Clear()
+{
+	// Nothing drawn is as far as the far plane
+	for( BtU32 i=0; i<OcclusionWidth * OcclusionHeight; i++ )
+	{
+		m_depth[i] = 1.0f;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Prepare
+
+void SgOcclusionImpl::Prepare( const RsCamera &camera )
+{
+	if( g_isOcclusion == BtFalse )
+	{
+		m_isCurrent = BtFalse;
+		return;
+	}
+
+	// Jobs may be testing against the buffer so only the main thread draws into it
+	if( RsCommandBufferImpl::GetCurrent() != BtNull )
+	{
+		return;
+	}
+
+	const MtMatrix4 &m4ViewProjection = camera.GetViewProjection();
+
+	if( IsCurrent( m4ViewProjection ) == BtTrue )
+	{
+		return;
+	}
+
+	BtU64 startTime = BtTime::GetElapsedTimeInNanoseconds();
+
+	Clear();
+	m_m4ViewProjection = m4ViewProjection;
+	m_isEmpty = BtTrue;
+
+	for( BtU32 i=0; i<m_numOccluders; i++ )
+	{
+		SgNodeImpl *pNode = m_pOccluders[i];
+
+		m_m4OccluderWorld[i] = pNode->GetWorldTransform();
+		m_isOccluderRendered[i] = pNode->IsRendered();
+
+		if( m_isOccluderRendered[i] == BtTrue )
+		{
+			SgMeshWinGL *pMesh = (SgMeshWinGL*)pNode->GetMesh();
+			pMesh->RasteriseOccluder( *this, m4ViewProjection );
+		}
+	}
+
+	m_isCurrent = BtTrue;
+
+	m_stats.m_numOccluders = m_numOccluders;
+	m_stats.m_rasteriseTime += BtTime::GetElapsedTimeInNanoseconds() - startTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rasterise
+
+void SgOcclusionImpl::Rasterise( const MtVector4 &v4A, const MtVector4 &v4B, const MtVector4 &v4C )
+{
+	++m_stats.m_numTriangles;
+
+	MtVector4 input[3] = { v4A, v4B, v4C };
+	MtVector4 clipped[4];
+	BtU32 numClipped = 0;
+
+	// Clip to the near plane, z = -w. Each corner in front is kept and each edge crossing
+	// the plane adds the point where it does. A triangle becomes at most a quad
+	for( BtU32 i=0; i<3; i++ )
+	{
+		const MtVector4 &v4From = input[i];
+		const MtVector4 &v4To = input[( i + 1 ) % 3];
+
+		BtFloat fromDistance = v4From.z + v4From.w;
+		BtFloat toDistance = v4To.z + v4To.w;
+
+		if( fromDistance >= 0 )
+		{
+			LCopy( clipped[numClipped++], v4From );
+		}
+
+		if( ( fromDistance >= 0 ) != ( toDistance >= 0 ) )
+		{
+			BtFloat t = fromDistance / ( fromDistance - toDistance );
+			const MtVector4 v4Edge( v4To - v4From );
+			LCopy( clipped[numClipped++], v4From + ( v4Edge * t ) );
+		}
+	}
+
+	if( numClipped >= 3 )
+	{
+		RasteriseClipped( clipped, numClipped );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RasteriseClipped
+
+void SgOcclusionImpl::RasteriseClipped( const MtVector4 *pVertex, BtU32 numVertex )
+{
+	MtVector3 v3Screen[4];
+
+	for( BtU32 i=0; i<numVertex; i++ )
+	{
+		const MtVector4 &v4Clip = pVertex[i];
+
+		if( v4Clip.w <= 0 )
+		{
+			return;
+		}
+
+		BtFloat oneOverW = 1.0f / v4Clip.w;
+
+		v3Screen[i].x = ( ( v4Clip.x * oneOverW * 0.5f ) + 0.5f ) * OcclusionWidth;
+		v3Screen[i].y = ( ( v4Clip.y * oneOverW * 0.5f ) + 0.5f ) * OcclusionHeight;
+		v3Screen[i].z = v4Clip.z * oneOverW;
+	}
+
+	// Draw the clipped polygon as a fan
+	for( BtU32 i=2; i<numVertex; i++ )
+	{
+		RasteriseScreen( v3Screen[0], v3Screen[i - 1], v3Screen[i] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RasteriseScreen
+
+// Keeps the nearest depth at each pixel whose centre the triangle covers. Each row is
+// walked four pixels at a time
+void SgOcclusionImpl::RasteriseScreen( const MtVector3 &v3A, const MtVector3 &v3B, const MtVector3 &v3C )
+{
+	BtFloat area = ( ( v3B.x - v3A.x ) * ( v3C.y - v3A.y ) ) -
+				   ( ( v3B.y - v3A.y ) * ( v3C.x - v3A.x ) );
+
+	if( MtAbs( area ) < OcclusionMinArea )
+	{
+		return;
+	}
+
+	// Occluders are drawn from both sides so wind them all the same way
+	const MtVector3 *pSecond = &v3B;
+	const MtVector3 *pThird = &v3C;
+
+	if( area < 0 )
+	{
+		pSecond = &v3C;
+		pThird = &v3B;
+		area = -area;
+	}
+
+	const MtVector3 &v3First = v3A;
+	const MtVector3 &v3Second = *pSecond;
+	const MtVector3 &v3Third = *pThird;
+
+	// Pixels whose centres fall inside the bounds, clamped to the buffer
+	BtFloat minX = MtMax( MtMin( v3First.x, MtMin( v3Second.x, v3Third.x ) ), 0.0f );
+	BtFloat maxX = MtMin( MtMax( v3First.x, MtMax( v3Second.x, v3Third.x ) ), (BtFloat)OcclusionWidth );
+	BtFloat minY = MtMax( MtMin( v3First.y, MtMin( v3Second.y, v3Third.y ) ), 0.0f );
+	BtFloat maxY = MtMin( MtMax( v3First.y, MtMax( v3Second.y, v3Third.y ) ), (BtFloat)OcclusionHeight );
+
+	BtS32 startX = (BtS32)MtCeil( minX - 0.5f );
+	BtS32 endX = (BtS32)MtFloor( maxX - 0.5f );
+	BtS32 startY = (BtS32)MtCeil( minY - 0.5f );
+	BtS32 endY = (BtS32)MtFloor( maxY - 0.5f );
+
+	endX = MtMin( endX, (BtS32)OcclusionWidth - 1 );
+	endY = MtMin( endY, (BtS32)OcclusionHeight - 1 );
+
+	if( ( startX > endX ) || ( startY > endY ) )
+	{
+		return;
+	}
+
+	m_isEmpty = BtFalse;
+
+	// Each edge is a * x + b * y + c, positive on the inside
+	BtFloat a0 = v3First.y - v3Second.y;
+	BtFloat b0 = v3Second.x - v3First.x;
+	BtFloat c0 = -( ( a0 * v3First.x ) + ( b0 * v3First.y ) );
+
+	BtFloat a1 = v3Second.y - v3Third.y;
+	BtFloat b1 = v3Third.x - v3Second.x;
+	BtFloat c1 = -( ( a1 * v3Second.x ) + ( b1 * v3Second.y ) );
+
+	BtFloat a2 = v3Third.y - v3First.y;
+	BtFloat b2 = v3First.x - v3Third.x;
+	BtFloat c2 = -( ( a2 * v3Third.x ) + ( b2 * v3Third.y ) );
+
+	// Depth is a plane in screen space. Each edge weights the corner opposite it
+	BtFloat oneOverArea = 1.0f / area;
+	BtFloat za = ( ( a1 * v3First.z ) + ( a2 * v3Second.z ) + ( a0 * v3Third.z ) ) * oneOverArea;
+	BtFloat zb = ( ( b1 * v3First.z ) + ( b2 * v3Second.z ) + ( b0 * v3Third.z ) ) * oneOverArea;
+	BtFloat zc = ( ( c1 * v3First.z ) + ( c2 * v3Second.z ) + ( c0 * v3Third.z ) ) * oneOverArea;
+
+	// Start each row on a group of four
+	BtS32 groupX = startX & ~3;
+
+	for( BtS32 y=startY; y<=endY; y++ )
+	{
+		BtFloat centreY = (BtFloat)y + 0.5f;
+
+		BtFloat row0 = ( b0 * centreY ) + c0;
+		BtFloat row1 = ( b1 * centreY ) + c1;
+		BtFloat row2 = ( b2 * centreY ) + c2;
+		BtFloat rowZ = ( zb * centreY ) + zc;
+
+		BtFloat *pRow = m_depth + ( y * OcclusionWidth );
+
+#if defined( SG_OCCLUSION_SSE )
+		__m128 vZero = _mm_setzero_ps();
+
+		for( BtS32 x=groupX; x<=endX; x+=4 )
+		{
+			__m128 vX = _mm_add_ps( _mm_set1_ps( (BtFloat)x ), _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f ) );
+
+			__m128 vEdge0 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a0 ), vX ), _mm_set1_ps( row0 ) );
+			__m128 vEdge1 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a1 ), vX ), _mm_set1_ps( row1 ) );
+			__m128 vEdge2 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a2 ), vX ), _mm_set1_ps( row2 ) );
+			__m128 vDepth = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( za ), vX ), _mm_set1_ps( rowZ ) );
+
+			__m128 vInside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( vEdge0, vZero ), _mm_cmpge_ps( vEdge1, vZero ) ),
+										 _mm_cmpge_ps( vEdge2, vZero ) );
+
+			__m128 vOld = _mm_loadu_ps( pRow + x );
+			__m128 vNew = _mm_min_ps( vOld, vDepth );
+
+			_mm_storeu_ps( pRow + x, _mm_or_ps( _mm_and_ps( vInside, vNew ), _mm_andnot_ps( vInside, vOld ) ) );
+		}
+#elif defined( SG_OCCLUSION_NEON )
+		static const BtFloat centres[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+		float32x4_t vCentres = vld1q_f32( centres );
+		float32x4_t vZero = vdupq_n_f32( 0 );
+
+		for( BtS32 x=groupX; x<=endX; x+=4 )
+		{
+			float32x4_t vX = vaddq_f32( vdupq_n_f32( (BtFloat)x ), vCentres );
+
+			float32x4_t vEdge0 = vaddq_f32( vmulq_f32( vdupq_n_f32( a0 ), vX ), vdupq_n_f32( row0 ) );
+			float32x4_t vEdge1 = vaddq_f32( vmulq_f32( vdupq_n_f32( a1 ), vX ), vdupq_n_f32( row1 ) );
+			float32x4_t vEdge2 = vaddq_f32( vmulq_f32( vdupq_n_f32( a2 ), vX ), vdupq_n_f32( row2 ) );
+			float32x4_t vDepth = vaddq_f32( vmulq_f32( vdupq_n_f32( za ), vX ), vdupq_n_f32( rowZ ) );
+
+			uint32x4_t vInside = vandq_u32( vandq_u32( vcgeq_f32( vEdge0, vZero ), vcgeq_f32( vEdge1, vZero ) ),
+											vcgeq_f32( vEdge2, vZero ) );
+
+			float32x4_t vOld = vld1q_f32( pRow + x );
+
+			vst1q_f32( pRow + x, vbslq_f32( vInside, vminq_f32( vOld, vDepth ), vOld ) );
+		}
+#else
+		for( BtS32 x=groupX; x<=endX; x++ )
+		{
+			BtFloat centreX = (BtFloat)x + 0.5f;
+
+			BtFloat edge0 = ( a0 * centreX ) + row0;
+			BtFloat edge1 = ( a1 * centreX ) + row1;
+			BtFloat edge2 = ( a2 * centreX ) + row2;
+
+			if( ( edge0 >= 0 ) && ( edge1 >= 0 ) && ( edge2 >= 0 ) )
+			{
+				pRow[x] = MtMin( pRow[x], ( za * centreX ) + rowZ );
+			}
+		}
+#endif
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsVisible
+
+BtBool SgOcclusionImpl::IsVisible( const MtVector3 &v3Center, BtFloat radius, const MtMatrix4 &m4ViewProjection )
+{
+	if( ( g_isOcclusion == BtFalse ) || ( m_isCurrent == BtFalse ) || ( m_isEmpty == BtTrue ) )
+	{
+		return BtTrue;
+	}
+
+	// The buffer says nothing about what another view can see
+	if( BtMemory::Compare( &m4ViewProjection, &m_m4ViewProjection, sizeof( MtMatrix4 ) ) == BtFalse )
+	{
+		return BtTrue;
+	}
+
+	BtAtomicAdd( &m_stats.m_numTested, 1 );
+
+	// Project the corners of the box around the sphere to find the pixels it covers and
+	// the nearest it comes to the camera
+	BtFloat minX = 0, maxX = 0, minY = 0, maxY = 0, minZ = 0;
+
+	for( BtU32 i=0; i<8; i++ )
+	{
+		MtVector4 v4Corner( v3Center.x + ( ( i & 1 ) ? radius : -radius ),
+							v3Center.y + ( ( i & 2 ) ? radius : -radius ),
+							v3Center.z + ( ( i & 4 ) ? radius : -radius ),
+							1.0f );
+
+		MtVector4 v4Clip = v4Corner * m_m4ViewProjection;
+
+		// Anything reaching through the near plane is too close to be hidden
+		if( ( v4Clip.w <= 0 ) || ( v4Clip.z + v4Clip.w < 0 ) )
+		{
+			return BtTrue;
+		}
+
+		BtFloat oneOverW = 1.0f / v4Clip.w;
+		BtFloat x = ( ( v4Clip.x * oneOverW * 0.5f ) + 0.5f ) * OcclusionWidth;
+		BtFloat y = ( ( v4Clip.y * oneOverW * 0.5f ) + 0.5f ) * OcclusionHeight;
+		BtFloat z = v4Clip.z * oneOverW;
+
+		if( i == 0 )
+		{
+			minX = maxX = x;
+			minY = maxY = y;
+			minZ = z;
+		}
+		else
+		{
+			minX = MtMin( minX, x );
+			maxX = MtMax( maxX, x );
+			minY = MtMin( minY, y );
+			maxY = MtMax( maxY, y );
+			minZ = MtMin( minZ, z );
+		}
+	}
+
+	// Every pixel the box touches, not just those whose centres it covers
+	BtS32 startX = (BtS32)MtFloor( MtMax( minX, 0.0f ) );
+	BtS32 endX = (BtS32)MtFloor( MtMin( maxX, (BtFloat)OcclusionWidth - 1.0f ) );
+	BtS32 startY = (BtS32)MtFloor( MtMax( minY, 0.0f ) );
+	BtS32 endY = (BtS32)MtFloor( MtMin( maxY, (BtFloat)OcclusionHeight - 1.0f ) );
+
+	if( ( startX > endX ) || ( startY > endY ) )
+	{
+		return BtTrue;
+	}
+
+	// Visible if any of them has nothing in front of the box
+	for( BtS32 y=startY; y<=endY; y++ )
+	{
+		const BtFloat *pRow = m_depth + ( y * OcclusionWidth );
+		BtS32 x = startX;
+
+#if defined( SG_OCCLUSION_SSE )
+		__m128 vNearest = _mm_set1_ps( minZ );
+
+		for( ; x + 3<=endX; x+=4 )
+		{
+			if( _mm_movemask_ps( _mm_cmpge_ps( _mm_loadu_ps( pRow + x ), vNearest ) ) != 0 )
+			{
+				return BtTrue;
+			}
+		}
+#elif defined( SG_OCCLUSION_NEON )
+		float32x4_t vNearest = vdupq_n_f32( minZ );
+
+		for( ; x + 3<=endX; x+=4 )
+		{
+			uint32x4_t vVisible = vcgeq_f32( vld1q_f32( pRow + x ), vNearest );
+			uint32x2_t vAny = vorr_u32( vget_low_u32( vVisible ), vget_high_u32( vVisible ) );
+
+			if( ( vget_lane_u32( vAny, 0 ) | vget_lane_u32( vAny, 1 ) ) != 0 )
+			{
+				return BtTrue;
+			}
+		}
+#endif
+		for( ; x<=endX; x++ )
+		{
+			if( pRow[x] >= minZ )
+			{
+				return BtTrue;
+			}
+		}
+	}
+
+	BtAtomicAdd( &m_stats.m_numCulled, 1 );
+
+	return BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndFrame
+
+void SgOcclusionImpl::EndFrame()
+{
+	m_frameStats = m_stats;
+	BtMemory::Set( &m_stats, 0, sizeof( SgOcclusionStats ) );
+	m_stats.m_numOccluders = m_numOccluders;
+}
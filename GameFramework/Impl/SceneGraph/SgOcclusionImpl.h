@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+/// SgOcclusionImpl.h
+
+#pragma once
+#include "BtTypes.h"
+#include "MtMatrix4.h"
+#include "MtVector3.h"
+#include "MtVector4.h"
+
+class SgNodeImpl;
+class RsCamera;
+
+// Size of the depth buffer occluders are drawn into. The width is a multiple of four
+// so each row splits into whole SIMD groups
+const BtU32 OcclusionWidth = 256;
+const BtU32 OcclusionHeight = 128;
+
+// Most meshes that can be occluders at once
+const BtU32 MaxOccluders = 256;
+
+struct SgOcclusionStats
+{
+	BtU32								m_numOccluders;
+	BtU32								m_numTriangles;			// Occluder triangles drawn
+	BtS32								m_numTested;
+	BtS32								m_numCulled;
+	BtU64								m_rasteriseTime;		// Nanoseconds spent drawing the occluders
+};
+
+// A small depth buffer on the CPU that the meshes marked as occluders are drawn into. Meshes
+// that pass the frustum are then tested against it before their renderables are made. The
+// occluders are drawn again only when the camera or one of them has moved. That has to happen
+// on the main thread, so jobs recording renderables leave meshes alone until it is up to date
+class SgOcclusionImpl
+{
+public:
+
+	SgOcclusionImpl();
+
+	// Only meshes are drawn
+	void								AddOccluder( SgNodeImpl *pNode );
+	void								RemoveOccluder( SgNodeImpl *pNode );
+
+	// Draw the occluders from this camera unless the buffer already holds them
+	void								Prepare( const RsCamera &camera );
+
+	// False when the sphere is behind the occluders everywhere it covers on screen. Always
+	// true when the buffer was drawn from a different view projection, e.g. another camera
+	BtBool								IsVisible( const MtVector3 &v3Center, BtFloat radius, const MtMatrix4 &m4ViewProjection );
+
+	// Draws one occluder triangle given in clip space
+	void								Rasterise( const MtVector4 &v4A, const MtVector4 &v4B, const MtVector4 &v4C );
+
+	// Counts are kept for a frame at a time
+	void								EndFrame();
+	const SgOcclusionStats&				GetFrameStats() const;
+
+	// Turn off to render everything that passes the frustum, e.g. to compare
+	static void							SetOcclusion( BtBool isEnabled );
+
+	static SgOcclusionImpl*				pInstance();
+
+private:
+
+	BtBool								IsCurrent( const MtMatrix4 &m4ViewProjection ) const;
+	void								Clear();
+	void								RasteriseClipped( const MtVector4 *pVertex, BtU32 numVertex );
+	void								RasteriseScreen( const MtVector3 &v3A, const MtVector3 &v3B, const MtVector3 &v3C );
+
+	BtFloat								m_depth[OcclusionWidth * OcclusionHeight];
+
+	SgNodeImpl*							m_pOccluders[MaxOccluders];
+	MtMatrix4							m_m4OccluderWorld[MaxOccluders];		// Where each was when drawn
+	BtBool								m_isOccluderRendered[MaxOccluders];
+	BtU32								m_numOccluders;
+
+	MtMatrix4							m_m4ViewProjection;
+	BtBool								m_isCurrent;
+	BtBool								m_isEmpty;
+
+	SgOcclusionStats					m_stats;
+	SgOcclusionStats					m_frameStats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// GetFrameStats
+
+inline const SgOcclusionStats& SgOcclusionImpl::GetFrameStats() const
+{
+	return m_frameStats;
+}
@@ -51,7 +51,7 @@ void SgSkinImpl::GetDuplicate()
 //virtual
 void SgSkinImpl::Render()
 {
-    m_pSkinNode->m_pMaterials->Render();
+    m_pSkinNode->m_pMaterials->Render( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,11 +67,8 @@ void SgSkinImpl::Render( SgSkinRenderable* pRenderable )
 	// Cache the material
 	RsMaterialImpl* pMaterial = (RsMaterialImpl*) pMaterialBlock->m_pMaterial;
 
-	// Set the vertex buffer
-	pScene->pVertexBuffer( pMaterial->GetVertexType() )->SetStream();
-
-	// Set the index stream
-	pScene->pIndexBuffer()->SetIndices();
+	// Set the vertex and index buffers
+	pScene->pVertexBuffer( pMaterial->GetVertexType() )->SetStream( pScene->pIndexBuffer() );
 
 	// Cache the effect
 	RsShaderImpl* pShader = (RsShaderImpl*)pRenderable->m_pShader;
@@ -98,17 +95,8 @@ void SgSkinImpl::Render( SgSkinRenderable* pRenderable )
 	MtMatrix4 m4WorldViewScreen   = m4World * m4ViewScreen;
 	MtMatrix4 m4WorldView		  = m4World * m4View;
 
-	// Cache the technique
-	const BtChar* pTechnique = pMaterial->GetTechniqueName();
-
-	if (strstr(pTechnique, "RsShaderZLT"))
-	{
-		int a = 0;
-		a++;
-	}
-
 	// Set the technique
-	pShader->SetTechnique( "RsShaderZLTS" );
+	pShader->SetTechnique( RsTechnique_ShaderZLTS );
 	pShader->SetMatrix( RsHandles_WorldViewScreen, m4WorldViewScreen );
 	pShader->SetMatrix( RsHandles_WorldViewInverseTranspose, m4WorldView.GetInverse().GetTranspose() );
 	pShader->SetMatrix( RsHandles_ViewInverseTranspose, m4View.GetInverse().GetTranspose() );
@@ -25,6 +25,7 @@ public:
 	// Accessors
 	const MtAABB&				AABB() const;
 	const MtSphere&				Sphere() const;
+	const MtMatrix4&			GetWorldTransform() const;
 
 private:
 
@@ -55,3 +56,10 @@ inline const MtSphere& SgSkinImpl::Sphere() const
 	return m_pFileData->m_sphere;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// GetWorldTransform
+
+inline const MtMatrix4& SgSkinImpl::GetWorldTransform() const
+{
+	return m_pSkinNode->GetWorldTransform();
+}
@@ -5,16 +5,40 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
 
-struct timeval start, end;
-long mtime, seconds, useconds;
+static BtU64 g_start = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtTime_GetNanoseconds
+
+static BtU64 LBtTime_GetNanoseconds()
+{
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase = { 0, 0 };
+
+	if( timebase.denom == 0 )
+	{
+		mach_timebase_info( &timebase );
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return ( (BtU64)now.tv_sec * 1000000000ULL ) + (BtU64)now.tv_nsec;
+#endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Init
 
 void BtTime::Init()
 {
-    gettimeofday(&start, NULL);
+	g_start = LBtTime_GetNanoseconds();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -49,19 +73,20 @@ void BtTime::SetTick(BtFloat tick)
     m_tick = tick;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// GetElapsedTimeInNanoseconds
+
+BtU64 BtTime::GetElapsedTimeInNanoseconds()
+{
+	return LBtTime_GetNanoseconds() - g_start;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetElapsedTimeInMilliseconds
 
 BtFloat BtTime::GetElapsedTimeInMilliseconds()
 {
-    gettimeofday(&end, NULL);
-    
-    seconds  = end.tv_sec  - start.tv_sec;
-    useconds = end.tv_usec - start.tv_usec;
-    
-    mtime = ((seconds) * 1000 + useconds/1000.0) + 0.5;
-    
-    return mtime;
+	return (BtFloat)( (BtDouble)GetElapsedTimeInNanoseconds() / 1000000.0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -69,14 +94,7 @@ BtFloat BtTime::GetElapsedTimeInMilliseconds()
 
 BtFloat BtTime::GetElapsedTimeInSeconds()
 {
-    gettimeofday(&end, NULL);
-    
-    seconds  = end.tv_sec  - start.tv_sec;
-    useconds = end.tv_usec - start.tv_usec;
-    
-    mtime = ((seconds) * 1000 + useconds/1000.0) + 0.5;
-    
-    return mtime / 1000.0f;
+	return (BtFloat)( (BtDouble)GetElapsedTimeInNanoseconds() / 1000000000.0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtMutex.cpp
+
+#ifndef WIN32
+#include <pthread.h>
+#include "BtMutex.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtMutex::BtMutex()
+{
+	pthread_mutex_t* pMutex = new pthread_mutex_t;
+	pthread_mutex_init( pMutex, BtNull );
+	m_pHandle = pMutex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+BtMutex::~BtMutex()
+{
+	pthread_mutex_t* pMutex = (pthread_mutex_t*)m_pHandle;
+	pthread_mutex_destroy( pMutex );
+	delete pMutex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Lock
+
+void BtMutex::Lock()
+{
+	pthread_mutex_lock( (pthread_mutex_t*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TryLock
+
+BtBool BtMutex::TryLock()
+{
+	return pthread_mutex_trylock( (pthread_mutex_t*)m_pHandle ) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unlock
+
+void BtMutex::Unlock()
+{
+	pthread_mutex_unlock( (pthread_mutex_t*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtConditionVariable::BtConditionVariable()
+{
+	pthread_cond_t* pCondition = new pthread_cond_t;
+	pthread_cond_init( pCondition, BtNull );
+	m_pHandle = pCondition;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+BtConditionVariable::~BtConditionVariable()
+{
+	pthread_cond_t* pCondition = (pthread_cond_t*)m_pHandle;
+	pthread_cond_destroy( pCondition );
+	delete pCondition;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wait
+
+void BtConditionVariable::Wait( BtMutex& mutex )
+{
+	pthread_cond_wait( (pthread_cond_t*)m_pHandle, (pthread_mutex_t*)mutex.m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NotifyOne
+
+void BtConditionVariable::NotifyOne()
+{
+	pthread_cond_signal( (pthread_cond_t*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NotifyAll
+
+void BtConditionVariable::NotifyAll()
+{
+	pthread_cond_broadcast( (pthread_cond_t*)m_pHandle );
+}
+#endif
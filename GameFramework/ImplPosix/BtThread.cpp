@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtThread.cpp
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "BtThread.h"
+#include "BtMemory.h"
+#include "BtProfiler.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Forward declarations
+
+static void* LBtThread_EntryPoint( void* pParameter );
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtThread::BtThread()
+{
+	m_nThreadID = 0;
+	m_nThreadHandle = 0;
+	m_pHandle = BtNull;
+	m_ePriority = TP_Normal;
+	m_bThreadEnded = BtFalse;
+	m_bSuspended = BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Start
+
+void BtThread::Start()
+{
+	static volatile BtU32 nextThreadID = 1;
+
+	pthread_t* pThread = new pthread_t;
+
+	m_pHandle = pThread;
+	m_nThreadID = __sync_fetch_and_add( &nextThreadID, 1 );
+	m_nThreadHandle = m_nThreadID;
+
+	// A thread that was ended can be started again. Clear the flag here rather than on the
+	// new thread so an End that comes before it runs isn't lost
+	IsEnded( BtFalse );
+
+	if( pthread_create( pThread, BtNull, LBtThread_EntryPoint, static_cast< void* >( this ) ) != 0 )
+	{
+		delete pThread;
+		m_pHandle = BtNull;
+		IsEnded( BtTrue );
+		return;
+	}
+
+	// Apply a priority that was set before the thread existed
+	if( m_ePriority != TP_Normal )
+	{
+		Priority( m_ePriority );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// End
+
+void BtThread::End()
+{
+	// Call the closing event so the thread knows it's been told to close
+	Closing();
+
+	// Set the thread to inactive
+	IsEnded( BtTrue );
+
+	// We have to resume the thread for it to end it's loop
+	Resume();
+
+	// Wait for the thread to finish
+	pthread_t* pThread = (pthread_t*)m_pHandle;
+
+	if( pThread != BtNull )
+	{
+		pthread_join( *pThread, BtNull );
+		delete pThread;
+		m_pHandle = BtNull;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Resume
+
+void BtThread::Resume()
+{
+	BtAtomicStore( &m_bSuspended, BtFalse );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Suspend
+
+void BtThread::Suspend()
+{
+	// pthreads can't be suspended from outside so the thread parks itself between updates
+	BtAtomicStore( &m_bSuspended, BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// YieldThread
+
+void BtThread::YieldThread()
+{
+	sched_yield();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SleepThread
+
+void BtThread::SleepThread( BtU32 milliseconds )
+{
+	if( milliseconds == 0 )
+	{
+		sched_yield();
+	}
+	else
+	{
+		usleep( milliseconds * 1000 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumProcessors
+
+//static
+BtU32 BtThread::GetNumProcessors()
+{
+	long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+
+	if( numProcessors < 1 )
+	{
+		return 1;
+	}
+	return (BtU32)numProcessors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBtThread_EntryPoint
+
+static void* LBtThread_EntryPoint( void* pParameter )
+{
+	BtThread* pThread = reinterpret_cast< BtThread* >( pParameter );
+
+	pThread->Create();
+
+	// Update the threading function
+	while( pThread->IsEnded() == BtFalse )
+	{
+		if( pThread->IsSuspended() == BtTrue )
+		{
+			pThread->SleepThread( 1 );
+			continue;
+		}
+		pThread->Update();
+	}
+
+	pThread->Destroy();
+
+	// Free the profiler slot for the next thread and give back the thread's cached memory
+	BtProfiler::EndThread();
+	BtMemory::EndThread();
+
+	return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Priority
+
+void BtThread::Priority( eThreadPriority ePriority )
+{
+	m_ePriority = ePriority;
+
+	pthread_t* pThread = (pthread_t*)m_pHandle;
+
+	if( pThread == BtNull )
+	{
+		return;
+	}
+
+	BtS32 policy;
+	sched_param param;
+	pthread_getschedparam( *pThread, &policy, &param );
+
+	BtS32 minPriority = sched_get_priority_min( policy );
+	BtS32 maxPriority = sched_get_priority_max( policy );
+
+	switch( m_ePriority )
+	{
+	case TP_Low:
+		param.sched_priority = minPriority;
+		break;
+	case TP_Normal:
+		param.sched_priority = ( minPriority + maxPriority ) / 2;
+		break;
+	case TP_High:
+		param.sched_priority = maxPriority;
+		break;
+	}
+
+	// Unprivileged processes may not be allowed to raise priority. That's not fatal
+	pthread_setschedparam( *pThread, policy, &param );
+}
+#endif
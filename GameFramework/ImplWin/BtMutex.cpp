@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtMutex.cpp
+
+#ifdef WIN32
+#include <windows.h>
+#include "BtMutex.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtMutex::BtMutex()
+{
+	CRITICAL_SECTION* pSection = new CRITICAL_SECTION;
+	InitializeCriticalSection( pSection );
+	m_pHandle = pSection;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+BtMutex::~BtMutex()
+{
+	CRITICAL_SECTION* pSection = (CRITICAL_SECTION*)m_pHandle;
+	DeleteCriticalSection( pSection );
+	delete pSection;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Lock
+
+void BtMutex::Lock()
+{
+	EnterCriticalSection( (CRITICAL_SECTION*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// TryLock
+
+BtBool BtMutex::TryLock()
+{
+	return TryEnterCriticalSection( (CRITICAL_SECTION*)m_pHandle ) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unlock
+
+void BtMutex::Unlock()
+{
+	LeaveCriticalSection( (CRITICAL_SECTION*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+BtConditionVariable::BtConditionVariable()
+{
+	CONDITION_VARIABLE* pCondition = new CONDITION_VARIABLE;
+	InitializeConditionVariable( pCondition );
+	m_pHandle = pCondition;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+
+BtConditionVariable::~BtConditionVariable()
+{
+	delete (CONDITION_VARIABLE*)m_pHandle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wait
+
+void BtConditionVariable::Wait( BtMutex& mutex )
+{
+	SleepConditionVariableCS( (CONDITION_VARIABLE*)m_pHandle, (CRITICAL_SECTION*)mutex.m_pHandle, INFINITE );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NotifyOne
+
+void BtConditionVariable::NotifyOne()
+{
+	WakeConditionVariable( (CONDITION_VARIABLE*)m_pHandle );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NotifyAll
+
+void BtConditionVariable::NotifyAll()
+{
+	WakeAllConditionVariable( (CONDITION_VARIABLE*)m_pHandle );
+}
+#endif
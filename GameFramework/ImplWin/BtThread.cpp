@@ -5,6 +5,8 @@
 #include <windows.h>
 #include <process.h>
 #include "BtThread.h"
+#include "BtMemory.h"
+#include "BtProfiler.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Forward declarations
@@ -17,7 +19,11 @@ DWORD WINAPI LBtThread_EntryPoint( LPVOID lpParameter );
 BtThread::BtThread()
 {
 	m_nThreadID = 0;
+	m_nThreadHandle = 0;
+	m_pHandle = BtNull;
+	m_ePriority = TP_Normal;
 	m_bThreadEnded = BtFalse;
+	m_bSuspended = BtFalse;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +35,10 @@ void BtThread::Start()
 
 	Flags = CREATE_SUSPENDED;
 
+	// A thread that was ended can be started again. Clear the flag here rather than on the
+	// new thread so an End that comes before it runs isn't lost
+	IsEnded( BtFalse );
+
 	m_nThreadHandle = (BtU32) CreateThread( BtNull,
 											0,
 											LBtThread_EntryPoint,
@@ -62,6 +72,7 @@ void BtThread::End()
 
 void BtThread::Resume()
 {
+	BtAtomicStore( &m_bSuspended, BtFalse );
 	ResumeThread( (HANDLE) m_nThreadHandle );
 }
 
@@ -70,6 +81,7 @@ void BtThread::Resume()
 
 void BtThread::Suspend()
 {
+	BtAtomicStore( &m_bSuspended, BtTrue );
 	SuspendThread( (HANDLE) m_nThreadHandle );
 }
 
@@ -89,6 +101,18 @@ void BtThread::SleepThread( BtU32 milliseconds )
 	Sleep( milliseconds );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// GetNumProcessors
+
+//static
+BtU32 BtThread::GetNumProcessors()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo( &systemInfo );
+
+	return systemInfo.dwNumberOfProcessors;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // LBtThread_EntryPoint
 
@@ -98,8 +122,6 @@ DWORD WINAPI LBtThread_EntryPoint( LPVOID lpParameter )
 
 	pThread->Create();
 
-	pThread->IsEnded( BtFalse );
-
 	// Update the threading function
 	while( pThread->IsEnded() == BtFalse )
 	{
@@ -107,6 +129,10 @@ DWORD WINAPI LBtThread_EntryPoint( LPVOID lpParameter )
 	}
 
 	pThread->Destroy();
+
+	// Free the profiler slot for the next thread and give back the thread's cached memory
+	BtProfiler::EndThread();
+	BtMemory::EndThread();
 	
 	// Exit the thread
 	ExitThread(0);
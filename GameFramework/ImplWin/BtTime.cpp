@@ -67,6 +67,28 @@ BtFloat BtTime::GetElapsedTimeInSeconds()
 	return (now.QuadPart - m_depart.QuadPart) / static_cast<float>(freq.QuadPart);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// GetElapsedTimeInNanoseconds
+
+BtU64 BtTime::GetElapsedTimeInNanoseconds()
+{
+	LARGE_INTEGER now;
+	static LARGE_INTEGER freq = { 0 };
+
+	if( freq.QuadPart == 0 )
+	{
+		QueryPerformanceFrequency( &freq );
+	}
+	QueryPerformanceCounter(&now);
+
+	// Split the division so the multiply can't overflow
+	BtU64 ticks = now.QuadPart - m_depart.QuadPart;
+	BtU64 seconds = ticks / freq.QuadPart;
+	BtU64 remainder = ticks % freq.QuadPart;
+
+	return ( seconds * 1000000000ULL ) + ( remainder * 1000000000ULL ) / freq.QuadPart;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // GetElapsedTimeInMilliseconds
 
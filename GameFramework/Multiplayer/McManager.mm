@@ -186,7 +186,7 @@ NSString *ServiceName = @"gavins-test";
     strcpy( event.m_peer.m_networkName, [[peerID displayName] UTF8String] );
     event.m_eventType = MpEventType_ReceivedData;
     event.m_length = (int)[data length];
-    event.m_pData = (char*)BtMemory::Allocate(event.m_length);
+    event.m_pData = (char*)BtMemory::Allocate(BtMT_Network, event.m_length);
     event.m_dataForDelloc = event.m_pData;
     memcpy( event.m_pData, data.bytes, event.m_length );
     MpPeerToPeer::AddEvent(event);
@@ -10,6 +10,7 @@
 #include <mutex>
 #include <string>
 #include "BtMemory.h"
+#include "BtProfiler.h"
 
 #ifdef WIN32
 #include "enetwrapper.h"
@@ -78,6 +79,8 @@ BtU64 MpPeerToPeer::GetTimeStarted()
 //static
 void MpPeerToPeer::Update()
 {
+	BtProfile( "MpPeerToPeer::Update" );
+
 #ifdef WIN32
 	// Update the underlying UDP network
 	udpNetwork.Update();
@@ -297,7 +300,7 @@ void MpPeerToPeer::SendUnsequenced( void *packet, int length )
 #ifdef WIN32
 	udpNetwork.SendUnsequenced( packet, length );
 #else
-    BtU8 *temp = BtMemory::Allocate(length);
+    BtU8 *temp = BtMemory::Allocate(BtMT_Network, length);
     memcpy( temp, packet, length );
     MpEvent event;
     event.m_pData = (BtChar*)temp;
@@ -327,7 +330,7 @@ void MpPeerToPeer::SendReliable(void *packet, int length)
 #ifdef WIN32
 	udpNetwork.SendReliable(packet, length);
 #else
-    BtU8 *temp = BtMemory::Allocate(length);
+    BtU8 *temp = BtMemory::Allocate(BtMT_Network, length);
     memcpy( temp, packet, length );
     MpEvent event;
     event.m_pData = (BtChar*)temp;
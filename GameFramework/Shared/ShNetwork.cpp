@@ -12,8 +12,8 @@
 //static
 
 // Public functions
-BtQueue<ShNetworkAction, 128> ShNetwork::m_actions;
-BtQueue<ShNetworkAction, 128> ShNetwork::m_alerts;
+BtQueueMPMC<ShNetworkAction, 128> ShNetwork::m_actions;
+BtQueueMPMC<ShNetworkAction, 128> ShNetwork::m_alerts;
 BtU32 ShNetwork::m_numConnectedPeers = 0;
 std::vector<std::string> ShNetwork::m_connectedPeers;
 std::string ShNetwork::m_peerName;
@@ -25,7 +25,10 @@ std::mutex networkMutex;
 //static
 void ShNetwork::PushAction( ShNetworkAction action )
 {
-    m_actions.Push( action );
+    // Actions arrive on the platform's network threads. A full queue means the game has stopped reading them
+    BtBool isPushed = m_actions.Push( action );
+    BtUnusedVariable( isPushed );
+    BtAssert( isPushed );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -34,7 +37,9 @@ void ShNetwork::PushAction( ShNetworkAction action )
 //static
 void ShNetwork::PushAlert( ShNetworkAction action )
 {
-    m_alerts.Push( action );
+    BtBool isPushed = m_alerts.Push( action );
+    BtUnusedVariable( isPushed );
+    BtAssert( isPushed );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -105,7 +110,9 @@ void ShNetwork::SetConnectedPeers( std::vector<std::string> connectedPeers )
 ShNetworkAction ShNetwork::PopAlert()
 {
     ShNetworkAction action;
-    action = m_alerts.Pop();
+    BtBool isPopped = m_alerts.Pop( action );
+    BtUnusedVariable( isPopped );
+    BtAssert( isPopped );
     return action;
 }
 
@@ -116,7 +123,9 @@ ShNetworkAction ShNetwork::PopAlert()
 ShNetworkAction ShNetwork::PopAction()
 {
     ShNetworkAction action;
-    action = m_actions.Pop();
+    BtBool isPopped = m_actions.Pop( action );
+    BtUnusedVariable( isPopped );
+    BtAssert( isPopped );
     return action;
 }
 
@@ -6,7 +6,7 @@
 
 // Includes
 #include "BtBase.h"
-#include "BtQueue.h"
+#include "BtQueueMPMC.h"
 #include "BtTypes.h"
 #include "MtVector2.h"
 #include "MtQuaternion.h"
@@ -56,8 +56,8 @@ public:
 	// Public functions
 private:
 
-    static BtQueue<ShNetworkAction, 128>    m_actions;
-    static BtQueue<ShNetworkAction, 128>    m_alerts;
+    static BtQueueMPMC<ShNetworkAction, 128> m_actions;
+    static BtQueueMPMC<ShNetworkAction, 128> m_alerts;
     static BtU32                            m_numConnectedPeers;
     static std::vector<std::string>         m_connectedPeers;
     static std::string                      m_peerName;
@@ -45,11 +45,13 @@ public:
 	std::vector<RsIndexedPrimitive>			m_primitives;
 
 	ExPrimitiveType							m_primitiveType;
+	BtU32									m_lod;							// Level of detail this block draws
 };
 
 inline ExRenderBlock::ExRenderBlock()
 {
 	m_primitiveType = ExPT_LIST;
+	m_lod = 0;
 	Empty();
 }
 
@@ -1582,6 +1582,15 @@ void ExScene::ExtractToMaterialAndRenderGroups()
 
 				pMaterialBlock->m_fileData.m_nStartRenderBlock = (BtU32) m_renderBlocks.size();
 
+				// Each level of detail starts empty
+				BaMaterialLodFileData lodFileData;
+
+				for( BtU32 iLod=0; iLod<MaxMeshLods; iLod++ )
+				{
+					lodFileData.m_nStartRenderBlock[iLod] = (BtU32) m_renderBlocks.size();
+					lodFileData.m_nEndRenderBlock[iLod] = (BtU32) m_renderBlocks.size();
+				}
+
 				// Flatten the render blocks
 				BtU32 nRenderBlocks = (BtU32) pMaterialBlock->m_renderBlocks.size();
 
@@ -1590,6 +1599,15 @@ void ExScene::ExtractToMaterialAndRenderGroups()
 					// Cache each render block
 					ExRenderBlock& renderBlock = pMaterialBlock->m_renderBlocks[iRenderBlock];
 
+					// The render blocks of each level follow each other
+					BtU32 iLod = renderBlock.m_lod;
+
+					if( lodFileData.m_nStartRenderBlock[iLod] == lodFileData.m_nEndRenderBlock[iLod] )
+					{
+						lodFileData.m_nStartRenderBlock[iLod] = (BtU32) m_renderBlocks.size();
+					}
+					lodFileData.m_nEndRenderBlock[iLod] = (BtU32) m_renderBlocks.size() + 1;
+
 					renderBlock.m_fileData.m_nStartPrimitiveBlock = (BtU32) m_primitives.size();
 
 					// Flatten the primitives
@@ -1610,8 +1628,10 @@ void ExScene::ExtractToMaterialAndRenderGroups()
 					m_renderBlocks.push_back( renderBlock.m_fileData );
 				}
 
-				pMaterialBlock->m_fileData.m_nEndRenderBlock = (BtU32) m_renderBlocks.size();
+				// Older runtimes only know the material block so it covers the full mesh
+				pMaterialBlock->m_fileData.m_nEndRenderBlock = lodFileData.m_nEndRenderBlock[0];
 				pSceneNode->m_materialBlocks.push_back( pMaterialBlock->m_fileData );
+				pSceneNode->m_materialLods.push_back( lodFileData );
 			}
 		}
 		
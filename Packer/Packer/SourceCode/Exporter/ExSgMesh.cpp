@@ -15,6 +15,17 @@
 #include "PaTopState.h"
 #include "FCollada.h"
 #include "PaRendering.h"
+#include <map>
+#include <set>
+
+// Cells across the longest side of the mesh for each coarser level of detail
+static const BtU32 g_lodCells[MaxMeshLods] = { 0, 32, 16, 8 };
+
+// Smallest projected radius, as a fraction of half the screen height, each level is drawn at
+static const BtFloat g_lodScreenSize[MaxMeshLods] = { 0.25f, 0.1f, 0.04f, 0.0f };
+
+// A level is only kept if it has at most this fraction of the triangles of the level before
+const BtFloat LodReduction = 0.75f;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -23,6 +34,7 @@ ExSgMesh::ExSgMesh( ExSgNode *pNode, ExScene *pScene )
 {
 	m_pNode = pNode;
 	m_pScene = pScene;
+	m_numLods = 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +53,7 @@ ExSgMesh::~ExSgMesh()
 void ExSgMesh::GroupDrawing()
 {
 	MakeRenderGroups();
+	MakeLods();
 	OptimiseGeometry();
 	BoundVertex();
 }
@@ -78,6 +91,170 @@ void ExSgMesh::MakeRenderGroups()
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// LClusterTriangles
+
+// Snaps the full render block's vertices to a grid and keeps the first vertex found in
+// each cell. Triangles that collapse or repeat once their corners are snapped are dropped
+static void LClusterTriangles( const ExRenderBlock& full, ExRenderBlock& lod, const MtVector3& v3Min, BtFloat cellSize )
+{
+	std::map<BtU64, BtU32> cells;
+	std::set<BtU64> triangles;
+
+	lod.m_vertex = full.m_vertex;
+	lod.m_indices.clear();
+
+	BtU32 nIndices = (BtU32) full.m_indices.size();
+
+	for( BtU32 iIndex=0; iIndex + 2<nIndices; iIndex+=3 )
+	{
+		BtU32 corner[3];
+
+		for( BtU32 i=0; i<3; i++ )
+		{
+			BtU32 iVertex = full.m_indices[iIndex + i];
+
+			MtVector3 v3Cell = ( full.m_vertex[iVertex]->Position() - v3Min ) / cellSize;
+
+			BtU64 x = (BtU64) MtMax( v3Cell.x, 0.0f );
+			BtU64 y = (BtU64) MtMax( v3Cell.y, 0.0f );
+			BtU64 z = (BtU64) MtMax( v3Cell.z, 0.0f );
+
+			BtU64 key = ( x << 42 ) | ( y << 21 ) | z;
+
+			std::map<BtU64, BtU32>::iterator cell = cells.find( key );
+
+			if( cell == cells.end() )
+			{
+				cells[key] = iVertex;
+				corner[i] = iVertex;
+			}
+			else
+			{
+				corner[i] = cell->second;
+			}
+		}
+
+		if( ( corner[0] == corner[1] ) || ( corner[1] == corner[2] ) || ( corner[0] == corner[2] ) )
+		{
+			continue;
+		}
+
+		// The same corners in any order are the same triangle
+		BtU64 a = MtMin( corner[0], MtMin( corner[1], corner[2] ) );
+		BtU64 c = MtMax( corner[0], MtMax( corner[1], corner[2] ) );
+		BtU64 b = corner[0] + corner[1] + corner[2] - a - c;
+
+		if( triangles.insert( ( a << 42 ) | ( b << 21 ) | c ).second == false )
+		{
+			continue;
+		}
+
+		lod.m_indices.push_back( corner[0] );
+		lod.m_indices.push_back( corner[1] );
+		lod.m_indices.push_back( corner[2] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeLods
+
+void ExSgMesh::MakeLods()
+{
+	m_numLods = 1;
+
+	// Cache the number of material blocks
+	BtU32 nMaterialBlocks = (BtU32) m_materialBlocks.size();
+
+	// Bound the mesh and count its triangles
+	MtVector3 v3Min( 0, 0, 0 );
+	MtVector3 v3Max( 0, 0, 0 );
+	BtU32 numTriangles = 0;
+	BtBool isBounded = BtFalse;
+
+	for( BtU32 iMaterialBlock=0; iMaterialBlock<nMaterialBlocks; iMaterialBlock++ )
+	{
+		ExMaterialBlock* pMaterialBlock = m_materialBlocks[iMaterialBlock];
+
+		if( pMaterialBlock->m_renderBlocks.size() != 1 )
+		{
+			return;
+		}
+
+		ExRenderBlock& renderBlock = pMaterialBlock->m_renderBlocks[0];
+
+		// Triangles are keyed by their three vertex indices packed into 21 bits each
+		if( renderBlock.m_vertex.size() >= ( 1 << 21 ) )
+		{
+			return;
+		}
+
+		BtU32 nVertices = (BtU32) renderBlock.m_vertex.size();
+
+		for( BtU32 iVertex=0; iVertex<nVertices; iVertex++ )
+		{
+			const MtVector3& v3Position = renderBlock.m_vertex[iVertex]->Position();
+
+			if( isBounded == BtFalse )
+			{
+				v3Min = v3Position;
+				v3Max = v3Position;
+				isBounded = BtTrue;
+			}
+			else
+			{
+				v3Min = v3Position.Min( v3Min );
+				v3Max = v3Position.Max( v3Max );
+			}
+		}
+
+		numTriangles += (BtU32) renderBlock.m_indices.size() / 3;
+	}
+
+	MtVector3 v3Size = v3Max - v3Min;
+	BtFloat size = MtMax( v3Size.x, MtMax( v3Size.y, v3Size.z ) );
+
+	if( size <= 0 )
+	{
+		return;
+	}
+
+	// Each level clusters the full mesh onto a coarser grid
+	for( BtU32 iLod=1; iLod<MaxMeshLods; iLod++ )
+	{
+		std::vector<ExRenderBlock> lodBlocks( nMaterialBlocks );
+
+		BtFloat cellSize = size / g_lodCells[iLod];
+		BtU32 numLodTriangles = 0;
+
+		for( BtU32 iMaterialBlock=0; iMaterialBlock<nMaterialBlocks; iMaterialBlock++ )
+		{
+			ExMaterialBlock* pMaterialBlock = m_materialBlocks[iMaterialBlock];
+
+			LClusterTriangles( pMaterialBlock->m_renderBlocks[0], lodBlocks[iMaterialBlock], v3Min, cellSize );
+			lodBlocks[iMaterialBlock].m_lod = iLod;
+
+			numLodTriangles += (BtU32) lodBlocks[iMaterialBlock].m_indices.size() / 3;
+		}
+
+		// Stop once the grid no longer saves enough to be worth a level
+		if( ( numLodTriangles == 0 ) || ( numLodTriangles > numTriangles * LodReduction ) )
+		{
+			break;
+		}
+
+		for( BtU32 iMaterialBlock=0; iMaterialBlock<nMaterialBlocks; iMaterialBlock++ )
+		{
+			m_materialBlocks[iMaterialBlock]->m_renderBlocks.push_back( lodBlocks[iMaterialBlock] );
+		}
+
+		ErrorLog::Printf( "Level of detail %d of node %s has %d of %d triangles\r\n", iLod, m_pNode->pName(), numLodTriangles, numTriangles );
+
+		numTriangles = numLodTriangles;
+		m_numLods = iLod + 1;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // OptimiseGeometry
 
@@ -343,4 +520,21 @@ void ExSgMesh::CopyAttributes()
 	m_pNode->m_meshFileData.m_AABB = m_AABB;
 	m_pNode->m_meshFileData.m_sphere = m_sphere;
 	m_pNode->m_meshFileData.m_nMaterials = (BtU32) m_pNode->m_materialBlocks.size();
+
+	// The coarsest level is drawn however small the mesh gets
+	BaMeshLodFileData& lodFileData = m_pNode->m_meshLodFileData;
+	lodFileData.m_numLods = m_numLods;
+	lodFileData.m_pad = 0;
+
+	for( BtU32 iLod=0; iLod<MaxMeshLods; iLod++ )
+	{
+		if( iLod + 1 < m_numLods )
+		{
+			lodFileData.m_screenSize[iLod] = g_lodScreenSize[iLod];
+		}
+		else
+		{
+			lodFileData.m_screenSize[iLod] = 0;
+		}
+	}
 }
@@ -42,6 +42,7 @@ private:
 	void							BoundVertex();
 	void							MakeBoneGroups();
 	void							MakeRenderGroups();
+	void							MakeLods();
 
 	MtAABB							m_AABB;
 	MtSphere						m_sphere;
@@ -50,6 +51,7 @@ private:
 	ExSgNode*						m_pNode;
 	ExScene*						m_pScene;
 	std::vector<ExMaterialBlock*>	m_materialBlocks;
+	BtU32							m_numLods;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -474,6 +474,11 @@ void ExSgNode::CopyAttributes()
 		nFileDataSize+=sizeof(BaMaterialsFileData);
 		nFileDataSize+=( (BtU32) m_materialBlocks.size() ) * sizeof( BaMaterialBlockFileData );
 	}
+	if( GetNodeType( ExSgType_Mesh ) )
+	{
+		nFileDataSize+=sizeof(BaMeshLodFileData);
+		nFileDataSize+=( (BtU32) m_materialLods.size() ) * sizeof( BaMaterialLodFileData );
+	}
 
 	// Copy the run time sizes
 	m_fileData.m_nFileDataSize = nFileDataSize;
@@ -608,6 +613,19 @@ void ExSgNode::Export()
 		}
 	}
 
+	// Serialise the levels of detail after the material blocks so they can be skipped
+	if( GetNodeType( ExSgType_Mesh ) )
+	{
+		resource << m_meshLodFileData;
+
+		BtU32 numMaterials = (BtU32) m_materialLods.size();
+
+		for( BtU32 iMaterial=0; iMaterial<numMaterials; iMaterial++ )
+		{
+			resource << m_materialLods[iMaterial];
+		}
+	}
+
 	// Add the resource without a filename so no dependency is made
 
 	if( strstr( m_fileData.m_name, "obj45" ) )
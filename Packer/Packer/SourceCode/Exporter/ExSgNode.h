@@ -121,6 +121,8 @@ struct ExSgNode : public ExResource
 	BaSgLightFileData						m_lightFileData;
 	BaMaterialsFileData						m_materialsFileData;
 	std::vector<BaMaterialBlockFileData>	m_materialBlocks;
+	BaMeshLodFileData						m_meshLodFileData;
+	std::vector<BaMaterialLodFileData>		m_materialLods;
 
 	BtU32									m_lastKey;
 
@@ -8,6 +8,7 @@
 #include "PaTopState.h"
 #include "PaRendering.h"
 #include "FsFile.h"
+#include "BtCRC.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Globals
@@ -19,6 +20,32 @@ ExShader::ExShader()
 {
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SetSourceHash
+
+// The runtime keys its program binary cache on this. It covers the shader text from
+// the first shader to the end of the last, which is where it sits in the resource
+void ExShader::SetSourceHash( BaShaderFileData *pShaderFileData )
+{
+	BtU32 start = 0xFFFFFFFF;
+	BtU32 end = 0;
+
+	for( BtU32 i=0; i<pShaderFileData->m_count; i++ )
+	{
+		const BaShader &shaderData = pShaderFileData->m_shaders[i];
+
+		start = MtMin( start, shaderData.m_offset );
+		end = MtMax( end, shaderData.m_offset + shaderData.m_size );
+	}
+
+	pShaderFileData->m_sourceHash = 0;
+
+	if( end > start )
+	{
+		pShaderFileData->m_sourceHash = BtCRC::GenerateHashCode( (BtU8*)pShaderFileData + start, end - start );
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Export
 
@@ -100,6 +127,7 @@ void ExShader::Export()
 
 			BaShaderFileData *pShaderFileData = (BaShaderFileData*)resource.GetBase();
 			*pShaderFileData = shaderFileData;
+			SetSourceHash( pShaderFileData );
 
 			AddResource(resource, GetFilename(), GetTitle(), BaRT_Shader);
 		}
@@ -173,6 +201,7 @@ void ExShader::Export()
 
 			BaShaderFileData *pShaderFileData = (BaShaderFileData*)resource.GetBase();
 			*pShaderFileData = shaderFileData;
+			SetSourceHash( pShaderFileData );
 
 			AddResource( resource, GetFilename(), GetTitle(), BaRT_Shader );
 		}
@@ -6,6 +6,8 @@
 
 #include "ExResource.h"
 
+struct BaShaderFileData;
+
 class ExShader : public ExResource
 {
 public:
@@ -16,6 +18,7 @@ public:
 
 private:
 
+	void SetSourceHash( BaShaderFileData *pShaderFileData );
 };
 
 #endif // __ExShader_h__
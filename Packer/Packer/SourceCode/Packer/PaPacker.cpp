@@ -14,6 +14,7 @@
 #include "ExExporter.h"
 #include "BaArchive.h"
 #include "BaFileData.h"
+#include "BtCompressedFile.h"
 #include "ErrorLog.h"
 #include "PaPacker.h"
 #include "PaResource.h"
@@ -32,7 +33,7 @@ BaResourceType gDirty[] = { BaRT_Max };
 //BaResourceType gDirty[] = { BaRT_Sound };
 //BaResourceType gDirty[] = { BaRT_Material };
 
-const BtU32 PACKER_VERSION = 100;
+const BtU32 PACKER_VERSION = 102;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Declarations
@@ -769,6 +770,12 @@ void PaPacker::Pack()
 
 			// Deflate each archive using zlib
 			DeflateArchive();
+
+			// Write the uncompressed variant that can be mapped in place
+			if( IsMappedPlatform() == BtTrue )
+			{
+				WriteMappedArchive();
+			}
 		}
 	}
 
@@ -791,22 +798,33 @@ void PaPacker::Pack()
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SetArchiveHeader
+
+void PaPacker::SetArchiveHeader( BaArchiveHeader& archiveHeader )
+{
+	BtMemory::Set( &archiveHeader, 0, sizeof(BaArchiveHeader) );
+	archiveHeader.m_nNumResources = m_pArchive->GetNumResources();
+	archiveHeader.m_nDataSize = m_pArchive->m_archiveSize;
+	BtStrCopy( archiveHeader.m_szTitle, m_pArchive->m_archiveHeader.m_szTitle );
+	archiveHeader.m_nPackerVersion = PACKER_VERSION;
+	archiveHeader.m_nHeaderCheckSum = BtCRC::GenerateHashCode((BtU8*)&archiveHeader, sizeof(BaArchiveHeader) - sizeof(BtU32));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // DeflateArchive
 
 void PaPacker::DeflateArchive()
 {
-    BtS32 ret, flush;
-    BtU32 have;
-    z_stream strm;
-	const BtS32 CHUNK = 256 * 1024;
-    BtU8 in[CHUNK];
-    BtU8 out[CHUNK];
-
-	// Open the source file
+	// Read the whole uncompressed archive
 	FILE* hSource;
 	
 	hSource = fopen( m_pArchive->m_szArchiveFilename, "rb" );
+
+	if( hSource == BtNull )
+	{
+		ErrorLog::Fatal_Printf( "Cannot open %s\n", m_pArchive->m_szArchiveFilename );
+	}
 	
 	fseek(hSource, 0, SEEK_END);
 	BtU32 archiveSize = ftell(hSource);
@@ -814,6 +832,14 @@ void PaPacker::DeflateArchive()
 
 	ErrorLog::Printf("Compressing %s from %d\n", m_pArchive->m_szArchiveFilename, archiveSize);
 
+	BtU8* pSource = BtMemory::Allocate( archiveSize );
+
+	if( fread( pSource, 1, archiveSize, hSource ) != archiveSize )
+	{
+		ErrorLog::Fatal_Printf( "ferror\n" );
+	}
+	fclose( hSource );
+
 	// Open the destination file
 	FILE* destStream;
 	
@@ -821,66 +847,103 @@ void PaPacker::DeflateArchive()
 
 	// Setup the archive header
 	BaArchiveHeader archiveHeader;
-	archiveHeader.m_nNumResources = m_pArchive->GetNumResources();
-	archiveHeader.m_nDataSize = m_pArchive->m_archiveSize;
-	BtStrCopy( archiveHeader.m_szTitle, m_pArchive->m_archiveHeader.m_szTitle );
-	archiveHeader.m_nPackerVersion = PACKER_VERSION;
-	archiveHeader.m_nHeaderCheckSum = BtCRC::GenerateHashCode((BtU8*)&archiveHeader, sizeof(BaArchiveHeader) - sizeof(BtU32));
+	SetArchiveHeader( archiveHeader );
 	fwrite( (void*)&archiveHeader, 1, sizeof(BaArchiveHeader), destStream );
 
-    // Allocate deflate state
-    strm.zalloc = Z_NULL;
-    strm.zfree  = Z_NULL;
-    strm.opaque = Z_NULL;
-    ret = deflateInit( &strm, 1 );
+	// Write the chunk table followed by the chunks, each deflated to its own zlib stream
+	BtU32 compressedSize = BtCompressedFile::WriteChunks( destStream, pSource, archiveSize );
+	BtU32 numChunks = ( archiveSize + BaArchiveChunkSize - 1 ) / BaArchiveChunkSize;
+
+	BtMemory::Free( pSource );
+
+	ErrorLog::Printf( "Compressed to %d bytes in %d chunks\n", compressedSize, numChunks );
+
+	fclose( destStream );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IsMappedPlatform
 
-    if( ret != Z_OK )
+BtBool PaPacker::IsMappedPlatform()
+{
+	// Only the posix runtimes map archives in place. Windows always inflates them. There is
+	// no Linux runtime or packer platform, so a Linux build packs for OSX to get the mapping
+	switch( PaTopState::Instance().GetPlatform() )
 	{
-		ErrorLog::Fatal_Printf( "deflateInit %d\n", ret );
+	case PackerPlatform_GLES:
+	case PackerPlatform_OSX:
+		return BtTrue;
+	default:
+		return BtFalse;
 	}
+}
 
-    /* compress until end of file */
-    do {
-        strm.avail_in = (BtU32) fread( in, 1, CHUNK, hSource );
-        
-		if( ferror( hSource ) )
-		{
-            (void)deflateEnd(&strm);
-
-			ErrorLog::Fatal_Printf( "ferror\n" );
-        }
-
-        flush = feof( hSource ) ? Z_FINISH : Z_NO_FLUSH;
-        strm.next_in = in;
-
-        /* run deflate() on input until output buffer not full, finish
-           compression if all of source has been read in */
-        do {
-            strm.avail_out = CHUNK;
-            strm.next_out = out;
-            ret = deflate(&strm, flush);    /* no bad return value */
-            assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-            have = CHUNK - strm.avail_out;
-            
-			if (fwrite(out, 1, have, destStream ) != have || ferror(destStream) )
-			{
-                (void)deflateEnd(&strm);
-			
-				ErrorLog::Fatal_Printf( "ferror\n" );
-            }
-        } while (strm.avail_out == 0);
-        assert(strm.avail_in == 0);     /* all input will be used */
+////////////////////////////////////////////////////////////////////////////////
+// WriteMappedArchive
 
-        /* done when last data in file processed */
-    } while (flush != Z_FINISH);
+void PaPacker::WriteMappedArchive()
+{
+	// The mapped archive swaps the trailing z of the packed extension for an m
+	BtChar mappedFilename[MaxFilePath];
+	BtStrCopy( mappedFilename, MaxFilePath, m_pArchive->m_szPackedFilename );
+
+	BtU32 length = BtStrLength( mappedFilename );
+	BtAssert( ( length > 0 ) && ( mappedFilename[length - 1] == 'z' ) );
+	mappedFilename[length - 1] = 'm';
 
-    BtAssert(ret == Z_STREAM_END);        /* stream will be complete */
+	// Find the size of the compressed archive so the runtime can tell if the mapping is stale
+	FILE* hPacked = fopen( m_pArchive->m_szPackedFilename, "rb" );
 
-    /* clean up and return */
-    (void)deflateEnd(&strm);
+	if( hPacked == BtNull )
+	{
+		ErrorLog::Fatal_Printf( "Cannot open %s\n", m_pArchive->m_szPackedFilename );
+	}
+	fseek( hPacked, 0, SEEK_END );
+	BtU32 packedSize = (BtU32)ftell( hPacked );
+	fclose( hPacked );
 
+	// Read the uncompressed archive
+	FILE* hSource = fopen( m_pArchive->m_szArchiveFilename, "rb" );
+
+	if( hSource == BtNull )
+	{
+		ErrorLog::Fatal_Printf( "Cannot open %s\n", m_pArchive->m_szArchiveFilename );
+	}
+
+	BtU32 archiveSize = m_pArchive->m_archiveSize;
+	BtU8* pArchive = BtMemory::Allocate( archiveSize );
+	BtMemory::Set( pArchive, 0, archiveSize );
+	fread( pArchive, 1, archiveSize, hSource );
 	fclose( hSource );
+
+	FILE* destStream = fopen( mappedFilename, "wb" );
+
+	if( destStream == BtNull )
+	{
+		ErrorLog::Fatal_Printf( "Cannot open %s\n", mappedFilename );
+	}
+
+	// Write the header padded to a page so the archive is page aligned when mapped
+	BtU8 page[BaMappedArchiveAlignment];
+	BtMemory::Set( page, 0, BaMappedArchiveAlignment );
+	SetArchiveHeader( *(BaArchiveHeader*)page );
+
+	BaMappedArchiveHeader* pMappedHeader = (BaMappedArchiveHeader*)( page + sizeof(BaArchiveHeader) );
+	pMappedHeader->m_magic = BaMappedArchiveMagic;
+	pMappedHeader->m_nVersion = BaMappedArchiveVersion;
+	pMappedHeader->m_nSourceSize = packedSize;
+	fwrite( page, 1, BaMappedArchiveAlignment, destStream );
+
+	// Write the archive as is
+	if( fwrite( pArchive, 1, archiveSize, destStream ) != archiveSize )
+	{
+		ErrorLog::Fatal_Printf( "ferror\n" );
+	}
+
+	ErrorLog::Printf( "Writing mapped archive %s %d\n", mappedFilename, archiveSize );
+
 	fclose( destStream );
+	BtMemory::Free( pArchive );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
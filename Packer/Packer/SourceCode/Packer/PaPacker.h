@@ -55,7 +55,10 @@ private:
 	void							SetDataOffsets();
     void							LoadResourceHeaders();
 	void							PackResources();
+	void							SetArchiveHeader( BaArchiveHeader& archiveHeader );
 	void							DeflateArchive();
+	BtBool							IsMappedPlatform();
+	void							WriteMappedArchive();
 	void							WriteArchiveBuildTimes();
 	void							WriteAssetBuildTimes();
 	void							WriteResourceList();
@@ -3,6 +3,11 @@
 
 // Includes
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+#include <windows.h>
+#endif
 #include "ApConfig.h"
 #include "RsUtil.h"
 #include "RsShader.h"
@@ -58,6 +63,13 @@ void ScMain::Init()
     ApConfig::SetResourcePath( "..\\RigidBody\\release\\" );
     ApConfig::CheckResourcePath( "game" );
     RsUtil::SetDimension(MtVector2(800.0f, 600.0f));
+
+	// -stress N adds N boxes to measure render submission
+	const BtChar* stress = strstr( GetCommandLineA(), "-stress" );
+	if( stress != BtNull )
+	{
+		m_model.SetNumStressCubes( atoi( stress + strlen( "-stress" ) ) );
+	}
 #endif
 }
 
@@ -30,6 +30,22 @@
 #include "DyImpl.h"
 #include "UiKeyboard.h"
 
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+ScModel::ScModel()
+{
+	m_numStressCubes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetNumStressCubes
+
+void ScModel::SetNumStressCubes( BtU32 numCubes )
+{
+	m_numStressCubes = MtMin( numCubes, MaxStressCubes );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Setup
 
@@ -44,6 +60,12 @@ void ScModel::Setup( BaArchive *pGameArchive )
 	HlModel::SetSortOrders(m_pLargeCube, ModelSortOrder);
 	HlModel::SetSortOrders(m_pSmallCube, ModelSortOrder);
 
+	for( BtU32 i=0; i<m_numStressCubes; i++ )
+	{
+		m_pStressCubes[i] = m_pLargeCube->GetDuplicate();
+		HlModel::SetSortOrders( m_pStressCubes[i], ModelSortOrder );
+	}
+
 	// Cache the main shader
 	m_pShader = pGameArchive->GetShader( "shader" );
 
@@ -83,6 +105,29 @@ void ScModel::Update( RsCamera &camera )
 		m_pSmallCube->Update();
 	}
 
+	if( m_numStressCubes > 0 )
+	{
+		// A square wall far enough in front of the camera to fill its view
+		BtU32 side = (BtU32)MtCeil( MtSqrt( (BtFloat)m_numStressCubes ) );
+		BtFloat spacing = 1.5f;
+		BtFloat halfWidth = side * spacing * 0.5f;
+		BtFloat distance = ( halfWidth * 2.0f ) + 10.0f;
+
+		m_time += BtTime::GetTick();
+
+		for( BtU32 i=0; i<m_numStressCubes; i++ )
+		{
+			MtMatrix4 m4Rotate;
+			m4Rotate.SetRotationY( m_time + ( i * 0.1f ) );
+			MtMatrix4 m4Translate;
+			m4Translate.SetTranslation( MtVector3( ( ( i % side ) * spacing ) - halfWidth,
+												   ( ( i / side ) * spacing ) - halfWidth,
+												   distance ) );
+			m_pStressCubes[i]->SetLocalTransform( m4Rotate * m4Translate );
+			m_pStressCubes[i]->Update();
+		}
+	}
+
 	if (UiKeyboard::pInstance()->IsPressed(UiKeyCode_R))
 	{
 		Reset();
@@ -91,6 +136,20 @@ void ScModel::Update( RsCamera &camera )
 	DyImpl::Update();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RenderStressCubes
+
+//static
+void ScModel::RenderStressCubes( void* pContext, BtU32 iStart, BtU32 iEnd )
+{
+	ScModel *pModel = (ScModel*)pContext;
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		pModel->m_pStressCubes[i]->Render();
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Render
 
@@ -116,6 +175,9 @@ void ScModel::Render( RsCamera &camera )
 	{
 		m_pSmallCube->Render();
 	}
+
+	// Spread the culling and renderable setup over the job system
+	RsUtil::RenderParallel( m_numStressCubes, 64, RenderStressCubes, this );
     //MtVector2 v2Position( 0, 0 );
     //MtVector3 v3Position = camera.GetRotation().Col2();
     //BtChar text[32];
@@ -13,11 +13,17 @@ class RsModel;
 class BaArchive;
 class SgAnimator;
 
+// Most extra boxes the stress test can add
+const BtU32 MaxStressCubes = 4096;
+
 // Class definition
 class ScModel
 {
 public:
 
+	// Constructor
+									ScModel();
+
 	// Public functions
 	void							Init();
 	void							Setup( BaArchive *pArchive );
@@ -25,15 +31,22 @@ public:
 	void							Update( RsCamera &camera );
 	void							Render( RsCamera &camera );
 
+	// Adds a wall of spinning boxes for measuring render submission, e.g. with
+	// -stress 2000 -nullrender -frames 300. Call before Setup
+	void							SetNumStressCubes( BtU32 numCubes );
+
 	// Accessors
 
 private:
 
 	// Private functions
+	static void						RenderStressCubes( void* pContext, BtU32 iStart, BtU32 iEnd );
 	
 	// Private members
 	SgNode						   *m_pLargeCube;
 	SgNode						   *m_pSmallCube;
+	SgNode						   *m_pStressCubes[MaxStressCubes];
+	BtU32							m_numStressCubes;
 
 	DyBody							m_largeBody;
 	DyBody							m_smallBody;
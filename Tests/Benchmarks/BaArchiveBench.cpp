@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveBench.cpp
+
+// Times resource lookups in archives of headers alone, so only the index is measured.
+// The linear search the index replaced is timed over the same titles for comparison.
+// Then loading the 3D scene demo's game data, packed file by file into an archive, by
+// inflating it into allocated memory against mapping its uncompressed variant, and how
+// much of each is resident once loaded
+
+#include <stdio.h>
+#include <vector>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+#include "ApConfig.h"
+#include "BaArchive.h"
+#include "BtString.h"
+#include "MtMath.h"
+#include "TsArchive.h"
+#include "TsTest.h"
+
+const BtU32 NumLookups = 200000;
+const BtU32 NumLoads = 20;
+
+// Stops the optimiser dropping lookups whose results aren't used
+static volatile BtU32 g_numFound = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LLinearSearch
+
+// What GetResource did before the index: compare every title until one matches
+static BtU32 LLinearSearch( const std::vector<BtChar*> &titles, const std::vector<BaResourceType> &types,
+							BaResourceType type, const BtChar *pTitle )
+{
+	for( BtU32 i=0; i<titles.size(); i++ )
+	{
+		if( ( types[i] == type ) && ( BtStrCompareNoCase( titles[i], pTitle ) == BtTrue ) )
+		{
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBenchmark
+
+static void LBenchmark( BtU32 numResources )
+{
+	std::vector<BtChar*> titles( numResources );
+	std::vector<BtChar*> upperTitles( numResources );
+	std::vector<BaResourceType> types( numResources );
+
+	for( BtU32 i=0; i<numResources; i++ )
+	{
+		titles[i] = new BtChar[LMaxResourceName];
+		upperTitles[i] = new BtChar[LMaxResourceName];
+
+		// Long shared prefixes, as exported node and material names tend to have
+		sprintf( titles[i], "Level01_Props_Crate%d", i );
+		BtStrCopy( upperTitles[i], LMaxResourceName, titles[i] );
+		BtStrUpper( upperTitles[i], LMaxResourceName );
+
+		types[i] = (BaResourceType)( BaRT_Texture + ( i % 4 ) );
+	}
+
+	TsArchive::Write( "bench.z", (const BtChar**)&titles[0], &types[0], numResources );
+
+	BaArchive archive;
+	archive.Load( "bench" );
+
+	printf( "%d resources\n", numResources );
+
+	TsTimer timer;
+	BtU32 numFound = 0;
+
+	timer.Start();
+	for( BtU32 i=0; i<NumLookups; i++ )
+	{
+		BtU32 index = ( i * 7919 ) % numResources;
+		numFound += archive.GetResource( types[index], titles[index] ) != BtNull;
+	}
+	timer.Stop( "  GetResource by title", NumLookups );
+
+	timer.Start();
+	for( BtU32 i=0; i<NumLookups; i++ )
+	{
+		BtU32 index = ( i * 7919 ) % numResources;
+		numFound += archive.GetResource( types[index], upperTitles[index] ) != BtNull;
+	}
+	timer.Stop( "  GetResource by title in another case", NumLookups );
+
+	timer.Start();
+	for( BtU32 i=0; i<NumLookups; i++ )
+	{
+		BtU32 index = ( i * 7919 ) % numResources;
+		numFound += archive.GetResource( types[( index + 1 ) % numResources], titles[index] ) != BtNull;
+	}
+	timer.Stop( "  GetResource missing", NumLookups );
+
+	timer.Start();
+	for( BtU32 i=0; i<NumLookups; i++ )
+	{
+		numFound += archive.GetResource( ( ( i * 7919 ) % numResources ) + 1 ) != BtNull;
+	}
+	timer.Stop( "  GetResource by ID", NumLookups );
+
+	// The linear search is slow enough at the larger sizes to need fewer lookups
+	BtU32 numLinear = MtMax( NumLookups / numResources, (BtU32)100 );
+
+	timer.Start();
+	for( BtU32 i=0; i<numLinear; i++ )
+	{
+		BtU32 index = ( i * 7919 ) % numResources;
+		numFound += LLinearSearch( titles, types, types[index], titles[index] ) != 0;
+	}
+	timer.Stop( "  Linear search by title", numLinear );
+
+	g_numFound += numFound;
+
+	archive.Unload();
+	remove( "bench.z" );
+
+	for( BtU32 i=0; i<numResources; i++ )
+	{
+		delete [] titles[i];
+		delete [] upperTitles[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LResidentBytes
+
+static BtU64 LResidentBytes()
+{
+#ifdef __APPLE__
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if( task_info( mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count ) != KERN_SUCCESS )
+	{
+		return 0;
+	}
+	return info.resident_size;
+#else
+	long size = 0;
+	long resident = 0;
+	FILE *f = fopen( "/proc/self/statm", "r" );
+
+	if( f != BtNull )
+	{
+		if( fscanf( f, "%ld %ld", &size, &resident ) != 2 )
+		{
+			resident = 0;
+		}
+		fclose( f );
+	}
+	return (BtU64)resident * sysconf( _SC_PAGESIZE );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBenchLoad
+
+// Load and Unload of load.z, then how much more is resident while it is loaded. Only the
+// pages a load writes to are resident in a mapping until resources read their data
+static void LBenchLoad( const BtChar *pName )
+{
+	BtChar name[64];
+	TsTimer timer;
+	BaArchive archive;
+
+	timer.Start();
+	for( BtU32 i=0; i<NumLoads; i++ )
+	{
+		archive.Load( "load" );
+		archive.Unload();
+	}
+	sprintf( name, "%s: Load and Unload", pName );
+	timer.Stop( name, NumLoads );
+
+	BtU64 residentBefore = LResidentBytes();
+	archive.Load( "load" );
+	BtU64 residentLoaded = LResidentBytes();
+
+	archive.Unload();
+
+	printf( "%-48s %12.1f MB\n", "  resident once loaded", ( residentLoaded - residentBefore ) / ( 1024.0 * 1024.0 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	LBenchmark( 100 );
+	LBenchmark( 1000 );
+	LBenchmark( 10000 );
+
+	// The resources load as plain BaResources, so what is timed is reading the file, inflating
+	// or mapping it and fixing up the resource headers
+	if( TsArchive::WriteDirectory( "load.z", TsDemoArchive ) == BtFalse )
+	{
+		printf( "Can't find %s\n", TsDemoArchive );
+		return 1;
+	}
+
+	printf( "%s\n", TsDemoArchive );
+	LBenchLoad( "  inflated" );
+
+	TsArchive::WriteDirectory( "load.z", TsDemoArchive, BtTrue );
+	LBenchLoad( "  mapped" );
+
+	remove( "load.z" );
+	remove( "load.m" );
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveLoaderBench.cpp
+
+// Frames of a fixed amount of game work while a 64MB archive loads, reporting the mean
+// and worst frame. The archive is loaded in one frame with BaArchive::Load, then in the
+// background with BaArchiveLoader at a few resources per update. Frames with no load
+// come first for comparison
+
+#include <stdio.h>
+#include <vector>
+#include "ApConfig.h"
+#include "BaArchive.h"
+#include "BaArchiveLoader.h"
+#include "BtThread.h"
+#include "MtMath.h"
+#include "TsArchive.h"
+#include "TsTest.h"
+
+const BtU32 NumResources = 1024;
+const BtU32 ResourceSize = 64 * 1024;
+const BtU32 NumFrames = 120;
+const BtU32 LoadFrame = 10;
+
+// About the work a game does in a 60Hz frame, leaving the rest for the load
+const BtU64 FrameWork = 4 * 1000 * 1000;
+
+enum LLoad
+{
+	LLoad_None,
+	LLoad_Blocking,
+	LLoad_Background,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LGameWork
+
+static void LGameWork()
+{
+	BtU64 start = BtTime::GetElapsedTimeInNanoseconds();
+
+	while( BtTime::GetElapsedTimeInNanoseconds() - start < FrameWork )
+	{
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+// Runs NumFrames frames, and more if the background load hasn't finished by then
+static void LRunFrames( const BtChar *pName, LLoad load, BtU32 resourcesPerUpdate )
+{
+	BaArchive archive;
+	BaLoadHandle handle = 0;
+
+	BaArchiveLoader::SetResourcesPerUpdate( resourcesPerUpdate );
+
+	BtU64 worst = 0;
+	BtU64 total = 0;
+	BtU32 numFrames = 0;
+	BtU32 loadedFrame = 0;
+
+	for( BtU32 iFrame=0; ( iFrame < NumFrames ) || ( BaArchiveLoader::GetNumPending() > 0 ); iFrame++ )
+	{
+		BtU64 start = BtTime::GetElapsedTimeInNanoseconds();
+
+		if( iFrame == LoadFrame )
+		{
+			if( load == LLoad_Blocking )
+			{
+				archive.Load( "frames" );
+				loadedFrame = iFrame;
+			}
+			else if( load == LLoad_Background )
+			{
+				handle = BaArchiveLoader::Load( &archive, "frames" );
+			}
+		}
+
+		LGameWork();
+		BaArchiveLoader::Update();
+
+		if( ( handle != 0 ) && ( loadedFrame == 0 ) && ( BaArchiveLoader::IsComplete( handle ) == BtTrue ) )
+		{
+			loadedFrame = iFrame;
+		}
+
+		BtU64 frameTime = BtTime::GetElapsedTimeInNanoseconds() - start;
+		worst = MtMax( worst, frameTime );
+		total += frameTime;
+		++numFrames;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%s: mean frame", pName );
+	printf( "%-48s %12.1f ns\n", name, (BtDouble)total / numFrames );
+	sprintf( name, "%s: worst frame", pName );
+	printf( "%-48s %12.1f ns\n", name, (BtDouble)worst );
+
+	if( load != LLoad_None )
+	{
+		printf( "%-48s %12d frames\n", "  loaded after", loadedFrame - LoadFrame );
+	}
+
+	archive.Unload();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	std::vector<BtChar*> titles( NumResources );
+	std::vector<BaResourceType> types( NumResources, BaRT_UserData );
+
+	for( BtU32 i=0; i<NumResources; i++ )
+	{
+		titles[i] = new BtChar[LMaxResourceName];
+		sprintf( titles[i], "resource%d", i );
+	}
+
+	TsArchive::Write( "frames.z", (const BtChar**)&titles[0], &types[0], NumResources, ResourceSize );
+
+	printf( "%d processors, %d resources of %dK, %.1f ms of work a frame\n",
+			BtThread::GetNumProcessors(), NumResources, ResourceSize / 1024, FrameWork / 1e6 );
+
+	LRunFrames( "No load", LLoad_None, 32 );
+	LRunFrames( "Load in a frame", LLoad_Blocking, 32 );
+
+	BaArchiveLoader::CreateManager();
+
+	LRunFrames( "BaArchiveLoader, 32 per update", LLoad_Background, 32 );
+	LRunFrames( "BaArchiveLoader, 256 per update", LLoad_Background, 256 );
+
+	BaArchiveLoader::DestroyManager();
+
+	remove( "frames.z" );
+
+	for( BtU32 i=0; i<NumResources; i++ )
+	{
+		delete [] titles[i];
+	}
+	return 0;
+}
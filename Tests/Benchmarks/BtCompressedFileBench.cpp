@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtCompressedFileBench.cpp
+
+// Inflating a 32MB archive as the single zlib stream archives used to be, and as chunks
+// across one, two, four and more job workers the way BaArchive::LoadFile inflates them.
+// Then what one resource costs to inflate on its own against the whole archive
+
+#include <stdio.h>
+#include <vector>
+#include "zlib.h"
+#include "BtCompressedFile.h"
+#include "BtJobSystem.h"
+#include "BtMemory.h"
+#include "BtThread.h"
+#include "MtMath.h"
+#include "TsTest.h"
+
+const BtU32 ArchiveSize = 32 * 1024 * 1024;
+const BtU32 NumLoads = 4;
+const BtU32 NumResourceLoads = 200;
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeData
+
+// Runs and repeats with noise through them, so it deflates about as well as mesh data
+static void LMakeData( std::vector<BtU8> &data )
+{
+	data.resize( ArchiveSize );
+	BtU32 seed = 12345;
+
+	for( BtU32 i=0; i<ArchiveSize; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = ( ( seed >> 16 ) & 3 ) ? (BtU8)( i >> 5 ) : (BtU8)( seed >> 24 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LInflateChunks
+
+struct LInflateContext
+{
+	const BtCompressedFile			   *m_pCompressedFile;
+	BtU8							   *m_pMemory;
+};
+
+static void LInflateChunks( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LInflateContext *pInflate = (LInflateContext*)pContext;
+
+	pInflate->m_pCompressedFile->InflateChunks( pInflate->m_pMemory, iStart, iEnd );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LPrintRate
+
+static void LPrintRate( BtDouble nanosecondsPerLoad )
+{
+	BtDouble megabytes = (BtDouble)ArchiveSize / ( 1024.0 * 1024.0 );
+	printf( "%-48s %12.1f MB/s\n", "  inflated", megabytes / ( nanosecondsPerLoad / 1e9 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBenchSingleStream
+
+static BtDouble LBenchSingleStream( const std::vector<BtU8> &data, std::vector<BtU8> &memory )
+{
+	uLongf compressedSize = compressBound( ArchiveSize );
+	std::vector<BtU8> compressed( compressedSize );
+	compress2( &compressed[0], &compressedSize, &data[0], ArchiveSize, 1 );
+
+	FILE *f = fopen( "stream.z", "wb" );
+	fwrite( &compressed[0], 1, compressedSize, f );
+	fclose( f );
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<NumLoads; i++ )
+	{
+		f = fopen( "stream.z", "rb" );
+		BtCompressedFile compressedFile;
+		compressedFile.Read( f, &memory[0], ArchiveSize );
+		fclose( f );
+	}
+	BtDouble perLoad = timer.Stop( "Single stream: read and inflate per load", NumLoads );
+	LPrintRate( perLoad );
+
+	return perLoad;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	std::vector<BtU8> data;
+	LMakeData( data );
+	std::vector<BtU8> memory( ArchiveSize );
+
+	BtDouble singleStream = LBenchSingleStream( data, memory );
+
+	FILE *f = fopen( "chunks.z", "wb" );
+	BtU32 compressedSize = BtCompressedFile::WriteChunks( f, &data[0], ArchiveSize );
+	fclose( f );
+
+	printf( "%d processors, %d bytes in %d chunks\n", BtThread::GetNumProcessors(), compressedSize, ArchiveSize / BaArchiveChunkSize );
+
+	// The chunks are read once and inflated from memory each time, so only the inflate is timed
+	BtCompressedFile compressedFile;
+	f = fopen( "chunks.z", "rb" );
+	compressedFile.ReadChunkTable( f, ArchiveSize );
+	compressedFile.ReadChunks( f );
+	fclose( f );
+
+	LInflateContext context;
+	context.m_pCompressedFile = &compressedFile;
+	context.m_pMemory = &memory[0];
+
+	BtU32 maxWorkers = MtMax( MtMin( BtThread::GetNumProcessors(), MaxJobWorkers ), (BtU32)4 );
+
+	for( BtU32 numWorkers=1; numWorkers<=maxWorkers; numWorkers*=2 )
+	{
+		BtJobSystem::CreateManager( numWorkers );
+
+		// Warm the workers and the memory up first
+		BtJobSystem::ParallelFor( compressedFile.GetNumChunks(), 1, LInflateChunks, &context );
+
+		BtChar name[64];
+		sprintf( name, "%d workers: inflate chunks per load", numWorkers );
+
+		TsTimer timer;
+		timer.Start();
+
+		for( BtU32 i=0; i<NumLoads; i++ )
+		{
+			BtJobSystem::ParallelFor( compressedFile.GetNumChunks(), 1, LInflateChunks, &context );
+		}
+		BtDouble perLoad = timer.Stop( name, NumLoads );
+		LPrintRate( perLoad );
+		printf( "%-48s %12.2fx\n", "  against the single stream", singleStream / perLoad );
+
+		BtJobSystem::DestroyManager();
+	}
+
+	// A 64K resource in the middle of the archive needs only its own chunk
+	BaResourceHeader resourceHeader;
+	BtMemory::Set( &resourceHeader, 0, sizeof(BaResourceHeader) );
+	resourceHeader.m_nResourceOffset = ArchiveSize / 2 + 1000;
+	resourceHeader.m_nResourceSize = 64 * 1024;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<NumResourceLoads; i++ )
+	{
+		compressedFile.InflateResource( &memory[0], resourceHeader );
+	}
+	timer.Stop( "One 64K resource: inflate its chunk", NumResourceLoads );
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtJobSystemBench.cpp
+
+// How a ParallelFor of even work scales with the number of workers, and what the job
+// system costs per job when the work is tiny
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "BtJobSystem.h"
+#include "BtThread.h"
+#include "MtMath.h"
+#include "TsTest.h"
+
+const BtU32 NumItems = 1 << 20;
+const BtU32 NumTinyJobs = 100000;
+
+////////////////////////////////////////////////////////////////////////////////
+// LWork
+
+// A few hundred cycles of arithmetic per item
+static void LWork( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	BtFloat *pOut = (BtFloat*)pContext;
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		BtFloat x = (BtFloat)i;
+
+		for( BtU32 k=0; k<64; k++ )
+		{
+			x = sqrtf( x * 1.0001f + 1.0f );
+		}
+		pOut[i] = x;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNothing
+
+static void LNothing( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	(void)pContext;
+	(void)iStart;
+	(void)iEnd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	std::vector<BtFloat> out( NumItems );
+	BtU32 maxWorkers = MtMin( BtThread::GetNumProcessors(), MaxJobWorkers );
+	BtDouble oneWorker = 0;
+
+	printf( "%d processors\n", BtThread::GetNumProcessors() );
+
+	for( BtU32 numWorkers=1; numWorkers<=maxWorkers; numWorkers*=2 )
+	{
+		BtJobSystem::CreateManager( numWorkers );
+
+		BtChar name[64];
+		TsTimer timer;
+
+		// Warm the workers and the output up first
+		BtJobSystem::ParallelFor( NumItems, 0, LWork, &out[0] );
+
+		sprintf( name, "%d workers: ParallelFor per item", numWorkers );
+		timer.Start();
+		for( BtU32 i=0; i<4; i++ )
+		{
+			BtJobSystem::ParallelFor( NumItems, 0, LWork, &out[0] );
+		}
+		BtDouble perItem = timer.Stop( name, NumItems * 4 );
+
+		if( numWorkers == 1 )
+		{
+			oneWorker = perItem;
+		}
+		printf( "%-48s %12.2fx\n", "  speed up", oneWorker / perItem );
+
+		sprintf( name, "%d workers: ParallelFor per empty job", numWorkers );
+		timer.Start();
+		BtJobSystem::ParallelFor( NumTinyJobs, 1, LNothing, BtNull );
+		timer.Stop( name, NumTinyJobs );
+
+		sprintf( name, "%d workers: Run and Wait per empty job", numWorkers );
+		BtJobCounter counter;
+		timer.Start();
+		for( BtU32 i=0; i<NumTinyJobs; i++ )
+		{
+			BtJobSystem::Run( LNothing, BtNull, i, i + 1, &counter );
+		}
+		BtJobSystem::Wait( &counter );
+		timer.Stop( name, NumTinyJobs );
+
+		BtJobSystem::DestroyManager();
+	}
+	return 0;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtMemoryBench.cpp
+
+// What an allocation and free costs through BtMemory against malloc and free, for sizes
+// the pools serve and sizes they don't, freed straight away or after a thousand more, and
+// with every job worker allocating at once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "BtJobSystem.h"
+#include "BtMemory.h"
+#include "TsTest.h"
+
+const BtU32 NumPairs = 1000000;
+const BtU32 BatchSize = 1000;
+const BtU32 NumBatches = 500;
+const BtU32 JobGrainSize = 10000;
+
+static void *g_batch[BatchSize];
+
+////////////////////////////////////////////////////////////////////////////////
+// LAllocate
+
+static void *LAllocate( BtU32 size, BtBool isBtMemory )
+{
+	return ( isBtMemory == BtTrue ) ? (void*)BtMemory::Allocate( BtMT_General, size ) : malloc( size );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LFree
+
+static void LFree( void *pMemory, BtBool isBtMemory )
+{
+	if( isBtMemory == BtTrue )
+	{
+		BtMemory::Free( pMemory );
+	}
+	else
+	{
+		free( pMemory );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBench
+
+static void LBench( BtU32 size, BtBool isBtMemory )
+{
+	const BtChar *pName = ( isBtMemory == BtTrue ) ? "BtMemory" : "malloc";
+	BtChar name[64];
+	TsTimer timer;
+
+	// Each allocation freed before the next
+	timer.Start();
+	for( BtU32 i=0; i<NumPairs; i++ )
+	{
+		void *pMemory = LAllocate( size, isBtMemory );
+		*(volatile BtU8*)pMemory = 0;
+		LFree( pMemory, isBtMemory );
+	}
+	sprintf( name, "%s %d bytes, allocate and free", pName, size );
+	timer.Stop( name, NumPairs );
+
+	// A thousand live at once, freed in the order they came
+	timer.Start();
+	for( BtU32 iBatch=0; iBatch<NumBatches; iBatch++ )
+	{
+		for( BtU32 i=0; i<BatchSize; i++ )
+		{
+			g_batch[i] = LAllocate( size, isBtMemory );
+			*(volatile BtU8*)g_batch[i] = 0;
+		}
+		for( BtU32 i=0; i<BatchSize; i++ )
+		{
+			LFree( g_batch[i], isBtMemory );
+		}
+	}
+	sprintf( name, "%s %d bytes, %d live", pName, size, BatchSize );
+	timer.Stop( name, NumBatches * BatchSize );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LPairsJob
+
+// The context is the size, with the top bit set for BtMemory
+static void LPairsJob( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	BtU32 size = (BtU32)(size_t)pContext & 0x7FFFFFFF;
+	BtBool isBtMemory = ( (size_t)pContext & 0x80000000 ) ? BtTrue : BtFalse;
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		void *pMemory = LAllocate( size, isBtMemory );
+		*(volatile BtU8*)pMemory = 0;
+		LFree( pMemory, isBtMemory );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBenchWorkers
+
+static void LBenchWorkers( BtU32 size, BtBool isBtMemory )
+{
+	const BtChar *pName = ( isBtMemory == BtTrue ) ? "BtMemory" : "malloc";
+	BtChar name[64];
+	TsTimer timer;
+
+	void *pContext = (void*)(size_t)( size | ( ( isBtMemory == BtTrue ) ? 0x80000000 : 0 ) );
+
+	timer.Start();
+	BtJobSystem::ParallelFor( NumPairs, JobGrainSize, LPairsJob, pContext );
+	sprintf( name, "%s %d bytes, %d workers", pName, size, BtJobSystem::GetNumWorkers() );
+	timer.Stop( name, NumPairs );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	BtU32 sizes[] = { 16, 64, 200, 1024, 65536 };
+
+	for( BtU32 i=0; i<sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+	{
+		LBench( sizes[i], BtTrue );
+		LBench( sizes[i], BtFalse );
+	}
+
+	// Per pair of all the workers together
+	BtJobSystem::CreateManager();
+
+	for( BtU32 i=0; i<sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+	{
+		LBenchWorkers( sizes[i], BtTrue );
+		LBenchWorkers( sizes[i], BtFalse );
+	}
+
+	BtJobSystem::DestroyManager();
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtProfilerBench.cpp
+
+// What a marker costs with no capture running and while recording, and what writing
+// a capture out costs per event
+
+#include <stdio.h>
+#include "BtProfiler.h"
+#include "TsTest.h"
+
+const BtU32 NumIdleMarkers = 10000000;
+
+// Stays under MaxProfileEvents so nothing is dropped
+const BtU32 NumRecordedMarkers = 15000;
+
+////////////////////////////////////////////////////////////////////////////////
+// LRecordMarkers
+
+static void LRecordMarkers( TsTimer &timer, const BtChar *pName )
+{
+	BtProfiler::Capture( 1 );
+	BtProfiler::BeginFrame();
+
+	timer.Start();
+	for( BtU32 i=0; i<NumRecordedMarkers; i++ )
+	{
+		BtProfile( "Recorded" );
+	}
+	timer.Stop( pName, NumRecordedMarkers );
+
+	BtProfiler::EndFrame();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	BtProfiler::SetThreadName( "Main" );
+
+	TsTimer timer;
+
+	timer.Start();
+	for( BtU32 i=0; i<NumIdleMarkers; i++ )
+	{
+		BtProfile( "Idle" );
+	}
+	timer.Stop( "BtProfile with no capture", NumIdleMarkers );
+
+	// The first capture allocates the thread's events
+	LRecordMarkers( timer, "BtProfile in the first capture" );
+	BtProfiler::WriteTrace( "bench.json" );
+	LRecordMarkers( timer, "BtProfile while capturing" );
+
+	timer.Start();
+	BtProfiler::WriteTrace( "bench.json" );
+	timer.Stop( "WriteTrace per event", NumRecordedMarkers );
+
+	BtProfiler::Capture( 1 );
+	BtProfiler::BeginFrame();
+
+	timer.Start();
+	for( BtU32 i=0; i<NumRecordedMarkers; i++ )
+	{
+		BtProfiler::Counter( "Counter", i );
+	}
+	timer.Stop( "Counter while capturing", NumRecordedMarkers );
+
+	BtProfiler::EndFrame();
+	BtProfiler::WriteTrace( "bench.json" );
+
+	timer.Start();
+	for( BtU32 i=0; i<NumIdleMarkers; i++ )
+	{
+		BtProfiler::Counter( "Counter", i );
+	}
+	timer.Stop( "Counter with no capture", NumIdleMarkers );
+
+	printf( "%d events dropped\n", BtProfiler::GetNumDroppedEvents() );
+
+	remove( "bench.json" );
+	return 0;
+}
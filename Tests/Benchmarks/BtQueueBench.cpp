@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtQueueBench.cpp
+
+// Items per second through the lock free MPMC queue against a BtQueue behind a BtMutex,
+// with one consumer and one, two or four producers
+
+#include <stdio.h>
+#include "BtAtomic.h"
+#include "BtMutex.h"
+#include "BtQueue.h"
+#include "BtQueueMPMC.h"
+#include "BtThread.h"
+#include "TsTest.h"
+
+const BtU32 NumItems = 1 << 21;
+const BtU32 QueueSize = 1024;
+const BtU32 MaxProducers = 4;
+
+////////////////////////////////////////////////////////////////////////////////
+// LLockedQueue
+
+// What a queue shared between threads looked like before the lock free ones
+class LLockedQueue
+{
+public:
+
+	BtBool								Push( BtU32 item )
+	{
+		BtScopedLock lock( m_mutex );
+
+		if( m_queue.IsRoom() == BtFalse )
+		{
+			return BtFalse;
+		}
+		m_queue.Push( item );
+		return BtTrue;
+	}
+
+	BtBool								Pop( BtU32 &item )
+	{
+		BtScopedLock lock( m_mutex );
+
+		if( m_queue.GetItemCount() == 0 )
+		{
+			return BtFalse;
+		}
+		item = m_queue.Pop();
+		return BtTrue;
+	}
+
+private:
+
+	BtMutex								m_mutex;
+	BtQueue<BtU32, QueueSize>			m_queue;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LProducer
+
+template< class Queue > class LProducer : public BtThread
+{
+public:
+
+	Queue							   *m_pQueue;
+	BtU32								m_numItems;
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		for( BtU32 i=0; i<m_numItems; i++ )
+		{
+			while( ( m_pQueue->Push( i ) == BtFalse ) && ( IsEnded() == BtFalse ) )
+			{
+				YieldThread();
+			}
+		}
+		IsEnded( BtTrue );
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LRun
+
+// Pops on this thread until every producer's items have come through
+template< class Queue > static void LRun( Queue &queue, const BtChar *pQueueName, BtU32 numProducers )
+{
+	LProducer<Queue> producers[MaxProducers];
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<numProducers; i++ )
+	{
+		producers[i].m_pQueue = &queue;
+		producers[i].m_numItems = NumItems / numProducers;
+		producers[i].Start();
+	}
+
+	BtU64 sum = 0;
+	BtU32 item;
+
+	for( BtU32 numPopped=0; numPopped<NumItems; )
+	{
+		if( queue.Pop( item ) == BtTrue )
+		{
+			sum += item;
+			++numPopped;
+		}
+		else
+		{
+			producers[0].YieldThread();
+		}
+	}
+
+	BtChar name[64];
+	sprintf( name, "%s, %d producers: per item", pQueueName, numProducers );
+	timer.Stop( name, NumItems );
+
+	for( BtU32 i=0; i<numProducers; i++ )
+	{
+		producers[i].End();
+	}
+
+	// Keeps the pops from being optimised away
+	if( sum == 0 )
+	{
+		printf( "Nothing popped\n" );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	printf( "%d processors\n", BtThread::GetNumProcessors() );
+
+	BtQueueMPMC<BtU32, QueueSize> lockFree;
+	LLockedQueue locked;
+
+	for( BtU32 numProducers=1; numProducers<=MaxProducers; numProducers*=2 )
+	{
+		LRun( lockFree, "MPMC", numProducers );
+		LRun( locked, "BtQueue and BtMutex", numProducers );
+	}
+
+	return 0;
+}
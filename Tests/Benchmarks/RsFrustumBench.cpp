@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsFrustumBench.cpp
+
+// Culling 100k bounding spheres against a camera's frustum, one IsInside at a time as
+// the scene graph used to, then in batches with the SIMD kernel off and on. Spheres are
+// scattered all around the camera, so one in twenty or so is visible. Then the same for
+// boxes of the same centres
+
+#include <stdio.h>
+#include <vector>
+#include "MtAABB.h"
+#include "MtMatrix4.h"
+#include "RsFrustum.h"
+#include "TsTest.h"
+
+const BtU32 NumBounds = 100000;
+const BtU32 NumPasses = 50;
+
+// How many bounds the scene graph gathers before culling them
+const BtU32 BatchSize = 256;
+
+static BtBool g_isInside[NumBounds];
+
+////////////////////////////////////////////////////////////////////////////////
+// LCountVisible
+
+static BtU32 LCountVisible()
+{
+	BtU32 numVisible = 0;
+
+	for( BtU32 i=0; i<NumBounds; i++ )
+	{
+		numVisible += ( g_isInside[i] == BtTrue ) ? 1 : 0;
+	}
+	return numVisible;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunBatches
+
+static void LRunBatches( const RsFrustum &frustum, std::vector<BtFloat> *pBounds, BtBool isBoxes, BtBool isSimd )
+{
+	RsFrustum::SetSimd( isSimd );
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iPass=0; iPass<NumPasses; iPass++ )
+	{
+		for( BtU32 i=0; i<NumBounds; i += BatchSize )
+		{
+			BtU32 count = ( NumBounds - i < BatchSize ) ? NumBounds - i : BatchSize;
+
+			if( isBoxes == BtTrue )
+			{
+				frustum.IsInside( &pBounds[0][i], &pBounds[1][i], &pBounds[2][i], &pBounds[4][i], &pBounds[5][i], &pBounds[6][i], count, &g_isInside[i] );
+			}
+			else
+			{
+				frustum.IsInside( &pBounds[0][i], &pBounds[1][i], &pBounds[2][i], &pBounds[3][i], count, &g_isInside[i] );
+			}
+		}
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d %s, batched, SIMD %s: per pass", NumBounds, ( isBoxes == BtTrue ) ? "boxes" : "spheres", ( isSimd == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumPasses );
+
+	printf( "%-48s %12d\n", "  visible", LCountVisible() );
+
+	RsFrustum::SetSimd( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	MtMatrix4 m4Projection;
+	m4Projection.BuildLeftHandedProjectionMatrix( 0.1f, 200.0f, 1.33f );
+
+	RsFrustum frustum;
+	frustum.Set( m4Projection );
+
+	// X, Y, Z and radius, then the half extents of the boxes
+	std::vector<BtFloat> bounds[7];
+
+	for( BtU32 i=0; i<NumBounds; i++ )
+	{
+		bounds[0].push_back( TsTest::Random( -150.0f, 150.0f ) );
+		bounds[1].push_back( TsTest::Random( -150.0f, 150.0f ) );
+		bounds[2].push_back( TsTest::Random( -150.0f, 150.0f ) );
+		bounds[3].push_back( TsTest::Random( 0.5f, 5.0f ) );
+		bounds[4].push_back( TsTest::Random( 0.5f, 5.0f ) );
+		bounds[5].push_back( TsTest::Random( 0.5f, 5.0f ) );
+		bounds[6].push_back( TsTest::Random( 0.5f, 5.0f ) );
+	}
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iPass=0; iPass<NumPasses; iPass++ )
+	{
+		for( BtU32 i=0; i<NumBounds; i++ )
+		{
+			g_isInside[i] = frustum.IsInside( MtVector3( bounds[0][i], bounds[1][i], bounds[2][i] ), bounds[3][i] );
+		}
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d spheres, one at a time: per pass", NumBounds );
+	timer.Stop( name, NumPasses );
+
+	printf( "%-48s %12d\n", "  visible", LCountVisible() );
+
+	LRunBatches( frustum, bounds, BtFalse, BtFalse );
+	LRunBatches( frustum, bounds, BtFalse, BtTrue );
+
+	// The boxes as the scene graph keeps them
+	std::vector<MtAABB> boxes;
+
+	for( BtU32 i=0; i<NumBounds; i++ )
+	{
+		MtVector3 v3Center( bounds[0][i], bounds[1][i], bounds[2][i] );
+		MtVector3 v3Extent( bounds[4][i], bounds[5][i], bounds[6][i] );
+
+		boxes.push_back( MtAABB( v3Center - v3Extent, v3Center + v3Extent ) );
+	}
+
+	timer.Start();
+
+	for( BtU32 iPass=0; iPass<NumPasses; iPass++ )
+	{
+		for( BtU32 i=0; i<NumBounds; i++ )
+		{
+			g_isInside[i] = frustum.IsInside( boxes[i] );
+		}
+	}
+
+	sprintf( name, "%d boxes, one at a time: per pass", NumBounds );
+	timer.Stop( name, NumPasses );
+
+	printf( "%-48s %12d\n", "  visible", LCountVisible() );
+
+	LRunBatches( frustum, bounds, BtTrue, BtFalse );
+	LRunBatches( frustum, bounds, BtTrue, BtTrue );
+
+	return 0;
+}
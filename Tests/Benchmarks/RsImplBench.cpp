@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsImplBench.cpp
+
+// Allocation rates of the graphics heap for renderable sized blocks, once it has grown
+// and in the frame that grows it, against the general heap for the same blocks
+
+#include <vector>
+#include "BtMemory.h"
+#include "TsRenderer.h"
+#include "TsTest.h"
+
+const BtU32 NumRenderables = 40960;
+const BtU32 NumFrames = 50;
+
+// Too big for the stack with its vertex arrays
+static TsRenderer g_renderer;
+
+////////////////////////////////////////////////////////////////////////////////
+// LAllocateFrame
+
+static void LAllocateFrame( TsRenderer &renderer )
+{
+	for( BtU32 i=0; i<NumRenderables; i++ )
+	{
+		renderer.AllocateGraphicsMemory( sizeof( TsRenderable ) );
+		renderer.AllocateGraphicsMemory( sizeof( RsPrimitive ) );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	g_renderer.Create();
+
+	TsTimer timer;
+
+	timer.Start();
+	g_renderer.ResetGraphicsMemory();
+	LAllocateFrame( g_renderer );
+	timer.Stop( "Graphics heap, frame that grows it", NumRenderables * 2 );
+
+	timer.Start();
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		g_renderer.ResetGraphicsMemory();
+		LAllocateFrame( g_renderer );
+	}
+	timer.Stop( "Graphics heap, grown", NumRenderables * 2 * NumFrames );
+
+	timer.Start();
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		g_renderer.AllocateGraphicsMemory( sizeof( TsRenderable ) );
+		g_renderer.ResetGraphicsMemory();
+	}
+	timer.Stop( "Graphics heap, reset", NumFrames );
+
+	const RsGraphicsHeapStats &stats = g_renderer.GetGraphicsHeapStats();
+	printf( "%d bytes in %d pages, %d used at most\n", stats.m_capacity, stats.m_numPages, stats.m_highWater );
+
+	g_renderer.Destroy();
+
+	// What allocating each renderable from the general heap would cost
+	std::vector<void*> allocations( NumRenderables * 2 );
+
+	timer.Start();
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		for( BtU32 i=0; i<NumRenderables; i++ )
+		{
+			allocations[i * 2] = BtMemory::Allocate( BtMT_Render, sizeof( TsRenderable ) );
+			allocations[i * 2 + 1] = BtMemory::Allocate( BtMT_Render, sizeof( RsPrimitive ) );
+		}
+		for( BtU32 i=0; i<allocations.size(); i++ )
+		{
+			BtMemory::Free( allocations[i] );
+		}
+	}
+	timer.Stop( "General heap, allocate and free", NumRenderables * 2 * NumFrames );
+
+	return 0;
+}
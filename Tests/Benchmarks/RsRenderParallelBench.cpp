@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsRenderParallelBench.cpp
+
+// How preparing the renderables of a scene of thousands of nodes scales with the number
+// of workers. Each node does what a mesh does to render: transform its bounds, test
+// them against the camera frustum and add a mesh renderable for each material
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "BtJobSystem.h"
+#include "BtThread.h"
+#include "MtMath.h"
+#include "RsCamera.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "TsNullGL.h"
+#include "TsRenderTarget.h"
+#include "TsTest.h"
+
+const BtU32 NumMaterials = 2;
+const BtU32 NumFrames = 20;
+const BtU32 GrainSize = 64;
+
+struct LNode
+{
+	MtMatrix4							m_m4Local;
+	MtMatrix4							m_m4World;
+	MtVector3							m_v3Center;
+	BtFloat								m_radius;
+};
+
+struct LScene
+{
+	std::vector<LNode>					m_nodes;
+	MtMatrix4							m_m4Parent;
+	TsRenderTarget						m_target;
+};
+
+static LScene g_scene;
+
+////////////////////////////////////////////////////////////////////////////////
+// LPrepare
+
+static void LPrepare( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LScene *pScene = (LScene*)pContext;
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	const RsCamera &camera = pScene->m_target.GetCamera();
+	const RsFrustum &frustum = camera.GetFrustum();
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		LNode &node = pScene->m_nodes[i];
+
+		node.m_m4World = node.m_m4Local * pScene->m_m4Parent;
+
+		MtVector3 v3Center = node.m_v3Center * node.m_m4World;
+
+		if( frustum.IsInside( v3Center, node.m_radius ) == BtFalse )
+		{
+			continue;
+		}
+
+		for( BtU32 iMaterial=0; iMaterial<NumMaterials; iMaterial++ )
+		{
+			SgMeshRenderable *pRenderable = pImpl->AddMesh();
+			pRenderable->m_pMesh = BtNull;
+			pRenderable->m_pMaterialBlock = BtNull;
+			pRenderable->m_nStartRenderBlock = iMaterial;
+			pRenderable->m_nEndRenderBlock = iMaterial + 1;
+			pRenderable->m_m4World = node.m_m4World;
+
+			pScene->m_target.Add( iMaterial, pRenderable );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeScene
+
+// A grid of nodes in front of the camera, with some of it out of view to be culled
+static void LMakeScene( BtU32 numNodes )
+{
+	g_scene.m_nodes.resize( numNodes );
+	g_scene.m_m4Parent.SetIdentity();
+
+	BtU32 width = (BtU32)sqrtf( (BtFloat)numNodes );
+
+	for( BtU32 i=0; i<numNodes; i++ )
+	{
+		LNode &node = g_scene.m_nodes[i];
+
+		MtMatrix4 m4Rotate;
+		m4Rotate.SetRotationY( i * 0.1f );
+		MtMatrix4 m4Translate;
+		m4Translate.SetTranslation( MtVector3( ( i % width ) * 2.0f - width, ( i / width ) * 2.0f - width, width * 1.5f ) );
+
+		node.m_m4Local = m4Rotate * m4Translate;
+		node.m_v3Center = MtVector3( 0, 0, 0 );
+		node.m_radius = 1.0f;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRenderFrames
+
+// Nanoseconds per node
+static BtDouble LRenderFrames( const BtChar *pName, BtU32 numNodes )
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	BtU64 elapsed = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		pImpl->ResetRenderables();
+		g_scene.m_target.Reset();
+
+		// Only the preparation is timed, as the frame would spend it before rendering
+		BtU64 start = BtTime::GetElapsedTimeInNanoseconds();
+		pImpl->RenderParallel( numNodes, GrainSize, LPrepare, &g_scene );
+		elapsed += BtTime::GetElapsedTimeInNanoseconds() - start;
+	}
+
+	BtDouble perNode = (BtDouble)elapsed / ( numNodes * NumFrames );
+	printf( "%-48s %12.1f ns\n", pName, perNode );
+
+	return perNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsCamera camera( 0.1f, 10000.0f, 800.0f / 600.0f, RsViewport( 0, 0, 800, 600 ), MtDegreesToRadians( 60.0f ) );
+	camera.SetPerspective( BtTrue );
+	camera.Update();
+	g_scene.m_target.SetCamera( camera );
+
+	// RenderParallel needs two workers to record on jobs, so always time that
+	BtU32 maxWorkers = MtMax( MtMin( BtThread::GetNumProcessors(), MaxJobWorkers ), (BtU32)2 );
+	const BtU32 sceneSizes[] = { 4096, 16384 };
+
+	printf( "%d processors\n", BtThread::GetNumProcessors() );
+
+	for( BtU32 iSize=0; iSize<sizeof( sceneSizes ) / sizeof( sceneSizes[0] ); iSize++ )
+	{
+		BtU32 numNodes = sceneSizes[iSize];
+		LMakeScene( numNodes );
+
+		BtChar name[64];
+
+		// Without a job system the nodes are prepared on this thread as they were before
+		sprintf( name, "%d nodes, no job system: per node", numNodes );
+		BtDouble serial = LRenderFrames( name, numNodes );
+
+		for( BtU32 numWorkers=1; numWorkers<=maxWorkers; numWorkers*=2 )
+		{
+			BtJobSystem::CreateManager( numWorkers );
+
+			sprintf( name, "%d nodes, %d workers: per node", numNodes, numWorkers );
+			BtDouble perNode = LRenderFrames( name, numNodes );
+			printf( "%-48s %12.2fx\n", "  speed up", serial / perNode );
+
+			BtJobSystem::DestroyManager();
+		}
+	}
+
+	BtU32 numRenderables = 0;
+
+	for( BtU32 iMaterial=0; iMaterial<NumMaterials; iMaterial++ )
+	{
+		std::vector<const SgMeshRenderable*> meshes;
+		g_scene.m_target.GetMeshes( iMaterial, meshes );
+		numRenderables += (BtU32)meshes.size();
+	}
+	printf( "%d renderables in the last frame\n", numRenderables );
+
+	((RsImplWinGL*)RsImpl::pInstance())->ResetRenderables();
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
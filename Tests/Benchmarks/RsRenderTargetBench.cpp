@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsRenderTargetBench.cpp
+
+// Frames of the immediate mode drawing a game's debug lines and UI do, rendered with
+// batching on and off. Small strips and lists come in runs of a material, as a UI draws
+// a panel's quads together. Reports the frame time and the draw calls each frame makes.
+// Then frames of meshes with their materials mixed, sorted and not, reporting the state
+// changes that reach the device
+
+#include <stdio.h>
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumFrames = 200;
+const BtU32 NumMaterials = 4;
+const BtU32 NumQuads = 2000;
+const BtU32 RunLength = 25;
+const BtU32 NumMeshCounts = 2;
+const BtU32 MeshCounts[NumMeshCounts] = { 1000, 10000 };
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtBool isBatching )
+{
+	RsRenderTargetWinGL::SetBatching( isBatching );
+
+	RsVertex3 quad[4];
+	BtMemory::Set( quad, 0, sizeof( quad ) );
+
+	for( BtU32 i=0; i<4; i++ )
+	{
+		quad[i].m_v3Position = MtVector3( (BtFloat)( i & 1 ), (BtFloat)( i >> 1 ), 10.0f );
+		quad[i].m_colour = 0xFFFFFFFF;
+	}
+
+	BtU64 numDrawCalls = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		TsDraw::BeginFrame( pShader );
+
+		for( BtU32 i=0; i<NumQuads; i++ )
+		{
+			RsMaterialImpl *pMaterial = ppMaterials[( i / RunLength ) % NumMaterials];
+
+			// Every other quad of a run is a strip, the rest lists of two triangles
+			if( i & 1 )
+			{
+				pMaterial->Render( RsPT_TriangleStrip, quad, 4, 0 );
+			}
+			else
+			{
+				RsVertex3 list[6] = { quad[0], quad[1], quad[2], quad[2], quad[1], quad[3] };
+				pMaterial->Render( RsPT_TriangleList, list, 6, 0 );
+			}
+		}
+		TsDraw::EndFrame();
+
+		numDrawCalls += RsGL::GetFrameStats().m_numDrawCalls;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d quads, batching %s: per frame", NumQuads, ( isBatching == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  draw calls per frame", (BtDouble)numDrawCalls / NumFrames );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunMeshFrames
+
+static void LRunMeshFrames( RsShaderImpl *pShader, const std::vector<SgNodeImpl*> &meshes, BtBool isSorting )
+{
+	RsRenderTargetWinGL::SetSorting( isSorting );
+
+	BtU64 numStateChanges = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		TsDraw::BeginFrame( pShader );
+
+		for( BtU32 i=0; i<meshes.size(); i++ )
+		{
+			meshes[i]->Render();
+		}
+		TsDraw::EndFrame();
+
+		numStateChanges += RsGL::GetFrameStats().m_numStateChanges;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d meshes, sorting %s: per frame", (BtU32)meshes.size(), ( isSorting == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  state changes per frame", (BtDouble)numStateChanges / NumFrames );
+
+	RsRenderTargetWinGL::SetSorting( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunMeshes
+
+// Meshes scattered in front of the camera with every material in turn. Instancing is off
+// so each mesh is drawn on its own either way
+static void LRunMeshes( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtU32 numMeshes )
+{
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	std::vector<SgNodeImpl*> meshes;
+
+	for( BtU32 i=0; i<numMeshes; i++ )
+	{
+		MtMatrix4 m4World;
+		m4World.SetIdentity();
+		m4World.SetTranslation( (BtFloat)( i % 16 ) - 8.0f, (BtFloat)( ( i / 16 ) % 16 ) - 8.0f, 30.0f + ( ( i * 7 ) % 50 ) );
+
+		meshes.push_back( TsDraw::MakeMesh( pScene, ppMaterials + ( i % NumMaterials ), 1, m4World ) );
+	}
+
+	RsRenderTargetWinGL::SetInstancing( BtFalse );
+
+	LRunMeshFrames( pShader, meshes, BtTrue );
+	LRunMeshFrames( pShader, meshes, BtFalse );
+
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		TsDraw::FreeMesh( meshes[i] );
+	}
+	TsDraw::FreeScene( pScene );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterials[NumMaterials];
+
+	for( BtU32 i=0; i<NumMaterials; i++ )
+	{
+		pMaterials[i] = TsDraw::MakeMaterial( ( i & 1 ) ? "RsShaderT2" : "RsShaderZL" );
+	}
+
+	LRunFrames( pShader, pMaterials, BtTrue );
+	LRunFrames( pShader, pMaterials, BtFalse );
+
+	RsRenderTargetWinGL::SetBatching( BtTrue );
+
+	for( BtU32 i=0; i<NumMeshCounts; i++ )
+	{
+		LRunMeshes( pShader, pMaterials, MeshCounts[i] );
+	}
+
+	for( BtU32 i=0; i<NumMaterials; i++ )
+	{
+		TsDraw::FreeMaterial( pMaterials[i] );
+	}
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsShaderBench.cpp
+
+// The cost of picking a technique for a draw. The chain of name comparisons SetTechnique
+// used to walk is timed on its own, then SetTechnique by name, by a handle and by the
+// handle a material keeps. The null backend with the state cache on stands in for the
+// device, so this is our side of each call. Then loading the shader with the program
+// cache cold and warm. Compiling costs nothing on the null backend, so this times our
+// side of a load and counts the commands each sends
+
+#include <stdio.h>
+#include "ApConfig.h"
+#include "BtString.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsShaderImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumDraws = 1000000;
+const BtU32 NumLoads = 50;
+
+// Techniques in the order the old chain tested them
+static const BtChar* g_names[RsTechnique_BuiltIn] =
+{
+	"RsShaderAdditive",
+	"lensflare",
+	"RsShadow",
+	"RsProjectedShadow",
+	"RsShaderT2",
+	"RsShaderTG",
+	"RsShaderTG2",
+	"RsShaderT",
+	"RsShaderZL",
+	"RsShaderZLTGD",
+	"RsShaderZLT",
+	"RsShaderZLTG",
+	"RsShaderZTG",
+	"RsShaderZLTS",
+	"RsYUVToRGB",
+};
+
+// Draws alternate between these, as meshes of a scene do
+static const BtChar* g_drawn[] = { "RsShaderZLT", "RsShaderZL", "RsShaderZLTS", "RsShaderT2" };
+const BtU32 NumDrawn = sizeof( g_drawn ) / sizeof( g_drawn[0] );
+
+static volatile BtU32 g_sink;
+
+////////////////////////////////////////////////////////////////////////////////
+// LFindByChain
+
+// How the old SetTechnique found a technique
+static BtU32 LFindByChain( const BtChar *pName )
+{
+	for( BtU32 i=0; i<RsTechnique_BuiltIn; i++ )
+	{
+		if( BtStrCompare( pName, g_names[i] ) == BtTrue )
+		{
+			return i;
+		}
+	}
+	return RsTechniqueNone;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTimeLoads
+
+// Cold loads start without a cache file, so each compiles and writes one
+static void LTimeLoads( BtBool isWarm )
+{
+	const BtChar *pCacheFilename = "RsShaderBench.glcache";
+
+	BtU64 numCommands = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<NumLoads; i++ )
+	{
+		if( isWarm == BtFalse )
+		{
+			remove( pCacheFilename );
+		}
+
+		RsGL::BeginCapture();
+		RsShaderImpl *pShader = TsDraw::MakeShader();
+		RsGL::EndCapture();
+
+		numCommands += RsGL::GetNumCommands();
+
+		TsDraw::FreeShader( pShader );
+	}
+	timer.Stop( ( isWarm == BtTrue ) ? "Load from a warm program cache: per load" : "Load with a cold program cache: per load", NumLoads );
+
+	printf( "%-48s %12.1f\n", "  commands captured per load", (BtDouble)numCommands / NumLoads );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterials[NumDrawn];
+	BtU32 handles[NumDrawn];
+
+	for( BtU32 i=0; i<NumDrawn; i++ )
+	{
+		pMaterials[i] = TsDraw::MakeMaterial( g_drawn[i] );
+		handles[i] = RsShaderImpl::GetTechnique( g_drawn[i] );
+	}
+
+	TsTimer timer;
+
+	// Finding the technique alone, without setting it
+	timer.Start();
+
+	for( BtU32 i=0; i<NumDraws; i++ )
+	{
+		g_sink = LFindByChain( g_drawn[i % NumDrawn] );
+	}
+	timer.Stop( "Find by name comparisons: per draw", NumDraws );
+
+	timer.Start();
+
+	for( BtU32 i=0; i<NumDraws; i++ )
+	{
+		g_sink = RsShaderImpl::GetTechnique( g_drawn[i % NumDrawn] );
+	}
+	timer.Stop( "Find by hashed name: per draw", NumDraws );
+
+	// Setting it, with the GL calls it makes
+	timer.Start();
+
+	for( BtU32 i=0; i<NumDraws; i++ )
+	{
+		pShader->SetTechnique( g_drawn[i % NumDrawn] );
+	}
+	timer.Stop( "SetTechnique by name: per draw", NumDraws );
+
+	timer.Start();
+
+	for( BtU32 i=0; i<NumDraws; i++ )
+	{
+		pShader->SetTechnique( handles[i % NumDrawn] );
+	}
+	timer.Stop( "SetTechnique by handle: per draw", NumDraws );
+
+	timer.Start();
+
+	for( BtU32 i=0; i<NumDraws; i++ )
+	{
+		pShader->SetTechnique( pMaterials[i % NumDrawn]->GetTechnique() );
+	}
+	timer.Stop( "SetTechnique by material's handle: per draw", NumDraws );
+
+	for( BtU32 i=0; i<NumDrawn; i++ )
+	{
+		TsDraw::FreeMaterial( pMaterials[i] );
+	}
+	TsDraw::FreeShader( pShader );
+
+	// The cache is named after the documents folder and the archive, which TsDraw's lacks
+	ApConfig::SetDocuments( "RsShaderBench" );
+	RsShaderImpl::SetProgramCache( BtTrue );
+
+	LTimeLoads( BtFalse );
+	LTimeLoads( BtTrue );
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+	remove( "RsShaderBench.glcache" );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsStreamBufferBench.cpp
+
+// Frames of immediate mode triangles drawn through the render system with the stream
+// ring on and off, reporting the frame time and what each frame uploads. The null backend
+// keeps what is uploaded in memory, so this times our side of the upload and not a
+// driver's. The draws are not batched, so each one has its vertices found or written
+
+#include <stdio.h>
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumFrames = 200;
+const BtU32 NumDrawCounts = 3;
+const BtU32 DrawCounts[NumDrawCounts] = { 100, 1000, 5000 };
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, RsMaterialImpl *pMaterial, BtU32 numDraws, BtBool isRing )
+{
+	RsImplWinGL::SetStreamRing( isRing );
+
+	std::vector<RsVertex3> vertex( numDraws * 3 );
+	BtMemory::Set( &vertex[0], 0, (BtU32)( vertex.size() * sizeof( RsVertex3 ) ) );
+
+	for( BtU32 i=0; i<vertex.size(); i++ )
+	{
+		vertex[i].m_v3Position = MtVector3( (BtFloat)( i % 3 ), (BtFloat)( i % 7 ), 10.0f );
+		vertex[i].m_colour = 0xFFFFFFFF;
+	}
+
+	BtU64 numUploads = 0;
+	BtU64 bytesUploaded = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		TsDraw::BeginFrame( pShader );
+
+		for( BtU32 i=0; i<numDraws; i++ )
+		{
+			pMaterial->Render( RsPT_TriangleList, &vertex[i * 3], 3, 0 );
+		}
+		TsDraw::EndFrame();
+
+		numUploads += RsGL::GetFrameStats().m_numUploads;
+		bytesUploaded += RsGL::GetFrameStats().m_bytesUploaded;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d draws, ring %s: per frame", numDraws, ( isRing == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  uploads per frame", (BtDouble)numUploads / NumFrames );
+	printf( "%-48s %12.1f KB\n", "  uploaded per frame", (BtDouble)bytesUploaded / NumFrames / 1024.0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+	RsRenderTargetWinGL::SetBatching( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL", RsMaterial_Lit );
+
+	for( BtU32 i=0; i<NumDrawCounts; i++ )
+	{
+		LRunFrames( pShader, pMaterial, DrawCounts[i], BtTrue );
+		LRunFrames( pShader, pMaterial, DrawCounts[i], BtFalse );
+	}
+
+	RsImplWinGL::SetStreamRing( BtTrue );
+
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
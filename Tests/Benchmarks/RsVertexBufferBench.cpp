@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsVertexBufferBench.cpp
+
+// Frames of meshes drawn from vertex array objects and with their attributes set up by
+// hand, reporting the frame time and the state changes that reach the device. Instancing
+// is off so each mesh is drawn on its own, and the materials alternate so every mesh
+// binds its buffers again
+
+#include <stdio.h>
+#include <vector>
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "RsVertexBufferImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumFrames = 200;
+const BtU32 NumMaterials = 2;
+const BtU32 NumMeshCounts = 2;
+const BtU32 MeshCounts[NumMeshCounts] = { 100, 1000 };
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtU32 numMeshes, BtBool isVertexArrays )
+{
+	// Vertex arrays are made as the scene is
+	RsVertexBufferImpl::SetVertexArrays( isVertexArrays );
+
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	std::vector<SgNodeImpl*> meshes;
+
+	for( BtU32 i=0; i<numMeshes; i++ )
+	{
+		MtMatrix4 m4World;
+		m4World.SetIdentity();
+		m4World.SetTranslation( (BtFloat)( i % 16 ) - 8.0f, (BtFloat)( ( i / 16 ) % 16 ) - 8.0f, 30.0f + ( ( i * 7 ) % 50 ) );
+
+		meshes.push_back( TsDraw::MakeMesh( pScene, ppMaterials + ( i % NumMaterials ), 1, m4World ) );
+	}
+
+	BtU64 numStateChanges = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		TsDraw::BeginFrame( pShader );
+
+		for( BtU32 i=0; i<meshes.size(); i++ )
+		{
+			meshes[i]->Render();
+		}
+		TsDraw::EndFrame();
+
+		numStateChanges += RsGL::GetFrameStats().m_numStateChanges;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d meshes, vertex arrays %s: per frame", numMeshes, ( isVertexArrays == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  state changes per frame", (BtDouble)numStateChanges / NumFrames );
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		TsDraw::FreeMesh( meshes[i] );
+	}
+	TsDraw::FreeScene( pScene );
+
+	RsVertexBufferImpl::SetVertexArrays( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+	RsRenderTargetWinGL::SetInstancing( BtFalse );
+	RsRenderTargetWinGL::SetSorting( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterials[NumMaterials];
+	pMaterials[0] = TsDraw::MakeMaterial( "RsShaderZL" );
+	pMaterials[1] = TsDraw::MakeMaterial( "RsShaderZLT" );
+
+	for( BtU32 i=0; i<NumMeshCounts; i++ )
+	{
+		LRunFrames( pShader, pMaterials, MeshCounts[i], BtTrue );
+		LRunFrames( pShader, pMaterials, MeshCounts[i], BtFalse );
+	}
+
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+	RsRenderTargetWinGL::SetSorting( BtTrue );
+
+	for( BtU32 i=0; i<NumMaterials; i++ )
+	{
+		TsDraw::FreeMaterial( pMaterials[i] );
+	}
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
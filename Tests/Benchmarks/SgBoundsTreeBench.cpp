@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgBoundsTreeBench.cpp
+
+// Frames of a large generated level drawn through its root with the bounds tree on and
+// off, as the camera moves across it. Without the tree every mesh's sphere is gathered
+// and tested each frame. Reports the frame time and the meshes drawn, which match. Then
+// picks and finds of meshes near a point, through the tree and by walking every node
+
+#include <stdio.h>
+#include "MtMatrix3.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 NumGroups = 200;
+const BtU32 NumMeshesPerGroup = 100;
+const BtU32 NumFrames = 100;
+const BtU32 NumQueries = 1000;
+const BtU32 MaxNear = 1024;
+const BtFloat LevelSize = 4000.0f;
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetCamera
+
+// Walking across the level looking along the ground
+static RsCamera LGetCamera( BtU32 iFrame )
+{
+	RsCamera camera( 0.1f, 300.0f, 800.0f / 600.0f, RsViewport( 0, 0, 800, 600 ), MtDegreesToRadians( 60.0f ) );
+
+	MtMatrix3 m3Rotation;
+	m3Rotation.SetRotationY( iFrame * 0.05f );
+
+	camera.SetPosition( MtVector3( ( (BtFloat)iFrame / NumFrames - 0.5f ) * LevelSize, 0, 0 ) );
+	camera.SetRotation( m3Rotation );
+	camera.Update();
+
+	return camera;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, SgNodeImpl *pRoot, BtBool isBoundsTree )
+{
+	SgNodeImpl::SetBoundsTree( isBoundsTree );
+
+	BtU64 numDrawCalls = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		TsDraw::DrawFrame( pShader, LGetCamera( iFrame ), pRoot );
+
+		numDrawCalls += RsGL::GetFrameStats().m_numDrawCalls;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d meshes, bounds tree %s: per frame", NumGroups * NumMeshesPerGroup, ( isBoundsTree == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  meshes drawn per frame", (BtDouble)numDrawCalls / NumFrames );
+
+	SgNodeImpl::SetBoundsTree( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunQueries
+
+static void LRunQueries( SgNodeImpl *pRoot, BtBool isBoundsTree )
+{
+	static SgNode *pNear[MaxNear];
+
+	SgNodeImpl::SetBoundsTree( isBoundsTree );
+
+	BtU32 numPicked = 0;
+	BtU32 numNear = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	TsTest::SetSeed( 1 );
+
+	for( BtU32 i=0; i<NumQueries; i++ )
+	{
+		MtVector3 v3From( TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ), 100.0f, TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ) );
+		MtVector3 v3To = v3From + MtVector3( TsTest::Random( -50.0f, 50.0f ), -200.0f, TsTest::Random( -50.0f, 50.0f ) );
+
+		numPicked += ( pRoot->pPick( v3From, v3To ) != BtNull ) ? 1 : 0;
+	}
+
+	BtChar name[64];
+	sprintf( name, "Pick, bounds tree %s: per query", ( isBoundsTree == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumQueries );
+
+	timer.Start();
+
+	for( BtU32 i=0; i<NumQueries; i++ )
+	{
+		MtVector3 v3Position( TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ), 0, TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ) );
+
+		numNear += pRoot->FindNear( v3Position, 50.0f, pNear, MaxNear );
+	}
+
+	sprintf( name, "FindNear, bounds tree %s: per query", ( isBoundsTree == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumQueries );
+
+	printf( "%-48s %12d\n", "  picked", numPicked );
+	printf( "%-48s %12d\n", "  found near", numNear );
+
+	SgNodeImpl::SetBoundsTree( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	// So each mesh drawn is a draw call
+	RsRenderTargetWinGL::SetInstancing( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL" );
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	MtMatrix4 m4Identity;
+	m4Identity.SetIdentity();
+
+	SgNodeImpl *pRoot = TsScene::MakeNode( "root", m4Identity );
+
+	// Groups of meshes spread over the level
+	for( BtU32 iGroup=0; iGroup<NumGroups; iGroup++ )
+	{
+		MtMatrix4 m4Group;
+		m4Group.SetTranslation( TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ), 0, TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ) );
+
+		SgNodeImpl *pGroup = TsScene::MakeNode( "group", m4Group );
+		pRoot->AddChild( pGroup );
+
+		for( BtU32 i=0; i<NumMeshesPerGroup; i++ )
+		{
+			MtMatrix4 m4Local;
+			m4Local.SetTranslation( TsTest::Random( -100.0f, 100.0f ), TsTest::Random( -10.0f, 10.0f ), TsTest::Random( -100.0f, 100.0f ) );
+
+			pGroup->AddChild( TsDraw::MakeMesh( pScene, &pMaterial, 1, m4Local ) );
+		}
+	}
+
+	// Works out the world transforms and builds the tree
+	pRoot->Update();
+
+	LRunFrames( pShader, pRoot, BtTrue );
+	LRunFrames( pShader, pRoot, BtFalse );
+
+	LRunQueries( pRoot, BtTrue );
+	LRunQueries( pRoot, BtFalse );
+
+	TsScene::FreeNodes( pRoot );
+	TsDraw::FreeScene( pScene );
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
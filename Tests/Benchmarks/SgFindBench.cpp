@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgFindBench.cpp
+
+// pFind on a 1000 node character rig through the name table against the recursive
+// search, from the root and from a limb, for names it has and names it hasn't, and
+// what building the table again costs after a node is moved
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 NumRigNodes = 1000;
+const BtU32 NumNames = 1024;
+const BtU32 NumHashedFinds = 1000000;
+const BtU32 NumRecursiveFinds = 20000;
+const BtU32 NumBuilds = 1000;
+
+static std::vector<std::string> g_names;
+
+// Keeps the finds from being optimised away
+static BtU32 g_numFound = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LFind
+
+static void LFind( SgNode *pNode, const BtChar *pName, BtU32 numFinds, BtBool isHashed )
+{
+	SgNodeImpl::SetNameTable( isHashed );
+
+	// The first find builds the table
+	pNode->pFind( "root" );
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<numFinds; i++ )
+	{
+		const BtChar *pFind = ( pName != BtNull ) ? pName : g_names[i % NumNames].c_str();
+
+		if( pNode->pFind( pFind ) != BtNull )
+		{
+			++g_numFound;
+		}
+	}
+
+	BtChar name[64];
+	sprintf( name, "%s, %s, %s", pNode->pName(), ( pName != BtNull ) ? pName : "rig names", ( isHashed == BtTrue ) ? "hashed" : "recursive" );
+	timer.Stop( name, numFinds );
+
+	SgNodeImpl::SetNameTable( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	std::vector<SgNodeImpl*> nodes;
+	SgNodeImpl *pRoot = TsScene::MakeRig( NumRigNodes, nodes );
+
+	// Names spread over the rig, with one in sixteen it hasn't got
+	for( BtU32 i=0; i<NumNames; i++ )
+	{
+		g_names.push_back( ( i % 16 == 15 ) ? "missing" : nodes[( i * 7919 ) % NumRigNodes]->pName() );
+	}
+
+	SgNode *pLimb = pRoot->pFind( "R_arm_0" );
+
+	LFind( pRoot, BtNull, NumHashedFinds, BtTrue );
+	LFind( pRoot, BtNull, NumRecursiveFinds, BtFalse );
+	LFind( pRoot, "tip", NumHashedFinds, BtTrue );
+	LFind( pRoot, "tip", NumRecursiveFinds, BtFalse );
+	LFind( pRoot, "missing", NumHashedFinds, BtTrue );
+	LFind( pRoot, "missing", NumRecursiveFinds, BtFalse );
+	LFind( pLimb, "attach", NumHashedFinds, BtTrue );
+	LFind( pLimb, "attach", NumRecursiveFinds, BtFalse );
+
+	// Moving a node invalidates the table and the next find builds it again
+	SgNodeImpl *pProp = nodes[NumRigNodes - 1];
+	SgNodeImpl *pParent = (SgNodeImpl*)pProp->pParent();
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 i=0; i<NumBuilds; i++ )
+	{
+		pParent->RemoveChild( pProp );
+		pParent->AddChild( pProp );
+		pRoot->pFind( "tip" );
+	}
+	timer.Stop( "root, move a node and find", NumBuilds );
+
+	printf( "%d found\n", g_numFound );
+
+	TsScene::FreeNodes( pRoot );
+
+	return 0;
+}
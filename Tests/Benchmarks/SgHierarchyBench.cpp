@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgHierarchyBench.cpp
+
+// Updates of a deep and a wide tree, recursive against flattened, with none, a few, many
+// or all of the nodes moved each frame
+
+#include <stdio.h>
+#include <vector>
+#include "MtMatrix4.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 DeepLength = 2000;
+const BtU32 WideGroups = 1000;
+const BtU32 WideGroupSize = 100;
+const BtU32 NumLocals = 64;
+
+struct LTree
+{
+	std::vector<SgNodeImpl*>			m_nodes;				// The root first
+};
+
+static MtMatrix4 g_locals[NumLocals];
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeLocal
+
+static MtMatrix4 LMakeLocal( BtU32 index )
+{
+	MtMatrix4 m4Rotation;
+	MtMatrix4 m4Translation;
+	m4Rotation.SetRotationY( index * 0.1f );
+	m4Translation.SetTranslation( 0.0f, 1.0f, 0.5f );
+
+	return m4Rotation * m4Translation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeDeep
+
+static void LMakeDeep( LTree &tree )
+{
+	tree.m_nodes.push_back( TsScene::MakeNode( "root", LMakeLocal( 0 ) ) );
+
+	for( BtU32 i=0; i<DeepLength; i++ )
+	{
+		SgNodeImpl *pNode = TsScene::MakeNode( "link", LMakeLocal( i ) );
+		tree.m_nodes.back()->AddChild( pNode );
+		tree.m_nodes.push_back( pNode );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeWide
+
+// Groups below the root, each with a row of nodes and meshes below it
+static void LMakeWide( LTree &tree )
+{
+	SgNodeImpl *pRoot = TsScene::MakeNode( "root", LMakeLocal( 0 ) );
+	tree.m_nodes.push_back( pRoot );
+
+	for( BtU32 iGroup=0; iGroup<WideGroups; iGroup++ )
+	{
+		SgNodeImpl *pGroup = TsScene::MakeNode( "group", LMakeLocal( iGroup ) );
+		pRoot->AddChild( pGroup );
+		tree.m_nodes.push_back( pGroup );
+
+		for( BtU32 i=0; i<WideGroupSize; i++ )
+		{
+			SgNodeImpl *pNode = TsScene::MakeNode( "member", LMakeLocal( i ), ( i & 1 ) ? BtTrue : BtFalse );
+			pGroup->AddChild( pNode );
+			tree.m_nodes.push_back( pNode );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LUpdateFrames
+
+// Microseconds per frame of moving numMoved nodes spread through the tree and updating it
+static void LUpdateFrames( LTree &tree, const BtChar *pTreeName, BtU32 numMoved, BtBool isFlat )
+{
+	SgNodeImpl::SetFlatTransforms( isFlat );
+
+	BtU32 numNodes = (BtU32)tree.m_nodes.size();
+	SgNodeImpl *pRoot = tree.m_nodes[0];
+
+	// The first update builds what it needs
+	pRoot->Update();
+
+	// Fewer frames of the bigger trees
+	BtU32 numFrames = MtMax( 2000000 / numNodes, (BtU32)10 );
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<numFrames; iFrame++ )
+	{
+		for( BtU32 i=0; i<numMoved; i++ )
+		{
+			BtU32 index = ( ( i * 7919 ) + ( iFrame * 31 ) ) % numNodes;
+			tree.m_nodes[index]->SetLocalTransform( g_locals[( i + iFrame ) % NumLocals] );
+		}
+		pRoot->Update();
+	}
+
+	BtChar name[64];
+	sprintf( name, "%s, %s, %d moved: per frame", pTreeName, ( isFlat == BtTrue ) ? "flat" : "recursive", numMoved );
+	timer.Stop( name, numFrames );
+
+	SgNodeImpl::SetFlatTransforms( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBenchTree
+
+static void LBenchTree( LTree &tree, const BtChar *pTreeName )
+{
+	BtU32 numMoved[] = { 0, 10, 100, (BtU32)tree.m_nodes.size() };
+
+	for( BtU32 i=0; i<sizeof( numMoved ) / sizeof( numMoved[0] ); i++ )
+	{
+		LUpdateFrames( tree, pTreeName, numMoved[i], BtFalse );
+		LUpdateFrames( tree, pTreeName, numMoved[i], BtTrue );
+	}
+
+	TsScene::FreeNodes( tree.m_nodes[0] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	for( BtU32 i=0; i<NumLocals; i++ )
+	{
+		g_locals[i] = LMakeLocal( i * 3 );
+	}
+
+	LTree deep;
+	LMakeDeep( deep );
+	LBenchTree( deep, "Deep 2000" );
+
+	LTree wide;
+	LMakeWide( wide );
+	LBenchTree( wide, "Wide 1000x100" );
+
+	return 0;
+}
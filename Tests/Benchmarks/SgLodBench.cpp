@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgLodBench.cpp
+
+// Frames of a field of props spread from near the camera to far away, with levels of
+// detail on and off, reporting the frame time and the triangles and draw calls that
+// reach the device. The camera backs away over the frames, so props cross the level
+// boundaries as they would in a game
+
+#include <stdio.h>
+#include <vector>
+#include "ApConfig.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "SgMeshImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumFrames = 200;
+const BtU32 NumLods = 4;
+const BtFloat ScreenSizes[NumLods] = { 0.2f, 0.1f, 0.05f, 0 };
+const BtU32 NumPropCounts = 2;
+const BtU32 PropCounts[NumPropCounts] = { 100, 1000 };
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, RsMaterialImpl *pMaterial, RsSceneImpl *pScene, BtU32 numProps, BtBool isLod )
+{
+	SgMeshWinGL::SetLod( isLod );
+
+	std::vector<SgNodeImpl*> props;
+
+	for( BtU32 i=0; i<numProps; i++ )
+	{
+		MtMatrix4 m4World;
+		m4World.SetIdentity();
+		m4World.SetTranslation( (BtFloat)( i % 16 ) * 4.0f - 32.0f, (BtFloat)( ( i / 16 ) % 8 ) * 4.0f - 16.0f, 10.0f + ( ( i * 37 ) % 300 ) );
+
+		props.push_back( TsDraw::MakeMesh( pScene, &pMaterial, 1, m4World, ScreenSizes, NumLods ) );
+	}
+
+	BtU64 numTriangles = 0;
+	BtU64 numDrawCalls = 0;
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		RsCamera camera = TsDraw::GetCamera();
+		camera.SetPosition( MtVector3( 0, 0, -50.0f * iFrame / NumFrames ) );
+		camera.Update();
+
+		numTriangles += TsDraw::DrawFrame( pShader, camera, props );
+		numDrawCalls += RsGL::GetFrameStats().m_numDrawCalls;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d props, levels of detail %s: per frame", numProps, ( isLod == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f\n", "  triangles per frame", (BtDouble)numTriangles / NumFrames );
+	printf( "%-48s %12.1f\n", "  draw calls per frame", (BtDouble)numDrawCalls / NumFrames );
+
+	for( BtU32 i=0; i<props.size(); i++ )
+	{
+		TsDraw::FreeMesh( props[i] );
+	}
+
+	SgMeshWinGL::SetLod( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	// The levels are read from an archive written next to the benchmark
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL" );
+	RsSceneImpl *pScene = TsDraw::MakeScene( NumLods );
+
+	for( BtU32 i=0; i<NumPropCounts; i++ )
+	{
+		LRunFrames( pShader, pMaterial, pScene, PropCounts[i], BtTrue );
+		LRunFrames( pShader, pMaterial, pScene, PropCounts[i], BtFalse );
+	}
+
+	TsDraw::FreeScene( pScene );
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
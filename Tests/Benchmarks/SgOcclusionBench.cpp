@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgOcclusionBench.cpp
+
+// Frames of a room whose far wall hides most of the props in it, with occlusion on and
+// off, reporting the frame time, the time drawing the occluders, the meshes tested and
+// culled and the triangles that reach the device. The wall is built from tiles, each an
+// occluder of its own, and the camera strafes so the buffer is drawn again every frame
+
+#include <stdio.h>
+#include <vector>
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "SgOcclusionImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumFrames = 200;
+const BtU32 NumTilesPerSide = 4;
+const BtFloat TileHalfSize = 10.0f;
+const BtFloat WallDistance = 30.0f;
+const BtU32 NumPropsBehind = 2000;
+const BtU32 NumPropsInFront = 200;
+
+////////////////////////////////////////////////////////////////////////////////
+// LRunFrames
+
+static void LRunFrames( RsShaderImpl *pShader, const std::vector<SgNodeImpl*> &tiles, const std::vector<SgNodeImpl*> &props, BtBool isOcclusion )
+{
+	SgOcclusionImpl::SetOcclusion( isOcclusion );
+
+	BtU64 rasteriseTime = 0;
+	BtU64 numTested = 0;
+	BtU64 numCulled = 0;
+	BtU64 numTriangles = 0;
+
+	// The tiles then the props
+	std::vector<SgNodeImpl*> nodes( tiles );
+	nodes.insert( nodes.end(), props.begin(), props.end() );
+
+	TsTimer timer;
+	timer.Start();
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		RsCamera camera = TsDraw::GetCamera();
+		camera.SetPosition( MtVector3( -10.0f + 20.0f * iFrame / NumFrames, 0, 0 ) );
+		camera.Update();
+
+		numTriangles += TsDraw::DrawFrame( pShader, camera, nodes );
+
+		const SgOcclusionStats &stats = SgOcclusionImpl::pInstance()->GetFrameStats();
+		rasteriseTime += stats.m_rasteriseTime;
+		numTested += stats.m_numTested;
+		numCulled += stats.m_numCulled;
+	}
+
+	BtChar name[64];
+	sprintf( name, "%d meshes, occlusion %s: per frame", (BtU32)nodes.size(), ( isOcclusion == BtTrue ) ? "on" : "off" );
+	timer.Stop( name, NumFrames );
+
+	printf( "%-48s %12.1f ns\n", "  drawing the occluders", (BtDouble)rasteriseTime / NumFrames );
+	printf( "%-48s %12.1f\n", "  meshes tested per frame", (BtDouble)numTested / NumFrames );
+	printf( "%-48s %12.1f\n", "  meshes culled per frame", (BtDouble)numCulled / NumFrames );
+	printf( "%-48s %12.1f\n", "  triangles per frame", (BtDouble)numTriangles / NumFrames );
+
+	SgOcclusionImpl::SetOcclusion( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL" );
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	// The far wall, in tiles
+	std::vector<SgNodeImpl*> tiles;
+
+	for( BtU32 y=0; y<NumTilesPerSide; y++ )
+	{
+		for( BtU32 x=0; x<NumTilesPerSide; x++ )
+		{
+			MtMatrix4 m4Tile;
+			m4Tile.SetScale( TileHalfSize, TileHalfSize, 0.5f );
+			m4Tile._30 = ( ( x * 2.0f ) + 1.0f - NumTilesPerSide ) * TileHalfSize;
+			m4Tile._31 = ( ( y * 2.0f ) + 1.0f - NumTilesPerSide ) * TileHalfSize;
+			m4Tile._32 = WallDistance;
+
+			SgNodeImpl *pTile = TsDraw::MakeMesh( pScene, &pMaterial, 1, m4Tile );
+			pTile->SetOccluder( BtTrue );
+			tiles.push_back( pTile );
+		}
+	}
+
+	// Most of the props are behind the wall and a few are in the room
+	std::vector<SgNodeImpl*> props;
+
+	for( BtU32 i=0; i<NumPropsBehind + NumPropsInFront; i++ )
+	{
+		BtFloat z = ( i < NumPropsBehind ) ? TsTest::Random( WallDistance + 5.0f, 300.0f ) : TsTest::Random( 5.0f, WallDistance - 5.0f );
+
+		MtMatrix4 m4Prop;
+		m4Prop.SetTranslation( TsTest::Random( -0.6f, 0.6f ) * z, TsTest::Random( -0.4f, 0.4f ) * z, z );
+
+		props.push_back( TsDraw::MakeMesh( pScene, &pMaterial, 1, m4Prop ) );
+	}
+
+	LRunFrames( pShader, tiles, props, BtTrue );
+	LRunFrames( pShader, tiles, props, BtFalse );
+
+	for( BtU32 i=0; i<tiles.size(); i++ )
+	{
+		tiles[i]->SetOccluder( BtFalse );
+		TsDraw::FreeMesh( tiles[i] );
+	}
+
+	for( BtU32 i=0; i<props.size(); i++ )
+	{
+		TsDraw::FreeMesh( props[i] );
+	}
+	TsDraw::FreeScene( pScene );
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return 0;
+}
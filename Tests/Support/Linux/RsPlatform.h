@@ -0,0 +1,12 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsPlatform.h
+
+// The GL headers for building the render system on Linux. The tests draw with the
+// null backend so nothing here is ever called
+#pragma once
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define RS_GL_DEPTH_COMPONENT GL_DEPTH_COMPONENT24
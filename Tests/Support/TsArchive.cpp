@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsArchive.cpp
+
+#include <algorithm>
+#include <dirent.h>
+#include <new>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "BtCompressedFile.h"
+#include "BtCRC.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "BaResource.h"
+#include "TsArchive.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// GetInstanceSize
+
+// Headers alone carry no resources worth creating, so each becomes a plain BaResource
+// whose type never matches a loader
+BtU32 BaArchive::GetInstanceSize( BaResourceHeader *pResourceHeader )
+{
+	(void)pResourceHeader;
+	return sizeof( BaResource );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CreateResourceInstance
+
+void BaArchive::CreateResourceInstance( BaResourceType resourceType, BtU8 *pMemory )
+{
+	(void)resourceType;
+	new( pMemory ) BaResource;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LWriteArchive
+
+// Writes the resource headers and data in memory to pFilename, and the mapped variant
+// beside it when isMapped
+static BtBool LWriteArchive( const BtChar *pFilename, const std::vector<BtU8> &memory, BtU32 numResources, BtBool isMapped, BtU32 packerVersion )
+{
+	BtU32 archiveSize = (BtU32)memory.size();
+
+	BaArchiveHeader archiveHeader;
+	BtMemory::Set( &archiveHeader, 0, sizeof(BaArchiveHeader) );
+	BtStrCopy( archiveHeader.m_szTitle, MaxArchiveName, "TsArchive" );
+	archiveHeader.m_nPackerVersion = packerVersion;
+	archiveHeader.m_nNumResources = numResources;
+	archiveHeader.m_nDataSize = archiveSize;
+	archiveHeader.m_nHeaderCheckSum = BtCRC::GenerateHashCode( (BtU8*)&archiveHeader, sizeof(BaArchiveHeader) - sizeof(BtU32) );
+
+	FILE *f = fopen( pFilename, "wb" );
+
+	if( f == BtNull )
+	{
+		return BtFalse;
+	}
+
+	// The chunks are written by the packer's own code
+	fwrite( &archiveHeader, 1, sizeof(BaArchiveHeader), f );
+	BtCompressedFile::WriteChunks( f, (const BtU8*)( archiveSize ? &memory[0] : BtNull ), archiveSize );
+
+	BtU32 packedSize = (BtU32)ftell( f );
+
+	if( fclose( f ) != 0 )
+	{
+		return BtFalse;
+	}
+
+	if( isMapped == BtFalse )
+	{
+		return BtTrue;
+	}
+
+	// As PaPacker::WriteMappedArchive lays it out, the headers padded to a page then the archive
+	BtChar mappedFilename[256];
+	BtStrCopy( mappedFilename, 256, pFilename );
+	mappedFilename[BtStrLength( mappedFilename ) - 1] = 'm';
+
+	std::vector<BtU8> page( BaMappedArchiveAlignment, 0 );
+	*(BaArchiveHeader*)&page[0] = archiveHeader;
+
+	BaMappedArchiveHeader *pMappedHeader = (BaMappedArchiveHeader*)( &page[0] + sizeof(BaArchiveHeader) );
+	pMappedHeader->m_magic = BaMappedArchiveMagic;
+	pMappedHeader->m_nVersion = BaMappedArchiveVersion;
+	pMappedHeader->m_nSourceSize = packedSize;
+
+	f = fopen( mappedFilename, "wb" );
+
+	if( f == BtNull )
+	{
+		return BtFalse;
+	}
+
+	fwrite( &page[0], 1, BaMappedArchiveAlignment, f );
+
+	if( archiveSize )
+	{
+		fwrite( &memory[0], 1, archiveSize, f );
+	}
+	return fclose( f ) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Write
+
+//static
+BtBool TsArchive::Write( const BtChar *pFilename, const BtChar **ppTitles, const BaResourceType *pTypes, BtU32 numResources,
+						 BtU32 resourceSize, BtBool isMapped, BtU32 packerVersion )
+{
+	// The resource headers followed by the data of each resource
+	BtU32 headersSize = numResources * sizeof( BaResourceHeader );
+	BtU32 archiveSize = headersSize + numResources * resourceSize;
+	std::vector<BtU8> memory( archiveSize );
+
+	if( archiveSize )
+	{
+		BtMemory::Set( &memory[0], 0, archiveSize );
+	}
+
+	BaResourceHeader *pHeaders = (BaResourceHeader*)( archiveSize ? &memory[0] : BtNull );
+
+	for( BtU32 i=0; i<numResources; i++ )
+	{
+		BaResourceHeader &header = pHeaders[i];
+		BtStrCopy( header.m_szTitle, LMaxResourceName, ppTitles[i] );
+		header.m_type = pTypes[i];
+		header.m_nResourceID = i + 1;
+
+		if( resourceSize )
+		{
+			header.m_nResourceOffset = headersSize + i * resourceSize;
+			header.m_nResourceSize = resourceSize;
+		}
+	}
+
+	// Runs and repeats with noise through them, so it deflates about as well as mesh data
+	BtU32 seed = 12345;
+
+	for( BtU32 i=headersSize; i<archiveSize; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		memory[i] = ( ( seed >> 16 ) & 3 ) ? (BtU8)( i >> 5 ) : (BtU8)( seed >> 24 );
+	}
+
+	return LWriteArchive( pFilename, memory, numResources, isMapped, packerVersion );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LFindFiles
+
+// The files under pDirectory and its subdirectories, named from it, in name order so the
+// archive is the same each time
+static void LFindFiles( const std::string &directory, const std::string &path, std::vector<std::string> &files )
+{
+	DIR *pDir = opendir( ( directory + path ).c_str() );
+
+	if( pDir == BtNull )
+	{
+		return;
+	}
+
+	std::vector<std::string> names;
+
+	while( dirent *pEntry = readdir( pDir ) )
+	{
+		if( pEntry->d_name[0] != '.' )
+		{
+			names.push_back( pEntry->d_name );
+		}
+	}
+	closedir( pDir );
+
+	std::sort( names.begin(), names.end() );
+
+	for( BtU32 i=0; i<names.size(); i++ )
+	{
+		std::string name = path + names[i];
+		DIR *pSubDir = opendir( ( directory + name ).c_str() );
+
+		if( pSubDir != BtNull )
+		{
+			closedir( pSubDir );
+			LFindFiles( directory, name + "/", files );
+		}
+		else
+		{
+			files.push_back( name );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WriteDirectory
+
+//static
+BtBool TsArchive::WriteDirectory( const BtChar *pFilename, const BtChar *pDirectory, BtBool isMapped, BtU32 packerVersion )
+{
+	std::string directory = std::string( pDirectory ) + "/";
+	std::vector<std::string> files;
+	LFindFiles( directory, "", files );
+
+	BtU32 numResources = (BtU32)files.size();
+
+	if( numResources == 0 )
+	{
+		return BtFalse;
+	}
+
+	// The resource headers, then each file's bytes end to end as the packer lays them out
+	BtU32 headersSize = numResources * sizeof( BaResourceHeader );
+	std::vector<BtU8> memory( headersSize, 0 );
+
+	for( BtU32 i=0; i<numResources; i++ )
+	{
+		FILE *f = fopen( ( directory + files[i] ).c_str(), "rb" );
+
+		if( f == BtNull )
+		{
+			return BtFalse;
+		}
+
+		fseek( f, 0, SEEK_END );
+		BtU32 size = (BtU32)ftell( f );
+		fseek( f, 0, SEEK_SET );
+
+		BtU32 offset = (BtU32)memory.size();
+		memory.resize( offset + size );
+
+		BtU32 numRead = size ? (BtU32)fread( &memory[offset], 1, size, f ) : 0;
+		fclose( f );
+
+		if( numRead != size )
+		{
+			return BtFalse;
+		}
+
+		BaResourceHeader &header = ( (BaResourceHeader*)&memory[0] )[i];
+		BtStrCopy( header.m_szTitle, LMaxResourceName, files[i].c_str() );
+		header.m_type = BaRT_UserData;
+		header.m_nResourceID = i + 1;
+		header.m_nResourceOffset = offset;
+		header.m_nResourceSize = size;
+	}
+	return LWriteArchive( pFilename, memory, numResources, isMapped, packerVersion );
+}
@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsArchive.h
+
+#pragma once
+#include "BtTypes.h"
+#include "BaArchive.h"
+
+// Writes archives for the tests the way the packer does, but with resource headers and
+// data no loader reads. Every resource loads as a plain BaResource, so the archive can be
+// loaded and searched without a device
+// The source of the 3D scene demo's game archive, whose shaders the render tests load
+const BtChar TsDemoArchive[] = "../../3D-Demos/3DScene/3DScene/GameData/Game.Archive";
+
+class TsArchive
+{
+public:
+
+	// Writes pFilename with a resource for each title and type. Resource IDs count up from one.
+	// Each resource has resourceSize bytes of data after the headers. isMapped also writes the
+	// uncompressed variant the packer writes for the posix platforms, with its z swapped for an m.
+	// The header carries packerVersion, which decides the file data layouts resources expect
+	static BtBool						Write( const BtChar *pFilename, const BtChar **ppTitles, const BaResourceType *pTypes, BtU32 numResources,
+											   BtU32 resourceSize = 0, BtBool isMapped = BtFalse, BtU32 packerVersion = 0 );
+
+	// Writes pFilename with a user data resource for each file under pDirectory, titled with its
+	// path from there and holding its bytes, so the archive is the size and makeup of real game data
+	static BtBool						WriteDirectory( const BtChar *pFilename, const BtChar *pDirectory, BtBool isMapped = BtFalse, BtU32 packerVersion = 0 );
+};
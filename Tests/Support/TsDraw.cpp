@@ -0,0 +1,558 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsDraw.cpp
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "BaArchive.h"
+#include "BtCRC.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "MtMath.h"
+#include "RsGL.h"
+#include "RsImpl.h"
+#include "RsIndexBufferImpl.h"
+#include "RsUtil.h"
+#include "RsVertexBufferImpl.h"
+#include "SgMaterialsImpl.h"
+#include "SgMeshImpl.h"
+#include "TsArchive.h"
+#include "TsDraw.h"
+
+// Resolves every index in the file data to null
+static BaArchive g_archive;
+
+// The same, but from a packer that writes meshes' levels of detail
+static BaArchive g_lodArchive;
+
+// The vertex a scene's buffer holds
+struct LMeshVertex
+{
+	MtVector3							m_v3Position;
+	MtVector3							m_v3Normal;
+};
+
+const BtU32 NumCubeVertex = 24;
+const BtU32 NumCubeIndices = 36;
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetLodArchive
+
+// Written next to the tests and loaded the first time it's needed
+static BaArchive *LGetLodArchive()
+{
+	if( g_lodArchive.IsLoaded() == BtFalse )
+	{
+		TsArchive::Write( "TsDrawLods.z", BtNull, BtNull, 0, 0, BtFalse, BaMeshLodVersion );
+		g_lodArchive.Load( "TsDrawLods" );
+	}
+	return &g_lodArchive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadFile
+
+static BtBool LReadFile( const BtChar *pFilename, std::vector<BtChar> &text )
+{
+	FILE *f = fopen( pFilename, "rb" );
+
+	if( f == BtNull )
+	{
+		return BtFalse;
+	}
+	fseek( f, 0, SEEK_END );
+	text.resize( ftell( f ) );
+	fseek( f, 0, SEEK_SET );
+
+	BtBool isRead = ( text.size() == 0 ) || ( fread( &text[0], 1, text.size(), f ) == text.size() );
+	fclose( f );
+
+	return isRead;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeShader
+
+//static
+RsShaderImpl *TsDraw::MakeShader( const BtChar *pListFilename )
+{
+	// The shader files are named relative to the list
+	BtChar folder[256];
+	BtStrCopy( folder, 256, pListFilename );
+	BtChar *pSlash = strrchr( folder, '/' );
+	*( ( pSlash != BtNull ) ? pSlash + 1 : folder ) = 0;
+
+	FILE *f = fopen( pListFilename, "r" );
+
+	if( f == BtNull )
+	{
+		return BtNull;
+	}
+
+	// The sources follow the file data, each with a terminator, as the packer writes them
+	BaShaderFileData fileData;
+	BtMemory::Set( &fileData, 0, sizeof( BaShaderFileData ) );
+
+	std::vector<BtChar> sources;
+	BtChar name[64];
+
+	while( ( fileData.m_count < MaxShaders ) && ( fscanf( f, "%63s", name ) == 1 ) )
+	{
+		BtChar filename[320];
+		sprintf( filename, "%s%s", folder, name );
+
+		std::vector<BtChar> text;
+
+		if( LReadFile( filename, text ) == BtFalse )
+		{
+			fclose( f );
+			return BtNull;
+		}
+
+		BaShader &shader = fileData.m_shaders[fileData.m_count++];
+		BtStrCopy( shader.m_name, 32, name );
+		shader.m_offset = sizeof( BaShaderFileData ) + (BtU32)sources.size();
+		shader.m_size = (BtU32)text.size();
+
+		sources.insert( sources.end(), text.begin(), text.end() );
+		sources.push_back( 0 );
+	}
+	fclose( f );
+
+	if( fileData.m_count == 0 )
+	{
+		return BtNull;
+	}
+	fileData.m_sourceHash = BtCRC::GenerateHashCode( (const BtU8*)&sources[0], (BtU32)sources.size() );
+
+	// The instance comes first and its file data after it
+	BtU32 instanceSize = sizeof( RsShaderImpl );
+	BtU32 fileDataSize = sizeof( BaShaderFileData ) + (BtU32)sources.size();
+
+	BtU8 *pMemory = BtMemory::Allocate( BtMT_Render, instanceSize + fileDataSize );
+	BtMemory::Set( pMemory, 0, instanceSize );
+
+	RsShaderImpl *pShader = new( pMemory ) RsShaderImpl;
+
+	BtU8 *pFileData = pMemory + instanceSize;
+	BtMemory::Copy( pFileData, &fileData, sizeof( BaShaderFileData ) );
+	BtMemory::Copy( pFileData + sizeof( BaShaderFileData ), &sources[0], (BtU32)sources.size() );
+
+	pShader->FixPointers( pFileData, &g_archive );
+
+	return pShader;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeShader
+
+//static
+void TsDraw::FreeShader( RsShaderImpl *pShader )
+{
+	pShader->RemoveFromDevice();
+	BtMemory::Free( pShader );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeMaterial
+
+//static
+RsMaterialImpl *TsDraw::MakeMaterial( const BtChar *pTechniqueName, BtU32 flags )
+{
+	BtU32 instanceSize = sizeof( RsMaterialImpl );
+	BtU32 fileDataSize = sizeof( BaMaterialFileData );
+
+	BtU8 *pMemory = BtMemory::Allocate( BtMT_Render, instanceSize + fileDataSize );
+	BtMemory::Set( pMemory, 0, instanceSize + fileDataSize );
+
+	RsMaterialImpl *pMaterial = new( pMemory ) RsMaterialImpl;
+
+	BaMaterialFileData *pFileData = (BaMaterialFileData*)( pMemory + instanceSize );
+	BtStrCopy( pFileData->m_name, 64, pTechniqueName );
+	BtStrCopy( pFileData->m_techniqueName, 64, pTechniqueName );
+	pFileData->m_nFileDataSize = fileDataSize;
+	pFileData->m_diffuseColour = RsColour::WhiteColour();
+	pFileData->m_nPasses = 1;
+	pFileData->m_flags = flags;
+	pFileData->m_m4Transform.SetIdentity();
+	pFileData->m_vertexType = TsMeshVertexType;
+
+	pMaterial->FixPointers( (BtU8*)pFileData, &g_archive );
+
+	return pMaterial;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeMaterial
+
+//static
+void TsDraw::FreeMaterial( RsMaterialImpl *pMaterial )
+{
+	BtMemory::Free( pMaterial );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeScene
+
+//static
+RsSceneImpl *TsDraw::MakeScene( BtU32 numLods )
+{
+	// Each buffer is its instance followed by its file data and then its contents
+	BtU32 vertexSize = sizeof( RsVertexBufferImpl ) + sizeof( BaVertexBufferFileData ) + ( NumCubeVertex * sizeof( LMeshVertex ) );
+	BtU8 *pVertexMemory = BtMemory::Allocate( BtMT_Render, vertexSize );
+	BtMemory::Set( pVertexMemory, 0, vertexSize );
+
+	RsVertexBufferImpl *pVertexBuffer = new( pVertexMemory ) RsVertexBufferImpl;
+	BaVertexBufferFileData *pVertexData = (BaVertexBufferFileData*)( pVertexMemory + sizeof( RsVertexBufferImpl ) );
+	pVertexData->m_type = TsMeshVertexType;
+	pVertexData->m_nVertices = NumCubeVertex;
+	pVertexData->m_nStride = sizeof( LMeshVertex );
+
+	// Four corners on each face, facing out along the face's axis
+	LMeshVertex *pVertex = (LMeshVertex*)( pVertexData + 1 );
+
+	for( BtU32 iFace=0; iFace<6; iFace++ )
+	{
+		BtU32 axis = iFace >> 1;
+		BtFloat side = ( iFace & 1 ) ? 1.0f : -1.0f;
+
+		for( BtU32 iCorner=0; iCorner<4; iCorner++ )
+		{
+			BtFloat corner[3];
+			corner[axis] = side;
+			corner[( axis + 1 ) % 3] = ( iCorner & 1 ) ? 1.0f : -1.0f;
+			corner[( axis + 2 ) % 3] = ( iCorner & 2 ) ? 1.0f : -1.0f;
+
+			BtFloat normal[3] = { 0, 0, 0 };
+			normal[axis] = side;
+
+			LMeshVertex &vertex = pVertex[iFace * 4 + iCorner];
+			vertex.m_v3Position = MtVector3( corner[0], corner[1], corner[2] );
+			vertex.m_v3Normal = MtVector3( normal[0], normal[1], normal[2] );
+		}
+	}
+	pVertexBuffer->FixPointers( (BtU8*)pVertexData, &g_archive );
+
+	BtU32 indexSize = sizeof( RsIndexBufferImpl ) + sizeof( BaIndexBufferFileData ) + ( NumCubeIndices * sizeof( BtU16 ) );
+	BtU8 *pIndexMemory = BtMemory::Allocate( BtMT_Render, indexSize );
+	BtMemory::Set( pIndexMemory, 0, indexSize );
+
+	RsIndexBufferImpl *pIndexBuffer = new( pIndexMemory ) RsIndexBufferImpl;
+	BaIndexBufferFileData *pIndexData = (BaIndexBufferFileData*)( pIndexMemory + sizeof( RsIndexBufferImpl ) );
+	pIndexData->m_type = RsIndexBufferImpl::IndType_Short;
+	pIndexData->m_nIndices = NumCubeIndices;
+
+	// Two triangles a face
+	BtU16 *pIndex = (BtU16*)( pIndexData + 1 );
+
+	for( BtU32 iFace=0; iFace<6; iFace++ )
+	{
+		BtU16 first = (BtU16)( iFace * 4 );
+		const BtU16 quad[6] = { 0, 1, 2, 2, 1, 3 };
+
+		for( BtU32 i=0; i<6; i++ )
+		{
+			pIndex[iFace * 6 + i] = first + quad[i];
+		}
+	}
+	pIndexBuffer->FixPointers( (BtU8*)pIndexData, &g_archive );
+
+	// A render block for each level of detail, each with one primitive block
+	BtU32 sceneSize = sizeof( RsSceneImpl ) + sizeof( BaSceneFileData ) + ( numLods * ( sizeof( BaRenderBlockFileData ) + sizeof( RsIndexedPrimitive ) ) );
+	BtU8 *pSceneMemory = BtMemory::Allocate( BtMT_Render, sceneSize );
+	BtMemory::Set( pSceneMemory, 0, sceneSize );
+
+	RsSceneImpl *pScene = new( pSceneMemory ) RsSceneImpl;
+	BaSceneFileData *pSceneData = (BaSceneFileData*)( pSceneMemory + sizeof( RsSceneImpl ) );
+	pSceneData->m_nRenderBlocks = numLods;
+	pSceneData->m_nPrimitives = numLods;
+
+	// Any ID will do to mark the buffers there. The empty archive resolves them to null
+	pSceneData->m_nVertexBuffer[TsMeshVertexType] = 1;
+	pSceneData->m_nIndexBuffer = 1;
+
+	BaRenderBlockFileData *pRenderBlocks = (BaRenderBlockFileData*)( pSceneData + 1 );
+	RsIndexedPrimitive *pPrimitives = (RsIndexedPrimitive*)( pRenderBlocks + numLods );
+
+	for( BtU32 iLod=0; iLod<numLods; iLod++ )
+	{
+		pRenderBlocks[iLod].m_nStartPrimitiveBlock = iLod;
+		pRenderBlocks[iLod].m_nEndPrimitiveBlock = iLod + 1;
+
+		BtU32 numTriangles = MtMax( ( NumCubeIndices / 3 ) >> iLod, 1U );
+
+		RsIndexedPrimitive &primitive = pPrimitives[iLod];
+		primitive.m_primitiveType = GL_TRIANGLES;
+		primitive.m_numVertices = NumCubeVertex;
+		primitive.m_primitives = numTriangles;
+		primitive.m_numIndices = numTriangles * 3;
+		primitive.m_indexType = RsIndexBufferImpl::IndType_Short;
+	}
+
+	pScene->FixPointers( (BtU8*)pSceneData, &g_archive );
+
+	pSceneData->m_pVertexBuffer[TsMeshVertexType] = pVertexBuffer;
+	pSceneData->m_pIndexBuffer = pIndexBuffer;
+
+	// Buffers are created before the scenes that pair them, as an archive creates them
+	pVertexBuffer->CreateOnDevice();
+	pIndexBuffer->CreateOnDevice();
+	pScene->CreateOnDevice();
+
+	return pScene;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeScene
+
+//static
+void TsDraw::FreeScene( RsSceneImpl *pScene )
+{
+	RsVertexBufferImpl *pVertexBuffer = pScene->pVertexBuffer( TsMeshVertexType );
+	RsIndexBufferImpl *pIndexBuffer = pScene->pIndexBuffer();
+
+	pVertexBuffer->RemoveFromDevice();
+	pIndexBuffer->RemoveFromDevice();
+
+	BtMemory::Free( pVertexBuffer );
+	BtMemory::Free( pIndexBuffer );
+	BtMemory::Free( pScene );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeMesh
+
+//static
+SgNodeImpl *TsDraw::MakeMesh( RsSceneImpl *pScene, RsMaterialImpl **ppMaterials, BtU32 numMaterials, const MtMatrix4 &m4World,
+							  const BtFloat *pScreenSizes, BtU32 numLods )
+{
+	// The mesh and its materials follow the node, in the instance and in the file data. Any
+	// levels of detail follow the material blocks
+	BtU32 instanceSize = sizeof( SgNodeImpl ) + sizeof( SgMeshWinGL ) + sizeof( SgMaterialsWinGL );
+	BtU32 fileDataSize = sizeof( BaSgNodeFileData ) + sizeof( BaSgMeshFileData ) + sizeof( BaMaterialsFileData ) +
+						 ( numMaterials * sizeof( BaMaterialBlockFileData ) );
+
+	if( numLods )
+	{
+		fileDataSize += sizeof( BaMeshLodFileData ) + ( numMaterials * sizeof( BaMaterialLodFileData ) );
+	}
+
+	BtU8 *pMemory = BtMemory::Allocate( BtMT_SceneGraph, instanceSize + fileDataSize );
+	BtMemory::Set( pMemory, 0, instanceSize + fileDataSize );
+
+	SgNodeImpl *pNode = new( pMemory ) SgNodeImpl;
+
+	BtU8 *pFileData = pMemory + instanceSize;
+	BaSgNodeFileData *pNodeData = (BaSgNodeFileData*)pFileData;
+	pNodeData->m_nodeType = SgType_Node | SgType_Mesh | SgType_Materials;
+	BtStrCopy( pNodeData->m_name, MaxSceneNodeName, "mesh" );
+	pNodeData->m_nFileDataSize = fileDataSize;
+	pNodeData->m_renderFlags = RsRF_Visible;
+	pNodeData->m_m4Local = m4World;
+	pNodeData->m_m4World = m4World;
+
+	BaSgMeshFileData *pMeshData = (BaSgMeshFileData*)( pNodeData + 1 );
+	pMeshData->m_AABB = MtAABB( MtVector3( -1.0f, -1.0f, -1.0f ), MtVector3( 1.0f, 1.0f, 1.0f ) );
+	pMeshData->m_sphere = MtSphere( MtVector3( 0, 0, 0 ), 1.732f );
+	pMeshData->m_nMaterials = numMaterials;
+
+	BaMaterialsFileData *pMaterialsData = (BaMaterialsFileData*)( pMeshData + 1 );
+	pMaterialsData->m_nMaterials = numMaterials;
+
+	BaMaterialBlockFileData *pMaterialBlocks = (BaMaterialBlockFileData*)( pMaterialsData + 1 );
+
+	for( BtU32 i=0; i<numMaterials; i++ )
+	{
+		pMaterialBlocks[i].m_nStartRenderBlock = 0;
+		pMaterialBlocks[i].m_nEndRenderBlock = 1;
+	}
+
+	if( numLods == 0 )
+	{
+		pNode->FixPointers( pFileData, &g_archive );
+	}
+	else
+	{
+		BaMeshLodFileData *pLodData = (BaMeshLodFileData*)( pMaterialBlocks + numMaterials );
+		pLodData->m_numLods = numLods;
+
+		for( BtU32 iLod=0; iLod<numLods; iLod++ )
+		{
+			pLodData->m_screenSize[iLod] = pScreenSizes[iLod];
+		}
+
+		BaMaterialLodFileData *pMaterialLods = (BaMaterialLodFileData*)( pLodData + 1 );
+
+		for( BtU32 i=0; i<numMaterials; i++ )
+		{
+			for( BtU32 iLod=0; iLod<numLods; iLod++ )
+			{
+				pMaterialLods[i].m_nStartRenderBlock[iLod] = iLod;
+				pMaterialLods[i].m_nEndRenderBlock[iLod] = iLod + 1;
+			}
+		}
+
+		pNode->FixPointers( pFileData, LGetLodArchive() );
+	}
+
+	// Point at what the empty archive couldn't find
+	pNodeData->m_pScene = pScene;
+
+	for( BtU32 i=0; i<numMaterials; i++ )
+	{
+		pMaterialBlocks[i].m_pMaterial = ppMaterials[i];
+	}
+
+	return pNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeMesh
+
+//static
+void TsDraw::FreeMesh( SgNodeImpl *pNode )
+{
+	pNode->Destroy();
+	BtMemory::Free( pNode );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetCamera
+
+//static
+RsCamera TsDraw::GetCamera()
+{
+	RsCamera camera( 0.1f, 1000.0f, 800.0f / 600.0f, RsViewport( 0, 0, 800, 600 ), MtDegreesToRadians( 60.0f ) );
+	camera.Update();
+
+	return camera;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BeginFrame
+
+//static
+RsRenderTarget *TsDraw::BeginFrame( RsShaderImpl *pShader )
+{
+	return BeginFrame( pShader, GetCamera() );
+}
+
+//static
+RsRenderTarget *TsDraw::BeginFrame( RsShaderImpl *pShader, const RsCamera &camera )
+{
+	RsUtil::EmptyRenderTargets();
+
+	RsRenderTarget *pRenderTarget = RsUtil::GetNewRenderTarget();
+	pRenderTarget->SetCamera( camera );
+	pRenderTarget->SetCleared( BtTrue );
+	pRenderTarget->SetZCleared( BtTrue );
+	pRenderTarget->Apply();
+
+	// RsShaderImpl declares an Apply it doesn't define. The base's makes it current
+	( (RsShader*)pShader )->Apply();
+
+	return pRenderTarget;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EndFrame
+
+//static
+void TsDraw::EndFrame()
+{
+	RsImpl::pInstance()->Render();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DrawFrame
+
+//static
+BtU32 TsDraw::DrawFrame( RsShaderImpl *pShader, const RsCamera &camera, SgNodeImpl *pNode )
+{
+	BeginFrame( pShader, camera );
+	pNode->Render();
+	EndFrame();
+
+	return RsGL::GetFrameStats().m_numVertices / 3;
+}
+
+//static
+BtU32 TsDraw::DrawFrame( RsShaderImpl *pShader, const RsCamera &camera, const std::vector<SgNodeImpl*> &nodes )
+{
+	BeginFrame( pShader, camera );
+
+	for( BtU32 i=0; i<nodes.size(); i++ )
+	{
+		nodes[i]->Render();
+	}
+	EndFrame();
+
+	return RsGL::GetFrameStats().m_numVertices / 3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CaptureFrame
+
+//static
+void TsDraw::CaptureFrame()
+{
+	RsGL::InvalidateState();
+
+	RsGL::BeginCapture();
+	RsImpl::pInstance()->Render();
+	RsGL::EndCapture();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetDrawCalls
+
+//static
+void TsDraw::GetDrawCalls( std::vector<TsDrawCall> &drawCalls )
+{
+	drawCalls.clear();
+
+	GLuint buffer = 0;
+	BtU32 offset = 0;
+	BtU32 stride = 0;
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		const RsGLCommand &command = RsGL::GetCommand( i );
+
+		if( ( command.m_type == RsGLCommand_BindBuffer ) && ( command.m_args[0] == GL_ARRAY_BUFFER ) )
+		{
+			buffer = command.m_args[1];
+		}
+		else if( ( command.m_type == RsGLCommand_VertexAttribPointer ) && ( command.m_args[0] == 0 ) )
+		{
+			stride = command.m_args[2];
+			offset = command.m_args[3];
+		}
+		else if( command.m_type == RsGLCommand_DrawArrays )
+		{
+			BtU32 size;
+			const BtU8 *pData = RsGL::GetBufferData( buffer, size );
+
+			drawCalls.push_back( TsDrawCall() );
+			TsDrawCall &drawCall = drawCalls.back();
+			drawCall.m_mode = command.m_args[0];
+			drawCall.m_vertex.resize( command.m_args[1] );
+
+			for( BtU32 iVertex=0; iVertex<command.m_args[1]; iVertex++ )
+			{
+				BtU32 at = offset + ( command.m_args[2] + iVertex ) * stride;
+				RsVertex3 &vertex = drawCall.m_vertex[iVertex];
+
+				if( ( pData != BtNull ) && ( stride == sizeof( RsVertex3 ) ) && ( at + sizeof( RsVertex3 ) <= size ) )
+				{
+					BtMemory::Copy( &vertex, pData + at, sizeof( RsVertex3 ) );
+				}
+				else
+				{
+					BtMemory::Set( &vertex, 0xFF, sizeof( RsVertex3 ) );
+				}
+			}
+		}
+	}
+}
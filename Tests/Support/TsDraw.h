@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsDraw.h
+
+#pragma once
+#include <vector>
+#include "BtTypes.h"
+#include "RsCamera.h"
+#include "RsMaterialImpl.h"
+#include "RsRenderTarget.h"
+#include "RsSceneImpl.h"
+#include "RsShaderImpl.h"
+#include "SgNodeImpl.h"
+
+// The shaders the demos ship for desktop GL, relative to the build folder the tests run in
+const BtChar TsShaderList[] = "../../3D-Demos/3DScene/3DScene/GameData/Game.Archive/Shaders/shader.wingl";
+
+// Meshes draw from the vertex buffer of their material's vertex type. The materials and
+// scenes made here all use this one
+const BtU32 TsMeshVertexType = VT_Position | VT_Normal;
+
+// A draw read back from a command capture
+struct TsDrawCall
+{
+	BtU32								m_mode;
+	std::vector<RsVertex3>				m_vertex;
+};
+
+// Draws through the GL render system with real shaders and materials but no archive, so
+// a test on the null backend can capture what reaches the device. The shader and
+// materials are laid out in memory the way an archive lays them out and are fixed up
+// against an empty archive
+class TsDraw
+{
+public:
+
+	// A shader built from a list of vertex and fragment shader pairs, in program order. The
+	// files are found next to the list. The program cache is keyed on the archive, so turn
+	// it off with RsShaderImpl::SetProgramCache first
+	static RsShaderImpl				   *MakeShader( const BtChar *pListFilename = TsShaderList );
+	static void							FreeShader( RsShaderImpl *pShader );
+
+	// An untextured white material drawn with the named technique
+	static RsMaterialImpl			   *MakeMaterial( const BtChar *pTechniqueName, BtU32 flags = 0 );
+	static void							FreeMaterial( RsMaterialImpl *pMaterial );
+
+	// The indexed triangles of a unit cube around the origin, on the device. Each level of
+	// detail after the first is another render block drawing half the triangles of the one
+	// before, so a cube with four draws 12, 6, 3 and then 1
+	static RsSceneImpl				   *MakeScene( BtU32 numLods = 1 );
+	static void							FreeScene( RsSceneImpl *pScene );
+
+	// A mesh node drawing the scene with a material block for each material. It has the
+	// bounds of the cube and no parent or children. Given screen sizes, it has that many
+	// levels of detail, each drawing the render block of the same index, and is fixed up
+	// against an archive new enough to read them. That archive is written and loaded in the
+	// working folder, so ApConfig needs the resource path and extension set first
+	static SgNodeImpl				   *MakeMesh( RsSceneImpl *pScene, RsMaterialImpl **ppMaterials, BtU32 numMaterials, const MtMatrix4 &m4World,
+												  const BtFloat *pScreenSizes = BtNull, BtU32 numLods = 0 );
+	static void							FreeMesh( SgNodeImpl *pNode );
+
+	// A perspective camera at the origin looking down z into an 800x600 viewport
+	static RsCamera						GetCamera();
+
+	// Starts a frame with one render target seen through the camera and the shader current.
+	// Draw into it and call EndFrame to render everything to the device
+	static RsRenderTarget			   *BeginFrame( RsShaderImpl *pShader );
+	static RsRenderTarget			   *BeginFrame( RsShaderImpl *pShader, const RsCamera &camera );
+	static void							EndFrame();
+
+	// A whole frame of the nodes seen through the camera. Returns the triangles that reached
+	// the device, and RsGL::GetFrameStats has the rest
+	static BtU32						DrawFrame( RsShaderImpl *pShader, const RsCamera &camera, SgNodeImpl *pNode );
+	static BtU32						DrawFrame( RsShaderImpl *pShader, const RsCamera &camera, const std::vector<SgNodeImpl*> &nodes );
+
+	// Ends the frame with its commands captured. The state cache is invalidated first so the
+	// capture has every bind the draws rely on
+	static void							CaptureFrame();
+
+	// The draws in the capture, with the vertices each read from the buffer bound and the
+	// offset given to the position attribute when it was drawn. Vertices the buffer doesn't
+	// hold are filled with 0xFF. Only draws of RsVertex3 through DrawArrays are read
+	static void							GetDrawCalls( std::vector<TsDrawCall> &drawCalls );
+};
@@ -0,0 +1,430 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsNullGL.cpp
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "TsNullGL.h"
+
+const BtU32 MaxUniformName = 64;
+
+// Names nothing declares have no location, as on a device
+struct LUniform
+{
+	GLchar								m_name[MaxUniformName];
+	GLenum								m_type;
+	GLint								m_size;
+	GLint								m_location;
+};
+
+// A shader or a program, indexed by name
+struct LObject
+{
+	std::string							m_source;
+	std::vector<GLuint>					m_shaders;
+	std::vector<LUniform>				m_uniforms;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LSkipSpace
+
+// Skips white space and comments
+static const GLchar* LSkipSpace( const GLchar* pText )
+{
+	while( *pText )
+	{
+		if( ( pText[0] == '/' ) && ( pText[1] == '/' ) )
+		{
+			while( *pText && ( *pText != '\n' ) )
+			{
+				++pText;
+			}
+		}
+		else if( ( pText[0] == '/' ) && ( pText[1] == '*' ) )
+		{
+			const GLchar* pEnd = strstr( pText + 2, "*/" );
+			pText = ( pEnd != BtNull ) ? pEnd + 2 : pText + strlen( pText );
+		}
+		else if( ( *pText == ' ' ) || ( *pText == '\t' ) || ( *pText == '\r' ) || ( *pText == '\n' ) )
+		{
+			++pText;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return pText;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadWord
+
+// Reads an identifier or number into pWord, which is empty if there isn't one
+static const GLchar* LReadWord( const GLchar* pText, GLchar* pWord, BtU32 size )
+{
+	pText = LSkipSpace( pText );
+
+	BtU32 length = 0;
+
+	while( ( ( *pText >= 'a' ) && ( *pText <= 'z' ) ) || ( ( *pText >= 'A' ) && ( *pText <= 'Z' ) ) ||
+		   ( ( *pText >= '0' ) && ( *pText <= '9' ) ) || ( *pText == '_' ) )
+	{
+		if( length + 1 < size )
+		{
+			pWord[length++] = *pText;
+		}
+		++pText;
+	}
+	pWord[length] = 0;
+
+	return pText;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetUniformType
+
+static GLenum LGetUniformType( const GLchar* pType )
+{
+	struct LUniformType
+	{
+		const GLchar*					m_name;
+		GLenum							m_type;
+	};
+
+	static const LUniformType types[] =
+	{
+		{ "float",		GL_FLOAT },
+		{ "vec2",		GL_FLOAT_VEC2 },
+		{ "vec3",		GL_FLOAT_VEC3 },
+		{ "vec4",		GL_FLOAT_VEC4 },
+		{ "mat2",		GL_FLOAT_MAT2 },
+		{ "mat3",		GL_FLOAT_MAT3 },
+		{ "mat4",		GL_FLOAT_MAT4 },
+		{ "int",		GL_INT },
+		{ "bool",		GL_BOOL },
+		{ "sampler2D",	GL_SAMPLER_2D },
+		{ "samplerCube",GL_SAMPLER_CUBE },
+	};
+
+	for( BtU32 i=0; i<sizeof( types ) / sizeof( types[0] ); i++ )
+	{
+		if( strcmp( types[i].m_name, pType ) == 0 )
+		{
+			return types[i].m_type;
+		}
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReflection
+
+class LReflection : public RsGLNullReflection
+{
+public:
+
+	LReflection() : m_nextLocation( 0 ) {}
+
+	void								ShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length );
+	void								AttachShader( GLuint program, GLuint shader );
+	void								LinkProgram( GLuint program );
+	GLint								GetNumUniforms( GLuint program );
+	void								GetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name );
+	GLint								GetUniformLocation( GLuint program, const GLchar* name );
+	GLsizei								GetProgramBinaryLength( GLuint program );
+	GLsizei								GetProgramBinary( GLuint program, GLsizei bufSize, void* binary );
+	void								ProgramBinary( GLuint program, const void* binary, GLsizei length );
+
+private:
+
+	LObject&							GetObject( GLuint name );
+	void								AddUniform( LObject &program, const GLchar* pName, GLenum type, GLint size );
+	void								ParseUniforms( LObject &program, const GLchar* pSource );
+
+	std::vector<LObject>				m_objects;
+	GLint								m_nextLocation;
+};
+
+static LReflection g_reflection;
+
+////////////////////////////////////////////////////////////////////////////////
+// GetObject
+
+LObject& LReflection::GetObject( GLuint name )
+{
+	if( name >= m_objects.size() )
+	{
+		m_objects.resize( name + 1 );
+	}
+	return m_objects[name];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AddUniform
+
+void LReflection::AddUniform( LObject &program, const GLchar* pName, GLenum type, GLint size )
+{
+	// Both stages may declare the same uniform
+	for( BtU32 i=0; i<program.m_uniforms.size(); i++ )
+	{
+		if( strcmp( program.m_uniforms[i].m_name, pName ) == 0 )
+		{
+			return;
+		}
+	}
+
+	LUniform uniform;
+	strncpy( uniform.m_name, pName, MaxUniformName - 1 );
+	uniform.m_name[MaxUniformName - 1] = 0;
+	uniform.m_type = type;
+	uniform.m_size = size;
+	uniform.m_location = ++m_nextLocation;
+
+	program.m_uniforms.push_back( uniform );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ParseUniforms
+
+// Adds the uniforms a shader declares to the program, as "uniform [precision] type
+// name[size], name ...;". Arrays are named by their first element, as GL names them
+void LReflection::ParseUniforms( LObject &program, const GLchar* pSource )
+{
+	GLchar word[MaxUniformName];
+	const GLchar* pText = pSource;
+
+	while( *( pText = LSkipSpace( pText ) ) )
+	{
+		const GLchar* pNext = LReadWord( pText, word, MaxUniformName );
+
+		if( pNext == pText )
+		{
+			++pText;
+			continue;
+		}
+		pText = pNext;
+
+		if( strcmp( word, "uniform" ) != 0 )
+		{
+			continue;
+		}
+
+		pText = LReadWord( pText, word, MaxUniformName );
+
+		if( ( strcmp( word, "lowp" ) == 0 ) || ( strcmp( word, "mediump" ) == 0 ) || ( strcmp( word, "highp" ) == 0 ) )
+		{
+			pText = LReadWord( pText, word, MaxUniformName );
+		}
+
+		GLenum type = LGetUniformType( word );
+
+		while( type != 0 )
+		{
+			GLchar name[MaxUniformName];
+			pText = LReadWord( pText, name, MaxUniformName - 3 );
+			pText = LSkipSpace( pText );
+
+			if( name[0] == 0 )
+			{
+				break;
+			}
+
+			GLint size = 1;
+
+			if( *pText == '[' )
+			{
+				pText = LReadWord( pText + 1, word, MaxUniformName );
+				size = atoi( word );
+				pText = LSkipSpace( pText );
+
+				if( *pText == ']' )
+				{
+					++pText;
+				}
+				strcat( name, "[0]" );
+			}
+			AddUniform( program, name, type, size );
+
+			pText = LSkipSpace( pText );
+
+			if( *pText != ',' )
+			{
+				break;
+			}
+			++pText;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ShaderSource
+
+void LReflection::ShaderSource( GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length )
+{
+	// Join the strings into one source, each with the length given or up to its terminator
+	LObject &object = GetObject( shader );
+	object.m_source.clear();
+
+	for( GLsizei i=0; i<count; i++ )
+	{
+		if( ( length != BtNull ) && ( length[i] >= 0 ) )
+		{
+			object.m_source.append( string[i], length[i] );
+		}
+		else
+		{
+			object.m_source.append( string[i] );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AttachShader
+
+void LReflection::AttachShader( GLuint program, GLuint shader )
+{
+	GetObject( program ).m_shaders.push_back( shader );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LinkProgram
+
+void LReflection::LinkProgram( GLuint program )
+{
+	GetObject( program ).m_uniforms.clear();
+
+	for( BtU32 i=0; i<GetObject( program ).m_shaders.size(); i++ )
+	{
+		// Copy the source as looking the program up again may move the objects
+		std::string source = GetObject( GetObject( program ).m_shaders[i] ).m_source;
+		ParseUniforms( GetObject( program ), source.c_str() );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNumUniforms
+
+GLint LReflection::GetNumUniforms( GLuint program )
+{
+	return (GLint)GetObject( program ).m_uniforms.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetActiveUniform
+
+void LReflection::GetActiveUniform( GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name )
+{
+	const LObject &object = GetObject( program );
+
+	if( index >= object.m_uniforms.size() )
+	{
+		if( length != BtNull )
+		{
+			*length = 0;
+		}
+		if( ( name != BtNull ) && ( bufSize > 0 ) )
+		{
+			name[0] = 0;
+		}
+		*size = 0;
+		*type = 0;
+		return;
+	}
+
+	const LUniform &uniform = object.m_uniforms[index];
+	GLsizei nameLength = (GLsizei)strlen( uniform.m_name );
+
+	if( nameLength >= bufSize )
+	{
+		nameLength = bufSize - 1;
+	}
+	BtMemory::Copy( name, uniform.m_name, nameLength );
+	name[nameLength] = 0;
+
+	if( length != BtNull )
+	{
+		*length = nameLength;
+	}
+	*size = uniform.m_size;
+	*type = uniform.m_type;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetUniformLocation
+
+GLint LReflection::GetUniformLocation( GLuint program, const GLchar* name )
+{
+	const LObject &object = GetObject( program );
+	size_t length = strlen( name );
+
+	// Arrays are found by their name alone or by their first element
+	for( BtU32 i=0; i<object.m_uniforms.size(); i++ )
+	{
+		const GLchar* pUniform = object.m_uniforms[i].m_name;
+
+		if( ( strcmp( pUniform, name ) == 0 ) ||
+			( ( strncmp( pUniform, name, length ) == 0 ) && ( strcmp( pUniform + length, "[0]" ) == 0 ) ) )
+		{
+			return object.m_uniforms[i].m_location;
+		}
+	}
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramBinaryLength
+
+GLsizei LReflection::GetProgramBinaryLength( GLuint program )
+{
+	return (GLsizei)( GetObject( program ).m_uniforms.size() * sizeof( LUniform ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetProgramBinary
+
+// The binary is the program's uniforms
+GLsizei LReflection::GetProgramBinary( GLuint program, GLsizei bufSize, void* binary )
+{
+	GLsizei size = GetProgramBinaryLength( program );
+
+	if( size > bufSize )
+	{
+		return 0;
+	}
+	if( size > 0 )
+	{
+		BtMemory::Copy( binary, &GetObject( program ).m_uniforms[0], size );
+	}
+	return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ProgramBinary
+
+// Takes back the uniforms GetProgramBinary wrote, with new locations
+void LReflection::ProgramBinary( GLuint program, const void* binary, GLsizei length )
+{
+	LObject &object = GetObject( program );
+	object.m_uniforms.clear();
+
+	const LUniform* pUniforms = (const LUniform*)binary;
+
+	for( BtU32 i=0; i<(BtU32)length / sizeof( LUniform ); i++ )
+	{
+		AddUniform( object, pUniforms[i].m_name, pUniforms[i].m_type, pUniforms[i].m_size );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Use
+
+//static
+void TsNullGL::Use()
+{
+	RsGL::SetBackend( RsBackend_Null );
+	RsGL::SetNullReflection( &g_reflection );
+}
@@ -0,0 +1,16 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsNullGL.h
+
+#pragma once
+#include "BtTypes.h"
+
+// The null backend with uniform reflection, so programs report the uniforms their shaders
+// declare and the render system finds them as it would on a device. A driver only reports
+// the ones a program uses, so this may report more. Uniform blocks aren't reported
+class TsNullGL
+{
+public:
+
+	// Call instead of RsGL::SetBackend( RsBackend_Null ), before the render system is created
+	static void							Use();
+};
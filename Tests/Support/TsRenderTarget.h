@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsRenderTarget.h
+
+#pragma once
+#include <vector>
+#include "RsRenderTargetImpl.h"
+
+// A render target that reports the renderables added to it, in the order they'll be drawn
+class TsRenderTarget : public RsRenderTargetWinGL
+{
+public:
+
+	void								GetMeshes( BtU32 sortOrder, std::vector<const SgMeshRenderable*> &meshes );
+	void								GetSprites( BtU32 sortOrder, std::vector<const RsSpriteRenderable*> &sprites );
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// GetMeshes
+
+inline void TsRenderTarget::GetMeshes( BtU32 sortOrder, std::vector<const SgMeshRenderable*> &meshes )
+{
+	meshes.clear();
+
+	for( const SgMeshRenderable *pMesh = m_nodes[sortOrder].pHead(); pMesh != BtNull; pMesh = pMesh->pNext() )
+	{
+		meshes.push_back( pMesh );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetSprites
+
+inline void TsRenderTarget::GetSprites( BtU32 sortOrder, std::vector<const RsSpriteRenderable*> &sprites )
+{
+	sprites.clear();
+
+	for( const RsSpriteRenderable *pSprite = m_sprites[sortOrder].pHead(); pSprite != BtNull; pSprite = pSprite->pNext() )
+	{
+		sprites.push_back( pSprite );
+	}
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsRenderer.cpp
+
+#include "BtMemory.h"
+#include "TsRenderer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeWorld
+
+// A world matrix that can only belong to this index
+static void LMakeWorld( MtMatrix4 &m4World, BtU32 index )
+{
+	m4World.SetIdentity();
+	m4World._30 = (BtFloat)index;
+	m4World._31 = (BtFloat)( index * 2 );
+	m4World._32 = (BtFloat)( index * 3 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BeginScene
+
+void TsRenderer::BeginScene()
+{
+	RsImpl::BeginScene();
+
+	m_renderables.clear();
+	m_numWrong = 0;
+	m_numRendered = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AddRenderable
+
+TsRenderable *TsRenderer::AddRenderable( BtU32 index )
+{
+	TsRenderable *pRenderable = (TsRenderable*)AllocateGraphicsMemory( sizeof( TsRenderable ) );
+	RsPrimitive *pPrimitive = (RsPrimitive*)AllocateGraphicsMemory( sizeof( RsPrimitive ) );
+
+	LMakeWorld( pRenderable->m_m4World, index );
+	pRenderable->m_pPrimitive = pPrimitive;
+	pRenderable->m_index = index;
+
+	pPrimitive->m_primitiveType = 4;
+	pPrimitive->m_numVertex = 3;
+	pPrimitive->m_nStartVertex = index * 3;
+	pPrimitive->m_indexType = 0;
+
+	m_renderables.push_back( pRenderable );
+
+	return pRenderable;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Render
+
+void TsRenderer::Render()
+{
+	for( BtU32 i=0; i<m_renderables.size(); i++ )
+	{
+		const TsRenderable *pRenderable = m_renderables[i];
+
+		MtMatrix4 m4World;
+		LMakeWorld( m4World, i );
+
+		BtBool isRight = ( ( (size_t)pRenderable & 15 ) == 0 ) &&
+						 ( pRenderable->m_index == i ) &&
+						 ( BtMemory::Compare( &pRenderable->m_m4World, &m4World, sizeof( MtMatrix4 ) ) == BtTrue ) &&
+						 ( pRenderable->m_pPrimitive->m_numVertex == 3 ) &&
+						 ( pRenderable->m_pPrimitive->m_nStartVertex == i * 3 );
+
+		if( isRight == BtFalse )
+		{
+			++m_numWrong;
+		}
+		++m_numRendered;
+	}
+}
@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsRenderer.h
+
+#pragma once
+#include <vector>
+#include "RsImpl.h"
+#include "RsPrimitive.h"
+#include "MtMatrix4.h"
+
+// A renderable the size of a mesh renderable, with its primitive
+struct TsRenderable
+{
+	MtMatrix4							m_m4World;
+	RsPrimitive						   *m_pPrimitive;
+	BtU32								m_index;
+};
+
+// A renderer with no device. Renderables come from the graphics heap like those of the
+// real renderers, and Render checks each one still holds what was written into it
+class TsRenderer : public RsImpl
+{
+public:
+
+	TsRenderer() : m_numWrong( 0 ), m_numRendered( 0 ) {}
+
+	void							   *GetHandle() { return BtNull; }
+	RsRenderTarget					   *GetNewRenderTarget() { return BtNull; }
+	void								EmptyRenderTargets() {}
+	RsCaps							   *GetCaps() { return BtNull; }
+
+	void								BeginScene();
+	void								Render();
+
+	// Adds a renderable and its primitive for the given index
+	TsRenderable					   *AddRenderable( BtU32 index );
+
+	// Renderables Render found wrong or not aligned for their matrices
+	BtU32								GetNumWrong() const { return m_numWrong; }
+	BtU32								GetNumRendered() const { return m_numRendered; }
+
+private:
+
+	std::vector<TsRenderable*>			m_renderables;
+	BtU32								m_numWrong;
+	BtU32								m_numRendered;
+};
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsScene.cpp
+
+#include <new>
+#include <stdio.h>
+#include "BaArchive.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "SgSkinImpl.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+// Resolves every index in the file data to null
+static BaArchive g_archive;
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeNode
+
+//static
+SgNodeImpl *TsScene::MakeNode( const BtChar *pName, const MtMatrix4 &m4Local, BtBool isMesh, BtBool isSkin )
+{
+	BtU32 instanceSize = SgNodeImpl::GetInstanceSize( BtNull );
+	BtU32 fileDataSize = sizeof( BaSgNodeFileData ) + ( ( isMesh == BtTrue ) ? sizeof( BaSgMeshFileData ) : 0 );
+
+	// The skin follows the mesh in both
+	if( isSkin == BtTrue )
+	{
+		instanceSize += sizeof( SgSkinImpl );
+		fileDataSize += sizeof( BaSgSkinFileData );
+	}
+
+	// The instance comes first and its file data after it, as GetDuplicate makes them
+	BtU8 *pMemory = BtMemory::Allocate( BtMT_SceneGraph, instanceSize + fileDataSize );
+	BtMemory::Set( pMemory, 0, instanceSize + fileDataSize );
+
+	SgNodeImpl *pNode = new( pMemory ) SgNodeImpl;
+
+	BtU8 *pFileData = pMemory + instanceSize;
+	BaSgNodeFileData *pNodeData = (BaSgNodeFileData*)pFileData;
+
+	pNodeData->m_nodeType = SgType_Node;
+	BtStrCopy( pNodeData->m_name, MaxSceneNodeName, pName );
+	pNodeData->m_nFileDataSize = fileDataSize;
+	pNodeData->m_renderFlags = RsRF_Visible;
+	pNodeData->m_m4Local = m4Local;
+	pNodeData->m_m4World = m4Local;
+
+	if( isMesh == BtTrue )
+	{
+		pNodeData->m_nodeType |= SgType_Mesh;
+
+		BaSgMeshFileData *pMeshData = (BaSgMeshFileData*)( pFileData + sizeof( BaSgNodeFileData ) );
+		pMeshData->m_AABB = MtAABB( MtVector3( -1.0f, -1.0f, -1.0f ), MtVector3( 1.0f, 1.0f, 1.0f ) );
+		pMeshData->m_sphere = MtSphere( MtVector3( 0, 0, 0 ), 1.732f );
+	}
+
+	if( isSkin == BtTrue )
+	{
+		pNodeData->m_nodeType |= SgType_Skin;
+	}
+
+	pNode->FixPointers( pFileData, &g_archive );
+
+	return pNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RandomLocal
+
+//static
+MtMatrix4 TsScene::RandomLocal( BtFloat spread, BtFloat height, BtBool isTilted )
+{
+	MtMatrix4 m4RotationX;
+	m4RotationX.SetIdentity();
+
+	if( isTilted == BtTrue )
+	{
+		m4RotationX.SetRotationX( TsTest::Random( -3.0f, 3.0f ) );
+	}
+
+	MtMatrix4 m4RotationY;
+	m4RotationY.SetRotationY( TsTest::Random( -3.0f, 3.0f ) );
+
+	MtMatrix4 m4Translation;
+	m4Translation.SetTranslation( TsTest::Random( -spread, spread ), TsTest::Random( -height, height ), TsTest::Random( -spread, spread ) );
+
+	// SetTranslation starts from the identity so it goes on last
+	return m4RotationX * m4RotationY * m4Translation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LAddNode
+
+static SgNodeImpl *LAddNode( SgNodeImpl *pParent, const BtChar *pName, std::vector<SgNodeImpl*> &nodes )
+{
+	MtMatrix4 m4Local;
+	m4Local.SetTranslation( 0.0f, 1.0f, 0.0f );
+
+	SgNodeImpl *pNode = TsScene::MakeNode( pName, m4Local );
+	pParent->AddChild( pNode );
+	nodes.push_back( pNode );
+
+	return pNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MakeRig
+
+//static
+SgNodeImpl *TsScene::MakeRig( BtU32 numNodes, std::vector<SgNodeImpl*> &nodes )
+{
+	const BtChar *pSides[] = { "L", "R", "C" };
+	const BtChar *pLimbs[] = { "arm", "leg", "tail", "wing" };
+	const BtU32 SpineLength = 10;
+
+	BtChar name[MaxSceneNodeName];
+
+	MtMatrix4 m4Identity;
+	m4Identity.SetIdentity();
+
+	SgNodeImpl *pRoot = MakeNode( "root", m4Identity );
+	nodes.push_back( pRoot );
+
+	SgNodeImpl *pSpine = pRoot;
+
+	for( BtU32 i=0; i<SpineLength; i++ )
+	{
+		sprintf( name, "spine_%d", i );
+		pSpine = LAddNode( pSpine, name, nodes );
+	}
+
+	for( BtU32 iSide=0; iSide<3; iSide++ )
+	{
+		for( BtU32 iLimb=0; iLimb<4; iLimb++ )
+		{
+			// Limbs come off the spine from its first node on
+			SgNodeImpl *pLimb = nodes[1 + ( iSide * 4 + iLimb ) % SpineLength];
+
+			for( BtU32 i=0; i<4; i++ )
+			{
+				sprintf( name, "%s_%s_%d", pSides[iSide], pLimbs[iLimb], i );
+				pLimb = LAddNode( pLimb, name, nodes );
+			}
+
+			for( BtU32 iDigit=0; iDigit<5; iDigit++ )
+			{
+				SgNodeImpl *pDigit = pLimb;
+
+				for( BtU32 i=0; i<3; i++ )
+				{
+					sprintf( name, "%s_%s_digit%d_%d", pSides[iSide], pLimbs[iLimb], iDigit, i );
+					pDigit = LAddNode( pDigit, name, nodes );
+				}
+				LAddNode( pDigit, "tip", nodes );
+			}
+			LAddNode( pLimb, "attach", nodes );
+		}
+	}
+
+	// Props hang from nodes spread over the rig
+	while( nodes.size() < numNodes )
+	{
+		BtU32 index = (BtU32)nodes.size();
+
+		if( index % 7 == 0 )
+		{
+			sprintf( name, "prop" );
+		}
+		else
+		{
+			sprintf( name, "prop_%d", index );
+		}
+		BtU32 parent = ( ( index * 2654435761u ) >> 8 ) % index;
+		LAddNode( nodes[parent], name, nodes );
+	}
+
+	return pRoot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FreeNodes
+
+//static
+void TsScene::FreeNodes( SgNodeImpl *pNode )
+{
+	// A root's hierarchy lets go of the nodes below it, so destroy it while they are there
+	pNode->Destroy();
+
+	SgNodeImpl *pChild = (SgNodeImpl*)pNode->pFirstChild();
+
+	while( pChild != BtNull )
+	{
+		SgNodeImpl *pNext = (SgNodeImpl*)pChild->pNextSibling();
+		FreeNodes( pChild );
+		pChild = pNext;
+	}
+
+	BtMemory::Free( pNode );
+}
@@ -0,0 +1,32 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsScene.h
+
+#pragma once
+#include <vector>
+#include "BtTypes.h"
+#include "MtMatrix4.h"
+#include "SgNodeImpl.h"
+
+// Makes scene nodes without an archive file. Each is laid out in memory the way an archive
+// lays out a node and is fixed up against an empty archive, so it has no parent, children
+// or scene until it is added to another node
+class TsScene
+{
+public:
+
+	// A plain node, or a mesh with the bounds of a unit cube around its origin. A skinned
+	// mesh also has a skin with no joints
+	static SgNodeImpl				   *MakeNode( const BtChar *pName, const MtMatrix4 &m4Local, BtBool isMesh = BtFalse, BtBool isSkin = BtFalse );
+
+	// A local transform from TsTest's numbers. It turns about y, and about x too when tilted,
+	// then moves up to spread along x and z and up to height along y
+	static MtMatrix4					RandomLocal( BtFloat spread, BtFloat height, BtBool isTilted = BtFalse );
+
+	// A character rig of numNodes nodes, the root first. A spine has limbs with digits, and
+	// props hang from nodes all over it. Every digit ends in a node named "tip", each limb
+	// has one named "attach" and every seventh prop is named "prop"
+	static SgNodeImpl				   *MakeRig( BtU32 numNodes, std::vector<SgNodeImpl*> &nodes );
+
+	// Destroys the node and everything below it
+	static void							FreeNodes( SgNodeImpl *pNode );
+};
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsTest.cpp
+
+#include "TsTest.h"
+
+BtU32 TsTest::m_numChecks = 0;
+BtU32 TsTest::m_numFailed = 0;
+BtU32 TsTest::m_seed = 1;
+
+////////////////////////////////////////////////////////////////////////////////
+// Check
+
+void TsTest::Check( BtBool isPassed, const BtChar *pCondition, const BtChar *pFile, BtU32 line )
+{
+	++m_numChecks;
+
+	if( isPassed == BtFalse )
+	{
+		++m_numFailed;
+		printf( "%s(%d): Failed %s\n", pFile, line, pCondition );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Finish
+
+int TsTest::Finish( const BtChar *pName )
+{
+	if( m_numFailed > 0 )
+	{
+		printf( "%s: %d of %d checks failed\n", pName, m_numFailed, m_numChecks );
+		return 1;
+	}
+	printf( "%s: %d checks passed\n", pName, m_numChecks );
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SetSeed
+
+void TsTest::SetSeed( BtU32 seed )
+{
+	m_seed = seed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Random
+
+BtU32 TsTest::Random( BtU32 range )
+{
+	m_seed = m_seed * 1664525 + 1013904223;
+	return ( m_seed >> 8 ) % range;
+}
+
+BtFloat TsTest::Random( BtFloat min, BtFloat max )
+{
+	m_seed = m_seed * 1664525 + 1013904223;
+	return min + ( max - min ) * ( ( m_seed >> 8 ) / 16777216.0f );
+}
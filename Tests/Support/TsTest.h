@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+// TsTest.h
+
+#pragma once
+#include <stdio.h>
+#include "BtTypes.h"
+#include "BtTime.h"
+
+// Reports where a check failed and carries on so one run shows every failure
+#define TsCheck( condition ) TsTest::Check( ( condition ), #condition, __FILE__, __LINE__ )
+
+// The checks of a unit test. Each test is its own program and returns Finish from main
+class TsTest
+{
+public:
+
+	static void							Check( BtBool isPassed, const BtChar *pCondition, const BtChar *pFile, BtU32 line );
+
+	// Prints the totals and returns the exit code
+	static int							Finish( const BtChar *pName );
+
+	// The same sequence of numbers on every platform, from one for each program. Setting the
+	// seed again repeats a sequence, so two copies of something can be made alike
+	static void							SetSeed( BtU32 seed );
+
+	// From zero up to but not including range, or from min to max
+	static BtU32						Random( BtU32 range );
+	static BtFloat						Random( BtFloat min, BtFloat max );
+
+private:
+
+	static BtU32						m_numChecks;
+	static BtU32						m_numFailed;
+	static BtU32						m_seed;
+};
+
+// Times a benchmark. Start it, run the loop and Stop prints the time taken per iteration
+class TsTimer
+{
+public:
+
+	void								Start();
+	BtDouble							Stop( const BtChar *pName, BtU32 numIterations );
+
+	// Nanoseconds per iteration of the last Stop
+	BtDouble							GetNanoseconds() const;
+
+private:
+
+	BtU64								m_start;
+	BtDouble							m_nanoseconds;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Start
+
+inline void TsTimer::Start()
+{
+	m_start = BtTime::GetElapsedTimeInNanoseconds();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stop
+
+inline BtDouble TsTimer::Stop( const BtChar *pName, BtU32 numIterations )
+{
+	BtU64 elapsed = BtTime::GetElapsedTimeInNanoseconds() - m_start;
+
+	m_nanoseconds = (BtDouble)elapsed / ( numIterations > 0 ? numIterations : 1 );
+
+	printf( "%-48s %12.1f ns\n", pName, m_nanoseconds );
+	return m_nanoseconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GetNanoseconds
+
+inline BtDouble TsTimer::GetNanoseconds() const
+{
+	return m_nanoseconds;
+}
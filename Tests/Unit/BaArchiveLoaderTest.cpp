@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveLoaderTest.cpp
+
+// Archives loaded in the background through BaArchiveLoader end up as a blocking load
+// leaves them, with their callbacks called once on the game thread and the fix ups spread
+// over updates. Without the loading thread a load happens straight away, and destroying
+// the loader leaves no archive half loaded
+
+#include <sched.h>
+#include <stdio.h>
+#include "ApConfig.h"
+#include "BaArchive.h"
+#include "BaArchiveLoader.h"
+#include "TsArchive.h"
+#include "TsTest.h"
+
+const BtU32 NumArchives = 3;
+const BtU32 NumResources = 40;
+
+// Bounds the waits on the loading thread
+const BtU64 MaxWait = (BtU64)10 * 1000 * 1000 * 1000;
+
+struct LLoad
+{
+	BaArchive							m_archive;
+	BtU32								m_numCallbacks;
+	BtBool								m_isLoadedInCallback;
+};
+
+static LLoad g_loads[NumArchives];
+
+////////////////////////////////////////////////////////////////////////////////
+// LCallback
+
+static void LCallback( BaArchive *pArchive, void *pContext )
+{
+	LLoad *pLoad = (LLoad*)pContext;
+
+	pLoad->m_numCallbacks++;
+	pLoad->m_isLoadedInCallback = ( pArchive == &pLoad->m_archive ) ? pArchive->IsLoaded() : BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LWriteArchives
+
+static void LWriteArchives()
+{
+	const BtChar *ppTitles[NumResources];
+	BaResourceType types[NumResources];
+	BtChar titles[NumResources][LMaxResourceName];
+
+	for( BtU32 iArchive=0; iArchive<NumArchives; iArchive++ )
+	{
+		for( BtU32 i=0; i<NumResources; i++ )
+		{
+			sprintf( titles[i], "archive%d_resource%d", iArchive, i );
+			ppTitles[i] = titles[i];
+			types[i] = BaRT_UserData;
+		}
+
+		BtChar filename[64];
+		sprintf( filename, "loader%d.z", iArchive );
+		TsCheck( TsArchive::Write( filename, ppTitles, types, NumResources, 1000 ) == BtTrue );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsArchiveComplete
+
+// Every resource of the archive is found by title and ID
+static BtBool LIsArchiveComplete( BaArchive &archive, BtU32 iArchive )
+{
+	for( BtU32 i=0; i<NumResources; i++ )
+	{
+		BtChar title[LMaxResourceName];
+		sprintf( title, "archive%d_resource%d", iArchive, i );
+
+		BaResource *pResource = archive.GetResource( BaRT_UserData, title );
+
+		if( ( pResource == BtNull ) || ( pResource != archive.GetResource( i + 1 ) ) )
+		{
+			return BtFalse;
+		}
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestWithoutThread
+
+static void LTestWithoutThread()
+{
+	LLoad &load = g_loads[0];
+	load.m_numCallbacks = 0;
+
+	BaLoadHandle handle = BaArchiveLoader::Load( &load.m_archive, "loader0", BaLP_Normal, LCallback, &load );
+
+	TsCheck( handle == 0 );
+	TsCheck( BaArchiveLoader::IsComplete( handle ) == BtTrue );
+	TsCheck( load.m_numCallbacks == 1 );
+	TsCheck( load.m_isLoadedInCallback == BtTrue );
+	TsCheck( LIsArchiveComplete( load.m_archive, 0 ) == BtTrue );
+
+	load.m_archive.Unload();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestBackground
+
+static void LTestBackground()
+{
+	BaArchiveLoader::CreateManager();
+	BaArchiveLoader::SetResourcesPerUpdate( 1 );
+
+	BaLoadHandle handles[NumArchives];
+	BaLoadPriority priorities[NumArchives] = { BaLP_Low, BaLP_High, BaLP_Normal };
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		BtChar name[64];
+		sprintf( name, "loader%d", i );
+
+		g_loads[i].m_numCallbacks = 0;
+		handles[i] = BaArchiveLoader::Load( &g_loads[i].m_archive, name, priorities[i], LCallback, &g_loads[i] );
+		TsCheck( handles[i] != 0 );
+	}
+	TsCheck( BaArchiveLoader::GetNumPending() == NumArchives );
+
+	// Nothing is created on the device until the game thread updates the loader
+	BtU64 start = BtTime::GetElapsedTimeInNanoseconds();
+	BtU32 numUpdates = 0;
+
+	while( ( BaArchiveLoader::GetNumPending() > 0 ) && ( BtTime::GetElapsedTimeInNanoseconds() - start < MaxWait ) )
+	{
+		BtU32 numCallbacks = g_loads[0].m_numCallbacks + g_loads[1].m_numCallbacks + g_loads[2].m_numCallbacks;
+
+		BaArchiveLoader::Update();
+
+		if( g_loads[0].m_numCallbacks + g_loads[1].m_numCallbacks + g_loads[2].m_numCallbacks == numCallbacks )
+		{
+			sched_yield();
+		}
+		++numUpdates;
+	}
+	TsCheck( BaArchiveLoader::GetNumPending() == 0 );
+
+	// One resource an update means at least as many updates as resources
+	TsCheck( numUpdates >= NumArchives * NumResources );
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		TsCheck( BaArchiveLoader::IsComplete( handles[i] ) == BtTrue );
+		TsCheck( g_loads[i].m_numCallbacks == 1 );
+		TsCheck( g_loads[i].m_isLoadedInCallback == BtTrue );
+		TsCheck( LIsArchiveComplete( g_loads[i].m_archive, i ) == BtTrue );
+	}
+
+	// Loading an archive again unloads it first
+	BaArchiveLoader::SetResourcesPerUpdate( 32 );
+	BaLoadHandle handle = BaArchiveLoader::Load( &g_loads[1].m_archive, "loader2", BaLP_Normal, LCallback, &g_loads[1] );
+	TsCheck( g_loads[1].m_archive.IsLoaded() == BtFalse );
+
+	start = BtTime::GetElapsedTimeInNanoseconds();
+
+	while( ( BaArchiveLoader::IsComplete( handle ) == BtFalse ) && ( BtTime::GetElapsedTimeInNanoseconds() - start < MaxWait ) )
+	{
+		BaArchiveLoader::Update();
+		sched_yield();
+	}
+	TsCheck( g_loads[1].m_numCallbacks == 2 );
+	TsCheck( LIsArchiveComplete( g_loads[1].m_archive, 2 ) == BtTrue );
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		g_loads[i].m_archive.Unload();
+	}
+
+	BaArchiveLoader::DestroyManager();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestDestroy
+
+// Loads still queued are dropped, and any being read are finished, so each archive is
+// either loaded with its callback called or not loaded at all
+static void LTestDestroy()
+{
+	BaArchiveLoader::CreateManager();
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		BtChar name[64];
+		sprintf( name, "loader%d", i );
+
+		g_loads[i].m_numCallbacks = 0;
+		BaArchiveLoader::Load( &g_loads[i].m_archive, name, BaLP_Normal, LCallback, &g_loads[i] );
+	}
+
+	BaArchiveLoader::DestroyManager();
+
+	TsCheck( BaArchiveLoader::GetNumPending() == 0 );
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		LLoad &load = g_loads[i];
+
+		if( load.m_archive.IsLoaded() == BtTrue )
+		{
+			TsCheck( load.m_numCallbacks == 1 );
+			TsCheck( LIsArchiveComplete( load.m_archive, i ) == BtTrue );
+			load.m_archive.Unload();
+		}
+		else
+		{
+			TsCheck( load.m_numCallbacks == 0 );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	LWriteArchives();
+
+	LTestWithoutThread();
+	LTestBackground();
+	LTestDestroy();
+
+	for( BtU32 i=0; i<NumArchives; i++ )
+	{
+		BtChar filename[64];
+		sprintf( filename, "loader%d.z", i );
+		remove( filename );
+	}
+
+	return TsTest::Finish( "BaArchiveLoaderTest" );
+}
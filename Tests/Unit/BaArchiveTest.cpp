@@ -0,0 +1,259 @@
+////////////////////////////////////////////////////////////////////////////////
+// BaArchiveTest.cpp
+
+// Looks resources up in archives of headers alone through the hashed title and ID
+// indices, in any case, with duplicates and across types. Titles match whole, however
+// long. Uncompressed variants are mapped in place, unless the compressed archive beside
+// them has changed since
+
+#include <stdio.h>
+#include "ApConfig.h"
+#include "BaArchive.h"
+#include "BaResource.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "TsArchive.h"
+#include "TsTest.h"
+
+// Enough headers to span several chunks
+const BtU32 NumArchiveResources = 5000;
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeTitle
+
+static void LMakeTitle( BtChar *pTitle, BtU32 index )
+{
+	sprintf( pTitle, "Resource%d", index );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestLookups
+
+// Every title is found as written, upper cased and lower cased, and only with its type
+static void LTestLookups()
+{
+	static BtChar titles[NumArchiveResources][LMaxResourceName];
+	const BtChar *ppTitles[NumArchiveResources];
+	BaResourceType types[NumArchiveResources];
+
+	for( BtU32 i=0; i<NumArchiveResources; i++ )
+	{
+		LMakeTitle( titles[i], i );
+		ppTitles[i] = titles[i];
+		types[i] = ( i & 1 ) ? BaRT_Texture : BaRT_Material;
+	}
+
+	TsCheck( TsArchive::Write( "lookups.z", ppTitles, types, NumArchiveResources ) == BtTrue );
+
+	BaArchive archive;
+	archive.Load( "lookups" );
+	TsCheck( archive.IsLoaded() == BtTrue );
+
+	BtU32 numFound = 0;
+	BtU32 numFoundUpper = 0;
+	BtU32 numFoundLower = 0;
+	BtU32 numWrongType = 0;
+	BtU32 numByID = 0;
+
+	for( BtU32 i=0; i<NumArchiveResources; i++ )
+	{
+		BaResource *pResource = archive.GetResource( types[i], titles[i] );
+
+		if( ( pResource != BtNull ) && ( BtStrCompare( pResource->GetTitle(), titles[i] ) == BtTrue ) )
+		{
+			++numFound;
+		}
+
+		BtChar title[LMaxResourceName];
+		BtStrCopy( title, LMaxResourceName, titles[i] );
+
+		BtStrUpper( title, LMaxResourceName );
+		if( archive.GetResource( types[i], title ) == pResource )
+		{
+			++numFoundUpper;
+		}
+
+		BtStrLower( title, LMaxResourceName );
+		if( archive.GetResource( types[i], title ) == pResource )
+		{
+			++numFoundLower;
+		}
+
+		BaResourceType otherType = ( types[i] == BaRT_Texture ) ? BaRT_Material : BaRT_Texture;
+		if( archive.GetResource( otherType, titles[i] ) == BtNull )
+		{
+			++numWrongType;
+		}
+
+		if( archive.GetResource( i + 1 ) == pResource )
+		{
+			++numByID;
+		}
+	}
+
+	TsCheck( numFound == NumArchiveResources );
+	TsCheck( numFoundUpper == NumArchiveResources );
+	TsCheck( numFoundLower == NumArchiveResources );
+	TsCheck( numWrongType == NumArchiveResources );
+	TsCheck( numByID == NumArchiveResources );
+
+	// Titles that aren't there, including ones that only differ at the end
+	TsCheck( archive.GetResource( BaRT_Texture, "Missing" ) == BtNull );
+	TsCheck( archive.GetResource( BaRT_Texture, "Resource1x" ) == BtNull );
+	TsCheck( archive.GetResource( BaRT_Texture, "Resource" ) == BtNull );
+	TsCheck( archive.GetResource( BaRT_Texture, "" ) == BtNull );
+
+	// IDs start at one and zero is never looked up
+	TsCheck( archive.GetResource( (BtU32)0 ) == BtNull );
+	TsCheck( archive.GetResource( NumArchiveResources + 1 ) == BtNull );
+
+	archive.Unload();
+	TsCheck( archive.IsLoaded() == BtFalse );
+
+	// Loading again builds a fresh index
+	archive.Load( "lookups" );
+	TsCheck( archive.GetResource( BaRT_Material, "RESOURCE4998" ) != BtNull );
+	archive.Unload();
+
+	remove( "lookups.z" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestDuplicates
+
+// The first of any titles that differ only in case is found, as with the old linear search.
+// The same title with another type is a different resource
+static void LTestDuplicates()
+{
+	const BtChar *ppTitles[] = { "Ship", "SHIP", "ship", "Ship", "Engine", "ENGINE" };
+	const BaResourceType types[] = { BaRT_SgNode, BaRT_SgNode, BaRT_Texture, BaRT_Material, BaRT_Sound, BaRT_Sound };
+	const BtU32 numResources = sizeof( types ) / sizeof( types[0] );
+
+	TsCheck( TsArchive::Write( "duplicates.z", ppTitles, types, numResources ) == BtTrue );
+
+	BaArchive archive;
+	archive.Load( "duplicates" );
+
+	BaResource *pNode = archive.GetResource( BaRT_SgNode, "sHiP" );
+	TsCheck( pNode != BtNull );
+	TsCheck( pNode == archive.GetResource( 1 ) );
+	TsCheck( pNode != archive.GetResource( 2 ) );
+
+	TsCheck( archive.GetResource( BaRT_Texture, "SHIP" ) == archive.GetResource( 3 ) );
+	TsCheck( archive.GetResource( BaRT_Material, "ship" ) == archive.GetResource( 4 ) );
+	TsCheck( archive.GetResource( BaRT_Sound, "engine" ) == archive.GetResource( 5 ) );
+	TsCheck( archive.GetResource( BaRT_Font, "Ship" ) == BtNull );
+
+	// Duplicate titles keep their own IDs
+	TsCheck( archive.GetResource( 2 ) != BtNull );
+	TsCheck( archive.GetResource( 6 ) != BtNull );
+
+	archive.Unload();
+
+	remove( "duplicates.z" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestLongTitles
+
+// Titles match only when they are the same apart from case, so one that is longer than
+// any in the archive is never found, even when it starts with one of them
+static void LTestLongTitles()
+{
+	const BtU32 longLength = 300;
+
+	static BtChar long1[longLength + 1];
+	static BtChar long2[longLength + 1];
+
+	BtMemory::Set( long1, 'a', longLength );
+	BtMemory::Set( long2, 'A', longLength );
+	long1[longLength] = 0;
+	long2[longLength] = 0;
+
+	TsCheck( BtStrCompareNoCase( long1, long2 ) == BtTrue );
+
+	// Past the 255 characters the comparison once stopped at
+	long2[280] = 'b';
+	TsCheck( BtStrCompareNoCase( long1, long2 ) == BtFalse );
+
+	long2[280] = 'A';
+	long2[longLength - 1] = 0;
+	TsCheck( BtStrCompareNoCase( long1, long2 ) == BtFalse );
+	TsCheck( BtStrCompareNoCase( long2, long1 ) == BtFalse );
+
+	BtChar title[LMaxResourceName];
+	BtMemory::Set( title, 'a', LMaxResourceName - 1 );
+	title[LMaxResourceName - 1] = 0;
+
+	const BtChar *ppTitles[] = { title };
+	const BaResourceType types[] = { BaRT_Texture };
+
+	TsCheck( TsArchive::Write( "long.z", ppTitles, types, 1 ) == BtTrue );
+
+	BaArchive archive;
+	archive.Load( "long" );
+
+	TsCheck( archive.GetResource( BaRT_Texture, title ) == archive.GetResource( 1 ) );
+	TsCheck( archive.GetResource( BaRT_Texture, long1 ) == BtNull );
+	TsCheck( archive.GetResource( BaRT_Texture, long2 ) == BtNull );
+
+	archive.Unload();
+
+	remove( "long.z" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestMapped
+
+static void LTestMapped()
+{
+	const BtChar *ppOldTitles[] = { "Ship", "Engine", "Sail" };
+	const BtChar *ppNewTitles[] = { "Boat", "Motor", "Mast", "Flag" };
+	const BaResourceType types[] = { BaRT_SgNode, BaRT_Sound, BaRT_Texture, BaRT_Texture };
+
+	// With only the mapping there, the archive loads from it
+	TsCheck( TsArchive::Write( "mapped.z", ppOldTitles, types, 3, 1000, BtTrue ) == BtTrue );
+	remove( "mapped.z" );
+
+	BaArchive archive;
+	archive.Load( "mapped" );
+
+	TsCheck( archive.IsLoaded() == BtTrue );
+	TsCheck( archive.GetResource( BaRT_Sound, "engine" ) == archive.GetResource( 2 ) );
+	TsCheck( archive.GetResource( BaRT_Texture, "Sail" ) != BtNull );
+	TsCheck( archive.GetResource( 4 ) == BtNull );
+
+	archive.Unload();
+
+	// A compressed archive written since the mapping is loaded instead of it
+	TsCheck( TsArchive::Write( "mapped.z", ppNewTitles, types, 4, 2000 ) == BtTrue );
+
+	archive.Load( "mapped" );
+
+	TsCheck( archive.GetResource( BaRT_Sound, "Engine" ) == BtNull );
+	TsCheck( archive.GetResource( BaRT_Sound, "Motor" ) == archive.GetResource( 2 ) );
+	TsCheck( archive.GetResource( BaRT_Texture, "Flag" ) == archive.GetResource( 4 ) );
+
+	archive.Unload();
+
+	remove( "mapped.z" );
+	remove( "mapped.m" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	LTestLookups();
+	LTestDuplicates();
+	LTestLongTitles();
+	LTestMapped();
+
+	return TsTest::Finish( "BaArchiveTest" );
+}
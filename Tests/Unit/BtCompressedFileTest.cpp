@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtCompressedFileTest.cpp
+
+// Archives written by the packer's chunk writer read back the same, inflated in order, in
+// parallel across the job workers and a resource at a time. A resource inflates only the
+// chunks it lies in. Archives of a single zlib stream still read through the old path
+
+#include <stdio.h>
+#include <vector>
+#include "zlib.h"
+#include "BtCompressedFile.h"
+#include "BtJobSystem.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "MtMath.h"
+#include "TsTest.h"
+
+const BtU32 NumResources = 6;
+
+// Neither a whole number of chunks nor of resources
+const BtU32 ArchiveSize = BaArchiveChunkSize * 4 + 1234;
+
+// Memory the reads haven't written to
+const BtU8 Untouched = 0xCD;
+
+struct LArchive
+{
+	std::vector<BtU8>					m_memory;				// Resource headers then their data
+	BaResourceHeader				   *m_pHeaders;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeArchive
+
+// Resource headers followed by data that compresses the way meshes and textures do, with
+// runs and repeats but different everywhere. The fourth resource straddles two chunks
+static void LMakeArchive( LArchive &archive )
+{
+	archive.m_memory.resize( ArchiveSize );
+	BtU8 *pMemory = &archive.m_memory[0];
+	BtMemory::Set( pMemory, 0, ArchiveSize );
+
+	archive.m_pHeaders = (BaResourceHeader*)pMemory;
+
+	BtU32 dataStart = NumResources * sizeof( BaResourceHeader );
+	BtU32 offsets[NumResources + 1] = { dataStart, 100000, BaArchiveChunkSize + 5000, BaArchiveChunkSize * 2 - 700,
+										BaArchiveChunkSize * 2 + 64, BaArchiveChunkSize * 4 + 16, ArchiveSize };
+
+	for( BtU32 i=0; i<NumResources; i++ )
+	{
+		BaResourceHeader &header = archive.m_pHeaders[i];
+		sprintf( header.m_szTitle, "resource%d", i );
+		header.m_type = BaRT_Texture;
+		header.m_nResourceID = i + 1;
+		header.m_nResourceOffset = offsets[i];
+		header.m_nResourceSize = offsets[i + 1] - offsets[i];
+	}
+
+	BtU32 seed = 12345;
+
+	for( BtU32 i=dataStart; i<ArchiveSize; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		pMemory[i] = ( ( seed >> 16 ) & 3 ) ? (BtU8)( i >> 5 ) : (BtU8)( seed >> 24 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LWriteArchive
+
+// Writes the archive header and the chunks as PaPacker::DeflateArchive does
+static BtU32 LWriteArchive( const BtChar *pFilename, const LArchive &archive )
+{
+	BaArchiveHeader archiveHeader;
+	BtMemory::Set( &archiveHeader, 0, sizeof(BaArchiveHeader) );
+	archiveHeader.m_nNumResources = NumResources;
+	archiveHeader.m_nDataSize = ArchiveSize;
+
+	FILE *f = fopen( pFilename, "wb" );
+	TsCheck( f != BtNull );
+
+	fwrite( &archiveHeader, 1, sizeof(BaArchiveHeader), f );
+	BtU32 compressedSize = BtCompressedFile::WriteChunks( f, &archive.m_memory[0], ArchiveSize );
+	fclose( f );
+
+	return compressedSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LOpenArchive
+
+// Opens the archive and reads its header and chunk table, leaving the chunks to be read
+static FILE *LOpenArchive( const BtChar *pFilename, BtCompressedFile &compressedFile )
+{
+	FILE *f = fopen( pFilename, "rb" );
+	TsCheck( f != BtNull );
+
+	BaArchiveHeader archiveHeader;
+	TsCheck( fread( &archiveHeader, 1, sizeof(BaArchiveHeader), f ) == sizeof(BaArchiveHeader) );
+	TsCheck( archiveHeader.m_nDataSize == ArchiveSize );
+	TsCheck( compressedFile.ReadChunkTable( f, archiveHeader.m_nDataSize ) == BtTrue );
+
+	return f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumDifferent
+
+static BtU32 LNumDifferent( const BtU8 *pA, const BtU8 *pB, BtU32 size )
+{
+	BtU32 numDifferent = 0;
+
+	for( BtU32 i=0; i<size; i++ )
+	{
+		if( pA[i] != pB[i] )
+		{
+			++numDifferent;
+		}
+	}
+	return numDifferent;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumUntouched
+
+static BtU32 LNumUntouched( const BtU8 *pMemory, BtU32 offset, BtU32 size )
+{
+	BtU32 numUntouched = 0;
+
+	for( BtU32 i=offset; i<offset + size; i++ )
+	{
+		if( pMemory[i] == Untouched )
+		{
+			++numUntouched;
+		}
+	}
+	return numUntouched;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestChunkTable
+
+static void LTestChunkTable( const LArchive &archive )
+{
+	BtU32 compressedSize = LWriteArchive( "chunks.z", archive );
+	TsCheck( compressedSize > 0 );
+	TsCheck( compressedSize < ArchiveSize );
+
+	BtCompressedFile compressedFile;
+	FILE *f = LOpenArchive( "chunks.z", compressedFile );
+	compressedFile.ReadChunks( f );
+	fclose( f );
+
+	// Every chunk is the chunk size but the last, which holds what's left
+	TsCheck( compressedFile.GetNumChunks() == 5 );
+
+	BtU32 totalCompressed = 0;
+
+	for( BtU32 i=0; i<compressedFile.GetNumChunks(); i++ )
+	{
+		const BaArchiveChunk &chunk = compressedFile.GetChunk( i );
+		TsCheck( chunk.m_nUncompressedOffset == i * BaArchiveChunkSize );
+		TsCheck( chunk.m_nUncompressedSize == ( ( i < 4 ) ? BaArchiveChunkSize : 1234 ) );
+		TsCheck( chunk.m_nCompressedOffset == totalCompressed );
+		totalCompressed += chunk.m_nCompressedSize;
+	}
+	TsCheck( totalCompressed == compressedSize );
+
+	// The chunks are all the file holds after the table
+	f = fopen( "chunks.z", "rb" );
+	fseek( f, 0, SEEK_END );
+	TsCheck( (BtU32)ftell( f ) == sizeof(BaArchiveHeader) + sizeof(BaArchiveChunkHeader) + 5 * sizeof(BaArchiveChunk) + compressedSize );
+	fclose( f );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LInflateChunks
+
+struct LInflateContext
+{
+	const BtCompressedFile			   *m_pCompressedFile;
+	BtU8							   *m_pMemory;
+};
+
+static void LInflateChunks( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LInflateContext *pInflate = (LInflateContext*)pContext;
+
+	pInflate->m_pCompressedFile->InflateChunks( pInflate->m_pMemory, iStart, iEnd );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRoundTrip
+
+// In order, and across the job workers as BaArchive::LoadFile inflates them
+static void LTestRoundTrip( const LArchive &archive )
+{
+	BtCompressedFile compressedFile;
+	FILE *f = LOpenArchive( "chunks.z", compressedFile );
+	compressedFile.ReadChunks( f );
+	fclose( f );
+
+	std::vector<BtU8> memory( ArchiveSize, Untouched );
+	compressedFile.InflateChunks( &memory[0], 0, compressedFile.GetNumChunks() );
+	TsCheck( LNumDifferent( &memory[0], &archive.m_memory[0], ArchiveSize ) == 0 );
+
+	for( BtU32 numWorkers=1; numWorkers<=4; numWorkers*=2 )
+	{
+		BtJobSystem::CreateManager( numWorkers );
+
+		std::vector<BtU8> parallelMemory( ArchiveSize, Untouched );
+
+		LInflateContext context;
+		context.m_pCompressedFile = &compressedFile;
+		context.m_pMemory = &parallelMemory[0];
+		BtJobSystem::ParallelFor( compressedFile.GetNumChunks(), 1, LInflateChunks, &context );
+
+		TsCheck( LNumDifferent( &parallelMemory[0], &archive.m_memory[0], ArchiveSize ) == 0 );
+
+		BtJobSystem::DestroyManager();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestResources
+
+// The headers first, then each resource on its own into memory nothing else has written
+static void LTestResources( const LArchive &archive )
+{
+	BtCompressedFile compressedFile;
+	FILE *f = LOpenArchive( "chunks.z", compressedFile );
+	compressedFile.ReadChunks( f );
+	fclose( f );
+
+	std::vector<BtU8> headers( ArchiveSize, Untouched );
+	BtU32 headersSize = NumResources * sizeof( BaResourceHeader );
+	compressedFile.InflateRange( &headers[0], 0, headersSize );
+	TsCheck( LNumDifferent( &headers[0], &archive.m_memory[0], headersSize ) == 0 );
+
+	// Only the first chunk, which the headers lie in, was inflated
+	TsCheck( LNumUntouched( &headers[0], BaArchiveChunkSize, ArchiveSize - BaArchiveChunkSize ) == ArchiveSize - BaArchiveChunkSize );
+
+	const BaResourceHeader *pHeaders = (const BaResourceHeader*)&headers[0];
+
+	for( BtU32 i=0; i<NumResources; i++ )
+	{
+		const BaResourceHeader &header = pHeaders[i];
+		TsCheck( BtStrCompare( header.m_szTitle, archive.m_pHeaders[i].m_szTitle ) == BtTrue );
+
+		std::vector<BtU8> memory( ArchiveSize, Untouched );
+		compressedFile.InflateResource( &memory[0], header );
+
+		TsCheck( LNumDifferent( &memory[header.m_nResourceOffset], &archive.m_memory[header.m_nResourceOffset], header.m_nResourceSize ) == 0 );
+
+		// The chunks the resource lies in are inflated whole and the others not at all
+		BtU32 firstByte = ( header.m_nResourceOffset / BaArchiveChunkSize ) * BaArchiveChunkSize;
+		BtU32 endByte = MtMin( ( ( header.m_nResourceOffset + header.m_nResourceSize - 1 ) / BaArchiveChunkSize + 1 ) * BaArchiveChunkSize, ArchiveSize );
+
+		TsCheck( LNumDifferent( &memory[firstByte], &archive.m_memory[firstByte], endByte - firstByte ) == 0 );
+		TsCheck( LNumUntouched( &memory[0], 0, firstByte ) == firstByte );
+		TsCheck( LNumUntouched( &memory[0], endByte, ArchiveSize - endByte ) == ArchiveSize - endByte );
+	}
+
+	// The resource that straddles two chunks inflates both
+	const BaResourceHeader &straddling = pHeaders[3];
+	TsCheck( straddling.m_nResourceOffset / BaArchiveChunkSize == 1 );
+	TsCheck( ( straddling.m_nResourceOffset + straddling.m_nResourceSize - 1 ) / BaArchiveChunkSize == 2 );
+
+	// Nothing to inflate inflates nothing
+	std::vector<BtU8> memory( ArchiveSize, Untouched );
+	compressedFile.InflateRange( &memory[0], BaArchiveChunkSize, 0 );
+	TsCheck( LNumUntouched( &memory[0], 0, ArchiveSize ) == ArchiveSize );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestSingleStream
+
+// Archives from before chunking are one zlib stream after the archive header
+static void LTestSingleStream( const LArchive &archive )
+{
+	uLongf compressedSize = compressBound( ArchiveSize );
+	std::vector<BtU8> compressed( compressedSize );
+	TsCheck( compress2( &compressed[0], &compressedSize, &archive.m_memory[0], ArchiveSize, 1 ) == Z_OK );
+
+	BaArchiveHeader archiveHeader;
+	BtMemory::Set( &archiveHeader, 0, sizeof(BaArchiveHeader) );
+	archiveHeader.m_nDataSize = ArchiveSize;
+
+	FILE *f = fopen( "stream.z", "wb" );
+	fwrite( &archiveHeader, 1, sizeof(BaArchiveHeader), f );
+	fwrite( &compressed[0], 1, compressedSize, f );
+	fclose( f );
+
+	f = fopen( "stream.z", "rb" );
+	TsCheck( fread( &archiveHeader, 1, sizeof(BaArchiveHeader), f ) == sizeof(BaArchiveHeader) );
+
+	BtCompressedFile compressedFile;
+	TsCheck( compressedFile.ReadChunkTable( f, ArchiveSize ) == BtFalse );
+	TsCheck( compressedFile.GetNumChunks() == 0 );
+	TsCheck( (BtU32)ftell( f ) == sizeof(BaArchiveHeader) );
+
+	std::vector<BtU8> memory( ArchiveSize, Untouched );
+	compressedFile.Read( f, &memory[0], ArchiveSize );
+	fclose( f );
+
+	TsCheck( LNumDifferent( &memory[0], &archive.m_memory[0], ArchiveSize ) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	LArchive archive;
+	LMakeArchive( archive );
+
+	LTestChunkTable( archive );
+	LTestRoundTrip( archive );
+	LTestResources( archive );
+	LTestSingleStream( archive );
+
+	return TsTest::Finish( "BtCompressedFileTest" );
+}
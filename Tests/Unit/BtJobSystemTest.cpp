@@ -0,0 +1,321 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtJobSystemTest.cpp
+
+// Every index of a ParallelFor and every Run job executes exactly once, for any number of
+// workers and grain size, when nested, and while other threads submit work at the same time.
+// A thread that has been ended can be started again
+
+#include <vector>
+#include "BtAtomic.h"
+#include "BtJobSystem.h"
+#include "BtThread.h"
+#include "TsTest.h"
+
+const BtU32 NumIndices = 20000;
+const BtU32 NumSubmitters = 4;
+const BtU32 NumSubmitterRounds = 50;
+
+struct LHits
+{
+	std::vector<BtS32>					m_hits;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LMark
+
+static void LMark( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LHits *pHits = (LHits*)pContext;
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		BtAtomicAdd( &pHits->m_hits[i], 1 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMarkNested
+
+// Each index runs a ParallelFor of its own from inside a job
+static void LMarkNested( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		BtJobSystem::ParallelFor( 100, 7, LMark, pContext );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsEach
+
+// True when every index was hit the given number of times. Resets them for the next run
+static BtBool LIsEach( LHits &hits, BtS32 numTimes )
+{
+	BtBool isEach = BtTrue;
+
+	for( BtU32 i=0; i<hits.m_hits.size(); i++ )
+	{
+		if( hits.m_hits[i] != numTimes )
+		{
+			isEach = BtFalse;
+		}
+		hits.m_hits[i] = 0;
+	}
+	return isEach;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestParallelFor
+
+static void LTestParallelFor()
+{
+	const BtU32 grainSizes[] = { 0, 1, 7, 64, 1000, NumIndices - 1, NumIndices, NumIndices + 1 };
+	const BtU32 numGrainSizes = sizeof( grainSizes ) / sizeof( grainSizes[0] );
+
+	LHits hits;
+	hits.m_hits.assign( NumIndices, 0 );
+
+	for( BtU32 numWorkers=1; numWorkers<=8; numWorkers*=2 )
+	{
+		BtJobSystem::CreateManager( numWorkers );
+		TsCheck( BtJobSystem::GetNumWorkers() == numWorkers );
+
+		BtU32 numFailed = 0;
+
+		for( BtU32 iGrain=0; iGrain<numGrainSizes; iGrain++ )
+		{
+			for( BtU32 i=0; i<20; i++ )
+			{
+				BtJobSystem::ParallelFor( NumIndices, grainSizes[iGrain], LMark, &hits );
+
+				if( LIsEach( hits, 1 ) == BtFalse )
+				{
+					++numFailed;
+				}
+			}
+		}
+		TsCheck( numFailed == 0 );
+
+		// Nothing to do returns straight away
+		BtJobSystem::ParallelFor( 0, 1, LMark, &hits );
+		TsCheck( LIsEach( hits, 0 ) == BtTrue );
+
+		BtJobSystem::DestroyManager();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestNested
+
+static void LTestNested()
+{
+	LHits hits;
+	hits.m_hits.assign( 100, 0 );
+
+	BtJobSystem::CreateManager( 4 );
+
+	BtJobSystem::ParallelFor( 50, 1, LMarkNested, &hits );
+	TsCheck( LIsEach( hits, 50 ) == BtTrue );
+
+	BtJobSystem::DestroyManager();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRunAndWait
+
+// More jobs than a queue holds, so some run as they're submitted
+static void LTestRunAndWait()
+{
+	LHits hits;
+	hits.m_hits.assign( MaxJobsPerQueue * 4, 0 );
+
+	BtJobSystem::CreateManager( 4 );
+
+	BtJobCounter counter;
+
+	for( BtU32 i=0; i<hits.m_hits.size(); i++ )
+	{
+		BtJobSystem::Run( LMark, &hits, i, i + 1, &counter );
+	}
+	BtJobSystem::Wait( &counter );
+
+	TsCheck( counter.m_count == 0 );
+	TsCheck( LIsEach( hits, 1 ) == BtTrue );
+
+	BtJobSystem::DestroyManager();
+
+	// Without a manager jobs run as they are submitted
+	BtJobSystem::Run( LMark, &hits, 0, 10, &counter );
+	TsCheck( counter.m_count == 0 );
+	BtJobSystem::ParallelFor( 10, 1, LMark, &hits );
+	TsCheck( hits.m_hits[0] == 2 );
+	TsCheck( hits.m_hits[10] == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LSubmitter
+
+// A thread that isn't a worker, submitting work through the shared queue and checking it
+class LSubmitter : public BtThread
+{
+public:
+
+	LSubmitter() : m_numRounds( 0 ), m_numFailed( 0 )
+	{
+		m_hits.m_hits.assign( NumIndices, 0 );
+	}
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		BtJobSystem::ParallelFor( NumIndices, 50, LMark, &m_hits );
+
+		BtJobCounter counter;
+
+		for( BtU32 i=0; i<NumIndices; i+=100 )
+		{
+			BtJobSystem::Run( LMark, &m_hits, i, i + 100, &counter );
+		}
+		BtJobSystem::Wait( &counter );
+
+		if( LIsEach( m_hits, 2 ) == BtFalse )
+		{
+			BtAtomicAdd( &m_numFailed, 1 );
+		}
+		BtAtomicAdd( &m_numRounds, 1 );
+	}
+
+	volatile BtS32						m_numRounds;
+	volatile BtS32						m_numFailed;
+
+private:
+
+	LHits								m_hits;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestContention
+
+// Several threads and the workers all push, pop and steal at once
+static void LTestContention()
+{
+	BtJobSystem::CreateManager( 4 );
+
+	LSubmitter submitters[NumSubmitters];
+
+	for( BtU32 i=0; i<NumSubmitters; i++ )
+	{
+		submitters[i].Start();
+	}
+
+	LHits hits;
+	hits.m_hits.assign( NumIndices, 0 );
+	BtU32 numFailed = 0;
+
+	// Keep the workers' own queues busy until every submitter has done its rounds
+	for( BtBool isDone = BtFalse; isDone == BtFalse; )
+	{
+		BtJobSystem::ParallelFor( NumIndices, 10, LMark, &hits );
+
+		if( LIsEach( hits, 1 ) == BtFalse )
+		{
+			++numFailed;
+		}
+
+		isDone = BtTrue;
+
+		for( BtU32 i=0; i<NumSubmitters; i++ )
+		{
+			if( BtAtomicLoad( &submitters[i].m_numRounds ) < (BtS32)NumSubmitterRounds )
+			{
+				isDone = BtFalse;
+			}
+		}
+	}
+
+	for( BtU32 i=0; i<NumSubmitters; i++ )
+	{
+		submitters[i].End();
+		TsCheck( submitters[i].m_numFailed == 0 );
+	}
+	TsCheck( numFailed == 0 );
+
+	BtJobSystem::DestroyManager();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCounter
+
+class LCounter : public BtThread
+{
+public:
+
+	LCounter() : m_numUpdates( 0 ) {}
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		BtAtomicAdd( &m_numUpdates, 1 );
+		YieldThread();
+	}
+
+	volatile BtS32						m_numUpdates;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRestart
+
+static void LTestRestart()
+{
+	LCounter counter;
+
+	for( BtU32 iRun=0; iRun<3; iRun++ )
+	{
+		BtS32 numUpdates = BtAtomicLoad( &counter.m_numUpdates );
+
+		counter.Start();
+		TsCheck( counter.IsEnded() == BtFalse );
+
+		// Each run updates until it's ended, however many runs came before. Give up after
+		// a few seconds rather than hang when it doesn't
+		BtU64 giveUp = BtTime::GetElapsedTimeInNanoseconds() + 5000000000ULL;
+
+		while( ( BtAtomicLoad( &counter.m_numUpdates ) < numUpdates + 100 ) &&
+			   ( BtTime::GetElapsedTimeInNanoseconds() < giveUp ) )
+		{
+			counter.SleepThread( 0 );
+		}
+		TsCheck( BtAtomicLoad( &counter.m_numUpdates ) >= numUpdates + 100 );
+
+		counter.End();
+		TsCheck( counter.IsEnded() == BtTrue );
+	}
+
+	// Ended before the new thread gets going, it still finishes
+	for( BtU32 iRun=0; iRun<10; iRun++ )
+	{
+		counter.Start();
+		counter.End();
+	}
+	TsCheck( counter.IsEnded() == BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	LTestParallelFor();
+	LTestNested();
+	LTestRunAndWait();
+	LTestContention();
+	LTestRestart();
+
+	return TsTest::Finish( "BtJobSystemTest" );
+}
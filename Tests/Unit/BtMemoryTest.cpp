@@ -0,0 +1,407 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtMemoryTest.cpp
+
+// Allocations are aligned as asked, from the pools or the heap, and are counted against
+// their tag until they are freed. Each tag's pools hold pages of their own. Job workers
+// allocating and freeing each other's blocks leave nothing corrupt or counted once they
+// are done, and so do threads that aren't BtThreads once they exit. ReportLeaks names
+// what is still live, and unloading an archive frees the duplicates made of its resources
+
+#include <new>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "ApConfig.h"
+#include "BaArchive.h"
+#include "BaResource.h"
+#include "BtAtomic.h"
+#include "BtJobSystem.h"
+#include "BtMemory.h"
+#include "BtString.h"
+#include "MtMath.h"
+#include "TsArchive.h"
+#include "TsTest.h"
+
+const BtU32 NumAllocations = 10000;
+const BtU32 NumDuplicates = 100;
+const BtU32 NumThreadAllocations = 20000;
+const BtU32 NumWorkers = 4;
+const BtU32 NumPlainThreads = 200;
+const BtU32 NumPlainAllocations = 48;
+
+// Destroy calls on duplicates
+static BtU32 g_numDestroyed = 0;
+
+// What the workers allocated and the blocks they found overwritten
+static BtU8 *g_pShared[NumThreadAllocations];
+static volatile BtS32 g_numCorrupt = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LDuplicate
+
+// Stands in for a duplicated node or material. Its instance starts its block
+class LDuplicate : public BaResource
+{
+public:
+
+	void								Destroy()
+	{
+		++g_numDestroyed;
+	}
+
+	BtU8								m_fileData[200];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsUnchanged
+
+// True when a tag has the same live bytes and allocations as before
+static BtBool LIsUnchanged( BtMemoryTag tag, const BtMemoryStats &before )
+{
+	BtMemoryStats stats = BtMemory::GetStats( tag );
+
+	return ( stats.m_bytes == before.m_bytes ) && ( stats.m_allocations == before.m_allocations );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestAlignment
+
+// Sizes either side of each pool and the heap, at every alignment, filled and checked
+static void LTestAlignment()
+{
+	BtU32 sizes[] = { 1, 15, 16, 17, 100, BtMemoryMaxPooledSize, BtMemoryMaxPooledSize + 1, 4096, 100000 };
+	BtU32 alignments[] = { 1, 16, 64, 4096 };
+	BtU32 numMisaligned = 0;
+	BtU32 numCorrupt = 0;
+
+	BtMemoryStats before = BtMemory::GetStats( BtMT_General );
+	std::vector<BtU8*> allocations;
+
+	for( BtU32 iSize=0; iSize<sizeof( sizes ) / sizeof( sizes[0] ); iSize++ )
+	{
+		for( BtU32 iAlign=0; iAlign<sizeof( alignments ) / sizeof( alignments[0] ); iAlign++ )
+		{
+			BtU8 *pMemory = BtMemory::Allocate( sizes[iSize], alignments[iAlign] );
+			BtU32 alignment = MtMax( alignments[iAlign], BtMemoryDefaultAlignment );
+
+			if( ( (size_t)pMemory & ( alignment - 1 ) ) != 0 )
+			{
+				++numMisaligned;
+			}
+			BtMemory::Set( pMemory, (BtU8)( iSize + iAlign ), sizes[iSize] );
+			allocations.push_back( pMemory );
+		}
+	}
+
+	// Nothing has written over anything else
+	for( BtU32 iSize=0, i=0; iSize<sizeof( sizes ) / sizeof( sizes[0] ); iSize++ )
+	{
+		for( BtU32 iAlign=0; iAlign<sizeof( alignments ) / sizeof( alignments[0] ); iAlign++, i++ )
+		{
+			for( BtU32 iByte=0; iByte<sizes[iSize]; iByte++ )
+			{
+				if( allocations[i][iByte] != (BtU8)( iSize + iAlign ) )
+				{
+					++numCorrupt;
+					break;
+				}
+			}
+			BtMemory::Free( allocations[i] );
+		}
+	}
+
+	TsCheck( numMisaligned == 0 );
+	TsCheck( numCorrupt == 0 );
+	TsCheck( LIsUnchanged( BtMT_General, before ) == BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestStats
+
+// Live and peak bytes and counts per tag, with other tags left alone
+static void LTestStats()
+{
+	BtMemoryStats render = BtMemory::GetStats( BtMT_Render );
+	BtMemoryStats network = BtMemory::GetStats( BtMT_Network );
+
+	std::vector<BtU8*> allocations;
+
+	for( BtU32 i=0; i<NumAllocations; i++ )
+	{
+		allocations.push_back( BtMemory::Allocate( BtMT_Render, 1 + ( i % 300 ) ) );
+	}
+
+	BtS64 numBytes = 0;
+
+	for( BtU32 i=0; i<NumAllocations; i++ )
+	{
+		numBytes += 1 + ( i % 300 );
+	}
+
+	BtMemoryStats stats = BtMemory::GetStats( BtMT_Render );
+	TsCheck( stats.m_bytes == render.m_bytes + numBytes );
+	TsCheck( stats.m_allocations == render.m_allocations + NumAllocations );
+	TsCheck( stats.m_totalAllocations == render.m_totalAllocations + NumAllocations );
+	TsCheck( stats.m_peakBytes >= stats.m_bytes );
+	TsCheck( LIsUnchanged( BtMT_Network, network ) == BtTrue );
+
+	// The small ones came from pages of the tag's own
+	TsCheck( stats.m_poolBytes > render.m_poolBytes );
+	TsCheck( BtMemory::GetStats( BtMT_Network ).m_poolBytes == network.m_poolBytes );
+
+	for( BtU32 i=0; i<NumAllocations; i++ )
+	{
+		BtMemory::Free( allocations[i] );
+	}
+
+	stats = BtMemory::GetStats( BtMT_Render );
+	TsCheck( LIsUnchanged( BtMT_Render, render ) == BtTrue );
+	TsCheck( stats.m_peakBytes >= render.m_bytes + numBytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LAllocateJob
+
+static void LAllocateJob( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		BtU32 size = 1 + ( i % 300 );
+
+		g_pShared[i] = BtMemory::Allocate( (BtMemoryTag)( i % BtMT_Max ), size );
+		BtMemory::Set( g_pShared[i], (BtU8)i, size );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LFreeJob
+
+// From the other end, so most blocks are freed by a worker that didn't allocate them
+static void LFreeJob( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	for( BtU32 j=iStart; j<iEnd; j++ )
+	{
+		BtU32 i = NumThreadAllocations - 1 - j;
+		BtU32 size = 1 + ( i % 300 );
+
+		for( BtU32 iByte=0; iByte<size; iByte++ )
+		{
+			if( g_pShared[i][iByte] != (BtU8)i )
+			{
+				BtAtomicAdd( &g_numCorrupt, 1 );
+				break;
+			}
+		}
+		BtMemory::Free( g_pShared[i] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestThreads
+
+// Every tag at once from the job workers, then freed across them
+static void LTestThreads()
+{
+	BtMemoryStats before[BtMT_Max];
+	BtS64 numBytes[BtMT_Max] = { 0 };
+	BtS64 numAllocations[BtMT_Max] = { 0 };
+
+	for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+	{
+		before[tag] = BtMemory::GetStats( (BtMemoryTag)tag );
+	}
+
+	for( BtU32 i=0; i<NumThreadAllocations; i++ )
+	{
+		numBytes[i % BtMT_Max] += 1 + ( i % 300 );
+		++numAllocations[i % BtMT_Max];
+	}
+
+	BtJobSystem::CreateManager( NumWorkers );
+	BtJobSystem::ParallelFor( NumThreadAllocations, 64, LAllocateJob, BtNull );
+
+	// What each worker counted is seen while it's still running
+	BtU32 numWrong = 0;
+
+	for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+	{
+		BtMemoryStats stats = BtMemory::GetStats( (BtMemoryTag)tag );
+
+		if( ( stats.m_bytes != before[tag].m_bytes + numBytes[tag] ) ||
+			( stats.m_allocations != before[tag].m_allocations + numAllocations[tag] ) )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+
+	BtJobSystem::ParallelFor( NumThreadAllocations, 64, LFreeJob, BtNull );
+	BtJobSystem::DestroyManager();
+
+	TsCheck( g_numCorrupt == 0 );
+
+	// And once the workers have gone
+	numWrong = 0;
+
+	for( BtU32 tag=0; tag<BtMT_Max; tag++ )
+	{
+		if( LIsUnchanged( (BtMemoryTag)tag, before[tag] ) == BtFalse )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LPlainThread
+
+static void *LPlainThread( void * )
+{
+	void *pMemory[NumPlainAllocations];
+
+	for( BtU32 i=0; i<NumPlainAllocations; i++ )
+	{
+		pMemory[i] = BtMemory::Allocate( BtMT_Audio, 16 );
+	}
+
+	for( BtU32 i=0; i<NumPlainAllocations; i++ )
+	{
+		BtMemory::Free( pMemory[i] );
+	}
+	return BtNull;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestPlainThreads
+
+// Threads made without BtThread, as platform and audio callbacks are, give their cached
+// blocks back as they exit. Were they kept, each would hold dozens and the second round
+// would need new pages for them
+static void LTestPlainThreads()
+{
+	BtMemoryStats before = BtMemory::GetStats( BtMT_Audio );
+	BtS64 poolBytes = 0;
+
+	for( BtU32 iRound=0; iRound<2; iRound++ )
+	{
+		poolBytes = BtMemory::GetStats( BtMT_Audio ).m_poolBytes;
+
+		for( BtU32 i=0; i<NumPlainThreads; i++ )
+		{
+			pthread_t thread;
+			pthread_create( &thread, BtNull, LPlainThread, BtNull );
+			pthread_join( thread, BtNull );
+		}
+	}
+
+	TsCheck( LIsUnchanged( BtMT_Audio, before ) == BtTrue );
+	TsCheck( BtMemory::GetStats( BtMT_Audio ).m_poolBytes == poolBytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReportLeaks
+
+// Runs ReportLeaks with what it prints going to a file, then reads it back
+static BtU32 LReportLeaks( BtChar *pReport, BtU32 maxLength )
+{
+	fflush( stdout );
+
+	FILE *pFile = fopen( "leaks.txt", "w+" );
+	int console = dup( fileno( stdout ) );
+	dup2( fileno( pFile ), fileno( stdout ) );
+
+	BtU32 numLeaks = BtMemory::ReportLeaks();
+
+	fflush( stdout );
+	dup2( console, fileno( stdout ) );
+	close( console );
+
+	rewind( pFile );
+	size_t length = fread( pReport, 1, maxLength - 1, pFile );
+	pReport[length] = 0;
+
+	fclose( pFile );
+	remove( "leaks.txt" );
+
+	return numLeaks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestReportLeaks
+
+static void LTestReportLeaks()
+{
+	BtChar report[1024];
+
+	// Nothing has been left behind so far
+	TsCheck( LReportLeaks( report, sizeof( report ) ) == 0 );
+	TsCheck( report[0] == 0 );
+
+	BtU8 *pSmall = BtMemory::Allocate( BtMT_Network, 100 );
+	BtU8 *pLarge = BtMemory::Allocate( BtMT_Network, 200000 );
+
+	TsCheck( LReportLeaks( report, sizeof( report ) ) == 2 );
+	TsCheck( strstr( report, "Memory Network: 2 allocations of 200100 bytes still live." ) != BtNull );
+	TsCheck( strstr( report, "General" ) == BtNull );
+
+	BtMemory::Free( pSmall );
+	BtMemory::Free( pLarge );
+
+	TsCheck( LReportLeaks( report, sizeof( report ) ) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestArchiveDuplicates
+
+// Duplicates are destroyed and freed when their archive is unloaded
+static void LTestArchiveDuplicates()
+{
+	const BtChar *ppTitles[] = { "first", "second" };
+	BaResourceType types[] = { BaRT_Material, BaRT_SgNode };
+
+	TsCheck( TsArchive::Write( "duplicates.z", ppTitles, types, 2 ) == BtTrue );
+
+	BtMemoryStats before = BtMemory::GetStats( BtMT_Archive );
+
+	BaArchive archive;
+	archive.Load( "duplicates" );
+	TsCheck( archive.IsLoaded() == BtTrue );
+
+	for( BtU32 i=0; i<NumDuplicates; i++ )
+	{
+		LDuplicate *pDuplicate = new( BtMemory::Allocate( BtMT_Archive, sizeof( LDuplicate ) ) ) LDuplicate;
+		archive.AddDuplicate( pDuplicate );
+	}
+
+	archive.Unload();
+
+	TsCheck( g_numDestroyed == NumDuplicates );
+	TsCheck( LIsUnchanged( BtMT_Archive, before ) == BtTrue );
+
+	remove( "duplicates.z" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	LTestReportLeaks();
+	LTestAlignment();
+	LTestStats();
+	LTestThreads();
+	LTestPlainThreads();
+	LTestArchiveDuplicates();
+
+	BtChar report[1024];
+	TsCheck( LReportLeaks( report, sizeof( report ) ) == 0 );
+
+	return TsTest::Finish( "BtMemoryTest" );
+}
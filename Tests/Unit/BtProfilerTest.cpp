@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtProfilerTest.cpp
+
+// A capture of known markers writes the golden trace once its times are masked, with
+// times that nest as the markers did. Short lived threads hand their slots on so a
+// capture records every one of them
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BtProfiler.h"
+#include "BtThread.h"
+#include "TsTest.h"
+
+const BtU32 NumShortThreads = 40;
+const BtU32 NumShortThreadsAtOnce = 3;
+
+// Times in the trace are printed to the nearest nanosecond in microseconds, each rounded on its own
+const BtDouble TraceRounding = 0.002;
+
+struct LTraceEvent
+{
+	BtDouble							m_start;
+	BtDouble							m_duration;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadFile
+
+static std::string LReadFile( const BtChar *pFilename )
+{
+	std::string text;
+	FILE *f = fopen( pFilename, "rb" );
+
+	if( f != BtNull )
+	{
+		BtChar buffer[4096];
+		size_t numRead;
+
+		while( ( numRead = fread( buffer, 1, sizeof( buffer ), f ) ) > 0 )
+		{
+			text.append( buffer, numRead );
+		}
+		fclose( f );
+	}
+	return text;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMaskTimes
+
+// Replaces the value of every "ts" and "dur" with # as they change from run to run
+static std::string LMaskTimes( const std::string &trace )
+{
+	std::string masked;
+
+	for( size_t i=0; i<trace.size(); )
+	{
+		if( ( trace.compare( i, 5, "\"ts\":" ) == 0 ) || ( trace.compare( i, 6, "\"dur\":" ) == 0 ) )
+		{
+			size_t colon = trace.find( ':', i );
+			masked.append( trace, i, colon + 1 - i );
+			masked += '#';
+
+			for( i = colon + 1; ( i < trace.size() ) && ( strchr( "0123456789.-", trace[i] ) != BtNull ); i++ )
+			{
+			}
+			continue;
+		}
+		masked += trace[i++];
+	}
+	return masked;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadCompleteEvents
+
+// The times of the complete events, in the order they were written
+static std::vector<LTraceEvent> LReadCompleteEvents( const std::string &trace )
+{
+	std::vector<LTraceEvent> events;
+
+	for( size_t line = 0; line < trace.size(); )
+	{
+		size_t end = trace.find( '\n', line );
+
+		if( end == std::string::npos )
+		{
+			end = trace.size();
+		}
+
+		std::string text = trace.substr( line, end - line );
+
+		size_t start = text.find( "\"ts\":" );
+		size_t duration = text.find( "\"dur\":" );
+
+		if( ( text.find( "\"ph\":\"X\"" ) != std::string::npos ) && ( start != std::string::npos ) && ( duration != std::string::npos ) )
+		{
+			LTraceEvent event;
+			sscanf( text.c_str() + start + 5, "%lf", &event.m_start );
+			sscanf( text.c_str() + duration + 6, "%lf", &event.m_duration );
+			events.push_back( event );
+		}
+		line = end + 1;
+	}
+	return events;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsInside
+
+static BtBool LIsInside( const LTraceEvent &inner, const LTraceEvent &outer )
+{
+	return ( inner.m_start + TraceRounding >= outer.m_start ) &&
+		   ( inner.m_start + inner.m_duration <= outer.m_start + outer.m_duration + TraceRounding );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCountOf
+
+static BtU32 LCountOf( const std::string &text, const BtChar *pFind )
+{
+	BtU32 count = 0;
+
+	for( size_t i = text.find( pFind ); i != std::string::npos; i = text.find( pFind, i + 1 ) )
+	{
+		++count;
+	}
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestGoldenTrace
+
+static void LTestGoldenTrace()
+{
+	// The main thread takes the first slot
+	BtProfiler::SetThreadName( "Main" );
+
+	// Nothing is recorded before a capture or written without one
+	{
+		BtProfile( "Before" );
+	}
+	TsCheck( BtProfiler::IsCapturing() == BtFalse );
+	TsCheck( BtProfiler::WriteTrace( "profiler.json" ) == BtFalse );
+
+	BtProfiler::Capture( 2 );
+	TsCheck( BtProfiler::IsCapturing() == BtTrue );
+
+	BtProfiler::BeginFrame();
+	{
+		BtProfile( "Update" );
+		{
+			BtProfile( "Physics" );
+		}
+		BtProfiler::Counter( "Memory", 1024 );
+		{
+			// Quotes, backslashes and control characters are escaped
+			BtProfile( "Load \"level\\1\"\t" );
+		}
+	}
+	BtProfiler::EndFrame();
+	TsCheck( BtProfiler::IsCaptureReady() == BtFalse );
+
+	// Still open when the capture finishes, so it's left out
+	BtProfiler::Begin( "Open" );
+
+	BtProfiler::BeginFrame();
+	{
+		BtProfile( "Update" );
+	}
+	BtProfiler::Counter( "Memory", -1 );
+	BtProfiler::EndFrame();
+
+	BtProfiler::End();
+
+	TsCheck( BtProfiler::IsCaptureReady() == BtTrue );
+	TsCheck( BtProfiler::GetNumDroppedEvents() == 0 );
+	TsCheck( BtProfiler::WriteTrace( "profiler.json" ) == BtTrue );
+	TsCheck( BtProfiler::IsCaptureReady() == BtFalse );
+
+	std::string trace = LReadFile( "profiler.json" );
+	std::string golden = LReadFile( "../Golden/BtProfilerTrace.json" );
+
+	TsCheck( golden.empty() == false );
+	TsCheck( LMaskTimes( trace ) == golden );
+
+	// Frame 0, Update, Physics, Load, then Frame 1 and its Update
+	std::vector<LTraceEvent> events = LReadCompleteEvents( trace );
+	TsCheck( events.size() == 6 );
+
+	if( events.size() == 6 )
+	{
+		BtU32 numNegative = 0;
+		BtU32 numOutOfOrder = 0;
+
+		for( BtU32 i=0; i<events.size(); i++ )
+		{
+			if( events[i].m_duration < 0 )
+			{
+				++numNegative;
+			}
+			if( ( i > 0 ) && ( events[i].m_start + TraceRounding < events[i - 1].m_start ) )
+			{
+				++numOutOfOrder;
+			}
+		}
+		TsCheck( numNegative == 0 );
+		TsCheck( numOutOfOrder == 0 );
+
+		TsCheck( LIsInside( events[1], events[0] ) == BtTrue );
+		TsCheck( LIsInside( events[2], events[1] ) == BtTrue );
+		TsCheck( LIsInside( events[3], events[1] ) == BtTrue );
+		TsCheck( events[3].m_start + TraceRounding >= events[2].m_start + events[2].m_duration );
+		TsCheck( events[4].m_start + TraceRounding >= events[0].m_start + events[0].m_duration );
+		TsCheck( LIsInside( events[5], events[4] ) == BtTrue );
+	}
+
+	remove( "profiler.json" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LShortThread
+
+// Records one marker as it starts and then idles until it's ended
+class LShortThread : public BtThread
+{
+public:
+
+	void								Create()
+	{
+		BtProfiler::SetThreadName( "Short" );
+		BtProfile( "Short" );
+	}
+
+	void								Update()
+	{
+		SleepThread( 0 );
+	}
+
+	void								Destroy() {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestShortThreads
+
+// Far more threads than there are slots come and go during one capture. They share
+// the slots of the few that run at once and every marker is kept
+static void LTestShortThreads()
+{
+	BtProfiler::Capture( 1 );
+	BtProfiler::BeginFrame();
+
+	for( BtU32 i=0; i<NumShortThreads; i+=NumShortThreadsAtOnce )
+	{
+		LShortThread threads[NumShortThreadsAtOnce];
+		BtU32 numThreads = NumShortThreads - i < NumShortThreadsAtOnce ? NumShortThreads - i : NumShortThreadsAtOnce;
+
+		for( BtU32 iThread=0; iThread<numThreads; iThread++ )
+		{
+			threads[iThread].Start();
+		}
+		for( BtU32 iThread=0; iThread<numThreads; iThread++ )
+		{
+			threads[iThread].End();
+		}
+	}
+
+	BtProfiler::EndFrame();
+
+	TsCheck( BtProfiler::GetNumDroppedEvents() == 0 );
+	TsCheck( BtProfiler::WriteTrace( "threads.json" ) == BtTrue );
+
+	std::string trace = LReadFile( "threads.json" );
+
+	TsCheck( LCountOf( trace, "{\"name\":\"Short\",\"ph\":\"X\"" ) == NumShortThreads );
+
+	// The main thread and no more than one slot for each thread running at once
+	TsCheck( LCountOf( trace, "\"thread_name\"" ) <= 1 + NumShortThreadsAtOnce );
+
+	remove( "threads.json" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	LTestGoldenTrace();
+	LTestShortThreads();
+
+	return TsTest::Finish( "BtProfilerTest" );
+}
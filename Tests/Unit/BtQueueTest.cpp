@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////////////////////////
+// BtQueueTest.cpp
+
+// The MPMC queue hands every item pushed by any number of producers to exactly one of any
+// number of consumers. GetItemCount only counts items that have been written, so a lone
+// consumer can pop as many as it reports while producers are still pushing
+
+#include <vector>
+#include "BtAtomic.h"
+#include "BtQueueMPMC.h"
+#include "BtThread.h"
+#include "TsTest.h"
+
+const BtU32 NumProducers = 4;
+const BtU32 NumConsumers = 3;
+const BtU32 NumPerProducer = 50000;
+const BtU32 NumItems = NumProducers * NumPerProducer;
+
+typedef BtQueueMPMC<BtU32, 64> LQueue;
+
+// Set while a gated item is being copied into the queue, which holds it there until the gate opens
+static volatile BtS32 g_isCopying = 0;
+static volatile BtS32 g_isGateOpen = 0;
+
+struct LShared
+{
+	LQueue								m_queue;
+	std::vector<BtS32>					m_hits;
+	volatile BtS32						m_numPopped;
+	volatile BtS32						m_numFailedPops;		// Pops that failed after GetItemCount said there was an item
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LProducer
+
+// Pushes its own range of values, trying again while the queue is full
+class LProducer : public BtThread
+{
+public:
+
+	LShared							   *m_pShared;
+	BtU32								m_first;
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		for( BtU32 i=m_first; i<m_first + NumPerProducer; i++ )
+		{
+			while( ( m_pShared->m_queue.Push( i ) == BtFalse ) && ( IsEnded() == BtFalse ) )
+			{
+				YieldThread();
+			}
+		}
+		IsEnded( BtTrue );
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LConsumer
+
+// Pops until every item has been popped by someone. A counting consumer only pops when
+// GetItemCount says there is something, as ShNetwork does, and every such pop must work
+class LConsumer : public BtThread
+{
+public:
+
+	LShared							   *m_pShared;
+	BtBool								m_isCounting;
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		while( ( BtAtomicLoad( &m_pShared->m_numPopped ) < (BtS32)NumItems ) && ( IsEnded() == BtFalse ) )
+		{
+			BtU32 numItems = ( m_isCounting == BtTrue ) ? m_pShared->m_queue.GetItemCount() : 1;
+			BtU32 numPopped = 0;
+
+			for( BtU32 i=0; i<numItems; i++ )
+			{
+				BtU32 item;
+
+				if( m_pShared->m_queue.Pop( item ) == BtTrue )
+				{
+					BtAtomicAdd( &m_pShared->m_hits[item], 1 );
+					++numPopped;
+				}
+				else if( m_isCounting == BtTrue )
+				{
+					BtAtomicAdd( &m_pShared->m_numFailedPops, 1 );
+				}
+			}
+			BtAtomicAdd( &m_pShared->m_numPopped, numPopped );
+
+			// Let the producers in while there's nothing to pop
+			if( numPopped == 0 )
+			{
+				YieldThread();
+			}
+		}
+		IsEnded( BtTrue );
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LRun
+
+// Pushes from every producer and pops from numConsumers consumers. Returns the number of
+// items that weren't popped exactly once
+static BtU32 LRun( LShared &shared, BtU32 numConsumers, BtBool isCounting )
+{
+	shared.m_hits.assign( NumItems, 0 );
+	shared.m_numPopped = 0;
+	shared.m_numFailedPops = 0;
+
+	LProducer producers[NumProducers];
+	LConsumer consumers[NumConsumers];
+
+	for( BtU32 i=0; i<numConsumers; i++ )
+	{
+		consumers[i].m_pShared = &shared;
+		consumers[i].m_isCounting = isCounting;
+		consumers[i].Start();
+	}
+
+	for( BtU32 i=0; i<NumProducers; i++ )
+	{
+		producers[i].m_pShared = &shared;
+		producers[i].m_first = i * NumPerProducer;
+		producers[i].Start();
+	}
+
+	// End stops a thread that hasn't got round to its work yet, so wait for the work first.
+	// Give up after a while rather than hang if items go missing
+	BtU64 giveUp = BtTime::GetElapsedTimeInNanoseconds() + 60000000000ULL;
+
+	while( ( BtAtomicLoad( &shared.m_numPopped ) < (BtS32)NumItems ) &&
+		   ( BtTime::GetElapsedTimeInNanoseconds() < giveUp ) )
+	{
+		producers[0].SleepThread( 1 );
+	}
+
+	for( BtU32 i=0; i<NumProducers; i++ )
+	{
+		producers[i].End();
+	}
+
+	for( BtU32 i=0; i<numConsumers; i++ )
+	{
+		consumers[i].End();
+	}
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; i<NumItems; i++ )
+	{
+		if( shared.m_hits[i] != 1 )
+		{
+			++numWrong;
+		}
+	}
+	return numWrong;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGatedItem
+
+// An item whose copy can be held up, to stop a producer between claiming a slot and filling it
+struct LGatedItem
+{
+	BtU32								m_value;
+	BtBool								m_isGated;
+
+	LGatedItem&							operator=( const LGatedItem &item )
+	{
+		if( item.m_isGated == BtTrue )
+		{
+			BtAtomicStore( &g_isCopying, 1 );
+
+			while( BtAtomicLoad( &g_isGateOpen ) == 0 )
+			{
+				BtAtomicPause();
+			}
+		}
+		m_value = item.m_value;
+		m_isGated = BtFalse;
+		return *this;
+	}
+};
+
+typedef BtQueueMPMC<LGatedItem, 8> LGatedQueue;
+
+////////////////////////////////////////////////////////////////////////////////
+// LGatedProducer
+
+class LGatedProducer : public BtThread
+{
+public:
+
+	LGatedQueue						   *m_pQueue;
+
+	void								Create() {}
+	void								Destroy() {}
+
+	void								Update()
+	{
+		LGatedItem item = { 0, BtTrue };
+		m_pQueue->Push( item );
+		IsEnded( BtTrue );
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestUnpublished
+
+// A producer holds the first slot while others fill the ones after it. None of them are
+// counted or popped until the first is written
+static void LTestUnpublished()
+{
+	LGatedQueue queue;
+	LGatedProducer producer;
+	producer.m_pQueue = &queue;
+	producer.Start();
+
+	while( BtAtomicLoad( &g_isCopying ) == 0 )
+	{
+		producer.YieldThread();
+	}
+
+	for( BtU32 i=1; i<3; i++ )
+	{
+		LGatedItem item = { i, BtFalse };
+		TsCheck( queue.Push( item ) == BtTrue );
+	}
+
+	LGatedItem item;
+	TsCheck( queue.GetItemCount() == 0 );
+	TsCheck( queue.Pop( item ) == BtFalse );
+	TsCheck( queue.IsRoom() == BtTrue );
+
+	BtAtomicStore( &g_isGateOpen, 1 );
+	producer.End();
+
+	TsCheck( queue.GetItemCount() == 3 );
+
+	for( BtU32 i=0; i<3; i++ )
+	{
+		TsCheck( ( queue.Pop( item ) == BtTrue ) && ( item.m_value == i ) );
+	}
+	TsCheck( queue.GetItemCount() == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestSingleThread
+
+static void LTestSingleThread()
+{
+	BtQueueMPMC<BtU32, 4> queue;
+	BtU32 item = 0;
+
+	TsCheck( queue.GetItemCount() == 0 );
+	TsCheck( queue.Pop( item ) == BtFalse );
+
+	for( BtU32 i=0; i<4; i++ )
+	{
+		TsCheck( queue.Push( i ) == BtTrue );
+	}
+	TsCheck( queue.IsRoom() == BtFalse );
+	TsCheck( queue.Push( 4 ) == BtFalse );
+	TsCheck( queue.GetItemCount() == 4 );
+
+	// First in, first out, round the ring a few times
+	BtBool isInOrder = BtTrue;
+
+	for( BtU32 i=0; i<20; i++ )
+	{
+		if( ( queue.Pop( item ) == BtFalse ) || ( item != i ) || ( queue.Push( i + 4 ) == BtFalse ) )
+		{
+			isInOrder = BtFalse;
+		}
+	}
+	TsCheck( isInOrder == BtTrue );
+	TsCheck( queue.GetItemCount() == 4 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	LTestSingleThread();
+	LTestUnpublished();
+
+	LShared shared;
+
+	TsCheck( LRun( shared, NumConsumers, BtFalse ) == 0 );
+	TsCheck( shared.m_queue.GetItemCount() == 0 );
+
+	TsCheck( LRun( shared, 1, BtTrue ) == 0 );
+	TsCheck( shared.m_numFailedPops == 0 );
+
+	return TsTest::Finish( "BtQueueTest" );
+}
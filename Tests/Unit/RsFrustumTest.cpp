@@ -0,0 +1,391 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsFrustumTest.cpp
+
+// Testing spheres in batches gives the same result for every sphere as testing it on
+// its own, with the SIMD kernel on and off. Random spheres are tested from several
+// views, then spheres sized to the float either side of where the single test changes
+// its answer, so both paths must round the same way. Batches of every length up to a few
+// groups of four and at unaligned addresses cover the tail the kernel leaves over. Boxes
+// are tested the same way against the single box test, the edge boxes scaled to the
+// float either side of where it changes its answer
+
+#include <vector>
+#include "MtAABB.h"
+#include "MtMatrix4.h"
+#include "RsFrustum.h"
+#include "TsTest.h"
+
+const BtU32 NumViews = 8;
+const BtU32 NumSpheres = 20000;
+const BtU32 NumEdgeSpheres = 4000;
+const BtU32 NumBoxes = 20000;
+const BtU32 NumEdgeBoxes = 4000;
+const BtU32 MaxTailCount = 13;
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeFrustum
+
+// A camera in the middle of the spheres looking along a different heading for each view
+static RsFrustum LMakeFrustum( BtU32 view )
+{
+	MtMatrix4 m4Translation;
+	m4Translation.SetIdentity();
+	m4Translation.SetTranslation( -TsTest::Random( -10.0f, 10.0f ), -TsTest::Random( -10.0f, 10.0f ), -TsTest::Random( -10.0f, 10.0f ) );
+
+	MtMatrix4 m4RotationY;
+	m4RotationY.SetRotationY( view * 0.8f );
+
+	MtMatrix4 m4RotationX;
+	m4RotationX.SetRotationX( TsTest::Random( -0.5f, 0.5f ) );
+
+	MtMatrix4 m4Projection;
+	m4Projection.BuildLeftHandedProjectionMatrix( 0.1f, 200.0f, 1.0f + view * 0.25f, 0.6f + view * 0.1f );
+
+	RsFrustum frustum;
+	frustum.Set( m4Translation * m4RotationY * m4RotationX * m4Projection );
+	return frustum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LSpheres
+
+struct LSpheres
+{
+	std::vector<BtFloat>				m_x;
+	std::vector<BtFloat>				m_y;
+	std::vector<BtFloat>				m_z;
+	std::vector<BtFloat>				m_radius;
+
+	void								Add( const MtVector3 &v3Position, BtFloat radius )
+	{
+		m_x.push_back( v3Position.x );
+		m_y.push_back( v3Position.y );
+		m_z.push_back( v3Position.z );
+		m_radius.push_back( radius );
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LCountWrong
+
+// Tests spheres [first, first + count) in one batch and counts those that don't match
+// the single test
+static BtU32 LCountWrong( const RsFrustum &frustum, const LSpheres &spheres, BtU32 first, BtU32 count, BtBool isSimd )
+{
+	RsFrustum::SetSimd( isSimd );
+
+	// BtBool is a bool, so not a vector of them
+	BtBool *pIsInside = new BtBool[count + 1];
+
+	frustum.IsInside( &spheres.m_x[first], &spheres.m_y[first], &spheres.m_z[first], &spheres.m_radius[first], count, pIsInside );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; i<count; i++ )
+	{
+		BtU32 index = first + i;
+		MtVector3 v3Position( spheres.m_x[index], spheres.m_y[index], spheres.m_z[index] );
+
+		if( pIsInside[i] != frustum.IsInside( v3Position, spheres.m_radius[index] ) )
+		{
+			++numWrong;
+		}
+	}
+	delete[] pIsInside;
+
+	RsFrustum::SetSimd( BtTrue );
+
+	return numWrong;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRandom
+
+static void LTestRandom( const RsFrustum &frustum )
+{
+	LSpheres spheres;
+
+	for( BtU32 i=0; i<NumSpheres; i++ )
+	{
+		MtVector3 v3Position( TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ) );
+		spheres.Add( v3Position, TsTest::Random( 0, 10.0f ) );
+	}
+
+	TsCheck( LCountWrong( frustum, spheres, 0, NumSpheres, BtTrue ) == 0 );
+	TsCheck( LCountWrong( frustum, spheres, 0, NumSpheres, BtFalse ) == 0 );
+
+	// Some of each, so the comparison means something
+	BtU32 numInside = 0;
+
+	for( BtU32 i=0; i<NumSpheres; i++ )
+	{
+		if( frustum.IsInside( MtVector3( spheres.m_x[i], spheres.m_y[i], spheres.m_z[i] ), spheres.m_radius[i] ) == BtTrue )
+		{
+			++numInside;
+		}
+	}
+	TsCheck( numInside > NumSpheres / 100 );
+	TsCheck( numInside < NumSpheres - NumSpheres / 100 );
+
+	// Every length of batch, starting at every alignment
+	BtU32 numWrong = 0;
+
+	for( BtU32 first=0; first<4; first++ )
+	{
+		for( BtU32 count=0; count<=MaxTailCount; count++ )
+		{
+			numWrong += LCountWrong( frustum, spheres, first, count, BtTrue );
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestEdges
+
+// Finds the smallest radius the single test calls inside for each point, and tests it
+// and the float below it, which is called outside
+static void LTestEdges( const RsFrustum &frustum )
+{
+	LSpheres spheres;
+
+	for( BtU32 i=0; i<NumEdgeSpheres; i++ )
+	{
+		MtVector3 v3Position( TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ) );
+
+		BtFloat low = -1000.0f;
+		BtFloat high = 1000.0f;
+
+		if( ( frustum.IsInside( v3Position, low ) == BtTrue ) || ( frustum.IsInside( v3Position, high ) == BtFalse ) )
+		{
+			continue;
+		}
+
+		// Halve the gap until the two are neighbouring floats
+		for( BtU32 j=0; j<200; j++ )
+		{
+			BtFloat middle = low + ( high - low ) * 0.5f;
+
+			if( ( middle == low ) || ( middle == high ) )
+			{
+				break;
+			}
+
+			if( frustum.IsInside( v3Position, middle ) == BtTrue )
+			{
+				high = middle;
+			}
+			else
+			{
+				low = middle;
+			}
+		}
+		spheres.Add( v3Position, high );
+		spheres.Add( v3Position, low );
+	}
+
+	TsCheck( spheres.m_x.size() > NumEdgeSpheres );
+	TsCheck( LCountWrong( frustum, spheres, 0, (BtU32)spheres.m_x.size(), BtTrue ) == 0 );
+	TsCheck( LCountWrong( frustum, spheres, 0, (BtU32)spheres.m_x.size(), BtFalse ) == 0 );
+
+	// And each pair straddles the edge
+	BtU32 numStraddling = 0;
+
+	for( BtU32 i=0; i<spheres.m_x.size(); i += 2 )
+	{
+		MtVector3 v3Position( spheres.m_x[i], spheres.m_y[i], spheres.m_z[i] );
+
+		if( ( frustum.IsInside( v3Position, spheres.m_radius[i] ) == BtTrue ) &&
+			( frustum.IsInside( v3Position, spheres.m_radius[i + 1] ) == BtFalse ) )
+		{
+			++numStraddling;
+		}
+	}
+	TsCheck( numStraddling == spheres.m_x.size() / 2 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBoxes
+
+// The boxes, and the centres and half extents the batch is given, worked out from each
+// box as the single test works them out
+struct LBoxes
+{
+	std::vector<MtAABB>					m_boxes;
+	std::vector<BtFloat>				m_centers[3];
+	std::vector<BtFloat>				m_extents[3];
+
+	void								Add( const MtAABB &box )
+	{
+		MtVector3 v3Center = ( box.Min() + box.Max() ) * 0.5f;
+		MtVector3 v3Extent = ( box.Max() - box.Min() ) * 0.5f;
+
+		m_boxes.push_back( box );
+
+		for( BtU32 i=0; i<3; i++ )
+		{
+			m_centers[i].push_back( v3Center[i] );
+			m_extents[i].push_back( v3Extent[i] );
+		}
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LCountWrongBoxes
+
+// Tests boxes [first, first + count) in one batch and counts those that don't match
+// the single test
+static BtU32 LCountWrongBoxes( const RsFrustum &frustum, const LBoxes &boxes, BtU32 first, BtU32 count, BtBool isSimd )
+{
+	RsFrustum::SetSimd( isSimd );
+
+	BtBool *pIsInside = new BtBool[count + 1];
+
+	frustum.IsInside( &boxes.m_centers[0][first], &boxes.m_centers[1][first], &boxes.m_centers[2][first],
+					  &boxes.m_extents[0][first], &boxes.m_extents[1][first], &boxes.m_extents[2][first], count, pIsInside );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; i<count; i++ )
+	{
+		if( pIsInside[i] != frustum.IsInside( boxes.m_boxes[first + i] ) )
+		{
+			++numWrong;
+		}
+	}
+	delete[] pIsInside;
+
+	RsFrustum::SetSimd( BtTrue );
+
+	return numWrong;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRandomExtent
+
+// Long thin boxes as well as cubes, so every plane's normal is weighed differently
+static MtVector3 LRandomExtent( BtFloat size )
+{
+	return MtVector3( TsTest::Random( 0.1f, size ), TsTest::Random( 0.1f, size ), TsTest::Random( 0.1f, size ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRandomBoxes
+
+static void LTestRandomBoxes( const RsFrustum &frustum )
+{
+	LBoxes boxes;
+
+	for( BtU32 i=0; i<NumBoxes; i++ )
+	{
+		MtVector3 v3Center( TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ) );
+		MtVector3 v3Extent = LRandomExtent( 10.0f );
+
+		boxes.Add( MtAABB( v3Center - v3Extent, v3Center + v3Extent ) );
+	}
+
+	TsCheck( LCountWrongBoxes( frustum, boxes, 0, NumBoxes, BtTrue ) == 0 );
+	TsCheck( LCountWrongBoxes( frustum, boxes, 0, NumBoxes, BtFalse ) == 0 );
+
+	BtU32 numInside = 0;
+
+	for( BtU32 i=0; i<NumBoxes; i++ )
+	{
+		if( frustum.IsInside( boxes.m_boxes[i] ) == BtTrue )
+		{
+			++numInside;
+		}
+	}
+	TsCheck( numInside > NumBoxes / 100 );
+	TsCheck( numInside < NumBoxes - NumBoxes / 100 );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 first=0; first<4; first++ )
+	{
+		for( BtU32 count=0; count<=MaxTailCount; count++ )
+		{
+			numWrong += LCountWrongBoxes( frustum, boxes, first, count, BtTrue );
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestBoxEdges
+
+// Grows a box of a random shape about each point until the single test calls it inside,
+// and tests the smallest scale that is and the float below it, which isn't
+static void LTestBoxEdges( const RsFrustum &frustum )
+{
+	LBoxes boxes;
+
+	for( BtU32 i=0; i<NumEdgeBoxes; i++ )
+	{
+		MtVector3 v3Center( TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ), TsTest::Random( -150.0f, 150.0f ) );
+		MtVector3 v3Shape = LRandomExtent( 1.0f );
+
+		BtFloat low = 0;
+		BtFloat high = 1000.0f;
+
+		if( ( frustum.IsInside( MtAABB( v3Center - v3Shape * low, v3Center + v3Shape * low ) ) == BtTrue ) ||
+			( frustum.IsInside( MtAABB( v3Center - v3Shape * high, v3Center + v3Shape * high ) ) == BtFalse ) )
+		{
+			continue;
+		}
+
+		for( BtU32 j=0; j<200; j++ )
+		{
+			BtFloat middle = low + ( high - low ) * 0.5f;
+
+			if( ( middle == low ) || ( middle == high ) )
+			{
+				break;
+			}
+
+			if( frustum.IsInside( MtAABB( v3Center - v3Shape * middle, v3Center + v3Shape * middle ) ) == BtTrue )
+			{
+				high = middle;
+			}
+			else
+			{
+				low = middle;
+			}
+		}
+		boxes.Add( MtAABB( v3Center - v3Shape * high, v3Center + v3Shape * high ) );
+		boxes.Add( MtAABB( v3Center - v3Shape * low, v3Center + v3Shape * low ) );
+	}
+
+	TsCheck( boxes.m_boxes.size() > NumEdgeBoxes );
+	TsCheck( LCountWrongBoxes( frustum, boxes, 0, (BtU32)boxes.m_boxes.size(), BtTrue ) == 0 );
+	TsCheck( LCountWrongBoxes( frustum, boxes, 0, (BtU32)boxes.m_boxes.size(), BtFalse ) == 0 );
+
+	BtU32 numStraddling = 0;
+
+	for( BtU32 i=0; i<boxes.m_boxes.size(); i += 2 )
+	{
+		if( ( frustum.IsInside( boxes.m_boxes[i] ) == BtTrue ) && ( frustum.IsInside( boxes.m_boxes[i + 1] ) == BtFalse ) )
+		{
+			++numStraddling;
+		}
+	}
+	TsCheck( numStraddling == boxes.m_boxes.size() / 2 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	for( BtU32 view=0; view<NumViews; view++ )
+	{
+		RsFrustum frustum = LMakeFrustum( view );
+
+		LTestRandom( frustum );
+		LTestEdges( frustum );
+		LTestRandomBoxes( frustum );
+		LTestBoxEdges( frustum );
+	}
+
+	return TsTest::Finish( "RsFrustumTest" );
+}
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsImplTest.cpp
+
+// The graphics heap takes frames of ten times the renderables the fixed heap and primitive
+// array used to hold, and every renderable is still intact when the frame is rendered.
+// It grows once and then serves the same frames from the pages it has
+
+#include "TsRenderer.h"
+#include "TsTest.h"
+
+// What the graphics heap and the primitive array held before they could grow
+const BtU32 FixedHeapSize = 1024 * 100;
+const BtU32 FixedNumPrimitives = 4096;
+
+// Ten times as much of both
+const BtU32 NumBusyRenderables = FixedNumPrimitives * 10;
+const BtU32 NumFrames = 4;
+
+// Too big for the stack with its vertex arrays
+static TsRenderer g_renderer;
+
+////////////////////////////////////////////////////////////////////////////////
+// LRenderFrame
+
+static void LRenderFrame( TsRenderer &renderer, BtU32 numRenderables )
+{
+	renderer.BeginScene();
+
+	for( BtU32 i=0; i<numRenderables; i++ )
+	{
+		renderer.AddRenderable( i );
+	}
+	renderer.Render();
+	renderer.EndScene();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestBusyFrames
+
+static void LTestBusyFrames( TsRenderer &renderer )
+{
+	TsCheck( NumBusyRenderables * ( sizeof( TsRenderable ) + sizeof( RsPrimitive ) ) >= FixedHeapSize * 10 );
+
+	BtU32 numWrong = 0;
+	BtU32 numPages = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		LRenderFrame( renderer, NumBusyRenderables );
+
+		TsCheck( renderer.GetNumRendered() == NumBusyRenderables );
+		numWrong += renderer.GetNumWrong();
+
+		if( iFrame == 0 )
+		{
+			numPages = renderer.GetGraphicsHeapStats().m_numPages;
+		}
+	}
+	TsCheck( numWrong == 0 );
+
+	// Stats are for the last frame once the next has begun
+	renderer.BeginScene();
+
+	const RsGraphicsHeapStats &stats = renderer.GetGraphicsHeapStats();
+
+	TsCheck( stats.m_numAllocations == NumBusyRenderables * 2 );
+	TsCheck( stats.m_bytesUsed >= NumBusyRenderables * ( sizeof( TsRenderable ) + sizeof( RsPrimitive ) ) );
+	TsCheck( stats.m_highWater == stats.m_bytesUsed );
+	TsCheck( stats.m_capacity >= stats.m_highWater );
+	TsCheck( stats.m_numPages > 1 );
+
+	// Only the first frame needed more pages
+	TsCheck( stats.m_numPages == numPages );
+	TsCheck( stats.m_numGrowths == numPages - 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestQuietFrames
+
+// A quiet frame after busy ones reuses the first page and keeps the high-water mark
+static void LTestQuietFrames( TsRenderer &renderer )
+{
+	BtU32 highWater = renderer.GetGraphicsHeapStats().m_highWater;
+	BtU32 capacity = renderer.GetGraphicsHeapStats().m_capacity;
+
+	LRenderFrame( renderer, 100 );
+	TsCheck( renderer.GetNumWrong() == 0 );
+
+	renderer.BeginScene();
+
+	const RsGraphicsHeapStats &stats = renderer.GetGraphicsHeapStats();
+
+	TsCheck( stats.m_numAllocations == 200 );
+	TsCheck( stats.m_bytesUsed < FixedHeapSize );
+	TsCheck( stats.m_highWater == highWater );
+	TsCheck( stats.m_capacity == capacity );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestLargeAllocation
+
+// One allocation larger than any page gets a page of its own, and later frames still fit
+static void LTestLargeAllocation( TsRenderer &renderer )
+{
+	const BtU32 size = renderer.GetGraphicsHeapStats().m_capacity * 2;
+
+	renderer.BeginScene();
+
+	renderer.AddRenderable( 0 );
+	BtU8 *pMemory = renderer.AllocateGraphicsMemory( size );
+	TsCheck( pMemory != BtNull );
+	TsCheck( ( (size_t)pMemory & 15 ) == 0 );
+
+	BtMemory::Set( pMemory, 0xAB, size );
+	TsCheck( pMemory[0] == 0xAB );
+	TsCheck( pMemory[size - 1] == 0xAB );
+
+	renderer.AddRenderable( 1 );
+	renderer.Render();
+	TsCheck( renderer.GetNumWrong() == 0 );
+	renderer.EndScene();
+
+	LRenderFrame( renderer, NumBusyRenderables );
+	TsCheck( renderer.GetNumWrong() == 0 );
+
+	renderer.BeginScene();
+	TsCheck( renderer.GetGraphicsHeapStats().m_capacity >= size );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	g_renderer.Create();
+
+	// A frame of what the fixed heap held needs no more pages
+	LRenderFrame( g_renderer, FixedHeapSize / ( sizeof( TsRenderable ) + sizeof( RsPrimitive ) ) );
+	TsCheck( g_renderer.GetNumWrong() == 0 );
+	TsCheck( g_renderer.GetGraphicsHeapStats().m_numGrowths == 0 );
+
+	LTestBusyFrames( g_renderer );
+	LTestQuietFrames( g_renderer );
+	LTestLargeAllocation( g_renderer );
+
+	g_renderer.Destroy();
+
+	return TsTest::Finish( "RsImplTest" );
+}
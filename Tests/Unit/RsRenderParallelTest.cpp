@@ -0,0 +1,312 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsRenderParallelTest.cpp
+
+// Renderables recorded by RenderParallel jobs reach their render targets in the order one
+// thread would have added them, for any number of workers and grain size, when the jobs
+// nest, when the frame runs out of command buffers and around renderables added directly
+
+#include <vector>
+#include "BtJobSystem.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "TsNullGL.h"
+#include "TsRenderTarget.h"
+#include "TsTest.h"
+
+const BtU32 NumRenderables = 3000;
+const BtU32 NumTargets = 2;
+const BtU32 NumSortOrders = 3;
+const BtU32 NumFrames = 10;
+
+// Enough RenderParallel calls in one frame to use up the command buffers
+const BtU32 NumCalls = MaxCommandBuffers + 6;
+const BtU32 NumPerCall = 100;
+
+struct LScene
+{
+	TsRenderTarget						m_targets[NumTargets];
+};
+
+// Where a nested RenderParallel's indices start
+struct LNested
+{
+	LScene							   *m_pScene;
+	BtU32								m_first;
+};
+
+static LScene g_scene;
+
+////////////////////////////////////////////////////////////////////////////////
+// LAdd
+
+// Every fourth renderable is a sprite. The rest are meshes. The index is kept in each
+// and in the memory it was given, so the order and contents can both be checked
+static void LAdd( LScene *pScene, BtU32 index )
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	TsRenderTarget &target = pScene->m_targets[index % NumTargets];
+	BtU32 sortOrder = ( index / NumTargets ) % NumSortOrders;
+
+	if( index % 4 == 3 )
+	{
+		RsSpriteRenderable *pSprite = pImpl->AddSprite();
+		pSprite->m_primitive = pImpl->AddPrimitive();
+		pSprite->m_primitive->m_nStartVertex = index;
+		target.Add( sortOrder, pSprite );
+	}
+	else
+	{
+		SgMeshRenderable *pMesh = pImpl->AddMesh();
+		pMesh->m_nStartRenderBlock = index;
+		pMesh->m_m4World.SetIdentity();
+		pMesh->m_m4World._30 = (BtFloat)index;
+		target.Add( sortOrder, pMesh );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRecord
+
+static void LRecord( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		LAdd( (LScene*)pContext, i );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRecordFrom
+
+static void LRecordFrom( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	LNested *pNested = (LNested*)pContext;
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		LAdd( pNested->m_pScene, pNested->m_first + i );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LRecordNested
+
+// Each index records four renderables through a RenderParallel of its own
+static void LRecordNested( void *pContext, BtU32 iStart, BtU32 iEnd )
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	for( BtU32 i=iStart; i<iEnd; i++ )
+	{
+		LNested nested;
+		nested.m_pScene = (LScene*)pContext;
+		nested.m_first = i * 4;
+
+		pImpl->RenderParallel( 4, 1, LRecordFrom, &nested );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LBeginFrame
+
+static void LBeginFrame( LScene &scene )
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	pImpl->ResetRenderables();
+
+	for( BtU32 i=0; i<NumTargets; i++ )
+	{
+		scene.m_targets[i].Reset();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetOrder
+
+// The indices of everything in the render targets, list by list, or ~0 for any
+// renderable whose contents don't match its index
+static std::vector<BtU32> LGetOrder( LScene &scene )
+{
+	std::vector<BtU32> order;
+	std::vector<const SgMeshRenderable*> meshes;
+	std::vector<const RsSpriteRenderable*> sprites;
+
+	for( BtU32 iTarget=0; iTarget<NumTargets; iTarget++ )
+	{
+		for( BtU32 sortOrder=0; sortOrder<NumSortOrders; sortOrder++ )
+		{
+			scene.m_targets[iTarget].GetMeshes( sortOrder, meshes );
+
+			for( BtU32 i=0; i<meshes.size(); i++ )
+			{
+				BtU32 index = meshes[i]->m_nStartRenderBlock;
+				BtBool isIntact = meshes[i]->m_m4World._30 == (BtFloat)index;
+
+				order.push_back( ( isIntact == BtTrue ) ? index : ~0u );
+			}
+
+			scene.m_targets[iTarget].GetSprites( sortOrder, sprites );
+
+			for( BtU32 i=0; i<sprites.size(); i++ )
+			{
+				order.push_back( sprites[i]->m_primitive->m_nStartVertex );
+			}
+		}
+	}
+	return order;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetSerialOrder
+
+// The order adding the renderables one after another on this thread gives
+static std::vector<BtU32> LGetSerialOrder( BtU32 numRenderables )
+{
+	LBeginFrame( g_scene );
+	LRecord( &g_scene, 0, numRenderables );
+
+	return LGetOrder( g_scene );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestOrder
+
+static void LTestOrder()
+{
+	const BtU32 grainSizes[] = { 1, 7, 64, 1000 };
+	const BtU32 numGrainSizes = sizeof( grainSizes ) / sizeof( grainSizes[0] );
+
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	// Indices either side of the parallel ones are added directly
+	std::vector<BtU32> serial = LGetSerialOrder( NumRenderables + 2 );
+	TsCheck( serial.size() == NumRenderables + 2 );
+
+	for( BtU32 numWorkers=1; numWorkers<=8; numWorkers*=2 )
+	{
+		BtJobSystem::CreateManager( numWorkers );
+
+		BtU32 numWrong = 0;
+
+		for( BtU32 iGrain=0; iGrain<numGrainSizes; iGrain++ )
+		{
+			for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+			{
+				LBeginFrame( g_scene );
+
+				LAdd( &g_scene, 0 );
+
+				LNested nested;
+				nested.m_pScene = &g_scene;
+				nested.m_first = 1;
+				pImpl->RenderParallel( NumRenderables, grainSizes[iGrain], LRecordFrom, &nested );
+
+				LAdd( &g_scene, NumRenderables + 1 );
+
+				if( LGetOrder( g_scene ) != serial )
+				{
+					++numWrong;
+				}
+			}
+		}
+		TsCheck( numWrong == 0 );
+
+		BtJobSystem::DestroyManager();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestNested
+
+// Jobs that call RenderParallel record into their own buffer rather than start more jobs
+static void LTestNested()
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	std::vector<BtU32> serial = LGetSerialOrder( NumRenderables * 4 );
+
+	BtJobSystem::CreateManager( 4 );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		LBeginFrame( g_scene );
+		pImpl->RenderParallel( NumRenderables, 16, LRecordNested, &g_scene );
+
+		if( LGetOrder( g_scene ) != serial )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+
+	BtJobSystem::DestroyManager();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestOutOfCommandBuffers
+
+// Once a frame's command buffers are used up RenderParallel runs on the calling thread
+static void LTestOutOfCommandBuffers()
+{
+	RsImplWinGL *pImpl = (RsImplWinGL*)RsImpl::pInstance();
+
+	std::vector<BtU32> serial = LGetSerialOrder( NumCalls * NumPerCall );
+
+	BtJobSystem::CreateManager( 4 );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		LBeginFrame( g_scene );
+
+		for( BtU32 iCall=0; iCall<NumCalls; iCall++ )
+		{
+			LNested nested;
+			nested.m_pScene = &g_scene;
+			nested.m_first = iCall * NumPerCall;
+
+			pImpl->RenderParallel( NumPerCall, 10, LRecordFrom, &nested );
+		}
+
+		if( LGetOrder( g_scene ) != serial )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+
+	BtJobSystem::DestroyManager();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	LTestOrder();
+	LTestNested();
+	LTestOutOfCommandBuffers();
+
+	// Without a job system everything is added as it's made
+	std::vector<BtU32> serial = LGetSerialOrder( 100 );
+
+	LBeginFrame( g_scene );
+	((RsImplWinGL*)RsImpl::pInstance())->RenderParallel( 100, 1, LRecord, &g_scene );
+	TsCheck( RsCommandBufferImpl::GetCurrent() == BtNull );
+	TsCheck( LGetOrder( g_scene ) == serial );
+
+	LBeginFrame( g_scene );
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "RsRenderParallelTest" );
+}
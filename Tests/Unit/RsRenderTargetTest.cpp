@@ -0,0 +1,455 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsRenderTargetTest.cpp
+
+// What a render target sends the device. Batching joins neighbouring strips, fans and
+// lists of a material into lists, and the triangles and lines drawn, their vertices and
+// winding included, are the same with it on and off. Sorting draws meshes grouped by
+// program and state, however many there are
+
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+// Larger than a batch can take so it is drawn on its own
+const BtU32 LargeList = 9000;
+
+struct LSubmit
+{
+	BtU32								m_material;
+	RsPrimitiveType						m_type;
+	BtU32								m_numVertex;
+};
+
+// Runs of each material with every kind of primitive, a strip too short to have a
+// triangle, a change from triangles to lines and a list too large to batch
+static const LSubmit g_submits[] =
+{
+	{ 0, RsPT_TriangleStrip,	6 },
+	{ 0, RsPT_TriangleFan,		5 },
+	{ 0, RsPT_TriangleList,		6 },
+	{ 0, RsPT_TriangleStrip,	2 },
+	{ 0, RsPT_TriangleStrip,	7 },
+	{ 1, RsPT_TriangleList,		3 },
+	{ 1, RsPT_TriangleStrip,	5 },
+	{ 1, RsPT_LineStrip,		4 },
+	{ 1, RsPT_LineList,			4 },
+	{ 1, RsPT_LineStrip,		3 },
+	{ 0, RsPT_TriangleStrip,	4 },
+	{ 0, RsPT_TriangleList,		LargeList },
+	{ 0, RsPT_TriangleStrip,	5 },
+};
+
+const BtU32 NumSubmits = sizeof( g_submits ) / sizeof( g_submits[0] );
+
+// The runs above. Triangles can't join lines and the large list stands alone, so it
+// breaks the run either side of it
+const BtU32 NumBatches = 6;
+
+const BtU32 NumMaterials = 2;
+
+// Meshes added with their materials interleaved, so each one changes program unsorted
+const BtU32 NumStateMeshes = 64;
+
+// More than the sort has room for at first
+const BtU32 NumGrowthMeshes = 9000;
+
+struct LFrameCounts
+{
+	BtU32								m_numDrawCalls;
+	BtU32								m_numPrograms;		// Programs made current
+	BtU32								m_numStateChanges;
+};
+
+// One triangle or line as it was drawn
+struct LPrimitive
+{
+	BtU32								m_numVertex;
+	RsVertex3							m_vertex[3];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LSubmitAll
+
+// Every vertex has its own position, colour and UV
+static void LSubmitAll( RsMaterialImpl **ppMaterials )
+{
+	std::vector<RsVertex3> vertex;
+	std::vector<RsVertex2> vertex2;
+	BtU32 index = 0;
+
+	for( BtU32 iSubmit=0; iSubmit<NumSubmits; iSubmit++ )
+	{
+		const LSubmit &submit = g_submits[iSubmit];
+		RsMaterialImpl *pMaterial = ppMaterials[submit.m_material];
+
+		vertex.resize( submit.m_numVertex );
+		vertex2.resize( submit.m_numVertex );
+		BtMemory::Set( &vertex[0], 0, submit.m_numVertex * sizeof( RsVertex3 ) );
+		BtMemory::Set( &vertex2[0], 0, submit.m_numVertex * sizeof( RsVertex2 ) );
+
+		for( BtU32 i=0; i<submit.m_numVertex; i++, index++ )
+		{
+			BtFloat value = (BtFloat)index;
+
+			vertex[i].m_v3Position = MtVector3( value, value * 0.5f, 10.0f );
+			vertex[i].m_colour = 0xFF000000 | index;
+			vertex[i].m_v2UV = MtVector2( value * 0.25f, 1.0f );
+
+			vertex2[i].m_v2Position = MtVector2( value, value * 0.5f );
+			vertex2[i].m_colour = 0xFF000000 | index;
+			vertex2[i].m_v2UV = MtVector2( value * 0.25f, 1.0f );
+		}
+
+		// Only the screen space vertex can be drawn as a fan
+		if( submit.m_type == RsPT_TriangleFan )
+		{
+			pMaterial->Render( submit.m_type, &vertex2[0], submit.m_numVertex, 0 );
+		}
+		else
+		{
+			pMaterial->Render( submit.m_type, &vertex[0], submit.m_numVertex, 0 );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LAddPrimitive
+
+static void LAddPrimitive( std::vector<LPrimitive> &primitives, const RsVertex3 *pVertex, BtU32 a, BtU32 b, BtU32 c, BtU32 numVertex )
+{
+	LPrimitive primitive;
+	BtMemory::Set( &primitive, 0, sizeof( LPrimitive ) );
+
+	// The screen space vertex leaves the rest of the vertex as it finds it
+	const BtU32 corners[3] = { a, b, c };
+
+	for( BtU32 i=0; i<numVertex; i++ )
+	{
+		primitive.m_vertex[i].m_v3Position = pVertex[corners[i]].m_v3Position;
+		primitive.m_vertex[i].m_colour = pVertex[corners[i]].m_colour;
+		primitive.m_vertex[i].m_v2UV = pVertex[corners[i]].m_v2UV;
+	}
+	primitive.m_numVertex = numVertex;
+
+	primitives.push_back( primitive );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetPrimitives
+
+// The triangles and lines the draws make, in the order and winding GL draws them
+static void LGetPrimitives( const std::vector<TsDrawCall> &drawCalls, std::vector<LPrimitive> &primitives )
+{
+	primitives.clear();
+
+	for( BtU32 iDraw=0; iDraw<drawCalls.size(); iDraw++ )
+	{
+		const TsDrawCall &drawCall = drawCalls[iDraw];
+		const RsVertex3 *pVertex = &drawCall.m_vertex[0];
+		BtU32 numVertex = (BtU32)drawCall.m_vertex.size();
+
+		switch( drawCall.m_mode )
+		{
+		case GL_TRIANGLES:
+			for( BtU32 i=0; i+2<numVertex; i+=3 )
+			{
+				LAddPrimitive( primitives, pVertex, i, i + 1, i + 2, 3 );
+			}
+			break;
+
+		case GL_TRIANGLE_STRIP:
+			for( BtU32 i=0; i+2<numVertex; i++ )
+			{
+				if( i & 1 )
+				{
+					LAddPrimitive( primitives, pVertex, i + 1, i, i + 2, 3 );
+				}
+				else
+				{
+					LAddPrimitive( primitives, pVertex, i, i + 1, i + 2, 3 );
+				}
+			}
+			break;
+
+		case GL_TRIANGLE_FAN:
+			for( BtU32 i=1; i+1<numVertex; i++ )
+			{
+				LAddPrimitive( primitives, pVertex, 0, i, i + 1, 3 );
+			}
+			break;
+
+		case GL_LINES:
+			for( BtU32 i=0; i+1<numVertex; i+=2 )
+			{
+				LAddPrimitive( primitives, pVertex, i, i + 1, 0, 2 );
+			}
+			break;
+
+		case GL_LINE_STRIP:
+			for( BtU32 i=0; i+1<numVertex; i++ )
+			{
+				LAddPrimitive( primitives, pVertex, i, i + 1, 0, 2 );
+			}
+			break;
+
+		default:
+			// Something we don't expect, so the comparison fails
+			LAddPrimitive( primitives, pVertex, 0, 0, 0, 0 );
+			break;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LDrawFrame
+
+static void LDrawFrame( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtBool isBatching,
+						std::vector<TsDrawCall> &drawCalls, std::vector<LPrimitive> &primitives )
+{
+	RsRenderTargetWinGL::SetBatching( isBatching );
+
+	TsDraw::BeginFrame( pShader );
+	LSubmitAll( ppMaterials );
+	TsDraw::CaptureFrame();
+
+	TsDraw::GetDrawCalls( drawCalls );
+	LGetPrimitives( drawCalls, primitives );
+
+	RsRenderTargetWinGL::SetBatching( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestBatching
+
+static void LTestBatching( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials )
+{
+	std::vector<TsDrawCall> unbatchedCalls;
+	std::vector<TsDrawCall> batchedCalls;
+	std::vector<LPrimitive> unbatched;
+	std::vector<LPrimitive> batched;
+
+	LDrawFrame( pShader, ppMaterials, BtFalse, unbatchedCalls, unbatched );
+	LDrawFrame( pShader, ppMaterials, BtTrue, batchedCalls, batched );
+
+	// A draw for each submit without batching, a draw for each run with it
+	TsCheck( unbatchedCalls.size() == NumSubmits );
+	TsCheck( batchedCalls.size() == NumBatches );
+
+	// Strips with n vertices have n - 2 triangles, fans the same and lists n / 3
+	BtU32 numPrimitives = 0;
+
+	for( BtU32 i=0; i<NumSubmits; i++ )
+	{
+		BtU32 numVertex = g_submits[i].m_numVertex;
+
+		switch( g_submits[i].m_type )
+		{
+		case RsPT_TriangleStrip:
+		case RsPT_TriangleFan:
+			numPrimitives += ( numVertex > 2 ) ? numVertex - 2 : 0;
+			break;
+		case RsPT_TriangleList:
+			numPrimitives += numVertex / 3;
+			break;
+		case RsPT_LineList:
+			numPrimitives += numVertex / 2;
+			break;
+		case RsPT_LineStrip:
+			numPrimitives += numVertex - 1;
+			break;
+		default:
+			break;
+		}
+	}
+	TsCheck( unbatched.size() == numPrimitives );
+
+	// Batching draws the same triangles and lines, in the same order and winding
+	TsCheck( batched.size() == unbatched.size() );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; ( i < batched.size() ) && ( i < unbatched.size() ); i++ )
+	{
+		if( BtMemory::Compare( &batched[i], &unbatched[i], sizeof( LPrimitive ) ) == BtFalse )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeMeshes
+
+// A row of meshes going away from the camera, added far to near and alternating material
+static void LMakeMeshes( RsSceneImpl *pScene, RsMaterialImpl **ppMaterials, BtU32 numMeshes, std::vector<SgNodeImpl*> &meshes )
+{
+	for( BtU32 i=0; i<numMeshes; i++ )
+	{
+		MtMatrix4 m4World;
+		m4World.SetIdentity();
+		m4World.SetTranslation( 0, 0, 10.0f + ( ( numMeshes - i ) * 0.05f ) );
+
+		meshes.push_back( TsDraw::MakeMesh( pScene, ppMaterials + ( i % NumMaterials ), 1, m4World ) );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LDrawMeshes
+
+static LFrameCounts LDrawMeshes( RsShaderImpl *pShader, const std::vector<SgNodeImpl*> &meshes, BtBool isSorting, BtBool isCapture )
+{
+	RsRenderTargetWinGL::SetSorting( isSorting );
+
+	TsDraw::BeginFrame( pShader );
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		meshes[i]->Render();
+	}
+
+	if( isCapture == BtTrue )
+	{
+		TsDraw::CaptureFrame();
+	}
+	else
+	{
+		TsDraw::EndFrame();
+	}
+
+	RsRenderTargetWinGL::SetSorting( BtTrue );
+
+	LFrameCounts counts;
+	counts.m_numDrawCalls = RsGL::GetFrameStats().m_numDrawCalls;
+	counts.m_numStateChanges = RsGL::GetFrameStats().m_numStateChanges;
+	counts.m_numPrograms = 0;
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		if( RsGL::GetCommand( i ).m_type == RsGLCommand_UseProgram )
+		{
+			++counts.m_numPrograms;
+		}
+	}
+	return counts;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestStateChanges
+
+// The state cache drops binds that change nothing, so what reaches the device is what
+// the draw order costs
+static void LTestStateChanges( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, RsSceneImpl *pScene )
+{
+	std::vector<SgNodeImpl*> meshes;
+	LMakeMeshes( pScene, ppMaterials, NumStateMeshes, meshes );
+
+	RsRenderTargetWinGL::SetInstancing( BtFalse );
+
+	LFrameCounts unsorted = LDrawMeshes( pShader, meshes, BtFalse, BtTrue );
+	LFrameCounts sorted = LDrawMeshes( pShader, meshes, BtTrue, BtTrue );
+
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+
+	// A draw per mesh either way
+	TsCheck( unsorted.m_numDrawCalls == NumStateMeshes );
+	TsCheck( sorted.m_numDrawCalls == NumStateMeshes );
+
+	// Unsorted every mesh changes program. Sorted each program is made current once
+	TsCheck( unsorted.m_numPrograms == NumStateMeshes );
+	TsCheck( sorted.m_numPrograms == NumMaterials );
+
+	// The depth and cull state of the two techniques changes with the program
+	TsCheck( sorted.m_numStateChanges < unsorted.m_numStateChanges );
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		TsDraw::FreeMesh( meshes[i] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestSortGrowth
+
+// Past what the sort has room for the meshes are still sorted, rather than drawn in
+// the order they were added
+static void LTestSortGrowth( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, RsSceneImpl *pScene )
+{
+	std::vector<SgNodeImpl*> meshes;
+	LMakeMeshes( pScene, ppMaterials, NumGrowthMeshes, meshes );
+
+	RsRenderTargetWinGL::SetInstancing( BtFalse );
+
+	BtU32 numGrowths = RsRenderTargetWinGL::GetNumSortGrowths();
+
+	LFrameCounts unsorted = LDrawMeshes( pShader, meshes, BtFalse, BtFalse );
+	LFrameCounts sorted = LDrawMeshes( pShader, meshes, BtTrue, BtFalse );
+
+	// It grew once and the next frame has room
+	TsCheck( RsRenderTargetWinGL::GetNumSortGrowths() == numGrowths + 1 );
+
+	LFrameCounts again = LDrawMeshes( pShader, meshes, BtTrue, BtFalse );
+	TsCheck( RsRenderTargetWinGL::GetNumSortGrowths() == numGrowths + 1 );
+
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+
+	TsCheck( unsorted.m_numDrawCalls == NumGrowthMeshes );
+	TsCheck( sorted.m_numDrawCalls == NumGrowthMeshes );
+	TsCheck( again.m_numDrawCalls == NumGrowthMeshes );
+
+	// Unsorted each mesh's program and depth state changes. Sorted they change once a
+	// program, the same as with a handful of meshes
+	TsCheck( sorted.m_numStateChanges + NumGrowthMeshes < unsorted.m_numStateChanges );
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		TsDraw::FreeMesh( meshes[i] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+	TsCheck( pShader != BtNull );
+
+	if( pShader != BtNull )
+	{
+		RsMaterialImpl *pMaterials[NumMaterials];
+		pMaterials[0] = TsDraw::MakeMaterial( "RsShaderZL", RsMaterial_Lit );
+		pMaterials[1] = TsDraw::MakeMaterial( "RsShaderT2" );
+
+		LTestBatching( pShader, pMaterials );
+
+		RsSceneImpl *pScene = TsDraw::MakeScene();
+
+		LTestStateChanges( pShader, pMaterials, pScene );
+		LTestSortGrowth( pShader, pMaterials, pScene );
+
+		TsDraw::FreeScene( pScene );
+
+		for( BtU32 i=0; i<NumMaterials; i++ )
+		{
+			TsDraw::FreeMaterial( pMaterials[i] );
+		}
+		TsDraw::FreeShader( pShader );
+	}
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "RsRenderTargetTest" );
+}
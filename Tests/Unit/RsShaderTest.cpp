@@ -0,0 +1,766 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsShaderTest.cpp
+
+// Every built in technique sets the GL state and program the old chain of name
+// comparisons in SetTechnique set, which is written out here rather than read from the
+// registry. Each is captured set by name and by handle with the state cache on and off,
+// and all four send the same state, use the same program and upload the same uniforms,
+// with no error checks on the way. Then every uniform the shipped shaders declare outside
+// a sampler is set by name and must be sent to the program of each technique using it. On
+// the null backend the programs report the uniforms their sources declare. Last, the
+// shader is loaded with the program cache: cold it compiles everything and writes the
+// cache, warm it compiles nothing and its programs report the same uniforms, and a cache
+// from other source or a cut short file is ignored and written again
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "ApConfig.h"
+#include "BaFileData.h"
+#include "BtString.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsShaderImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+// What SetTechnique did for each technique before the registry
+struct LExpectedTechnique
+{
+	const BtChar*						m_name;
+	BtU32								m_program;
+	BtBool								m_isDepthTest;
+	GLenum								m_depthFunc;
+	BtBool								m_isCullFace;
+	GLenum								m_frontFace;
+	GLenum								m_sourceBlend;
+	GLenum								m_destBlend;
+};
+
+static const LExpectedTechnique g_expected[RsTechnique_BuiltIn] =
+{
+	{ "RsShaderAdditive",	RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "lensflare",			RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		GL_ONE,			GL_ONE },
+	{ "RsShadow",			RsShadow,				BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsProjectedShadow",	RsProjectedTexture,		BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderT2",			RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderTG",			RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderTG2",		RsShaderPassThrough,	BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderT",			RsShaderTextured,		BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZL",			RsShaderLit,			BtTrue,		GL_LEQUAL,	BtTrue,		GL_CW,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZLTGD",		RsShaderLitTextured,	BtTrue,		0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZLT",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZLTG",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZTG",		RsShaderLitTextured,	BtTrue,		0,			BtTrue,		GL_CW,	GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsShaderZLTS",		RsShaderSkin,			BtTrue,		GL_LEQUAL,	BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+	{ "RsYUVToRGB",			RsYUVToRGB,				BtFalse,	0,			BtFalse,	0,		GL_SRC_ALPHA,	GL_ONE_MINUS_SRC_ALPHA },
+};
+
+// The values the shaders read, all set before each capture
+static const RsHandles g_matrixHandles[] =
+{
+	RsHandles_World,
+	RsHandles_View,
+	RsHandles_ViewInverse,
+	RsHandles_WorldView,
+	RsHandles_ViewScreen,
+	RsHandles_WorldViewScreen,
+	RsHandles_WorldViewInverseTranspose,
+	RsHandles_ViewInverseTranspose,
+	RsHandles_TextureMatrix0,
+};
+
+static const RsHandles g_vectorHandles[] =
+{
+	RsHandles_CameraPosition,
+	RsHandles_BlendWeights,
+	RsHandles_Light0Direction,
+	RsHandles_LightAmbient,
+	RsHandles_Colour,
+};
+
+// A uniform declared in a shipped shader
+struct LUniform
+{
+	BtChar								m_name[64];
+	BtU32								m_command;			// That sends it
+	BtU32								m_floatsPerElement;
+	BtU32								m_count;
+};
+
+// What a capture of a technique reached the device with
+struct LTechniqueCapture
+{
+	std::vector<RsGLCommand>			m_state;			// Enable, Disable, DepthFunc, FrontFace and BlendFunc
+	std::vector<RsGLCommand>			m_uniforms;
+	std::vector<BtU32>					m_programs;			// Each UseProgram
+	BtU32								m_numErrorChecks;	// Each GetError, a round trip to the driver
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsSameCommand
+
+static BtBool LIsSameCommand( const RsGLCommand &a, const RsGLCommand &b )
+{
+	return ( a.m_type == b.m_type ) &&
+		   ( a.m_args[0] == b.m_args[0] ) && ( a.m_args[1] == b.m_args[1] ) &&
+		   ( a.m_args[2] == b.m_args[2] ) && ( a.m_args[3] == b.m_args[3] ) ? BtTrue : BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsSameCommands
+
+static BtBool LIsSameCommands( const std::vector<RsGLCommand> &a, const std::vector<RsGLCommand> &b )
+{
+	if( a.size() != b.size() )
+	{
+		return BtFalse;
+	}
+
+	for( BtU32 i=0; i<a.size(); i++ )
+	{
+		if( LIsSameCommand( a[i], b[i] ) == BtFalse )
+		{
+			return BtFalse;
+		}
+	}
+	return BtTrue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCommand
+
+static RsGLCommand LCommand( BtU32 type, BtU32 arg0, BtU32 arg1 = 0 )
+{
+	RsGLCommand command;
+	BtMemory::Set( &command, 0, sizeof( command ) );
+
+	command.m_type = type;
+	command.m_args[0] = arg0;
+	command.m_args[1] = arg1;
+
+	return command;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetExpectedState
+
+// The state calls the old chain made, in the order the registry makes them
+static std::vector<RsGLCommand> LGetExpectedState( const LExpectedTechnique &expected )
+{
+	std::vector<RsGLCommand> state;
+
+	state.push_back( LCommand( ( expected.m_isDepthTest == BtTrue ) ? RsGLCommand_Enable : RsGLCommand_Disable, GL_DEPTH_TEST ) );
+
+	if( expected.m_depthFunc != 0 )
+	{
+		state.push_back( LCommand( RsGLCommand_DepthFunc, expected.m_depthFunc ) );
+	}
+
+	state.push_back( LCommand( ( expected.m_isCullFace == BtTrue ) ? RsGLCommand_Enable : RsGLCommand_Disable, GL_CULL_FACE ) );
+
+	if( expected.m_frontFace != 0 )
+	{
+		state.push_back( LCommand( RsGLCommand_FrontFace, expected.m_frontFace ) );
+	}
+
+	state.push_back( LCommand( RsGLCommand_Enable, GL_BLEND ) );
+	state.push_back( LCommand( RsGLCommand_BlendFunc, expected.m_sourceBlend, expected.m_destBlend ) );
+
+	return state;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LSetValues
+
+// Sets every value to something it hasn't been so each capture uploads them all
+static void LSetValues( RsShaderImpl *pShader, BtU32 iCapture )
+{
+	BtFloat value = (BtFloat)( iCapture + 1 );
+
+	MtMatrix4 m4Matrix;
+	m4Matrix.SetIdentity();
+	m4Matrix.SetTranslation( value, 0, 0 );
+
+	for( BtU32 i=0; i<sizeof( g_matrixHandles ) / sizeof( g_matrixHandles[0] ); i++ )
+	{
+		pShader->SetMatrix( g_matrixHandles[i], m4Matrix );
+	}
+
+	BtFloat v3Vector[3] = { value, 0, 0 };
+
+	for( BtU32 i=0; i<sizeof( g_vectorHandles ) / sizeof( g_vectorHandles[0] ); i++ )
+	{
+		pShader->SetFloats( g_vectorHandles[i], v3Vector, 3 );
+	}
+
+	MtMatrix4 m4Bones[MaxBoneMatrices];
+
+	for( BtU32 i=0; i<MaxBoneMatrices; i++ )
+	{
+		m4Bones[i] = m4Matrix;
+	}
+	pShader->SetMatrix( "s_m4BoneMatrices", m4Bones, MaxBoneMatrices );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCaptureTechnique
+
+static LTechniqueCapture LCaptureTechnique( RsShaderImpl *pShader, BtU32 technique, BtBool isByName, BtBool isStateCache )
+{
+	static BtU32 numCaptures = 0;
+
+	RsGL::SetStateCache( isStateCache );
+	RsGL::InvalidateState();
+
+	LSetValues( pShader, numCaptures++ );
+
+	RsPrimitive primitive;
+	primitive.m_primitiveType = GL_TRIANGLES;
+	primitive.m_numVertex = 3;
+
+	RsGL::BeginCapture();
+
+	if( isByName == BtTrue )
+	{
+		pShader->SetTechnique( g_expected[technique].m_name );
+	}
+	else
+	{
+		pShader->SetTechnique( technique );
+	}
+	pShader->Draw( &primitive );
+
+	RsGL::EndCapture();
+
+	LTechniqueCapture capture;
+	capture.m_numErrorChecks = 0;
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		const RsGLCommand &command = RsGL::GetCommand( i );
+
+		switch( command.m_type )
+		{
+			case RsGLCommand_Enable:
+			case RsGLCommand_Disable:
+			case RsGLCommand_DepthFunc:
+			case RsGLCommand_FrontFace:
+			case RsGLCommand_BlendFunc:
+				capture.m_state.push_back( command );
+				break;
+
+			case RsGLCommand_Uniform1fv:
+			case RsGLCommand_Uniform2fv:
+			case RsGLCommand_Uniform3fv:
+			case RsGLCommand_Uniform4fv:
+			case RsGLCommand_UniformMatrix4fv:
+				capture.m_uniforms.push_back( command );
+				break;
+
+			case RsGLCommand_UseProgram:
+				capture.m_programs.push_back( command.m_args[0] );
+				break;
+
+			case RsGLCommand_GetError:
+				++capture.m_numErrorChecks;
+				break;
+		}
+	}
+
+	RsGL::SetStateCache( BtTrue );
+
+	return capture;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRegistry
+
+// The registry holds the state of the old chain and finds each technique by its name
+static void LTestRegistry()
+{
+	for( BtU32 i=0; i<RsTechnique_BuiltIn; i++ )
+	{
+		const LExpectedTechnique &expected = g_expected[i];
+		const RsTechnique &state = RsShaderImpl::GetTechniqueState( i );
+
+		TsCheck( RsShaderImpl::GetTechnique( expected.m_name ) == i );
+		TsCheck( state.m_program == expected.m_program );
+		TsCheck( state.m_isDepthTest == expected.m_isDepthTest );
+		TsCheck( state.m_depthFunc == expected.m_depthFunc );
+		TsCheck( state.m_isCullFace == expected.m_isCullFace );
+		TsCheck( state.m_frontFace == expected.m_frontFace );
+		TsCheck( state.m_isBlend == BtTrue );
+		TsCheck( state.m_sourceBlend == expected.m_sourceBlend );
+		TsCheck( state.m_destBlend == expected.m_destBlend );
+	}
+
+	TsCheck( RsShaderImpl::GetTechnique( "RsShaderUnknown" ) == RsTechniqueNone );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestCaptures
+
+static void LTestCaptures( RsShaderImpl *pShader )
+{
+	// The GL program each of ours was first seen to use, and the uniforms it uploaded
+	BtU32 glPrograms[MaxPrograms] = { 0 };
+	std::vector<RsGLCommand> uniforms[MaxPrograms];
+	BtBool isSeen[MaxPrograms] = { BtFalse };
+
+	for( BtU32 i=0; i<RsTechnique_BuiltIn; i++ )
+	{
+		const LExpectedTechnique &expected = g_expected[i];
+
+		LTechniqueCapture captures[4] =
+		{
+			LCaptureTechnique( pShader, i, BtTrue, BtTrue ),
+			LCaptureTechnique( pShader, i, BtFalse, BtTrue ),
+			LCaptureTechnique( pShader, i, BtTrue, BtFalse ),
+			LCaptureTechnique( pShader, i, BtFalse, BtFalse ),
+		};
+
+		std::vector<RsGLCommand> state = LGetExpectedState( expected );
+
+		// The pass through shader reads no uniforms, and the desktop shaders have no
+		// YUV program. The rest read at least their matrices
+		if( ( expected.m_program != RsShaderPassThrough ) && ( expected.m_program != RsYUVToRGB ) )
+		{
+			TsCheck( captures[0].m_uniforms.size() > 0 );
+		}
+
+		// Techniques sharing a program upload the same uniforms
+		if( isSeen[expected.m_program] == BtFalse )
+		{
+			uniforms[expected.m_program] = captures[0].m_uniforms;
+			isSeen[expected.m_program] = BtTrue;
+		}
+		TsCheck( LIsSameCommands( captures[0].m_uniforms, uniforms[expected.m_program] ) == BtTrue );
+
+		for( BtU32 j=0; j<4; j++ )
+		{
+			const LTechniqueCapture &capture = captures[j];
+
+			TsCheck( LIsSameCommands( capture.m_state, state ) == BtTrue );
+			TsCheck( capture.m_programs.size() == 1 );
+			TsCheck( LIsSameCommands( capture.m_uniforms, captures[0].m_uniforms ) == BtTrue );
+			TsCheck( capture.m_numErrorChecks == 0 );
+
+			if( capture.m_programs.size() != 1 )
+			{
+				continue;
+			}
+
+			if( glPrograms[expected.m_program] == 0 )
+			{
+				glPrograms[expected.m_program] = capture.m_programs[0];
+			}
+			TsCheck( capture.m_programs[0] == glPrograms[expected.m_program] );
+		}
+	}
+
+	// Techniques with different programs use different GL programs
+	for( BtU32 i=0; i<MaxPrograms; i++ )
+	{
+		for( BtU32 j=i+1; j<MaxPrograms; j++ )
+		{
+			if( ( glPrograms[i] != 0 ) && ( glPrograms[j] != 0 ) )
+			{
+				TsCheck( glPrograms[i] != glPrograms[j] );
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestUnknown
+
+// An unknown technique keeps the state and program of the last
+static void LTestUnknown( RsShaderImpl *pShader )
+{
+	LTechniqueCapture known = LCaptureTechnique( pShader, RsTechnique_ShaderZL, BtFalse, BtFalse );
+
+	// Without the state cache the program is used again rather than skipped
+	RsGL::SetStateCache( BtFalse );
+
+	RsGL::BeginCapture();
+	pShader->SetTechnique( "RsShaderUnknown" );
+	RsGL::EndCapture();
+
+	RsGL::SetStateCache( BtTrue );
+
+	BtU32 numState = 0;
+	BtU32 program = 0;
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		const RsGLCommand &command = RsGL::GetCommand( i );
+
+		if( command.m_type == RsGLCommand_UseProgram )
+		{
+			program = command.m_args[0];
+		}
+		else if( ( command.m_type == RsGLCommand_Enable ) || ( command.m_type == RsGLCommand_Disable ) ||
+				 ( command.m_type == RsGLCommand_BlendFunc ) )
+		{
+			++numState;
+		}
+	}
+	TsCheck( numState == 0 );
+	TsCheck( ( known.m_programs.size() == 1 ) && ( program == known.m_programs[0] ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadUniforms
+
+// Adds the uniforms the shader declares as "uniform type name;" or "uniform type
+// name[size];", which is how the shipped shaders declare them. Samplers are left out.
+// Returns false if the file isn't there or a uniform has a type we don't send
+static BtBool LReadUniforms( const BtChar *pFilename, std::vector<LUniform> &uniforms )
+{
+	FILE *f = fopen( pFilename, "r" );
+
+	if( f == BtNull )
+	{
+		return BtFalse;
+	}
+
+	BtBool isKnown = BtTrue;
+	BtChar line[256];
+
+	while( fgets( line, sizeof( line ), f ) != BtNull )
+	{
+		BtChar type[64];
+		BtChar name[64];
+
+		if( sscanf( line, " uniform %63s %63[^;[ ]", type, name ) != 2 )
+		{
+			continue;
+		}
+
+		if( strncmp( type, "sampler", 7 ) == 0 )
+		{
+			continue;
+		}
+
+		LUniform uniform;
+		BtStrCopy( uniform.m_name, 64, name );
+
+		const BtChar *pSize = strchr( line, '[' );
+		uniform.m_count = ( pSize != BtNull ) ? (BtU32)atoi( pSize + 1 ) : 1;
+
+		if( strcmp( type, "mat4" ) == 0 )
+		{
+			uniform.m_command = RsGLCommand_UniformMatrix4fv;
+			uniform.m_floatsPerElement = 16;
+		}
+		else if( strcmp( type, "vec4" ) == 0 )
+		{
+			uniform.m_command = RsGLCommand_Uniform4fv;
+			uniform.m_floatsPerElement = 4;
+		}
+		else if( strcmp( type, "vec3" ) == 0 )
+		{
+			uniform.m_command = RsGLCommand_Uniform3fv;
+			uniform.m_floatsPerElement = 3;
+		}
+		else if( strcmp( type, "vec2" ) == 0 )
+		{
+			uniform.m_command = RsGLCommand_Uniform2fv;
+			uniform.m_floatsPerElement = 2;
+		}
+		else if( strcmp( type, "float" ) == 0 )
+		{
+			uniform.m_command = RsGLCommand_Uniform1fv;
+			uniform.m_floatsPerElement = 1;
+		}
+		else
+		{
+			isKnown = BtFalse;
+			continue;
+		}
+
+		// The vertex and fragment shader may both declare it
+		BtBool isAdded = BtFalse;
+
+		for( BtU32 i=0; i<uniforms.size(); i++ )
+		{
+			if( strcmp( uniforms[i].m_name, uniform.m_name ) == 0 )
+			{
+				isAdded = BtTrue;
+			}
+		}
+
+		if( isAdded == BtFalse )
+		{
+			uniforms.push_back( uniform );
+		}
+	}
+	fclose( f );
+
+	return isKnown;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LReadShaderList
+
+// The vertex and fragment shader file of each program, in program order
+static void LReadShaderList( std::vector<std::string> &filenames )
+{
+	std::string folder = TsShaderList;
+	folder = folder.substr( 0, folder.rfind( '/' ) + 1 );
+
+	FILE *f = fopen( TsShaderList, "r" );
+
+	if( f == BtNull )
+	{
+		return;
+	}
+
+	BtChar name[64];
+
+	while( fscanf( f, "%63s", name ) == 1 )
+	{
+		filenames.push_back( folder + name );
+	}
+	fclose( f );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestReflection
+
+static void LTestReflection( RsShaderImpl *pShader )
+{
+	std::vector<std::string> filenames;
+	LReadShaderList( filenames );
+
+	BtU32 numPrograms = (BtU32)filenames.size() / 2;
+	TsCheck( numPrograms > 0 );
+
+	BtBool isTested[MaxPrograms] = { BtFalse };
+	BtU32 numUniforms = 0;
+	BtU32 numValue = 0;
+
+	RsPrimitive primitive;
+	primitive.m_primitiveType = GL_TRIANGLES;
+	primitive.m_numVertex = 3;
+
+	for( BtU32 technique=0; technique<RsTechnique_BuiltIn; technique++ )
+	{
+		BtU32 program = RsShaderImpl::GetTechniqueState( technique ).m_program;
+
+		// Programs the list doesn't have aren't made
+		if( ( program >= numPrograms ) || ( isTested[program] == BtTrue ) )
+		{
+			continue;
+		}
+		isTested[program] = BtTrue;
+
+		std::vector<LUniform> uniforms;
+		TsCheck( LReadUniforms( filenames[program * 2 + 0].c_str(), uniforms ) == BtTrue );
+		TsCheck( LReadUniforms( filenames[program * 2 + 1].c_str(), uniforms ) == BtTrue );
+
+		// Send everything once, then each uniform on its own
+		pShader->SetTechnique( technique );
+		pShader->Draw( &primitive );
+
+		for( BtU32 i=0; i<uniforms.size(); i++ )
+		{
+			const LUniform &uniform = uniforms[i];
+
+			std::vector<BtFloat> values( uniform.m_floatsPerElement * uniform.m_count, (BtFloat)++numValue );
+			pShader->SetFloats( uniform.m_name, &values[0], (BtU32)values.size() );
+
+			RsGL::BeginCapture();
+			pShader->SetTechnique( technique );
+			pShader->Draw( &primitive );
+			RsGL::EndCapture();
+
+			BtU32 numSent = 0;
+			BtBool isSentWhole = BtFalse;
+
+			for( BtU32 j=0; j<RsGL::GetNumCommands(); j++ )
+			{
+				const RsGLCommand &command = RsGL::GetCommand( j );
+
+				if( ( command.m_type >= RsGLCommand_Uniform1fv ) && ( command.m_type <= RsGLCommand_UniformMatrix4fv ) )
+				{
+					++numSent;
+					isSentWhole = ( command.m_type == uniform.m_command ) && ( command.m_args[1] == uniform.m_count ) ? BtTrue : BtFalse;
+				}
+			}
+
+			if( ( numSent != 1 ) || ( isSentWhole == BtFalse ) )
+			{
+				printf( "%s isn't sent to %s\n", uniform.m_name, filenames[program * 2].c_str() );
+			}
+			TsCheck( numSent == 1 );
+			TsCheck( isSentWhole == BtTrue );
+		}
+		numUniforms += (BtU32)uniforms.size();
+	}
+
+	// The lit, textured and skinned shaders have their matrices and lights at least
+	TsCheck( numUniforms > 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LLoadWithCache
+
+struct LCacheLoad
+{
+	RsShaderImpl					   *m_pShader;
+	BtU32								m_numCompiled;			// Shaders compiled
+	BtU32								m_numBinaries;			// Programs loaded from binaries
+	BtU32								m_numSaved;				// Binaries read back to save
+};
+
+// Loads the shader with the program cache on, counting what it sends the device
+static LCacheLoad LLoadWithCache()
+{
+	RsGL::BeginCapture();
+
+	LCacheLoad load;
+	load.m_pShader = TsDraw::MakeShader();
+	load.m_numCompiled = 0;
+	load.m_numBinaries = 0;
+	load.m_numSaved = 0;
+
+	RsGL::EndCapture();
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		switch( RsGL::GetCommand( i ).m_type )
+		{
+			case RsGLCommand_CompileShader:
+				++load.m_numCompiled;
+				break;
+
+			case RsGLCommand_ProgramBinary:
+				++load.m_numBinaries;
+				break;
+
+			case RsGLCommand_GetProgramBinary:
+				++load.m_numSaved;
+				break;
+		}
+	}
+	return load;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestProgramCache
+
+static void LTestProgramCache()
+{
+	// The cache is written to the documents folder and named after the archive. TsDraw's
+	// archive has no name, so the documents prefix names the file
+	const BtChar *pCacheFilename = "RsShaderTest.glcache";
+	ApConfig::SetDocuments( "RsShaderTest" );
+	remove( pCacheFilename );
+
+	RsShaderImpl::SetProgramCache( BtTrue );
+
+	// Cold. Every program is compiled and saved
+	LCacheLoad cold = LLoadWithCache();
+	TsCheck( cold.m_pShader != BtNull );
+	TsCheck( cold.m_numCompiled > 0 );
+	TsCheck( cold.m_numBinaries == 0 );
+	TsCheck( cold.m_numSaved > 0 );
+	TsDraw::FreeShader( cold.m_pShader );
+
+	FILE *f = fopen( pCacheFilename, "rb" );
+	TsCheck( f != BtNull );
+
+	RsProgramCacheHeader header;
+	BtMemory::Set( &header, 0, sizeof( header ) );
+
+	if( f != BtNull )
+	{
+		TsCheck( fread( &header, sizeof( header ), 1, f ) == 1 );
+		fclose( f );
+	}
+	TsCheck( header.m_magic == RsProgramCacheMagic );
+	TsCheck( header.m_numPrograms == cold.m_numSaved );
+
+	// Warm. Nothing is compiled or saved, and the programs have the uniforms they had
+	LCacheLoad warm = LLoadWithCache();
+	TsCheck( warm.m_numCompiled == 0 );
+	TsCheck( warm.m_numBinaries == cold.m_numSaved );
+	TsCheck( warm.m_numSaved == 0 );
+	LTestReflection( warm.m_pShader );
+	TsDraw::FreeShader( warm.m_pShader );
+
+	// From other source. It's compiled again and the cache rewritten, then used
+	header.m_sourceHash = ~header.m_sourceHash;
+	f = fopen( pCacheFilename, "r+b" );
+
+	if( f != BtNull )
+	{
+		fwrite( &header, sizeof( header ), 1, f );
+		fclose( f );
+	}
+
+	LCacheLoad stale = LLoadWithCache();
+	TsCheck( stale.m_numCompiled == cold.m_numCompiled );
+	TsCheck( stale.m_numBinaries == 0 );
+	TsCheck( stale.m_numSaved == cold.m_numSaved );
+	TsDraw::FreeShader( stale.m_pShader );
+
+	LCacheLoad rewritten = LLoadWithCache();
+	TsCheck( rewritten.m_numCompiled == 0 );
+	TsCheck( rewritten.m_numBinaries == cold.m_numSaved );
+	TsDraw::FreeShader( rewritten.m_pShader );
+
+	// Cut short inside the header
+	f = fopen( pCacheFilename, "wb" );
+
+	if( f != BtNull )
+	{
+		fwrite( &header, sizeof( header ) / 2, 1, f );
+		fclose( f );
+	}
+
+	LCacheLoad truncated = LLoadWithCache();
+	TsCheck( truncated.m_numCompiled == cold.m_numCompiled );
+	TsCheck( truncated.m_numSaved == cold.m_numSaved );
+	TsDraw::FreeShader( truncated.m_pShader );
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+	remove( pCacheFilename );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	LTestRegistry();
+	LTestCaptures( pShader );
+	LTestUnknown( pShader );
+	LTestReflection( pShader );
+
+	TsDraw::FreeShader( pShader );
+
+	LTestProgramCache();
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "RsShaderTest" );
+}
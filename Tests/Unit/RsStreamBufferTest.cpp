@@ -0,0 +1,346 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsStreamBufferTest.cpp
+
+// Writes to the stream buffer land aligned in the current frame's region, which moves on
+// each frame and comes round again after RsStreamBufferFrames. Without the ring every
+// write reallocates the buffer, and a write that doesn't fit spills into a buffer of its
+// own until the ring grows. Then vertices drawn through the render system are read back
+// from the offsets their attribute pointers were given, with the ring on and off
+
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "RsStreamBufferImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 FrameSize = 4096;
+const BtU32 Alignment = 16;
+const BtU32 NumFrames = 7;
+const BtU32 NumDraws = 50;
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeData
+
+static void LMakeData( std::vector<BtU8> &data, BtU32 size, BtU32 seed )
+{
+	data.resize( size );
+
+	for( BtU32 i=0; i<size; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (BtU8)( seed >> 24 );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsWritten
+
+// The bytes at the offset of the buffer are the data
+static BtBool LIsWritten( GLuint buffer, BtU32 offset, const std::vector<BtU8> &data )
+{
+	BtU32 size;
+	const BtU8 *pData = RsGL::GetBufferData( buffer, size );
+
+	if( ( pData == BtNull ) || ( offset + data.size() > size ) )
+	{
+		return BtFalse;
+	}
+	return BtMemory::Compare( pData + offset, &data[0], (BtU32)data.size() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LFindCommand
+
+// The last captured command of the type, or null
+static const RsGLCommand *LFindCommand( BtU32 type )
+{
+	const RsGLCommand *pFound = BtNull;
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		if( RsGL::GetCommand( i ).m_type == type )
+		{
+			pFound = &RsGL::GetCommand( i );
+		}
+	}
+	return pFound;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRing
+
+static void LTestRing()
+{
+	const BtU32 sizes[] = { 100, 37, 500, 16, 1 };
+	const BtU32 numSizes = sizeof( sizes ) / sizeof( sizes[0] );
+
+	RsStreamBufferImpl streamBuffer;
+	streamBuffer.CreateOnDevice( GL_ARRAY_BUFFER, FrameSize, Alignment );
+
+	BtU32 lastRegion = ~0u;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		streamBuffer.BeginFrame();
+
+		BtU32 region = ~0u;
+		BtU32 end = 0;
+
+		for( BtU32 i=0; i<numSizes; i++ )
+		{
+			std::vector<BtU8> data;
+			LMakeData( data, sizes[i], iFrame * numSizes + i );
+
+			RsGL::BeginCapture();
+			BtU32 offset = streamBuffer.Write( &data[0], sizes[i] );
+			RsGL::EndCapture();
+
+			// Each write is aligned, after the last and in the same region as the rest of the frame
+			TsCheck( offset % Alignment == 0 );
+			TsCheck( offset >= end );
+			end = offset + sizes[i];
+
+			if( region == ~0u )
+			{
+				region = offset / FrameSize;
+			}
+			TsCheck( offset / FrameSize == region );
+			TsCheck( ( end - 1 ) / FrameSize == region );
+
+			// It was mapped where it was said to be and nothing was reallocated
+			const RsGLCommand *pMap = LFindCommand( RsGLCommand_MapBufferRange );
+			TsCheck( pMap != BtNull );
+			TsCheck( ( pMap != BtNull ) && ( pMap->m_args[1] == offset ) && ( pMap->m_args[2] == sizes[i] ) );
+			TsCheck( LFindCommand( RsGLCommand_BufferData ) == BtNull );
+
+			TsCheck( LIsWritten( streamBuffer.GetHandle(), offset, data ) == BtTrue );
+		}
+
+		// Frames take the regions in turn
+		TsCheck( region < RsStreamBufferFrames );
+
+		if( lastRegion != ~0u )
+		{
+			TsCheck( region == ( lastRegion + 1 ) % RsStreamBufferFrames );
+		}
+		lastRegion = region;
+
+		streamBuffer.EndFrame();
+	}
+	TsCheck( streamBuffer.GetNumOverflows() == 0 );
+
+	streamBuffer.RemoveFromDevice();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestOrphan
+
+static void LTestOrphan()
+{
+	RsStreamBufferImpl streamBuffer;
+	streamBuffer.CreateOnDevice( GL_ARRAY_BUFFER, FrameSize, Alignment );
+	streamBuffer.SetRing( BtFalse );
+
+	for( BtU32 iFrame=0; iFrame<3; iFrame++ )
+	{
+		streamBuffer.BeginFrame();
+
+		std::vector<BtU8> data;
+		LMakeData( data, 300 + iFrame, iFrame );
+
+		RsGL::BeginCapture();
+		BtU32 offset = streamBuffer.Write( &data[0], (BtU32)data.size() );
+		RsGL::EndCapture();
+
+		// The buffer is reallocated to the size of the write
+		const RsGLCommand *pBufferData = LFindCommand( RsGLCommand_BufferData );
+		TsCheck( offset == 0 );
+		TsCheck( ( pBufferData != BtNull ) && ( pBufferData->m_args[1] == data.size() ) );
+		TsCheck( LFindCommand( RsGLCommand_MapBufferRange ) == BtNull );
+		TsCheck( LIsWritten( streamBuffer.GetHandle(), 0, data ) == BtTrue );
+
+		streamBuffer.EndFrame();
+	}
+
+	// Going back to the ring puts its storage back
+	streamBuffer.SetRing( BtTrue );
+
+	BtU32 size;
+	RsGL::GetBufferData( streamBuffer.GetHandle(), size );
+	TsCheck( size == FrameSize * RsStreamBufferFrames );
+
+	streamBuffer.RemoveFromDevice();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestOverflow
+
+static void LTestOverflow()
+{
+	const BtU32 WriteSize = FrameSize * 3 / 4;
+
+	RsStreamBufferImpl streamBuffer;
+	streamBuffer.CreateOnDevice( GL_ARRAY_BUFFER, FrameSize, Alignment );
+
+	std::vector<BtU8> first;
+	std::vector<BtU8> second;
+	LMakeData( first, WriteSize, 1 );
+	LMakeData( second, WriteSize, 2 );
+
+	streamBuffer.BeginFrame();
+	BtU32 firstOffset = streamBuffer.Write( &first[0], WriteSize );
+
+	// The second write doesn't fit so it goes to the spill buffer, leaving the first alone
+	RsGL::BeginCapture();
+	BtU32 secondOffset = streamBuffer.Write( &second[0], WriteSize );
+	RsGL::EndCapture();
+
+	const RsGLCommand *pBind = LFindCommand( RsGLCommand_BindBuffer );
+	GLuint spillBuffer = ( pBind != BtNull ) ? pBind->m_args[1] : 0;
+
+	TsCheck( secondOffset == 0 );
+	TsCheck( ( spillBuffer != 0 ) && ( spillBuffer != streamBuffer.GetHandle() ) );
+	TsCheck( LIsWritten( spillBuffer, 0, second ) == BtTrue );
+	TsCheck( LIsWritten( streamBuffer.GetHandle(), firstOffset, first ) == BtTrue );
+	TsCheck( streamBuffer.GetNumOverflows() == 1 );
+
+	streamBuffer.EndFrame();
+
+	// From the next frame the ring has grown to take both
+	streamBuffer.BeginFrame();
+	firstOffset = streamBuffer.Write( &first[0], WriteSize );
+	secondOffset = streamBuffer.Write( &second[0], WriteSize );
+
+	TsCheck( secondOffset > firstOffset );
+	TsCheck( LIsWritten( streamBuffer.GetHandle(), firstOffset, first ) == BtTrue );
+	TsCheck( LIsWritten( streamBuffer.GetHandle(), secondOffset, second ) == BtTrue );
+	TsCheck( streamBuffer.GetNumOverflows() == 1 );
+
+	streamBuffer.EndFrame();
+	streamBuffer.RemoveFromDevice();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeTriangle
+
+static void LMakeTriangle( RsVertex3 *pVertex, BtU32 index )
+{
+	BtMemory::Set( pVertex, 0, sizeof( RsVertex3 ) * 3 );
+
+	for( BtU32 i=0; i<3; i++ )
+	{
+		BtFloat value = (BtFloat)( index * 3 + i );
+
+		pVertex[i].m_v3Position = MtVector3( value, -value, 10.0f );
+		pVertex[i].m_v3Normal = MtVector3( 0, 0, -1.0f );
+		pVertex[i].m_colour = 0xFF000000 | ( index * 3 + i );
+		pVertex[i].m_v2UV = MtVector2( value * 0.5f, value * 0.25f );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LDrawFrame
+
+// Draws the triangles, copied into the frame's vertex or straight from our memory, and
+// returns what the device was given to draw
+static void LDrawFrame( RsShaderImpl *pShader, RsMaterialImpl *pMaterial, std::vector<RsVertex3> &vertex,
+						BtU32 firstTriangle, BtU32 numTriangles, BtBool isCopy, std::vector<RsVertex3> &drawn )
+{
+	TsDraw::BeginFrame( pShader );
+
+	for( BtU32 i=0; i<numTriangles; i++ )
+	{
+		RsVertex3 *pVertex = &vertex[( firstTriangle + i ) * 3];
+		LMakeTriangle( pVertex, firstTriangle + i );
+		pMaterial->Render( RsPT_TriangleList, pVertex, 3, 0, isCopy );
+	}
+
+	TsDraw::CaptureFrame();
+
+	std::vector<TsDrawCall> drawCalls;
+	TsDraw::GetDrawCalls( drawCalls );
+
+	for( BtU32 i=0; i<drawCalls.size(); i++ )
+	{
+		drawn.insert( drawn.end(), drawCalls[i].m_vertex.begin(), drawCalls[i].m_vertex.end() );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestDraw
+
+static void LTestDraw( RsShaderImpl *pShader, RsMaterialImpl *pMaterial )
+{
+	RsRenderTargetWinGL::SetBatching( BtFalse );
+
+	std::vector<RsVertex3> vertex( NumDraws * 3 );
+
+	for( BtU32 isCopy=0; isCopy<2; isCopy++ )
+	{
+		// The ring takes a frame of draws at a time
+		RsImplWinGL::SetStreamRing( BtTrue );
+
+		for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+		{
+			std::vector<RsVertex3> drawn;
+			LDrawFrame( pShader, pMaterial, vertex, 0, NumDraws, (BtBool)isCopy, drawn );
+
+			TsCheck( drawn.size() == vertex.size() );
+			TsCheck( ( drawn.size() == vertex.size() ) && ( BtMemory::Compare( &drawn[0], &vertex[0], (BtU32)( vertex.size() * sizeof( RsVertex3 ) ) ) == BtTrue ) );
+		}
+
+		// Without it each draw reallocates the buffer, so only the last draw of a frame can be
+		// read back afterwards. Draw one a frame
+		RsImplWinGL::SetStreamRing( BtFalse );
+
+		for( BtU32 i=0; i<NumDraws; i++ )
+		{
+			std::vector<RsVertex3> drawn;
+			LDrawFrame( pShader, pMaterial, vertex, i, 1, (BtBool)isCopy, drawn );
+
+			TsCheck( drawn.size() == 3 );
+			TsCheck( ( drawn.size() == 3 ) && ( BtMemory::Compare( &drawn[0], &vertex[i * 3], sizeof( RsVertex3 ) * 3 ) == BtTrue ) );
+		}
+	}
+
+	RsImplWinGL::SetStreamRing( BtTrue );
+	RsRenderTargetWinGL::SetBatching( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	BtTime::Init();
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	LTestRing();
+	LTestOrphan();
+	LTestOverflow();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+	TsCheck( pShader != BtNull );
+
+	if( pShader != BtNull )
+	{
+		RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL", RsMaterial_Lit );
+
+		LTestDraw( pShader, pMaterial );
+
+		TsDraw::FreeMaterial( pMaterial );
+		TsDraw::FreeShader( pShader );
+	}
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "RsStreamBufferTest" );
+}
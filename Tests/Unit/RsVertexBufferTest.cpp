@@ -0,0 +1,357 @@
+////////////////////////////////////////////////////////////////////////////////
+// RsVertexBufferTest.cpp
+
+// Meshes drawn from vertex array objects see the same attribute layout as meshes with
+// their attributes set up by hand. The capture of a scene being made and drawn is played
+// back through the vertex array state GL keeps, and each draw's enabled attributes, their
+// pointers and buffers and the index buffer must match with vertex arrays on and off.
+// Immediate mode draws go between the meshes, so the default vertex array is used again
+// after a mesh's, and the meshes are drawn instanced and not
+
+#include <map>
+#include <vector>
+#include "BtMemory.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "RsVertexBufferImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumMaterials = 2;
+const BtU32 NumMeshes = 8;
+
+// Covers the instance matrix columns as well as the mesh attributes
+const BtU32 MaxAttribs = 16;
+
+struct LAttrib
+{
+	BtU32								m_isEnabled;
+	BtU32								m_size;
+	BtU32								m_stride;
+	BtU32								m_offset;
+	BtU32								m_buffer;
+	BtU32								m_divisor;
+};
+
+// What GL keeps in a vertex array
+struct LVertexArray
+{
+	LAttrib								m_attribs[MaxAttribs];
+	BtU32								m_elementBuffer;
+};
+
+// The layout a draw was made with. Buffers are numbered in the order the draws first
+// use them, as the two scenes are given different names
+struct LLayout
+{
+	BtU32								m_type;
+	BtU32								m_elementBuffer;
+	LAttrib								m_attribs[MaxAttribs];
+};
+
+struct LFrame
+{
+	std::vector<LLayout>				m_layouts;
+	BtU32								m_numVertexArrayBinds;		// Of a vertex array other than the default
+	BtU32								m_numMeshDraws;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumberBuffer
+
+static BtU32 LNumberBuffer( std::map<BtU32, BtU32> &numbers, BtU32 buffer )
+{
+	if( buffer == 0 )
+	{
+		return 0;
+	}
+
+	std::map<BtU32, BtU32>::iterator it = numbers.find( buffer );
+
+	if( it != numbers.end() )
+	{
+		return it->second;
+	}
+
+	BtU32 number = (BtU32)numbers.size() + 1;
+	numbers[buffer] = number;
+
+	return number;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LPlayCapture
+
+// Plays the capture through the vertex array state, starting from GL's defaults
+static LFrame LPlayCapture()
+{
+	std::map<BtU32, LVertexArray> vertexArrays;
+	std::map<BtU32, BtU32> numbers;
+
+	LFrame frame;
+	frame.m_numVertexArrayBinds = 0;
+	frame.m_numMeshDraws = 0;
+
+	BtU32 vertexArray = 0;
+	BtU32 arrayBuffer = 0;
+
+	BtMemory::Set( &vertexArrays[0], 0, sizeof( LVertexArray ) );
+
+	for( BtU32 i=0; i<RsGL::GetNumCommands(); i++ )
+	{
+		const RsGLCommand &command = RsGL::GetCommand( i );
+		LVertexArray &current = vertexArrays[vertexArray];
+
+		switch( command.m_type )
+		{
+			case RsGLCommand_GenVertexArrays:
+				break;
+
+			case RsGLCommand_BindVertexArray:
+				vertexArray = command.m_args[0];
+
+				if( vertexArrays.find( vertexArray ) == vertexArrays.end() )
+				{
+					// A new vertex array starts with every attribute off
+					BtMemory::Set( &vertexArrays[vertexArray], 0, sizeof( LVertexArray ) );
+				}
+				if( vertexArray != 0 )
+				{
+					++frame.m_numVertexArrayBinds;
+				}
+				break;
+
+			case RsGLCommand_BindBuffer:
+				if( command.m_args[0] == GL_ARRAY_BUFFER )
+				{
+					arrayBuffer = command.m_args[1];
+				}
+				else if( command.m_args[0] == GL_ELEMENT_ARRAY_BUFFER )
+				{
+					current.m_elementBuffer = command.m_args[1];
+				}
+				break;
+
+			case RsGLCommand_EnableVertexAttribArray:
+			case RsGLCommand_DisableVertexAttribArray:
+				if( command.m_args[0] < MaxAttribs )
+				{
+					current.m_attribs[command.m_args[0]].m_isEnabled = ( command.m_type == RsGLCommand_EnableVertexAttribArray ) ? 1 : 0;
+				}
+				break;
+
+			case RsGLCommand_VertexAttribPointer:
+				if( command.m_args[0] < MaxAttribs )
+				{
+					LAttrib &attrib = current.m_attribs[command.m_args[0]];
+					attrib.m_size = command.m_args[1];
+					attrib.m_stride = command.m_args[2];
+					attrib.m_offset = command.m_args[3];
+					attrib.m_buffer = arrayBuffer;
+				}
+				break;
+
+			case RsGLCommand_VertexAttribDivisor:
+				if( command.m_args[0] < MaxAttribs )
+				{
+					current.m_attribs[command.m_args[0]].m_divisor = command.m_args[1];
+				}
+				break;
+
+			case RsGLCommand_DrawArrays:
+			case RsGLCommand_DrawElements:
+			case RsGLCommand_DrawElementsInstanced:
+			{
+				LLayout layout;
+				BtMemory::Set( &layout, 0, sizeof( layout ) );
+
+				layout.m_type = command.m_type;
+
+				if( command.m_type != RsGLCommand_DrawArrays )
+				{
+					layout.m_elementBuffer = LNumberBuffer( numbers, current.m_elementBuffer );
+					++frame.m_numMeshDraws;
+				}
+
+				// Only what the enabled attributes point at is read
+				for( BtU32 j=0; j<MaxAttribs; j++ )
+				{
+					if( current.m_attribs[j].m_isEnabled == 1 )
+					{
+						layout.m_attribs[j] = current.m_attribs[j];
+					}
+				}
+
+				// Immediate mode vertices and instance matrices are wherever the stream ring
+				// wrote them that frame, so offsets are kept relative to the lowest read from
+				// each buffer
+				for( BtU32 j=0; j<MaxAttribs; j++ )
+				{
+					if( layout.m_attribs[j].m_isEnabled == 1 )
+					{
+						BtU32 base = layout.m_attribs[j].m_offset;
+
+						for( BtU32 k=0; k<MaxAttribs; k++ )
+						{
+							if( ( current.m_attribs[k].m_isEnabled == 1 ) && ( current.m_attribs[k].m_buffer == current.m_attribs[j].m_buffer ) )
+							{
+								base = MtMin( base, current.m_attribs[k].m_offset );
+							}
+						}
+						layout.m_attribs[j].m_offset -= base;
+						layout.m_attribs[j].m_buffer = LNumberBuffer( numbers, current.m_attribs[j].m_buffer );
+					}
+				}
+				frame.m_layouts.push_back( layout );
+				break;
+			}
+		}
+	}
+	return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LDrawScene
+
+// Makes a scene with vertex arrays on or off and draws a frame of it, capturing both
+static LFrame LDrawScene( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtBool isVertexArrays, BtBool isInstancing )
+{
+	RsVertexBufferImpl::SetVertexArrays( isVertexArrays );
+	RsRenderTargetWinGL::SetInstancing( isInstancing );
+
+	RsGL::InvalidateState();
+	RsGL::BeginCapture();
+
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	std::vector<SgNodeImpl*> meshes;
+
+	for( BtU32 i=0; i<NumMeshes; i++ )
+	{
+		MtMatrix4 m4World;
+		m4World.SetIdentity();
+		m4World.SetTranslation( (BtFloat)i - 4.0f, 0, 20.0f );
+
+		meshes.push_back( TsDraw::MakeMesh( pScene, ppMaterials + ( i % NumMaterials ), 1, m4World ) );
+	}
+
+	RsVertex3 triangle[3];
+	BtMemory::Set( triangle, 0, sizeof( triangle ) );
+
+	for( BtU32 i=0; i<3; i++ )
+	{
+		triangle[i].m_v3Position = MtVector3( (BtFloat)( i & 1 ), (BtFloat)( i >> 1 ), 10.0f );
+		triangle[i].m_colour = 0xFFFFFFFF;
+	}
+
+	TsDraw::BeginFrame( pShader );
+
+	for( BtU32 i=0; i<NumMeshes; i++ )
+	{
+		meshes[i]->Render();
+		ppMaterials[i % NumMaterials]->Render( RsPT_TriangleList, triangle, 3, 0 );
+	}
+	TsDraw::EndFrame();
+
+	RsGL::EndCapture();
+
+	LFrame frame = LPlayCapture();
+
+	for( BtU32 i=0; i<meshes.size(); i++ )
+	{
+		TsDraw::FreeMesh( meshes[i] );
+	}
+	TsDraw::FreeScene( pScene );
+
+	RsVertexBufferImpl::SetVertexArrays( BtTrue );
+	RsRenderTargetWinGL::SetInstancing( BtTrue );
+
+	return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestLayouts
+
+static void LTestLayouts( RsShaderImpl *pShader, RsMaterialImpl **ppMaterials, BtBool isInstancing )
+{
+	LFrame vertexArrays = LDrawScene( pShader, ppMaterials, BtTrue, isInstancing );
+	LFrame byHand = LDrawScene( pShader, ppMaterials, BtFalse, isInstancing );
+
+	// Each path was taken
+	TsCheck( vertexArrays.m_numVertexArrayBinds > 0 );
+	TsCheck( byHand.m_numVertexArrayBinds == 0 );
+
+	TsCheck( vertexArrays.m_numMeshDraws > 0 );
+	TsCheck( vertexArrays.m_numMeshDraws == byHand.m_numMeshDraws );
+	TsCheck( vertexArrays.m_layouts.size() == byHand.m_layouts.size() );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; ( i < vertexArrays.m_layouts.size() ) && ( i < byHand.m_layouts.size() ); i++ )
+	{
+		if( BtMemory::Compare( &vertexArrays.m_layouts[i], &byHand.m_layouts[i], sizeof( LLayout ) ) == BtFalse )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+
+	// The meshes read positions and normals from the same buffer, with their indices
+	BtU32 numMeshLayouts = 0;
+
+	for( BtU32 i=0; i<vertexArrays.m_layouts.size(); i++ )
+	{
+		const LLayout &layout = vertexArrays.m_layouts[i];
+
+		if( layout.m_type == RsGLCommand_DrawArrays )
+		{
+			continue;
+		}
+
+		if( ( layout.m_attribs[0].m_isEnabled == 1 ) && ( layout.m_attribs[1].m_isEnabled == 1 ) &&
+			( layout.m_attribs[0].m_buffer == layout.m_attribs[1].m_buffer ) &&
+			( layout.m_attribs[1].m_offset == sizeof( MtVector3 ) ) && ( layout.m_elementBuffer != 0 ) )
+		{
+			++numMeshLayouts;
+		}
+	}
+	TsCheck( numMeshLayouts == vertexArrays.m_numMeshDraws );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterials[NumMaterials];
+	pMaterials[0] = TsDraw::MakeMaterial( "RsShaderZL" );
+	pMaterials[1] = TsDraw::MakeMaterial( "RsShaderZLT" );
+
+	LTestLayouts( pShader, pMaterials, BtFalse );
+	LTestLayouts( pShader, pMaterials, BtTrue );
+
+	for( BtU32 i=0; i<NumMaterials; i++ )
+	{
+		TsDraw::FreeMaterial( pMaterials[i] );
+	}
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "RsVertexBufferTest" );
+}
@@ -0,0 +1,374 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgBoundsTreeTest.cpp
+
+// Culling through the bounds tree finds the same meshes as testing every mesh's world
+// sphere against the frustum, from cameras all over a generated level and after meshes
+// and the groups they hang from have moved and the tree has been refit. Hidden meshes
+// are left out either way, and every skin is passed on whatever the frustum, once. Picking and finding meshes near a point through a root's own
+// tree find what the walk of every node finds with the tree turned off
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+#include "MtMatrix3.h"
+#include "RsCamera.h"
+#include "SgBoundsTreeImpl.h"
+#include "SgMesh.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 NumGroups = 60;
+const BtU32 NumMeshesPerGroup = 40;
+const BtU32 NumViews = 24;
+const BtU32 NumMoves = 5;
+const BtU32 NumQueries = 200;
+const BtU32 MaxNear = 4096;
+const BtFloat LevelSize = 2000.0f;
+
+struct LLevel
+{
+	SgNodeImpl						   *m_pRoot;
+	std::vector<SgNodeImpl*>			m_groups;
+	std::vector<SgNodeImpl*>			m_meshes;
+	BtU32								m_numSkins;				// Shown ones
+};
+
+// What the flush of a cull is testing against and the meshes it found inside
+static const RsFrustum *g_pFrustum = BtNull;
+static std::vector<SgNodeImpl*> g_culled;
+static BtU32 g_numSkins = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeLevel
+
+// Groups of meshes spread over the level. Every third mesh has another below it, every
+// seventh is skinned and every eleventh is hidden
+static LLevel LMakeLevel()
+{
+	LLevel level;
+	level.m_numSkins = 0;
+
+	MtMatrix4 m4Identity;
+	m4Identity.SetIdentity();
+
+	level.m_pRoot = TsScene::MakeNode( "root", m4Identity );
+
+	BtChar name[MaxSceneNodeName];
+
+	for( BtU32 iGroup=0; iGroup<NumGroups; iGroup++ )
+	{
+		sprintf( name, "group_%d", iGroup );
+		SgNodeImpl *pGroup = TsScene::MakeNode( name, TsScene::RandomLocal( LevelSize * 0.5f, LevelSize * 0.025f ) );
+		level.m_pRoot->AddChild( pGroup );
+		level.m_groups.push_back( pGroup );
+
+		for( BtU32 i=0; i<NumMeshesPerGroup; i++ )
+		{
+			sprintf( name, "mesh_%d_%d", iGroup, i );
+			BtBool isSkin = ( ( level.m_meshes.size() + 1 ) % 7 == 0 ) ? BtTrue : BtFalse;
+
+			SgNodeImpl *pMesh = TsScene::MakeNode( name, TsScene::RandomLocal( 100.0f, 5.0f ), BtTrue, isSkin );
+			pGroup->AddChild( pMesh );
+			level.m_meshes.push_back( pMesh );
+
+			if( level.m_meshes.size() % 11 == 0 )
+			{
+				pMesh->SetRendered( BtFalse );
+			}
+			else if( isSkin == BtTrue )
+			{
+				++level.m_numSkins;
+			}
+
+			if( i % 3 == 0 )
+			{
+				sprintf( name, "mesh_%d_%d_child", iGroup, i );
+				SgNodeImpl *pChild = TsScene::MakeNode( name, TsScene::RandomLocal( 10.0f, 0.5f ), BtTrue );
+				pMesh->AddChild( pChild );
+				level.m_meshes.push_back( pChild );
+			}
+		}
+	}
+	level.m_pRoot->Update();
+
+	return level;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetWorldSphere
+
+// Worked out as a mesh works out its own
+static void LGetWorldSphere( SgNodeImpl *pNode, MtVector3 &v3Center, BtFloat &radius )
+{
+	const MtAABB &AABB = pNode->GetMesh()->GetAABB();
+
+	v3Center = AABB.Center();
+	MtVector3 v3Edge = v3Center + MtVector3( 0, 0, AABB.Radius() );
+
+	v3Center *= pNode->GetWorldTransform();
+	v3Edge *= pNode->GetWorldTransform();
+
+	radius = ( v3Edge - v3Center ).GetLength();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LFlush
+
+static void LFlush( SgRenderBatch &batch )
+{
+	g_pFrustum->IsInside( batch.m_x, batch.m_y, batch.m_z, batch.m_radius, batch.m_numNodes, batch.m_isInside );
+
+	for( BtU32 i=0; i<batch.m_numNodes; i++ )
+	{
+		if( batch.m_pNodes[i]->NodeType() & SgType_Skin )
+		{
+			++g_numSkins;
+		}
+
+		if( batch.m_isInside[i] == BtTrue )
+		{
+			g_culled.push_back( batch.m_pNodes[i] );
+		}
+	}
+	batch.m_numNodes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCullTree
+
+static std::vector<SgNodeImpl*> LCullTree( const SgBoundsTreeImpl &tree, const RsFrustum &frustum )
+{
+	SgRenderBatch batch;
+	batch.m_numNodes = 0;
+
+	g_pFrustum = &frustum;
+	g_culled.clear();
+	g_numSkins = 0;
+
+	tree.Cull( frustum, batch, LFlush );
+	LFlush( batch );
+
+	std::sort( g_culled.begin(), g_culled.end() );
+	return g_culled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LCullEvery
+
+static std::vector<SgNodeImpl*> LCullEvery( const LLevel &level, const RsFrustum &frustum )
+{
+	std::vector<SgNodeImpl*> culled;
+
+	for( BtU32 i=0; i<level.m_meshes.size(); i++ )
+	{
+		SgNodeImpl *pNode = level.m_meshes[i];
+
+		if( pNode->IsRendered() == BtFalse )
+		{
+			continue;
+		}
+
+		MtVector3 v3Center;
+		BtFloat radius;
+		LGetWorldSphere( pNode, v3Center, radius );
+
+		if( frustum.IsInside( v3Center, radius ) == BtTrue )
+		{
+			culled.push_back( pNode );
+		}
+	}
+	std::sort( culled.begin(), culled.end() );
+	return culled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeCamera
+
+// Somewhere in the level looking along the ground, or now and then down on all of it
+static RsCamera LMakeCamera( BtU32 view )
+{
+	RsCamera camera( 0.1f, 400.0f, 800.0f / 600.0f, RsViewport( 0, 0, 800, 600 ), MtDegreesToRadians( 60.0f ) );
+
+	MtMatrix3 m3Rotation;
+	m3Rotation.SetRotationY( TsTest::Random( -3.0f, 3.0f ) );
+
+	if( view % 8 == 0 )
+	{
+		camera.FarPlane( 5000.0f );
+		camera.SetPosition( MtVector3( 0, 0, -LevelSize * 1.5f ) );
+		m3Rotation.SetIdentity();
+	}
+	else
+	{
+		camera.SetPosition( MtVector3( TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ), 0, TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ) ) );
+	}
+	camera.SetRotation( m3Rotation );
+	camera.Update();
+
+	return camera;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestCull
+
+static void LTestCull( const LLevel &level, const SgBoundsTreeImpl &tree )
+{
+	BtU32 numWrong = 0;
+	BtU32 numWrongSkins = 0;
+	BtU32 numSeen = 0;
+	BtU32 numPartial = 0;
+
+	for( BtU32 view=0; view<NumViews; view++ )
+	{
+		RsCamera camera = LMakeCamera( view );
+
+		std::vector<SgNodeImpl*> fromTree = LCullTree( tree, camera.GetFrustum() );
+		std::vector<SgNodeImpl*> fromEvery = LCullEvery( level, camera.GetFrustum() );
+
+		if( fromTree != fromEvery )
+		{
+			++numWrong;
+		}
+
+		if( g_numSkins != level.m_numSkins )
+		{
+			++numWrongSkins;
+		}
+		numSeen += (BtU32)fromEvery.size();
+
+		if( ( fromEvery.size() > 0 ) && ( fromEvery.size() < level.m_meshes.size() / 4 ) )
+		{
+			++numPartial;
+		}
+	}
+	TsCheck( numWrong == 0 );
+	TsCheck( numWrongSkins == 0 );
+	TsCheck( level.m_numSkins > 0 );
+
+	// The views see something, and most only part of the level
+	TsCheck( numSeen > 0 );
+	TsCheck( numPartial > NumViews / 2 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestQueries
+
+// Through the root's own tree and by walking every node
+static void LTestQueries( const LLevel &level )
+{
+	static SgNode *pNearTree[MaxNear];
+	static SgNode *pNearEvery[MaxNear];
+
+	BtU32 numWrongPicks = 0;
+	BtU32 numPicked = 0;
+	BtU32 numWrongNear = 0;
+	BtU32 numNear = 0;
+
+	for( BtU32 i=0; i<NumQueries; i++ )
+	{
+		// From above the level down through somewhere near a mesh, so most lines hit one
+		MtVector3 v3Center;
+		BtFloat meshRadius;
+		LGetWorldSphere( level.m_meshes[(BtU32)TsTest::Random( 0, (BtFloat)level.m_meshes.size() - 1 )], v3Center, meshRadius );
+
+		MtVector3 v3Target = v3Center + MtVector3( TsTest::Random( -2.0f, 2.0f ), TsTest::Random( -2.0f, 2.0f ), TsTest::Random( -2.0f, 2.0f ) );
+		MtVector3 v3From = v3Target + MtVector3( TsTest::Random( -200.0f, 200.0f ), 200.0f, TsTest::Random( -200.0f, 200.0f ) );
+		MtVector3 v3To = v3Target + ( v3Target - v3From );
+
+		SgNodeImpl::SetBoundsTree( BtTrue );
+		SgNode *pPickedTree = level.m_pRoot->pPick( v3From, v3To );
+		SgNodeImpl::SetBoundsTree( BtFalse );
+		SgNode *pPickedEvery = level.m_pRoot->pPick( v3From, v3To );
+
+		numWrongPicks += ( pPickedTree != pPickedEvery ) ? 1 : 0;
+		numPicked += ( pPickedEvery != BtNull ) ? 1 : 0;
+
+		MtVector3 v3Position( TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ), 0, TsTest::Random( -LevelSize * 0.5f, LevelSize * 0.5f ) );
+		BtFloat radius = TsTest::Random( 1.0f, 150.0f );
+
+		SgNodeImpl::SetBoundsTree( BtTrue );
+		BtU32 numTree = level.m_pRoot->FindNear( v3Position, radius, pNearTree, MaxNear );
+		SgNodeImpl::SetBoundsTree( BtFalse );
+		BtU32 numEvery = level.m_pRoot->FindNear( v3Position, radius, pNearEvery, MaxNear );
+
+		std::sort( pNearTree, pNearTree + numTree );
+		std::sort( pNearEvery, pNearEvery + numEvery );
+
+		if( ( numTree != numEvery ) || ( std::equal( pNearTree, pNearTree + numTree, pNearEvery ) == false ) )
+		{
+			++numWrongNear;
+		}
+		numNear += numEvery;
+	}
+	SgNodeImpl::SetBoundsTree( BtTrue );
+
+	TsCheck( numWrongPicks == 0 );
+	TsCheck( numWrongNear == 0 );
+	TsCheck( numPicked > NumQueries / 4 );
+	TsCheck( numNear > 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMove
+
+// Moves some groups and some meshes, then updates the level, which refits the root's tree
+static void LMove( LLevel &level, SgBoundsTreeImpl &tree )
+{
+	for( BtU32 i=0; i<level.m_groups.size(); i += 7 )
+	{
+		level.m_groups[i]->SetLocalTransform( TsScene::RandomLocal( LevelSize * 0.5f, LevelSize * 0.025f ) );
+	}
+
+	for( BtU32 i=0; i<level.m_meshes.size(); i += 13 )
+	{
+		SgNodeImpl *pMesh = level.m_meshes[i];
+		BtFloat spread = ( pMesh->pParent() == level.m_pRoot ) ? LevelSize * 0.5f : 100.0f;
+		pMesh->SetLocalTransform( TsScene::RandomLocal( spread, spread * 0.05f ) );
+	}
+	level.m_pRoot->Update();
+
+	// Our own tree moves every mesh's bounds and refits
+	for( BtU32 i=0; i<level.m_meshes.size(); i++ )
+	{
+		MtVector3 v3Center;
+		BtFloat radius;
+		LGetWorldSphere( level.m_meshes[i], v3Center, radius );
+
+		tree.SetBounds( level.m_meshes[i], v3Center, radius );
+	}
+	tree.Refit();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	LLevel level = LMakeLevel();
+
+	SgBoundsTreeImpl tree;
+	tree.Build( level.m_pRoot );
+
+	TsCheck( tree.IsBuilt() == BtTrue );
+	TsCheck( tree.GetNumEntries() == level.m_meshes.size() );
+
+	LTestCull( level, tree );
+	LTestQueries( level );
+
+	for( BtU32 i=0; i<NumMoves; i++ )
+	{
+		LMove( level, tree );
+
+		LTestCull( level, tree );
+		LTestQueries( level );
+	}
+
+	// Built again from where the meshes are now
+	tree.Build( level.m_pRoot );
+	LTestCull( level, tree );
+
+	tree.Destroy();
+	TsScene::FreeNodes( level.m_pRoot );
+
+	return TsTest::Finish( "SgBoundsTreeTest" );
+}
@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgFindTest.cpp
+
+// pFind through the name table finds what the recursive search finds, searching from any
+// node of a rig for every name it has and names it hasn't. Of nodes with the same name
+// the first walked at or below the node searched from is found. The table follows nodes
+// that are removed, added and duplicated
+
+#include <string>
+#include <vector>
+#include "BtString.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 NumRigNodes = 1000;
+const BtU32 NumSameName = 5000;
+
+struct LRig
+{
+	SgNodeImpl						   *m_pRoot;
+	std::vector<SgNodeImpl*>			m_nodes;
+	std::vector<std::string>			m_names;
+};
+
+static LRig g_rig;
+
+////////////////////////////////////////////////////////////////////////////////
+// LFindRecursive
+
+static SgNode *LFindRecursive( SgNode *pNode, const BtChar *pName )
+{
+	SgNodeImpl::SetNameTable( BtFalse );
+	SgNode *pFound = pNode->pFind( pName );
+	SgNodeImpl::SetNameTable( BtTrue );
+
+	return pFound;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumDifferent
+
+// Searches from every node in nodes for every name of the rig and a few it hasn't got
+static BtU32 LNumDifferent( const std::vector<SgNodeImpl*> &nodes )
+{
+	BtU32 numDifferent = 0;
+
+	for( BtU32 iNode=0; iNode<nodes.size(); iNode++ )
+	{
+		for( BtU32 iName=0; iName<g_rig.m_names.size(); iName++ )
+		{
+			const BtChar *pName = g_rig.m_names[iName].c_str();
+
+			if( nodes[iNode]->pFind( pName ) != LFindRecursive( nodes[iNode], pName ) )
+			{
+				++numDifferent;
+			}
+		}
+	}
+	return numDifferent;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LIsBelow
+
+static BtBool LIsBelow( SgNode *pNode, SgNode *pAncestor )
+{
+	for( ; pNode != BtNull; pNode = pNode->pParent() )
+	{
+		if( pNode == pAncestor )
+		{
+			return BtTrue;
+		}
+	}
+	return BtFalse;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestDuplicateNames
+
+static void LTestDuplicateNames()
+{
+	SgNodeImpl *pRoot = g_rig.m_pRoot;
+
+	// The first tip walked from the root
+	SgNode *pTip = pRoot->pFind( "tip" );
+	TsCheck( pTip != BtNull );
+	TsCheck( pTip == LFindRecursive( pRoot, "tip" ) );
+
+	// Each digit finds its own tip rather than the first
+	BtU32 numTips = 0;
+	BtU32 numOwnTips = 0;
+
+	for( BtU32 i=0; i<g_rig.m_nodes.size(); i++ )
+	{
+		SgNodeImpl *pNode = g_rig.m_nodes[i];
+
+		if( BtStrCompare( pNode->pName(), "tip" ) == BtTrue )
+		{
+			++numTips;
+
+			SgNode *pDigit = pNode->pParent();
+
+			if( ( pDigit->pFind( "tip" ) == pNode ) && ( pNode->pFind( "tip" ) == pNode ) )
+			{
+				++numOwnTips;
+			}
+		}
+	}
+	TsCheck( numTips == 60 );
+	TsCheck( numOwnTips == numTips );
+
+	// A limb finds an attachment point below it
+	SgNode *pLimb = pRoot->pFind( "R_leg_0" );
+	SgNode *pAttach = pLimb->pFind( "attach" );
+	TsCheck( pAttach != BtNull );
+	TsCheck( LIsBelow( pAttach, pLimb ) == BtTrue );
+
+	// Names no node has, or only nodes elsewhere have, aren't found
+	TsCheck( pRoot->pFind( "missing" ) == BtNull );
+	TsCheck( pRoot->pFind( "" ) == BtNull );
+	TsCheck( pRoot->pFind( "tip " ) == BtNull );
+	TsCheck( pRoot->pFind( "TIP" ) == BtNull );
+	TsCheck( pAttach->pFind( "tip" ) == BtNull );
+	TsCheck( pLimb->pFind( "L_leg_0" ) == BtNull );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestReparenting
+
+// A limb moved to the end of the spine is found there and not where it was
+static void LTestReparenting()
+{
+	SgNodeImpl *pRoot = g_rig.m_pRoot;
+	SgNodeImpl *pLimb = (SgNodeImpl*)pRoot->pFind( "L_leg_0" );
+	SgNodeImpl *pSpine = (SgNodeImpl*)pRoot->pFind( "spine_9" );
+	SgNode *pDigit = pRoot->pFind( "L_leg_digit2_1" );
+
+	((SgNodeImpl*)pLimb->pParent())->RemoveChild( pLimb );
+
+	TsCheck( pRoot->pFind( "L_leg_digit2_1" ) == BtNull );
+	TsCheck( pLimb->pFind( "L_leg_digit2_1" ) == pDigit );
+	TsCheck( pLimb->pFind( "tip" ) == LFindRecursive( pLimb, "tip" ) );
+
+	pSpine->AddChild( pLimb );
+
+	TsCheck( pRoot->pFind( "L_leg_digit2_1" ) == pDigit );
+	TsCheck( LNumDifferent( g_rig.m_nodes ) == 0 );
+
+	pRoot->Update();
+	TsCheck( LNumDifferent( g_rig.m_nodes ) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestDuplicate
+
+// A duplicate of an attachment point added to its limb is walked ahead of the original.
+// Only a leaf is copied, as a duplicate finds its children through the archive
+static void LTestDuplicate()
+{
+	SgNodeImpl *pRoot = g_rig.m_pRoot;
+	SgNodeImpl *pLimb = (SgNodeImpl*)pRoot->pFind( "C_wing_3" );
+	SgNode *pAttach = pLimb->pFind( "attach" );
+	TsCheck( pAttach->pParent() == pLimb );
+
+	SgNodeImpl *pCopy = (SgNodeImpl*)pAttach->GetDuplicate();
+	TsCheck( pCopy->pFind( "attach" ) == pCopy );
+
+	// Added as the limb's first child
+	pLimb->AddChild( pCopy );
+
+	TsCheck( pLimb->pFind( "attach" ) == pCopy );
+	TsCheck( pAttach->pFind( "attach" ) == pAttach );
+	TsCheck( LNumDifferent( g_rig.m_nodes ) == 0 );
+
+	pLimb->RemoveChild( pCopy );
+	TsScene::FreeNodes( pCopy );
+
+	TsCheck( pLimb->pFind( "attach" ) == pAttach );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestSameName
+
+// Thousands of nodes of one name, each of which finds itself
+static void LTestSameName()
+{
+	MtMatrix4 m4Identity;
+	m4Identity.SetIdentity();
+
+	SgNodeImpl *pRoot = TsScene::MakeNode( "root", m4Identity );
+	std::vector<SgNodeImpl*> nodes;
+
+	for( BtU32 i=0; i<NumSameName; i++ )
+	{
+		// Every tenth starts a branch the next nine hang from
+		SgNodeImpl *pParent = ( i % 10 == 0 ) ? pRoot : nodes[i - i % 10];
+
+		SgNodeImpl *pNode = TsScene::MakeNode( "member", m4Identity );
+		pParent->AddChild( pNode );
+		nodes.push_back( pNode );
+	}
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 i=0; i<NumSameName; i++ )
+	{
+		if( nodes[i]->pFind( "member" ) != nodes[i] )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+	TsCheck( pRoot->pFind( "member" ) == LFindRecursive( pRoot, "member" ) );
+	TsCheck( pRoot->pFind( "root" ) == pRoot );
+	TsCheck( nodes[0]->pFind( "root" ) == BtNull );
+
+	TsScene::FreeNodes( pRoot );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	g_rig.m_pRoot = TsScene::MakeRig( NumRigNodes, g_rig.m_nodes );
+	TsCheck( g_rig.m_nodes.size() == NumRigNodes );
+
+	for( BtU32 i=0; i<g_rig.m_nodes.size(); i++ )
+	{
+		g_rig.m_names.push_back( g_rig.m_nodes[i]->pName() );
+	}
+	g_rig.m_names.push_back( "missing" );
+	g_rig.m_names.push_back( "" );
+	g_rig.m_names.push_back( "spine_10" );
+	g_rig.m_names.push_back( "tip " );
+
+	// The first pFind builds the table and Update leaves it as it is
+	TsCheck( LNumDifferent( g_rig.m_nodes ) == 0 );
+	g_rig.m_pRoot->Update();
+	TsCheck( LNumDifferent( g_rig.m_nodes ) == 0 );
+
+	LTestDuplicateNames();
+	LTestReparenting();
+	LTestDuplicate();
+	LTestSameName();
+
+	TsScene::FreeNodes( g_rig.m_pRoot );
+
+	return TsTest::Finish( "SgFindTest" );
+}
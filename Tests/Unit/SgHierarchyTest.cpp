@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgHierarchyTest.cpp
+
+// The flattened hierarchy works out world transforms that match the recursive path to
+// the bit, on deep and wide trees, after random moves, when a subtree is updated on its
+// own and after nodes are removed and added again. Two copies of each tree are moved the
+// same way, one updated flattened and the other recursively, and both are compared with
+// world transforms worked out here from the local ones
+
+#include <vector>
+#include "BtMemory.h"
+#include "MtMatrix4.h"
+#include "TsScene.h"
+#include "TsTest.h"
+
+const BtU32 DeepLength = 2000;
+const BtU32 WideGroups = 100;
+const BtU32 WideGroupSize = 100;
+const BtU32 NumFrames = 20;
+const BtU32 MaxMovedPerFrame = 50;
+
+struct LTree
+{
+	std::vector<SgNodeImpl*>			m_nodes;				// The root first
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeDeep
+
+static void LMakeDeep( LTree &tree, BtU32 seed )
+{
+	TsTest::SetSeed( seed );
+
+	tree.m_nodes.push_back( TsScene::MakeNode( "root", TsScene::RandomLocal( 5.0f, 5.0f, BtTrue ) ) );
+
+	for( BtU32 i=0; i<DeepLength; i++ )
+	{
+		SgNodeImpl *pNode = TsScene::MakeNode( "link", TsScene::RandomLocal( 5.0f, 5.0f, BtTrue ) );
+		tree.m_nodes.back()->AddChild( pNode );
+		tree.m_nodes.push_back( pNode );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMakeWide
+
+// Groups below the root, each with a row of nodes and meshes below it
+static void LMakeWide( LTree &tree, BtU32 seed )
+{
+	TsTest::SetSeed( seed );
+
+	SgNodeImpl *pRoot = TsScene::MakeNode( "root", TsScene::RandomLocal( 5.0f, 5.0f, BtTrue ) );
+	tree.m_nodes.push_back( pRoot );
+
+	for( BtU32 iGroup=0; iGroup<WideGroups; iGroup++ )
+	{
+		SgNodeImpl *pGroup = TsScene::MakeNode( "group", TsScene::RandomLocal( 5.0f, 5.0f, BtTrue ) );
+		pRoot->AddChild( pGroup );
+		tree.m_nodes.push_back( pGroup );
+
+		for( BtU32 i=0; i<WideGroupSize; i++ )
+		{
+			SgNodeImpl *pNode = TsScene::MakeNode( "member", TsScene::RandomLocal( 5.0f, 5.0f, BtTrue ), ( i & 1 ) ? BtTrue : BtFalse );
+			pGroup->AddChild( pNode );
+			tree.m_nodes.push_back( pNode );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LUpdate
+
+static void LUpdate( SgNodeImpl *pNode, BtBool isFlat )
+{
+	SgNodeImpl::SetFlatTransforms( isFlat );
+	pNode->Update();
+	SgNodeImpl::SetFlatTransforms( BtTrue );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumDifferent
+
+static BtU32 LNumDifferent( LTree &flat, LTree &recursive )
+{
+	BtU32 numDifferent = 0;
+
+	for( BtU32 i=0; i<flat.m_nodes.size(); i++ )
+	{
+		if( BtMemory::Compare( &flat.m_nodes[i]->GetWorldTransform(), &recursive.m_nodes[i]->GetWorldTransform(), sizeof( MtMatrix4 ) ) == BtFalse )
+		{
+			++numDifferent;
+		}
+	}
+	return numDifferent;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LNumWrong
+
+// Walks the nodes below pRoot with a stack, multiplying each local transform by its
+// parent's world transform, and counts those whose world transform is different
+static BtU32 LNumWrong( SgNodeImpl *pRoot )
+{
+	struct LEntry
+	{
+		SgNodeImpl					   *m_pNode;
+		MtMatrix4						m_m4World;
+	};
+
+	std::vector<LEntry> stack( 1 );
+	stack[0].m_pNode = pRoot;
+	stack[0].m_m4World = pRoot->GetLocalTransform();
+
+	BtU32 numWrong = 0;
+
+	while( stack.empty() == false )
+	{
+		LEntry entry = stack.back();
+		stack.pop_back();
+
+		if( BtMemory::Compare( &entry.m_pNode->GetWorldTransform(), &entry.m_m4World, sizeof( MtMatrix4 ) ) == BtFalse )
+		{
+			++numWrong;
+		}
+
+		for( SgNode *pChild = entry.m_pNode->pFirstChild(); pChild != BtNull; pChild = pChild->pNextSibling() )
+		{
+			LEntry child;
+			child.m_pNode = (SgNodeImpl*)pChild;
+			child.m_m4World = pChild->GetLocalTransform() * entry.m_m4World;
+			stack.push_back( child );
+		}
+	}
+	return numWrong;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LMoveBoth
+
+// Moves the same nodes of both trees to the same places
+static void LMoveBoth( LTree &flat, LTree &recursive, BtU32 numMoved )
+{
+	for( BtU32 i=0; i<numMoved; i++ )
+	{
+		BtU32 index = TsTest::Random( (BtU32)flat.m_nodes.size() );
+		MtMatrix4 m4Local = TsScene::RandomLocal( 5.0f, 5.0f, BtTrue );
+
+		flat.m_nodes[index]->SetLocalTransform( m4Local );
+		recursive.m_nodes[index]->SetLocalTransform( m4Local );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestMoves
+
+static void LTestMoves( LTree &flat, LTree &recursive )
+{
+	SgNodeImpl *pFlatRoot = flat.m_nodes[0];
+	SgNodeImpl *pRecursiveRoot = recursive.m_nodes[0];
+
+	LUpdate( pFlatRoot, BtTrue );
+	LUpdate( pRecursiveRoot, BtFalse );
+	TsCheck( LNumDifferent( flat, recursive ) == 0 );
+	TsCheck( LNumWrong( pFlatRoot ) == 0 );
+
+	BtU32 numDifferent = 0;
+	BtU32 numWrong = 0;
+	BtU32 numSubtreesDifferent = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		LMoveBoth( flat, recursive, TsTest::Random( MaxMovedPerFrame ) + 1 );
+
+		// Now and again a node moves and only its subtree is updated. Nodes moved elsewhere
+		// have their own world transforms but those below them wait for the root's update
+		if( iFrame % 5 == 4 )
+		{
+			BtU32 index = TsTest::Random( (BtU32)flat.m_nodes.size() );
+			MtMatrix4 m4Local = TsScene::RandomLocal( 5.0f, 5.0f, BtTrue );
+
+			flat.m_nodes[index]->SetLocalTransform( m4Local );
+			recursive.m_nodes[index]->SetLocalTransform( m4Local );
+
+			LUpdate( flat.m_nodes[index], BtTrue );
+			LUpdate( recursive.m_nodes[index], BtFalse );
+			numSubtreesDifferent += LNumDifferent( flat, recursive );
+		}
+
+		LUpdate( pFlatRoot, BtTrue );
+		LUpdate( pRecursiveRoot, BtFalse );
+		numDifferent += LNumDifferent( flat, recursive );
+		numWrong += LNumWrong( pFlatRoot );
+	}
+	TsCheck( numSubtreesDifferent == 0 );
+	TsCheck( numDifferent == 0 );
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestRebuild
+
+// A node removed from the middle moves while it is a root of its own and is then added
+// below another. The flattened hierarchy is built again with it in its new place
+static void LTestRebuild( LTree &flat, LTree &recursive )
+{
+	SgNodeImpl *pFlatRoot = flat.m_nodes[0];
+	SgNodeImpl *pRecursiveRoot = recursive.m_nodes[0];
+
+	BtU32 index = (BtU32)flat.m_nodes.size() / 2;
+	SgNodeImpl *pFlatNode = flat.m_nodes[index];
+	SgNodeImpl *pRecursiveNode = recursive.m_nodes[index];
+
+	((SgNodeImpl*)pFlatNode->pParent())->RemoveChild( pFlatNode );
+	((SgNodeImpl*)pRecursiveNode->pParent())->RemoveChild( pRecursiveNode );
+
+	MtMatrix4 m4Local = TsScene::RandomLocal( 5.0f, 5.0f, BtTrue );
+	pFlatNode->SetLocalTransform( m4Local );
+	pRecursiveNode->SetLocalTransform( m4Local );
+
+	LUpdate( pFlatNode, BtTrue );
+	LUpdate( pRecursiveNode, BtFalse );
+	TsCheck( LNumDifferent( flat, recursive ) == 0 );
+	TsCheck( LNumWrong( pFlatNode ) == 0 );
+
+	flat.m_nodes[1]->AddChild( pFlatNode );
+	recursive.m_nodes[1]->AddChild( pRecursiveNode );
+
+	LMoveBoth( flat, recursive, MaxMovedPerFrame );
+
+	LUpdate( pFlatRoot, BtTrue );
+	LUpdate( pRecursiveRoot, BtFalse );
+	TsCheck( LNumDifferent( flat, recursive ) == 0 );
+	TsCheck( LNumWrong( pFlatRoot ) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestSwitching
+
+// Turning the flattened transforms off and on again between updates loses no moves
+static void LTestSwitching( LTree &flat, LTree &recursive )
+{
+	SgNodeImpl *pFlatRoot = flat.m_nodes[0];
+	SgNodeImpl *pRecursiveRoot = recursive.m_nodes[0];
+
+	for( BtU32 iFrame=0; iFrame<4; iFrame++ )
+	{
+		LMoveBoth( flat, recursive, MaxMovedPerFrame );
+
+		LUpdate( pFlatRoot, ( iFrame & 1 ) ? BtTrue : BtFalse );
+		LUpdate( pRecursiveRoot, BtFalse );
+		TsCheck( LNumDifferent( flat, recursive ) == 0 );
+	}
+	TsCheck( LNumWrong( pFlatRoot ) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestTree
+
+static void LTestTree( void (*makeTree)( LTree&, BtU32 ) )
+{
+	LTree flat;
+	LTree recursive;
+
+	makeTree( flat, 1 );
+	makeTree( recursive, 1 );
+	TsCheck( LNumDifferent( flat, recursive ) == 0 );
+
+	LTestMoves( flat, recursive );
+	LTestRebuild( flat, recursive );
+	LTestSwitching( flat, recursive );
+
+	TsScene::FreeNodes( flat.m_nodes[0] );
+	TsScene::FreeNodes( recursive.m_nodes[0] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	LTestTree( LMakeDeep );
+	LTestTree( LMakeWide );
+
+	return TsTest::Finish( "SgHierarchyTest" );
+}
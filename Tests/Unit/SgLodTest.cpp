@@ -0,0 +1,335 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgLodTest.cpp
+
+// Meshes pick their level of detail from their projected size, and the triangles that
+// reach the device drop as the camera moves away and come back as it returns. Each step
+// is checked against the levels the screen sizes and the hysteresis give, levels switch
+// further out than they switch back, and a mesh held near a boundary doesn't flicker.
+// Two views of the same mesh each keep their own level. Meshes with no levels, or with
+// levels turned off, always draw every triangle
+
+#include <vector>
+#include "ApConfig.h"
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "RsRenderTargetImpl.h"
+#include "RsUtil.h"
+#include "SgMesh.h"
+#include "SgMeshImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+const BtU32 NumLods = 4;
+const BtFloat ScreenSizes[NumLods] = { 0.2f, 0.1f, 0.05f, 0 };
+
+// The triangles of each level of TsDraw's cube
+const BtU32 NumTriangles[NumLods] = { 12, 6, 3, 1 };
+
+const BtU32 NumSteps = 400;
+const BtFloat NearDistance = 4.0f;
+const BtFloat FarDistance = 400.0f;
+const BtU32 NumJitterFrames = 50;
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetCamera
+
+// Looking down z at the mesh from distance away
+static RsCamera LGetCamera( BtFloat distance )
+{
+	RsCamera camera = TsDraw::GetCamera();
+	camera.SetPosition( MtVector3( 0, 0, -distance ) );
+	camera.Update();
+
+	return camera;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetDistance
+
+static BtFloat LGetDistance( BtU32 step )
+{
+	return NearDistance + ( FarDistance - NearDistance ) * step / ( NumSteps - 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LExpectLod
+
+// The level a mesh at lod moves to at distance, worked out as the mesh does
+static BtU32 LExpectLod( SgNodeImpl *pMesh, BtU32 lod, BtFloat distance )
+{
+	BtFloat radius = pMesh->GetMesh()->GetAABB().Radius();
+	BtFloat size = radius * LGetCamera( distance ).GetProjection()._11 / distance;
+
+	while( ( lod + 1 < NumLods ) && ( size < ScreenSizes[lod] * ( 1.0f - MeshLodHysteresis ) ) )
+	{
+		++lod;
+	}
+
+	while( ( lod > 0 ) && ( size > ScreenSizes[lod - 1] * ( 1.0f + MeshLodHysteresis ) ) )
+	{
+		--lod;
+	}
+	return lod;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LGetBoundary
+
+// The distance the first coarser level takes over at, without the hysteresis
+static BtFloat LGetBoundary( SgNodeImpl *pMesh )
+{
+	BtFloat radius = pMesh->GetMesh()->GetAABB().Radius();
+
+	return radius * LGetCamera( 1.0f ).GetProjection()._11 / ScreenSizes[0];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestWalk
+
+// Out to the far distance and back again
+static void LTestWalk( RsShaderImpl *pShader, SgNodeImpl *pMesh )
+{
+	BtU32 lod = 0;
+	BtU32 numWrong = 0;
+	BtU32 numIncreases = 0;
+	BtU32 last = NumTriangles[0];
+
+	// Where each level was first drawn on the way out
+	BtFloat outAt[NumLods] = { 0 };
+
+	for( BtU32 step=0; step<NumSteps; step++ )
+	{
+		BtFloat distance = LGetDistance( step );
+
+		BtU32 numTriangles = TsDraw::DrawFrame( pShader, LGetCamera( distance ), pMesh );
+
+		BtU32 expected = LExpectLod( pMesh, lod, distance );
+
+		if( expected != lod )
+		{
+			outAt[expected] = distance;
+		}
+		lod = expected;
+
+		if( numTriangles != NumTriangles[lod] )
+		{
+			++numWrong;
+		}
+
+		if( numTriangles > last )
+		{
+			++numIncreases;
+		}
+		last = numTriangles;
+	}
+
+	// Every level was drawn and the far end has the fewest triangles
+	TsCheck( numWrong == 0 );
+	TsCheck( numIncreases == 0 );
+	TsCheck( last == NumTriangles[NumLods - 1] );
+
+	for( BtU32 iLod=1; iLod<NumLods; iLod++ )
+	{
+		TsCheck( outAt[iLod] > 0 );
+	}
+
+	// Back again. Each level gives way to the one before nearer than it took over
+	BtFloat backAt[NumLods] = { 0 };
+	BtU32 numDecreases = 0;
+
+	for( BtU32 step=NumSteps; step>0; step-- )
+	{
+		BtFloat distance = LGetDistance( step - 1 );
+
+		BtU32 numTriangles = TsDraw::DrawFrame( pShader, LGetCamera( distance ), pMesh );
+
+		BtU32 expected = LExpectLod( pMesh, lod, distance );
+
+		if( expected != lod )
+		{
+			backAt[lod] = distance;
+		}
+		lod = expected;
+
+		if( numTriangles != NumTriangles[lod] )
+		{
+			++numWrong;
+		}
+
+		if( numTriangles < last )
+		{
+			++numDecreases;
+		}
+		last = numTriangles;
+	}
+
+	TsCheck( numWrong == 0 );
+	TsCheck( numDecreases == 0 );
+	TsCheck( last == NumTriangles[0] );
+
+	for( BtU32 iLod=1; iLod<NumLods; iLod++ )
+	{
+		TsCheck( backAt[iLod] > 0 );
+		TsCheck( backAt[iLod] < outAt[iLod] );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestJitter
+
+// A mesh moving back and forth a little either side of where a level takes over keeps
+// whichever level it had
+static void LTestJitter( RsShaderImpl *pShader, SgNodeImpl *pMesh )
+{
+	BtFloat boundary = LGetBoundary( pMesh );
+
+	// From near, so the mesh arrives at full detail
+	TsDraw::DrawFrame( pShader, LGetCamera( NearDistance ), pMesh );
+
+	BtU32 numChanges = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumJitterFrames; iFrame++ )
+	{
+		BtFloat distance = boundary * ( ( iFrame & 1 ) ? 1.05f : 0.95f );
+
+		if( TsDraw::DrawFrame( pShader, LGetCamera( distance ), pMesh ) != NumTriangles[0] )
+		{
+			++numChanges;
+		}
+	}
+	TsCheck( numChanges == 0 );
+
+	// And from far, so it arrives at the next level down
+	TsDraw::DrawFrame( pShader, LGetCamera( FarDistance ), pMesh );
+	TsDraw::DrawFrame( pShader, LGetCamera( boundary * 1.5f ), pMesh );
+
+	numChanges = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumJitterFrames; iFrame++ )
+	{
+		BtFloat distance = boundary * ( ( iFrame & 1 ) ? 1.05f : 0.95f );
+
+		if( TsDraw::DrawFrame( pShader, LGetCamera( distance ), pMesh ) != NumTriangles[1] )
+		{
+			++numChanges;
+		}
+	}
+	TsCheck( numChanges == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LDrawViews
+
+// The triangles a frame of the mesh seen from two distances sends to the device
+static BtU32 LDrawViews( RsShaderImpl *pShader, SgNodeImpl *pMesh, BtFloat distance, BtFloat otherDistance )
+{
+	TsDraw::BeginFrame( pShader, LGetCamera( distance ) );
+	pMesh->Render();
+
+	RsRenderTarget *pOther = RsUtil::GetNewRenderTarget();
+	pOther->SetCamera( LGetCamera( otherDistance ) );
+	pOther->Apply();
+	pMesh->Render();
+
+	TsDraw::EndFrame();
+
+	return RsGL::GetFrameStats().m_numVertices / 3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestViews
+
+// Two views that came to the same spot from near and from far keep the levels they had,
+// frame after frame. Were the level shared, the far view would take the near one's
+static void LTestViews( RsShaderImpl *pShader, SgNodeImpl *pMesh )
+{
+	BtFloat boundary = LGetBoundary( pMesh );
+
+	LDrawViews( pShader, pMesh, NearDistance, FarDistance );
+	LDrawViews( pShader, pMesh, NearDistance, boundary * 1.5f );
+
+	BtU32 numWrong = 0;
+
+	for( BtU32 iFrame=0; iFrame<NumJitterFrames; iFrame++ )
+	{
+		if( LDrawViews( pShader, pMesh, boundary * 1.05f, boundary * 1.05f ) != NumTriangles[0] + NumTriangles[1] )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestFullDetail
+
+// Every triangle at every distance
+static void LTestFullDetail( RsShaderImpl *pShader, SgNodeImpl *pMesh )
+{
+	BtU32 numWrong = 0;
+
+	for( BtU32 step=0; step<NumSteps; step++ )
+	{
+		if( TsDraw::DrawFrame( pShader, LGetCamera( LGetDistance( step ) ), pMesh ) != NumTriangles[0] )
+		{
+			++numWrong;
+		}
+	}
+	TsCheck( numWrong == 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	// The levels are read from an archive written next to the test
+	ApConfig::Init();
+	ApConfig::SetResourcePath( "" );
+	ApConfig::SetExtension( ".z" );
+
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL" );
+	RsSceneImpl *pScene = TsDraw::MakeScene( NumLods );
+
+	MtMatrix4 m4World;
+	m4World.SetIdentity();
+
+	SgNodeImpl *pLodMesh = TsDraw::MakeMesh( pScene, &pMaterial, 1, m4World, ScreenSizes, NumLods );
+	SgNodeImpl *pMesh = TsDraw::MakeMesh( pScene, &pMaterial, 1, m4World );
+
+	LTestWalk( pShader, pLodMesh );
+	LTestJitter( pShader, pLodMesh );
+	LTestViews( pShader, pLodMesh );
+
+	// As packed before there were levels
+	LTestFullDetail( pShader, pMesh );
+
+	// As -nolod draws
+	SgMeshWinGL::SetLod( BtFalse );
+	LTestFullDetail( pShader, pLodMesh );
+	SgMeshWinGL::SetLod( BtTrue );
+
+	TsDraw::FreeMesh( pMesh );
+	TsDraw::FreeMesh( pLodMesh );
+	TsDraw::FreeScene( pScene );
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "SgLodTest" );
+}
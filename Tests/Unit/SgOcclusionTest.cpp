@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+// SgOcclusionTest.cpp
+
+// Meshes behind an occluding wall aren't drawn and meshes the wall doesn't cover are.
+// A grid of cubes in front of, around and behind the wall is drawn on the null backend.
+// Cubes that lie wholly behind it, with a margin, must be culled and cubes that reach
+// clearly past its edges or come in front of it must be drawn. The meshes that reach the
+// device and the counts the occlusion buffer reports must agree. The buffer is drawn
+// again only when the camera or the wall changes, and nothing is culled with the wall
+// hidden or occlusion turned off
+
+#include <vector>
+#include "RsGL.h"
+#include "RsManagerImpl.h"
+#include "SgMesh.h"
+#include "SgMeshImpl.h"
+#include "SgOcclusionImpl.h"
+#include "TsDraw.h"
+#include "TsNullGL.h"
+#include "TsTest.h"
+
+// The wall is TsDraw's cube stretched to 20 by 20 and half a unit deep, 20 ahead
+const BtFloat WallHalfSize = 10.0f;
+const BtFloat WallHalfDepth = 0.5f;
+const BtFloat WallDistance = 20.0f;
+
+// The triangles each draw of the cube sends
+const BtU32 NumCubeTriangles = 12;
+
+const BtU32 NumDepths = 3;
+const BtFloat Depths[NumDepths] = { 10.0f, 40.0f, 80.0f };
+const BtS32 GridHalfSize = 10;
+const BtFloat GridSpacing = 3.0f;
+
+// How far inside or outside the wall's edges a cube has to be, as a fraction of them,
+// for its answer to be certain. Between, it depends on which pixels the edges fill
+const BtFloat EdgeMargin = 0.1f;
+
+enum LExpected
+{
+	LExpected_Hidden,
+	LExpected_Visible,
+	LExpected_Either,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LExpect
+
+// Whether the box around a cube's bounding sphere is surely behind the wall, surely not,
+// or too near an edge to say. The camera is at the origin looking down z
+static LExpected LExpect( SgNodeImpl *pNode )
+{
+	MtVector3 v3Center;
+	BtFloat radius;
+	( (SgMeshWinGL*)pNode->GetMesh() )->GetWorldSphere( v3Center, radius );
+
+	// The wall's front face is nearest, so it covers the least of the screen
+	BtFloat wallSlope = WallHalfSize / ( WallDistance - WallHalfDepth );
+
+	if( v3Center.z - radius < WallDistance + WallHalfDepth )
+	{
+		return ( v3Center.z + radius < WallDistance - WallHalfDepth ) ? LExpected_Visible : LExpected_Either;
+	}
+
+	BtFloat maxSlope = 0;
+
+	for( BtU32 i=0; i<8; i++ )
+	{
+		BtFloat x = v3Center.x + ( ( i & 1 ) ? radius : -radius );
+		BtFloat y = v3Center.y + ( ( i & 2 ) ? radius : -radius );
+		BtFloat z = v3Center.z + ( ( i & 4 ) ? radius : -radius );
+
+		maxSlope = MtMax( maxSlope, MtMax( MtAbs( x ), MtAbs( y ) ) / z );
+	}
+
+	if( maxSlope < wallSlope * ( 1.0f - EdgeMargin ) )
+	{
+		return LExpected_Hidden;
+	}
+
+	if( maxSlope > wallSlope * ( 1.0f + EdgeMargin ) )
+	{
+		return LExpected_Visible;
+	}
+	return LExpected_Either;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestCulling
+
+// The wall comes first in nodes, then the cubes
+static void LTestCulling( RsShaderImpl *pShader, const std::vector<SgNodeImpl*> &nodes, const std::vector<SgNodeImpl*> &cubes, BtU32 numInView )
+{
+	RsCamera camera = TsDraw::GetCamera();
+
+	BtU32 numDrawn = TsDraw::DrawFrame( pShader, camera, nodes ) / NumCubeTriangles;
+	SgOcclusionStats stats = SgOcclusionImpl::pInstance()->GetFrameStats();
+
+	// The wall was drawn into the buffer and everything not culled reached the device
+	TsCheck( stats.m_numOccluders == 1 );
+	TsCheck( stats.m_numTriangles == NumCubeTriangles );
+	TsCheck( stats.m_rasteriseTime > 0 );
+	TsCheck( stats.m_numCulled > 0 );
+	TsCheck( stats.m_numTested >= stats.m_numCulled );
+	TsCheck( numDrawn == 1 + numInView - stats.m_numCulled );
+
+	// The same again doesn't draw the wall again
+	TsDraw::DrawFrame( pShader, camera, nodes );
+	TsCheck( SgOcclusionImpl::pInstance()->GetFrameStats().m_numTriangles == 0 );
+	TsCheck( SgOcclusionImpl::pInstance()->GetFrameStats().m_numCulled == stats.m_numCulled );
+
+	// Each cube asked again. The frame's buffer is still current for the camera
+	BtU32 numHidden = 0;
+	BtU32 numVisible = 0;
+	BtU32 numWrong = 0;
+	BtU32 numCulled = 0;
+
+	for( BtU32 i=0; i<cubes.size(); i++ )
+	{
+		MtVector3 v3Center;
+		BtFloat radius;
+		( (SgMeshWinGL*)cubes[i]->GetMesh() )->GetWorldSphere( v3Center, radius );
+
+		if( camera.GetFrustum().IsInside( v3Center, radius ) == BtFalse )
+		{
+			continue;
+		}
+
+		BtBool isVisible = SgOcclusionImpl::pInstance()->IsVisible( v3Center, radius, camera.GetViewProjection() );
+
+		if( isVisible == BtFalse )
+		{
+			++numCulled;
+		}
+
+		switch( LExpect( cubes[i] ) )
+		{
+			case LExpected_Hidden:
+				++numHidden;
+				numWrong += ( isVisible == BtTrue ) ? 1 : 0;
+				break;
+
+			case LExpected_Visible:
+				++numVisible;
+				numWrong += ( isVisible == BtFalse ) ? 1 : 0;
+				break;
+
+			case LExpected_Either:
+				break;
+		}
+	}
+
+	// Both kinds were tried and the frame culled the same cubes
+	TsCheck( numHidden > 0 );
+	TsCheck( numVisible > 0 );
+	TsCheck( numWrong == 0 );
+	TsCheck( numCulled == (BtU32)stats.m_numCulled );
+
+	// A camera that has moved does
+	RsCamera moved = camera;
+	moved.SetPosition( MtVector3( 1.0f, 0, 0 ) );
+	moved.Update();
+
+	TsDraw::DrawFrame( pShader, moved, nodes );
+	TsCheck( SgOcclusionImpl::pInstance()->GetFrameStats().m_numTriangles == NumCubeTriangles );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LTestNothingCulled
+
+// Every mesh in view reaches the device
+static void LTestNothingCulled( RsShaderImpl *pShader, const std::vector<SgNodeImpl*> &nodes, BtU32 numInView )
+{
+	BtU32 numDrawn = TsDraw::DrawFrame( pShader, TsDraw::GetCamera(), nodes ) / NumCubeTriangles;
+
+	TsCheck( SgOcclusionImpl::pInstance()->GetFrameStats().m_numCulled == 0 );
+	TsCheck( numDrawn == numInView );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+
+int main()
+{
+	TsNullGL::Use();
+	RsImpl::pInstance()->Create();
+
+	RsShaderImpl::SetProgramCache( BtFalse );
+
+	RsShaderImpl *pShader = TsDraw::MakeShader();
+
+	if( pShader == BtNull )
+	{
+		printf( "Can't find the shaders in %s\n", TsShaderList );
+		return 1;
+	}
+
+	RsMaterialImpl *pMaterial = TsDraw::MakeMaterial( "RsShaderZL" );
+	RsSceneImpl *pScene = TsDraw::MakeScene();
+
+	MtMatrix4 m4Wall;
+	m4Wall.SetScale( WallHalfSize, WallHalfSize, WallHalfDepth );
+	m4Wall._32 = WallDistance;
+
+	SgNodeImpl *pWall = TsDraw::MakeMesh( pScene, &pMaterial, 1, m4Wall );
+	pWall->SetOccluder( BtTrue );
+
+	// Cubes in front of, level with and behind the wall, from well inside its edges to
+	// well outside them
+	std::vector<SgNodeImpl*> cubes;
+	BtU32 numInView = 0;
+
+	RsCamera camera = TsDraw::GetCamera();
+
+	for( BtU32 iDepth=0; iDepth<NumDepths; iDepth++ )
+	{
+		for( BtS32 y=-GridHalfSize; y<=GridHalfSize; y++ )
+		{
+			for( BtS32 x=-GridHalfSize; x<=GridHalfSize; x++ )
+			{
+				MtMatrix4 m4World;
+				m4World.SetTranslation( x * GridSpacing, y * GridSpacing, Depths[iDepth] );
+
+				SgNodeImpl *pCube = TsDraw::MakeMesh( pScene, &pMaterial, 1, m4World );
+				cubes.push_back( pCube );
+
+				MtVector3 v3Center;
+				BtFloat radius;
+				( (SgMeshWinGL*)pCube->GetMesh() )->GetWorldSphere( v3Center, radius );
+
+				if( camera.GetFrustum().IsInside( v3Center, radius ) == BtTrue )
+				{
+					++numInView;
+				}
+			}
+		}
+	}
+
+	// The wall then the cubes, as drawn
+	std::vector<SgNodeImpl*> nodes( 1, pWall );
+	nodes.insert( nodes.end(), cubes.begin(), cubes.end() );
+
+	LTestCulling( pShader, nodes, cubes, numInView );
+
+	// A hidden wall hides nothing
+	pWall->SetRendered( BtFalse );
+	LTestNothingCulled( pShader, nodes, numInView );
+	pWall->SetRendered( BtTrue );
+
+	// As -noocclusion draws, the wall too
+	SgOcclusionImpl::SetOcclusion( BtFalse );
+	LTestNothingCulled( pShader, nodes, numInView + 1 );
+	SgOcclusionImpl::SetOcclusion( BtTrue );
+
+	pWall->SetOccluder( BtFalse );
+
+	for( BtU32 i=0; i<cubes.size(); i++ )
+	{
+		TsDraw::FreeMesh( cubes[i] );
+	}
+	TsDraw::FreeMesh( pWall );
+	TsDraw::FreeScene( pScene );
+	TsDraw::FreeMaterial( pMaterial );
+	TsDraw::FreeShader( pShader );
+
+	RsImpl::pInstance()->Destroy();
+
+	return TsTest::Finish( "SgOcclusionTest" );
+}